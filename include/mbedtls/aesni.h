@@ -79,6 +79,73 @@ void mbedtls_aesni_gcm_mult( unsigned char c[16],
                      const unsigned char a[16],
                      const unsigned char b[16] );
 
+/**
+ * \brief          Precompute the powers of H used by
+ *                 mbedtls_aesni_gcm_crypt()
+ *
+ * \param hpow     Destination buffer for H^1 to H^4
+ * \param h        GCM hash subkey H
+ */
+void mbedtls_aesni_gcm_precompute( unsigned char hpow[64],
+                                   const unsigned char h[16] );
+
+/**
+ * \brief          AES-NI AES-GCM bulk en(de)cryption: encrypt 4 counter
+ *                 blocks at a time and update the GHASH of the ciphertext
+ *                 with a single reduction per 4 blocks
+ *
+ * \param ctx      AES context, set up for encryption
+ * \param mode     MBEDTLS_AES_ENCRYPT or MBEDTLS_AES_DECRYPT
+ * \param length   length of the input data, a multiple of 64 bytes
+ * \param y        GCM counter block, updated
+ * \param buf      GHASH value, updated
+ * \param hpow     powers of H, from mbedtls_aesni_gcm_precompute()
+ * \param input    buffer holding the input data
+ * \param output   buffer holding the output data, which may be the same
+ *                 as input
+ */
+void mbedtls_aesni_gcm_crypt( mbedtls_aes_context *ctx,
+                              int mode,
+                              size_t length,
+                              unsigned char y[16],
+                              unsigned char buf[16],
+                              const unsigned char hpow[64],
+                              const unsigned char *input,
+                              unsigned char *output );
+
+/**
+ * \brief          AES-NI AES-CBC bulk decryption: decrypt 8 blocks at a time
+ *
+ * \param ctx      AES context, set up for decryption
+ * \param length   length of the input data, a multiple of 128 bytes
+ * \param iv       initialization vector, updated
+ * \param input    buffer holding the input data
+ * \param output   buffer holding the output data, which may be the same
+ *                 as input
+ */
+void mbedtls_aesni_decrypt_cbc( mbedtls_aes_context *ctx,
+                                size_t length,
+                                unsigned char iv[16],
+                                const unsigned char *input,
+                                unsigned char *output );
+
+/**
+ * \brief          AES-NI AES-CTR bulk en(de)cryption: encrypt 8 counter
+ *                 blocks at a time
+ *
+ * \param ctx      AES context, set up for encryption
+ * \param length   length of the input data, a multiple of 128 bytes
+ * \param nonce_counter  128-bit big-endian counter block, updated
+ * \param input    buffer holding the input data
+ * \param output   buffer holding the output data, which may be the same
+ *                 as input
+ */
+void mbedtls_aesni_crypt_ctr( mbedtls_aes_context *ctx,
+                              size_t length,
+                              unsigned char nonce_counter[16],
+                              const unsigned char *input,
+                              unsigned char *output );
+
 /**
  * \brief           Compute decryption round keys from encryption round keys
  *
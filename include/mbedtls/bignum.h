@@ -138,6 +138,35 @@
 extern "C" {
 #endif
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/*
+ * Number of size classes of a scratch arena: blocks hold 2^k limbs,
+ * for k < MBEDTLS_MPI_SCRATCH_CLASSES
+ */
+#define MBEDTLS_MPI_SCRATCH_CLASSES     15
+
+/**
+ * \brief          Scratch arena for temporary MPIs
+ *
+ *                 Limbs of the MPIs bound to the arena (see
+ *                 mbedtls_mpi_init_scratch()) are carved out of a
+ *                 caller-supplied buffer instead of the heap. Freed blocks
+ *                 are reused, and the arena is rewound as a whole as soon as
+ *                 none of its blocks is in use any more.
+ */
+typedef struct mbedtls_mpi_scratch
+{
+    unsigned char *buf;         /*!<  start of the usable buffer          */
+    size_t len;                 /*!<  size of the usable buffer           */
+    size_t used;                /*!<  bytes handed out since the rewind   */
+    size_t live;                /*!<  number of blocks in use             */
+    size_t peak;                /*!<  highest value of used               */
+    size_t fallbacks;           /*!<  allocations that went to the heap   */
+    void *free_list[MBEDTLS_MPI_SCRATCH_CLASSES]; /*!<  freed blocks      */
+}
+mbedtls_mpi_scratch;
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
 /**
  * \brief          MPI structure
  */
@@ -146,6 +175,9 @@ typedef struct
     int s;              /*!<  integer sign      */
     size_t n;           /*!<  total # of limbs  */
     mbedtls_mpi_uint *p;          /*!<  pointer to limbs  */
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    mbedtls_mpi_scratch *scratch; /*!<  arena for the limbs, or NULL */
+#endif
 }
 mbedtls_mpi;
 
@@ -165,6 +197,45 @@ void mbedtls_mpi_init( mbedtls_mpi *X );
  */
 void mbedtls_mpi_free( mbedtls_mpi *X );
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/**
+ * \brief          Prepare a scratch arena over a caller-supplied buffer
+ *
+ * \param ctx      Arena to initialize
+ * \param buf      Buffer the limbs are taken from, or NULL
+ * \param len      Size of buf in bytes
+ *
+ * \note           The arena is not thread-safe: use one per thread, or per
+ *                 context used from a single thread at a time. The buffer
+ *                 must outlive every MPI bound to the arena, and only holds
+ *                 zeroized limbs once all of them have been freed.
+ */
+void mbedtls_mpi_scratch_init( mbedtls_mpi_scratch *ctx,
+                               unsigned char *buf, size_t len );
+
+/**
+ * \brief          Detach a scratch arena from its buffer
+ *
+ * \param ctx      Arena to free, with no MPI bound to it in use any more
+ */
+void mbedtls_mpi_scratch_free( mbedtls_mpi_scratch *ctx );
+
+/**
+ * \brief          Initialize one MPI whose limbs come from a scratch arena
+ *
+ *                 This is mbedtls_mpi_init() for temporaries: the limbs are
+ *                 allocated from the arena while there is room left in it,
+ *                 and from the heap otherwise (counted in
+ *                 scratch->fallbacks). The temporaries used internally by
+ *                 the functions writing to X are taken from the same
+ *                 arena.
+ *
+ * \param X        One MPI to initialize
+ * \param scratch  Arena to bind X to, or NULL for the heap
+ */
+void mbedtls_mpi_init_scratch( mbedtls_mpi *X, mbedtls_mpi_scratch *scratch );
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
 /**
  * \brief          Enlarge to the specified number of limbs
  *
@@ -609,6 +680,41 @@ int mbedtls_mpi_mod_mpi( mbedtls_mpi *R, const mbedtls_mpi *A, const mbedtls_mpi
  */
 int mbedtls_mpi_mod_int( mbedtls_mpi_uint *r, const mbedtls_mpi *A, mbedtls_mpi_sint b );
 
+/**
+ * \brief          Montgomery constant of N, for mbedtls_mpi_montg_reduce()
+ *
+ * \param mm       Destination: -N^-1 mod 2^biL, where biL is the number of
+ *                 bits in a mbedtls_mpi_uint
+ * \param N        Modular MPI, must be odd and positive
+ *
+ * \return         0 if successful,
+ *                 MBEDTLS_ERR_MPI_BAD_INPUT_DATA if N is negative or even
+ */
+int mbedtls_mpi_montg_init( mbedtls_mpi_uint *mm, const mbedtls_mpi *N );
+
+/**
+ * \brief          Montgomery reduction: X = X * R^-1 mod N, in place,
+ *                 with R = 2^( biL * N->n ) (N->n being the number of limbs
+ *                 of N as allocated)
+ *
+ * \param X        MPI to reduce, such as the product of two integers in the
+ *                 range 0..N-1. It must be non-negative and less than
+ *                 2^bitlen(N) * R.
+ * \param N        Modular MPI, odd and positive
+ * \param mm       Montgomery constant from mbedtls_mpi_montg_init( mm, N )
+ *
+ * \return         0 if successful,
+ *                 MBEDTLS_ERR_MPI_ALLOC_FAILED if memory allocation failed,
+ *                 MBEDTLS_ERR_MPI_BAD_INPUT_DATA if X is negative or too large
+ *
+ * \note           Values kept in Montgomery form, a R mod N, are multiplied
+ *                 with mbedtls_mpi_mul_mpi() followed by this function, and
+ *                 converted with a multiplication by R^2 mod N (to) or by
+ *                 this function alone (from).
+ */
+int mbedtls_mpi_montg_reduce( mbedtls_mpi *X, const mbedtls_mpi *N,
+                              mbedtls_mpi_uint mm );
+
 /**
  * \brief          Sliding-window exponentiation: X = A^E mod N
  *
@@ -629,6 +735,37 @@ int mbedtls_mpi_mod_int( mbedtls_mpi_uint *r, const mbedtls_mpi *A, mbedtls_mpi_
  */
 int mbedtls_mpi_exp_mod( mbedtls_mpi *X, const mbedtls_mpi *A, const mbedtls_mpi *E, const mbedtls_mpi *N, mbedtls_mpi *_RR );
 
+/**
+ * \brief          Fixed-window exponentiation: X = A^E mod N, with
+ *                 precomputed Montgomery constants
+ *
+ *                 Unlike mbedtls_mpi_exp_mod(), the sequence of operations
+ *                 and the memory accesses only depend on ebits, not on the
+ *                 value of E, and the constants are only read, so that they
+ *                 can be shared between threads.
+ *
+ * \param X        Destination MPI, which must not be E
+ * \param A        Left-hand MPI, non-negative
+ * \param E        Exponent MPI, non-negative and less than 2^ebits
+ * \param ebits    Number of exponent bits to process, a public bound such
+ *                 as the bit length of N
+ * \param N        Modular MPI, odd and positive
+ * \param mm       Montgomery constant from mbedtls_mpi_montg_init( mm, N )
+ * \param RR       R^2 mod N, with R = 2^( biL * N->n ) as for
+ *                 mbedtls_mpi_montg_reduce(): the value mbedtls_mpi_exp_mod()
+ *                 stores in its _RR argument
+ *
+ * \return         0 if successful,
+ *                 MBEDTLS_ERR_MPI_ALLOC_FAILED if memory allocation failed,
+ *                 MBEDTLS_ERR_MPI_BAD_INPUT_DATA if N is negative or even, if
+ *                 A or E is negative, if E has more than ebits bits or if RR
+ *                 is not in the range 1..N-1
+ */
+int mbedtls_mpi_exp_mod_fixed( mbedtls_mpi *X, const mbedtls_mpi *A,
+                               const mbedtls_mpi *E, size_t ebits,
+                               const mbedtls_mpi *N, mbedtls_mpi_uint mm,
+                               const mbedtls_mpi *RR );
+
 /**
  * \brief          Fill an MPI X with size bytes of random
  *
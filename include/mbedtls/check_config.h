@@ -69,6 +69,15 @@
 #error "MBEDTLS_AESNI_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SHANI_C) && !defined(MBEDTLS_HAVE_ASM)
+#error "MBEDTLS_SHANI_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SHA_MB_C) && !defined(MBEDTLS_SHA1_C) &&             \
+    !defined(MBEDTLS_SHA256_C)
+#error "MBEDTLS_SHA_MB_C defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_CTR_DRBG_C) && !defined(MBEDTLS_AES_C)
 #error "MBEDTLS_CTR_DRBG_C defined, but not all prerequisites"
 #endif
@@ -182,6 +191,19 @@
 #error "MBEDTLS_ECP_NORMALIZE_MXZ_ALT defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_ECP_P256_C) && ( !defined(MBEDTLS_ECP_C) ||           \
+    !defined(MBEDTLS_ECP_INTERNAL_ALT) ||                                   \
+    !defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED) )
+#error "MBEDTLS_ECP_P256_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_ECP_P256_C) && ( defined(MBEDTLS_ECP_RANDOMIZE_JAC_ALT) || \
+    defined(MBEDTLS_ECP_DOUBLE_ADD_MXZ_ALT) ||                              \
+    defined(MBEDTLS_ECP_RANDOMIZE_MXZ_ALT) ||                               \
+    defined(MBEDTLS_ECP_NORMALIZE_MXZ_ALT) )
+#error "MBEDTLS_ECP_P256_C does not provide the selected MBEDTLS_ECP_XXX_ALT functions"
+#endif
+
 #if defined(MBEDTLS_HAVEGE_C) && !defined(MBEDTLS_TIMING_C)
 #error "MBEDTLS_HAVEGE_C defined, but not all prerequisites"
 #endif
@@ -250,6 +272,10 @@
 #error "MBEDTLS_MEMORY_BUFFER_ALLOC_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA) && !defined(MBEDTLS_BIGNUM_C)
+#error "MBEDTLS_MPI_SCRATCH_ARENA defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_MILAGRO_CS_C) &&                                    \
     !defined(MBEDTLS_KEY_EXCHANGE_MILAGRO_CS_ENABLED)
 #error "MBEDTLS_MILAGRO_CS_C defined, but not all prerequisites"
@@ -507,6 +533,19 @@
 #error "MBEDTLS_X509_RSASSA_PSS_SUPPORT defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_X509_CA_STORE) && !defined(MBEDTLS_X509_CRT_PARSE_C)
+#error "MBEDTLS_X509_CA_STORE defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE) &&                               \
+    ( !defined(MBEDTLS_X509_CRT_PARSE_C) || !defined(MBEDTLS_SHA256_C) )
+#error "MBEDTLS_X509_VERIFY_CACHE defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE) && !defined(MBEDTLS_X509_CRT_PARSE_C)
+#error "MBEDTLS_X509_CRT_LAZY_PARSE defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_SSL3) && ( !defined(MBEDTLS_MD5_C) ||     \
     !defined(MBEDTLS_SHA1_C) )
 #error "MBEDTLS_SSL_PROTO_SSL3 defined, but not all prerequisites"
@@ -605,6 +644,23 @@
 #error "MBEDTLS_SSL_TICKET_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && !defined(MBEDTLS_X509_CRT_PARSE_C)
+#error "MBEDTLS_SSL_ASYNC_PRIVATE defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY) && !defined(MBEDTLS_X509_CRT_PARSE_C)
+#error "MBEDTLS_SSL_ASYNC_VERIFY defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C) && !defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+#error "MBEDTLS_SSL_BUFFER_POOL_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) &&                             \
+    defined(MBEDTLS_X509_CRT_PARSE_C) && !defined(MBEDTLS_SHA256_C)
+#error "MBEDTLS_SSL_LEAN_CONNECTIONS defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING) && \
     !defined(MBEDTLS_SSL_PROTO_SSL3) && !defined(MBEDTLS_SSL_PROTO_TLS1)
 #error "MBEDTLS_SSL_CBC_RECORD_SPLITTING defined, but not all prerequisites"
@@ -526,6 +526,24 @@
  */
 #define MBEDTLS_ECP_NIST_OPTIM
 
+/**
+ * \def MBEDTLS_ECP_MONT_FORM_OPTIM
+ *
+ * Keep the field elements of the curves that have no specific 'modulo p'
+ * routine (Brainpool curves, and the NIST curves if MBEDTLS_ECP_NIST_OPTIM
+ * is disabled) in Montgomery form during point arithmetic. Every reduction
+ * is then a Montgomery reduction instead of a generic division, which makes
+ * operations on these curves several times faster, at the cost of a few
+ * constants and a copy of the precomputed points of the generator in each
+ * group structure.
+ *
+ * Not used for the groups handled by an alternative implementation (see
+ * MBEDTLS_ECP_INTERNAL_ALT).
+ *
+ * Comment this macro to do all reductions with the generic algorithm.
+ */
+#define MBEDTLS_ECP_MONT_FORM_OPTIM
+
 /**
  * \def MBEDTLS_ECDSA_DETERMINISTIC
  *
@@ -875,6 +893,23 @@
  */
 #define MBEDTLS_GENPRIME
 
+/**
+ * \def MBEDTLS_MPI_SCRATCH_ARENA
+ *
+ * Allow the temporary MPIs of RSA, ECP, ECDSA and ECDH operations to take
+ * their limbs from a caller-supplied scratch arena instead of the heap, see
+ * mbedtls_mpi_scratch_init(), mbedtls_rsa_set_scratch() and
+ * mbedtls_ecp_group_set_scratch(). Without an arena attached, the operations
+ * keep using the heap.
+ *
+ * This adds a pointer to every MPI structure.
+ *
+ * Requires: MBEDTLS_BIGNUM_C
+ *
+ * Uncomment this macro to enable scratch arenas.
+ */
+//#define MBEDTLS_MPI_SCRATCH_ARENA
+
 /**
  * \def MBEDTLS_FS_IO
  *
@@ -1077,6 +1112,38 @@
  */
 #define MBEDTLS_SSL_ALL_ALERT_MESSAGES
 
+/**
+ * \def MBEDTLS_SSL_ASYNC_PRIVATE
+ *
+ * Enable asynchronous private key operations in the SSL server: the
+ * signature of the ServerKeyExchange message and the decryption of the RSA
+ * premaster secret can be started by the application and completed later,
+ * with the handshake returning MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS meanwhile.
+ * Disabled by default at runtime, see mbedtls_ssl_conf_async_private_cb().
+ *
+ * Requires: MBEDTLS_X509_CRT_PARSE_C
+ *
+ * Comment this macro to disable support for asynchronous private key
+ * operations.
+ */
+#define MBEDTLS_SSL_ASYNC_PRIVATE
+
+/**
+ * \def MBEDTLS_SSL_ASYNC_VERIFY
+ *
+ * Enable asynchronous verification of the peer's certificate chain: the
+ * call to mbedtls_x509_crt_verify_with_profile() in the handshake can be
+ * started by the application, e.g. on a worker thread, and completed later,
+ * with the handshake returning MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS meanwhile.
+ * Disabled by default at runtime, see mbedtls_ssl_conf_async_verify_cb().
+ *
+ * Requires: MBEDTLS_X509_CRT_PARSE_C
+ *
+ * Comment this macro to disable support for asynchronous certificate
+ * verification.
+ */
+#define MBEDTLS_SSL_ASYNC_VERIFY
+
 /**
  * \def MBEDTLS_SSL_DEBUG_ALL
  *
@@ -1168,6 +1235,45 @@
  */
 #define MBEDTLS_SSL_CBC_RECORD_SPLITTING
 
+/**
+ * \def MBEDTLS_SSL_DYNAMIC_BUFFERS
+ *
+ * Enable support for taking the TLS record buffers from a pool only while
+ * they are in use, instead of allocating them for the lifetime of each
+ * context. This reduces the memory held by idle connections. Disabled by
+ * default at runtime, see mbedtls_ssl_conf_buffer_pool().
+ *
+ * Comment this macro to disable support for dynamic record buffers.
+ */
+#define MBEDTLS_SSL_DYNAMIC_BUFFERS
+
+/**
+ * \def MBEDTLS_SSL_LEAN_CONNECTIONS
+ *
+ * Enable support for lean connections, which release the state only needed
+ * by the handshake, including the peer's certificate chain, as soon as the
+ * handshake completes. Disabled by default at runtime, see
+ * mbedtls_ssl_conf_lean().
+ *
+ * Requires: MBEDTLS_SHA256_C if MBEDTLS_X509_CRT_PARSE_C is defined
+ *
+ * Comment this macro to disable support for lean connections.
+ */
+#define MBEDTLS_SSL_LEAN_CONNECTIONS
+
+/**
+ * \def MBEDTLS_SSL_RECORD_BATCHING
+ *
+ * Enable support for batching records in the TLS record layer, for bulk
+ * transfers: outgoing application data records can be accumulated and sent
+ * together, and several incoming records can be read with a single call to
+ * the receive callback. Both are disabled by default at runtime, see
+ * mbedtls_ssl_conf_write_batching() and mbedtls_ssl_conf_read_ahead().
+ *
+ * Comment this macro to disable support for record batching.
+ */
+#define MBEDTLS_SSL_RECORD_BATCHING
+
 /**
  * \def MBEDTLS_SSL_RENEGOTIATION
  *
@@ -1445,6 +1551,47 @@
  */
 //#define MBEDTLS_X509_ALLOW_UNSUPPORTED_CRITICAL_EXTENSION
 
+/**
+ * \def MBEDTLS_X509_CA_STORE
+ *
+ * Enable indexed stores of trusted CA certificates, see
+ * mbedtls_x509_ca_store_build(). Verifying a certificate against a large
+ * list of trusted CAs then no longer compares it with every CA.
+ *
+ * Requires: MBEDTLS_X509_CRT_PARSE_C
+ *
+ * Comment this macro to disable the CA store.
+ */
+#define MBEDTLS_X509_CA_STORE
+
+/**
+ * \def MBEDTLS_X509_VERIFY_CACHE
+ *
+ * Enable the verify cache, see mbedtls_x509_crt_verify_with_cache() and
+ * mbedtls_ssl_conf_verify_cache(). Chains that are verified again, e.g.
+ * those of clients that reconnect, then skip the signature checks made in
+ * the previous verification.
+ *
+ * Requires: MBEDTLS_X509_CRT_PARSE_C, MBEDTLS_SHA256_C
+ *
+ * Comment this macro to disable the verify cache.
+ */
+#define MBEDTLS_X509_VERIFY_CACHE
+
+/**
+ * \def MBEDTLS_X509_CRT_LAZY_PARSE
+ *
+ * Enable lazy parsing of certificates, see mbedtls_x509_crt_set_lazy_parse().
+ * The names and extensions of certificates parsed into a chain in this mode
+ * are only decoded when first used, which makes loading large lists of
+ * trusted CAs faster and lighter.
+ *
+ * Requires: MBEDTLS_X509_CRT_PARSE_C
+ *
+ * Comment this macro to disable lazy parsing.
+ */
+#define MBEDTLS_X509_CRT_LAZY_PARSE
+
 /**
  * \def MBEDTLS_X509_CHECK_KEY_USAGE
  *
@@ -1935,6 +2082,31 @@
  */
 #define MBEDTLS_ECP_C
 
+/**
+ * \def MBEDTLS_ECP_P256_C
+ *
+ * Enable the built-in implementation of the MBEDTLS_ECP_INTERNAL_ALT interface
+ * for secp256r1, with field elements in fixed-size limb arrays on the stack
+ * instead of heap-allocated bignums and constant-time field arithmetic.
+ *
+ * The functions replaced are the ones whose MBEDTLS_ECP_XXX_ALT macro is
+ * defined among MBEDTLS_ECP_DOUBLE_JAC_ALT, MBEDTLS_ECP_ADD_MIXED_ALT,
+ * MBEDTLS_ECP_NORMALIZE_JAC_ALT and MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT.
+ * Other curves keep using the generic code. As this implementation has no
+ * shared state, point multiplications don't take the ECP mutex that
+ * MBEDTLS_ECP_INTERNAL_ALT otherwise implies with MBEDTLS_THREADING_C.
+ *
+ * Module:  library/ecp_p256.c
+ * Caller:  library/ecp.c
+ *
+ * Requires: MBEDTLS_ECP_C, MBEDTLS_ECP_INTERNAL_ALT,
+ *           MBEDTLS_ECP_DP_SECP256R1_ENABLED
+ *
+ * Uncomment this macro, MBEDTLS_ECP_INTERNAL_ALT and the four macros above to
+ * speed up ECDH and ECDSA on secp256r1.
+ */
+//#define MBEDTLS_ECP_P256_C
+
 /**
  * \def MBEDTLS_ENTROPY_C
  *
@@ -2356,6 +2528,55 @@
  */
 #define MBEDTLS_SHA512_C
 
+/**
+ * \def MBEDTLS_SHANI_C
+ *
+ * Enable SHA extensions and AVX2 support on x86-64.
+ *
+ * Module:  library/shani.c
+ * Caller:  library/sha256.c
+ *          library/sha512.c
+ *
+ * Requires: MBEDTLS_HAVE_ASM
+ *
+ * This modules adds support for the SHA instructions for SHA-224/256 and
+ * for AVX2 in SHA-384/512 on x86-64, used when the CPU has them.
+ */
+#define MBEDTLS_SHANI_C
+
+/**
+ * \def MBEDTLS_SHA_MB_C
+ *
+ * Enable multi-buffer SHA-1 and SHA-224/256: many independent messages
+ * hashed side by side, with mbedtls_sha1_mb(), mbedtls_sha256_mb() or
+ * mbedtls_md_multi().
+ *
+ * Module:  library/sha_mb.c
+ * Caller:  library/md.c
+ *
+ * Requires: MBEDTLS_SHA1_C or MBEDTLS_SHA256_C
+ *
+ * The messages are hashed in the lanes of the vector registers with GCC or
+ * Clang on x86-64 (SSE2, and AVX2 when the CPU has it and MBEDTLS_SHANI_C is
+ * enabled) and ARM (NEON), and one after the other elsewhere. SHA-224/256
+ * messages are also hashed one after the other when the CPU has the SHA
+ * extensions, which are faster.
+ */
+#define MBEDTLS_SHA_MB_C
+
+/**
+ * \def MBEDTLS_SSL_BUFFER_POOL_C
+ *
+ * Enable the pool of SSL record buffers, to be used with
+ * mbedtls_ssl_conf_buffer_pool().
+ *
+ * Module:  library/ssl_buffer_pool.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_SSL_DYNAMIC_BUFFERS
+ */
+#define MBEDTLS_SSL_BUFFER_POOL_C
+
 /**
  * \def MBEDTLS_SSL_CACHE_C
  *
@@ -2368,6 +2589,20 @@
  */
 #define MBEDTLS_SSL_CACHE_C
 
+/**
+ * \def MBEDTLS_SSL_CACHE_SHARDED_C
+ *
+ * Enable the sharded, hash-indexed SSL cache implementation.
+ *
+ * Compared to MBEDTLS_SSL_CACHE_C, lookups and evictions take constant time
+ * and each shard has its own lock, which suits servers holding many sessions
+ * and handshaking from many threads.
+ *
+ * Module:  library/ssl_cache_sharded.c
+ * Caller:
+ */
+#define MBEDTLS_SSL_CACHE_SHARDED_C
+
 /**
  * \def MBEDTLS_SSL_COOKIE_C
  *
@@ -2677,9 +2912,14 @@
 //#define MBEDTLS_PLATFORM_NV_SEED_READ_MACRO   mbedtls_platform_std_nv_seed_read /**< Default nv_seed_read function to use, can be undefined */
 //#define MBEDTLS_PLATFORM_NV_SEED_WRITE_MACRO  mbedtls_platform_std_nv_seed_write /**< Default nv_seed_write function to use, can be undefined */
 
+/* SSL buffer pool options */
+//#define MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_IDLE   64 /**< Maximum idle buffers kept by the pool for each buffer size */
+
 /* SSL Cache options */
 //#define MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT       86400 /**< 1 day  */
 //#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES      50 /**< Maximum entries in cache */
+//#define MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_TIMEOUT  86400 /**< 1 day  */
+//#define MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_SHARDS      16 /**< Number of independently locked shards in the sharded cache */
 
 /* SSL options */
 //#define MBEDTLS_SSL_MAX_CONTENT_LEN             16384 /**< Maxium fragment length in bytes, determines the size of each of the two internal I/O buffers */
@@ -2704,6 +2944,8 @@
 /* X509 options */
 //#define MBEDTLS_X509_MAX_INTERMEDIATE_CA   8   /**< Maximum number of intermediate CAs in a verification chain. */
 //#define MBEDTLS_X509_MAX_FILE_PATH_LEN     512 /**< Maximum length of a path/filename string in bytes including the null terminator character ('\0'). */
+//#define MBEDTLS_X509_VERIFY_CACHE_DEFAULT_TIMEOUT      3600 /**< Verify cache entry timeout in seconds (1 hour) */
+//#define MBEDTLS_X509_VERIFY_CACHE_DEFAULT_MAX_ENTRIES   100 /**< Maximum entries in the verify cache */
 
 /**
  * Allow SHA-1 in the default TLS configuration for certificate signing.
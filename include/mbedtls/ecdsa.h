@@ -127,6 +127,38 @@ int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
                   const unsigned char *buf, size_t blen,
                   const mbedtls_ecp_point *Q, const mbedtls_mpi *r, const mbedtls_mpi *s);
 
+/**
+ * \brief           Verify a batch of ECDSA signatures of previously hashed
+ *                  messages, all on the same curve
+ *
+ * \param grp       ECP group
+ * \param count     Number of signatures
+ * \param buf       Array of count message hashes
+ * \param blen      Array of count lengths of the hashes
+ * \param Q         Array of count public keys to use for verification
+ * \param r         Array of count first integers of the signatures
+ * \param s         Array of count second integers of the signatures
+ * \param results   Array of count results, each one set to what
+ *                  mbedtls_ecdsa_verify() would return for that signature
+ *
+ * \note            This is faster than verifying the signatures one by one:
+ *                  the modular inversions of the whole batch are shared, as
+ *                  is the work on a public key used for consecutive
+ *                  signatures. See mbedtls_ecp_muladd_batch().
+ *
+ * \return          0 if all the signatures are valid,
+ *                  MBEDTLS_ERR_ECP_VERIFY_FAILED if at least one of them is
+ *                  not, see results,
+ *                  or a MBEDTLS_ERR_ECP_XXX or MBEDTLS_MPI_XXX error code if
+ *                  the batch could not be processed, which is then also set
+ *                  in all the results
+ */
+int mbedtls_ecdsa_verify_batch( mbedtls_ecp_group *grp, size_t count,
+                  const unsigned char *buf[], const size_t blen[],
+                  const mbedtls_ecp_point *Q[],
+                  const mbedtls_mpi *r[], const mbedtls_mpi *s[],
+                  int results[] );
+
 /**
  * \brief           Compute ECDSA signature and write it to buffer,
  *                  serialized as defined in RFC 4492 page 20.
@@ -128,7 +128,10 @@ mbedtls_ecp_point;
  * the quantity actually used in the formulas. Also, nbits is not the size of N
  * but the required size for private keys.
  *
- * If modp is NULL, reduction modulo P is done using a generic algorithm.
+ * If modp is NULL, reduction modulo P is done using a generic algorithm, or
+ * for groups from mbedtls_ecp_group_load() if MBEDTLS_ECP_MONT_FORM_OPTIM is
+ * enabled, with Montgomery reductions on field elements kept in Montgomery
+ * form (see mbedtls_mpi_montg_reduce()), in which case T is not static.
  * Otherwise, it must point to a function that takes an mbedtls_mpi in the range
  * 0..2^(2*pbits)-1 and transforms it in-place in an integer of little more
  * than pbits, so that the integer may be efficiently brought in the 0..P-1
@@ -145,13 +148,25 @@ typedef struct
     mbedtls_mpi N;              /*!<  1. the order of G, or 2. unused               */
     size_t pbits;       /*!<  number of bits in P                           */
     size_t nbits;       /*!<  number of bits in 1. P, or 2. private keys    */
-    unsigned int h;     /*!<  internal: 1 if the constants are static       */
+    unsigned int h;     /*!<  internal: 1 if the constants and T are static */
     int (*modp)(mbedtls_mpi *); /*!<  function for fast reduction mod P             */
     int (*t_pre)(mbedtls_ecp_point *, void *);  /*!< unused                         */
     int (*t_post)(mbedtls_ecp_point *, void *); /*!< unused                         */
     void *t_data;                       /*!< unused                         */
     mbedtls_ecp_point *T;       /*!<  pre-computed points for ecp_mul_comb()        */
     size_t T_size;      /*!<  number for pre-computed points                */
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    mbedtls_mpi_uint mm;        /*!<  internal: Montgomery constant of P if field
+                                      elements are in Montgomery form, else 0   */
+    mbedtls_mpi RR;             /*!<  internal: R^2 mod P, R being the
+                                      Montgomery radix of P                     */
+    mbedtls_mpi one;            /*!<  internal: 1 in Montgomery form, R mod P   */
+    mbedtls_mpi Am;             /*!<  internal: A (or -3) in Montgomery form    */
+#endif
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    mbedtls_mpi_scratch *scratch; /*!<  arena for the temporaries of the
+                                        operations on the group, or NULL */
+#endif
 }
 mbedtls_ecp_group;
 
@@ -221,8 +236,11 @@ mbedtls_ecp_keypair;
  * ECDSA verification and ECDHE) by a factor roughly 3 to 4.
  *
  * The cost is increasing EC peak memory usage by a factor roughly 2.
+ * For the curves built into ecp_curves.c, the tables are constants computed
+ * in advance instead, shared by all groups and threads: each enabled curve
+ * costs about 4 to 7 KB of read-only data and no RAM.
  *
- * Change this value to 0 to reduce peak memory usage.
+ * Change this value to 0 to reduce peak memory usage and code size.
  */
 #define MBEDTLS_ECP_FIXED_POINT_OPTIM  1   /**< Enable fixed-point speed-up */
 #endif /* MBEDTLS_ECP_FIXED_POINT_OPTIM */
@@ -289,6 +307,15 @@ const mbedtls_ecp_curve_info *mbedtls_ecp_curve_info_from_name( const char *name
  */
 void mbedtls_ecp_point_init( mbedtls_ecp_point *pt );
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/**
+ * \brief           Initialize a point (as zero) whose coordinates take their
+ *                  limbs from a scratch arena, see mbedtls_mpi_init_scratch()
+ */
+void mbedtls_ecp_point_init_scratch( mbedtls_ecp_point *pt,
+                                     mbedtls_mpi_scratch *scratch );
+#endif
+
 /**
  * \brief           Initialize a group (to something meaningless)
  */
@@ -336,6 +363,27 @@ int mbedtls_ecp_copy( mbedtls_ecp_point *P, const mbedtls_ecp_point *Q );
  */
 int mbedtls_ecp_group_copy( mbedtls_ecp_group *dst, const mbedtls_ecp_group *src );
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/**
+ * \brief           Attach a scratch arena to a group
+ *
+ *                  The temporaries of the arithmetic on the group, including
+ *                  the precomputed points of mbedtls_ecp_mul() and
+ *                  mbedtls_ecp_muladd() that are not kept in the group, and
+ *                  the ones of ECDSA and ECDH on it, then take their limbs
+ *                  from the arena instead of the heap.
+ *
+ * \note            Attach the arena once the group is loaded: loading or
+ *                  freeing the group detaches it. The arena must not be used
+ *                  by several threads at once.
+ *
+ * \param grp       Group to use the arena for
+ * \param scratch   Arena, or NULL to use the heap again
+ */
+void mbedtls_ecp_group_set_scratch( mbedtls_ecp_group *grp,
+                                    mbedtls_mpi_scratch *scratch );
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
 /**
  * \brief           Set a point to zero
  *
@@ -537,7 +585,10 @@ int mbedtls_ecp_mul( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
  *                  (Not thread-safe to use same group in multiple threads)
  *
  * \note            In contrast to mbedtls_ecp_mul(), this function does not guarantee
- *                  a constant execution flow and timing.
+ *                  a constant execution flow and timing: it must not be used
+ *                  with secret integers. It interleaves both multiplications
+ *                  so that they share their doublings, using the
+ *                  precomputed points of the generator when P is G.
  *
  * \param grp       ECP group
  * \param R         Destination point
@@ -555,6 +606,44 @@ int mbedtls_ecp_muladd( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
              const mbedtls_mpi *m, const mbedtls_ecp_point *P,
              const mbedtls_mpi *n, const mbedtls_ecp_point *Q );
 
+/**
+ * \brief           Batch of multiplications and additions of points by
+ *                  integers: R[i] = m[i] * P + n[i] * Q[i] for i < count
+ *                  (Not thread-safe to use same group in multiple threads)
+ *
+ * \note            This gives the same results as count calls to
+ *                  mbedtls_ecp_muladd(), faster: the precomputations for P
+ *                  are done once, those for Q[i] are reused when Q[i] is
+ *                  equal to Q[i-1], and all the results are normalized
+ *                  together, with a single modular inversion.
+ *
+ * \note            Unlike mbedtls_ecp_muladd(), this function has no
+ *                  shortcut for the integers 1 and -1: all m[i] and n[i]
+ *                  must be valid private keys.
+ *
+ * \note            In contrast to mbedtls_ecp_mul(), this function does not guarantee
+ *                  a constant execution flow and timing.
+ *
+ * \param grp       ECP group
+ * \param R         Array of count destination points
+ * \param m         Array of count integers by which to multiply P
+ * \param P         Point to multiply by each m[i]
+ * \param n         Array of count integers by which to multiply Q[i]
+ * \param Q         Array of count points to be multiplied by n[i]
+ * \param count     Number of combinations
+ *
+ * \return          0 if successful,
+ *                  MBEDTLS_ERR_ECP_INVALID_KEY if one of the m[i] or n[i] is
+ *                  not a valid privkey or P or one of the Q[i] is not a valid
+ *                  pubkey,
+ *                  MBEDTLS_ERR_MPI_ALLOC_FAILED or MBEDTLS_ERR_ECP_ALLOC_FAILED
+ *                  if memory allocation failed
+ */
+int mbedtls_ecp_muladd_batch( mbedtls_ecp_group *grp, mbedtls_ecp_point R[],
+             const mbedtls_mpi *m[], const mbedtls_ecp_point *P,
+             const mbedtls_mpi *n[], const mbedtls_ecp_point *Q[],
+             size_t count );
+
 /**
  * \brief           Check that a point is a valid public key on this curve
  *
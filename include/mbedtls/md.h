@@ -255,6 +255,26 @@ int mbedtls_md_finish( mbedtls_md_context_t *ctx, unsigned char *output );
 int mbedtls_md( const mbedtls_md_info_t *md_info, const unsigned char *input, size_t ilen,
         unsigned char *output );
 
+/**
+ * \brief          output[i] = message_digest( input[i] ) for i < n
+ *
+ * \param md_info  message digest info
+ * \param n        number of messages
+ * \param input    the messages
+ * \param ilen     the lengths of the messages
+ * \param output   the Generic message digest checksum results
+ *
+ * \returns        0 on success, MBEDTLS_ERR_MD_BAD_INPUT_DATA if parameter
+ *                 verification fails.
+ *
+ * \note           With MBEDTLS_SHA_MB_C, SHA-1 and SHA-224/256 hash the
+ *                 messages side by side (see sha_mb.h), which is faster
+ *                 than calling mbedtls_md() on each of them.
+ */
+int mbedtls_md_multi( const mbedtls_md_info_t *md_info, size_t n,
+                      const unsigned char * const input[], const size_t ilen[],
+                      unsigned char * const output[] );
+
 #if defined(MBEDTLS_FS_IO)
 /**
  * \brief          Output = message_digest( file contents )
@@ -81,6 +81,10 @@ struct mbedtls_md_info_t
 
     /** Internal use only */
     void (*process_func)( void *ctx, const unsigned char *input );
+
+    /** Digest of several messages at once, NULL if only one at a time */
+    void (*multi_func)( size_t n, const unsigned char * const input[],
+                        const size_t ilen[], unsigned char * const output[] );
 };
 
 #if defined(MBEDTLS_MD2_C)
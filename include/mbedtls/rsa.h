@@ -94,6 +94,9 @@ typedef struct
     mbedtls_mpi RN;                     /*!<  cached R^2 mod N  */
     mbedtls_mpi RP;                     /*!<  cached R^2 mod P  */
     mbedtls_mpi RQ;                     /*!<  cached R^2 mod Q  */
+    mbedtls_mpi_uint mN;                /*!<  cached -N^-1 mod 2^biL, or 0 */
+    mbedtls_mpi_uint mP;                /*!<  cached -P^-1 mod 2^biL, or 0 */
+    mbedtls_mpi_uint mQ;                /*!<  cached -Q^-1 mod 2^biL, or 0 */
 
     mbedtls_mpi Vi;                     /*!<  cached blinding value     */
     mbedtls_mpi Vf;                     /*!<  cached un-blinding value  */
@@ -107,9 +110,27 @@ typedef struct
 #if defined(MBEDTLS_THREADING_C)
     mbedtls_threading_mutex_t mutex;    /*!<  Thread-safety mutex       */
 #endif
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    mbedtls_mpi_scratch *scratch;       /*!<  arena for the temporaries
+                                              of the operations, or NULL */
+#endif
 }
 mbedtls_rsa_context;
 
+/**
+ * \brief          Blinding values of a thread, for mbedtls_rsa_private_blinded()
+ */
+typedef struct
+{
+    mbedtls_mpi Vi;                     /*!<  cached blinding value     */
+    mbedtls_mpi Vf;                     /*!<  cached un-blinding value  */
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    mbedtls_mpi_scratch *scratch;       /*!<  arena for the temporaries
+                                              of the operations, or NULL */
+#endif
+}
+mbedtls_rsa_blinding;
+
 /**
  * \brief          Initialize an RSA context
  *
@@ -148,6 +169,26 @@ void mbedtls_rsa_init( mbedtls_rsa_context *ctx,
  */
 void mbedtls_rsa_set_padding( mbedtls_rsa_context *ctx, int padding, int hash_id);
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/**
+ * \brief          Attach a scratch arena to an RSA context
+ *
+ *                 The temporaries of mbedtls_rsa_public() and
+ *                 mbedtls_rsa_private() then take their limbs from the
+ *                 arena instead of the heap, while the values cached in the
+ *                 context keep using the heap.
+ *
+ * \note           The operations use the arena while holding the mutex of
+ *                 the context, but the arena must not be shared with other
+ *                 contexts used from other threads.
+ *
+ * \param ctx      RSA context to use the arena for
+ * \param scratch  Arena, or NULL to use the heap again
+ */
+void mbedtls_rsa_set_scratch( mbedtls_rsa_context *ctx,
+                              mbedtls_mpi_scratch *scratch );
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
 /**
  * \brief          Generate an RSA keypair
  *
@@ -196,6 +237,27 @@ int mbedtls_rsa_check_privkey( const mbedtls_rsa_context *ctx );
  */
 int mbedtls_rsa_check_pub_priv( const mbedtls_rsa_context *pub, const mbedtls_rsa_context *prv );
 
+/**
+ * \brief          Precompute the Montgomery constants of an RSA key
+ *
+ *                 The values R^2 mod N, P and Q and the Montgomery
+ *                 multipliers of N, P and Q are stored in the context, after
+ *                 which the private key operations only read the key. They
+ *                 are otherwise computed on the first private key operation.
+ *
+ * \note           Call this once the key is loaded, before sharing the
+ *                 context between threads that use
+ *                 mbedtls_rsa_private_blinded(). mbedtls_rsa_private() only
+ *                 holds the mutex of the context to update the shared
+ *                 blinding values (and throughout the operation if a
+ *                 scratch arena is attached).
+ *
+ * \param ctx      RSA context holding at least a public key
+ *
+ * \return         0 if successful, or an MBEDTLS_ERR_RSA_XXX error code
+ */
+int mbedtls_rsa_precompute( mbedtls_rsa_context *ctx );
+
 /**
  * \brief          Do an RSA public key operation
  *
@@ -236,6 +298,62 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
                  const unsigned char *input,
                  unsigned char *output );
 
+/**
+ * \brief          Initialize blinding values
+ *
+ * \param blind    Blinding values to be initialized
+ */
+void mbedtls_rsa_blinding_init( mbedtls_rsa_blinding *blind );
+
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/**
+ * \brief          Attach a scratch arena to blinding values, for the
+ *                 temporaries of mbedtls_rsa_private_blinded()
+ *
+ * \param blind    Blinding values of the thread owning the arena
+ * \param scratch  Arena, or NULL to use the heap again
+ */
+void mbedtls_rsa_blinding_set_scratch( mbedtls_rsa_blinding *blind,
+                                       mbedtls_mpi_scratch *scratch );
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
+/**
+ * \brief          Free blinding values
+ *
+ * \param blind    Blinding values to be freed
+ */
+void mbedtls_rsa_blinding_free( mbedtls_rsa_blinding *blind );
+
+/**
+ * \brief          Do an RSA private key operation with the blinding values
+ *                 of the calling thread
+ *
+ *                 This is mbedtls_rsa_private(), except that the blinding
+ *                 values are taken from and updated in blind instead of ctx,
+ *                 and ctx is only read: threads with their own blinding
+ *                 values use the same key without any locking.
+ *
+ * \param ctx      RSA context, on which mbedtls_rsa_precompute() was called
+ * \param blind    Blinding values, used with this key only
+ * \param f_rng    RNG function
+ * \param p_rng    RNG parameter
+ * \param input    input buffer
+ * \param output   output buffer
+ *
+ * \return         0 if successful, or an MBEDTLS_ERR_RSA_XXX error code:
+ *                 MBEDTLS_ERR_RSA_BAD_INPUT_DATA if the constants of ctx
+ *                 were not precomputed
+ *
+ * \note           The input and output buffers must be large
+ *                 enough (eg. 128 bytes if RSA-1024 is used).
+ */
+int mbedtls_rsa_private_blinded( const mbedtls_rsa_context *ctx,
+                                 mbedtls_rsa_blinding *blind,
+                                 int (*f_rng)(void *, unsigned char *, size_t),
+                                 void *p_rng,
+                                 const unsigned char *input,
+                                 unsigned char *output );
+
 /**
  * \brief          Generic wrapper to perform a PKCS#1 encryption using the
  *                 mode from the context. Add the message padding, then do an
@@ -0,0 +1,126 @@
+/**
+ * \file sha_mb.h
+ *
+ * \brief Multi-buffer SHA-1 and SHA-224/256: many independent messages
+ *        hashed side by side in the lanes of the vector registers
+ *
+ *  Copyright (C) 2006-2016, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_SHA_MB_H
+#define MBEDTLS_SHA_MB_H
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          Number of messages hashed side by side on this platform
+ *
+ * \return         8 with AVX2 (detected with MBEDTLS_SHANI_C), 4 with SSE2
+ *                 or NEON, 1 if the messages are hashed one after the other
+ */
+size_t mbedtls_sha_mb_lanes( void );
+
+#if defined(MBEDTLS_SHA1_C)
+/**
+ * \brief          output[i] = SHA-1( input[i] ) for i < n
+ *
+ * \param n        number of messages
+ * \param input    the messages, which may have any and different lengths
+ * \param ilen     the lengths of the messages
+ * \param output   the 20-byte SHA-1 checksum results
+ *
+ * \note           The messages are scheduled over the available lanes and
+ *                 a lane that finishes early starts the next message, so
+ *                 mixing short and long messages costs little.
+ */
+void mbedtls_sha1_mb( size_t n, const unsigned char * const input[],
+                      const size_t ilen[], unsigned char * const output[] );
+
+/**
+ * \brief          mbedtls_sha1_mb() on a chosen number of lanes
+ *
+ * \param n        number of messages
+ * \param input    the messages, which may have any and different lengths
+ * \param ilen     the lengths of the messages
+ * \param output   the 20-byte SHA-1 checksum results
+ * \param lanes    the largest number of lanes to use: the messages go
+ *                 through the 8-lane, 4-lane or one-after-the-other code,
+ *                 whichever is available and not above lanes
+ *
+ * \note           This is for testing and benchmarking each code path.
+ *                 mbedtls_sha1_mb() picks the lanes for the number of
+ *                 messages.
+ */
+void mbedtls_sha1_mb_ext( size_t n, const unsigned char * const input[],
+                          const size_t ilen[], unsigned char * const output[],
+                          size_t lanes );
+#endif /* MBEDTLS_SHA1_C */
+
+#if defined(MBEDTLS_SHA256_C)
+/**
+ * \brief          output[i] = SHA-256( input[i] ) for i < n
+ *
+ * \param n        number of messages
+ * \param input    the messages, which may have any and different lengths
+ * \param ilen     the lengths of the messages
+ * \param output   the SHA-224/256 checksum results
+ * \param is224    0 = use SHA256, 1 = use SHA224
+ *
+ * \note           When the CPU has the SHA extensions (MBEDTLS_SHANI_C),
+ *                 the messages are hashed one after the other with them,
+ *                 which is faster than the lanes.
+ */
+void mbedtls_sha256_mb( size_t n, const unsigned char * const input[],
+                        const size_t ilen[], unsigned char * const output[],
+                        int is224 );
+
+/**
+ * \brief          mbedtls_sha256_mb() on a chosen number of lanes
+ *
+ * \param n        number of messages
+ * \param input    the messages, which may have any and different lengths
+ * \param ilen     the lengths of the messages
+ * \param output   the SHA-224/256 checksum results
+ * \param is224    0 = use SHA256, 1 = use SHA224
+ * \param lanes    the largest number of lanes to use: the messages go
+ *                 through the 8-lane, 4-lane or one-after-the-other code,
+ *                 whichever is available and not above lanes
+ *
+ * \note           This is for testing and benchmarking each code path.
+ *                 mbedtls_sha256_mb() picks the lanes for the number of
+ *                 messages.
+ */
+void mbedtls_sha256_mb_ext( size_t n, const unsigned char * const input[],
+                            const size_t ilen[], unsigned char * const output[],
+                            int is224, size_t lanes );
+#endif /* MBEDTLS_SHA256_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* sha_mb.h */
@@ -0,0 +1,90 @@
+/**
+ * \file shani.h
+ *
+ * \brief SHA extensions and AVX2 support functions for SHA-256 and SHA-512
+ *
+ *  Copyright (C) 2006-2016, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_SHANI_H
+#define MBEDTLS_SHANI_H
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include <stdint.h>
+
+#define MBEDTLS_SHANI_SHA      0x20000000u
+#define MBEDTLS_SHANI_AVX2     0x00000020u
+
+#if defined(MBEDTLS_HAVE_ASM) && defined(__GNUC__) &&  \
+    ( defined(__amd64__) || defined(__x86_64__) )   &&  \
+    ! defined(MBEDTLS_HAVE_X86_64)
+#define MBEDTLS_HAVE_X86_64
+#endif
+
+#if defined(MBEDTLS_HAVE_X86_64)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          SHA extensions and AVX2 features detection routine
+ *
+ * \param what     The feature to detect
+ *                 (MBEDTLS_SHANI_SHA or MBEDTLS_SHANI_AVX2)
+ *
+ * \return         1 if CPU has support for the feature, 0 otherwise
+ *
+ * \note           MBEDTLS_SHANI_AVX2 is only reported when the OS saves
+ *                 the YMM registers and the CPU also has BMI2.
+ */
+int mbedtls_shani_has_support( unsigned int what );
+
+#if defined(MBEDTLS_SHA256_C)
+/**
+ * \brief          SHA-256 compression function with the SHA extensions
+ *
+ * \param state    SHA-256 intermediate digest state, updated
+ * \param data     64-byte block to process
+ */
+void mbedtls_shani_sha256_process( uint32_t state[8],
+                                   const unsigned char data[64] );
+#endif
+
+#if defined(MBEDTLS_SHA512_C)
+/**
+ * \brief          SHA-512 compression function with AVX2
+ *
+ * \param state    SHA-512 intermediate digest state, updated
+ * \param data     128-byte block to process
+ */
+void mbedtls_shani_sha512_process( uint64_t state[8],
+                                   const unsigned char data[128] );
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_HAVE_X86_64 */
+
+#endif /* MBEDTLS_SHANI_H */
@@ -115,6 +115,7 @@ defined(MBEDTLS_MILAGRO_P2P_C)
 #define MBEDTLS_ERR_SSL_UNEXPECTED_RECORD                 -0x6700  /**< Record header looks valid but is not expected. */
 #define MBEDTLS_ERR_SSL_NON_FATAL                         -0x6680  /**< The alert message received indicates a non-fatal error. */
 #define MBEDTLS_ERR_SSL_INVALID_VERIFY_HASH               -0x6600  /**< Couldn't set the hash for verifying CertificateVerify */
+#define MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS                 -0x7000  /**< An asynchronous operation is in progress; call again once it has completed. */
 
 /*
  * Various constants
@@ -185,6 +186,23 @@ defined(MBEDTLS_MILAGRO_P2P_C)
 #define MBEDTLS_SSL_CBC_RECORD_SPLITTING_DISABLED    0
 #define MBEDTLS_SSL_CBC_RECORD_SPLITTING_ENABLED     1
 
+#define MBEDTLS_SSL_READ_AHEAD_DISABLED         0
+#define MBEDTLS_SSL_READ_AHEAD_ENABLED          1
+
+#define MBEDTLS_SSL_LEAN_DISABLED               0
+#define MBEDTLS_SSL_LEAN_ENABLED                1
+
+/*
+ * Fields of the peer certificate kept in lean mode
+ */
+#define MBEDTLS_SSL_PEER_ID_SERIAL              0x01
+#define MBEDTLS_SSL_PEER_ID_ISSUER              0x02
+#define MBEDTLS_SSL_PEER_ID_SUBJECT             0x04
+#define MBEDTLS_SSL_PEER_ID_VALIDITY            0x08
+#define MBEDTLS_SSL_PEER_ID_SUBJECT_ALT_NAMES   0x10
+
+#define MBEDTLS_SSL_PEER_CERT_DIGEST_LEN        32  /* SHA-256 */
+
 #define MBEDTLS_SSL_ARC4_ENABLED                0
 #define MBEDTLS_SSL_ARC4_DISABLED               1
 
@@ -541,6 +559,37 @@ typedef void mbedtls_ssl_set_timer_t( void * ctx,
  */
 typedef int mbedtls_ssl_get_timer_t( void * ctx );
 
+/**
+ * \brief          Buffer descriptor for \c mbedtls_ssl_writev()
+ */
+typedef struct
+{
+    const unsigned char *buf;   /*!< start of the data              */
+    size_t len;                 /*!< length of the data             */
+}
+mbedtls_ssl_iovec;
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+/**
+ * \brief          Identity fields of the peer's certificate kept in lean
+ *                 mode, see \c mbedtls_ssl_conf_peer_id_fields().
+ *                 Fields that were not requested are empty.
+ */
+typedef struct
+{
+    unsigned char fields;       /*!< MBEDTLS_SSL_PEER_ID_XXX flags of the
+                                     fields present                 */
+    mbedtls_x509_buf serial;    /*!< serial number                  */
+    mbedtls_x509_buf issuer_raw;    /*!< DER issuer Name            */
+    mbedtls_x509_buf subject_raw;   /*!< DER subject Name           */
+    mbedtls_x509_time valid_from;   /*!< start of validity          */
+    mbedtls_x509_time valid_to;     /*!< end of validity            */
+    mbedtls_x509_buf subject_alt_names; /*!< DNS names of the subject
+                                     alternative names, as a series of
+                                     DER-encoded dNSName GeneralNames */
+}
+mbedtls_ssl_peer_id;
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS && MBEDTLS_X509_CRT_PARSE_C */
 
 /* Defined below */
 typedef struct mbedtls_ssl_session mbedtls_ssl_session;
@@ -558,6 +607,213 @@ typedef struct mbedtls_ssl_key_cert mbedtls_ssl_key_cert;
 typedef struct mbedtls_ssl_flight_item mbedtls_ssl_flight_item;
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+/**
+ * \brief           Callback type: start an asynchronous signature operation
+ *                  (server only)
+ *
+ * \note            This callback is called during the handshake, in place of
+ *                  signing the ServerKeyExchange message with the private
+ *                  key of \p cert. It should start the operation, e.g. hand
+ *                  it over to a worker thread or a key service, and return
+ *                  without waiting for its result, which is collected later
+ *                  by the resume callback.
+ *
+ * \note            The hash buffer is only valid during the call: copy it if
+ *                  the operation needs it later. Data about the operation
+ *                  can be kept with \c mbedtls_ssl_set_async_operation_data().
+ *
+ * \param p_async   Context for the callback
+ * \param ssl       SSL context doing the handshake
+ * \param cert      Certificate whose private key should be used
+ * \param md_alg    Hash algorithm, or MBEDTLS_MD_NONE for the MD5 + SHA-1
+ *                  concatenation used before TLS 1.2, as with
+ *                  \c mbedtls_pk_sign()
+ * \param hash      Hash to sign
+ * \param hash_len  Length of the hash
+ *
+ * \return          0 if the operation is complete already (the handshake
+ *                  then calls the resume callback at once), or
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if it was started, or
+ *                  MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH to sign with
+ *                  \c mbedtls_pk_sign() as if there were no callback, or
+ *                  another error code to abort the handshake.
+ */
+typedef int mbedtls_ssl_async_sign_t( void *p_async,
+                                      mbedtls_ssl_context *ssl,
+                                      mbedtls_x509_crt *cert,
+                                      mbedtls_md_type_t md_alg,
+                                      const unsigned char *hash,
+                                      size_t hash_len );
+
+/**
+ * \brief           Callback type: start an asynchronous decryption operation
+ *                  (server only)
+ *
+ * \note            This callback is called during the handshake, in place of
+ *                  decrypting the premaster secret of an RSA or RSA-PSK key
+ *                  exchange with the private key of \p cert. Like the
+ *                  signature callback, it should only start the operation.
+ *
+ * \note            The input buffer is only valid during the call.
+ *
+ * \note            The result is checked by the handshake in constant time
+ *                  as a local decryption would be, so that a failure doesn't
+ *                  end the handshake early (Bleichenbacher's attack): the
+ *                  operation should fail the same way for every invalid
+ *                  ciphertext.
+ *
+ * \param p_async   Context for the callback
+ * \param ssl       SSL context doing the handshake
+ * \param cert      Certificate whose private key should be used
+ * \param input     Encrypted premaster secret
+ * \param input_len Length of the input
+ *
+ * \return          Same as \c mbedtls_ssl_async_sign_t, with
+ *                  MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH meaning decryption
+ *                  with \c mbedtls_pk_decrypt(), except that other error
+ *                  codes count as a failed decryption and don't abort the
+ *                  handshake at once.
+ */
+typedef int mbedtls_ssl_async_decrypt_t( void *p_async,
+                                         mbedtls_ssl_context *ssl,
+                                         mbedtls_x509_crt *cert,
+                                         const unsigned char *input,
+                                         size_t input_len );
+
+/**
+ * \brief           Callback type: resume an asynchronous private key
+ *                  operation (server only)
+ *
+ * \note            This callback is called by \c mbedtls_ssl_handshake()
+ *                  after a start callback returned
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, each time the
+ *                  application calls it again. It should return the result
+ *                  if the operation has completed, or
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if it is still running.
+ *                  When it returns anything else, the operation is over and
+ *                  its data is reset to NULL: free it first.
+ *
+ * \param p_async   Context for the callback
+ * \param ssl       SSL context doing the handshake
+ * \param output    Buffer for the signature or the decrypted data
+ * \param output_len On success, holds the length written to \p output
+ * \param output_size Size of the output buffer
+ *
+ * \return          0 on success, or
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, or
+ *                  another error code.
+ */
+typedef int mbedtls_ssl_async_resume_t( void *p_async,
+                                        mbedtls_ssl_context *ssl,
+                                        unsigned char *output,
+                                        size_t *output_len,
+                                        size_t output_size );
+
+/**
+ * \brief           Callback type: cancel an asynchronous private key
+ *                  operation (server only)
+ *
+ * \note            This callback is called when the handshake is reset or
+ *                  freed while an operation is in progress. It should make
+ *                  sure that the operation's result won't be delivered, and
+ *                  free the operation's data.
+ *
+ * \param p_async   Context for the callback
+ * \param ssl       SSL context doing the handshake
+ */
+typedef void mbedtls_ssl_async_cancel_t( void *p_async,
+                                         mbedtls_ssl_context *ssl );
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+/**
+ * \brief           Callback type: start an asynchronous verification of the
+ *                  peer's certificate chain
+ *
+ * \note            This callback is called during the handshake, in place of
+ *                  \c mbedtls_x509_crt_verify_with_profile(). It should
+ *                  start the verification, e.g. on a worker thread, with the
+ *                  same arguments as the handshake would pass (the profile
+ *                  and expected name below, and the verification callback
+ *                  of the configuration), and return without waiting for
+ *                  its result, which is collected later by the resume
+ *                  callback.
+ *
+ * \note            \p crt, \p ca_chain and \p ca_crl stay valid until the
+ *                  verification is resumed to completion or cancelled.
+ *                  The chain must not be modified meanwhile. Data about
+ *                  the verification can be kept with
+ *                  \c mbedtls_ssl_set_async_operation_data().
+ *
+ * \param p_async_verify Context for the callback
+ * \param ssl       SSL context doing the handshake
+ * \param crt       Certificate chain sent by the peer
+ * \param ca_chain  Trusted CA chain (SNI specific one if any)
+ * \param ca_crl    Trusted CA CRLs (SNI specific ones if any)
+ * \param profile   Security profile for the verification
+ * \param cn        Expected Common Name, or NULL
+ *
+ * \return          0 if the verification is complete already (the
+ *                  handshake then calls the resume callback at once), or
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if it was started, or
+ *                  MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH to verify with
+ *                  \c mbedtls_x509_crt_verify_with_profile() as if there
+ *                  were no callback, or another error code to abort the
+ *                  handshake.
+ */
+typedef int mbedtls_ssl_async_verify_start_t( void *p_async_verify,
+                                    mbedtls_ssl_context *ssl,
+                                    mbedtls_x509_crt *crt,
+                                    mbedtls_x509_crt *ca_chain,
+                                    mbedtls_x509_crl *ca_crl,
+                                    const mbedtls_x509_crt_profile *profile,
+                                    const char *cn );
+
+/**
+ * \brief           Callback type: resume an asynchronous certificate
+ *                  verification
+ *
+ * \note            This callback is called by \c mbedtls_ssl_handshake()
+ *                  after the start callback returned 0 or
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, each time the
+ *                  application calls it again. It should return
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS while the verification
+ *                  is running. When it returns anything else, the
+ *                  verification is over and its data is reset to NULL:
+ *                  free it first.
+ *
+ * \param p_async_verify Context for the callback
+ * \param ssl       SSL context doing the handshake
+ * \param flags     Once complete, the verification flags, as set by
+ *                  \c mbedtls_x509_crt_verify_with_profile()
+ *
+ * \return          MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, or the return value
+ *                  of the verification: 0 if the chain is trusted,
+ *                  MBEDTLS_ERR_X509_CERT_VERIFY_FAILED with details in
+ *                  \p flags, or another (fatal) error code.
+ */
+typedef int mbedtls_ssl_async_verify_resume_t( void *p_async_verify,
+                                               mbedtls_ssl_context *ssl,
+                                               uint32_t *flags );
+
+/**
+ * \brief           Callback type: cancel an asynchronous certificate
+ *                  verification
+ *
+ * \note            This callback is called when the handshake is reset or
+ *                  freed while a verification is in progress, which frees
+ *                  the peer's certificate chain: it should only return once
+ *                  the verification no longer uses it, and free the
+ *                  verification's data.
+ *
+ * \param p_async_verify Context for the callback
+ * \param ssl       SSL context doing the handshake
+ */
+typedef void mbedtls_ssl_async_verify_cancel_t( void *p_async_verify,
+                                                mbedtls_ssl_context *ssl );
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+
 /*
  * This structure is used for storing current session data.
  */
@@ -574,6 +830,13 @@ struct mbedtls_ssl_session
 
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     mbedtls_x509_crt *peer_cert;        /*!< peer X.509 cert chain */
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    unsigned char peer_cert_digest[MBEDTLS_SSL_PEER_CERT_DIGEST_LEN];
+                                        /*!< SHA-256 of the peer cert,
+                                             once peer_cert is released */
+    unsigned char peer_cert_digest_len; /*!< 0 if no digest             */
+    mbedtls_ssl_peer_id *peer_id;       /*!< fields kept from peer_cert */
+#endif
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
     uint32_t verify_result;          /*!<  verification result     */
 
@@ -667,11 +930,44 @@ struct mbedtls_ssl_config
     void *p_export_keys;            /*!< context for key export callback    */
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    /** Callback to start an asynchronous signature operation               */
+    mbedtls_ssl_async_sign_t *f_async_sign_start;
+    /** Callback to start an asynchronous decryption operation              */
+    mbedtls_ssl_async_decrypt_t *f_async_decrypt_start;
+    /** Callback to resume an asynchronous private key operation            */
+    mbedtls_ssl_async_resume_t *f_async_resume;
+    /** Callback to cancel an asynchronous private key operation            */
+    mbedtls_ssl_async_cancel_t *f_async_cancel;
+    void *p_async;                  /*!< context for the async callbacks    */
+#endif
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    /** Callback to start an asynchronous certificate verification          */
+    mbedtls_ssl_async_verify_start_t *f_async_verify_start;
+    /** Callback to resume an asynchronous certificate verification         */
+    mbedtls_ssl_async_verify_resume_t *f_async_verify_resume;
+    /** Callback to cancel an asynchronous certificate verification         */
+    mbedtls_ssl_async_verify_cancel_t *f_async_verify_cancel;
+    void *p_async_verify;           /*!< context for async verification     */
+#endif
+
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /** Callback to get a record buffer                                     */
+    unsigned char *(*f_buf_get)( void *, size_t );
+    /** Callback to give a record buffer back                               */
+    void (*f_buf_put)( void *, unsigned char *, size_t );
+    void *p_buf_pool;               /*!< context for buffer callbacks       */
+#endif
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     const mbedtls_x509_crt_profile *cert_profile; /*!< verification profile */
     mbedtls_ssl_key_cert *key_cert; /*!< own certificate/key pair(s)        */
     mbedtls_x509_crt *ca_chain;     /*!< trusted CAs                        */
     mbedtls_x509_crl *ca_crl;       /*!< trusted CAs CRLs                   */
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    mbedtls_x509_verify_cache *verify_cache; /*!< cache of peer chains  */
+#endif
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
 #if defined(MBEDTLS_KEY_EXCHANGE__WITH_CERT__ENABLED)
@@ -725,11 +1021,19 @@ struct mbedtls_ssl_config
     unsigned int dhm_min_bitlen;    /*!< min. bit length of the DHM prime   */
 #endif
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    size_t write_batch_len;         /*!< size of the output batch buffer    */
+#endif
+
     unsigned char max_major_ver;    /*!< max. major version used            */
     unsigned char max_minor_ver;    /*!< max. minor version used            */
     unsigned char min_major_ver;    /*!< min. major version used            */
     unsigned char min_minor_ver;    /*!< min. minor version used            */
 
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+    unsigned char peer_id_fields;   /*!< peer cert fields kept in lean mode */
+#endif
+
     /*
      * Flags (bitfields)
      */
@@ -757,6 +1061,12 @@ struct mbedtls_ssl_config
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
     unsigned int cbc_record_splitting : 1;  /*!< do cbc record splitting    */
 #endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    unsigned int read_ahead : 1;    /*!< read more than one record at once? */
+#endif
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    unsigned int lean : 1;          /*!< release handshake-only state?      */
+#endif
 #if defined(MBEDTLS_SSL_RENEGOTIATION)
     unsigned int disable_renegotiation : 1; /*!< disable renegotiation?     */
 #endif
@@ -836,6 +1146,10 @@ struct mbedtls_ssl_context
      * Record layer (incoming data)
      */
     unsigned char *in_buf;      /*!< input buffer                     */
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    size_t in_buf_len;          /*!< size of in_buf (0 if released)   */
+    unsigned char in_ctr_save[8]; /*!< in_ctr while in_buf is released */
+#endif
     unsigned char *in_ctr;      /*!< 64-bit incoming message counter
                                      TLS: maintained by us
                                      DTLS: read from peer             */
@@ -850,9 +1164,9 @@ struct mbedtls_ssl_context
     size_t in_left;             /*!< amount of data read so far       */
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     uint16_t in_epoch;          /*!< DTLS epoch for incoming records  */
-    size_t next_record_offset;  /*!< offset of the next record in datagram
-                                     (equal to in_left if none)       */
 #endif
+    size_t next_record_offset;  /*!< offset of the next record in datagram
+                                     or read-ahead data (0 if none)   */
 #if defined(MBEDTLS_SSL_DTLS_ANTI_REPLAY)
     uint64_t in_window_top;     /*!< last validated record seq_num    */
     uint64_t in_window;         /*!< bitmask for replay detection     */
@@ -867,6 +1181,10 @@ struct mbedtls_ssl_context
      * Record layer (outgoing data)
      */
     unsigned char *out_buf;     /*!< output buffer                    */
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    size_t out_buf_len;         /*!< size of out_buf (0 if released)  */
+    unsigned char out_ctr_save[8]; /*!< out_ctr while out_buf is released */
+#endif
     unsigned char *out_ctr;     /*!< 64-bit outgoing message counter  */
     unsigned char *out_hdr;     /*!< start of record header           */
     unsigned char *out_len;     /*!< two-bytes message length field   */
@@ -883,6 +1201,12 @@ struct mbedtls_ssl_context
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
     signed char split_done;     /*!< current record already splitted? */
 #endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    unsigned char *out_batch;   /*!< protected records waiting to be sent */
+    size_t out_batch_size;      /*!< size of the out_batch buffer     */
+    size_t out_batch_len;       /*!< length of the records in out_batch */
+    size_t out_batch_left;      /*!< amount of out_batch not yet written */
+#endif
 
     /*
      * PKI layer
@@ -1339,6 +1663,107 @@ void mbedtls_ssl_conf_export_keys_cb( mbedtls_ssl_config *conf,
         void *p_export_keys );
 #endif /* MBEDTLS_SSL_EXPORT_KEYS */
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+/**
+ * \brief           Configure asynchronous private key operation callbacks
+ *                  (server only). (Default: none.)
+ *
+ *                  With these callbacks, the signature of the
+ *                  ServerKeyExchange message and the decryption of the RSA
+ *                  premaster secret don't block: the handshake starts the
+ *                  operation, and \c mbedtls_ssl_handshake() returns
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS until it has
+ *                  completed. The application calls it again once the
+ *                  result is available, e.g. when the worker that ran the
+ *                  operation wakes up the event loop.
+ *
+ * \note            Either start callback may be NULL, in which case that
+ *                  operation is done synchronously with the private key of
+ *                  the certificate as usual. The resume callback must be
+ *                  set if one of them is; the cancel callback is optional.
+ *
+ * \note            The private key of the certificate is only used when a
+ *                  start callback is NULL or returns
+ *                  MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH. Otherwise it can
+ *                  be a placeholder, for instance the certificate's public
+ *                  key, when the private key lives elsewhere.
+ *
+ * \param conf      SSL configuration context
+ * \param f_async_sign_start    Callback to start a signature
+ * \param f_async_decrypt_start Callback to start a decryption
+ * \param f_async_resume        Callback to resume an operation
+ * \param f_async_cancel        Callback to cancel an operation
+ * \param p_async   Context shared by the callbacks
+ */
+void mbedtls_ssl_conf_async_private_cb( mbedtls_ssl_config *conf,
+        mbedtls_ssl_async_sign_t *f_async_sign_start,
+        mbedtls_ssl_async_decrypt_t *f_async_decrypt_start,
+        mbedtls_ssl_async_resume_t *f_async_resume,
+        mbedtls_ssl_async_cancel_t *f_async_cancel,
+        void *p_async );
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+/**
+ * \brief           Configure asynchronous verification of the peer's
+ *                  certificate chain. (Default: none.)
+ *
+ *                  With these callbacks, the verification of the chain
+ *                  received in the Certificate message, which can take
+ *                  milliseconds for long chains with large RSA keys and
+ *                  CRLs, doesn't block: the handshake starts it, and
+ *                  \c mbedtls_ssl_handshake() returns
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS until it has
+ *                  completed. The application calls it again once the
+ *                  result is available.
+ *
+ * \note            The secondary checks of the handshake (EC curve, key
+ *                  usage extensions) and the handling of the authentication
+ *                  mode are unchanged: only the call to
+ *                  \c mbedtls_x509_crt_verify_with_profile() is replaced.
+ *
+ * \note            The resume callback must be set if the start callback
+ *                  is; the cancel callback is optional.
+ *
+ * \param conf      SSL configuration context
+ * \param f_async_verify_start  Callback to start a verification
+ * \param f_async_verify_resume Callback to resume a verification
+ * \param f_async_verify_cancel Callback to cancel a verification
+ * \param p_async_verify        Context shared by the callbacks
+ */
+void mbedtls_ssl_conf_async_verify_cb( mbedtls_ssl_config *conf,
+        mbedtls_ssl_async_verify_start_t *f_async_verify_start,
+        mbedtls_ssl_async_verify_resume_t *f_async_verify_resume,
+        mbedtls_ssl_async_verify_cancel_t *f_async_verify_cancel,
+        void *p_async_verify );
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) || defined(MBEDTLS_SSL_ASYNC_VERIFY)
+/**
+ * \brief           Get the data attached to the asynchronous operation
+ *                  (private key operation or certificate verification) in
+ *                  progress on a context
+ *
+ * \param ssl       SSL context
+ *
+ * \return          The data set with
+ *                  \c mbedtls_ssl_set_async_operation_data(), or NULL if
+ *                  none was set or no handshake is in progress.
+ */
+void *mbedtls_ssl_get_async_operation_data( const mbedtls_ssl_context *ssl );
+
+/**
+ * \brief           Attach data to the asynchronous operation in progress on
+ *                  a context, e.g. to identify the operation when resuming
+ *                  it. Does nothing if no handshake is in progress.
+ *
+ * \param ssl       SSL context
+ * \param ctx       Data to attach
+ */
+void mbedtls_ssl_set_async_operation_data( mbedtls_ssl_context *ssl,
+                                           void *ctx );
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE || MBEDTLS_SSL_ASYNC_VERIFY */
+
 /**
  * \brief          Callback type: generate a cookie
  *
@@ -1558,6 +1983,51 @@ void mbedtls_ssl_conf_session_cache( mbedtls_ssl_config *conf,
         int (*f_set_cache)(void *, const mbedtls_ssl_session *) );
 #endif /* MBEDTLS_SSL_SRV_C */
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+/**
+ * \brief          Set the callbacks providing the record buffers of TLS
+ *                 connections (Default: none, each context allocates its
+ *                 own buffers in \c mbedtls_ssl_setup())
+ *
+ *                 Without these callbacks, every context holds an input
+ *                 and an output buffer of MBEDTLS_SSL_BUFFER_LEN bytes
+ *                 (about 16 KB each) for its whole lifetime. With them,
+ *                 buffers are taken when a handshake starts or a record is
+ *                 read or written, and given back as soon as the connection
+ *                 is idle, e.g. when \c mbedtls_ssl_read() returns
+ *                 MBEDTLS_ERR_SSL_WANT_READ with no partial record pending.
+ *                 Buffers are full-size during handshakes; afterwards they
+ *                 are sized after the negotiated maximum fragment length.
+ *
+ *                 The get callback has the following parameters:
+ *                 (void *p_pool, size_t len). It should return a buffer of
+ *                 at least len bytes, or NULL if none is available.
+ *                 The put callback has the following parameters:
+ *                 (void *p_pool, unsigned char *buf, size_t len), where len
+ *                 is the length that was passed to the get callback. Buffers
+ *                 are zeroized before being given back.
+ *
+ * \note           See ssl_buffer_pool.h for a thread-safe implementation
+ *                 that keeps given back buffers for reuse.
+ *
+ * \note           The callbacks are not used for DTLS. They must be set
+ *                 before \c mbedtls_ssl_setup() and not changed while
+ *                 contexts use the configuration.
+ *
+ * \note           When a buffer can't be obtained, the function that needed
+ *                 it returns MBEDTLS_ERR_SSL_ALLOC_FAILED.
+ *
+ * \param conf     SSL configuration
+ * \param p_pool   context for both callbacks
+ * \param f_get    buffer get callback
+ * \param f_put    buffer put callback
+ */
+void mbedtls_ssl_conf_buffer_pool( mbedtls_ssl_config *conf,
+        void *p_pool,
+        unsigned char *(*f_get)( void *, size_t ),
+        void (*f_put)( void *, unsigned char *, size_t ) );
+#endif /* MBEDTLS_SSL_DYNAMIC_BUFFERS */
+
 #if defined(MBEDTLS_SSL_CLI_C)
 /**
  * \brief          Request resumption of session (client-side only)
@@ -1642,6 +2112,25 @@ void mbedtls_ssl_conf_ca_chain( mbedtls_ssl_config *conf,
                                mbedtls_x509_crt *ca_chain,
                                mbedtls_x509_crl *ca_crl );
 
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+/**
+ * \brief          Set the verify cache used to verify the peer certificate
+ *                 (Default: none)
+ *
+ * \note           With a cache, the peer's chain is verified with
+ *                 \c mbedtls_x509_crt_verify_with_cache() instead of
+ *                 \c mbedtls_x509_crt_verify_with_profile(), so that the
+ *                 signature checks of a chain that was verified before are
+ *                 skipped. The cache may be shared by several
+ *                 configurations, whatever their trusted CAs and profile.
+ *
+ * \param conf     SSL configuration
+ * \param cache    verify cache, or NULL to verify without a cache
+ */
+void mbedtls_ssl_conf_verify_cache( mbedtls_ssl_config *conf,
+                                    mbedtls_x509_verify_cache *cache );
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+
 /**
  * \brief          Set own certificate chain and private key
  *
@@ -2149,6 +2638,103 @@ void mbedtls_ssl_conf_truncated_hmac( mbedtls_ssl_config *conf, int truncate );
 void mbedtls_ssl_conf_cbc_record_splitting( mbedtls_ssl_config *conf, char split );
 #endif /* MBEDTLS_SSL_CBC_RECORD_SPLITTING */
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+/**
+ * \brief          Set the size of the buffer used to accumulate outgoing
+ *                 application data records before sending them together
+ *                 (TLS only, not DTLS). (Default: 0, no batching.)
+ *
+ *                 Once the handshake is over, each application data record
+ *                 is stored in this buffer after protection instead of
+ *                 being sent right away. The buffer is sent with a single
+ *                 call to the send callback when it can't hold another
+ *                 full-size record, before any other record, at the start
+ *                 of \c mbedtls_ssl_read(), and on \c mbedtls_ssl_flush().
+ *
+ * \note           The buffer is allocated by \c mbedtls_ssl_setup(), in
+ *                 addition to the usual input and output buffers. A size
+ *                 of a few full-size records (a multiple of
+ *                 MBEDTLS_SSL_BUFFER_LEN) is recommended.
+ *
+ * \note           Applications must call \c mbedtls_ssl_flush() when they
+ *                 are done writing and don't read or close the connection
+ *                 immediately, otherwise data may stay in the buffer.
+ *
+ * \param conf     SSL configuration
+ * \param len      size of the batch buffer in bytes, or 0 to disable
+ */
+void mbedtls_ssl_conf_write_batching( mbedtls_ssl_config *conf, size_t len );
+
+/**
+ * \brief          Enable / Disable reading ahead of incoming records
+ *                 (TLS only, not DTLS). (Default: MBEDTLS_SSL_READ_AHEAD_DISABLED)
+ *
+ *                 When enabled, once the handshake is over, the receive
+ *                 callback is asked for as much data as fits in the input
+ *                 buffer rather than exactly the current record, so that
+ *                 several small records can be read with a single call.
+ *
+ * \note           With read ahead, data may be waiting in the input buffer
+ *                 while the underlying transport has nothing to read. Event
+ *                 driven applications should use \c mbedtls_ssl_check_pending()
+ *                 before waiting for the transport to become readable.
+ *
+ * \param conf     SSL configuration
+ * \param read_ahead  MBEDTLS_SSL_READ_AHEAD_ENABLED or
+ *                 MBEDTLS_SSL_READ_AHEAD_DISABLED
+ */
+void mbedtls_ssl_conf_read_ahead( mbedtls_ssl_config *conf, char read_ahead );
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+/**
+ * \brief          Enable or disable lean connections.
+ *                 (Default: MBEDTLS_SSL_LEAN_DISABLED)
+ *
+ *                 In lean mode, state that is only needed by the handshake
+ *                 is released as soon as the handshake completes, so that
+ *                 established connections hold little more than their
+ *                 record protection state and buffers:
+ *                 - the peer's certificate chain is replaced by a SHA-256
+ *                   digest of its end-entity certificate, see
+ *                   \c mbedtls_ssl_get_peer_cert_digest(), and the fields
+ *                   selected with \c mbedtls_ssl_conf_peer_id_fields();
+ *                 - with DTLS, the key exchange and checksum state is
+ *                   released even while the last flight is kept for
+ *                   retransmission.
+ *
+ * \note           In lean mode, \c mbedtls_ssl_get_peer_cert() returns
+ *                 NULL once the handshake is over. Sessions saved with
+ *                 \c mbedtls_ssl_get_session() keep the digest and fields
+ *                 instead of the chain. A client still detects a server
+ *                 certificate change during renegotiation.
+ *
+ * \note           Session caches are given the session before the chain is
+ *                 released, so they can still restore it on resumption.
+ *
+ * \param conf     SSL configuration
+ * \param lean     MBEDTLS_SSL_LEAN_ENABLED or MBEDTLS_SSL_LEAN_DISABLED
+ */
+void mbedtls_ssl_conf_lean( mbedtls_ssl_config *conf, char lean );
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+/**
+ * \brief          Select the fields of the peer's end-entity certificate
+ *                 that are kept in lean mode, see
+ *                 \c mbedtls_ssl_get_peer_id().
+ *                 (Default: 0, only the certificate digest is kept)
+ *
+ * \param conf     SSL configuration
+ * \param fields   combination of MBEDTLS_SSL_PEER_ID_SERIAL,
+ *                 MBEDTLS_SSL_PEER_ID_ISSUER, MBEDTLS_SSL_PEER_ID_SUBJECT,
+ *                 MBEDTLS_SSL_PEER_ID_VALIDITY and
+ *                 MBEDTLS_SSL_PEER_ID_SUBJECT_ALT_NAMES
+ */
+void mbedtls_ssl_conf_peer_id_fields( mbedtls_ssl_config *conf,
+                                      unsigned char fields );
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS */
+
 #if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
 /**
  * \brief          Enable / Disable session tickets (client only).
@@ -2291,6 +2877,22 @@ void mbedtls_ssl_conf_renegotiation_period( mbedtls_ssl_config *conf,
  */
 size_t mbedtls_ssl_get_bytes_avail( const mbedtls_ssl_context *ssl );
 
+/**
+ * \brief          Check if there is data in the input buffer that has not
+ *                 been processed yet: either application data ready to be
+ *                 read, or records read ahead and not processed yet.
+ *
+ * \note           When this returns 1, \c mbedtls_ssl_read() may make
+ *                 progress without the underlying transport being readable.
+ *                 It may still return MBEDTLS_ERR_SSL_WANT_READ, for example
+ *                 if the buffered data is an incomplete record.
+ *
+ * \param ssl      SSL context
+ *
+ * \return         1 if there is pending data, 0 otherwise
+ */
+int mbedtls_ssl_check_pending( const mbedtls_ssl_context *ssl );
+
 /**
  * \brief          Return the result of the certificate verification
  *
@@ -2370,6 +2972,33 @@ size_t mbedtls_ssl_get_max_frag_len( const mbedtls_ssl_context *ssl );
  * \return         the current peer certificate
  */
 const mbedtls_x509_crt *mbedtls_ssl_get_peer_cert( const mbedtls_ssl_context *ssl );
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+/**
+ * \brief          Return the SHA-256 digest of the peer's end-entity
+ *                 certificate, as kept in lean mode
+ *
+ * \param ssl      SSL context
+ *
+ * \return         a buffer of MBEDTLS_SSL_PEER_CERT_DIGEST_LEN bytes, or
+ *                 NULL if lean mode is disabled, no handshake has completed
+ *                 or the peer sent no certificate
+ */
+const unsigned char *mbedtls_ssl_get_peer_cert_digest(
+                                        const mbedtls_ssl_context *ssl );
+
+/**
+ * \brief          Return the fields of the peer's end-entity certificate
+ *                 kept in lean mode, see
+ *                 \c mbedtls_ssl_conf_peer_id_fields()
+ *
+ * \param ssl      SSL context
+ *
+ * \return         the fields, or NULL if none were kept
+ */
+const mbedtls_ssl_peer_id *mbedtls_ssl_get_peer_id(
+                                        const mbedtls_ssl_context *ssl );
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS */
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
 #if defined(MBEDTLS_SSL_CLI_C)
@@ -2399,11 +3028,16 @@ int mbedtls_ssl_get_session( const mbedtls_ssl_context *ssl, mbedtls_ssl_session
  *
  * \return         0 if successful, or
  *                 MBEDTLS_ERR_SSL_WANT_READ or MBEDTLS_ERR_SSL_WANT_WRITE, or
+ *                 MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if an asynchronous
+ *                 private key operation or certificate verification is
+ *                 running (see \c mbedtls_ssl_conf_async_private_cb() and
+ *                 \c mbedtls_ssl_conf_async_verify_cb()), or
  *                 MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED (see below), or
  *                 a specific SSL error code.
  *
- * \note           If this function returns something other than 0 or
- *                 MBEDTLS_ERR_SSL_WANT_READ/WRITE, then the ssl context
+ * \note           If this function returns something other than 0,
+ *                 MBEDTLS_ERR_SSL_WANT_READ/WRITE or
+ *                 MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, then the ssl context
  *                 becomes unusable, and you should either free it or call
  *                 \c mbedtls_ssl_session_reset() on it before re-using it for
  *                 a new connection; the current connection must be closed.
@@ -2494,6 +3128,48 @@ int mbedtls_ssl_renegotiate( mbedtls_ssl_context *ssl );
  */
 int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len );
 
+/**
+ * \brief          Access application data in place, without copying it.
+ *                 This is an alternative to \c mbedtls_ssl_read() that
+ *                 lends the caller the decrypted data of the current record.
+ *
+ * \param ssl      SSL context
+ * \param buf      set to the start of the available data, or NULL
+ * \param len      set to the number of available bytes, or 0
+ *
+ * \return         the number of bytes available (same as *len), or
+ *                 0 for EOF, or any other \c mbedtls_ssl_read() return value
+ *                 with the same meaning and requirements.
+ *
+ * \note           The data returned never extends past the end of the
+ *                 current record: if more data is pending in later records,
+ *                 it is made available once this record is fully consumed.
+ *
+ * \note           Repeated calls return the same data until it is released
+ *                 with \c mbedtls_ssl_read_consume(). The data must not be
+ *                 modified, and is only valid until the next call to
+ *                 \c mbedtls_ssl_read_consume() or to any other function that
+ *                 may read from the connection (\c mbedtls_ssl_read(),
+ *                 \c mbedtls_ssl_handshake(), \c mbedtls_ssl_close_notify(),
+ *                 \c mbedtls_ssl_session_reset(), \c mbedtls_ssl_free()...).
+ */
+int mbedtls_ssl_read_borrow( mbedtls_ssl_context *ssl,
+                             const unsigned char **buf, size_t *len );
+
+/**
+ * \brief          Release application data obtained with
+ *                 \c mbedtls_ssl_read_borrow()
+ *
+ * \param ssl      SSL context
+ * \param len      number of bytes processed by the caller, at most the
+ *                 length returned by \c mbedtls_ssl_read_borrow(). The
+ *                 remaining bytes are returned by the next read.
+ *
+ * \return         0 if successful, or MBEDTLS_ERR_SSL_BAD_INPUT_DATA if no
+ *                 data is available or \c len is too large.
+ */
+int mbedtls_ssl_read_consume( mbedtls_ssl_context *ssl, size_t len );
+
 /**
  * \brief          Try to write exactly 'len' application data bytes
  *
@@ -2531,6 +3207,106 @@ int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
  */
 int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len );
 
+/**
+ * \brief          Try to write the concatenation of several buffers as
+ *                 application data (gather write)
+ *
+ *                 This behaves exactly as \c mbedtls_ssl_write() called on
+ *                 a single buffer holding the concatenated data, but without
+ *                 the need for the application to build that buffer: data
+ *                 from consecutive buffers is packed into the same record,
+ *                 up to the maximum fragment length.
+ *
+ * \warning        As with \c mbedtls_ssl_write(), partial writes happen.
+ *                 If the return value is non-negative but less than the
+ *                 total length, the function must be called again on the
+ *                 data that was not written yet, which may start in the
+ *                 middle of one of the buffers. Don't switch to
+ *                 \c mbedtls_ssl_write() for the rest of the data.
+ *
+ * \param ssl      SSL context
+ * \param iov      array of buffers holding the data
+ * \param iovcnt   number of buffers in the array
+ *
+ * \return         the number of bytes actually written (may be less than
+ *                 the total length), or the same error codes as
+ *                 \c mbedtls_ssl_write() with the same meaning.
+ *                 When MBEDTLS_ERR_SSL_WANT_WRITE/READ is returned, this
+ *                 function must be called later with the *same* arguments.
+ */
+int mbedtls_ssl_writev( mbedtls_ssl_context *ssl,
+                        const mbedtls_ssl_iovec *iov, size_t iovcnt );
+
+/**
+ * \brief          Send the records held back by write batching, if any
+ *                 (see \c mbedtls_ssl_conf_write_batching())
+ *
+ * \param ssl      SSL context
+ *
+ * \return         0 if successful (including if there was nothing to send),
+ *                 or MBEDTLS_ERR_SSL_WANT_WRITE or MBEDTLS_ERR_SSL_WANT_READ,
+ *                 or another negative error code.
+ *
+ * \note           When this function returns MBEDTLS_ERR_SSL_WANT_WRITE/READ,
+ *                 it must be called again later until it returns 0.
+ *
+ * \note           This does not replace calling a function that returned
+ *                 MBEDTLS_ERR_SSL_WANT_WRITE/READ again with the same
+ *                 arguments.
+ */
+int mbedtls_ssl_flush( mbedtls_ssl_context *ssl );
+
+/**
+ * \brief          Get a writable area for the plaintext of the next
+ *                 application data record, inside the output buffer.
+ *                 This is an alternative to \c mbedtls_ssl_write() that
+ *                 lets the application serialise its data in place, to be
+ *                 protected and sent by \c mbedtls_ssl_write_commit().
+ *
+ * \param ssl      SSL context
+ * \param buf      set to the start of the writable area, or NULL
+ * \param len      set to the size of the writable area (the current
+ *                 maximum fragment length, see
+ *                 \c mbedtls_ssl_get_max_frag_len()), or 0
+ *
+ * \return         0 if successful,
+ *                 or MBEDTLS_ERR_SSL_WANT_WRITE or MBEDTLS_ERR_SSL_WANT_READ,
+ *                 or MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE if 1/n-1 record
+ *                 splitting applies to the connection (use
+ *                 \c mbedtls_ssl_write() in that case),
+ *                 or another negative error code.
+ *
+ * \note           The area is only valid until the next call to
+ *                 \c mbedtls_ssl_write_commit(). No other function may be
+ *                 called on the context in between.
+ *
+ * \note           When this function returns MBEDTLS_ERR_SSL_WANT_WRITE/READ,
+ *                 it must be called again later. Other errors have the same
+ *                 consequences as for \c mbedtls_ssl_write().
+ */
+int mbedtls_ssl_write_prepare( mbedtls_ssl_context *ssl,
+                               unsigned char **buf, size_t *len );
+
+/**
+ * \brief          Protect and send the data written in place after a call
+ *                 to \c mbedtls_ssl_write_prepare(), as a single record
+ *
+ * \param ssl      SSL context
+ * \param len      number of bytes written to the area, at most the size
+ *                 returned by \c mbedtls_ssl_write_prepare()
+ *
+ * \return         0 if successful,
+ *                 or MBEDTLS_ERR_SSL_WANT_WRITE or MBEDTLS_ERR_SSL_WANT_READ,
+ *                 or MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \c len is too large,
+ *                 or another negative error code.
+ *
+ * \note           When this function returns MBEDTLS_ERR_SSL_WANT_WRITE/READ,
+ *                 the record has been protected but not fully sent yet:
+ *                 this function must be called later with the *same*
+ *                 arguments, until it returns 0.
+ */
+int mbedtls_ssl_write_commit( mbedtls_ssl_context *ssl, size_t len );
+
 /**
  * \brief           Send an alert message
  *
@@ -0,0 +1,146 @@
+/**
+ * \file ssl_buffer_pool.h
+ *
+ * \brief Pool of SSL record buffers
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_SSL_BUFFER_POOL_H
+#define MBEDTLS_SSL_BUFFER_POOL_H
+
+/*
+ * This pool provides the buffer callbacks of mbedtls_ssl_conf_buffer_pool().
+ * Buffers given back are kept on a free list for their size, up to a limit,
+ * so that connections going back and forth between idle and active don't
+ * go through the heap each time. A single pool can be shared by all
+ * contexts using a configuration, and by several configurations.
+ */
+
+#include "ssl.h"
+
+#if defined(MBEDTLS_THREADING_C)
+#include "threading.h"
+#endif
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_IDLE)
+#define MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_IDLE    64   /*!< Maximum idle buffers kept for each size */
+#endif
+
+/* \} name SECTION: Module settings */
+
+/*
+ * Record buffers come in one size per maximum fragment length, plus the
+ * full size used during handshakes.
+ */
+#define MBEDTLS_SSL_BUFFER_POOL_SIZES                6   /*!< Number of distinct buffer sizes kept */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief   Idle buffers of a given size
+ */
+typedef struct
+{
+    size_t len;                         /*!< size of the buffers (0: unused) */
+    unsigned char *head;                /*!< first idle buffer              */
+    size_t count;                       /*!< number of idle buffers         */
+}
+mbedtls_ssl_buffer_pool_list;
+
+/**
+ * \brief   Buffer pool context
+ */
+typedef struct
+{
+    mbedtls_ssl_buffer_pool_list lists[MBEDTLS_SSL_BUFFER_POOL_SIZES];
+                                        /*!< idle buffers, by size          */
+    size_t max_idle;                    /*!< max. idle buffers per size     */
+    size_t busy;                        /*!< buffers currently handed out   */
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t mutex;    /*!< mutex protecting the pool      */
+#endif
+}
+mbedtls_ssl_buffer_pool;
+
+/**
+ * \brief          Initialize a buffer pool
+ *
+ * \param pool     buffer pool
+ */
+void mbedtls_ssl_buffer_pool_init( mbedtls_ssl_buffer_pool *pool );
+
+/**
+ * \brief          Set the maximum number of idle buffers kept for each size
+ *                 (Default: MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_IDLE)
+ *
+ *                 Buffers given back beyond this limit are freed. A limit
+ *                 of 0 means the pool never keeps buffers.
+ *
+ * \param pool     buffer pool
+ * \param max_idle maximum number of idle buffers per size
+ */
+void mbedtls_ssl_buffer_pool_set_max_idle( mbedtls_ssl_buffer_pool *pool,
+                                           size_t max_idle );
+
+/**
+ * \brief          Buffer get callback implementation
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \param data     buffer pool
+ * \param len      size of the buffer
+ *
+ * \return         a zeroized buffer of len bytes, or NULL if allocation
+ *                 failed
+ */
+unsigned char *mbedtls_ssl_buffer_pool_get( void *data, size_t len );
+
+/**
+ * \brief          Buffer put callback implementation
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \param data     buffer pool
+ * \param buf      buffer obtained from mbedtls_ssl_buffer_pool_get(),
+ *                 zeroized by the caller
+ * \param len      size it was obtained with
+ */
+void mbedtls_ssl_buffer_pool_put( void *data, unsigned char *buf, size_t len );
+
+/**
+ * \brief          Free the idle buffers of a pool and clear memory
+ *
+ * \note           Contexts using the pool must be freed first.
+ *
+ * \param pool     buffer pool
+ */
+void mbedtls_ssl_buffer_pool_free( mbedtls_ssl_buffer_pool *pool );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_buffer_pool.h */
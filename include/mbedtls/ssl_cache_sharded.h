@@ -0,0 +1,193 @@
+/**
+ * \file ssl_cache_sharded.h
+ *
+ * \brief Sharded, hash-indexed SSL session cache implementation
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_SSL_CACHE_SHARDED_H
+#define MBEDTLS_SSL_CACHE_SHARDED_H
+
+/*
+ * This cache provides the same get/set callbacks as ssl_cache.h, but is
+ * meant for servers holding a large number of sessions and handling
+ * handshakes from many threads at once:
+ *
+ *  - entries are spread over a number of shards, each with its own mutex,
+ *    so that threads resuming different sessions rarely contend;
+ *  - within a shard, entries are indexed by a hash of the session id, so
+ *    lookups do not depend on the number of cached sessions;
+ *  - each shard keeps its entries on a least-recently-used list, so that
+ *    eviction when the shard is full is constant-time as well.
+ */
+
+#include "ssl.h"
+
+#if defined(MBEDTLS_THREADING_C)
+#include "threading.h"
+#endif
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_TIMEOUT)
+#define MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_TIMEOUT      86400   /*!< 1 day  */
+#endif
+
+#if !defined(MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_SHARDS)
+#define MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_SHARDS          16   /*!< Number of independently locked shards */
+#endif
+
+/* \} name SECTION: Module settings */
+
+#define MBEDTLS_SSL_CACHE_SHARDED_MAX_SHARDS             256   /*!< Maximum number of shards */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mbedtls_ssl_cache_sharded_entry mbedtls_ssl_cache_sharded_entry;
+
+/**
+ * \brief   This structure is used for storing cache entries
+ */
+struct mbedtls_ssl_cache_sharded_entry
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t timestamp;           /*!< entry timestamp            */
+#endif
+    uint32_t hash;                      /*!< hash of the session id     */
+    mbedtls_ssl_session session;        /*!< entry session              */
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    mbedtls_x509_buf peer_cert;         /*!< entry peer_cert            */
+#endif
+    mbedtls_ssl_cache_sharded_entry *hnext;     /*!< next in hash bucket    */
+    mbedtls_ssl_cache_sharded_entry *lru_prev;  /*!< more recently used     */
+    mbedtls_ssl_cache_sharded_entry *lru_next;  /*!< less recently used     */
+};
+
+/**
+ * \brief   A shard: a hash table and LRU list under a single lock
+ */
+typedef struct
+{
+    mbedtls_ssl_cache_sharded_entry **buckets;  /*!< hash buckets           */
+    size_t bucket_mask;                 /*!< number of buckets minus one    */
+    mbedtls_ssl_cache_sharded_entry *lru_head;  /*!< most recently used     */
+    mbedtls_ssl_cache_sharded_entry *lru_tail;  /*!< least recently used    */
+    size_t count;                       /*!< number of entries in shard     */
+    size_t max_entries;                 /*!< maximum entries in shard       */
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t mutex;    /*!< mutex protecting this shard    */
+#endif
+}
+mbedtls_ssl_cache_shard;
+
+/**
+ * \brief   Sharded cache context
+ */
+typedef struct
+{
+    mbedtls_ssl_cache_shard *shards;    /*!< array of shards                */
+    unsigned int shard_bits;            /*!< log2 of the number of shards   */
+    int timeout;                        /*!< cache entry timeout            */
+}
+mbedtls_ssl_cache_sharded_context;
+
+/**
+ * \brief          Initialize a sharded SSL cache context.
+ *                 (Just make it ready for mbedtls_ssl_cache_sharded_setup()
+ *                 or mbedtls_ssl_cache_sharded_free().)
+ *
+ * \param cache    SSL cache context
+ */
+void mbedtls_ssl_cache_sharded_init( mbedtls_ssl_cache_sharded_context *cache );
+
+/**
+ * \brief          Allocate the shards and hash tables of a cache context
+ *
+ * \param cache    SSL cache context
+ * \param shards   Number of shards, rounded up to a power of two, at most
+ *                 MBEDTLS_SSL_CACHE_SHARDED_MAX_SHARDS. 0 selects
+ *                 MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_SHARDS.
+ *                 Recommended value: a small multiple of the number of
+ *                 threads performing handshakes.
+ * \param max_entries  Maximum total number of cached sessions. This is split
+ *                 evenly between shards; when a shard is full, its least
+ *                 recently used entry is replaced.
+ *
+ * \note           Each shard pre-allocates one bucket pointer per entry it
+ *                 may hold, entries themselves are allocated on demand.
+ *
+ * \return         0 if successful,
+ *                 MBEDTLS_ERR_SSL_BAD_INPUT_DATA on invalid parameters, or
+ *                 MBEDTLS_ERR_SSL_ALLOC_FAILED on allocation failure.
+ */
+int mbedtls_ssl_cache_sharded_setup( mbedtls_ssl_cache_sharded_context *cache,
+                                     unsigned int shards,
+                                     size_t max_entries );
+
+/**
+ * \brief          Cache get callback implementation
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \param data     SSL cache context
+ * \param session  session to retrieve entry for
+ */
+int mbedtls_ssl_cache_sharded_get( void *data, mbedtls_ssl_session *session );
+
+/**
+ * \brief          Cache set callback implementation
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \param data     SSL cache context
+ * \param session  session to store entry for
+ */
+int mbedtls_ssl_cache_sharded_set( void *data, const mbedtls_ssl_session *session );
+
+#if defined(MBEDTLS_HAVE_TIME)
+/**
+ * \brief          Set the cache timeout
+ *                 (Default: MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_TIMEOUT (1 day))
+ *
+ *                 A timeout of 0 indicates no timeout.
+ *
+ * \param cache    SSL cache context
+ * \param timeout  cache entry timeout in seconds
+ */
+void mbedtls_ssl_cache_sharded_set_timeout( mbedtls_ssl_cache_sharded_context *cache,
+                                            int timeout );
+#endif /* MBEDTLS_HAVE_TIME */
+
+/**
+ * \brief          Free referenced items in a cache context and clear memory
+ *
+ * \param cache    SSL cache context
+ */
+void mbedtls_ssl_cache_sharded_free( mbedtls_ssl_cache_sharded_context *cache );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_cache_sharded.h */
@@ -288,6 +288,18 @@ struct mbedtls_ssl_handshake_params
 #if defined(MBEDTLS_SSL_EXTENDED_MASTER_SECRET)
     int extended_ms;                    /*!< use Extended Master Secret? */
 #endif
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) || defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    void *user_async_ctx;               /*!< data of the asynchronous
+                                             operation in progress    */
+#endif
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    int async_in_progress;              /*!< an asynchronous private key
+                                             operation is running     */
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    int async_verify_in_progress;       /*!< an asynchronous certificate
+                                             verification is running  */
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
 #if defined(MBEDTLS_MILAGRO_CS_C)
     mbedtls_milagro_cs_context *milagro_cs;
 #endif /* MBEDTLS_MILAGRO_CS_C */
@@ -397,9 +409,9 @@ void mbedtls_ssl_transform_free( mbedtls_ssl_transform *transform );
  * \brief           Free referenced items in an SSL handshake context and clear
  *                  memory
  *
- * \param handshake SSL handshake context
+ * \param ssl      SSL context whose handshake context is freed
  */
-void mbedtls_ssl_handshake_free( mbedtls_ssl_handshake_params *handshake );
+void mbedtls_ssl_handshake_free( mbedtls_ssl_context *ssl );
 
 int mbedtls_ssl_handshake_client_step( mbedtls_ssl_context *ssl );
 int mbedtls_ssl_handshake_server_step( mbedtls_ssl_context *ssl );
@@ -27,6 +27,12 @@
  * This implementation of the session ticket callbacks includes key
  * management, rotating the keys periodically in order to preserve forward
  * secrecy, when MBEDTLS_HAVE_TIME is defined.
+ *
+ * Keys are immutable once published and reference counted, so that rotation
+ * only swaps pointers and never waits for tickets being sealed or opened.
+ * Each key keeps a pool of cipher contexts, so that several threads can
+ * encrypt or decrypt tickets with the same key in parallel; the context's
+ * mutex only protects these pointer and pool updates.
  */
 
 #include "ssl.h"
@@ -40,6 +46,16 @@
 extern "C" {
 #endif
 
+/**
+ * \brief   Cipher context for one key, in a pool of idle contexts
+ */
+typedef struct mbedtls_ssl_ticket_cipher
+{
+    mbedtls_cipher_context_t ctx;               /*!< auth enc/decryption    */
+    struct mbedtls_ssl_ticket_cipher *next;     /*!< next idle context      */
+}
+mbedtls_ssl_ticket_cipher;
+
 /**
  * \brief   Information for session ticket protection
  */
@@ -47,7 +63,9 @@ typedef struct
 {
     unsigned char name[4];          /*!< random key identifier              */
     uint32_t generation_time;       /*!< key generation timestamp (seconds) */
-    mbedtls_cipher_context_t ctx;   /*!< context for auth enc/decryption    */
+    unsigned char key[32];          /*!< raw key, for new cipher contexts   */
+    unsigned int refcount;          /*!< context and in-flight operations   */
+    mbedtls_ssl_ticket_cipher *idle; /*!< cipher contexts not in use        */
 }
 mbedtls_ssl_ticket_key;
 
@@ -56,9 +74,11 @@ mbedtls_ssl_ticket_key;
  */
 typedef struct
 {
-    mbedtls_ssl_ticket_key keys[2]; /*!< ticket protection keys             */
+    mbedtls_ssl_ticket_key *keys[2]; /*!< ticket protection keys            */
     unsigned char active;           /*!< index of the currently active key  */
+    unsigned char rotating;         /*!< a new key is being generated       */
 
+    const mbedtls_cipher_info_t *cipher_info; /*!< ticket protection cipher */
     uint32_t ticket_lifetime;       /*!< lifetime of tickets in seconds     */
 
     /** Callback for getting (pseudo-)random numbers                        */
@@ -66,7 +86,7 @@ typedef struct
     void *p_rng;                    /*!< context for the RNG function       */
 
 #if defined(MBEDTLS_THREADING_C)
-    mbedtls_threading_mutex_t mutex;
+    mbedtls_threading_mutex_t mutex; /*!< protects keys, refcounts, pools   */
 #endif
 }
 mbedtls_ssl_ticket_context;
@@ -99,6 +119,12 @@ void mbedtls_ssl_ticket_init( mbedtls_ssl_ticket_context *ctx );
  *                  It is recommended to pick a reasonnable lifetime so as not
  *                  to negate the benefits of forward secrecy.
  *
+ * \note            The RNG is called without holding the context's mutex,
+ *                  so when tickets are handled from several threads, it
+ *                  must be thread-safe itself (as \c mbedtls_ctr_drbg_random()
+ *                  and \c mbedtls_hmac_drbg_random() are with
+ *                  MBEDTLS_THREADING_C).
+ *
  * \return          0 if successful,
  *                  or a specific MBEDTLS_ERR_XXX error code
  */
@@ -100,6 +100,9 @@ extern mbedtls_threading_mutex_t mbedtls_threading_gmtime_mutex;
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
 extern mbedtls_threading_mutex_t mbedtls_threading_ecp_mutex;
 #endif
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+extern mbedtls_threading_mutex_t mbedtls_threading_x509_crt_mutex;
+#endif
 #endif /* MBEDTLS_THREADING_C */
 
 #ifdef __cplusplus
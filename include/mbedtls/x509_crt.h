@@ -32,6 +32,33 @@
 #include "x509.h"
 #include "x509_crl.h"
 
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+#if defined(MBEDTLS_HAVE_TIME)
+#include "platform_time.h"
+#endif
+#if defined(MBEDTLS_THREADING_C)
+#include "threading.h"
+#endif
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_X509_VERIFY_CACHE_DEFAULT_TIMEOUT)
+#define MBEDTLS_X509_VERIFY_CACHE_DEFAULT_TIMEOUT       3600   /*!< 1 hour */
+#endif
+
+#if !defined(MBEDTLS_X509_VERIFY_CACHE_DEFAULT_MAX_ENTRIES)
+#define MBEDTLS_X509_VERIFY_CACHE_DEFAULT_MAX_ENTRIES    100   /*!< Maximum entries in the verify cache */
+#endif
+
+/* \} name SECTION: Module settings */
+
 /**
  * \addtogroup x509_module
  * \{
@@ -46,6 +73,10 @@ extern "C" {
  * \{
  */
 
+#if defined(MBEDTLS_X509_CA_STORE)
+struct mbedtls_x509_ca_store;
+#endif
+
 /**
  * Container for an X.509 certificate. The certificate may be chained.
  */
@@ -89,6 +120,15 @@ typedef struct mbedtls_x509_crt
     mbedtls_pk_type_t sig_pk;           /**< Internal representation of the Public Key algorithm of the signature algorithm, e.g. MBEDTLS_PK_RSA */
     void *sig_opts;             /**< Signature options to be passed to mbedtls_pk_verify_ext(), e.g. for RSASSA-PSS */
 
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    int lazy_parse;             /**< Names and extensions are decoded on first use. See mbedtls_x509_crt_set_lazy_parse(). */
+    int lazy_pending;           /**< Internal: parts of a lazily parsed certificate not decoded yet. */
+#endif
+
+#if defined(MBEDTLS_X509_CA_STORE)
+    const struct mbedtls_x509_ca_store *ca_store; /**< Index of the chain headed by this certificate, if any. See mbedtls_x509_ca_store_build(). */
+#endif
+
     struct mbedtls_x509_crt *next;     /**< Next certificate in the CA-chain. */
 }
 mbedtls_x509_crt;
@@ -113,6 +153,73 @@ typedef struct
 }
 mbedtls_x509_crt_profile;
 
+#if defined(MBEDTLS_X509_CA_STORE)
+struct mbedtls_x509_ca_entry;
+
+/**
+ * Index of a chain of trusted CA certificates, to find the possible parents
+ * of a certificate in constant time during verification instead of
+ * comparing its issuer with the subject of every CA.
+ */
+typedef struct mbedtls_x509_ca_store
+{
+    mbedtls_x509_crt *chain;            /**< The indexed chain */
+    size_t count;                       /**< Number of certificates */
+    size_t size;                        /**< Number of buckets, a power of 2 */
+    struct mbedtls_x509_ca_entry *entries; /**< One per certificate, in chain order */
+    size_t *buckets;                    /**< Index + 1 of the first entry of each bucket, or 0 */
+}
+mbedtls_x509_ca_store;
+#endif /* MBEDTLS_X509_CA_STORE */
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+#define MBEDTLS_X509_VERIFY_CACHE_MAX_SIGS      16  /**< Signature checks remembered per chain */
+
+/**
+ * Outcome of the check of the signature of a certificate of a chain with
+ * the public key of a possible issuer
+ */
+typedef struct
+{
+    unsigned char issuer[32];           /*!< hash of the issuer's DER   */
+    unsigned char child;                /*!< position in the chain      */
+    unsigned char valid;                /*!< 1 if the signature is valid */
+}
+mbedtls_x509_verify_cache_sig;
+
+typedef struct mbedtls_x509_verify_cache_entry mbedtls_x509_verify_cache_entry;
+
+/**
+ * Entry of a verify cache: the signature checks made while verifying a chain
+ */
+struct mbedtls_x509_verify_cache_entry
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t timestamp;           /*!< entry timestamp            */
+#endif
+    unsigned char key[32];              /*!< hash of chain and profile  */
+    size_t sig_count;                   /*!< number of signature checks */
+    mbedtls_x509_verify_cache_sig sigs[MBEDTLS_X509_VERIFY_CACHE_MAX_SIGS]; /*!< signature checks */
+    mbedtls_x509_verify_cache_entry *next; /*!< chain pointer           */
+};
+
+/**
+ * Verify cache context
+ */
+typedef struct
+{
+    mbedtls_x509_verify_cache_entry *chain; /*!< start of the chain     */
+    int timeout;                        /*!< cache entry timeout        */
+    int max_entries;                    /*!< maximum entries            */
+    unsigned long hits;                 /*!< verifications of a known chain */
+    unsigned long misses;               /*!< verifications of a new chain */
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t mutex;    /*!< mutex                      */
+#endif
+}
+mbedtls_x509_verify_cache;
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+
 #define MBEDTLS_X509_CRT_VERSION_1              0
 #define MBEDTLS_X509_CRT_VERSION_2              1
 #define MBEDTLS_X509_CRT_VERSION_3              2
@@ -222,6 +329,50 @@ int mbedtls_x509_crt_parse_file( mbedtls_x509_crt *chain, const char *path );
 int mbedtls_x509_crt_parse_path( mbedtls_x509_crt *chain, const char *path );
 #endif /* MBEDTLS_FS_IO */
 
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+/**
+ * \brief          Enable or disable lazy parsing for a certificate chain.
+ *
+ *                 Certificates later added to the chain by the
+ *                 \c mbedtls_x509_crt_parse_xxx() functions keep their
+ *                 issuer and subject names and their extensions in raw
+ *                 form; these are decoded on first use by the
+ *                 verification, \c mbedtls_x509_crt_info() and the key
+ *                 usage checks. The signature fields and the public key
+ *                 are still parsed immediately. This saves time and
+ *                 memory for large sets of trusted CAs of which only a
+ *                 few are used.
+ *
+ * \note           Errors in the deferred fields are only reported when
+ *                 they are decoded, so a malformed certificate may be
+ *                 accepted by the parsing functions.
+ *
+ * \note           Applications reading the name or extension fields of
+ *                 the structure directly must call
+ *                 \c mbedtls_x509_crt_decode() first.
+ *
+ * \param chain    points to the start of the chain, initialized and
+ *                 not holding any certificate yet
+ * \param lazy     1 to enable lazy parsing, 0 to disable it (default)
+ */
+void mbedtls_x509_crt_set_lazy_parse( mbedtls_x509_crt *chain, int lazy );
+
+/**
+ * \brief          Decode the names and extensions of a lazily parsed
+ *                 certificate, if not done yet. Does nothing for a
+ *                 certificate that was parsed in full.
+ *
+ * \note           With MBEDTLS_THREADING_C, this function (and the
+ *                 library functions calling it) may be used on a
+ *                 certificate shared between threads.
+ *
+ * \param crt      certificate to decode (not the rest of its chain)
+ *
+ * \return         0 if successful, or a specific X509 or ASN1 error code
+ */
+int mbedtls_x509_crt_decode( mbedtls_x509_crt *crt );
+#endif /* MBEDTLS_X509_CRT_LAZY_PARSE */
+
 /**
  * \brief          Returns an informational string about the
  *                 certificate.
@@ -338,6 +489,47 @@ int mbedtls_x509_crt_verify_with_profile( mbedtls_x509_crt *crt,
                      int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
                      void *p_vrfy );
 
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+/**
+ * \brief          Verify the certificate signature according to profile,
+ *                 reusing the signature checks of a previous verification
+ *                 of the same chain.
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \note           Same as \c mbedtls_x509_crt_verify_with_profile(), but
+ *                 the outcome of the signature checks is looked up in, and
+ *                 stored into, the cache, under a hash of the DER of the
+ *                 chain and of the profile. Each outcome is recorded with
+ *                 a hash of the issuer certificate it was checked with, so
+ *                 that it is only reused with the same issuer, whatever
+ *                 the trusted CAs. Everything else, including validity dates,
+ *                 CRLs, the expected CN and the calls to f_vrfy, is
+ *                 checked as without the cache, so that the result is the
+ *                 same.
+ *
+ * \param crt      a certificate (chain) to be verified
+ * \param trust_ca the list of trusted CAs
+ * \param ca_crl   the list of CRLs for trusted CAs
+ * \param profile  security profile for verification
+ * \param cache    verify cache
+ * \param cn       expected Common Name (can be set to
+ *                 NULL if the CN must not be verified)
+ * \param flags    result of the verification
+ * \param f_vrfy   verification function
+ * \param p_vrfy   verification parameter
+ *
+ * \return         as \c mbedtls_x509_crt_verify_with_profile()
+ */
+int mbedtls_x509_crt_verify_with_cache( mbedtls_x509_crt *crt,
+                     mbedtls_x509_crt *trust_ca,
+                     mbedtls_x509_crl *ca_crl,
+                     const mbedtls_x509_crt_profile *profile,
+                     mbedtls_x509_verify_cache *cache,
+                     const char *cn, uint32_t *flags,
+                     int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                     void *p_vrfy );
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+
 #if defined(MBEDTLS_X509_CHECK_KEY_USAGE)
 /**
  * \brief          Check usage of certificate against keyUsage extension.
@@ -408,6 +600,104 @@ void mbedtls_x509_crt_init( mbedtls_x509_crt *crt );
  * \param crt      Certificate chain to free
  */
 void mbedtls_x509_crt_free( mbedtls_x509_crt *crt );
+
+#if defined(MBEDTLS_X509_CA_STORE)
+/**
+ * \brief          Initialize a CA store
+ *
+ * \param store    CA store to initialize
+ */
+void mbedtls_x509_ca_store_init( mbedtls_x509_ca_store *store );
+
+/**
+ * \brief          Index a chain of trusted CA certificates.
+ *
+ *                 The index is attached to the first certificate of the
+ *                 chain, and used whenever that chain is passed as the
+ *                 trusted CAs of \c mbedtls_x509_crt_verify() and
+ *                 \c mbedtls_x509_crt_verify_with_profile(), including
+ *                 through \c mbedtls_ssl_conf_ca_chain(). The parents of a
+ *                 certificate are then looked up by a hash of its issuer
+ *                 name, and when it has an authority key identifier, the
+ *                 CAs whose subject key identifier matches are tried
+ *                 first.
+ *
+ * \note           Certificates added to the chain afterwards are not
+ *                 indexed: the verification then walks the whole chain as
+ *                 without a store. Call this function again to update the
+ *                 index.
+ *
+ * \note           The store must be freed before the chain, and must not
+ *                 be modified while a verification is using it.
+ *
+ * \param store    CA store, initialized or built already
+ * \param chain    Trusted CA certificates to index
+ *
+ * \return         0 if successful, or MBEDTLS_ERR_X509_ALLOC_FAILED
+ */
+int mbedtls_x509_ca_store_build( mbedtls_x509_ca_store *store,
+                                 mbedtls_x509_crt *chain );
+
+/**
+ * \brief          Free a CA store, and detach it from its chain
+ *
+ * \param store    CA store to free
+ */
+void mbedtls_x509_ca_store_free( mbedtls_x509_ca_store *store );
+#endif /* MBEDTLS_X509_CA_STORE */
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+/**
+ * \brief          Initialize a verify cache
+ *
+ * \param cache    verify cache
+ */
+void mbedtls_x509_verify_cache_init( mbedtls_x509_verify_cache *cache );
+
+#if defined(MBEDTLS_HAVE_TIME)
+/**
+ * \brief          Set the cache timeout
+ *                 (Default: MBEDTLS_X509_VERIFY_CACHE_DEFAULT_TIMEOUT (1 hour))
+ *
+ *                 A timeout of 0 indicates no timeout.
+ *
+ * \param cache    verify cache
+ * \param timeout  cache entry timeout in seconds
+ */
+void mbedtls_x509_verify_cache_set_timeout( mbedtls_x509_verify_cache *cache,
+                                            int timeout );
+#endif /* MBEDTLS_HAVE_TIME */
+
+/**
+ * \brief          Set the maximum number of cache entries
+ *                 (Default: MBEDTLS_X509_VERIFY_CACHE_DEFAULT_MAX_ENTRIES (100))
+ *
+ * \param cache    verify cache
+ * \param max      cache entry maximum
+ */
+void mbedtls_x509_verify_cache_set_max_entries( mbedtls_x509_verify_cache *cache,
+                                                int max );
+
+/**
+ * \brief          Get the number of verifications that found their chain
+ *                 in the cache, and of those that did not
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \param cache    verify cache
+ * \param hits     set to the number of cache hits
+ * \param misses   set to the number of cache misses
+ */
+void mbedtls_x509_verify_cache_get_stats( mbedtls_x509_verify_cache *cache,
+                                          unsigned long *hits,
+                                          unsigned long *misses );
+
+/**
+ * \brief          Free referenced items in a verify cache and clear memory
+ *
+ * \param cache    verify cache
+ */
+void mbedtls_x509_verify_cache_free( mbedtls_x509_verify_cache *cache );
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
 /* \} name */
@@ -884,6 +884,22 @@ int mbedtls_aes_crypt_cbc( mbedtls_aes_context *ctx,
     }
 #endif
 
+#if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
+    if( mode == MBEDTLS_AES_DECRYPT && length >= 128 &&
+        mbedtls_aesni_has_support( MBEDTLS_AESNI_AES ) )
+    {
+        size_t use_len = length & ~( (size_t) 127 );
+
+        /* Whole 8-block groups go through the multi-block path, the
+         * remaining blocks through the loop below */
+        mbedtls_aesni_decrypt_cbc( ctx, use_len, iv, input, output );
+
+        input  += use_len;
+        output += use_len;
+        length -= use_len;
+    }
+#endif
+
     if( mode == MBEDTLS_AES_DECRYPT )
     {
         while( length > 0 )
@@ -1016,6 +1032,31 @@ int mbedtls_aes_crypt_ctr( mbedtls_aes_context *ctx,
     int c, i;
     size_t n = *nc_off;
 
+#if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
+    if( length >= 128 && mbedtls_aesni_has_support( MBEDTLS_AESNI_AES ) )
+    {
+        size_t use_len;
+
+        /* Use up the current stream block, so that the multi-block path
+         * starts on a block boundary */
+        while( n != 0 && length > 0 )
+        {
+            c = *input++;
+            *output++ = (unsigned char)( c ^ stream_block[n] );
+
+            n = ( n + 1 ) & 0x0F;
+            length--;
+        }
+
+        use_len = length & ~( (size_t) 127 );
+        mbedtls_aesni_crypt_ctr( ctx, use_len, nonce_counter, input, output );
+
+        input  += use_len;
+        output += use_len;
+        length -= use_len;
+    }
+#endif
+
     while( length-- )
     {
         if( n == 0 ) {
@@ -80,6 +80,7 @@ int mbedtls_aesni_has_support( unsigned int what )
 #define AESIMC      ".byte 0x66,0x0F,0x38,0xDB,"
 #define AESKEYGENA  ".byte 0x66,0x0F,0x3A,0xDF,"
 #define PCLMULQDQ   ".byte 0x66,0x0F,0x3A,0x44,"
+#define PSHUFB      ".byte 0x66,0x0F,0x38,0x00,"
 
 #define xmm0_xmm0   "0xC0"
 #define xmm0_xmm1   "0xC8"
@@ -88,6 +89,29 @@ int mbedtls_aesni_has_support( unsigned int what )
 #define xmm0_xmm4   "0xE0"
 #define xmm1_xmm0   "0xC1"
 #define xmm1_xmm2   "0xD1"
+#define xmm4_xmm0   "0xC4"
+#define xmm4_xmm1   "0xCC"
+#define xmm4_xmm2   "0xD4"
+#define xmm4_xmm3   "0xDC"
+
+/*
+ * Same instructions with a REX.B prefix, so that the source operand is xmm8:
+ * the 8-block kernels keep their data in xmm0 to xmm7 and the round key in
+ * xmm8. Only to be used with the xmm8_xmmN operands below.
+ */
+#define AESDEC_R8       ".byte 0x66,0x41,0x0F,0x38,0xDE,"
+#define AESDECLAST_R8   ".byte 0x66,0x41,0x0F,0x38,0xDF,"
+#define AESENC_R8       ".byte 0x66,0x41,0x0F,0x38,0xDC,"
+#define AESENCLAST_R8   ".byte 0x66,0x41,0x0F,0x38,0xDD,"
+
+#define xmm8_xmm0   "0xC0"
+#define xmm8_xmm1   "0xC8"
+#define xmm8_xmm2   "0xD0"
+#define xmm8_xmm3   "0xD8"
+#define xmm8_xmm4   "0xE0"
+#define xmm8_xmm5   "0xE8"
+#define xmm8_xmm6   "0xF0"
+#define xmm8_xmm7   "0xF8"
 
 /*
  * AES-NI AES-ECB block en(de)cryption
@@ -134,6 +158,72 @@ int mbedtls_aesni_crypt_ecb( mbedtls_aes_context *ctx,
     return( 0 );
 }
 
+/*
+ * Reduce xmm2:xmm1 = x3:x2:x1:x0, the carry-less product of two byte-reversed
+ * elements of GF(2^128), into xmm0. Clobbers xmm1 to xmm5.
+ */
+#define GCM_SHIFT_REDUCE                                                    \
+         /*                                                                 \
+          * Now shift the result one bit to the left,                       \
+          * taking advantage of [CLMUL-WP] eq 27 (p. 20)                    \
+          */                                                                \
+         "movdqa %%xmm1, %%xmm3             \n\t" /* r1:r0 */               \
+         "movdqa %%xmm2, %%xmm4             \n\t" /* r3:r2 */               \
+         "psllq $1, %%xmm1                  \n\t" /* r1<<1:r0<<1 */         \
+         "psllq $1, %%xmm2                  \n\t" /* r3<<1:r2<<1 */         \
+         "psrlq $63, %%xmm3                 \n\t" /* r1>>63:r0>>63 */       \
+         "psrlq $63, %%xmm4                 \n\t" /* r3>>63:r2>>63 */       \
+         "movdqa %%xmm3, %%xmm5             \n\t" /* r1>>63:r0>>63 */       \
+         "pslldq $8, %%xmm3                 \n\t" /* r0>>63:0 */            \
+         "pslldq $8, %%xmm4                 \n\t" /* r2>>63:0 */            \
+         "psrldq $8, %%xmm5                 \n\t" /* 0:r1>>63 */            \
+         "por %%xmm3, %%xmm1                \n\t" /* r1<<1|r0>>63:r0<<1 */  \
+         "por %%xmm4, %%xmm2                \n\t" /* r3<<1|r2>>62:r2<<1 */  \
+         "por %%xmm5, %%xmm2                \n\t" /* r3<<1|r2>>62:r2<<1|r1>>63 */ \
+                                                                            \
+         /*                                                                 \
+          * Now reduce modulo the GCM polynomial x^128 + x^7 + x^2 + x + 1  \
+          * using [CLMUL-WP] algorithm 5 (p. 20).                           \
+          * Currently xmm2:xmm1 holds x3:x2:x1:x0 (already shifted).        \
+          */                                                                \
+         /* Step 2 (1) */                                                   \
+         "movdqa %%xmm1, %%xmm3             \n\t" /* x1:x0 */               \
+         "movdqa %%xmm1, %%xmm4             \n\t" /* same */                \
+         "movdqa %%xmm1, %%xmm5             \n\t" /* same */                \
+         "psllq $63, %%xmm3                 \n\t" /* x1<<63:x0<<63 = stuff:a */ \
+         "psllq $62, %%xmm4                 \n\t" /* x1<<62:x0<<62 = stuff:b */ \
+         "psllq $57, %%xmm5                 \n\t" /* x1<<57:x0<<57 = stuff:c */ \
+                                                                            \
+         /* Step 2 (2) */                                                   \
+         "pxor %%xmm4, %%xmm3               \n\t" /* stuff:a+b */           \
+         "pxor %%xmm5, %%xmm3               \n\t" /* stuff:a+b+c */         \
+         "pslldq $8, %%xmm3                 \n\t" /* a+b+c:0 */             \
+         "pxor %%xmm3, %%xmm1               \n\t" /* x1+a+b+c:x0 = d:x0 */  \
+                                                                            \
+         /* Steps 3 and 4 */                                                \
+         "movdqa %%xmm1,%%xmm0              \n\t" /* d:x0 */                \
+         "movdqa %%xmm1,%%xmm4              \n\t" /* same */                \
+         "movdqa %%xmm1,%%xmm5              \n\t" /* same */                \
+         "psrlq $1, %%xmm0                  \n\t" /* e1:x0>>1 = e1:e0' */   \
+         "psrlq $2, %%xmm4                  \n\t" /* f1:x0>>2 = f1:f0' */   \
+         "psrlq $7, %%xmm5                  \n\t" /* g1:x0>>7 = g1:g0' */   \
+         "pxor %%xmm4, %%xmm0               \n\t" /* e1+f1:e0'+f0' */       \
+         "pxor %%xmm5, %%xmm0               \n\t" /* e1+f1+g1:e0'+f0'+g0' */ \
+         /* e0'+f0'+g0' is almost e0+f0+g0, except for some missing */      \
+         /* bits carried from d. Now get those bits back in. */             \
+         "movdqa %%xmm1,%%xmm3              \n\t" /* d:x0 */                \
+         "movdqa %%xmm1,%%xmm4              \n\t" /* same */                \
+         "movdqa %%xmm1,%%xmm5              \n\t" /* same */                \
+         "psllq $63, %%xmm3                 \n\t" /* d<<63:stuff */         \
+         "psllq $62, %%xmm4                 \n\t" /* d<<62:stuff */         \
+         "psllq $57, %%xmm5                 \n\t" /* d<<57:stuff */         \
+         "pxor %%xmm4, %%xmm3               \n\t" /* d<<63+d<<62:stuff */   \
+         "pxor %%xmm5, %%xmm3               \n\t" /* missing bits of d:stuff */ \
+         "psrldq $8, %%xmm3                 \n\t" /* 0:missing bits of d */ \
+         "pxor %%xmm3, %%xmm0               \n\t" /* e1+f1+g1:e0+f0+g0 */   \
+         "pxor %%xmm1, %%xmm0               \n\t" /* h1:h0 */               \
+         "pxor %%xmm2, %%xmm0               \n\t" /* x3+h1:x2+h0 */
+
 /*
  * GCM multiplication: c = a times b in GF(2^128)
  * Based on [CLMUL-WP] algorithms 1 (with equation 27) and 5.
@@ -173,66 +263,7 @@ void mbedtls_aesni_gcm_mult( unsigned char c[16],
          "pxor %%xmm4, %%xmm2               \n\t" // d1:d0+e1+f1
          "pxor %%xmm3, %%xmm1               \n\t" // c1+e0+f1:c0
 
-         /*
-          * Now shift the result one bit to the left,
-          * taking advantage of [CLMUL-WP] eq 27 (p. 20)
-          */
-         "movdqa %%xmm1, %%xmm3             \n\t" // r1:r0
-         "movdqa %%xmm2, %%xmm4             \n\t" // r3:r2
-         "psllq $1, %%xmm1                  \n\t" // r1<<1:r0<<1
-         "psllq $1, %%xmm2                  \n\t" // r3<<1:r2<<1
-         "psrlq $63, %%xmm3                 \n\t" // r1>>63:r0>>63
-         "psrlq $63, %%xmm4                 \n\t" // r3>>63:r2>>63
-         "movdqa %%xmm3, %%xmm5             \n\t" // r1>>63:r0>>63
-         "pslldq $8, %%xmm3                 \n\t" // r0>>63:0
-         "pslldq $8, %%xmm4                 \n\t" // r2>>63:0
-         "psrldq $8, %%xmm5                 \n\t" // 0:r1>>63
-         "por %%xmm3, %%xmm1                \n\t" // r1<<1|r0>>63:r0<<1
-         "por %%xmm4, %%xmm2                \n\t" // r3<<1|r2>>62:r2<<1
-         "por %%xmm5, %%xmm2                \n\t" // r3<<1|r2>>62:r2<<1|r1>>63
-
-         /*
-          * Now reduce modulo the GCM polynomial x^128 + x^7 + x^2 + x + 1
-          * using [CLMUL-WP] algorithm 5 (p. 20).
-          * Currently xmm2:xmm1 holds x3:x2:x1:x0 (already shifted).
-          */
-         /* Step 2 (1) */
-         "movdqa %%xmm1, %%xmm3             \n\t" // x1:x0
-         "movdqa %%xmm1, %%xmm4             \n\t" // same
-         "movdqa %%xmm1, %%xmm5             \n\t" // same
-         "psllq $63, %%xmm3                 \n\t" // x1<<63:x0<<63 = stuff:a
-         "psllq $62, %%xmm4                 \n\t" // x1<<62:x0<<62 = stuff:b
-         "psllq $57, %%xmm5                 \n\t" // x1<<57:x0<<57 = stuff:c
-
-         /* Step 2 (2) */
-         "pxor %%xmm4, %%xmm3               \n\t" // stuff:a+b
-         "pxor %%xmm5, %%xmm3               \n\t" // stuff:a+b+c
-         "pslldq $8, %%xmm3                 \n\t" // a+b+c:0
-         "pxor %%xmm3, %%xmm1               \n\t" // x1+a+b+c:x0 = d:x0
-
-         /* Steps 3 and 4 */
-         "movdqa %%xmm1,%%xmm0              \n\t" // d:x0
-         "movdqa %%xmm1,%%xmm4              \n\t" // same
-         "movdqa %%xmm1,%%xmm5              \n\t" // same
-         "psrlq $1, %%xmm0                  \n\t" // e1:x0>>1 = e1:e0'
-         "psrlq $2, %%xmm4                  \n\t" // f1:x0>>2 = f1:f0'
-         "psrlq $7, %%xmm5                  \n\t" // g1:x0>>7 = g1:g0'
-         "pxor %%xmm4, %%xmm0               \n\t" // e1+f1:e0'+f0'
-         "pxor %%xmm5, %%xmm0               \n\t" // e1+f1+g1:e0'+f0'+g0'
-         // e0'+f0'+g0' is almost e0+f0+g0, ex\tcept for some missing
-         // bits carried from d. Now get those\t bits back in.
-         "movdqa %%xmm1,%%xmm3              \n\t" // d:x0
-         "movdqa %%xmm1,%%xmm4              \n\t" // same
-         "movdqa %%xmm1,%%xmm5              \n\t" // same
-         "psllq $63, %%xmm3                 \n\t" // d<<63:stuff
-         "psllq $62, %%xmm4                 \n\t" // d<<62:stuff
-         "psllq $57, %%xmm5                 \n\t" // d<<57:stuff
-         "pxor %%xmm4, %%xmm3               \n\t" // d<<63+d<<62:stuff
-         "pxor %%xmm5, %%xmm3               \n\t" // missing bits of d:stuff
-         "psrldq $8, %%xmm3                 \n\t" // 0:missing bits of d
-         "pxor %%xmm3, %%xmm0               \n\t" // e1+f1+g1:e0+f0+g0
-         "pxor %%xmm1, %%xmm0               \n\t" // h1:h0
-         "pxor %%xmm2, %%xmm0               \n\t" // x3+h1:x2+h0
+         GCM_SHIFT_REDUCE
 
          "movdqu %%xmm0, (%2)               \n\t" // done
          :
@@ -246,6 +277,415 @@ void mbedtls_aesni_gcm_mult( unsigned char c[16],
     return;
 }
 
+/*
+ * Mask for PSHUFB to byte-reverse a block
+ */
+static const unsigned char aesni_bswap_mask[16] =
+{
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+/*
+ * Precompute H^1..H^4, byte-reversed, for the bulk GCM path
+ */
+void mbedtls_aesni_gcm_precompute( unsigned char hpow[64],
+                                   const unsigned char h[16] )
+{
+    unsigned char x[16];
+    size_t i, k;
+
+    memcpy( x, h, 16 );
+
+    for( k = 0; k < 4; k++ )
+    {
+        if( k > 0 )
+            mbedtls_aesni_gcm_mult( x, x, h );
+
+        for( i = 0; i < 16; i++ )
+            hpow[16 * k + i] = x[15 - i];
+    }
+}
+
+/*
+ * Carry-less multiplication of xmm0, byte-reversed by the mask in xmm4, by
+ * xmm1, accumulated without reduction into xmm7 (low), xmm6 (high) and
+ * xmm5 (middle). Clobbers xmm0 to xmm3.
+ */
+#define GCM_MUL_ACC                                                         \
+         PSHUFB xmm4_xmm0               "\n\t" /* a1:a0 */                  \
+         "movdqa %%xmm1, %%xmm2          \n\t" /* h1:h0 */                  \
+         "movdqa %%xmm1, %%xmm3          \n\t" /* same */                   \
+         PCLMULQDQ xmm0_xmm2 ",0x00      \n\t" /* a0*h0 */                  \
+         PCLMULQDQ xmm0_xmm3 ",0x11      \n\t" /* a1*h1 */                  \
+         "pxor %%xmm2, %%xmm7            \n\t"                              \
+         "pxor %%xmm3, %%xmm6            \n\t"                              \
+         "movdqa %%xmm1, %%xmm2          \n\t"                              \
+         PCLMULQDQ xmm0_xmm2 ",0x10      \n\t" /* a1*h0 */                  \
+         PCLMULQDQ xmm0_xmm1 ",0x01      \n\t" /* a0*h1 */                  \
+         "pxor %%xmm2, %%xmm5            \n\t"                              \
+         "pxor %%xmm1, %%xmm5            \n\t"
+
+/*
+ * GHASH of 4 blocks: x = ( x + c0 ) * H^4 + c1 * H^3 + c2 * H^2 + c3 * H,
+ * with a single reduction
+ */
+static void aesni_gcm_ghash4( unsigned char x[16],
+                              const unsigned char c[64],
+                              const unsigned char hpow[64] )
+{
+    /* volatile: the work is the store to x */
+    asm volatile( "movdqu (%3), %%xmm4               \n\t" // byte-reversal mask
+         "pxor %%xmm5, %%xmm5               \n\t" // middle
+         "pxor %%xmm6, %%xmm6               \n\t" // high
+         "pxor %%xmm7, %%xmm7               \n\t" // low
+
+         "movdqu (%0), %%xmm0               \n\t"
+         "movdqu (%1), %%xmm1               \n\t"
+         "pxor %%xmm1, %%xmm0               \n\t" // x + c0
+         "movdqu 48(%2), %%xmm1             \n\t" // H^4
+         GCM_MUL_ACC
+         "movdqu 16(%1), %%xmm0             \n\t" // c1
+         "movdqu 32(%2), %%xmm1             \n\t" // H^3
+         GCM_MUL_ACC
+         "movdqu 32(%1), %%xmm0             \n\t" // c2
+         "movdqu 16(%2), %%xmm1             \n\t" // H^2
+         GCM_MUL_ACC
+         "movdqu 48(%1), %%xmm0             \n\t" // c3
+         "movdqu (%2), %%xmm1               \n\t" // H
+         GCM_MUL_ACC
+
+         "movdqa %%xmm5, %%xmm3             \n\t" // middle
+         "psrldq $8, %%xmm5                 \n\t" // 0:m1
+         "pslldq $8, %%xmm3                 \n\t" // m0:0
+         "pxor %%xmm6, %%xmm5               \n\t"
+         "pxor %%xmm7, %%xmm3               \n\t"
+         "movdqa %%xmm3, %%xmm1             \n\t" // x1:x0
+         "movdqa %%xmm5, %%xmm2             \n\t" // x3:x2
+
+         GCM_SHIFT_REDUCE
+
+         "movdqu (%3), %%xmm4               \n\t"
+         PSHUFB xmm4_xmm0                  "\n\t"
+         "movdqu %%xmm0, (%0)               \n\t"
+         :
+         : "r" (x), "r" (c), "r" (hpow), "r" (aesni_bswap_mask)
+         : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+           "xmm6", "xmm7" );
+}
+
+/*
+ * AES-CTR on 4 blocks, with the rounds of the 4 blocks interleaved
+ */
+static void aesni_crypt_ctr4( const mbedtls_aes_context *ctx,
+                              const unsigned char ctr[64],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    int nr = ctx->nr;
+    const uint32_t *rk = ctx->rk;
+
+    /* volatile: the outputs are not used, the work is the stores to output */
+    asm volatile( "movdqu    (%1), %%xmm4    \n\t" // load round key 0
+         "movdqu    (%2), %%xmm0    \n\t" // load counter blocks
+         "movdqu  16(%2), %%xmm1    \n\t"
+         "movdqu  32(%2), %%xmm2    \n\t"
+         "movdqu  48(%2), %%xmm3    \n\t"
+         "pxor      %%xmm4, %%xmm0  \n\t" // round 0
+         "pxor      %%xmm4, %%xmm1  \n\t"
+         "pxor      %%xmm4, %%xmm2  \n\t"
+         "pxor      %%xmm4, %%xmm3  \n\t"
+         "add       $16, %1         \n\t" // point to next round key
+         "subl      $1, %0          \n\t" // normal rounds = nr - 1
+
+         "1:                        \n\t" // encryption loop
+         "movdqu    (%1), %%xmm4    \n\t" // load round key
+         AESENC     xmm4_xmm0      "\n\t" // do round
+         AESENC     xmm4_xmm1      "\n\t"
+         AESENC     xmm4_xmm2      "\n\t"
+         AESENC     xmm4_xmm3      "\n\t"
+         "add       $16, %1         \n\t" // point to next round key
+         "subl      $1, %0          \n\t" // loop
+         "jnz       1b              \n\t"
+         "movdqu    (%1), %%xmm4    \n\t" // load round key
+         AESENCLAST xmm4_xmm0      "\n\t" // last round
+         AESENCLAST xmm4_xmm1      "\n\t"
+         AESENCLAST xmm4_xmm2      "\n\t"
+         AESENCLAST xmm4_xmm3      "\n\t"
+
+         "movdqu    (%3), %%xmm4    \n\t" // xor with input
+         "pxor      %%xmm4, %%xmm0  \n\t"
+         "movdqu  16(%3), %%xmm4    \n\t"
+         "pxor      %%xmm4, %%xmm1  \n\t"
+         "movdqu  32(%3), %%xmm4    \n\t"
+         "pxor      %%xmm4, %%xmm2  \n\t"
+         "movdqu  48(%3), %%xmm4    \n\t"
+         "pxor      %%xmm4, %%xmm3  \n\t"
+         "movdqu    %%xmm0,   (%4)  \n\t" // export output
+         "movdqu    %%xmm1, 16(%4)  \n\t"
+         "movdqu    %%xmm2, 32(%4)  \n\t"
+         "movdqu    %%xmm3, 48(%4)  \n\t"
+         : "+r" (nr), "+r" (rk)
+         : "r" (ctr), "r" (input), "r" (output)
+         : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4" );
+}
+
+/*
+ * AES-GCM bulk en(de)cryption, 64 bytes at a time
+ */
+void mbedtls_aesni_gcm_crypt( mbedtls_aes_context *ctx,
+                              int mode,
+                              size_t length,
+                              unsigned char y[16],
+                              unsigned char buf[16],
+                              const unsigned char hpow[64],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    unsigned char ctr[64];
+    size_t i, j;
+
+    for( ; length >= 64; length -= 64, input += 64, output += 64 )
+    {
+        for( j = 0; j < 64; j += 16 )
+        {
+            for( i = 16; i > 12; i-- )
+                if( ++y[i - 1] != 0 )
+                    break;
+
+            memcpy( ctr + j, y, 16 );
+        }
+
+        /* GHASH covers the ciphertext, which decryption may overwrite */
+        if( mode == MBEDTLS_AES_DECRYPT )
+            aesni_gcm_ghash4( buf, input, hpow );
+
+        aesni_crypt_ctr4( ctx, ctr, input, output );
+
+        if( mode == MBEDTLS_AES_ENCRYPT )
+            aesni_gcm_ghash4( buf, output, hpow );
+    }
+}
+
+/*
+ * AES-CBC decryption of 8 blocks, with the rounds of the 8 blocks interleaved
+ */
+static void aesni_decrypt_cbc8( const mbedtls_aes_context *ctx,
+                                const unsigned char iv[16],
+                                const unsigned char *input,
+                                unsigned char *output )
+{
+    int nr = ctx->nr;
+    const uint32_t *rk = ctx->rk;
+
+    /* volatile: the outputs are not used, the work is the stores to output */
+    asm volatile( "movdqu    (%1), %%xmm8    \n\t" // load round key 0
+         "movdqu    (%3), %%xmm0    \n\t" // load ciphertext blocks
+         "movdqu  16(%3), %%xmm1    \n\t"
+         "movdqu  32(%3), %%xmm2    \n\t"
+         "movdqu  48(%3), %%xmm3    \n\t"
+         "movdqu  64(%3), %%xmm4    \n\t"
+         "movdqu  80(%3), %%xmm5    \n\t"
+         "movdqu  96(%3), %%xmm6    \n\t"
+         "movdqu 112(%3), %%xmm7    \n\t"
+         "pxor      %%xmm8, %%xmm0  \n\t" // round 0
+         "pxor      %%xmm8, %%xmm1  \n\t"
+         "pxor      %%xmm8, %%xmm2  \n\t"
+         "pxor      %%xmm8, %%xmm3  \n\t"
+         "pxor      %%xmm8, %%xmm4  \n\t"
+         "pxor      %%xmm8, %%xmm5  \n\t"
+         "pxor      %%xmm8, %%xmm6  \n\t"
+         "pxor      %%xmm8, %%xmm7  \n\t"
+         "add       $16, %1         \n\t" // point to next round key
+         "subl      $1, %0          \n\t" // normal rounds = nr - 1
+
+         "1:                        \n\t" // decryption loop
+         "movdqu    (%1), %%xmm8    \n\t" // load round key
+         AESDEC_R8  xmm8_xmm0      "\n\t" // do round
+         AESDEC_R8  xmm8_xmm1      "\n\t"
+         AESDEC_R8  xmm8_xmm2      "\n\t"
+         AESDEC_R8  xmm8_xmm3      "\n\t"
+         AESDEC_R8  xmm8_xmm4      "\n\t"
+         AESDEC_R8  xmm8_xmm5      "\n\t"
+         AESDEC_R8  xmm8_xmm6      "\n\t"
+         AESDEC_R8  xmm8_xmm7      "\n\t"
+         "add       $16, %1         \n\t" // point to next round key
+         "subl      $1, %0          \n\t" // loop
+         "jnz       1b              \n\t"
+         "movdqu    (%1), %%xmm8    \n\t" // load round key
+         AESDECLAST_R8 xmm8_xmm0   "\n\t" // last round
+         AESDECLAST_R8 xmm8_xmm1   "\n\t"
+         AESDECLAST_R8 xmm8_xmm2   "\n\t"
+         AESDECLAST_R8 xmm8_xmm3   "\n\t"
+         AESDECLAST_R8 xmm8_xmm4   "\n\t"
+         AESDECLAST_R8 xmm8_xmm5   "\n\t"
+         AESDECLAST_R8 xmm8_xmm6   "\n\t"
+         AESDECLAST_R8 xmm8_xmm7   "\n\t"
+
+         "movdqu    (%2), %%xmm8    \n\t" // xor with IV
+         "pxor      %%xmm8, %%xmm0  \n\t"
+         "movdqu    (%3), %%xmm8    \n\t" // xor with previous ciphertext
+         "pxor      %%xmm8, %%xmm1  \n\t"
+         "movdqu  16(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm2  \n\t"
+         "movdqu  32(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm3  \n\t"
+         "movdqu  48(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm4  \n\t"
+         "movdqu  64(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm5  \n\t"
+         "movdqu  80(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm6  \n\t"
+         "movdqu  96(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm7  \n\t"
+         "movdqu    %%xmm0,    (%4) \n\t" // export output
+         "movdqu    %%xmm1,  16(%4) \n\t"
+         "movdqu    %%xmm2,  32(%4) \n\t"
+         "movdqu    %%xmm3,  48(%4) \n\t"
+         "movdqu    %%xmm4,  64(%4) \n\t"
+         "movdqu    %%xmm5,  80(%4) \n\t"
+         "movdqu    %%xmm6,  96(%4) \n\t"
+         "movdqu    %%xmm7, 112(%4) \n\t"
+         : "+r" (nr), "+r" (rk)
+         : "r" (iv), "r" (input), "r" (output)
+         : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3",
+           "xmm4", "xmm5", "xmm6", "xmm7", "xmm8" );
+}
+
+/*
+ * AES-NI AES-CBC bulk decryption, 128 bytes at a time
+ */
+void mbedtls_aesni_decrypt_cbc( mbedtls_aes_context *ctx,
+                                size_t length,
+                                unsigned char iv[16],
+                                const unsigned char *input,
+                                unsigned char *output )
+{
+    unsigned char temp[16];
+
+    for( ; length >= 128; length -= 128, input += 128, output += 128 )
+    {
+        /* The last ciphertext block is the next IV; save it in case the
+         * output overwrites the input */
+        memcpy( temp, input + 112, 16 );
+
+        aesni_decrypt_cbc8( ctx, iv, input, output );
+
+        memcpy( iv, temp, 16 );
+    }
+}
+
+/*
+ * AES-CTR on 8 blocks, with the rounds of the 8 blocks interleaved
+ */
+static void aesni_crypt_ctr8( const mbedtls_aes_context *ctx,
+                              const unsigned char ctr[128],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    int nr = ctx->nr;
+    const uint32_t *rk = ctx->rk;
+
+    /* volatile: the outputs are not used, the work is the stores to output */
+    asm volatile( "movdqu    (%1), %%xmm8    \n\t" // load round key 0
+         "movdqu    (%2), %%xmm0    \n\t" // load counter blocks
+         "movdqu  16(%2), %%xmm1    \n\t"
+         "movdqu  32(%2), %%xmm2    \n\t"
+         "movdqu  48(%2), %%xmm3    \n\t"
+         "movdqu  64(%2), %%xmm4    \n\t"
+         "movdqu  80(%2), %%xmm5    \n\t"
+         "movdqu  96(%2), %%xmm6    \n\t"
+         "movdqu 112(%2), %%xmm7    \n\t"
+         "pxor      %%xmm8, %%xmm0  \n\t" // round 0
+         "pxor      %%xmm8, %%xmm1  \n\t"
+         "pxor      %%xmm8, %%xmm2  \n\t"
+         "pxor      %%xmm8, %%xmm3  \n\t"
+         "pxor      %%xmm8, %%xmm4  \n\t"
+         "pxor      %%xmm8, %%xmm5  \n\t"
+         "pxor      %%xmm8, %%xmm6  \n\t"
+         "pxor      %%xmm8, %%xmm7  \n\t"
+         "add       $16, %1         \n\t" // point to next round key
+         "subl      $1, %0          \n\t" // normal rounds = nr - 1
+
+         "1:                        \n\t" // encryption loop
+         "movdqu    (%1), %%xmm8    \n\t" // load round key
+         AESENC_R8  xmm8_xmm0      "\n\t" // do round
+         AESENC_R8  xmm8_xmm1      "\n\t"
+         AESENC_R8  xmm8_xmm2      "\n\t"
+         AESENC_R8  xmm8_xmm3      "\n\t"
+         AESENC_R8  xmm8_xmm4      "\n\t"
+         AESENC_R8  xmm8_xmm5      "\n\t"
+         AESENC_R8  xmm8_xmm6      "\n\t"
+         AESENC_R8  xmm8_xmm7      "\n\t"
+         "add       $16, %1         \n\t" // point to next round key
+         "subl      $1, %0          \n\t" // loop
+         "jnz       1b              \n\t"
+         "movdqu    (%1), %%xmm8    \n\t" // load round key
+         AESENCLAST_R8 xmm8_xmm0   "\n\t" // last round
+         AESENCLAST_R8 xmm8_xmm1   "\n\t"
+         AESENCLAST_R8 xmm8_xmm2   "\n\t"
+         AESENCLAST_R8 xmm8_xmm3   "\n\t"
+         AESENCLAST_R8 xmm8_xmm4   "\n\t"
+         AESENCLAST_R8 xmm8_xmm5   "\n\t"
+         AESENCLAST_R8 xmm8_xmm6   "\n\t"
+         AESENCLAST_R8 xmm8_xmm7   "\n\t"
+
+         "movdqu    (%3), %%xmm8    \n\t" // xor with input
+         "pxor      %%xmm8, %%xmm0  \n\t"
+         "movdqu  16(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm1  \n\t"
+         "movdqu  32(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm2  \n\t"
+         "movdqu  48(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm3  \n\t"
+         "movdqu  64(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm4  \n\t"
+         "movdqu  80(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm5  \n\t"
+         "movdqu  96(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm6  \n\t"
+         "movdqu 112(%3), %%xmm8    \n\t"
+         "pxor      %%xmm8, %%xmm7  \n\t"
+         "movdqu    %%xmm0,    (%4) \n\t" // export output
+         "movdqu    %%xmm1,  16(%4) \n\t"
+         "movdqu    %%xmm2,  32(%4) \n\t"
+         "movdqu    %%xmm3,  48(%4) \n\t"
+         "movdqu    %%xmm4,  64(%4) \n\t"
+         "movdqu    %%xmm5,  80(%4) \n\t"
+         "movdqu    %%xmm6,  96(%4) \n\t"
+         "movdqu    %%xmm7, 112(%4) \n\t"
+         : "+r" (nr), "+r" (rk)
+         : "r" (ctr), "r" (input), "r" (output)
+         : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3",
+           "xmm4", "xmm5", "xmm6", "xmm7", "xmm8" );
+}
+
+/*
+ * AES-NI AES-CTR bulk en(de)cryption, 128 bytes at a time
+ */
+void mbedtls_aesni_crypt_ctr( mbedtls_aes_context *ctx,
+                              size_t length,
+                              unsigned char nonce_counter[16],
+                              const unsigned char *input,
+                              unsigned char *output )
+{
+    unsigned char ctr[128];
+    size_t i, j;
+
+    for( ; length >= 128; length -= 128, input += 128, output += 128 )
+    {
+        for( j = 0; j < 128; j += 16 )
+        {
+            memcpy( ctr + j, nonce_counter, 16 );
+
+            for( i = 16; i > 0; i-- )
+                if( ++nonce_counter[i - 1] != 0 )
+                    break;
+        }
+
+        aesni_crypt_ctr8( ctx, ctr, input, output );
+    }
+}
+
 /*
  * Compute decryption round keys from encryption round keys
  */
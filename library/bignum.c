@@ -76,6 +76,172 @@ static void mbedtls_mpi_zeroize( mbedtls_mpi_uint *v, size_t n ) {
 #define BITS_TO_LIMBS(i)  ( (i) / biL + ( (i) % biL != 0 ) )
 #define CHARS_TO_LIMBS(i) ( (i) / ciL + ( (i) % ciL != 0 ) )
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/*
+ * Blocks of a scratch arena: a header followed by 2^k limbs, rounded up to
+ * a multiple of the header size so that the next header stays aligned
+ */
+typedef union
+{
+    struct
+    {
+        void *next;     /* next free block of the same size class */
+        size_t k;       /* size class */
+    } h;
+    mbedtls_mpi_uint align;
+}
+mpi_scratch_hdr;
+
+#define SCRATCH_HDR     sizeof( mpi_scratch_hdr )
+
+void mbedtls_mpi_scratch_init( mbedtls_mpi_scratch *ctx,
+                               unsigned char *buf, size_t len )
+{
+    size_t skip;
+
+    memset( ctx, 0, sizeof( mbedtls_mpi_scratch ) );
+
+    if( buf == NULL )
+        return;
+
+    skip = ( SCRATCH_HDR - (size_t) buf % SCRATCH_HDR ) % SCRATCH_HDR;
+    if( len < skip )
+        return;
+
+    ctx->buf = buf + skip;
+    ctx->len = len - skip;
+}
+
+void mbedtls_mpi_scratch_free( mbedtls_mpi_scratch *ctx )
+{
+    if( ctx == NULL )
+        return;
+
+    memset( ctx, 0, sizeof( mbedtls_mpi_scratch ) );
+}
+
+/*
+ * Take a zeroed block of at least nblimbs limbs from the arena,
+ * or return NULL if it has no room left
+ */
+static mbedtls_mpi_uint *mpi_scratch_alloc( mbedtls_mpi_scratch *ctx,
+                                            size_t nblimbs )
+{
+    mpi_scratch_hdr *b;
+    mbedtls_mpi_uint *p;
+    size_t k = 0, size;
+
+    while( ( (size_t) 1 << k ) < nblimbs )
+        k++;
+
+    if( k >= MBEDTLS_MPI_SCRATCH_CLASSES )
+        return( NULL );
+
+    if( ctx->free_list[k] != NULL )
+    {
+        b = (mpi_scratch_hdr *) ctx->free_list[k];
+        ctx->free_list[k] = b->h.next;
+    }
+    else
+    {
+        size = ( ( ciL << k ) + SCRATCH_HDR - 1 ) / SCRATCH_HDR + 1;
+        size *= SCRATCH_HDR;
+
+        if( ctx->len - ctx->used < size )
+            return( NULL );
+
+        b = (mpi_scratch_hdr *) ( ctx->buf + ctx->used );
+        b->h.k = k;
+
+        ctx->used += size;
+        if( ctx->used > ctx->peak )
+            ctx->peak = ctx->used;
+    }
+
+    ctx->live++;
+
+    p = (mbedtls_mpi_uint *) ( b + 1 );
+    memset( p, 0, nblimbs * ciL );
+
+    return( p );
+}
+
+/*
+ * Give a block back to the arena, rewinding it once no block is in use
+ */
+static void mpi_scratch_release( mbedtls_mpi_scratch *ctx, mbedtls_mpi_uint *p )
+{
+    mpi_scratch_hdr *b = (mpi_scratch_hdr *) p - 1;
+
+    b->h.next = ctx->free_list[b->h.k];
+    ctx->free_list[b->h.k] = b;
+
+    if( --ctx->live == 0 )
+    {
+        ctx->used = 0;
+        memset( ctx->free_list, 0, sizeof( ctx->free_list ) );
+    }
+}
+
+/*
+ * Initialize a temporary sharing the scratch arena of Y, or else of Z
+ */
+static void mpi_init_like( mbedtls_mpi *X, const mbedtls_mpi *Y,
+                           const mbedtls_mpi *Z )
+{
+    mbedtls_mpi_init( X );
+
+    if( Y != NULL && Y->scratch != NULL )
+        X->scratch = Y->scratch;
+    else if( Z != NULL )
+        X->scratch = Z->scratch;
+}
+#else
+#define mpi_init_like( X, Y, Z )    mbedtls_mpi_init( X )
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
+/*
+ * Allocate nblimbs zeroed limbs for X
+ */
+static mbedtls_mpi_uint *mpi_alloc_limbs( const mbedtls_mpi *X, size_t nblimbs )
+{
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    mbedtls_mpi_uint *p;
+
+    if( X->scratch != NULL )
+    {
+        if( ( p = mpi_scratch_alloc( X->scratch, nblimbs ) ) != NULL )
+            return( p );
+
+        X->scratch->fallbacks++;
+    }
+#else
+    ((void) X);
+#endif
+
+    return( (mbedtls_mpi_uint*)mbedtls_calloc( nblimbs, ciL ) );
+}
+
+/*
+ * Zeroize and unallocate the limbs of X
+ */
+static void mpi_free_limbs( const mbedtls_mpi *X )
+{
+    mbedtls_mpi_zeroize( X->p, X->n );
+
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    if( X->scratch != NULL &&
+        (unsigned char *) X->p >= X->scratch->buf &&
+        (unsigned char *) X->p < X->scratch->buf + X->scratch->len )
+    {
+        mpi_scratch_release( X->scratch, X->p );
+        return;
+    }
+#endif
+
+    mbedtls_free( X->p );
+}
+
 /*
  * Initialize one MPI
  */
@@ -87,7 +253,24 @@ void mbedtls_mpi_init( mbedtls_mpi *X )
     X->s = 1;
     X->n = 0;
     X->p = NULL;
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    X->scratch = NULL;
+#endif
+}
+
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/*
+ * Initialize one MPI taking its limbs from a scratch arena
+ */
+void mbedtls_mpi_init_scratch( mbedtls_mpi *X, mbedtls_mpi_scratch *scratch )
+{
+    if( X == NULL )
+        return;
+
+    mbedtls_mpi_init( X );
+    X->scratch = scratch;
 }
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
 
 /*
  * Unallocate one MPI
@@ -98,10 +281,7 @@ void mbedtls_mpi_free( mbedtls_mpi *X )
         return;
 
     if( X->p != NULL )
-    {
-        mbedtls_mpi_zeroize( X->p, X->n );
-        mbedtls_free( X->p );
-    }
+        mpi_free_limbs( X );
 
     X->s = 1;
     X->n = 0;
@@ -120,14 +300,13 @@ int mbedtls_mpi_grow( mbedtls_mpi *X, size_t nblimbs )
 
     if( X->n < nblimbs )
     {
-        if( ( p = (mbedtls_mpi_uint*)mbedtls_calloc( nblimbs, ciL ) ) == NULL )
+        if( ( p = mpi_alloc_limbs( X, nblimbs ) ) == NULL )
             return( MBEDTLS_ERR_MPI_ALLOC_FAILED );
 
         if( X->p != NULL )
         {
             memcpy( p, X->p, X->n * ciL );
-            mbedtls_mpi_zeroize( X->p, X->n );
-            mbedtls_free( X->p );
+            mpi_free_limbs( X );
         }
 
         X->n = nblimbs;
@@ -158,14 +337,13 @@ int mbedtls_mpi_shrink( mbedtls_mpi *X, size_t nblimbs )
     if( i < nblimbs )
         i = nblimbs;
 
-    if( ( p = (mbedtls_mpi_uint*)mbedtls_calloc( i, ciL ) ) == NULL )
+    if( ( p = mpi_alloc_limbs( X, i ) ) == NULL )
         return( MBEDTLS_ERR_MPI_ALLOC_FAILED );
 
     if( X->p != NULL )
     {
         memcpy( p, X->p, i * ciL );
-        mbedtls_mpi_zeroize( X->p, X->n );
-        mbedtls_free( X->p );
+        mpi_free_limbs( X );
     }
 
     X->n = i;
@@ -431,7 +609,7 @@ int mbedtls_mpi_read_string( mbedtls_mpi *X, int radix, const char *s )
     if( radix < 2 || radix > 16 )
         return( MBEDTLS_ERR_MPI_BAD_INPUT_DATA );
 
-    mbedtls_mpi_init( &T );
+    mpi_init_like( &T, X, NULL );
 
     slen = strlen( s );
 
@@ -548,7 +726,7 @@ int mbedtls_mpi_write_string( const mbedtls_mpi *X, int radix,
     }
 
     p = buf;
-    mbedtls_mpi_init( &T );
+    mpi_init_like( &T, X, NULL );
 
     if( X->s == -1 )
         *p++ = '-';
@@ -970,7 +1148,7 @@ int mbedtls_mpi_sub_abs( mbedtls_mpi *X, const mbedtls_mpi *A, const mbedtls_mpi
     if( mbedtls_mpi_cmp_abs( A, B ) < 0 )
         return( MBEDTLS_ERR_MPI_NEGATIVE_VALUE );
 
-    mbedtls_mpi_init( &TB );
+    mpi_init_like( &TB, X, A );
 
     if( X == B )
     {
@@ -1072,6 +1250,7 @@ int mbedtls_mpi_add_int( mbedtls_mpi *X, const mbedtls_mpi *A, mbedtls_mpi_sint
     mbedtls_mpi_uint p[1];
 
     p[0] = ( b < 0 ) ? -b : b;
+    mbedtls_mpi_init( &_B );
     _B.s = ( b < 0 ) ? -1 : 1;
     _B.n = 1;
     _B.p = p;
@@ -1088,6 +1267,7 @@ int mbedtls_mpi_sub_int( mbedtls_mpi *X, const mbedtls_mpi *A, mbedtls_mpi_sint
     mbedtls_mpi_uint p[1];
 
     p[0] = ( b < 0 ) ? -b : b;
+    mbedtls_mpi_init( &_B );
     _B.s = ( b < 0 ) ? -1 : 1;
     _B.n = 1;
     _B.p = p;
@@ -1176,7 +1356,7 @@ int mbedtls_mpi_mul_mpi( mbedtls_mpi *X, const mbedtls_mpi *A, const mbedtls_mpi
     size_t i, j;
     mbedtls_mpi TA, TB;
 
-    mbedtls_mpi_init( &TA ); mbedtls_mpi_init( &TB );
+    mpi_init_like( &TA, X, A ); mpi_init_like( &TB, X, A );
 
     if( X == A ) { MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &TA, A ) ); A = &TA; }
     if( X == B ) { MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &TB, B ) ); B = &TB; }
@@ -1212,6 +1392,7 @@ int mbedtls_mpi_mul_int( mbedtls_mpi *X, const mbedtls_mpi *A, mbedtls_mpi_uint
     mbedtls_mpi _B;
     mbedtls_mpi_uint p[1];
 
+    mbedtls_mpi_init( &_B );
     _B.s = 1;
     _B.n = 1;
     _B.p = p;
@@ -1328,8 +1509,8 @@ int mbedtls_mpi_div_mpi( mbedtls_mpi *Q, mbedtls_mpi *R, const mbedtls_mpi *A, c
     if( mbedtls_mpi_cmp_int( B, 0 ) == 0 )
         return( MBEDTLS_ERR_MPI_DIVISION_BY_ZERO );
 
-    mbedtls_mpi_init( &X ); mbedtls_mpi_init( &Y ); mbedtls_mpi_init( &Z );
-    mbedtls_mpi_init( &T1 ); mbedtls_mpi_init( &T2 );
+    mpi_init_like( &X, A, B ); mpi_init_like( &Y, A, B ); mpi_init_like( &Z, A, B );
+    mpi_init_like( &T1, A, B ); mpi_init_like( &T2, A, B );
 
     if( mbedtls_mpi_cmp_abs( A, B ) < 0 )
     {
@@ -1440,6 +1621,7 @@ int mbedtls_mpi_div_int( mbedtls_mpi *Q, mbedtls_mpi *R, const mbedtls_mpi *A, m
     mbedtls_mpi_uint p[1];
 
     p[0] = ( b < 0 ) ? -b : b;
+    mbedtls_mpi_init( &_B );
     _B.s = ( b < 0 ) ? -1 : 1;
     _B.n = 1;
     _B.p = p;
@@ -1601,6 +1783,50 @@ static int mpi_montred( mbedtls_mpi *A, const mbedtls_mpi *N, mbedtls_mpi_uint m
     return( mpi_montmul( A, &U, N, mm, T ) );
 }
 
+/*
+ * Montgomery constant of an odd modulus, for mbedtls_mpi_montg_reduce()
+ */
+int mbedtls_mpi_montg_init( mbedtls_mpi_uint *mm, const mbedtls_mpi *N )
+{
+    if( mbedtls_mpi_cmp_int( N, 0 ) <= 0 || ( N->p[0] & 1 ) == 0 )
+        return( MBEDTLS_ERR_MPI_BAD_INPUT_DATA );
+
+    mpi_montg_init( mm, N );
+
+    return( 0 );
+}
+
+/*
+ * Montgomery reduction of a double-size value: X = X * R^-1 mod N,
+ * with R = 2^( biL * N->n )  (HAC 14.32)
+ */
+int mbedtls_mpi_montg_reduce( mbedtls_mpi *X, const mbedtls_mpi *N,
+                              mbedtls_mpi_uint mm )
+{
+    int ret;
+    size_t i, n = N->n;
+
+    if( ( X->s < 0 && mbedtls_mpi_cmp_int( X, 0 ) != 0 ) ||
+        mbedtls_mpi_bitlen( X ) > n * biL + mbedtls_mpi_bitlen( N ) )
+        return( MBEDTLS_ERR_MPI_BAD_INPUT_DATA );
+
+    /* X + ( sum of u_i N 2^(i biL) ) < 2 N R fits in 2n + 1 limbs */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( X, 2 * n + 1 ) );
+
+    for( i = 0; i < n; i++ )
+        mpi_mul_hlp( n, N->p, X->p + i, X->p[i] * mm );
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_shift_r( X, n * biL ) );
+    X->s = 1;
+
+    while( mbedtls_mpi_cmp_abs( X, N ) >= 0 )
+        mpi_sub_hlp( n, N->p, X->p );
+
+cleanup:
+
+    return( ret );
+}
+
 /*
  * Sliding-window exponentiation: X = A^E mod N  (HAC 14.85)
  */
@@ -1624,9 +1850,15 @@ int mbedtls_mpi_exp_mod( mbedtls_mpi *X, const mbedtls_mpi *A, const mbedtls_mpi
      * Init temps and window size
      */
     mpi_montg_init( &mm, N );
-    mbedtls_mpi_init( &RR ); mbedtls_mpi_init( &T );
-    mbedtls_mpi_init( &Apos );
-    memset( W, 0, sizeof( W ) );
+    mpi_init_like( &T, X, A ); mpi_init_like( &Apos, X, A );
+    for( i = 0; i < sizeof( W ) / sizeof( W[0] ); i++ )
+        mpi_init_like( &W[i], X, A );
+
+    /* RR may be kept in _RR, in which case it must not use an arena */
+    if( _RR != NULL )
+        mpi_init_like( &RR, _RR, NULL );
+    else
+        mpi_init_like( &RR, X, A );
 
     i = mbedtls_mpi_bitlen( E );
 
@@ -1809,6 +2041,141 @@ cleanup:
     return( ret );
 }
 
+/*
+ * Constant-time table lookup: X = W[idx], reading all count entries of W,
+ * each of which has X->n limbs
+ */
+static void mpi_select( mbedtls_mpi *X, const mbedtls_mpi *W, size_t count,
+                        size_t idx )
+{
+    size_t i, j, n = X->n;
+    mbedtls_mpi_uint mask, *d = X->p;
+    const mbedtls_mpi_uint *s;
+
+    memset( d, 0, n * ciL );
+
+    for( i = 0; i < count; i++ )
+    {
+        /* All ones if i == idx, zero otherwise */
+        mask = (mbedtls_mpi_uint) ( i ^ idx );
+        mask = ( ( mask | ( 0 - mask ) ) >> ( biL - 1 ) ) - 1;
+
+        for( j = 0, s = W[i].p; j < n; j++ )
+            d[j] |= s[j] & mask;
+    }
+
+    X->s = 1;
+}
+
+/*
+ * Fixed-window exponentiation: X = A^E mod N, with the Montgomery constants
+ * given by the caller. The exponent is processed ebits bits at a time from
+ * the top, whatever its value, and the window table is read in full for each
+ * window, so that neither the operations nor the memory accesses depend on E.
+ */
+int mbedtls_mpi_exp_mod_fixed( mbedtls_mpi *X, const mbedtls_mpi *A,
+                               const mbedtls_mpi *E, size_t ebits,
+                               const mbedtls_mpi *N, mbedtls_mpi_uint mm,
+                               const mbedtls_mpi *RR )
+{
+    int ret;
+    size_t i, j, pos, wsize, wbits, one = 1;
+    mbedtls_mpi T, S, W[ 1 << MBEDTLS_MPI_WINDOW_SIZE ];
+
+    if( mbedtls_mpi_cmp_int( N, 0 ) <= 0 || ( N->p[0] & 1 ) == 0 )
+        return( MBEDTLS_ERR_MPI_BAD_INPUT_DATA );
+
+    if( mbedtls_mpi_cmp_int( A, 0 ) < 0 || mbedtls_mpi_cmp_int( E, 0 ) < 0 ||
+        mbedtls_mpi_bitlen( E ) > ebits ||
+        mbedtls_mpi_cmp_int( RR, 0 ) <= 0 || mbedtls_mpi_cmp_mpi( RR, N ) >= 0 )
+        return( MBEDTLS_ERR_MPI_BAD_INPUT_DATA );
+
+    /*
+     * Init temps and window size: the table has 2^wsize entries here, twice
+     * as many as for the sliding window of mbedtls_mpi_exp_mod(), and all of
+     * them are read for each window, hence smaller windows
+     */
+    mpi_init_like( &T, X, A ); mpi_init_like( &S, X, A );
+    for( i = 0; i < sizeof( W ) / sizeof( W[0] ); i++ )
+        mpi_init_like( &W[i], X, A );
+
+    wsize = ( ebits > 4000 ) ? 6 : ( ebits > 1800 ) ? 5 :
+            ( ebits >  500 ) ? 4 : ( ebits >  135 ) ? 3 :
+            ( ebits >   40 ) ? 2 : 1;
+
+    if( wsize > MBEDTLS_MPI_WINDOW_SIZE )
+        wsize = MBEDTLS_MPI_WINDOW_SIZE;
+
+    j = N->n + 1;
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( &T, j * 2 ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( &S, j ) );
+
+    /*
+     * W[0] = R^2 * R^-1 mod N = R mod N
+     */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( &W[0], j ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &W[0], RR ) );
+    MBEDTLS_MPI_CHK( mpi_montred( &W[0], N, mm, &T ) );
+
+    /*
+     * W[1] = A * R^2 * R^-1 mod N = A * R mod N
+     */
+    if( mbedtls_mpi_cmp_mpi( A, N ) >= 0 )
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &W[1], A, N ) );
+    else
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &W[1], A ) );
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( &W[1], j ) );
+    MBEDTLS_MPI_CHK( mpi_montmul( &W[1], RR, N, mm, &T ) );
+
+    /*
+     * W[i] = W[i - 1] * W[1]
+     */
+    for( i = 2; i < ( one << wsize ); i++ )
+    {
+        MBEDTLS_MPI_CHK( mbedtls_mpi_grow( &W[i], j ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &W[i], &W[i - 1] ) );
+
+        MBEDTLS_MPI_CHK( mpi_montmul( &W[i], &W[1], N, mm, &T ) );
+    }
+
+    /*
+     * X = W[0], then for each window from the top:
+     * X = X^(2^wsize) * W[window] R^-1 mod N
+     */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( X, j ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_copy( X, &W[0] ) );
+
+    for( pos = ( ( ebits + wsize - 1 ) / wsize ) * wsize; pos > 0; )
+    {
+        pos -= wsize;
+
+        for( i = 0; i < wsize; i++ )
+            MBEDTLS_MPI_CHK( mpi_montmul( X, X, N, mm, &T ) );
+
+        wbits = 0;
+        for( i = 0; i < wsize; i++ )
+            wbits |= (size_t) mbedtls_mpi_get_bit( E, pos + i ) << i;
+
+        mpi_select( &S, W, one << wsize, wbits );
+        MBEDTLS_MPI_CHK( mpi_montmul( X, &S, N, mm, &T ) );
+    }
+
+    /*
+     * X = A^E * R * R^-1 mod N = A^E mod N
+     */
+    MBEDTLS_MPI_CHK( mpi_montred( X, N, mm, &T ) );
+
+cleanup:
+
+    for( i = 0; i < ( one << wsize ); i++ )
+        mbedtls_mpi_free( &W[i] );
+
+    mbedtls_mpi_free( &T ); mbedtls_mpi_free( &S );
+
+    return( ret );
+}
+
 /*
  * Greatest common divisor: G = gcd(A, B)  (HAC 14.54)
  */
@@ -1818,7 +2185,7 @@ int mbedtls_mpi_gcd( mbedtls_mpi *G, const mbedtls_mpi *A, const mbedtls_mpi *B
     size_t lz, lzt;
     mbedtls_mpi TG, TA, TB;
 
-    mbedtls_mpi_init( &TG ); mbedtls_mpi_init( &TA ); mbedtls_mpi_init( &TB );
+    mpi_init_like( &TG, G, A ); mpi_init_like( &TA, G, A ); mpi_init_like( &TB, G, A );
 
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &TA, A ) );
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &TB, B ) );
@@ -1896,9 +2263,9 @@ int mbedtls_mpi_inv_mod( mbedtls_mpi *X, const mbedtls_mpi *A, const mbedtls_mpi
     if( mbedtls_mpi_cmp_int( N, 0 ) <= 0 )
         return( MBEDTLS_ERR_MPI_BAD_INPUT_DATA );
 
-    mbedtls_mpi_init( &TA ); mbedtls_mpi_init( &TU ); mbedtls_mpi_init( &U1 ); mbedtls_mpi_init( &U2 );
-    mbedtls_mpi_init( &G ); mbedtls_mpi_init( &TB ); mbedtls_mpi_init( &TV );
-    mbedtls_mpi_init( &V1 ); mbedtls_mpi_init( &V2 );
+    mpi_init_like( &TA, X, A ); mpi_init_like( &TU, X, A ); mpi_init_like( &U1, X, A );
+    mpi_init_like( &U2, X, A ); mpi_init_like( &G, X, A ); mpi_init_like( &TB, X, A );
+    mpi_init_like( &TV, X, A ); mpi_init_like( &V1, X, A ); mpi_init_like( &V2, X, A );
 
     MBEDTLS_MPI_CHK( mbedtls_mpi_gcd( &G, A, N ) );
 
@@ -2154,6 +2521,7 @@ int mbedtls_mpi_is_prime( const mbedtls_mpi *X,
     int ret;
     mbedtls_mpi XX;
 
+    mbedtls_mpi_init( &XX );
     XX.s = 1;
     XX.n = X->n;
     XX.p = X->p;
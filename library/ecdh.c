@@ -59,7 +59,11 @@ int mbedtls_ecdh_compute_shared( mbedtls_ecp_group *grp, mbedtls_mpi *z,
     int ret;
     mbedtls_ecp_point P;
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    mbedtls_ecp_point_init_scratch( &P, grp->scratch );
+#else
     mbedtls_ecp_point_init( &P );
+#endif
 
     /*
      * Make sure Q is a valid pubkey before using it
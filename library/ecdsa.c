@@ -42,6 +42,25 @@
 #include "mbedtls/hmac_drbg.h"
 #endif
 
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdlib.h>
+#define mbedtls_calloc    calloc
+#define mbedtls_free       free
+#endif
+
+/*
+ * Temporaries take their limbs from the scratch arena of the group, if any
+ */
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+#define ECDSA_MPI_INIT( grp, X )    mbedtls_mpi_init_scratch( X, (grp)->scratch )
+#define ECDSA_POINT_INIT( grp, pt ) mbedtls_ecp_point_init_scratch( pt, (grp)->scratch )
+#else
+#define ECDSA_MPI_INIT( grp, X )    mbedtls_mpi_init( X )
+#define ECDSA_POINT_INIT( grp, pt ) mbedtls_ecp_point_init( pt )
+#endif
+
 /*
  * Derive a suitable integer for group grp from a buffer of length len
  * SEC1 4.1.3 step 5 aka SEC1 4.1.4 step 3
@@ -81,8 +100,8 @@ int mbedtls_ecdsa_sign( mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
     if( grp->N.p == NULL )
         return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
 
-    mbedtls_ecp_point_init( &R );
-    mbedtls_mpi_init( &k ); mbedtls_mpi_init( &e ); mbedtls_mpi_init( &t );
+    ECDSA_POINT_INIT( grp, &R );
+    ECDSA_MPI_INIT( grp, &k ); ECDSA_MPI_INIT( grp, &e ); ECDSA_MPI_INIT( grp, &t );
 
     sign_tries = 0;
     do
@@ -136,8 +155,8 @@ int mbedtls_ecdsa_sign( mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
         MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &e, &e, &t ) );
         MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &k, &k, &t ) );
         MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( s, &k, &grp->N ) );
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( s, s, &e ) );
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( s, s, &grp->N ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &e, &e, s ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( s, &e, &grp->N ) );
 
         if( sign_tries++ > 10 )
         {
@@ -172,7 +191,7 @@ int mbedtls_ecdsa_sign_det( mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi
     if( ( md_info = mbedtls_md_info_from_type( md_alg ) ) == NULL )
         return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
 
-    mbedtls_mpi_init( &h );
+    ECDSA_MPI_INIT( grp, &h );
     mbedtls_hmac_drbg_init( &rng_ctx );
 
     /* Use private key and message hash (reduced) to initialize HMAC_DRBG */
@@ -204,8 +223,8 @@ int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
     mbedtls_mpi e, s_inv, u1, u2;
     mbedtls_ecp_point R;
 
-    mbedtls_ecp_point_init( &R );
-    mbedtls_mpi_init( &e ); mbedtls_mpi_init( &s_inv ); mbedtls_mpi_init( &u1 ); mbedtls_mpi_init( &u2 );
+    ECDSA_POINT_INIT( grp, &R );
+    ECDSA_MPI_INIT( grp, &e ); ECDSA_MPI_INIT( grp, &s_inv ); ECDSA_MPI_INIT( grp, &u1 ); ECDSA_MPI_INIT( grp, &u2 );
 
     /* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
     if( grp->N.p == NULL )
@@ -278,6 +297,211 @@ cleanup:
     return( ret );
 }
 
+/*
+ * Verify a batch of ECDSA signatures: same steps as mbedtls_ecdsa_verify(),
+ * except that all the s^-1 mod n are computed with a single inversion
+ * (Montgomery's trick), and all the R with mbedtls_ecp_muladd_batch()
+ */
+int mbedtls_ecdsa_verify_batch( mbedtls_ecp_group *grp, size_t count,
+                  const unsigned char *buf[], const size_t blen[],
+                  const mbedtls_ecp_point *Q[],
+                  const mbedtls_mpi *r[], const mbedtls_mpi *s[],
+                  int results[] )
+{
+    int ret;
+    size_t i;
+#if defined(MBEDTLS_ECP_ALT)
+    ret = 0;
+
+    for( i = 0; i < count; i++ )
+    {
+        results[i] = mbedtls_ecdsa_verify( grp, buf[i], blen[i],
+                                           Q[i], r[i], s[i] );
+        if( results[i] != 0 )
+            ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+    }
+
+    return( ret );
+#else
+    size_t j, k;
+    mbedtls_mpi *u1 = NULL, *u2, *c, inv, s_inv;
+    mbedtls_ecp_point *R = NULL;
+    const mbedtls_mpi **pu = NULL;
+    const mbedtls_ecp_point **pQ = NULL;
+    size_t *idx = NULL;
+
+    /* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
+    if( grp->N.p == NULL )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    if( count == 0 )
+        return( 0 );
+
+    ECDSA_MPI_INIT( grp, &inv ); ECDSA_MPI_INIT( grp, &s_inv );
+
+    u1 = mbedtls_calloc( 3 * count, sizeof( mbedtls_mpi ) );
+    R = mbedtls_calloc( count, sizeof( mbedtls_ecp_point ) );
+    pu = mbedtls_calloc( 2 * count, sizeof( mbedtls_mpi * ) );
+    pQ = mbedtls_calloc( count, sizeof( mbedtls_ecp_point * ) );
+    idx = mbedtls_calloc( count, sizeof( size_t ) );
+    if( u1 == NULL || R == NULL || pu == NULL || pQ == NULL || idx == NULL )
+    {
+        ret = MBEDTLS_ERR_ECP_ALLOC_FAILED;
+        goto cleanup;
+    }
+    u2 = u1 + count;
+    c = u2 + count;
+
+    /*
+     * Steps 1 and 3 for each signature, the ones that fail them are out,
+     * and c[k] = s_0 * ... * s_k mod n for the others
+     */
+    for( i = 0, k = 0; i < count; i++ )
+    {
+        if( mbedtls_mpi_cmp_int( r[i], 1 ) < 0 ||
+            mbedtls_mpi_cmp_mpi( r[i], &grp->N ) >= 0 ||
+            mbedtls_mpi_cmp_int( s[i], 1 ) < 0 ||
+            mbedtls_mpi_cmp_mpi( s[i], &grp->N ) >= 0 )
+        {
+            results[i] = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+            continue;
+        }
+
+        if( ( results[i] = mbedtls_ecp_check_pubkey( grp, Q[i] ) ) != 0 )
+            continue;
+
+        MBEDTLS_MPI_CHK( derive_mpi( grp, &u1[k], buf[i], blen[i] ) );
+
+        if( k == 0 )
+        {
+            MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &c[k], s[i] ) );
+        }
+        else
+        {
+            MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &c[k], &c[k - 1], s[i] ) );
+            MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &c[k], &c[k], &grp->N ) );
+        }
+
+        idx[k++] = i;
+    }
+
+    if( k == 0 )
+    {
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+        goto cleanup;
+    }
+
+    /*
+     * Step 4: u1 = e / s mod n, u2 = r / s mod n, going backwards from
+     * inv = 1 / ( s_0 * ... * s_j ) mod n
+     */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( &inv, &c[k - 1], &grp->N ) );
+
+    for( j = k; j-- != 0; )
+    {
+        i = idx[j];
+
+        if( j == 0 )
+        {
+            MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &s_inv, &inv ) );
+        }
+        else
+        {
+            MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &s_inv, &inv, &c[j - 1] ) );
+            MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &s_inv, &s_inv, &grp->N ) );
+            MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &inv, &inv, s[i] ) );
+            MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &inv, &inv, &grp->N ) );
+        }
+
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &u1[j], &u1[j], &s_inv ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &u1[j], &u1[j], &grp->N ) );
+
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &u2[j], r[i], &s_inv ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &u2[j], &u2[j], &grp->N ) );
+    }
+
+    /*
+     * u1 = 0 is not a valid multiplier for mbedtls_ecp_muladd() either,
+     * leave these signatures out with the same error
+     */
+    for( j = 0, i = 0; j < k; j++ )
+    {
+        if( mbedtls_mpi_cmp_int( &u1[j], 0 ) == 0 )
+        {
+            results[idx[j]] = MBEDTLS_ERR_ECP_INVALID_KEY;
+            continue;
+        }
+
+        pu[i] = &u1[j];
+        pu[count + i] = &u2[j];
+        pQ[i] = Q[idx[j]];
+        idx[i++] = idx[j];
+    }
+    k = i;
+
+    /*
+     * Step 5: R = u1 G + u2 Q
+     */
+    MBEDTLS_MPI_CHK( mbedtls_ecp_muladd_batch( grp, R, pu, &grp->G,
+                                               pu + count, pQ, k ) );
+
+    /*
+     * Steps 6 to 8: check if R.X mod n is equal to r
+     */
+    for( j = 0; j < k; j++ )
+    {
+        i = idx[j];
+        results[i] = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+
+        if( mbedtls_ecp_is_zero( &R[j] ) )
+            continue;
+
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &R[j].X, &R[j].X, &grp->N ) );
+
+        if( mbedtls_mpi_cmp_mpi( &R[j].X, r[i] ) == 0 )
+            results[i] = 0;
+    }
+
+    ret = 0;
+    for( i = 0; i < count; i++ )
+    {
+        if( results[i] != 0 )
+        {
+            ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+            break;
+        }
+    }
+
+cleanup:
+
+    if( ret != 0 && ret != MBEDTLS_ERR_ECP_VERIFY_FAILED )
+    {
+        for( i = 0; i < count; i++ )
+            results[i] = ret;
+    }
+
+    mbedtls_mpi_free( &inv ); mbedtls_mpi_free( &s_inv );
+
+    if( u1 != NULL )
+    {
+        for( i = 0; i < 3 * count; i++ )
+            mbedtls_mpi_free( &u1[i] );
+        mbedtls_free( u1 );
+    }
+    if( R != NULL )
+    {
+        for( i = 0; i < count; i++ )
+            mbedtls_ecp_point_free( &R[i] );
+        mbedtls_free( R );
+    }
+    mbedtls_free( pu );
+    mbedtls_free( pQ );
+    mbedtls_free( idx );
+
+    return( ret );
+#endif /* MBEDTLS_ECP_ALT */
+}
+
 /*
  * Convert a signature (given by context) to ASN.1
  */
@@ -314,8 +538,8 @@ int mbedtls_ecdsa_write_signature( mbedtls_ecdsa_context *ctx, mbedtls_md_type_t
     int ret;
     mbedtls_mpi r, s;
 
-    mbedtls_mpi_init( &r );
-    mbedtls_mpi_init( &s );
+    ECDSA_MPI_INIT( &ctx->grp, &r );
+    ECDSA_MPI_INIT( &ctx->grp, &s );
 
 #if defined(MBEDTLS_ECDSA_DETERMINISTIC)
     (void) f_rng;
@@ -364,8 +588,8 @@ int mbedtls_ecdsa_read_signature( mbedtls_ecdsa_context *ctx,
     size_t len;
     mbedtls_mpi r, s;
 
-    mbedtls_mpi_init( &r );
-    mbedtls_mpi_init( &s );
+    ECDSA_MPI_INIT( &ctx->grp, &r );
+    ECDSA_MPI_INIT( &ctx->grp, &s );
 
     if( ( ret = mbedtls_asn1_get_tag( &p, end, &len,
                     MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE ) ) != 0 )
@@ -742,9 +742,13 @@ int mbedtls_ecjpake_derive_secret( mbedtls_ecjpake_context *ctx,
      */
     MBEDTLS_MPI_CHK( ecjpake_mul_secret( &m_xm2_s, -1, &ctx->xm2, &ctx->s,
                                          &ctx->grp.N, f_rng, p_rng ) );
+
+    /* m_xm2_s is secret: mbedtls_ecp_muladd() is not constant-time */
+    MBEDTLS_MPI_CHK( mbedtls_ecp_mul( &ctx->grp, &K, &m_xm2_s, &ctx->Xp2,
+                                      f_rng, p_rng ) );
     MBEDTLS_MPI_CHK( mbedtls_ecp_muladd( &ctx->grp, &K,
                                          &one, &ctx->Xp,
-                                         &m_xm2_s, &ctx->Xp2 ) );
+                                         &one, &K ) );
     MBEDTLS_MPI_CHK( mbedtls_ecp_mul( &ctx->grp, &K, &ctx->xm2, &K,
                                       f_rng, p_rng ) );
 
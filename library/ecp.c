@@ -65,8 +65,6 @@
 #define mbedtls_free       free
 #endif
 
-#include "mbedtls/ecp_internal.h"
-
 #if ( defined(__ARMCC_VERSION) || defined(_MSC_VER) ) && \
     !defined(inline) && !defined(__cplusplus)
 #define inline __inline
@@ -103,6 +101,32 @@ static unsigned long add_count, dbl_count, mul_count;
 #define ECP_MONTGOMERY
 #endif
 
+/* Needs ECP_SHORTWEIERSTRASS and ECP_MONTGOMERY to declare the functions */
+#include "mbedtls/ecp_internal.h"
+#include "ecp_x25519.h"
+
+/*
+ * Tell if the field elements of a group are kept in Montgomery form during
+ * point arithmetic, see ecp_modp()
+ */
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+#define ECP_MONT( grp )     ( (grp)->mm != 0 )
+#else
+#define ECP_MONT( grp )     0
+#endif
+
+/*
+ * Initialize the temporaries of the operations on a group, taking their limbs
+ * from the scratch arena attached to the group if any
+ */
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+#define ECP_MPI_INIT( grp, X )      mbedtls_mpi_init_scratch( X, (grp)->scratch )
+#define ECP_POINT_INIT( grp, pt )   mbedtls_ecp_point_init_scratch( pt, (grp)->scratch )
+#else
+#define ECP_MPI_INIT( grp, X )      mbedtls_mpi_init( X )
+#define ECP_POINT_INIT( grp, pt )   mbedtls_ecp_point_init( pt )
+#endif
+
 /*
  * Curve types: internal for now, might be exposed later
  */
@@ -283,6 +307,22 @@ void mbedtls_ecp_point_init( mbedtls_ecp_point *pt )
     mbedtls_mpi_init( &pt->Z );
 }
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/*
+ * Initialize a point taking its limbs from a scratch arena
+ */
+void mbedtls_ecp_point_init_scratch( mbedtls_ecp_point *pt,
+                                     mbedtls_mpi_scratch *scratch )
+{
+    if( pt == NULL )
+        return;
+
+    mbedtls_mpi_init_scratch( &pt->X, scratch );
+    mbedtls_mpi_init_scratch( &pt->Y, scratch );
+    mbedtls_mpi_init_scratch( &pt->Z, scratch );
+}
+#endif
+
 /*
  * Initialize (the components of) a group
  */
@@ -339,13 +379,20 @@ void mbedtls_ecp_group_free( mbedtls_ecp_group *grp )
         mbedtls_mpi_free( &grp->N );
     }
 
-    if( grp->T != NULL )
+    /* Static groups in Montgomery form own a converted copy of their T */
+    if( grp->T != NULL && ( grp->h != 1 || ECP_MONT( grp ) ) )
     {
         for( i = 0; i < grp->T_size; i++ )
             mbedtls_ecp_point_free( &grp->T[i] );
         mbedtls_free( grp->T );
     }
 
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    mbedtls_mpi_free( &grp->RR );
+    mbedtls_mpi_free( &grp->one );
+    mbedtls_mpi_free( &grp->Am );
+#endif
+
     mbedtls_zeroize( grp, sizeof( mbedtls_ecp_group ) );
 }
 
@@ -385,6 +432,17 @@ int mbedtls_ecp_group_copy( mbedtls_ecp_group *dst, const mbedtls_ecp_group *src
     return mbedtls_ecp_group_load( dst, src->id );
 }
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/*
+ * Attach a scratch arena to a group
+ */
+void mbedtls_ecp_group_set_scratch( mbedtls_ecp_group *grp,
+                                    mbedtls_mpi_scratch *scratch )
+{
+    grp->scratch = scratch;
+}
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
 /*
  * Set point to zero
  */
@@ -663,12 +721,21 @@ int mbedtls_ecp_tls_write_group( const mbedtls_ecp_group *grp, size_t *olen,
  * Wrapper around fast quasi-modp functions, with fall-back to mbedtls_mpi_mod_mpi.
  * See the documentation of struct mbedtls_ecp_group.
  *
+ * For groups in Montgomery form, this is a Montgomery reduction instead:
+ * N = N R^-1 mod P, so that after a multiplication of two elements a R and
+ * b R, N is their product a b R in Montgomery form.
+ *
  * This function is in the critial loop for mbedtls_ecp_mul, so pay attention to perf.
  */
 static int ecp_modp( mbedtls_mpi *N, const mbedtls_ecp_group *grp )
 {
     int ret;
 
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    if( ECP_MONT( grp ) )
+        return( mbedtls_mpi_montg_reduce( N, &grp->P, grp->mm ) );
+#endif
+
     if( grp->modp == NULL )
         return( mbedtls_mpi_mod_mpi( N, N, &grp->P ) );
 
@@ -741,6 +808,130 @@ cleanup:
  * SPA, hence timing attacks.
  */
 
+/*
+ * Field elements of groups in Montgomery form (see ecp_modp()) are a R mod P
+ * from the moment points enter the internal functions, through the tables
+ * (ecp_precompute_comb() and ecp_precompute_wnaf() convert their input
+ * point) to the normalized results, converted back by ecp_from_mont(). The
+ * static table of G is converted by mbedtls_ecp_group_load(). Affine points
+ * then have Z == R mod P, or unset (meaning 1 in either form).
+ */
+
+/*
+ * X = 1 in the form of the group
+ */
+static int ecp_set_one( const mbedtls_ecp_group *grp, mbedtls_mpi *X )
+{
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    if( ECP_MONT( grp ) )
+        return( mbedtls_mpi_copy( X, &grp->one ) );
+#else
+    (void) grp;
+#endif
+
+    return( mbedtls_mpi_lset( X, 1 ) );
+}
+
+/*
+ * Tell if X == 1 in the form of the group
+ */
+static int ecp_is_one( const mbedtls_ecp_group *grp, const mbedtls_mpi *X )
+{
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    if( ECP_MONT( grp ) )
+        return( mbedtls_mpi_cmp_mpi( X, &grp->one ) == 0 );
+#else
+    (void) grp;
+#endif
+
+    return( mbedtls_mpi_cmp_int( X, 1 ) == 0 );
+}
+
+/*
+ * A in the form of the group, if not -3 (see ecp_double_jac())
+ */
+static const mbedtls_mpi *ecp_a( const mbedtls_ecp_group *grp )
+{
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    if( ECP_MONT( grp ) )
+        return( &grp->Am );
+#endif
+
+    return( &grp->A );
+}
+
+/*
+ * X = A^-1 mod P in the form of the group
+ */
+static int ecp_inv_mod( const mbedtls_ecp_group *grp, mbedtls_mpi *X,
+                        const mbedtls_mpi *A )
+{
+    int ret;
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( X, A, &grp->P ) );
+
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    /* a^-1 R^-1 to a^-1 R */
+    if( ECP_MONT( grp ) )
+    {
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( X, X, &grp->RR ) ); MOD_MUL( *X );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( X, X, &grp->RR ) ); MOD_MUL( *X );
+    }
+#endif
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * R = P, an affine point in standard form, in the form of the group
+ */
+static int ecp_to_mont( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
+                        const mbedtls_ecp_point *P )
+{
+    int ret;
+
+    MBEDTLS_MPI_CHK( mbedtls_ecp_copy( R, P ) );
+
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    if( ECP_MONT( grp ) && mbedtls_mpi_cmp_int( &R->Z, 0 ) != 0 )
+    {
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &R->X, &R->X, &grp->RR ) ); MOD_MUL( R->X );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &R->Y, &R->Y, &grp->RR ) ); MOD_MUL( R->Y );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &R->Z, &grp->one ) );
+    }
+#else
+    (void) grp;
+#endif
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * Bring back a normalized point in the form of the group to standard form
+ */
+static int ecp_from_mont( const mbedtls_ecp_group *grp, mbedtls_ecp_point *P )
+{
+    int ret = 0;
+
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    if( ECP_MONT( grp ) && mbedtls_mpi_cmp_int( &P->Z, 0 ) != 0 )
+    {
+        MOD_MUL( P->X );
+        MOD_MUL( P->Y );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &P->Z, 1 ) );
+    }
+
+cleanup:
+#else
+    (void) grp;
+    (void) P;
+#endif
+
+    return( ret );
+}
+
 /*
  * Normalize jacobian coordinates so that Z == 0 || Z == 1  (GECC 3.2.1)
  * Cost: 1N := 1I + 3M + 1S
@@ -759,12 +950,12 @@ static int ecp_normalize_jac( const mbedtls_ecp_group *grp, mbedtls_ecp_point *p
         return mbedtls_internal_ecp_normalize_jac( grp, pt );
     }
 #endif /* MBEDTLS_ECP_NORMALIZE_JAC_ALT */
-    mbedtls_mpi_init( &Zi ); mbedtls_mpi_init( &ZZi );
+    ECP_MPI_INIT( grp, &Zi ); ECP_MPI_INIT( grp, &ZZi );
 
     /*
      * X = X / Z^2  mod p
      */
-    MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( &Zi,      &pt->Z,     &grp->P ) );
+    MBEDTLS_MPI_CHK( ecp_inv_mod( grp,   &Zi,       &pt->Z              ) );
     MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &ZZi,     &Zi,        &Zi     ) ); MOD_MUL( ZZi );
     MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &pt->X,   &pt->X,     &ZZi    ) ); MOD_MUL( pt->X );
 
@@ -777,7 +968,7 @@ static int ecp_normalize_jac( const mbedtls_ecp_group *grp, mbedtls_ecp_point *p
     /*
      * Z = 1
      */
-    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &pt->Z, 1 ) );
+    MBEDTLS_MPI_CHK( ecp_set_one( grp, &pt->Z ) );
 
 cleanup:
 
@@ -817,7 +1008,9 @@ static int ecp_normalize_jac_many( const mbedtls_ecp_group *grp,
     if( ( c = mbedtls_calloc( t_len, sizeof( mbedtls_mpi ) ) ) == NULL )
         return( MBEDTLS_ERR_ECP_ALLOC_FAILED );
 
-    mbedtls_mpi_init( &u ); mbedtls_mpi_init( &Zi ); mbedtls_mpi_init( &ZZi );
+    for( i = 0; i < t_len; i++ )
+        ECP_MPI_INIT( grp, &c[i] );
+    ECP_MPI_INIT( grp, &u ); ECP_MPI_INIT( grp, &Zi ); ECP_MPI_INIT( grp, &ZZi );
 
     /*
      * c[i] = Z_0 * ... * Z_i
@@ -832,7 +1025,7 @@ static int ecp_normalize_jac_many( const mbedtls_ecp_group *grp,
     /*
      * u = 1 / (Z_0 * ... * Z_n) mod P
      */
-    MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( &u, &c[t_len-1], &grp->P ) );
+    MBEDTLS_MPI_CHK( ecp_inv_mod( grp, &u, &c[t_len-1] ) );
 
     for( i = t_len - 1; ; i-- )
     {
@@ -893,7 +1086,7 @@ static int ecp_safe_invert_jac( const mbedtls_ecp_group *grp,
     unsigned char nonzero;
     mbedtls_mpi mQY;
 
-    mbedtls_mpi_init( &mQY );
+    ECP_MPI_INIT( grp, &mQY );
 
     /* Use the fact that -Q.Y mod P = P - Q.Y unless Q.Y == 0 */
     MBEDTLS_MPI_CHK( mbedtls_mpi_sub_mpi( &mQY, &grp->P, &Q->Y ) );
@@ -937,7 +1130,7 @@ static int ecp_double_jac( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     }
 #endif /* MBEDTLS_ECP_DOUBLE_JAC_ALT */
 
-    mbedtls_mpi_init( &M ); mbedtls_mpi_init( &S ); mbedtls_mpi_init( &T ); mbedtls_mpi_init( &U );
+    ECP_MPI_INIT( grp, &M ); ECP_MPI_INIT( grp, &S ); ECP_MPI_INIT( grp, &T ); ECP_MPI_INIT( grp, &U );
 
     /* Special case for A = -3 */
     if( grp->A.p == NULL )
@@ -961,7 +1154,7 @@ static int ecp_double_jac( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
             /* M += A.Z^4 */
             MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &S,  &P->Z,  &P->Z   ) ); MOD_MUL( S );
             MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &T,  &S,     &S      ) ); MOD_MUL( T );
-            MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &S,  &T,     &grp->A ) ); MOD_MUL( S );
+            MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &S,  &T,   ecp_a( grp ) ) ); MOD_MUL( S );
             MBEDTLS_MPI_CHK( mbedtls_mpi_add_mpi( &M,  &M,     &S      ) ); MOD_ADD( M );
         }
     }
@@ -1047,11 +1240,11 @@ static int ecp_add_mixed( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     /*
      * Make sure Q coordinates are normalized
      */
-    if( Q->Z.p != NULL && mbedtls_mpi_cmp_int( &Q->Z, 1 ) != 0 )
+    if( Q->Z.p != NULL && ! ecp_is_one( grp, &Q->Z ) )
         return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
 
-    mbedtls_mpi_init( &T1 ); mbedtls_mpi_init( &T2 ); mbedtls_mpi_init( &T3 ); mbedtls_mpi_init( &T4 );
-    mbedtls_mpi_init( &X ); mbedtls_mpi_init( &Y ); mbedtls_mpi_init( &Z );
+    ECP_MPI_INIT( grp, &T1 ); ECP_MPI_INIT( grp, &T2 ); ECP_MPI_INIT( grp, &T3 ); ECP_MPI_INIT( grp, &T4 );
+    ECP_MPI_INIT( grp, &X ); ECP_MPI_INIT( grp, &Y ); ECP_MPI_INIT( grp, &Z );
 
     MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &T1,  &P->Z,  &P->Z ) );  MOD_MUL( T1 );
     MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &T2,  &T1,    &P->Z ) );  MOD_MUL( T2 );
@@ -1123,7 +1316,7 @@ static int ecp_randomize_jac( const mbedtls_ecp_group *grp, mbedtls_ecp_point *p
 #endif /* MBEDTLS_ECP_RANDOMIZE_JAC_ALT */
 
     p_size = ( grp->pbits + 7 ) / 8;
-    mbedtls_mpi_init( &l ); mbedtls_mpi_init( &ll );
+    ECP_MPI_INIT( grp, &l ); ECP_MPI_INIT( grp, &ll );
 
     /* Generate l such that 1 < l < p */
     do
@@ -1241,7 +1434,7 @@ static int ecp_precompute_comb( const mbedtls_ecp_group *grp,
      * Set T[0] = P and
      * T[2^{l-1}] = 2^{dl} P for l = 1 .. w-1 (this is not the final value)
      */
-    MBEDTLS_MPI_CHK( mbedtls_ecp_copy( &T[0], P ) );
+    MBEDTLS_MPI_CHK( ecp_to_mont( grp, &T[0], P ) );
 
     k = 0;
     for( i = 1; i < ( 1U << ( w - 1 ) ); i <<= 1 )
@@ -1321,12 +1514,12 @@ static int ecp_mul_comb_core( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R
     mbedtls_ecp_point Txi;
     size_t i;
 
-    mbedtls_ecp_point_init( &Txi );
+    ECP_POINT_INIT( grp, &Txi );
 
     /* Start with a non-zero point and randomize its coordinates */
     i = d;
     MBEDTLS_MPI_CHK( ecp_select_comb( grp, R, T, t_len, x[i] ) );
-    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &R->Z, 1 ) );
+    MBEDTLS_MPI_CHK( ecp_set_one( grp, &R->Z ) );
     if( f_rng != 0 )
         MBEDTLS_MPI_CHK( ecp_randomize_jac( grp, R, f_rng, p_rng ) );
 
@@ -1345,27 +1538,28 @@ cleanup:
 }
 
 /*
- * Multiplication using the comb method,
- * for curves in short Weierstrass form
+ * Tell if P == G, that is if the precomputed points of G can be used for it
  */
-static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
-                         const mbedtls_mpi *m, const mbedtls_ecp_point *P,
-                         int (*f_rng)(void *, unsigned char *, size_t),
-                         void *p_rng )
+static unsigned char ecp_is_generator( const mbedtls_ecp_group *grp,
+                                       const mbedtls_ecp_point *P )
 {
-    int ret;
-    unsigned char w, m_is_odd, p_eq_g, pre_len, i;
-    size_t d;
-    unsigned char k[COMB_MAX_D + 1];
-    mbedtls_ecp_point *T;
-    mbedtls_mpi M, mm;
-
-    mbedtls_mpi_init( &M );
-    mbedtls_mpi_init( &mm );
+#if MBEDTLS_ECP_FIXED_POINT_OPTIM == 1
+    return( mbedtls_mpi_cmp_mpi( &P->Y, &grp->G.Y ) == 0 &&
+            mbedtls_mpi_cmp_mpi( &P->X, &grp->G.X ) == 0 );
+#else
+    (void) grp;
+    (void) P;
+    return( 0 );
+#endif
+}
 
-    /* we need N to be odd to trnaform m in an odd number, check now */
-    if( mbedtls_mpi_get_bit( &grp->N, 0 ) != 1 )
-        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+/*
+ * Window size of the comb method for P, p_eq_g telling if P == G
+ */
+static unsigned char ecp_comb_window( const mbedtls_ecp_group *grp,
+                                      unsigned char p_eq_g )
+{
+    unsigned char w;
 
     /*
      * Minimize the number of multiplications, that is minimize
@@ -1379,14 +1573,8 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
      * Just adding one avoids upping the cost of the first mul too much,
      * and the memory cost too.
      */
-#if MBEDTLS_ECP_FIXED_POINT_OPTIM == 1
-    p_eq_g = ( mbedtls_mpi_cmp_mpi( &P->Y, &grp->G.Y ) == 0 &&
-               mbedtls_mpi_cmp_mpi( &P->X, &grp->G.X ) == 0 );
     if( p_eq_g )
         w++;
-#else
-    p_eq_g = 0;
-#endif
 
     /*
      * Make sure w is within bounds.
@@ -1397,34 +1585,102 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     if( w >= grp->nbits )
         w = 2;
 
-    /* Other sizes that depend on w */
-    pre_len = 1U << ( w - 1 );
-    d = ( grp->nbits + w - 1 ) / w;
-
     /*
-     * Prepare precomputed points: if P == G we want to
-     * use grp->T if already initialized, or initialize it.
+     * If the table of G is already there, use the window it was computed
+     * with: built-in curves come with static tables of their own size.
      */
-    T = p_eq_g ? grp->T : NULL;
+    if( p_eq_g && grp->T != NULL )
+    {
+        for( w = 2; ( 1U << ( w - 1 ) ) < grp->T_size; w++ )
+            ;
+    }
+
+    return( w );
+}
+
+/*
+ * Get the precomputed points for P: if P == G we want to use grp->T if
+ * already initialized, or initialize it. Otherwise *T is a new table, to be
+ * released with ecp_table_free().
+ */
+static int ecp_comb_table( mbedtls_ecp_group *grp, mbedtls_ecp_point **T,
+                           const mbedtls_ecp_point *P, unsigned char p_eq_g,
+                           unsigned char w, size_t d )
+{
+    int ret;
+    unsigned char i, pre_len = 1U << ( w - 1 );
+
+    *T = p_eq_g ? grp->T : NULL;
+
+    if( *T != NULL )
+        return( 0 );
 
-    if( T == NULL )
+    *T = mbedtls_calloc( pre_len, sizeof( mbedtls_ecp_point ) );
+    if( *T == NULL )
+        return( MBEDTLS_ERR_ECP_ALLOC_FAILED );
+
+    /* Unless it is going to be kept in the group, the table is temporary */
+    if( ! p_eq_g || grp->h == 1 )
+        for( i = 0; i < pre_len; i++ )
+            ECP_POINT_INIT( grp, &(*T)[i] );
+
+    MBEDTLS_MPI_CHK( ecp_precompute_comb( grp, *T, P, w, d ) );
+
+    /* Static groups never own T, see mbedtls_ecp_group_free() */
+    if( p_eq_g && grp->h != 1 )
     {
-        T = mbedtls_calloc( pre_len, sizeof( mbedtls_ecp_point ) );
-        if( T == NULL )
-        {
-            ret = MBEDTLS_ERR_ECP_ALLOC_FAILED;
-            goto cleanup;
-        }
+        grp->T = *T;
+        grp->T_size = pre_len;
+    }
 
-        MBEDTLS_MPI_CHK( ecp_precompute_comb( grp, T, P, w, d ) );
+cleanup:
 
-        if( p_eq_g )
-        {
-            grp->T = T;
-            grp->T_size = pre_len;
-        }
+    if( ret != 0 )
+    {
+        for( i = 0; i < pre_len; i++ )
+            mbedtls_ecp_point_free( &(*T)[i] );
+        mbedtls_free( *T );
+        *T = NULL;
     }
 
+    return( ret );
+}
+
+/*
+ * Free a table of t_len precomputed points, unless it is grp->T
+ */
+static void ecp_table_free( const mbedtls_ecp_group *grp,
+                            mbedtls_ecp_point *T, size_t t_len )
+{
+    size_t i;
+
+    if( T == NULL || T == grp->T )
+        return;
+
+    for( i = 0; i < t_len; i++ )
+        mbedtls_ecp_point_free( &T[i] );
+    mbedtls_free( T );
+}
+
+/*
+ * R = m * P with the comb method, given the precomputed points T of P,
+ * for a window of w bits: R is left in Jacobian coordinates
+ */
+static int ecp_mul_comb_jac( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
+                             const mbedtls_mpi *m, const mbedtls_ecp_point T[],
+                             unsigned char w,
+                             int (*f_rng)(void *, unsigned char *, size_t),
+                             void *p_rng )
+{
+    int ret;
+    unsigned char m_is_odd;
+    size_t d = ( grp->nbits + w - 1 ) / w;
+    unsigned char k[COMB_MAX_D + 1];
+    mbedtls_mpi M, mm;
+
+    ECP_MPI_INIT( grp, &M );
+    ECP_MPI_INIT( grp, &mm );
+
     /*
      * Make sure M is odd (M = m or M = N - m, since N is odd)
      * using the fact that m * P = - (N - m) * P
@@ -1438,28 +1694,364 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
      * Go for comb multiplication, R = M * P
      */
     ecp_comb_fixed( k, d, w, &M );
-    MBEDTLS_MPI_CHK( ecp_mul_comb_core( grp, R, T, pre_len, k, d, f_rng, p_rng ) );
+    MBEDTLS_MPI_CHK( ecp_mul_comb_core( grp, R, T, 1U << ( w - 1 ), k, d,
+                                        f_rng, p_rng ) );
 
     /*
-     * Now get m * P from M * P and normalize it
+     * Now get m * P from M * P
      */
     MBEDTLS_MPI_CHK( ecp_safe_invert_jac( grp, R, ! m_is_odd ) );
+
+cleanup:
+
+    mbedtls_mpi_free( &M );
+    mbedtls_mpi_free( &mm );
+
+    return( ret );
+}
+
+/*
+ * Multiplication using the comb method,
+ * for curves in short Weierstrass form
+ */
+static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
+                         const mbedtls_mpi *m, const mbedtls_ecp_point *P,
+                         int (*f_rng)(void *, unsigned char *, size_t),
+                         void *p_rng )
+{
+    int ret;
+    unsigned char w, p_eq_g;
+    mbedtls_ecp_point *T = NULL;
+
+    /* we need N to be odd to trnaform m in an odd number, check now */
+    if( mbedtls_mpi_get_bit( &grp->N, 0 ) != 1 )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    p_eq_g = ecp_is_generator( grp, P );
+    w = ecp_comb_window( grp, p_eq_g );
+
+    MBEDTLS_MPI_CHK( ecp_comb_table( grp, &T, P, p_eq_g, w,
+                                     ( grp->nbits + w - 1 ) / w ) );
+    MBEDTLS_MPI_CHK( ecp_mul_comb_jac( grp, R, m, T, w, f_rng, p_rng ) );
     MBEDTLS_MPI_CHK( ecp_normalize_jac( grp, R ) );
+    MBEDTLS_MPI_CHK( ecp_from_mont( grp, R ) );
+
+cleanup:
+
+    ecp_table_free( grp, T, 1U << ( w - 1 ) );
+
+    if( ret != 0 )
+        mbedtls_ecp_point_free( R );
+
+    return( ret );
+}
+
+/*
+ * Normalize the non-zero points of T with a single inversion, leaving
+ * them with Z == 1 like ecp_normalize_jac() does. T is reordered.
+ */
+static int ecp_normalize_jac_batch( const mbedtls_ecp_group *grp,
+                                    mbedtls_ecp_point *T[], size_t t_len )
+{
+    int ret;
+    size_t i, k;
+
+    for( i = 0, k = 0; i < t_len; i++ )
+        if( mbedtls_mpi_cmp_int( &T[i]->Z, 0 ) != 0 )
+            T[k++] = T[i];
+
+    if( k == 0 )
+        return( 0 );
+
+    MBEDTLS_MPI_CHK( ecp_normalize_jac_many( grp, T, k ) );
+
+    for( i = 0; i < k; i++ )
+        MBEDTLS_MPI_CHK( ecp_set_one( grp, &T[i]->Z ) );
 
 cleanup:
+    return( ret );
+}
+
+/*
+ * Linear combinations for mbedtls_ecp_muladd(): interleaved method
+ * (GECC 3.51), where m * P and n * Q share their doublings.
+ *
+ * Each scalar is given as signed digits k[i] of weight 2^i. A non-zero digit
+ * k[i] stands for sign(k[i]) * T[( |k[i]| - 1 ) / 2], T being the
+ * precomputed points of its point:
+ * - if P == G, the comb table of G (see ecp_precompute_comb()), which is
+ *   static or cached in the group, and the d + 1 digits of the modified
+ *   comb method (see ecp_comb_fixed()), since K_i * 2^i P = 2^i T[K_i / 2];
+ * - otherwise, the odd multiples ( 2 i + 1 ) P for i < 2^(w-2), and the
+ *   width-w NAF of the scalar, about nbits / ( w + 1 ) non-zero digits.
+ *
+ * Only public data may go through these functions: they are NOT
+ * constant-time, neither in the scalars nor in the points.
+ */
+
+/* Maximum number of digits, the wNAF being the longest */
+#define MULADD_MAX_DIGITS   ( MBEDTLS_ECP_MAX_BITS + 1 )
+
+/* Number of precomputed points */
+#define MULADD_T_LEN( w, comb )     ( 1U << ( ( w ) - 2 + ( comb ) ) )
+
+/*
+ * Width-w NAF of m (GECC 3.35), in k[0..*len-1]
+ * m must be less than 2^MBEDTLS_ECP_MAX_BITS in absolute value.
+ */
+static int ecp_wnaf( signed char k[], size_t *len,
+                     const mbedtls_mpi *m, unsigned char w )
+{
+    int ret;
+    size_t i = 0, z;
+    mbedtls_mpi_sint u;
+    mbedtls_mpi M;
+
+    mbedtls_mpi_init( &M );
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &M, m ) );
+    M.s = 1;
 
-    if( T != NULL && ! p_eq_g )
+    while( mbedtls_mpi_cmp_int( &M, 0 ) != 0 )
     {
-        for( i = 0; i < pre_len; i++ )
-            mbedtls_ecp_point_free( &T[i] );
-        mbedtls_free( T );
+        /* Skip to the next odd value */
+        z = mbedtls_mpi_lsb( &M );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_shift_r( &M, z ) );
+        memset( k + i, 0, z );
+        i += z;
+
+        /* u = M mods 2^w, so that M - u is a multiple of 2^w */
+        u = (mbedtls_mpi_sint)( M.p[0] & ( ( 1U << w ) - 1 ) );
+        if( u >= ( 1 << ( w - 1 ) ) )
+            u -= 1 << w;
+
+        MBEDTLS_MPI_CHK( mbedtls_mpi_sub_int( &M, &M, u ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_shift_r( &M, 1 ) );
+        k[i++] = (signed char)( m->s < 0 ? -u : u );
     }
 
+    *len = i;
+
+cleanup:
     mbedtls_mpi_free( &M );
-    mbedtls_mpi_free( &mm );
+
+    return( ret );
+}
+
+/*
+ * Precompute T[i] = ( 2 i + 1 ) P for i < 2^(w-2), normalized with Z == 1
+ *
+ * Cost: 1D + ( 2^(w-2) - 1 ) A + 2N
+ */
+static int ecp_precompute_wnaf( const mbedtls_ecp_group *grp,
+                                mbedtls_ecp_point T[],
+                                const mbedtls_ecp_point *P, unsigned char w )
+{
+    int ret;
+    size_t i, t_len = MULADD_T_LEN( w, 0 );
+    mbedtls_ecp_point D, *TT[MULADD_T_LEN( 7, 0 )];
+
+    ECP_POINT_INIT( grp, &D );
+
+    MBEDTLS_MPI_CHK( ecp_to_mont( grp, &T[0], P ) );
+
+    if( t_len > 1 )
+    {
+        MBEDTLS_MPI_CHK( ecp_double_jac( grp, &D, &T[0] ) );
+        MBEDTLS_MPI_CHK( ecp_normalize_jac( grp, &D ) );
+
+        for( i = 1; i < t_len; i++ )
+        {
+            MBEDTLS_MPI_CHK( ecp_add_mixed( grp, &T[i], &T[i - 1], &D ) );
+            TT[i - 1] = &T[i];
+        }
+
+        MBEDTLS_MPI_CHK( ecp_normalize_jac_batch( grp, TT, t_len - 1 ) );
+    }
+
+cleanup:
+    mbedtls_ecp_point_free( &D );
+
+    return( ret );
+}
+
+/*
+ * Precomputed points for m * P, see above: with a window of 2, that is
+ * P alone, for m == 1 or -1, or if m is NULL and P is not G, odd multiples
+ * with the best window for the size of the curve. If P is G or is going to
+ * be used for several multiplications (reuse != 0), the comb table is worth
+ * its cost instead. Sets *comb to tell which kind of table *T is.
+ */
+static int ecp_muladd_table( mbedtls_ecp_group *grp, mbedtls_ecp_point **T,
+                             unsigned char *w, unsigned char *comb,
+                             const mbedtls_mpi *m, const mbedtls_ecp_point *P,
+                             unsigned char reuse )
+{
+    int ret;
+    size_t i;
+    unsigned char p_eq_g = ecp_is_generator( grp, P );
+
+    *comb = 0;
+
+    if( m != NULL && ( mbedtls_mpi_cmp_int( m, 1 ) == 0 ||
+                       mbedtls_mpi_cmp_int( m, -1 ) == 0 ) )
+    {
+        *w = 2;
+    }
+    else if( ( p_eq_g || reuse ) &&
+             mbedtls_mpi_get_bit( &grp->N, 0 ) == 1 )
+    {
+        *comb = 1;
+        *w = ecp_comb_window( grp, p_eq_g );
+        return( ecp_comb_table( grp, T, P, p_eq_g, *w,
+                                ( grp->nbits + *w - 1 ) / *w ) );
+    }
+    else
+    {
+        *w = grp->nbits >= 384 ? 6 : 5;
+
+        if( *w > MBEDTLS_ECP_WINDOW_SIZE )
+            *w = MBEDTLS_ECP_WINDOW_SIZE;
+        if( *w >= grp->nbits )
+            *w = 2;
+    }
+
+    *T = mbedtls_calloc( MULADD_T_LEN( *w, 0 ), sizeof( mbedtls_ecp_point ) );
+    if( *T == NULL )
+        return( MBEDTLS_ERR_ECP_ALLOC_FAILED );
+
+    for( i = 0; i < MULADD_T_LEN( *w, 0 ); i++ )
+        ECP_POINT_INIT( grp, &(*T)[i] );
+
+    MBEDTLS_MPI_CHK( ecp_precompute_wnaf( grp, *T, P, *w ) );
+
+cleanup:
 
     if( ret != 0 )
-        mbedtls_ecp_point_free( R );
+    {
+        for( i = 0; i < MULADD_T_LEN( *w, 0 ); i++ )
+            mbedtls_ecp_point_free( &(*T)[i] );
+        mbedtls_free( *T );
+        *T = NULL;
+    }
+
+    return( ret );
+}
+
+/*
+ * Digits of m matching a table from ecp_muladd_table()
+ */
+static int ecp_muladd_digits( const mbedtls_ecp_group *grp,
+                              signed char k[], size_t *len,
+                              const mbedtls_mpi *m,
+                              unsigned char w, unsigned char comb )
+{
+    int ret;
+    unsigned char m_is_odd, v, x[COMB_MAX_D + 1];
+    size_t i, d;
+    mbedtls_mpi M;
+
+    if( ! comb )
+        return( ecp_wnaf( k, len, m, w ) );
+
+    ECP_MPI_INIT( grp, &M );
+
+    /*
+     * As in ecp_mul_comb(): digits of M = m or N - m, whichever is odd,
+     * negated in the latter case
+     */
+    d = ( grp->nbits + w - 1 ) / w;
+    m_is_odd = ( mbedtls_mpi_get_bit( m, 0 ) == 1 );
+
+    if( m_is_odd )
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &M, m ) );
+    else
+        MBEDTLS_MPI_CHK( mbedtls_mpi_sub_mpi( &M, &grp->N, m ) );
+
+    ecp_comb_fixed( x, d, w, &M );
+
+    for( i = 0; i <= d; i++ )
+    {
+        v = x[i] & 0x7F;
+        k[i] = (signed char)( ( x[i] >> 7 ) ^ ! m_is_odd ? - v : v );
+    }
+
+    *len = d + 1;
+
+cleanup:
+    mbedtls_mpi_free( &M );
+
+    return( ret );
+}
+
+/*
+ * R += sign(k) * T[( |k| - 1 ) / 2], with T normalized
+ */
+static int ecp_muladd_add( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
+                           const mbedtls_ecp_point T[], signed char k,
+                           mbedtls_ecp_point *tmp )
+{
+    int ret;
+    const mbedtls_ecp_point *S = &T[( ( k < 0 ? -k : k ) - 1 ) / 2];
+
+    if( S->Z.p != NULL && mbedtls_mpi_cmp_int( &S->Z, 0 ) == 0 )
+        return( 0 );
+
+    if( k < 0 )
+    {
+        MBEDTLS_MPI_CHK( mbedtls_ecp_copy( tmp, S ) );
+        MBEDTLS_MPI_CHK( ecp_safe_invert_jac( grp, tmp, 1 ) );
+        S = tmp;
+    }
+
+    if( mbedtls_mpi_cmp_int( &R->Z, 0 ) == 0 )
+    {
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &R->X, &S->X ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &R->Y, &S->Y ) );
+        MBEDTLS_MPI_CHK( ecp_set_one( grp, &R->Z ) );
+    }
+    else
+    {
+        MBEDTLS_MPI_CHK( ecp_add_mixed( grp, R, R, S ) );
+    }
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * R = sum of the digits kp of TP and kq of TQ, in Jacobian coordinates
+ *
+ * Cost: max( lp, lq ) D + (number of non-zero digits) A
+ */
+static int ecp_muladd_jac( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
+                           const signed char kp[], size_t lp,
+                           const mbedtls_ecp_point TP[],
+                           const signed char kq[], size_t lq,
+                           const mbedtls_ecp_point TQ[] )
+{
+    int ret;
+    size_t i = lp > lq ? lp : lq;
+    mbedtls_ecp_point tmp;
+
+    ECP_POINT_INIT( grp, &tmp );
+
+    MBEDTLS_MPI_CHK( mbedtls_ecp_set_zero( R ) );
+
+    while( i-- != 0 )
+    {
+        if( mbedtls_mpi_cmp_int( &R->Z, 0 ) != 0 )
+            MBEDTLS_MPI_CHK( ecp_double_jac( grp, R, R ) );
+
+        if( i < lp && kp[i] != 0 )
+            MBEDTLS_MPI_CHK( ecp_muladd_add( grp, R, TP, kp[i], &tmp ) );
+
+        if( i < lq && kq[i] != 0 )
+            MBEDTLS_MPI_CHK( ecp_muladd_add( grp, R, TQ, kq[i], &tmp ) );
+    }
+
+cleanup:
+    mbedtls_ecp_point_free( &tmp );
 
     return( ret );
 }
@@ -1522,7 +2114,7 @@ static int ecp_randomize_mxz( const mbedtls_ecp_group *grp, mbedtls_ecp_point *P
 #endif /* MBEDTLS_ECP_RANDOMIZE_MXZ_ALT */
 
     p_size = ( grp->pbits + 7 ) / 8;
-    mbedtls_mpi_init( &l );
+    ECP_MPI_INIT( grp, &l );
 
     /* Generate l such that 1 < l < p */
     do
@@ -1576,9 +2168,9 @@ static int ecp_double_add_mxz( const mbedtls_ecp_group *grp,
     }
 #endif /* MBEDTLS_ECP_DOUBLE_ADD_MXZ_ALT */
 
-    mbedtls_mpi_init( &A ); mbedtls_mpi_init( &AA ); mbedtls_mpi_init( &B );
-    mbedtls_mpi_init( &BB ); mbedtls_mpi_init( &E ); mbedtls_mpi_init( &C );
-    mbedtls_mpi_init( &D ); mbedtls_mpi_init( &DA ); mbedtls_mpi_init( &CB );
+    ECP_MPI_INIT( grp, &A ); ECP_MPI_INIT( grp, &AA ); ECP_MPI_INIT( grp, &B );
+    ECP_MPI_INIT( grp, &BB ); ECP_MPI_INIT( grp, &E ); ECP_MPI_INIT( grp, &C );
+    ECP_MPI_INIT( grp, &D ); ECP_MPI_INIT( grp, &DA ); ECP_MPI_INIT( grp, &CB );
 
     MBEDTLS_MPI_CHK( mbedtls_mpi_add_mpi( &A,    &P->X,   &P->Z ) ); MOD_ADD( A    );
     MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &AA,   &A,      &A    ) ); MOD_MUL( AA   );
@@ -1622,7 +2214,12 @@ static int ecp_mul_mxz( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     mbedtls_ecp_point RP;
     mbedtls_mpi PX;
 
-    mbedtls_ecp_point_init( &RP ); mbedtls_mpi_init( &PX );
+#if defined(MBEDTLS_ECP_X25519_NATIVE)
+    if( grp->id == MBEDTLS_ECP_DP_CURVE25519 )
+        return( mbedtls_ecp_x25519_mul( R, m, P, f_rng, p_rng ) );
+#endif
+
+    ECP_POINT_INIT( grp, &RP ); ECP_MPI_INIT( grp, &PX );
 
     /* Save PX and read from P before writing to R, in case P == R */
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &PX, &P->X ) );
@@ -1633,8 +2230,9 @@ static int ecp_mul_mxz( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &R->Z, 0 ) );
     mbedtls_mpi_free( &R->Y );
 
-    /* RP.X might be sligtly larger than P, so reduce it */
+    /* RP.X and PX might be sligtly larger than P, so reduce them */
     MOD_ADD( RP.X );
+    MOD_ADD( PX );
 
     /* Randomize coordinates of the starting point */
     if( f_rng != NULL )
@@ -1690,12 +2288,13 @@ int mbedtls_ecp_mul( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
         return( ret );
 
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
-#if defined(MBEDTLS_THREADING_C)
+    /* The built-in secp256r1 implementation has no shared state to protect */
+#if defined(MBEDTLS_THREADING_C) && !defined(MBEDTLS_ECP_P256_C)
     if( mbedtls_mutex_lock( &mbedtls_threading_ecp_mutex ) != 0 )
         return ( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
 
 #endif
-    if ( is_grp_capable = mbedtls_internal_ecp_grp_capable( grp )  )
+    if( ( is_grp_capable = mbedtls_internal_ecp_grp_capable( grp ) ) )
     {
         MBEDTLS_MPI_CHK( mbedtls_internal_ecp_init( grp ) );
     }
@@ -1719,7 +2318,7 @@ cleanup:
         mbedtls_internal_ecp_free( grp );
     }
 
-#if defined(MBEDTLS_THREADING_C)
+#if defined(MBEDTLS_THREADING_C) && !defined(MBEDTLS_ECP_P256_C)
     if( mbedtls_mutex_unlock( &mbedtls_threading_ecp_mutex ) != 0 )
         return ( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
 
@@ -1737,6 +2336,11 @@ static int ecp_check_pubkey_sw( const mbedtls_ecp_group *grp, const mbedtls_ecp_
 {
     int ret;
     mbedtls_mpi YY, RHS;
+    const mbedtls_mpi *X = &pt->X, *Y = &pt->Y, *B = &grp->B;
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    mbedtls_ecp_point Pm;
+    mbedtls_mpi Bm;
+#endif
 
     /* pt coordinates must be normalized for our checks */
     if( mbedtls_mpi_cmp_int( &pt->X, 0 ) < 0 ||
@@ -1745,27 +2349,41 @@ static int ecp_check_pubkey_sw( const mbedtls_ecp_group *grp, const mbedtls_ecp_
         mbedtls_mpi_cmp_mpi( &pt->Y, &grp->P ) >= 0 )
         return( MBEDTLS_ERR_ECP_INVALID_KEY );
 
-    mbedtls_mpi_init( &YY ); mbedtls_mpi_init( &RHS );
+    ECP_MPI_INIT( grp, &YY ); ECP_MPI_INIT( grp, &RHS );
+
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    ECP_POINT_INIT( grp, &Pm ); ECP_MPI_INIT( grp, &Bm );
+
+    /* Check the equation in Montgomery form, a bijection */
+    if( ECP_MONT( grp ) )
+    {
+        MBEDTLS_MPI_CHK( ecp_to_mont( grp, &Pm, pt ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &Bm, &grp->B, &grp->RR ) ); MOD_MUL( Bm );
+        X = &Pm.X;
+        Y = &Pm.Y;
+        B = &Bm;
+    }
+#endif
 
     /*
      * YY = Y^2
      * RHS = X (X^2 + A) + B = X^3 + A X + B
      */
-    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &YY,  &pt->Y,   &pt->Y  ) );  MOD_MUL( YY  );
-    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &RHS, &pt->X,   &pt->X  ) );  MOD_MUL( RHS );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &YY,  Y,        Y       ) );  MOD_MUL( YY  );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &RHS, X,        X       ) );  MOD_MUL( RHS );
 
-    /* Special case for A = -3 */
-    if( grp->A.p == NULL )
+    /* Special case for A = -3, unless in Montgomery form */
+    if( grp->A.p == NULL && ! ECP_MONT( grp ) )
     {
         MBEDTLS_MPI_CHK( mbedtls_mpi_sub_int( &RHS, &RHS, 3       ) );  MOD_SUB( RHS );
     }
     else
     {
-        MBEDTLS_MPI_CHK( mbedtls_mpi_add_mpi( &RHS, &RHS, &grp->A ) );  MOD_ADD( RHS );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_add_mpi( &RHS, &RHS, ecp_a( grp ) ) ); MOD_ADD( RHS );
     }
 
-    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &RHS, &RHS,     &pt->X  ) );  MOD_MUL( RHS );
-    MBEDTLS_MPI_CHK( mbedtls_mpi_add_mpi( &RHS, &RHS,     &grp->B ) );  MOD_ADD( RHS );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &RHS, &RHS,     X       ) );  MOD_MUL( RHS );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_add_mpi( &RHS, &RHS,     B       ) );  MOD_ADD( RHS );
 
     if( mbedtls_mpi_cmp_mpi( &YY, &RHS ) != 0 )
         ret = MBEDTLS_ERR_ECP_INVALID_KEY;
@@ -1773,39 +2391,34 @@ static int ecp_check_pubkey_sw( const mbedtls_ecp_group *grp, const mbedtls_ecp_
 cleanup:
 
     mbedtls_mpi_free( &YY ); mbedtls_mpi_free( &RHS );
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    mbedtls_ecp_point_free( &Pm ); mbedtls_mpi_free( &Bm );
+#endif
 
     return( ret );
 }
 #endif /* ECP_SHORTWEIERSTRASS */
 
 /*
- * R = m * P with shortcuts for m == 1 and m == -1
- * NOT constant-time - ONLY for short Weierstrass!
+ * Checks of mbedtls_ecp_mul() for each part of mbedtls_ecp_muladd(), except
+ * for the scalars 1 and -1 that do not need any
  */
-static int mbedtls_ecp_mul_shortcuts( mbedtls_ecp_group *grp,
-                                      mbedtls_ecp_point *R,
-                                      const mbedtls_mpi *m,
-                                      const mbedtls_ecp_point *P )
+static int ecp_muladd_check( const mbedtls_ecp_group *grp,
+                             const mbedtls_mpi *m, const mbedtls_ecp_point *P )
 {
     int ret;
 
-    if( mbedtls_mpi_cmp_int( m, 1 ) == 0 )
-    {
-        MBEDTLS_MPI_CHK( mbedtls_ecp_copy( R, P ) );
-    }
-    else if( mbedtls_mpi_cmp_int( m, -1 ) == 0 )
-    {
-        MBEDTLS_MPI_CHK( mbedtls_ecp_copy( R, P ) );
-        if( mbedtls_mpi_cmp_int( &R->Y, 0 ) != 0 )
-            MBEDTLS_MPI_CHK( mbedtls_mpi_sub_mpi( &R->Y, &grp->P, &R->Y ) );
-    }
-    else
-    {
-        MBEDTLS_MPI_CHK( mbedtls_ecp_mul( grp, R, m, P, NULL, NULL ) );
-    }
+    if( mbedtls_mpi_cmp_int( &P->Z, 1 ) != 0 )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
 
-cleanup:
-    return( ret );
+    if( mbedtls_mpi_cmp_int( m, 1 ) == 0 || mbedtls_mpi_cmp_int( m, -1 ) == 0 )
+        return( 0 );
+
+    if( ( ret = mbedtls_ecp_check_privkey( grp, m ) ) != 0 ||
+        ( ret = mbedtls_ecp_check_pubkey( grp, P ) ) != 0 )
+        return( ret );
+
+    return( 0 );
 }
 
 /*
@@ -1817,7 +2430,10 @@ int mbedtls_ecp_muladd( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
              const mbedtls_mpi *n, const mbedtls_ecp_point *Q )
 {
     int ret;
-    mbedtls_ecp_point mP;
+    unsigned char wp, wq, cp = 0, cq = 0;
+    size_t lp, lq;
+    signed char kp[MULADD_MAX_DIGITS], kq[MULADD_MAX_DIGITS];
+    mbedtls_ecp_point *TP = NULL, *TQ = NULL;
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
     char is_grp_capable = 0;
 #endif
@@ -1825,45 +2441,166 @@ int mbedtls_ecp_muladd( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     if( ecp_get_type( grp ) != ECP_TYPE_SHORT_WEIERSTRASS )
         return( MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE );
 
-    mbedtls_ecp_point_init( &mP );
-
-    MBEDTLS_MPI_CHK( mbedtls_ecp_mul_shortcuts( grp, &mP, m, P ) );
-    MBEDTLS_MPI_CHK( mbedtls_ecp_mul_shortcuts( grp, R,   n, Q ) );
+    if( ( ret = ecp_muladd_check( grp, m, P ) ) != 0 ||
+        ( ret = ecp_muladd_check( grp, n, Q ) ) != 0 )
+        return( ret );
 
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
-#if defined(MBEDTLS_THREADING_C)
+#if defined(MBEDTLS_THREADING_C) && !defined(MBEDTLS_ECP_P256_C)
     if( mbedtls_mutex_lock( &mbedtls_threading_ecp_mutex ) != 0 )
         return ( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
 
 #endif
-    if (  is_grp_capable = mbedtls_internal_ecp_grp_capable( grp )  )
+    if( ( is_grp_capable = mbedtls_internal_ecp_grp_capable( grp ) ) )
     {
         MBEDTLS_MPI_CHK( mbedtls_internal_ecp_init( grp ) );
     }
 
 #endif /* MBEDTLS_ECP_INTERNAL_ALT */
-    MBEDTLS_MPI_CHK( ecp_add_mixed( grp, R, &mP, R ) );
+    MBEDTLS_MPI_CHK( ecp_muladd_table( grp, &TP, &wp, &cp, m, P, 0 ) );
+    MBEDTLS_MPI_CHK( ecp_muladd_table( grp, &TQ, &wq, &cq, n, Q, 0 ) );
+    MBEDTLS_MPI_CHK( ecp_muladd_digits( grp, kp, &lp, m, wp, cp ) );
+    MBEDTLS_MPI_CHK( ecp_muladd_digits( grp, kq, &lq, n, wq, cq ) );
+
+    MBEDTLS_MPI_CHK( ecp_muladd_jac( grp, R, kp, lp, TP, kq, lq, TQ ) );
     MBEDTLS_MPI_CHK( ecp_normalize_jac( grp, R ) );
+    MBEDTLS_MPI_CHK( ecp_from_mont( grp, R ) );
 
 cleanup:
 
+    if( TP != NULL )
+        ecp_table_free( grp, TP, MULADD_T_LEN( wp, cp ) );
+    if( TQ != NULL )
+        ecp_table_free( grp, TQ, MULADD_T_LEN( wq, cq ) );
+
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
     if ( is_grp_capable )
     {
         mbedtls_internal_ecp_free( grp );
     }
 
-#if defined(MBEDTLS_THREADING_C)
+#if defined(MBEDTLS_THREADING_C) && !defined(MBEDTLS_ECP_P256_C)
     if( mbedtls_mutex_unlock( &mbedtls_threading_ecp_mutex ) != 0 )
         return ( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
 
 #endif
 #endif /* MBEDTLS_ECP_INTERNAL_ALT */
-    mbedtls_ecp_point_free( &mP );
-
     return( ret );
 }
 
+/*
+ * Linear combinations R[i] = m[i] * P + n[i] * Q[i], sharing the
+ * precomputed points of P, those of Q[i] when it repeats Q[i-1], and the
+ * normalization: a single inversion for all the results.
+ * NOT constant-time
+ */
+int mbedtls_ecp_muladd_batch( mbedtls_ecp_group *grp, mbedtls_ecp_point R[],
+             const mbedtls_mpi *m[], const mbedtls_ecp_point *P,
+             const mbedtls_mpi *n[], const mbedtls_ecp_point *Q[],
+             size_t count )
+{
+    int ret;
+    size_t i, lp, lq;
+    unsigned char wp, wq, cp = 0, cq = 0;
+    signed char kp[MULADD_MAX_DIGITS], kq[MULADD_MAX_DIGITS];
+    mbedtls_ecp_point **pts = NULL, *TP = NULL, *TQ = NULL;
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+    char is_grp_capable = 0;
+#endif
+
+    if( ecp_get_type( grp ) != ECP_TYPE_SHORT_WEIERSTRASS )
+        return( MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE );
+
+    if( count == 0 )
+        return( 0 );
+
+    /* Same checks as mbedtls_ecp_mul() */
+    if( mbedtls_mpi_cmp_int( &P->Z, 1 ) != 0 )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    if( ( ret = mbedtls_ecp_check_pubkey( grp, P ) ) != 0 )
+        return( ret );
+
+    for( i = 0; i < count; i++ )
+    {
+        if( mbedtls_mpi_cmp_int( &Q[i]->Z, 1 ) != 0 )
+            return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+        if( ( ret = mbedtls_ecp_check_privkey( grp, m[i] ) ) != 0 ||
+            ( ret = mbedtls_ecp_check_privkey( grp, n[i] ) ) != 0 ||
+            ( ret = mbedtls_ecp_check_pubkey( grp, Q[i] ) ) != 0 )
+            return( ret );
+    }
+
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+#if defined(MBEDTLS_THREADING_C) && !defined(MBEDTLS_ECP_P256_C)
+    if( mbedtls_mutex_lock( &mbedtls_threading_ecp_mutex ) != 0 )
+        return ( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
+
+#endif
+    if( ( is_grp_capable = mbedtls_internal_ecp_grp_capable( grp ) ) )
+    {
+        MBEDTLS_MPI_CHK( mbedtls_internal_ecp_init( grp ) );
+    }
+
+#endif /* MBEDTLS_ECP_INTERNAL_ALT */
+    pts = mbedtls_calloc( count, sizeof( mbedtls_ecp_point * ) );
+    if( pts == NULL )
+    {
+        ret = MBEDTLS_ERR_ECP_ALLOC_FAILED;
+        goto cleanup;
+    }
+
+    MBEDTLS_MPI_CHK( ecp_muladd_table( grp, &TP, &wp, &cp, NULL, P,
+                                       count > 1 ) );
+
+    for( i = 0; i < count; i++ )
+    {
+        if( i == 0 || mbedtls_ecp_point_cmp( Q[i], Q[i - 1] ) != 0 )
+        {
+            if( TQ != NULL )
+                ecp_table_free( grp, TQ, MULADD_T_LEN( wq, cq ) );
+            TQ = NULL;
+            MBEDTLS_MPI_CHK( ecp_muladd_table( grp, &TQ, &wq, &cq, NULL, Q[i],
+                    i + 1 < count &&
+                    mbedtls_ecp_point_cmp( Q[i], Q[i + 1] ) == 0 ) );
+        }
+
+        MBEDTLS_MPI_CHK( ecp_muladd_digits( grp, kp, &lp, m[i], wp, cp ) );
+        MBEDTLS_MPI_CHK( ecp_muladd_digits( grp, kq, &lq, n[i], wq, cq ) );
+        MBEDTLS_MPI_CHK( ecp_muladd_jac( grp, &R[i], kp, lp, TP,
+                                         kq, lq, TQ ) );
+
+        pts[i] = &R[i];
+    }
+
+    MBEDTLS_MPI_CHK( ecp_normalize_jac_batch( grp, pts, count ) );
+
+    for( i = 0; i < count; i++ )
+        MBEDTLS_MPI_CHK( ecp_from_mont( grp, &R[i] ) );
+
+cleanup:
+
+    if( TP != NULL )
+        ecp_table_free( grp, TP, MULADD_T_LEN( wp, cp ) );
+    if( TQ != NULL )
+        ecp_table_free( grp, TQ, MULADD_T_LEN( wq, cq ) );
+    mbedtls_free( pts );
+
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+    if ( is_grp_capable )
+    {
+        mbedtls_internal_ecp_free( grp );
+    }
+
+#if defined(MBEDTLS_THREADING_C) && !defined(MBEDTLS_ECP_P256_C)
+    if( mbedtls_mutex_unlock( &mbedtls_threading_ecp_mutex ) != 0 )
+        return ( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
+
+#endif
+#endif /* MBEDTLS_ECP_INTERNAL_ALT */
+    return( ret );
+}
 
 #if defined(ECP_MONTGOMERY)
 /*
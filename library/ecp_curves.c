@@ -28,9 +28,18 @@
 #if defined(MBEDTLS_ECP_C)
 
 #include "mbedtls/ecp.h"
+#include "mbedtls/ecp_internal.h"
 
 #include <string.h>
 
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdlib.h>
+#define mbedtls_calloc    calloc
+#define mbedtls_free       free
+#endif
+
 #if !defined(MBEDTLS_ECP_ALT)
 
 #if ( defined(__ARMCC_VERSION) || defined(_MSC_VER) ) && \
@@ -549,92 +558,5561 @@ static const mbedtls_mpi_uint brainpoolP512r1_n[] = {
 };
 #endif /* MBEDTLS_ECP_DP_BP512R1_ENABLED */
 
+/* BEGIN generated comb tables */
 /*
- * Create an MPI from embedded constants
- * (assumes len is an exact multiple of sizeof mbedtls_mpi_uint)
- */
-static inline void ecp_mpi_load( mbedtls_mpi *X, const mbedtls_mpi_uint *p, size_t len )
-{
-    X->s = 1;
-    X->n = len / sizeof( mbedtls_mpi_uint );
-    X->p = (mbedtls_mpi_uint *) p;
-}
-
-/*
- * Set an MPI to static value 1
- */
-static inline void ecp_mpi_set1( mbedtls_mpi *X )
-{
-    static mbedtls_mpi_uint one[] = { 1 };
-    X->s = 1;
-    X->n = 1;
-    X->p = one;
-}
-
-/*
- * Make group available from embedded constants
+ * Precomputed comb tables of the generators for ecp_mul_comb(), window of
+ * 6 bits. Generated by scripts/generate_ecp_comb_tables.pl, do not edit.
  */
-static int ecp_group_load( mbedtls_ecp_group *grp,
-                           const mbedtls_mpi_uint *p,  size_t plen,
-                           const mbedtls_mpi_uint *a,  size_t alen,
-                           const mbedtls_mpi_uint *b,  size_t blen,
-                           const mbedtls_mpi_uint *gx, size_t gxlen,
-                           const mbedtls_mpi_uint *gy, size_t gylen,
-                           const mbedtls_mpi_uint *n,  size_t nlen)
-{
-    ecp_mpi_load( &grp->P, p, plen );
-    if( a != NULL )
-        ecp_mpi_load( &grp->A, a, alen );
-    ecp_mpi_load( &grp->B, b, blen );
-    ecp_mpi_load( &grp->N, n, nlen );
-
-    ecp_mpi_load( &grp->G.X, gx, gxlen );
-    ecp_mpi_load( &grp->G.Y, gy, gylen );
-    ecp_mpi_set1( &grp->G.Z );
-
-    grp->pbits = mbedtls_mpi_bitlen( &grp->P );
-    grp->nbits = mbedtls_mpi_bitlen( &grp->N );
-
-    grp->h = 1;
-
-    return( 0 );
-}
+#if MBEDTLS_ECP_FIXED_POINT_OPTIM == 1
+
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+#define ECP_POINT_INIT_XY( X, Y )                                             \
+    { { 1, sizeof( X ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) X,  \
+        NULL },                                                               \
+      { 1, sizeof( Y ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) Y,  \
+        NULL },                                                               \
+      { 0, 0, NULL, NULL } }
+#else
+#define ECP_POINT_INIT_XY( X, Y )                                             \
+    { { 1, sizeof( X ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) X }, \
+      { 1, sizeof( Y ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) Y }, \
+      { 0, 0, NULL } }
+#endif
 
-#if defined(MBEDTLS_ECP_NIST_OPTIM)
-/* Forward declarations */
 #if defined(MBEDTLS_ECP_DP_SECP192R1_ENABLED)
-static int ecp_mod_p192( mbedtls_mpi * );
-#endif
-#if defined(MBEDTLS_ECP_DP_SECP224R1_ENABLED)
-static int ecp_mod_p224( mbedtls_mpi * );
-#endif
-#if defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
-static int ecp_mod_p256( mbedtls_mpi * );
-#endif
-#if defined(MBEDTLS_ECP_DP_SECP384R1_ENABLED)
-static int ecp_mod_p384( mbedtls_mpi * );
-#endif
-#if defined(MBEDTLS_ECP_DP_SECP521R1_ENABLED)
-static int ecp_mod_p521( mbedtls_mpi * );
-#endif
+static const mbedtls_mpi_uint secp192r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x12, 0x10, 0xFF, 0x82, 0xFD, 0x0A, 0xFF, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x00, 0x88, 0xA1, 0x43, 0xEB, 0x20, 0xBF, 0x7C ),
+    BYTES_TO_T_UINT_8( 0xF6, 0x90, 0x30, 0xB0, 0x0E, 0xA8, 0x8D, 0x18 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x11, 0x48, 0x79, 0x1E, 0xA1, 0x77, 0xF9, 0x73 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0xCD, 0x24, 0x6B, 0xED, 0x11, 0x10, 0x63 ),
+    BYTES_TO_T_UINT_8( 0x78, 0xDA, 0xC8, 0xFF, 0x95, 0x2B, 0x19, 0x07 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0xDA, 0xF0, 0x2A, 0x88, 0xC9, 0x32, 0x48, 0x35 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x44, 0x35, 0xEF, 0x7F, 0xBC, 0x95, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x3B, 0xF1, 0x02, 0x74, 0x96, 0x1A, 0x57, 0xF1 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x13, 0x29, 0xA2, 0x4B, 0x99, 0xA8, 0x09, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0x86, 0xDF, 0x97, 0x73, 0x3E, 0xEA, 0xD3, 0x33 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x7B, 0x90, 0x49, 0xCD, 0xA1, 0x1C, 0x0D ),
+};
+static const mbedtls_mpi_uint secp192r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0xF4, 0xAC, 0x9F, 0x22, 0x09, 0xB9, 0xB0, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x1A, 0xA2, 0xA3, 0x5B, 0x47, 0xA8, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x1A, 0x76, 0x4C, 0xE0, 0xE6, 0xCD, 0xB0, 0xBD ),
+};
+static const mbedtls_mpi_uint secp192r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x74, 0xCE, 0x6F, 0x07, 0xF3, 0xAB, 0x5A, 0xBA ),
+    BYTES_TO_T_UINT_8( 0x25, 0x8E, 0xC5, 0x3F, 0x57, 0x39, 0x84, 0x6E ),
+    BYTES_TO_T_UINT_8( 0x14, 0xA1, 0xDD, 0xB9, 0x55, 0xCC, 0x21, 0x7A ),
+};
+static const mbedtls_mpi_uint secp192r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x40, 0xE2, 0xA9, 0x5F, 0xA3, 0x2A, 0xDD, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x7B, 0xEA, 0x4E, 0x85, 0xFC, 0xDB, 0x28, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x97, 0xBB, 0xE0, 0x4A, 0xEC, 0x7A, 0x8B, 0x8F ),
+};
+static const mbedtls_mpi_uint secp192r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4A, 0x03, 0xCB, 0xB6, 0x88, 0x93, 0xBE, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x01, 0x59, 0xE7, 0x31, 0x7D, 0x08, 0x94, 0x95 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0x7D, 0xB2, 0x6D, 0x67, 0x34, 0x67, 0xC8 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0x74, 0x33, 0xF4, 0xD4, 0x2D, 0x5A, 0xB1, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0x41, 0xC3, 0x92, 0xF2, 0xA7, 0xEE, 0x57, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x24, 0xDC, 0xF8, 0xD0, 0x91, 0x06, 0x73, 0x0C ),
+};
+static const mbedtls_mpi_uint secp192r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0x00, 0x5E, 0xF4, 0xBB, 0x90, 0x78, 0x79, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x08, 0x87, 0xDE, 0xE9, 0x83, 0x9E, 0x8A, 0x00 ),
+    BYTES_TO_T_UINT_8( 0x3E, 0xDE, 0x54, 0x93, 0x31, 0x4C, 0xB2, 0x31 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x8D, 0xD8, 0xAE, 0x37, 0xAF, 0x34, 0xD8, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x64, 0xEF, 0xB4, 0x8B, 0xB1, 0x59, 0xE2, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0xC5, 0xF2, 0xA2, 0xA2, 0xE0, 0xAB, 0x0E, 0x48 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0x13, 0x95, 0xB4, 0x9A, 0xE3, 0x37, 0xC3, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0x7C, 0x1A, 0x67, 0x9B, 0xDC, 0xCD, 0x7C ),
+    BYTES_TO_T_UINT_8( 0xEA, 0x2E, 0xB3, 0x79, 0x84, 0x7B, 0x15, 0xC2 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0xDC, 0xCC, 0x25, 0x3B, 0xCB, 0x11, 0xCC, 0x40 ),
+    BYTES_TO_T_UINT_8( 0xEB, 0xEC, 0xCC, 0xBE, 0xD1, 0x43, 0x24, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xD7, 0x89, 0x09, 0xB3, 0x81, 0xB4, 0x83, 0x72 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0x34, 0xFF, 0xE9, 0xDC, 0xBB, 0x45, 0xF5, 0x4B ),
+    BYTES_TO_T_UINT_8( 0xA9, 0xBC, 0x73, 0x68, 0x89, 0x20, 0xFD, 0x85 ),
+    BYTES_TO_T_UINT_8( 0x80, 0x6B, 0x2F, 0x63, 0x70, 0xE1, 0xEE, 0x0E ),
+};
+static const mbedtls_mpi_uint secp192r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0x14, 0x21, 0x1E, 0x85, 0x49, 0x0B, 0x98, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x5E, 0xEC, 0x50, 0x96, 0xF1, 0xA3, 0xD0, 0x9F ),
+    BYTES_TO_T_UINT_8( 0x8A, 0xD3, 0x8D, 0x80, 0xE9, 0xBE, 0x74, 0x3B ),
+};
+static const mbedtls_mpi_uint secp192r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x53, 0x7C, 0xCB, 0x14, 0x41, 0xA5, 0x00, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x44, 0xAE, 0x59, 0xE1, 0xB2, 0x56, 0x42, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x20, 0x1F, 0x10, 0x3D, 0x4F, 0xAD, 0xE4 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x0F, 0xD9, 0xA9, 0x69, 0x79, 0x1B, 0xC0, 0xD0 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0x0F, 0xFB, 0x1F, 0x9C, 0x55, 0x22, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x4B, 0x35, 0xEA, 0x0F, 0xAE, 0x3A, 0x2B, 0x22 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0x0C, 0x43, 0xB8, 0x71, 0xE7, 0xE4, 0xB9, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x24, 0x7F, 0x9F, 0x71, 0x03, 0x7D, 0x00, 0x8C ),
+    BYTES_TO_T_UINT_8( 0x75, 0x10, 0xBA, 0x7E, 0x0A, 0x10, 0xB5, 0x02 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0xAA, 0x60, 0xD1, 0xE3, 0xB1, 0xC9, 0x6C, 0x07 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x8F, 0x85, 0x66, 0xD3, 0x6F, 0x6B, 0x69 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x72, 0xEB, 0x44, 0x94, 0x32, 0xCD, 0xE1 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF6, 0x66, 0x9C, 0x5D, 0x28, 0x0A, 0x7F, 0x4D ),
+    BYTES_TO_T_UINT_8( 0x97, 0x1D, 0xF6, 0x07, 0x28, 0xD6, 0x23, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x0B, 0x1D, 0x28, 0xA0, 0xAC, 0xB3, 0x87, 0x40 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0xC8, 0xDF, 0xCE, 0xD6, 0x9A, 0x75, 0x3E, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xBD, 0x5E, 0xFE, 0x6C, 0xB6, 0x29, 0x39 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0xDC, 0x8F, 0x59, 0xCC, 0x52, 0x4B, 0xC2 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x63, 0x42, 0x15, 0x88, 0xD8, 0xDC, 0x33, 0x9C ),
+    BYTES_TO_T_UINT_8( 0xD6, 0xE7, 0x57, 0x58, 0xED, 0xF9, 0x8B, 0x19 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0xDF, 0xF8, 0xF2, 0xA7, 0x6C, 0xF1, 0x6F ),
+};
+static const mbedtls_mpi_uint secp192r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0x1C, 0x27, 0xB3, 0x30, 0x33, 0xF6, 0x40, 0xD0 ),
+    BYTES_TO_T_UINT_8( 0x40, 0xDC, 0x8F, 0xEB, 0x1C, 0x1C, 0x9A, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x1B, 0xCD, 0x12, 0x76, 0x31, 0x51, 0x33 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0x0D, 0x22, 0x11, 0x02, 0x55, 0xA0, 0x77, 0xAB ),
+    BYTES_TO_T_UINT_8( 0xA3, 0x58, 0x99, 0xEF, 0x5F, 0xBD, 0x1A, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0x10, 0x2C, 0xCD, 0xB9, 0xAB, 0x6B, 0x32 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0x69, 0x32, 0xD9, 0xA5, 0x81, 0x79, 0x18, 0x69 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x9B, 0xCA, 0x4C, 0xC6, 0x0B, 0x95, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x77, 0x2B, 0x4F, 0xE1, 0x07, 0x6D, 0xF8, 0x07 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0x03, 0xCE, 0x1D, 0x2E, 0x9D, 0xB7, 0x77, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x0F, 0x81, 0x3E, 0xD0, 0xCF, 0x3A, 0xA3, 0x8A ),
+    BYTES_TO_T_UINT_8( 0x03, 0x57, 0x66, 0x57, 0x87, 0xD4, 0xAE, 0x16 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x16, 0x23, 0xEC, 0x7C, 0xAA, 0x66, 0xF0, 0xCC ),
+    BYTES_TO_T_UINT_8( 0x60, 0x12, 0xE7, 0xB9, 0x1A, 0x9E, 0x9E, 0x60 ),
+    BYTES_TO_T_UINT_8( 0x89, 0x93, 0x63, 0x0D, 0xA7, 0x37, 0xF9, 0x37 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0x89, 0x60, 0x70, 0x0C, 0xE2, 0x46, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0x3A, 0xC9, 0x17, 0x50, 0xE6, 0xC1, 0xFE, 0x5E ),
+    BYTES_TO_T_UINT_8( 0x66, 0xD0, 0xFC, 0xE6, 0x33, 0xD4, 0x02, 0x06 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x83, 0xD4, 0x96, 0x3A, 0xE9, 0x3B, 0x76, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0x74, 0xC4, 0x8D, 0x00, 0xCD, 0x82, 0xEE, 0x6E ),
+    BYTES_TO_T_UINT_8( 0xDE, 0xD2, 0x37, 0x00, 0x35, 0x9C, 0xBB, 0xE4 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0x91, 0x77, 0x01, 0x26, 0x36, 0x99, 0xA2, 0x0E ),
+    BYTES_TO_T_UINT_8( 0x0F, 0xA7, 0xCB, 0xEC, 0x10, 0xA0, 0xE4, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x54, 0x07, 0xF6, 0xAC, 0x93, 0xE4, 0x6E, 0x16 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0xC0, 0x00, 0xD7, 0x4A, 0x95, 0x62, 0x16, 0x54 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0x90, 0xA4, 0x59, 0x7F, 0xF6, 0xB6, 0xDE ),
+    BYTES_TO_T_UINT_8( 0x49, 0xE9, 0xD8, 0xB2, 0xF5, 0x2C, 0x0F, 0x0A ),
+};
+static const mbedtls_mpi_uint secp192r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0x20, 0x74, 0xC4, 0xF7, 0xD7, 0xB2, 0x9E, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x07, 0x6F, 0xC1, 0xD3, 0x87, 0xA3, 0x3C, 0x66 ),
+    BYTES_TO_T_UINT_8( 0x72, 0x03, 0x64, 0x43, 0x8C, 0x82, 0x45, 0x8B ),
+};
+static const mbedtls_mpi_uint secp192r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x86, 0x0A, 0x9B, 0xCC, 0x62, 0x2E, 0x12, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xD9, 0xAA, 0xBA, 0x2B, 0x98, 0x53, 0xAF, 0xAD ),
+    BYTES_TO_T_UINT_8( 0xD1, 0xB9, 0x92, 0x94, 0xCF, 0x33, 0x7D, 0x51 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0x20, 0x66, 0xED, 0x9D, 0x3D, 0xFD, 0xE2, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x4F, 0xDD, 0xE4, 0x3D, 0x2E, 0x89, 0xCA, 0x9C ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x2B, 0x32, 0x2B, 0xBF, 0x43, 0x2C, 0xEB ),
+};
+static const mbedtls_mpi_uint secp192r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x44, 0xC9, 0x72, 0x2E, 0xF6, 0x5C, 0xF0, 0x89 ),
+    BYTES_TO_T_UINT_8( 0xA3, 0xDC, 0x5B, 0x12, 0xE1, 0xC2, 0xF6, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x1A, 0x50, 0x11, 0x6A, 0xF2, 0xA7, 0x0F ),
+};
+static const mbedtls_mpi_uint secp192r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0x11, 0x6D, 0x98, 0xBB, 0x58, 0x86, 0x4C, 0x75 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x62, 0xBD, 0x43, 0x5C, 0xCA, 0x81, 0xAF ),
+    BYTES_TO_T_UINT_8( 0x08, 0x8A, 0xA0, 0x51, 0x46, 0xB5, 0x40, 0x46 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0xD3, 0x31, 0xE6, 0x24, 0x59, 0xC9, 0x64 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0xB7, 0x0D, 0xC3, 0xFB, 0xB8, 0x8F, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x45, 0x06, 0x12, 0x46, 0x91, 0x01, 0x60, 0xD4 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0xE8, 0xD4, 0x5A, 0x91, 0xD1, 0xE6, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0x27, 0x3D, 0x87, 0x7D, 0xF1, 0x30, 0x13, 0x5F ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x15, 0x2C, 0xA5, 0x29, 0x07, 0xCC, 0x23 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0x9A, 0x28, 0x3C, 0xB2, 0xD6, 0x38, 0x4A, 0xEA ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x8B, 0x4C, 0x95, 0x9A, 0xA7, 0x68, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xB0, 0xDD, 0xC4, 0xA4, 0xF6, 0x16, 0x0D, 0x75 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF8, 0x54, 0xD3, 0x7C, 0xAD, 0x19, 0x2D, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0xEE, 0xF3, 0xF6, 0x65, 0xE3, 0xE4, 0xD8, 0x92 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0xBF, 0x56, 0xCF, 0x3A, 0xB3, 0x78, 0x7F ),
+};
+static const mbedtls_mpi_uint secp192r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x28, 0x6F, 0xCD, 0xE8, 0xC9, 0xB3, 0xC7, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x41, 0x02, 0x8A, 0xE2, 0xCE, 0x93, 0xED, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x15, 0x17, 0xEF, 0xCC, 0x1F, 0x46, 0x39, 0x9D ),
+};
+static const mbedtls_mpi_uint secp192r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4E, 0x40, 0x2F, 0xEB, 0x79, 0x73, 0x91, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x83, 0xEC, 0xC5, 0x9E, 0xE8, 0x3D, 0x1E ),
+    BYTES_TO_T_UINT_8( 0x0A, 0xB4, 0x25, 0xA4, 0x61, 0xD4, 0x8D, 0xE4 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0x26, 0x5B, 0xAB, 0xA7, 0xFE, 0x08, 0x24, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x30, 0x5D, 0xE8, 0xC9, 0x39, 0xFD, 0xD1, 0x4C ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x0A, 0x2A, 0x60, 0xED, 0x4A, 0xA3, 0x8A ),
+};
+static const mbedtls_mpi_uint secp192r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE8, 0x39, 0xAC, 0xD1, 0xD2, 0xF9, 0x8F, 0x26 ),
+    BYTES_TO_T_UINT_8( 0xA2, 0xC6, 0x5B, 0x53, 0x3C, 0xC3, 0x0B, 0x18 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x79, 0x85, 0xF7, 0xF4, 0x0C, 0x61, 0xE7 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0xDF, 0x4C, 0x2B, 0xC3, 0x84, 0x3F, 0xA9, 0x57 ),
+    BYTES_TO_T_UINT_8( 0xA8, 0x00, 0x58, 0x6F, 0xAF, 0xB2, 0x58, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x90, 0xD9, 0x66, 0x0F, 0xC6, 0x92, 0xA3 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x3D, 0x81, 0x42, 0x03, 0xEC, 0x37, 0x68, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xCA, 0x9E, 0x55, 0x61, 0x10, 0xD5, 0x27, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xF2, 0x72, 0x08, 0xC9, 0x30, 0xF7, 0x48 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x7C, 0xE5, 0xA2, 0x1E, 0x70, 0x08, 0xEC, 0x43 ),
+    BYTES_TO_T_UINT_8( 0xC3, 0x1A, 0xAD, 0x27, 0x39, 0xEB, 0x29, 0xFC ),
+    BYTES_TO_T_UINT_8( 0x61, 0x81, 0xCC, 0x59, 0x09, 0xB4, 0xE8, 0xF2 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x75, 0x36, 0xE4, 0xBE, 0xC4, 0xA4, 0xE5, 0xF7 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x39, 0x17, 0x0E, 0xA7, 0xC7, 0x16, 0xF3 ),
+    BYTES_TO_T_UINT_8( 0x78, 0x89, 0x4B, 0xF3, 0x28, 0x1C, 0xAF, 0x93 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0xCE, 0xF4, 0x36, 0xCE, 0x03, 0x41, 0x76, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0xD7, 0x7D, 0x5E, 0x2C, 0x8F, 0xE1, 0x61 ),
+    BYTES_TO_T_UINT_8( 0x9C, 0xD5, 0x51, 0xC0, 0xD9, 0x59, 0x45, 0x43 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x29, 0xED, 0x52, 0xD6, 0x2C, 0x41, 0x7C, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0xF8, 0xD5, 0x80, 0xDE, 0xD5, 0x5D, 0x48, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0xD0, 0x8E, 0x10, 0x0E, 0x24, 0x96, 0x56 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x2B, 0x1A, 0xBA, 0xD7, 0x80, 0xAE, 0xA7, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x70, 0x4D, 0x4B, 0x0D, 0xA7, 0xF4, 0x34, 0x4E ),
+    BYTES_TO_T_UINT_8( 0x2D, 0x1D, 0x1A, 0xE7, 0xD5, 0xF9, 0x20, 0xF8 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDB, 0xA1, 0xD5, 0xB1, 0x57, 0xCC, 0x1D, 0x6A ),
+    BYTES_TO_T_UINT_8( 0x88, 0x81, 0x9B, 0xC8, 0xE4, 0xD0, 0x16, 0xFA ),
+    BYTES_TO_T_UINT_8( 0x5C, 0x42, 0x8C, 0x49, 0x76, 0x47, 0x24, 0xEE ),
+};
+static const mbedtls_mpi_uint secp192r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0xD6, 0x54, 0xFA, 0x6A, 0x19, 0x2B, 0xA8, 0xDD ),
+    BYTES_TO_T_UINT_8( 0x06, 0xE3, 0xD2, 0xC2, 0xC8, 0xC2, 0x22, 0x92 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x70, 0x20, 0xA5, 0x29, 0x1D, 0xBF, 0xEE ),
+};
+static const mbedtls_mpi_uint secp192r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0x7F, 0xBA, 0x66, 0x36, 0xC0, 0xA5, 0x48 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x51, 0x49, 0x1E, 0x7C, 0x2B, 0xE4, 0xC1 ),
+    BYTES_TO_T_UINT_8( 0x34, 0x29, 0xE0, 0x27, 0xD1, 0x8E, 0xB8, 0xD6 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0x88, 0xE7, 0x6A, 0xB3, 0xD2, 0x78, 0xAE, 0x51 ),
+    BYTES_TO_T_UINT_8( 0x06, 0x90, 0x9C, 0xB1, 0x77, 0x4E, 0x38, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xF2, 0xAA, 0x19, 0x04, 0x4E, 0x08, 0x78, 0xEA ),
+};
+static const mbedtls_mpi_uint secp192r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0x61, 0xB9, 0x22, 0x8D, 0xC0, 0xF1, 0x9C, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0x6C, 0x9D, 0xB3, 0x71, 0x8F, 0x4D, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x37, 0x70, 0x50, 0x7A, 0x4E, 0x5D, 0x61, 0x11 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x53, 0xAA, 0xF6, 0x82, 0x25, 0xD6, 0xC7, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xC7, 0xB5, 0x11, 0x7C, 0xBF, 0xA8, 0x62, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x11, 0x0C, 0x82, 0x22, 0x83, 0x97, 0x49, 0x87 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA1, 0x53, 0x43, 0x06, 0xDC, 0x77, 0xAD, 0x3D ),
+    BYTES_TO_T_UINT_8( 0x96, 0x92, 0xAB, 0xD1, 0x6F, 0x66, 0xC4, 0x4F ),
+    BYTES_TO_T_UINT_8( 0x18, 0x44, 0x8F, 0x4B, 0x4C, 0x03, 0x3E, 0xA5 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0x38, 0xD3, 0x82, 0x2B, 0xC6, 0x1E, 0xC3, 0x53 ),
+    BYTES_TO_T_UINT_8( 0x1B, 0x8C, 0x1F, 0xE1, 0xA5, 0x7C, 0x4E, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0x9E, 0xAC, 0xF8, 0x1D, 0xAE, 0xE4, 0xDA, 0x73 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFB, 0x54, 0xDE, 0x13, 0x96, 0x04, 0xDB, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0x77, 0x73, 0xAD, 0x24, 0x7B, 0xCB, 0x4F, 0xE0 ),
+    BYTES_TO_T_UINT_8( 0xA5, 0xEF, 0x78, 0x4C, 0x4E, 0x8C, 0x64, 0x84 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0xDE, 0x17, 0xF0, 0x1B, 0xC0, 0x10, 0xCB, 0x79 ),
+    BYTES_TO_T_UINT_8( 0x19, 0x36, 0x06, 0x65, 0x26, 0x87, 0x2C, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x92, 0x40, 0x1C, 0xDA, 0x59, 0x72, 0xEC, 0x68 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x0C, 0xB9, 0x88, 0x01, 0xE8, 0x0A, 0x5B, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x50, 0xCC, 0x7E, 0xA9, 0x68, 0xCC, 0xC7, 0x08 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x59, 0x76, 0x9C, 0xC3, 0x6F, 0x5E, 0x74 ),
+};
+static const mbedtls_mpi_uint secp192r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0x42, 0xC9, 0xA7, 0x94, 0x9B, 0x72, 0xCD, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x5B, 0x10, 0x53, 0x82, 0x3E, 0xE9, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x78, 0x07, 0xEB, 0x99, 0x89, 0xA3, 0x82, 0x7F ),
+};
+static const mbedtls_mpi_uint secp192r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA0, 0x23, 0x78, 0xD1, 0xF6, 0x8B, 0x3A, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x79, 0xCA, 0xF9, 0x11, 0x10, 0x0B, 0x8A, 0xFF ),
+    BYTES_TO_T_UINT_8( 0xDD, 0xA1, 0xF8, 0x47, 0xBC, 0xC0, 0x1A, 0xA0 ),
+};
+static const mbedtls_ecp_point secp192r1_T[32] = {
+    ECP_POINT_INIT_XY( secp192r1_T_0_X, secp192r1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_1_X, secp192r1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_2_X, secp192r1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_3_X, secp192r1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_4_X, secp192r1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_5_X, secp192r1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_6_X, secp192r1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_7_X, secp192r1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_8_X, secp192r1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_9_X, secp192r1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_10_X, secp192r1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_11_X, secp192r1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_12_X, secp192r1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_13_X, secp192r1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_14_X, secp192r1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_15_X, secp192r1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_16_X, secp192r1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_17_X, secp192r1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_18_X, secp192r1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_19_X, secp192r1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_20_X, secp192r1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_21_X, secp192r1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_22_X, secp192r1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_23_X, secp192r1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_24_X, secp192r1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_25_X, secp192r1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_26_X, secp192r1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_27_X, secp192r1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_28_X, secp192r1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_29_X, secp192r1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_30_X, secp192r1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp192r1_T_31_X, secp192r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP192R1_ENABLED */
 
-#define NIST_MODP( P )      grp->modp = ecp_mod_ ## P;
-#else
-#define NIST_MODP( P )
-#endif /* MBEDTLS_ECP_NIST_OPTIM */
+#if defined(MBEDTLS_ECP_DP_SECP224R1_ENABLED)
+static const mbedtls_mpi_uint secp224r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x21, 0x1D, 0x5C, 0x11, 0xD6, 0x80, 0x32, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x22, 0x11, 0xC2, 0x56, 0xD3, 0xC1, 0x03, 0x4A ),
+    BYTES_TO_T_UINT_8( 0xB9, 0x90, 0x13, 0x32, 0x7F, 0xBF, 0xB4, 0x6B ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x0C, 0x0E, 0xB7, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x34, 0x7E, 0x00, 0x85, 0x99, 0x81, 0xD5, 0x44 ),
+    BYTES_TO_T_UINT_8( 0x64, 0x47, 0x07, 0x5A, 0xA0, 0x75, 0x43, 0xCD ),
+    BYTES_TO_T_UINT_8( 0xE6, 0xDF, 0x22, 0x4C, 0xFB, 0x23, 0xF7, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x88, 0x63, 0x37, 0xBD, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0xC3, 0x67, 0xE2, 0x08, 0xC5, 0x81, 0x97, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x3A, 0xAE, 0xE6, 0xF5, 0xE2, 0xAA, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x23, 0xF6, 0xCB, 0x78, 0x90, 0xA7, 0x32, 0x6A ),
+    BYTES_TO_T_UINT_8( 0x27, 0xBA, 0xDA, 0xE6, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9F, 0xB2, 0x3F, 0xCC, 0xA2, 0xC9, 0x61, 0xF0 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x1F, 0xCB, 0x2F, 0x34, 0x23, 0xB7, 0x00 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0xE0, 0xEB, 0x82, 0x46, 0xE3, 0x33, 0x5A ),
+    BYTES_TO_T_UINT_8( 0x87, 0x7B, 0x80, 0xE8, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0x8A, 0x0C, 0xF0, 0xA8, 0x5F, 0x91, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x22, 0x88, 0x17, 0x90, 0xC2, 0xB9, 0x07, 0x1C ),
+    BYTES_TO_T_UINT_8( 0x27, 0x06, 0xCF, 0x7A, 0xC3, 0x40, 0x4F, 0x91 ),
+    BYTES_TO_T_UINT_8( 0x51, 0xDC, 0x6C, 0xCB, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x04, 0x35, 0xE1, 0xB4, 0x97, 0x61, 0xE2, 0x98 ),
+    BYTES_TO_T_UINT_8( 0xDE, 0xFB, 0x25, 0x6B, 0xEF, 0x26, 0xAD, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xCB, 0x93, 0x8C, 0xFA, 0xE4, 0x22, 0x68 ),
+    BYTES_TO_T_UINT_8( 0xB7, 0xC0, 0x17, 0x03, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x75, 0xEB, 0x81, 0x9D, 0x77, 0x22, 0xBE, 0x67 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0xA9, 0xC0, 0x3E, 0xCE, 0x7B, 0x39, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x72, 0x11, 0x29, 0xFE, 0x68, 0x32, 0x76, 0x5B ),
+    BYTES_TO_T_UINT_8( 0xDB, 0xC2, 0xE4, 0x59, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0x48, 0xD9, 0x2E, 0x68, 0x38, 0x85, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0x71, 0x3D, 0x01, 0x8A, 0xD4, 0xCC, 0x88, 0x4E ),
+    BYTES_TO_T_UINT_8( 0x68, 0xD2, 0x83, 0x08, 0xA4, 0x24, 0x41, 0xAB ),
+    BYTES_TO_T_UINT_8( 0x67, 0xEB, 0x53, 0xB0, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0xF8, 0xE0, 0x7C, 0x43, 0x89, 0x2D, 0x34, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x03, 0xF6, 0x4B, 0xFC, 0xBB, 0xF5, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x01, 0x61, 0x5D, 0x29, 0xDF, 0x4B, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xE7, 0x33, 0x8F, 0x95, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF9, 0x33, 0x88, 0x01, 0xEB, 0xD5, 0xD4, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0xF3, 0x76, 0x6D, 0xB7, 0xC7, 0x8A, 0xCD, 0x08 ),
+    BYTES_TO_T_UINT_8( 0x25, 0xC0, 0xBD, 0xF5, 0x66, 0x96, 0x46, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0x99, 0x08, 0x9E, 0xC9, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0x65, 0x57, 0x2F, 0x88, 0x21, 0x02, 0x6B ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x1D, 0x5D, 0xCC, 0x7A, 0x00, 0x6D, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xBC, 0xE2, 0x34, 0xF6, 0x95, 0x35, 0x6D, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0xCE, 0x5F, 0x1D, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC3, 0x86, 0xD5, 0x9F, 0x60, 0x77, 0x49, 0x22 ),
+    BYTES_TO_T_UINT_8( 0xA9, 0x75, 0xFE, 0xB2, 0xA7, 0x39, 0x47, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x00, 0xB1, 0x16, 0x06, 0x20, 0x58, 0xF8, 0x89 ),
+    BYTES_TO_T_UINT_8( 0x17, 0xA8, 0xBC, 0xDB, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0x01, 0xF6, 0x79, 0xFD, 0x74, 0x1C, 0xC7, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x8B, 0x05, 0x32, 0x11, 0x9A, 0xA0, 0x39, 0x0F ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x37, 0x02, 0x0F, 0x60, 0x2C, 0x24, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x7E, 0xF7, 0x26, 0x18, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC5, 0x72, 0xAA, 0xE8, 0x0B, 0x7B, 0xA4, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x62, 0x6C, 0x86, 0x48, 0x26, 0x76, 0xF7, 0x49 ),
+    BYTES_TO_T_UINT_8( 0x4A, 0x41, 0x20, 0x80, 0x8C, 0x54, 0xD3, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x08, 0x08, 0xA8, 0x5C, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0xCC, 0x1F, 0x05, 0x47, 0x9A, 0xC8, 0x8E, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xAD, 0xCF, 0x36, 0x54, 0xC7, 0x6E, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x21, 0xC0, 0xD4, 0xB5, 0xCB, 0xE0, 0x71, 0x26 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x32, 0x8E, 0x1D, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x70, 0x7E, 0xF1, 0xD9, 0x8A, 0x36, 0x04, 0x33 ),
+    BYTES_TO_T_UINT_8( 0x03, 0xDA, 0xCC, 0x84, 0x2A, 0x3D, 0x4A, 0x5E ),
+    BYTES_TO_T_UINT_8( 0x65, 0xAE, 0x1E, 0x3B, 0x52, 0xFA, 0x06, 0x19 ),
+    BYTES_TO_T_UINT_8( 0x40, 0x38, 0x37, 0x1E, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0xC3, 0x67, 0xFC, 0xCD, 0x95, 0x73, 0x6B, 0xDA ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x81, 0x78, 0x4C, 0x83, 0xB5, 0xA9, 0x53 ),
+    BYTES_TO_T_UINT_8( 0xD3, 0x4A, 0x2C, 0x73, 0xA3, 0x92, 0xEC, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xE9, 0x06, 0x65, 0x2B, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD9, 0x8A, 0x2E, 0x30, 0xCB, 0xE3, 0x5A, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x2D, 0x52, 0x29, 0xAA, 0x0B, 0x55, 0x97, 0x99 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0xE1, 0xB9, 0xB6, 0xA3, 0x39, 0x9B, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x11, 0xE8, 0x05, 0xEE, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0xB8, 0x98, 0xF4, 0x7A, 0x5F, 0xF7, 0x07, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x04, 0xAF, 0x89, 0xF1, 0x88, 0x09, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x96, 0xCB, 0x6F, 0x8D, 0xA7, 0x86, 0x55, 0xAB ),
+    BYTES_TO_T_UINT_8( 0x2F, 0x4A, 0x3D, 0xF4, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0x48, 0xE8, 0xEB, 0x6F, 0x23, 0xB6, 0xF2, 0x76 ),
+    BYTES_TO_T_UINT_8( 0x34, 0x30, 0x3B, 0x0B, 0xF4, 0x48, 0x8E, 0x47 ),
+    BYTES_TO_T_UINT_8( 0x60, 0xE8, 0xBE, 0x7F, 0xA4, 0xBC, 0x1B, 0x72 ),
+    BYTES_TO_T_UINT_8( 0x0F, 0xC6, 0xEC, 0x88, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0x3B, 0x32, 0x21, 0x2F, 0xA7, 0x0F, 0x6E, 0x88 ),
+    BYTES_TO_T_UINT_8( 0x81, 0xB0, 0x3E, 0x9D, 0x77, 0xAA, 0x83, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x0A, 0x29, 0x83, 0xC3, 0x36, 0x11, 0x41, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x69, 0xCE, 0xD3, 0xF7, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x5B, 0x2C, 0x06, 0x07, 0xA3, 0x0A, 0xA7, 0x4E ),
+    BYTES_TO_T_UINT_8( 0xC3, 0xA8, 0x1A, 0x03, 0xD1, 0x7F, 0x04, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x65, 0x6E, 0x6F, 0x2F, 0x5E, 0x82, 0xA5, 0x8A ),
+    BYTES_TO_T_UINT_8( 0x54, 0x35, 0xF6, 0x6C, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0x53, 0x8C, 0x56, 0x12, 0xA3, 0xCC, 0x84, 0x12 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x91, 0x11, 0x71, 0xC5, 0x5A, 0xDC, 0x54 ),
+    BYTES_TO_T_UINT_8( 0xF9, 0x52, 0x10, 0x5F, 0x06, 0x4F, 0x29, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0xEC, 0x4D, 0x4E, 0x0D, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC9, 0xFF, 0x2F, 0xAF, 0x14, 0xEA, 0xFA, 0x8B ),
+    BYTES_TO_T_UINT_8( 0xF8, 0x56, 0xB8, 0x52, 0x38, 0xEC, 0xBC, 0xEE ),
+    BYTES_TO_T_UINT_8( 0x56, 0x66, 0xF2, 0xA8, 0xF6, 0xA1, 0xD8, 0x75 ),
+    BYTES_TO_T_UINT_8( 0xB9, 0xBA, 0x78, 0x19, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0x70, 0xB7, 0x68, 0x9D, 0xB6, 0xEE, 0x19, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0x20, 0x9B, 0xD0, 0x2E, 0x06, 0x11, 0xAD, 0x67 ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x77, 0x88, 0x5B, 0xC2, 0x8F, 0x0B, 0x06 ),
+    BYTES_TO_T_UINT_8( 0x59, 0xF2, 0xA8, 0x5F, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0x10, 0xE1, 0xF9, 0x50, 0x6E, 0xC4, 0x3B, 0x8B ),
+    BYTES_TO_T_UINT_8( 0x0E, 0x91, 0xD1, 0xB1, 0x85, 0x90, 0x08, 0x33 ),
+    BYTES_TO_T_UINT_8( 0x34, 0x64, 0x51, 0xF0, 0xA7, 0x10, 0x9D, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x7E, 0x18, 0xCF, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x3E, 0x0A, 0x8A, 0xDB, 0x55, 0x03, 0xEC, 0x7D ),
+    BYTES_TO_T_UINT_8( 0xBB, 0x06, 0xE8, 0x83, 0x96, 0x6E, 0x0B, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x1E, 0xD7, 0x8D, 0x25, 0x5E, 0x2F, 0x69, 0xD9 ),
+    BYTES_TO_T_UINT_8( 0x98, 0xB0, 0x2B, 0x80, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x0E, 0x57, 0x6D, 0xCB, 0xD7, 0xFC, 0xA4, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0x95, 0x80, 0x48, 0xB3, 0xE8, 0x4B, 0xFA, 0x54 ),
+    BYTES_TO_T_UINT_8( 0xA6, 0xB6, 0x29, 0x58, 0xC9, 0xB4, 0x83, 0x10 ),
+    BYTES_TO_T_UINT_8( 0x94, 0x7B, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x07, 0xA3, 0x92, 0xBF, 0x6F, 0x9E, 0x81, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x00, 0x39, 0x79, 0xC1, 0x69, 0xE5, 0x74, 0x80 ),
+    BYTES_TO_T_UINT_8( 0x20, 0x17, 0xF3, 0xA4, 0x0B, 0x78, 0x21, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x13, 0xCC, 0xE8, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF3, 0x2C, 0x5B, 0x95, 0x64, 0x0F, 0x6B, 0x8A ),
+    BYTES_TO_T_UINT_8( 0x43, 0xCC, 0xE6, 0x58, 0x9E, 0xB3, 0xFB, 0x57 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xD1, 0xF3, 0x4E, 0x28, 0x98, 0xC6, 0xB4 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x6F, 0x93, 0xDF, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0x66, 0x3D, 0x11, 0x69, 0x3B, 0x48, 0xE1, 0x44 ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x1A, 0xE2, 0xC5, 0xD1, 0x34, 0x0F, 0x95 ),
+    BYTES_TO_T_UINT_8( 0x55, 0xA7, 0xCF, 0x7C, 0x77, 0x38, 0x2D, 0xC2 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0xCF, 0x55, 0x79, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0x97, 0x41, 0x25, 0x4B, 0x28, 0x3C, 0x71, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x2C, 0x87, 0xE8, 0xA8, 0x1E, 0x8E, 0x88, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x64, 0xEB, 0x06, 0x6D, 0xA9, 0x74, 0x90, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x44, 0x75, 0x0C, 0x9B, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0xFC, 0x1D, 0x7D, 0x40, 0x94, 0x81, 0xC9, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x95, 0xD9, 0x4F, 0x10, 0x44, 0xF4, 0x52, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0x60, 0x08, 0xE2, 0xBF, 0x2B, 0x45, 0xE0, 0x36 ),
+    BYTES_TO_T_UINT_8( 0x50, 0x33, 0x48, 0x45, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC8, 0x67, 0x2C, 0xC5, 0x87, 0x65, 0x05, 0x18 ),
+    BYTES_TO_T_UINT_8( 0xA2, 0xB5, 0xC0, 0xE4, 0xD1, 0x1E, 0x23, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x56, 0x6D, 0x8F, 0x72, 0xFC, 0x65, 0x68, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0xA3, 0x76, 0xB1, 0xF9, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x05, 0xF3, 0x36, 0x87, 0x0C, 0x5E, 0x34, 0x84 ),
+    BYTES_TO_T_UINT_8( 0xAA, 0x60, 0xCB, 0x04, 0xF4, 0x02, 0xEA, 0x70 ),
+    BYTES_TO_T_UINT_8( 0xB3, 0x9F, 0xFC, 0x79, 0x19, 0x2A, 0x0C, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xA6, 0x1B, 0x1D, 0x48, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4B, 0xC9, 0x92, 0xA3, 0x74, 0x5E, 0x86, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0x2A, 0x18, 0x15, 0xEF, 0xF7, 0x9D, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x6A, 0x59, 0xA0, 0x47, 0x5D, 0x14, 0x32, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xBC, 0x92, 0x21, 0x7F, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x16, 0x58, 0x8D, 0x97, 0xCD, 0x76, 0x66, 0x9D ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x0D, 0x08, 0xD4, 0x34, 0x62, 0x19, 0x51 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0x3E, 0xBF, 0x1B, 0xAE, 0xAD, 0x83, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x95, 0x89, 0x0A, 0x05, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0xF9, 0x25, 0x09, 0x10, 0xFE, 0x52, 0xF9 ),
+    BYTES_TO_T_UINT_8( 0x06, 0x90, 0x66, 0x58, 0xE4, 0x40, 0x1E, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x03, 0xE7, 0x82, 0x2E, 0x9B, 0xDB, 0x1C, 0x85 ),
+    BYTES_TO_T_UINT_8( 0xAE, 0xF1, 0x7E, 0x79, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0xEE, 0xBC, 0x1F, 0x3E, 0x44, 0x02, 0xA2, 0xDD ),
+    BYTES_TO_T_UINT_8( 0x45, 0x09, 0xE3, 0x6A, 0xC1, 0x79, 0x8F, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0x36, 0x3D, 0x0F, 0xDC, 0x54, 0xAB, 0xF2, 0x3A ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x0E, 0x18, 0xB3, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0x93, 0x31, 0xB5, 0x93, 0x3D, 0x26, 0xA5, 0x8F ),
+    BYTES_TO_T_UINT_8( 0x84, 0x53, 0xD9, 0x9C, 0x46, 0xEB, 0xF3, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xD6, 0xFD, 0xF2, 0xFB, 0x08, 0xAB, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x2E, 0xAD, 0xCC, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x46, 0x10, 0xFB, 0xF7, 0xDB, 0xB9, 0x3D, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x7E, 0x8B, 0x4C, 0x1C, 0x22, 0x50, 0xB3, 0x4A ),
+    BYTES_TO_T_UINT_8( 0xE1, 0x21, 0x15, 0x2D, 0xBA, 0x9D, 0x92, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0x44, 0x76, 0x41, 0xA7, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF0, 0xEE, 0xA6, 0x3F, 0x10, 0x5B, 0x60, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0xB0, 0x23, 0xFF, 0x16, 0x3A, 0x7A, 0xA9 ),
+    BYTES_TO_T_UINT_8( 0x84, 0x99, 0x4E, 0x07, 0x82, 0xF9, 0x37, 0xAC ),
+    BYTES_TO_T_UINT_8( 0x1F, 0x3F, 0xB1, 0x9B, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0x8C, 0xC3, 0x2C, 0xF7, 0xC1, 0x5D, 0xF7, 0xC7 ),
+    BYTES_TO_T_UINT_8( 0x92, 0x33, 0x4E, 0x4E, 0x8C, 0x7C, 0x6B, 0x19 ),
+    BYTES_TO_T_UINT_8( 0x29, 0xD2, 0xE8, 0x94, 0x4E, 0x93, 0xC5, 0x54 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0xFC, 0xA5, 0x4B, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD6, 0x16, 0x20, 0xE8, 0xBD, 0xCC, 0x8A, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xFD, 0x9E, 0xD7, 0x01, 0x89, 0x76, 0xA5, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x75, 0xA5, 0x41, 0xCB, 0x23, 0xB0, 0x75 ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x90, 0xEE, 0xC7, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0xF4, 0x8C, 0x2A, 0x5C, 0x5B, 0x0F, 0xE3, 0x4A ),
+    BYTES_TO_T_UINT_8( 0xD9, 0xEC, 0x96, 0x12, 0x8D, 0x35, 0x0D, 0x4C ),
+    BYTES_TO_T_UINT_8( 0xB2, 0x17, 0x4C, 0xB1, 0xB0, 0xED, 0x4F, 0xC5 ),
+    BYTES_TO_T_UINT_8( 0xDC, 0x30, 0xB5, 0xB0, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x89, 0xA5, 0xA1, 0x45, 0xFA, 0x89, 0xCF, 0x59 ),
+    BYTES_TO_T_UINT_8( 0x87, 0x69, 0xD8, 0xC2, 0x98, 0xBF, 0x7D, 0x21 ),
+    BYTES_TO_T_UINT_8( 0xED, 0xC5, 0xAD, 0xB5, 0x5E, 0xA3, 0xBF, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0x26, 0x8E, 0x92, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x3E, 0x41, 0x12, 0x46, 0x20, 0xBF, 0x5D, 0x54 ),
+    BYTES_TO_T_UINT_8( 0xCB, 0x4E, 0x84, 0xBB, 0x61, 0x29, 0x7C, 0x64 ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x03, 0x6D, 0x7E, 0x63, 0x6E, 0x2D, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x29, 0x73, 0xEE, 0x5E, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x3B, 0x75, 0x1B, 0xD4, 0xDD, 0xFD, 0xC7, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0x9D, 0xC7, 0xB3, 0x09, 0x0C, 0x47, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0xF1, 0xA8, 0xFD, 0x2A, 0x32, 0x45, 0xD1, 0x0F ),
+    BYTES_TO_T_UINT_8( 0x45, 0xDB, 0x5F, 0x2C, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0x63, 0x23, 0x07, 0x28, 0x3D, 0x19, 0x9F, 0x74 ),
+    BYTES_TO_T_UINT_8( 0x40, 0xB5, 0x1E, 0xBF, 0x48, 0x03, 0x6A, 0x7A ),
+    BYTES_TO_T_UINT_8( 0xD4, 0xFF, 0x16, 0xB5, 0x1D, 0x16, 0x15, 0x40 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0x4F, 0x86, 0xCB, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x7F, 0xE4, 0xFF, 0x85, 0x15, 0x41, 0x81, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x66, 0x31, 0x90, 0x5E, 0xD1, 0x40, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x5B, 0x31, 0xA6, 0xCD, 0x9B, 0xF5, 0xD2, 0xF0 ),
+    BYTES_TO_T_UINT_8( 0x44, 0x87, 0x90, 0x10, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0xD6, 0x0D, 0x55, 0xA8, 0x7A, 0x5F, 0x32, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x7E, 0x59, 0x1C, 0x03, 0x63, 0x3D, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0x92, 0xAF, 0x22, 0xF8, 0x38, 0xEF, 0x9D, 0x07 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0xC4, 0xA4, 0xB9, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD8, 0x7E, 0x95, 0x3D, 0x55, 0xF0, 0xAF, 0x33 ),
+    BYTES_TO_T_UINT_8( 0x08, 0xE4, 0x92, 0xB5, 0x95, 0xC7, 0x10, 0xCE ),
+    BYTES_TO_T_UINT_8( 0x1E, 0x2D, 0xE4, 0x83, 0x07, 0xF7, 0x5C, 0x80 ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x0A, 0x76, 0x58, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0x5D, 0x5A, 0xB5, 0xDE, 0x6E, 0xA6, 0x08, 0x91 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x85, 0x01, 0x2C, 0x8D, 0x8C, 0x46, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x69, 0x9E, 0x13, 0xAA, 0x27, 0xB3, 0xB1, 0x3C ),
+    BYTES_TO_T_UINT_8( 0x75, 0xEA, 0x3B, 0x9F, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0x23, 0x3D, 0x18, 0x0B, 0x51, 0x22, 0x96, 0x88 ),
+    BYTES_TO_T_UINT_8( 0xA9, 0x85, 0x7F, 0xCE, 0xDC, 0x00, 0x56, 0xBD ),
+    BYTES_TO_T_UINT_8( 0xEC, 0x07, 0x07, 0xC2, 0x70, 0x73, 0xFA, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x68, 0xC2, 0x1F, 0x03, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0xE0, 0x3A, 0x3C, 0xE3, 0xEB, 0xA9, 0xDA ),
+    BYTES_TO_T_UINT_8( 0xD4, 0x32, 0x05, 0xBB, 0x0F, 0xF0, 0x75, 0xAC ),
+    BYTES_TO_T_UINT_8( 0x78, 0xFD, 0x15, 0x7A, 0xCD, 0xF1, 0x75, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x58, 0xC5, 0x0F, 0x21, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDB, 0x64, 0x96, 0x4E, 0x19, 0xD0, 0xC9, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x61, 0x58, 0x0D, 0xEC, 0xAC, 0xE7, 0xC8, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xB7, 0x81, 0xE2, 0x75, 0xEA, 0xFF, 0x9E ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x95, 0x84, 0x04, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x0D, 0xD3, 0x1D, 0x9E, 0x57, 0xD7, 0xFA, 0x55 ),
+    BYTES_TO_T_UINT_8( 0xE9, 0xAC, 0xCD, 0xF9, 0x2A, 0x21, 0x9E, 0x81 ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x58, 0xD1, 0x0B, 0xDB, 0xBD, 0xA1, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x2E, 0x6E, 0xFC, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE8, 0x32, 0x5E, 0x17, 0x19, 0x6C, 0xBF, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x74, 0x9F, 0x26, 0x68, 0x5A, 0x6F, 0xE0, 0x3E ),
+    BYTES_TO_T_UINT_8( 0x14, 0x86, 0x4F, 0xF0, 0xD2, 0x96, 0x5A, 0x38 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x48, 0x33, 0x9B, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0x00, 0x6E, 0x9D, 0x15, 0x59, 0x39, 0x8D, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0x3B, 0x26, 0x38, 0x0D, 0xF7, 0xD9, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x7D, 0x13, 0x20, 0xE9, 0xC5, 0xBF, 0x4D, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x0F, 0x88, 0xFB, 0x11, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0x56, 0x63, 0x70, 0x6B, 0x71, 0xC2, 0x9C, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0xDB, 0x38, 0x2C, 0x4F, 0x1D, 0xE9, 0x91, 0x3A ),
+    BYTES_TO_T_UINT_8( 0x5B, 0xDD, 0x8E, 0xFC, 0xC5, 0xCE, 0x08, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0xE3, 0xD2, 0xF4, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0x6A, 0x48, 0xB4, 0xE4, 0x53, 0xBF, 0xC0, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x8B, 0x33, 0xE8, 0xD8, 0x60, 0x86, 0x49, 0x18 ),
+    BYTES_TO_T_UINT_8( 0x92, 0xE9, 0x3E, 0x47, 0x17, 0x43, 0x32, 0xD9 ),
+    BYTES_TO_T_UINT_8( 0x24, 0x93, 0x77, 0x67, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0xFA, 0xAE, 0x4E, 0x60, 0x11, 0x5D, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0x8E, 0x18, 0xE1, 0x6C, 0xB4, 0x56, 0x81, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x98, 0x35, 0x23, 0x8B, 0x9E, 0xA8, 0x6D ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x10, 0x97, 0xDA, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0x06, 0x60, 0xD9, 0xA5, 0xBB, 0x37, 0x56, 0x91 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0x94, 0x54, 0x73, 0x02, 0x66, 0x8A, 0x1C ),
+    BYTES_TO_T_UINT_8( 0x1D, 0xAA, 0xEE, 0x44, 0x4D, 0xAE, 0x02, 0x0A ),
+    BYTES_TO_T_UINT_8( 0xA3, 0x2F, 0x53, 0xE1, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDD, 0xF3, 0xB8, 0x69, 0xD7, 0x9C, 0x1F, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x82, 0x23, 0x50, 0x9A, 0xC1, 0x46, 0xEB, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x8E, 0xA9, 0xF2, 0x0E, 0xFB, 0xCA, 0x30, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x75, 0x29, 0xFD, 0x00, 0x00, 0x00, 0x00 ),
+};
+static const mbedtls_ecp_point secp224r1_T[32] = {
+    ECP_POINT_INIT_XY( secp224r1_T_0_X, secp224r1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_1_X, secp224r1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_2_X, secp224r1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_3_X, secp224r1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_4_X, secp224r1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_5_X, secp224r1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_6_X, secp224r1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_7_X, secp224r1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_8_X, secp224r1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_9_X, secp224r1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_10_X, secp224r1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_11_X, secp224r1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_12_X, secp224r1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_13_X, secp224r1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_14_X, secp224r1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_15_X, secp224r1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_16_X, secp224r1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_17_X, secp224r1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_18_X, secp224r1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_19_X, secp224r1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_20_X, secp224r1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_21_X, secp224r1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_22_X, secp224r1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_23_X, secp224r1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_24_X, secp224r1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_25_X, secp224r1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_26_X, secp224r1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_27_X, secp224r1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_28_X, secp224r1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_29_X, secp224r1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_30_X, secp224r1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp224r1_T_31_X, secp224r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP224R1_ENABLED */
 
-/* Additional forward declarations */
-#if defined(MBEDTLS_ECP_DP_CURVE25519_ENABLED)
-static int ecp_mod_p255( mbedtls_mpi * );
-#endif
-#if defined(MBEDTLS_ECP_DP_SECP192K1_ENABLED)
-static int ecp_mod_p192k1( mbedtls_mpi * );
-#endif
-#if defined(MBEDTLS_ECP_DP_SECP224K1_ENABLED)
-static int ecp_mod_p224k1( mbedtls_mpi * );
-#endif
-#if defined(MBEDTLS_ECP_DP_SECP256K1_ENABLED)
-static int ecp_mod_p256k1( mbedtls_mpi * );
+#if defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+static const mbedtls_mpi_uint secp256r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x96, 0xC2, 0x98, 0xD8, 0x45, 0x39, 0xA1, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x33, 0xEB, 0x2D, 0x81, 0x7D, 0x03, 0x77 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x40, 0xA4, 0x63, 0xE5, 0xE6, 0xBC, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0x47, 0x42, 0x2C, 0xE1, 0xF2, 0xD1, 0x17, 0x6B ),
+};
+static const mbedtls_mpi_uint secp256r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF5, 0x51, 0xBF, 0x37, 0x68, 0x40, 0xB6, 0xCB ),
+    BYTES_TO_T_UINT_8( 0xCE, 0x5E, 0x31, 0x6B, 0x57, 0x33, 0xCE, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x16, 0x9E, 0x0F, 0x7C, 0x4A, 0xEB, 0xE7, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x7F, 0x1A, 0xFE, 0xE2, 0x42, 0xE3, 0x4F ),
+};
+static const mbedtls_mpi_uint secp256r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0xB1, 0x3F, 0x1C, 0x5A, 0x7C, 0x16, 0xDB, 0x59 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0x8E, 0x31, 0xBF, 0x2A, 0xCE, 0xB3, 0x98 ),
+    BYTES_TO_T_UINT_8( 0xA6, 0x2F, 0xBC, 0xD2, 0x1E, 0xC4, 0xF1, 0x2D ),
+    BYTES_TO_T_UINT_8( 0xAF, 0xB2, 0xD1, 0x6E, 0x43, 0x2C, 0xCC, 0xEF ),
+};
+static const mbedtls_mpi_uint secp256r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x13, 0x55, 0xB2, 0x97, 0xF1, 0x07, 0xFE, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x89, 0xA5, 0x34, 0x37, 0x33, 0x45, 0x82, 0x46 ),
+    BYTES_TO_T_UINT_8( 0x43, 0xF5, 0x34, 0xED, 0x77, 0x4A, 0x38, 0xA5 ),
+    BYTES_TO_T_UINT_8( 0x63, 0x38, 0x9F, 0x8D, 0x9C, 0x4F, 0x68, 0xF3 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x8E, 0x18, 0x18, 0x73, 0x64, 0x02, 0xC9, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x99, 0x70, 0x16, 0xCA, 0x28, 0xEC, 0x0B, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0x20, 0x9C, 0x09, 0x2F, 0x4D, 0x66, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x5C, 0x62, 0xFA, 0x55, 0x34, 0xCA, 0xCC, 0x13 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x0C, 0x1C, 0x42, 0x05, 0x31, 0xC2, 0x84, 0xAA ),
+    BYTES_TO_T_UINT_8( 0x71, 0x0D, 0xDB, 0x6C, 0x21, 0x75, 0x64, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x6A, 0x21, 0xFB, 0xB1, 0x46, 0x04, 0xE9 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0x89, 0x46, 0xAF, 0xA5, 0xA5, 0x5B, 0x4B ),
+};
+static const mbedtls_mpi_uint secp256r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x78, 0x1C, 0xDB, 0xCB, 0x09, 0x28, 0xB2, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0xCD, 0xF6, 0x30, 0xEB, 0xC8, 0x91, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x8B, 0x0F, 0xE8, 0xBF, 0x40, 0x87, 0xE2, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0xE7, 0xE7, 0x40, 0x2A, 0x34, 0x74, 0x0F ),
+};
+static const mbedtls_mpi_uint secp256r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF2, 0x51, 0x1C, 0x35, 0x87, 0x8E, 0x96, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x7B, 0xE1, 0xF5, 0x81, 0xC5, 0xC5, 0x65 ),
+    BYTES_TO_T_UINT_8( 0x2E, 0x4E, 0x99, 0x9D, 0x2A, 0xF0, 0x58, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x07, 0xEC, 0xC1, 0xF5, 0x00, 0x0B, 0x1C, 0x53 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0x51, 0xAA, 0x21, 0x8B, 0x7D, 0xC4, 0x52, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x0D, 0x87, 0x7E, 0x5A, 0x29, 0x36, 0x50, 0x0F ),
+    BYTES_TO_T_UINT_8( 0x27, 0x51, 0xB4, 0x88, 0x14, 0x28, 0xA9, 0xBA ),
+    BYTES_TO_T_UINT_8( 0x50, 0xE0, 0x02, 0xC4, 0x1E, 0x45, 0xD6, 0x27 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2D, 0x43, 0x67, 0x55, 0x14, 0xEC, 0x96, 0x5C ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x50, 0x41, 0x0F, 0x29, 0x98, 0xEB, 0xCD ),
+    BYTES_TO_T_UINT_8( 0x66, 0xF5, 0xEE, 0xCD, 0x0C, 0x74, 0x91, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x83, 0xE5, 0xE9, 0x1B, 0x5E, 0xFA, 0x58, 0x2A ),
+};
+static const mbedtls_mpi_uint secp256r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0xA9, 0x95, 0x21, 0x50, 0xC5, 0xB7, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x13, 0x58, 0xDD, 0xB8, 0x74, 0xD4, 0x7E, 0x2D ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xE9, 0x04, 0xE1, 0xD2, 0xEC, 0xB9, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0xD8, 0x0E, 0xBD, 0xA2, 0x75, 0xD9, 0x90, 0xDC ),
+};
+static const mbedtls_mpi_uint secp256r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2E, 0xEB, 0xD6, 0x4D, 0x03, 0x52, 0xB5, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xE8, 0xFD, 0x1D, 0xC0, 0xBB, 0x54, 0xD5, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x7A, 0x97, 0xF0, 0x77, 0x32, 0xFD, 0x4C ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x74, 0x53, 0x81, 0x32, 0xE2, 0x7C, 0xC8 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0x6D, 0x40, 0x03, 0x17, 0x5B, 0xC3, 0x4D, 0xCB ),
+    BYTES_TO_T_UINT_8( 0x4C, 0xC5, 0xDA, 0x75, 0xC9, 0xAF, 0xD3, 0x4F ),
+    BYTES_TO_T_UINT_8( 0x78, 0x28, 0xF0, 0x29, 0xEB, 0x21, 0x23, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x22, 0x6B, 0xAD, 0x2F, 0x8D, 0xB1, 0xAF ),
+};
+static const mbedtls_mpi_uint secp256r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0x67, 0x6A, 0x77, 0xF1, 0x73, 0x82, 0xF5, 0xDD ),
+    BYTES_TO_T_UINT_8( 0x2F, 0x6C, 0xB9, 0xF6, 0x55, 0x97, 0x88, 0x96 ),
+    BYTES_TO_T_UINT_8( 0xFB, 0x8F, 0x20, 0x22, 0x63, 0xD6, 0xA8, 0x31 ),
+    BYTES_TO_T_UINT_8( 0x77, 0x48, 0xCA, 0xFC, 0x10, 0x1C, 0xD8, 0x5E ),
+};
+static const mbedtls_mpi_uint secp256r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0x40, 0xAF, 0x6A, 0x33, 0x1B, 0x1E, 0xC6, 0x2D ),
+    BYTES_TO_T_UINT_8( 0xB7, 0xF5, 0x51, 0x42, 0xBD, 0x87, 0x7E, 0x89 ),
+    BYTES_TO_T_UINT_8( 0x70, 0xB3, 0x11, 0x65, 0x23, 0x20, 0xB3, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x99, 0xF4, 0x41, 0x23, 0xCF, 0xA9, 0x0F, 0x46 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA7, 0x01, 0xAF, 0xCB, 0x79, 0x3B, 0xE6, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x34, 0x74, 0x15, 0x44, 0x3F, 0x12, 0x7E, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x1A, 0x4A, 0x9E, 0x80, 0x6E, 0x22, 0x59, 0x9D ),
+    BYTES_TO_T_UINT_8( 0x62, 0x5E, 0x77, 0x41, 0x3A, 0xF6, 0xD6, 0x18 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0xEA, 0x76, 0x64, 0x01, 0xD0, 0xB6, 0xE4, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0x10, 0x25, 0xEC, 0xD4, 0xE5, 0xA7, 0xB9, 0x71 ),
+    BYTES_TO_T_UINT_8( 0xD2, 0x90, 0xE4, 0xCB, 0x1E, 0xB7, 0x75, 0x19 ),
+    BYTES_TO_T_UINT_8( 0x25, 0xCD, 0x2A, 0xB5, 0x2F, 0x47, 0x6B, 0xDF ),
+};
+static const mbedtls_mpi_uint secp256r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEB, 0x55, 0x40, 0x78, 0x16, 0x87, 0x73, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x39, 0x7D, 0xB8, 0xB3, 0xB0, 0xC7, 0xCC ),
+    BYTES_TO_T_UINT_8( 0x19, 0x11, 0xB5, 0x1B, 0x37, 0x13, 0x9A, 0x3C ),
+    BYTES_TO_T_UINT_8( 0x93, 0xD5, 0x8F, 0xA8, 0xE1, 0x39, 0x26, 0xB4 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0x97, 0xD6, 0xB4, 0x20, 0x06, 0x42, 0xE9, 0x41 ),
+    BYTES_TO_T_UINT_8( 0xF9, 0x0D, 0xFA, 0x29, 0xD9, 0xD0, 0x0F, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x38, 0x2C, 0x02, 0x76, 0xA7, 0xB0, 0x1E, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0x63, 0x1C, 0x62, 0xA5, 0xDC, 0x7D, 0xCB, 0xFF ),
+};
+static const mbedtls_mpi_uint secp256r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0x5A, 0x96, 0x27, 0x09, 0x1B, 0x7B, 0xE3, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x19, 0x2C, 0xBD, 0x02, 0xC1, 0x9F, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x85, 0x3F, 0x7F, 0x90, 0x5E, 0xE7, 0x2D, 0x86 ),
+    BYTES_TO_T_UINT_8( 0x8E, 0x77, 0x9C, 0x5A, 0x29, 0x51, 0x98, 0xD3 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0xCC, 0xB8, 0x19, 0xF1, 0xE7, 0x08, 0x6A, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x6A, 0x69, 0xFC, 0x8A, 0x23, 0xD5, 0xB7, 0x03 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x70, 0x9F, 0x45, 0x32, 0x61, 0x89, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x16, 0x91, 0x6A, 0xA8, 0x57, 0x62, 0xA4, 0x57 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x65, 0x4C, 0x31, 0xBB, 0xEF, 0x6F, 0xA5, 0xFA ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x5C, 0x79, 0x74, 0x40, 0x1F, 0xE6, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x50, 0x78, 0x43, 0x52, 0x56, 0x3C, 0x1A ),
+    BYTES_TO_T_UINT_8( 0x11, 0xEC, 0x21, 0x66, 0x7D, 0x12, 0x4B, 0x7C ),
+};
+static const mbedtls_mpi_uint secp256r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0x5E, 0x81, 0xC8, 0x56, 0x07, 0x03, 0x1E, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0xF1, 0xA2, 0x37, 0x7D, 0xE3, 0x47, 0xF6, 0xBA ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xFB, 0xFA, 0xFE, 0x36, 0xEB, 0x91, 0x77 ),
+    BYTES_TO_T_UINT_8( 0x06, 0xF6, 0xB7, 0x35, 0xFB, 0x62, 0x82, 0x15 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE5, 0xE9, 0xDC, 0x32, 0x55, 0x22, 0xC3, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0x80, 0x47, 0x1B, 0x36, 0xCE, 0xD4, 0x7C, 0x6C ),
+    BYTES_TO_T_UINT_8( 0x8F, 0x28, 0x85, 0x3F, 0x70, 0x5E, 0xBE, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x4A, 0x62, 0x8E, 0xC9, 0xA3, 0x1A, 0x28, 0x4C ),
+};
+static const mbedtls_mpi_uint secp256r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0xEF, 0x3D, 0x6A, 0x4D, 0xDD, 0x11, 0x29, 0x5B ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x08, 0x60, 0xB9, 0x7C, 0xD0, 0xED, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x64, 0x7D, 0x6E, 0xE3, 0x6F, 0x8A, 0x74, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x5C, 0xBF, 0x4B, 0x34, 0x99, 0xC4, 0xBF ),
+};
+static const mbedtls_mpi_uint secp256r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0x0F, 0x75, 0x74, 0x8E, 0x2D, 0xF6, 0xC6, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x02, 0x99, 0x91, 0x48, 0x87, 0x9F, 0x63, 0x22 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0x24, 0x8A, 0x95, 0x94, 0xAA, 0x01, 0xFA ),
+    BYTES_TO_T_UINT_8( 0x40, 0xAA, 0x51, 0xED, 0x8A, 0xAE, 0x43, 0x27 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x15, 0x78, 0xEB, 0x86, 0x21, 0xA8, 0xDD, 0x9C ),
+    BYTES_TO_T_UINT_8( 0x65, 0x32, 0x41, 0xCE, 0x12, 0x36, 0x00, 0x8C ),
+    BYTES_TO_T_UINT_8( 0xF5, 0x77, 0xB5, 0x91, 0xAB, 0x1F, 0xCE, 0x8B ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x73, 0x8F, 0x48, 0xFF, 0x29, 0x3F, 0x0F ),
+};
+static const mbedtls_mpi_uint secp256r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x55, 0x0D, 0x96, 0xE6, 0x63, 0x80, 0xB0, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x67, 0xF4, 0xCB, 0xAE, 0xE2, 0x99, 0x96, 0x1A ),
+    BYTES_TO_T_UINT_8( 0x1B, 0x76, 0xE5, 0x4C, 0xA4, 0x64, 0x15, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x96, 0x29, 0x38, 0x81, 0xA5, 0x0E, 0xF0, 0x08 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x21, 0x4A, 0x51, 0x70, 0x39, 0xFF, 0x17, 0x0D ),
+    BYTES_TO_T_UINT_8( 0xEE, 0x80, 0xDD, 0xDA, 0xBA, 0xB5, 0xA7, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0xC4, 0xC8, 0x26, 0x81, 0xC3, 0x33, 0x1E, 0x94 ),
+    BYTES_TO_T_UINT_8( 0xDE, 0xC1, 0x57, 0x1D, 0xD0, 0x56, 0xE1, 0xB9 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0xAD, 0x05, 0x81, 0xEA, 0x0D, 0x50, 0x0D, 0x22 ),
+    BYTES_TO_T_UINT_8( 0xAE, 0xF3, 0x02, 0x02, 0x62, 0xA4, 0x2A, 0x6A ),
+    BYTES_TO_T_UINT_8( 0x56, 0x63, 0xC9, 0x3D, 0xAB, 0x56, 0x00, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xC3, 0x42, 0x21, 0x45, 0xAA, 0xB6, 0x6A, 0x50 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0xCD, 0x31, 0x51, 0xC0, 0x5B, 0x73, 0x97, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0x67, 0xB5, 0xBE, 0x22, 0x68, 0x07, 0x65, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x1F, 0x5B, 0xF5, 0xF7, 0x89, 0xB1, 0xF2, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x14, 0x26, 0x2C, 0x13, 0x82, 0x4C, 0x14, 0xAA ),
+};
+static const mbedtls_mpi_uint secp256r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0x51, 0x22, 0x82, 0xB3, 0x14, 0xBE, 0x1C, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0xAF, 0xD0, 0xFF, 0xB2, 0x72, 0xCE, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x43, 0x47, 0x84, 0x18, 0x4D, 0xA1, 0x01 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x39, 0x37, 0x92, 0xE3, 0x9F, 0xD8, 0xC1 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x80, 0x5B, 0x3F, 0x5F, 0x5C, 0x6A, 0x41, 0x12 ),
+    BYTES_TO_T_UINT_8( 0x22, 0x24, 0x52, 0xDA, 0xDB, 0x03, 0xE9, 0x58 ),
+    BYTES_TO_T_UINT_8( 0x7E, 0x86, 0x91, 0x42, 0xF1, 0x80, 0xCC, 0x18 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0x2C, 0x15, 0x7A, 0xF8, 0x5C, 0x03, 0xB2 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDE, 0x0E, 0xC8, 0x95, 0x91, 0x56, 0x12, 0x71 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0xC5, 0x97, 0xAF, 0x68, 0x25, 0xE0, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x93, 0xE4, 0x14, 0x8A, 0xC5, 0x1D, 0x3E, 0x60 ),
+    BYTES_TO_T_UINT_8( 0xDE, 0x80, 0x96, 0x74, 0x9C, 0x35, 0x2F, 0xF1 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x0C, 0x7B, 0xA7, 0xFE, 0x1B, 0x9D, 0x42, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x31, 0x9A, 0x5E, 0x59, 0xDC, 0xA4, 0x51, 0x46 ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x69, 0x12, 0xE7, 0xB1, 0xAA, 0x00, 0x89 ),
+    BYTES_TO_T_UINT_8( 0x2D, 0x61, 0xBF, 0x84, 0x67, 0x77, 0xEA, 0x90 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB6, 0xF2, 0x02, 0x0D, 0x25, 0x04, 0xD1, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x4F, 0x59, 0x4D, 0xFB, 0xCC, 0x3B, 0x58, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0xA1, 0xB6, 0xA7, 0x5B, 0x62, 0x44, 0x75, 0x75 ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x86, 0x1E, 0x10, 0xD3, 0x21, 0xA3, 0xD1 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x69, 0xA0, 0x2D, 0xE6, 0x6C, 0xB2, 0x90, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x65, 0x62, 0x58, 0x7C, 0x19, 0x23, 0x70, 0xA5 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x72, 0x56, 0x86, 0xBF, 0x19, 0x4E, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0x93, 0x98, 0x7D, 0xA0, 0xF5, 0x03, 0x65, 0xA6 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0x43, 0x47, 0xFE, 0x21, 0xC0, 0xB7, 0xDE, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0x00, 0x71, 0x7D, 0x7D, 0x84, 0xAE, 0x3B ),
+    BYTES_TO_T_UINT_8( 0x29, 0x1D, 0x7B, 0xE1, 0xA7, 0xFC, 0x69, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x60, 0xFC, 0x0A, 0x32, 0xEC, 0x60, 0xBA, 0xAD ),
+};
+static const mbedtls_mpi_uint secp256r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0x58, 0x81, 0xE4, 0xC4, 0x14, 0xD6, 0xC9, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x08, 0xC5, 0x8F, 0xAE, 0x98, 0x4A, 0x6B, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0x18, 0x8E, 0xB6, 0x38, 0xE0, 0x8B, 0xEF, 0x44 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0x1F, 0x27, 0xDB, 0x96, 0xF5, 0x9C, 0xBE ),
+};
+static const mbedtls_mpi_uint secp256r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0xAD, 0x95, 0x6F, 0x8E, 0x3E, 0x65, 0x7B, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x0A, 0x4D, 0x9E, 0x9B, 0xFF, 0xE6, 0xDB, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x59, 0x9F, 0x13, 0xA4, 0x8C, 0x2A, 0x77, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x7E, 0xC6, 0x66, 0xE5, 0x35, 0xF3, 0xA1 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x52, 0xF1, 0x7C, 0xF7, 0xFB, 0x61, 0xB1, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x00, 0xE3, 0x8C, 0xED, 0x4F, 0x3C, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x20, 0x0E, 0x05, 0xD0, 0xA2, 0xB4, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x99, 0x49, 0xC3, 0x86, 0xA2, 0x61, 0x5A ),
+};
+static const mbedtls_mpi_uint secp256r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB7, 0x4E, 0x21, 0x70, 0x68, 0xAF, 0x7B, 0x8C ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x61, 0xC2, 0xF2, 0x7D, 0xCA, 0x5B, 0x97 ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x1A, 0xD9, 0x1E, 0x31, 0xDF, 0xC6, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x38, 0x0D, 0x38, 0xA1, 0xAD, 0xAA, 0xCF, 0xE8 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0xDD, 0x28, 0x6D, 0x96, 0x78, 0x31, 0x9E, 0xC7 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0xA2, 0xF8, 0x89, 0x86, 0x86, 0xBA, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x42, 0x8D, 0xCF, 0x4A, 0x6D, 0x9C, 0x1F, 0xAF ),
+    BYTES_TO_T_UINT_8( 0x7D, 0x7F, 0x84, 0xE0, 0x73, 0x42, 0x2B, 0x2D ),
+};
+static const mbedtls_mpi_uint secp256r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEC, 0x0C, 0x13, 0x69, 0x90, 0x1A, 0x9E, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xB5, 0xE7, 0x83, 0x93, 0xFD, 0x10, 0xCB, 0x95 ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x71, 0xCC, 0x44, 0x26, 0x8A, 0x43, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x49, 0xEA, 0xE4, 0x1E, 0x10, 0xEB, 0xEA, 0x37 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0xDE, 0x37, 0x4A, 0xD8, 0xCB, 0xB5, 0x12, 0x1C ),
+    BYTES_TO_T_UINT_8( 0x1A, 0xEA, 0xB1, 0xC7, 0xB4, 0x6D, 0xD6, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x1E, 0xE3, 0x2C, 0x20, 0xE4, 0x2B, 0x85 ),
+    BYTES_TO_T_UINT_8( 0x48, 0xAF, 0x0F, 0xE4, 0x2D, 0x9C, 0xBE, 0x17 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x97, 0x87, 0xCC, 0x38, 0xCB, 0x3C, 0x5B, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x3E, 0x09, 0xB1, 0x34, 0x80, 0x9D, 0x8D, 0x1F ),
+    BYTES_TO_T_UINT_8( 0xC0, 0x81, 0x5B, 0xE7, 0x86, 0x6E, 0xCC, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0x97, 0xE6, 0xDB, 0x3F, 0x94, 0xBF, 0x14, 0x69 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x35, 0x6F, 0xB1, 0x00, 0x33, 0x4D, 0xB4, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x07, 0x57, 0x2D, 0x00, 0xF3, 0x8E, 0x98, 0x59 ),
+    BYTES_TO_T_UINT_8( 0x94, 0x4F, 0x49, 0xD0, 0xEB, 0xE1, 0x6F, 0x25 ),
+    BYTES_TO_T_UINT_8( 0xE4, 0x0D, 0x71, 0x7F, 0x69, 0x41, 0xF8, 0xAE ),
+};
+static const mbedtls_mpi_uint secp256r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x04, 0x96, 0xD4, 0x8B, 0x1F, 0xFB, 0x38, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x5C, 0xB1, 0xA0, 0xBF, 0xAE, 0xDA, 0xC9, 0xAE ),
+    BYTES_TO_T_UINT_8( 0xDD, 0xF6, 0x2C, 0x64, 0x5E, 0x36, 0x51, 0x15 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x8F, 0x0E, 0x16, 0xFA, 0xB0, 0xB8, 0x75 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0xB9, 0x9C, 0xAB, 0xED, 0x13, 0xD1, 0x33, 0x60 ),
+    BYTES_TO_T_UINT_8( 0xEE, 0x45, 0x9D, 0xE6, 0xA3, 0x7B, 0xF8, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x03, 0x5A, 0xD6, 0xE4, 0x36, 0x62, 0x43, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x08, 0xA5, 0x98, 0x3F, 0xF9, 0xF6, 0x93, 0x58 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0xAB, 0x4F, 0xD5, 0xAA, 0x15, 0x2E, 0x83, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x36, 0xC7, 0x6B, 0x0D, 0xFF, 0x77, 0x32 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x4F, 0x0C, 0x20, 0x18, 0x11, 0x30, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0x4D, 0x38, 0xE9, 0xD4, 0xBC, 0x71, 0xE4, 0x26 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0xD8, 0x27, 0x24, 0xC5, 0xA4, 0xC5, 0x76, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x64, 0x4B, 0xA3, 0xF5, 0x43, 0x82, 0x95, 0x66 ),
+    BYTES_TO_T_UINT_8( 0x92, 0x0D, 0x6E, 0xF3, 0x98, 0x67, 0x16, 0x04 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0xE6, 0xE9, 0xC6, 0x27, 0x39, 0xE3, 0x43 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2B, 0x8D, 0xCA, 0xF0, 0x76, 0xED, 0x9A, 0x89 ),
+    BYTES_TO_T_UINT_8( 0xD8, 0x0D, 0xF5, 0x0A, 0xDE, 0x9C, 0xB8, 0x43 ),
+    BYTES_TO_T_UINT_8( 0x3B, 0xE1, 0x51, 0x59, 0x1E, 0xA2, 0x5E, 0x80 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x30, 0x41, 0x28, 0xA4, 0xDA, 0x10, 0xE2 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0x5B, 0x03, 0x58, 0x07, 0x65, 0xA1, 0x46, 0xCE ),
+    BYTES_TO_T_UINT_8( 0xC9, 0xA0, 0x70, 0xE0, 0xAD, 0xF1, 0x3D, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x34, 0x69, 0x68, 0x38, 0xFB, 0x01, 0xBF ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x6E, 0xF1, 0xF0, 0x57, 0x62, 0xBA, 0x1C ),
+};
+static const mbedtls_mpi_uint secp256r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9C, 0x40, 0x93, 0xEE, 0xB6, 0xA9, 0x38, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0x38, 0x6B, 0x4A, 0xA1, 0x29, 0x24, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x15, 0xC2, 0xA5, 0x0D, 0x77, 0x88, 0x14 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x76, 0x1D, 0x89, 0x8E, 0x1F, 0xDE, 0x4A ),
+};
+static const mbedtls_mpi_uint secp256r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0x3F, 0xE6, 0xAD, 0x27, 0x4B, 0x2B, 0x70, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x67, 0x05, 0xA1, 0x33, 0x1A, 0xF1, 0x5D ),
+    BYTES_TO_T_UINT_8( 0xCE, 0xB9, 0x62, 0xA3, 0x80, 0xCB, 0x33, 0x0D ),
+    BYTES_TO_T_UINT_8( 0x09, 0xB2, 0x5B, 0x85, 0xF5, 0x42, 0xBB, 0xA7 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0x75, 0xE5, 0x5F, 0xC9, 0x96, 0x60, 0xCC, 0xFD ),
+    BYTES_TO_T_UINT_8( 0xC6, 0xDE, 0x51, 0x23, 0xD7, 0x08, 0x0E, 0xFF ),
+    BYTES_TO_T_UINT_8( 0x28, 0x5B, 0x6A, 0xBB, 0xF5, 0x3F, 0x32, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0xA2, 0xF7, 0x89, 0xAE, 0x2D, 0xAA, 0x2C ),
+};
+static const mbedtls_mpi_uint secp256r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x49, 0xEB, 0xA7, 0x2D, 0x76, 0xD6, 0x96, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x41, 0x5E, 0x77, 0xFB, 0x8E, 0x76, 0x04, 0x6E ),
+    BYTES_TO_T_UINT_8( 0x6C, 0xF7, 0x24, 0xAF, 0x3D, 0x9C, 0x34, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0x90, 0x0C, 0xDE, 0xCA, 0x6C, 0xDB, 0xE6 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0x87, 0xFD, 0x16, 0xA4, 0xF5, 0x01, 0xAA, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x27, 0xC4, 0x1E, 0x78, 0x0B, 0x27, 0xC3, 0x84 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0x34, 0x10, 0x02, 0x04, 0x0F, 0x68, 0x37 ),
+    BYTES_TO_T_UINT_8( 0x35, 0xF7, 0x4B, 0x65, 0x3C, 0xFE, 0x90, 0xEB ),
+};
+static const mbedtls_mpi_uint secp256r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0x76, 0x19, 0x57, 0xB3, 0x16, 0xBF, 0x35, 0x8E ),
+    BYTES_TO_T_UINT_8( 0xE7, 0x64, 0x68, 0x34, 0x63, 0x0C, 0xEB, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x7F, 0x6C, 0x9B, 0x7E, 0xE0, 0x57, 0x7B, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x98, 0x5A, 0xB3, 0x70, 0x6F, 0xCF, 0x57, 0x31 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA5, 0x9E, 0xC4, 0x5A, 0x14, 0x4C, 0xC2, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x32, 0x1A, 0x6B, 0x90, 0x56, 0x0C, 0xC2 ),
+    BYTES_TO_T_UINT_8( 0x35, 0xA3, 0x5F, 0x34, 0x4E, 0x7B, 0xEF, 0xEA ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x47, 0x77, 0x40, 0x5D, 0x65, 0xC9, 0xB4 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0xB9, 0x66, 0xF8, 0xFC, 0xFE, 0xE3, 0xF4, 0xF3 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0x0A, 0x8B, 0xE1, 0x07, 0x08, 0x2A, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x7B, 0x2E, 0x9B, 0x1B, 0x06, 0xC7, 0xC4, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x00, 0xDD, 0xDA, 0x2B, 0xE9, 0xD7, 0x41 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF7, 0x6E, 0x4B, 0x1D, 0x79, 0x8A, 0x0A, 0xFF ),
+    BYTES_TO_T_UINT_8( 0x47, 0x2F, 0xAA, 0xB2, 0xFF, 0x4D, 0x34, 0x02 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x06, 0x7A, 0x35, 0x04, 0xD7, 0x26, 0x17 ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x85, 0xBC, 0xC1, 0x77, 0xBB, 0xE6, 0x4C ),
+};
+static const mbedtls_mpi_uint secp256r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0xEF, 0x2B, 0xCC, 0xAF, 0xF4, 0x37, 0xE4, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0x53, 0x2B, 0xDA, 0x3A, 0xD6, 0xB2, 0x1F, 0x4F ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x0C, 0x58, 0xBB, 0x2D, 0xE1, 0xC0, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x54, 0xC7, 0x33, 0x34, 0x37, 0x18, 0x25 ),
+};
+static const mbedtls_mpi_uint secp256r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB9, 0x2F, 0xD9, 0xBF, 0x0F, 0xD9, 0x12, 0xAB ),
+    BYTES_TO_T_UINT_8( 0x46, 0xAE, 0x85, 0xA1, 0xB3, 0xB9, 0xB9, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x9F, 0xF4, 0xE6, 0x9C, 0x7E, 0x7A, 0x0C, 0x2A ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x21, 0x8F, 0xB4, 0x7F, 0x30, 0x1F, 0x53 ),
+};
+static const mbedtls_ecp_point secp256r1_T[32] = {
+    ECP_POINT_INIT_XY( secp256r1_T_0_X, secp256r1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_1_X, secp256r1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_2_X, secp256r1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_3_X, secp256r1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_4_X, secp256r1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_5_X, secp256r1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_6_X, secp256r1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_7_X, secp256r1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_8_X, secp256r1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_9_X, secp256r1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_10_X, secp256r1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_11_X, secp256r1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_12_X, secp256r1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_13_X, secp256r1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_14_X, secp256r1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_15_X, secp256r1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_16_X, secp256r1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_17_X, secp256r1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_18_X, secp256r1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_19_X, secp256r1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_20_X, secp256r1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_21_X, secp256r1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_22_X, secp256r1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_23_X, secp256r1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_24_X, secp256r1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_25_X, secp256r1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_26_X, secp256r1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_27_X, secp256r1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_28_X, secp256r1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_29_X, secp256r1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_30_X, secp256r1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp256r1_T_31_X, secp256r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP256R1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_SECP384R1_ENABLED)
+static const mbedtls_mpi_uint secp384r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0xB7, 0x0A, 0x76, 0x72, 0x38, 0x5E, 0x54, 0x3A ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x29, 0x55, 0xBF, 0x5D, 0xF2, 0x02, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x38, 0x2A, 0x54, 0x82, 0xE0, 0x41, 0xF7, 0x59 ),
+    BYTES_TO_T_UINT_8( 0x98, 0x9B, 0xA7, 0x8B, 0x62, 0x3B, 0x1D, 0x6E ),
+    BYTES_TO_T_UINT_8( 0x74, 0xAD, 0x20, 0xF3, 0x1E, 0xC7, 0xB1, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x37, 0x05, 0x8B, 0xBE, 0x22, 0xCA, 0x87, 0xAA ),
+};
+static const mbedtls_mpi_uint secp384r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x5F, 0x0E, 0xEA, 0x90, 0x7C, 0x1D, 0x43, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x9D, 0x81, 0x7E, 0x1D, 0xCE, 0xB1, 0x60, 0x0A ),
+    BYTES_TO_T_UINT_8( 0xC0, 0xB8, 0xF0, 0xB5, 0x13, 0x31, 0xDA, 0xE9 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0x14, 0x9A, 0x28, 0xBD, 0x1D, 0xF4, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0x29, 0xDC, 0x92, 0x92, 0xBF, 0x98, 0x9E, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x2C, 0x26, 0x96, 0x4A, 0xDE, 0x17, 0x36 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0x46, 0x92, 0x00, 0x2C, 0x78, 0xDB, 0x1F, 0x37 ),
+    BYTES_TO_T_UINT_8( 0x17, 0xF3, 0xEB, 0xB7, 0x06, 0xF7, 0xB6, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xBC, 0x2C, 0xCF, 0xD8, 0xED, 0x53, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x52, 0x75, 0x7B, 0xA3, 0xAB, 0xC3, 0x2C, 0x85 ),
+    BYTES_TO_T_UINT_8( 0xE5, 0x9D, 0x78, 0x41, 0xF6, 0x76, 0x84, 0xAC ),
+    BYTES_TO_T_UINT_8( 0x54, 0x56, 0xE8, 0x52, 0xB3, 0xCB, 0xA8, 0xBD ),
+};
+static const mbedtls_mpi_uint secp384r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x6D, 0xF2, 0xAE, 0xA4, 0xB6, 0x89, 0x1B, 0xDA ),
+    BYTES_TO_T_UINT_8( 0x01, 0x0F, 0xCE, 0x1C, 0x7C, 0xF6, 0x50, 0x4C ),
+    BYTES_TO_T_UINT_8( 0x4C, 0xEB, 0x90, 0xE6, 0x4D, 0xC7, 0xD4, 0x7A ),
+    BYTES_TO_T_UINT_8( 0xD1, 0x49, 0x2D, 0x8A, 0x01, 0x99, 0x60, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x80, 0x9B, 0x9B, 0x6A, 0xB0, 0x07, 0xD9 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0xA2, 0xEE, 0x59, 0xBE, 0x95, 0xBC, 0x23 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0xE6, 0x9D, 0x56, 0xAE, 0x59, 0xFB, 0x1F, 0x98 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0xAC, 0x91, 0x80, 0x87, 0xA8, 0x6E, 0x58 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x08, 0xA7, 0x08, 0x94, 0x32, 0xFC, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x9F, 0x29, 0x9E, 0x84, 0xF4, 0xE5, 0x6E, 0x7E ),
+    BYTES_TO_T_UINT_8( 0x55, 0x21, 0xB9, 0x50, 0x24, 0xF8, 0x9C, 0xC7 ),
+    BYTES_TO_T_UINT_8( 0x34, 0x04, 0x01, 0xC2, 0xFB, 0x77, 0x3E, 0xDE ),
+};
+static const mbedtls_mpi_uint secp384r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x00, 0x38, 0xEE, 0xE3, 0xC7, 0x9D, 0xEC, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x88, 0xCF, 0x43, 0xFA, 0x92, 0x5E, 0x8E ),
+    BYTES_TO_T_UINT_8( 0xE9, 0xCA, 0x43, 0xF8, 0x3B, 0x49, 0x7E, 0x75 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0xE7, 0xEB, 0x17, 0x45, 0x86, 0xC2, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x92, 0x69, 0x57, 0x32, 0xE0, 0x9C, 0xD1, 0x00 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x10, 0xB8, 0x4D, 0xB8, 0xF4, 0x0D, 0xE3 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x60, 0xDC, 0x9A, 0xB2, 0x79, 0x39, 0x27, 0x16 ),
+    BYTES_TO_T_UINT_8( 0x4F, 0x71, 0xE4, 0x3B, 0x4D, 0x60, 0x0C, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x55, 0xBD, 0x19, 0x40, 0xFA, 0x19, 0x2A, 0x5A ),
+    BYTES_TO_T_UINT_8( 0x4D, 0xF8, 0x1E, 0x43, 0xA1, 0x50, 0x8D, 0xEF ),
+    BYTES_TO_T_UINT_8( 0xA3, 0x18, 0x7C, 0x41, 0xFA, 0x7C, 0x1B, 0x58 ),
+    BYTES_TO_T_UINT_8( 0x00, 0x59, 0x24, 0xC4, 0xE9, 0xB7, 0xD3, 0xAD ),
+};
+static const mbedtls_mpi_uint secp384r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0xBB, 0x01, 0x3D, 0x63, 0x54, 0x45, 0x6F, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0x7B, 0xB2, 0x19, 0xA3, 0x86, 0x1D, 0x42, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x84, 0x02, 0x87, 0x18, 0x92, 0x52, 0x1A, 0x71 ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x18, 0xB1, 0x5D, 0x18, 0x1B, 0x37, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x74, 0x61, 0xBA, 0x18, 0xAF, 0x40, 0x30 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0x7D, 0x3C, 0x52, 0x0F, 0x07, 0xB0, 0x6F ),
+};
+static const mbedtls_mpi_uint secp384r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0x09, 0x39, 0x13, 0xAA, 0x60, 0x15, 0x99, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x17, 0x00, 0xCB, 0xC6, 0xB1, 0xDB, 0x97, 0x90 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0xFA, 0x60, 0xB8, 0x24, 0xE4, 0x7D, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x75, 0xB3, 0x70, 0xB2, 0x83, 0xB1, 0x9B ),
+    BYTES_TO_T_UINT_8( 0xA3, 0xE3, 0x6C, 0xCD, 0x33, 0x62, 0x7A, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x88, 0x30, 0xDC, 0x0F, 0x9F, 0xBB, 0xB8, 0xAA ),
+};
+static const mbedtls_mpi_uint secp384r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA6, 0xD5, 0x0A, 0x60, 0x81, 0xB9, 0xC5, 0x16 ),
+    BYTES_TO_T_UINT_8( 0x44, 0xAA, 0x2F, 0xD6, 0xF2, 0x73, 0xDF, 0xEB ),
+    BYTES_TO_T_UINT_8( 0xF3, 0x7B, 0x74, 0xC9, 0xB3, 0x5B, 0x95, 0x6D ),
+    BYTES_TO_T_UINT_8( 0xAC, 0x04, 0xEB, 0x15, 0xC8, 0x5F, 0x00, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x50, 0x20, 0x28, 0xD1, 0x01, 0xAF, 0xF0 ),
+    BYTES_TO_T_UINT_8( 0x28, 0x6D, 0x4F, 0x31, 0x81, 0x2F, 0x94, 0x48 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x46, 0x2F, 0xD8, 0xB6, 0x63, 0x7C, 0xE9, 0x50 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x8C, 0xB9, 0x14, 0xD9, 0x37, 0x63, 0xDE ),
+    BYTES_TO_T_UINT_8( 0x10, 0x02, 0xB8, 0x46, 0xAD, 0xCE, 0x7B, 0x38 ),
+    BYTES_TO_T_UINT_8( 0x82, 0x47, 0x2D, 0x66, 0xA7, 0xE9, 0x33, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x92, 0xF9, 0x93, 0x94, 0xA8, 0x48, 0xB3, 0x4F ),
+    BYTES_TO_T_UINT_8( 0xE9, 0x4A, 0xAC, 0x51, 0x08, 0x72, 0x2F, 0x1A ),
+};
+static const mbedtls_mpi_uint secp384r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDA, 0xAD, 0xA0, 0xF9, 0x81, 0xE1, 0x78, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x9A, 0x63, 0xD8, 0xBA, 0x79, 0x1A, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x34, 0x31, 0x7B, 0x7A, 0x5A, 0x5D, 0x7D, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x83, 0x96, 0x12, 0x4B, 0x19, 0x09, 0xE0, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0x55, 0x8A, 0x57, 0xEE, 0x4E, 0x6E, 0x7E, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x11, 0x9D, 0x69, 0xDC, 0xB3, 0xDA, 0xD8, 0x08 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0x68, 0x49, 0x03, 0x03, 0x33, 0x6F, 0x28, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xDB, 0xA7, 0x05, 0x8C, 0xF3, 0x4D, 0xFB ),
+    BYTES_TO_T_UINT_8( 0x8E, 0x92, 0xB1, 0xA8, 0xEC, 0x0D, 0x64, 0x3B ),
+    BYTES_TO_T_UINT_8( 0x4E, 0xFC, 0xFD, 0xD0, 0x4B, 0x88, 0x1B, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x83, 0x9C, 0x51, 0x69, 0xCE, 0x71, 0x73, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x5A, 0x14, 0x23, 0x1A, 0x46, 0x63, 0x5F ),
+};
+static const mbedtls_mpi_uint secp384r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0xBC, 0x4C, 0x70, 0x44, 0x18, 0xCD, 0xEF, 0xED ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x49, 0xDD, 0x64, 0x7E, 0x7E, 0x4D, 0x92 ),
+    BYTES_TO_T_UINT_8( 0xA2, 0x32, 0x7C, 0x09, 0xD0, 0x3F, 0xD6, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x6D, 0xE0, 0x4F, 0x65, 0x0C, 0x7A, 0x54, 0x3E ),
+    BYTES_TO_T_UINT_8( 0x16, 0xFA, 0xFB, 0x4A, 0xB4, 0x79, 0x5A, 0x8C ),
+    BYTES_TO_T_UINT_8( 0x04, 0x5D, 0x1B, 0x2B, 0xDA, 0xBC, 0x9A, 0x74 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0x51, 0xAC, 0x56, 0xF7, 0x5F, 0x51, 0x68, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xC6, 0xE0, 0x1D, 0xBC, 0x13, 0x4E, 0xAC, 0x03 ),
+    BYTES_TO_T_UINT_8( 0xB7, 0xF5, 0xC5, 0xE6, 0xD2, 0x88, 0xBA, 0xCB ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x0E, 0x28, 0x23, 0x58, 0x67, 0xFA, 0xEE ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x80, 0x4B, 0xD8, 0xC4, 0xDF, 0x15, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x0E, 0x58, 0xE6, 0x2C, 0x59, 0xC2, 0x03 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9B, 0x26, 0x27, 0x99, 0x16, 0x2B, 0x22, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xBA, 0xF3, 0x8F, 0xC3, 0x2A, 0x9B, 0xFC, 0x38 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x2E, 0x83, 0x3D, 0xFE, 0x9E, 0x3C, 0x1B ),
+    BYTES_TO_T_UINT_8( 0x08, 0x57, 0xCD, 0x2D, 0xC1, 0x49, 0x38, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x95, 0x42, 0x8B, 0x33, 0x89, 0x1F, 0xEA, 0x01 ),
+    BYTES_TO_T_UINT_8( 0xAA, 0x1D, 0x13, 0xD7, 0x50, 0xBB, 0x3E, 0xEB ),
+};
+static const mbedtls_mpi_uint secp384r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0xD2, 0x9A, 0x52, 0xD2, 0x54, 0x7C, 0x97, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x33, 0x6E, 0xED, 0xD9, 0x87, 0x50, 0xC5 ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x35, 0x7E, 0x16, 0x40, 0x15, 0x83, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x33, 0x2B, 0xA4, 0xAB, 0x03, 0x91, 0xEA, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x47, 0x39, 0xEF, 0x05, 0x59, 0xD0, 0x90 ),
+    BYTES_TO_T_UINT_8( 0xBF, 0x24, 0x0D, 0x76, 0x11, 0x53, 0x08, 0xAF ),
+};
+static const mbedtls_mpi_uint secp384r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1F, 0x2F, 0xDD, 0xBD, 0x50, 0x48, 0xB1, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x80, 0x1C, 0x84, 0x55, 0x78, 0x14, 0xEB, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x5E, 0x3E, 0xA6, 0xAF, 0xF6, 0xC7, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0x11, 0xE2, 0x65, 0xCA, 0x41, 0x95, 0x3B ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x83, 0xD8, 0xE6, 0x4D, 0x22, 0x06, 0x2D ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x7F, 0x25, 0x2A, 0xAA, 0x28, 0x46, 0x97 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0xDB, 0x15, 0x56, 0x84, 0xCB, 0xC0, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x56, 0xDB, 0x0E, 0x08, 0xC9, 0xF5, 0xD4, 0x9E ),
+    BYTES_TO_T_UINT_8( 0xE6, 0x62, 0xD0, 0x1A, 0x7C, 0x13, 0xD5, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x7D, 0xAD, 0x53, 0xE0, 0x32, 0x21, 0xA0, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0xC5, 0x38, 0x81, 0x21, 0x23, 0x0E, 0xD2, 0xBB ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x51, 0x05, 0xD0, 0x1E, 0x82, 0xA9, 0x71 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA7, 0xC3, 0x27, 0xBF, 0xC6, 0xAA, 0xB7, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xCB, 0x65, 0x45, 0xDF, 0xB9, 0x46, 0x17, 0x46 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0x38, 0x3F, 0xB2, 0xB1, 0x5D, 0xCA, 0x1C ),
+    BYTES_TO_T_UINT_8( 0x88, 0x29, 0x6C, 0x63, 0xE9, 0xD7, 0x48, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0xBC, 0xF1, 0xD7, 0x99, 0x8C, 0xC2, 0x05, 0x99 ),
+    BYTES_TO_T_UINT_8( 0x6D, 0xE6, 0x5E, 0x82, 0x6D, 0xE5, 0x7E, 0xD5 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0x7B, 0x61, 0xFA, 0x7D, 0x01, 0xDB, 0xB6, 0x63 ),
+    BYTES_TO_T_UINT_8( 0x11, 0xC6, 0x58, 0x39, 0xF4, 0xC6, 0x82, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x47, 0x5A, 0x7A, 0x80, 0x08, 0xCD, 0xAA, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0x8C, 0xC6, 0x3F, 0x3C, 0xA5, 0x68, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0xBB, 0xF5, 0xD5, 0x17, 0xAE, 0x36, 0xD8, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xC7, 0xAD, 0x92, 0xC5, 0x57, 0x6C, 0xDA, 0x91 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE8, 0x67, 0x17, 0xC0, 0x40, 0x78, 0x8C, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x7E, 0x9F, 0xF4, 0xAA, 0xDA, 0x5C, 0x7E, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0x96, 0xDB, 0x42, 0x3E, 0x72, 0x64, 0xA0, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x27, 0xF9, 0x41, 0x17, 0x43, 0xE3, 0xE8, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0x66, 0xDD, 0xCC, 0x43, 0x7E, 0x16, 0x05, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x36, 0x4B, 0xCF, 0x48, 0x8F, 0x41, 0x90, 0xE5 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0x98, 0x0C, 0x6B, 0x9D, 0x22, 0x04, 0xBC, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x86, 0x63, 0x79, 0x2F, 0x6A, 0x0E, 0x8A, 0xDE ),
+    BYTES_TO_T_UINT_8( 0x29, 0x67, 0x3F, 0x02, 0xB8, 0x91, 0x7F, 0x74 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x14, 0x64, 0xA0, 0x33, 0xF4, 0x6B, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x44, 0x71, 0x87, 0xB8, 0x88, 0x3F, 0x45 ),
+    BYTES_TO_T_UINT_8( 0x1B, 0x2B, 0x85, 0x05, 0xC5, 0x44, 0x53, 0x15 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0x3E, 0x2B, 0xFE, 0xD1, 0x1C, 0x73, 0xE3, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x66, 0x33, 0xA1, 0xD3, 0x69, 0x1C, 0x9D, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x5A, 0xBA, 0xB6, 0xAE, 0x1B, 0x94, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xAF, 0x74, 0x90, 0x5C, 0x57, 0xB0, 0x3A, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x2F, 0x93, 0x20, 0x24, 0x54, 0x1D, 0x8D ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x78, 0x9D, 0x71, 0x67, 0x5D, 0x49, 0x98 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0x12, 0xC8, 0x0E, 0x11, 0x8D, 0xE0, 0x8F, 0x69 ),
+    BYTES_TO_T_UINT_8( 0x59, 0x7F, 0x79, 0x6C, 0x5F, 0xB7, 0xBC, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0x88, 0xE1, 0x83, 0x3C, 0x12, 0xBB, 0xEE, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0xC2, 0xC4, 0x1B, 0x41, 0x71, 0xB9, 0x17 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0xEE, 0xBB, 0x1D, 0x89, 0x50, 0x88, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x1C, 0x55, 0x74, 0xEB, 0xDE, 0x92, 0x3F ),
+};
+static const mbedtls_mpi_uint secp384r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9C, 0x38, 0x92, 0x06, 0x19, 0xD0, 0xB3, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0x99, 0x26, 0xA3, 0x5F, 0xE2, 0xC1, 0x81 ),
+    BYTES_TO_T_UINT_8( 0x75, 0xFC, 0xFD, 0xC3, 0xB6, 0x26, 0x24, 0x8F ),
+    BYTES_TO_T_UINT_8( 0xAF, 0xAD, 0xE7, 0x49, 0xB7, 0x64, 0x4B, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x4E, 0x95, 0xAD, 0x07, 0xFE, 0xB6, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x4F, 0x15, 0xE7, 0x2D, 0x19, 0xA9, 0x08, 0x10 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0xBE, 0xBD, 0xAC, 0x0A, 0x3F, 0x6B, 0xFF, 0xFA ),
+    BYTES_TO_T_UINT_8( 0xE0, 0xE4, 0x74, 0x14, 0xD9, 0x70, 0x1D, 0x71 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0xB0, 0x71, 0xBB, 0xD8, 0x18, 0x96, 0x2B ),
+    BYTES_TO_T_UINT_8( 0xDA, 0xB8, 0x19, 0x90, 0x80, 0xB5, 0xEE, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x21, 0x20, 0xA6, 0x17, 0x48, 0x03, 0x6F ),
+    BYTES_TO_T_UINT_8( 0xE3, 0x1D, 0xBB, 0x6D, 0x94, 0x20, 0x34, 0xF1 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x59, 0x82, 0x67, 0x4B, 0x8E, 0x4E, 0xBE, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0xDA, 0x77, 0xF8, 0x23, 0x55, 0x2B, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x5C, 0x02, 0xDE, 0x25, 0x35, 0x2D, 0x74, 0x51 ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x0C, 0xB8, 0x0B, 0x39, 0xBA, 0xAD, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xA6, 0x0E, 0x28, 0x4D, 0xE1, 0x3D, 0xE4, 0x1B ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xEC, 0x0A, 0xD4, 0xB8, 0xC4, 0x8D, 0xB0 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x3E, 0x68, 0xCE, 0xC2, 0x55, 0x4D, 0x0C, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x20, 0x93, 0x32, 0x90, 0xD6, 0xAE, 0x47 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x78, 0xAB, 0x43, 0x9E, 0xEB, 0x73, 0xAE ),
+    BYTES_TO_T_UINT_8( 0xED, 0x97, 0xC3, 0x83, 0xA6, 0x3C, 0xF1, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x0F, 0x25, 0x25, 0x66, 0x08, 0x26, 0xFA, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x41, 0xFB, 0x44, 0x5D, 0x82, 0xEC, 0x3B, 0xAC ),
+};
+static const mbedtls_mpi_uint secp384r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0x58, 0x90, 0xEA, 0xB5, 0x04, 0x99, 0xD0, 0x69 ),
+    BYTES_TO_T_UINT_8( 0x4A, 0xF2, 0x22, 0xA0, 0xEB, 0xFD, 0x45, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xA4, 0x81, 0x32, 0xFC, 0xFA, 0xEE, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x27, 0xBB, 0xA4, 0x6A, 0x77, 0x41, 0x5C, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xA1, 0x1E, 0xAA, 0x4F, 0xF0, 0x10, 0xB3, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x09, 0x74, 0x13, 0x14, 0x9E, 0x90, 0xD7, 0xE6 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0xDB, 0xBD, 0x70, 0x4F, 0xA8, 0xD1, 0x06, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x19, 0x4E, 0x2E, 0x68, 0xFC, 0x35, 0xFA, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x60, 0x53, 0x75, 0xED, 0xF2, 0x5F, 0xC2, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x39, 0x87, 0x6B, 0x9F, 0x05, 0xE2, 0x22, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x4F, 0x1A, 0xA8, 0xB7, 0x03, 0x9E, 0x6D, 0x7C ),
+    BYTES_TO_T_UINT_8( 0xCB, 0xD0, 0x69, 0x88, 0xA8, 0x39, 0x9E, 0x3A ),
+};
+static const mbedtls_mpi_uint secp384r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF8, 0xEF, 0x68, 0xFE, 0xEC, 0x24, 0x08, 0x15 ),
+    BYTES_TO_T_UINT_8( 0xA1, 0x06, 0x4B, 0x92, 0x0D, 0xB7, 0x34, 0x74 ),
+    BYTES_TO_T_UINT_8( 0x3E, 0xF4, 0xDD, 0x1A, 0xA0, 0x4A, 0xE4, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xC3, 0x63, 0x4F, 0x4F, 0xCE, 0xBB, 0xD6, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0xEE, 0x8D, 0xDF, 0x3F, 0x73, 0xB7, 0xAC ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x06, 0xB6, 0x80, 0x4D, 0x81, 0xD9, 0x53 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x15, 0xF5, 0x13, 0xDF, 0x13, 0x19, 0x97, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x08, 0xF9, 0xB3, 0x33, 0x66, 0x82, 0x21, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xFC, 0x39, 0x16, 0x23, 0x43, 0x76, 0x0E ),
+    BYTES_TO_T_UINT_8( 0x09, 0x48, 0x25, 0xA1, 0x64, 0x95, 0x1C, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x43, 0xAC, 0x15, 0x57, 0xD9, 0xDE, 0xA0, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x16, 0x5F, 0xB8, 0x3D, 0x48, 0x91, 0x24, 0xCC ),
+};
+static const mbedtls_mpi_uint secp384r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2D, 0xF2, 0xC8, 0x54, 0xD1, 0x32, 0xBD, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x3B, 0xF0, 0xAA, 0x9D, 0xD8, 0xF4, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x4F, 0xC3, 0xBB, 0x6C, 0x66, 0xAC, 0x25, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x25, 0x10, 0xB2, 0xE1, 0x41, 0xDE, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x3C, 0xE8, 0x30, 0xB8, 0x37, 0xBC, 0x2A, 0x98 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x57, 0x01, 0x4A, 0x1E, 0x78, 0x9F, 0x85 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0xBD, 0x19, 0xCD, 0x12, 0x0B, 0x51, 0x4F, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x4B, 0x3D, 0x24, 0xA4, 0x16, 0x59, 0x05 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xEB, 0xD3, 0x59, 0x2E, 0x75, 0x7C, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x8C, 0xB9, 0xB4, 0xA5, 0xD9, 0x2E, 0x29, 0x4C ),
+    BYTES_TO_T_UINT_8( 0x86, 0x16, 0x05, 0x75, 0x02, 0xB3, 0x06, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x7C, 0x9F, 0x79, 0x91, 0xF1, 0x4F, 0x23 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0x65, 0x98, 0x7C, 0x84, 0xE1, 0xFF, 0x30, 0x77 ),
+    BYTES_TO_T_UINT_8( 0x71, 0xE2, 0xC2, 0x5F, 0x55, 0x40, 0xBD, 0xCD ),
+    BYTES_TO_T_UINT_8( 0x69, 0x65, 0x87, 0x3F, 0xC4, 0xC2, 0x24, 0x57 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0x30, 0x0A, 0x60, 0x15, 0xD1, 0x24, 0x48 ),
+    BYTES_TO_T_UINT_8( 0x57, 0x99, 0xD9, 0xB6, 0xAE, 0xB1, 0xAF, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x80, 0xEE, 0xA2, 0x0F, 0x74, 0xB9, 0xF3 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x03, 0xE6, 0x0F, 0x37, 0xC1, 0x10, 0x99, 0x1E ),
+    BYTES_TO_T_UINT_8( 0x61, 0xAD, 0x9D, 0x5D, 0x80, 0x01, 0xA6, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x0F, 0x10, 0x2A, 0x9D, 0x20, 0x38, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x60, 0xCB, 0xCE, 0x5A, 0xA0, 0xA7, 0x32 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0xCF, 0x14, 0xDF, 0xBF, 0xE5, 0x74, 0x2D ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x12, 0x1A, 0xDD, 0x59, 0x02, 0x5D, 0xC6 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC8, 0xC9, 0xF8, 0xF5, 0xB6, 0x13, 0x4D, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xED, 0x45, 0xB1, 0x93, 0xB3, 0xA2, 0x79, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x74, 0xF6, 0xCF, 0xF7, 0xE6, 0x29, 0x9C, 0xCC ),
+    BYTES_TO_T_UINT_8( 0x87, 0x50, 0x65, 0x80, 0xBC, 0x59, 0x0A, 0x59 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0xF0, 0x24, 0x35, 0xA2, 0x46, 0xF0, 0x0C ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x26, 0xC0, 0x9D, 0x61, 0x56, 0x62, 0x67 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0x10, 0xBB, 0xC2, 0x24, 0x43, 0x2E, 0x37, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x8A, 0xF7, 0xCE, 0x35, 0xFC, 0x77, 0xF3, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x75, 0x34, 0x96, 0xD5, 0x4A, 0x76, 0x9D, 0x6B ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x3B, 0x0F, 0xEA, 0xA8, 0x12, 0x0B, 0x22 ),
+    BYTES_TO_T_UINT_8( 0x66, 0x3F, 0x5D, 0x2D, 0x1C, 0xD4, 0x9E, 0xFB ),
+    BYTES_TO_T_UINT_8( 0x7D, 0x2E, 0xDD, 0xC7, 0x6E, 0xAB, 0xAF, 0xDC ),
+};
+static const mbedtls_mpi_uint secp384r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8C, 0xB2, 0x7B, 0x0C, 0x9A, 0x83, 0x8E, 0x59 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x51, 0x90, 0x92, 0x79, 0x32, 0x19, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0xEE, 0x89, 0xF9, 0xD0, 0xCF, 0x2C, 0xA5, 0x8F ),
+    BYTES_TO_T_UINT_8( 0x7B, 0x50, 0x21, 0xDE, 0x50, 0x41, 0x9D, 0x81 ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x7D, 0x2B, 0x9E, 0x9D, 0x95, 0xA8, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0xD8, 0xA5, 0x20, 0x87, 0x88, 0x97, 0x5F, 0xAA ),
+};
+static const mbedtls_mpi_uint secp384r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x64, 0x59, 0xB4, 0x66, 0x7E, 0xE8, 0x5A, 0x60 ),
+    BYTES_TO_T_UINT_8( 0xA5, 0x5C, 0x7E, 0xB2, 0xAD, 0xD9, 0xC9, 0xDA ),
+    BYTES_TO_T_UINT_8( 0x82, 0x97, 0x49, 0xA3, 0x13, 0x83, 0x07, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x26, 0xC7, 0x13, 0x35, 0x0D, 0xB0, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x1E, 0x60, 0xAB, 0xFA, 0x4B, 0x93, 0x18, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x54, 0x2D, 0x1C, 0x31, 0x4C, 0xE4, 0x61, 0xAE ),
+};
+static const mbedtls_mpi_uint secp384r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDE, 0x4D, 0x1E, 0x51, 0x59, 0x6E, 0x91, 0xC5 ),
+    BYTES_TO_T_UINT_8( 0x38, 0x54, 0x4D, 0x51, 0xED, 0x36, 0xCC, 0x60 ),
+    BYTES_TO_T_UINT_8( 0x18, 0xA8, 0x56, 0xC7, 0x78, 0x27, 0x33, 0xC5 ),
+    BYTES_TO_T_UINT_8( 0x42, 0xB7, 0x95, 0xC9, 0x8B, 0xC8, 0x6A, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x5E, 0xE9, 0x13, 0x96, 0xB3, 0xE1, 0xF9, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xF5, 0x46, 0xB0, 0x5E, 0xC3, 0x94, 0x03, 0x05 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0x6D, 0x5B, 0x29, 0x30, 0x41, 0x1A, 0x9E, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x76, 0xCA, 0x83, 0x31, 0x5B, 0xA7, 0xCB, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x21, 0x41, 0x50, 0x44, 0x4D, 0x64, 0x31, 0x89 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0x84, 0xC2, 0x5D, 0x97, 0xA5, 0x3C, 0x18 ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x0F, 0xA5, 0xFD, 0x8E, 0x5A, 0x47, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x7C, 0x58, 0x02, 0x2D, 0x40, 0xB1, 0x0B, 0xBA ),
+};
+static const mbedtls_mpi_uint secp384r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDA, 0x33, 0x8C, 0x67, 0xCE, 0x23, 0x43, 0x99 ),
+    BYTES_TO_T_UINT_8( 0x84, 0x53, 0x47, 0x72, 0x44, 0x1F, 0x5B, 0x2A ),
+    BYTES_TO_T_UINT_8( 0xAE, 0xC1, 0xD9, 0xA4, 0x50, 0x88, 0x63, 0x18 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0xF2, 0x75, 0x69, 0x73, 0x00, 0xC4, 0x31 ),
+    BYTES_TO_T_UINT_8( 0x4B, 0x90, 0x1D, 0xDF, 0x1A, 0x00, 0xD8, 0x69 ),
+    BYTES_TO_T_UINT_8( 0x05, 0xB1, 0x89, 0x48, 0xA8, 0x70, 0x62, 0xEF ),
+};
+static const mbedtls_mpi_uint secp384r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0x7E, 0x8A, 0x55, 0x50, 0x7B, 0xEF, 0x8A, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x1B, 0x23, 0x48, 0x23, 0x63, 0x91, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x0D, 0x04, 0x54, 0x3C, 0x24, 0x9B, 0xC7, 0x9A ),
+    BYTES_TO_T_UINT_8( 0x25, 0x38, 0xC3, 0x84, 0xFB, 0xFF, 0x9F, 0x49 ),
+    BYTES_TO_T_UINT_8( 0x66, 0x2A, 0xE0, 0x6D, 0x68, 0x8A, 0x5C, 0xCB ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x93, 0x53, 0x85, 0xA1, 0x0D, 0xAF, 0x63 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1B, 0x88, 0x95, 0x4C, 0x0B, 0xD0, 0x06, 0x51 ),
+    BYTES_TO_T_UINT_8( 0x92, 0xAF, 0x8D, 0x49, 0xA2, 0xC8, 0xB4, 0xE0 ),
+    BYTES_TO_T_UINT_8( 0x75, 0x76, 0x53, 0x09, 0x88, 0x43, 0x87, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x90, 0xA4, 0x77, 0x3F, 0x5E, 0x21, 0xB4, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x35, 0x9E, 0x86, 0x64, 0xCC, 0x91, 0xC1, 0x77 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x17, 0x56, 0xCB, 0xC3, 0x7D, 0x5B, 0xB1 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x64, 0x74, 0x9F, 0xB5, 0x91, 0x21, 0xB1, 0x1C ),
+    BYTES_TO_T_UINT_8( 0x1E, 0xED, 0xE1, 0x11, 0xEF, 0x45, 0xAF, 0xC1 ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x31, 0xBE, 0xB2, 0xBC, 0x72, 0x65, 0x1F ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x4B, 0x8C, 0x77, 0xCE, 0x1E, 0x42, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0xC9, 0xAA, 0xB9, 0xD9, 0x86, 0x99, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x65, 0x23, 0x80, 0xC6, 0x4E, 0x35, 0x0B, 0x6D ),
+};
+static const mbedtls_mpi_uint secp384r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x47, 0xD8, 0xA2, 0x0A, 0x39, 0x32, 0x1D, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x61, 0xC8, 0x86, 0xF1, 0x12, 0x9A, 0x4A, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xF1, 0x7C, 0xAA, 0x70, 0x8E, 0xBC, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x62, 0x01, 0x47, 0x8F, 0xDD, 0x8B, 0xA5, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0xDB, 0x08, 0x21, 0xF4, 0xAB, 0xC7, 0xF5, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x0A, 0x76, 0xA5, 0x95, 0xC4, 0x0F, 0x88, 0x1D ),
+};
+static const mbedtls_mpi_uint secp384r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0x3F, 0x42, 0x2A, 0x52, 0xCD, 0x75, 0x51, 0x49 ),
+    BYTES_TO_T_UINT_8( 0x90, 0x36, 0xE5, 0x04, 0x2B, 0x44, 0xC6, 0xEF ),
+    BYTES_TO_T_UINT_8( 0x5C, 0xEE, 0x16, 0x13, 0x07, 0x83, 0xB5, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x76, 0x59, 0xC6, 0xA2, 0x19, 0x05, 0xD3, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x8B, 0xA8, 0x16, 0x09, 0xB7, 0xEA, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0x70, 0xEE, 0x14, 0xAF, 0xB5, 0xFD, 0xD0, 0xEF ),
+};
+static const mbedtls_mpi_uint secp384r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x18, 0x7C, 0xCA, 0x71, 0x3E, 0x6E, 0x66, 0x75 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0x31, 0x0E, 0x3F, 0xE5, 0x91, 0xC4, 0x7F ),
+    BYTES_TO_T_UINT_8( 0x8E, 0x3D, 0xC2, 0x3E, 0x95, 0x37, 0x58, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x01, 0x1F, 0x02, 0x03, 0xF3, 0xEF, 0xEE, 0x66 ),
+    BYTES_TO_T_UINT_8( 0x28, 0x5B, 0x1A, 0xFC, 0x38, 0xCD, 0xE8, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x12, 0x57, 0x42, 0x85, 0xC6, 0x21, 0x68, 0x71 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x8D, 0xA2, 0x4A, 0x66, 0xB1, 0x0A, 0xE6, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0x86, 0x0C, 0x94, 0x9D, 0x5E, 0x99, 0xB2, 0xCE ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x03, 0x40, 0xCA, 0xB2, 0xB3, 0x30, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x78, 0x48, 0x27, 0x34, 0x1E, 0xE2, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x72, 0x5B, 0xAC, 0xC1, 0x6D, 0xE3, 0x82 ),
+    BYTES_TO_T_UINT_8( 0x57, 0xAB, 0x46, 0xCB, 0xEA, 0x5E, 0x4B, 0x0B ),
+};
+static const mbedtls_mpi_uint secp384r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFC, 0x08, 0xAD, 0x4E, 0x51, 0x9F, 0x2A, 0x52 ),
+    BYTES_TO_T_UINT_8( 0x68, 0x5C, 0x7D, 0x4C, 0xD6, 0xCF, 0xDD, 0x02 ),
+    BYTES_TO_T_UINT_8( 0xD8, 0x76, 0x26, 0xE0, 0x8B, 0x10, 0xD9, 0x7C ),
+    BYTES_TO_T_UINT_8( 0x30, 0xA7, 0x23, 0x4E, 0x5F, 0xD2, 0x42, 0x17 ),
+    BYTES_TO_T_UINT_8( 0xD1, 0xE5, 0xA4, 0xEC, 0x77, 0x21, 0x34, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x5C, 0x14, 0x65, 0xEA, 0x4A, 0x85, 0xC3, 0x2F ),
+};
+static const mbedtls_mpi_uint secp384r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0x19, 0xD8, 0x40, 0x27, 0x73, 0x15, 0x7E, 0x65 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xBB, 0x53, 0x7E, 0x0F, 0x40, 0xC8, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0x37, 0x19, 0x73, 0xEF, 0x5A, 0x5E, 0x04 ),
+    BYTES_TO_T_UINT_8( 0x9C, 0x73, 0x2B, 0x49, 0x7E, 0xAC, 0x97, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x15, 0xB2, 0xC3, 0x1E, 0x0E, 0xE7, 0xD2, 0x21 ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x08, 0xD6, 0xDD, 0xAC, 0x21, 0xD6, 0x3E ),
+};
+static const mbedtls_mpi_uint secp384r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA9, 0x26, 0xBE, 0x6D, 0x6D, 0xF2, 0x38, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x08, 0x6C, 0x31, 0xA7, 0x49, 0x50, 0x3A, 0x89 ),
+    BYTES_TO_T_UINT_8( 0xC3, 0x99, 0xC6, 0xF5, 0xD2, 0xC2, 0x30, 0x5A ),
+    BYTES_TO_T_UINT_8( 0x2A, 0xE4, 0xF6, 0x8B, 0x8B, 0x97, 0xE9, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x21, 0xB7, 0x0D, 0xFC, 0x15, 0x54, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x65, 0x83, 0x1C, 0xA4, 0xCD, 0x6B, 0x9D, 0xF2 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0xD6, 0xE8, 0x4C, 0x48, 0xE4, 0xAA, 0x69, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x27, 0x7A, 0x27, 0xFC, 0x37, 0x96, 0x1A, 0x7B ),
+    BYTES_TO_T_UINT_8( 0x6F, 0xE7, 0x30, 0xA5, 0xCF, 0x13, 0x46, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x8C, 0xD8, 0xAF, 0x74, 0x23, 0x4D, 0x56, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x32, 0x3D, 0x44, 0x14, 0x1B, 0x97, 0x83, 0xF0 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x47, 0xD7, 0x5F, 0xFD, 0x98, 0x38, 0xF7 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA3, 0x73, 0x64, 0x36, 0xFD, 0x7B, 0xC1, 0x15 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0x5D, 0x32, 0xD2, 0x47, 0x94, 0x89, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x51, 0xE9, 0x30, 0xAC, 0x06, 0xC8, 0x65, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x6C, 0xB9, 0x1B, 0xF7, 0x61, 0x49, 0x53 ),
+    BYTES_TO_T_UINT_8( 0xD7, 0xFF, 0x32, 0x43, 0x80, 0xDA, 0xA6, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xF8, 0x04, 0x01, 0x95, 0x35, 0xCE, 0x21 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x6D, 0x06, 0x46, 0x0D, 0x51, 0xE2, 0xD8, 0xAC ),
+    BYTES_TO_T_UINT_8( 0x14, 0x57, 0x1D, 0x6F, 0x79, 0xA0, 0xCD, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0xDF, 0xFB, 0x36, 0xCA, 0xAD, 0xF5, 0x9E, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x7A, 0x1D, 0x9E, 0x1D, 0x95, 0x48, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x81, 0x26, 0xA5, 0xB7, 0x15, 0x2C, 0xC2, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0x86, 0x42, 0x72, 0xAA, 0x11, 0xDC, 0xC9, 0xB6 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0x3F, 0x6C, 0x64, 0xA7, 0x62, 0x3C, 0xAB, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x6A, 0x44, 0xD8, 0x60, 0xC0, 0xA8, 0x80 ),
+    BYTES_TO_T_UINT_8( 0x82, 0x76, 0x58, 0x12, 0x57, 0x3C, 0x89, 0x46 ),
+    BYTES_TO_T_UINT_8( 0x82, 0x4F, 0x83, 0xCE, 0xCB, 0xB8, 0xD0, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x84, 0x04, 0xB0, 0xAD, 0xEB, 0xFA, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x34, 0xA4, 0xC3, 0x41, 0x44, 0x4E, 0x65, 0x3E ),
+};
+static const mbedtls_mpi_uint secp384r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0xB6, 0x16, 0xA9, 0x1C, 0xE7, 0x65, 0x20, 0xC1 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x53, 0x32, 0xF8, 0xC0, 0xA6, 0xBD, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xB7, 0xF0, 0xE6, 0x57, 0x31, 0xCC, 0x26, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x27, 0xE3, 0x54, 0x1C, 0x34, 0xD3, 0x17, 0xBC ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xAE, 0xED, 0xFB, 0xCD, 0xE7, 0x1E, 0x9F ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x16, 0x1C, 0x34, 0x40, 0x00, 0x1F, 0xB6 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0x6A, 0x32, 0x00, 0xC2, 0xD4, 0x3B, 0x1A, 0x09 ),
+    BYTES_TO_T_UINT_8( 0x34, 0xE0, 0x99, 0x8F, 0x0C, 0x4A, 0x16, 0x44 ),
+    BYTES_TO_T_UINT_8( 0x83, 0x73, 0x18, 0x1B, 0xD4, 0x94, 0x29, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x29, 0xA4, 0x2D, 0xB1, 0x9D, 0x74, 0x32, 0x67 ),
+    BYTES_TO_T_UINT_8( 0xBF, 0xF4, 0xB1, 0x0C, 0x37, 0x62, 0x8B, 0x66 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0xFF, 0xDA, 0xE2, 0x35, 0xA3, 0xB6, 0x42 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0x91, 0x49, 0x99, 0x65, 0xC5, 0xED, 0x16, 0xEF ),
+    BYTES_TO_T_UINT_8( 0x79, 0x42, 0x9A, 0xF3, 0xA7, 0x4E, 0x6F, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x7B, 0x0A, 0x7E, 0xC0, 0xD7, 0x4E, 0x07, 0x55 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x7A, 0x31, 0x69, 0xA6, 0xB9, 0x15, 0x34 ),
+    BYTES_TO_T_UINT_8( 0xA8, 0xE0, 0x72, 0xA4, 0x3F, 0xB9, 0xF8, 0x0C ),
+    BYTES_TO_T_UINT_8( 0x2B, 0x75, 0x32, 0x85, 0xA2, 0xDE, 0x37, 0x12 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0xBC, 0xC0, 0x0D, 0xCF, 0x25, 0x41, 0xA4, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0xFC, 0xB2, 0x48, 0xC3, 0x85, 0x83, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xBE, 0x0B, 0x58, 0x2D, 0x7A, 0x9A, 0x62 ),
+    BYTES_TO_T_UINT_8( 0xC5, 0xF3, 0x81, 0x18, 0x1B, 0x74, 0x4F, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xE2, 0x43, 0xA3, 0x0A, 0x16, 0x8B, 0xA3, 0x1E ),
+    BYTES_TO_T_UINT_8( 0x4A, 0x18, 0x81, 0x7B, 0x8D, 0xA2, 0x35, 0x77 ),
+};
+static const mbedtls_mpi_uint secp384r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0x86, 0xC4, 0x3F, 0x2C, 0xE7, 0x5F, 0x99, 0x03 ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x2B, 0xB7, 0xB6, 0xAD, 0x5A, 0x56, 0xFF ),
+    BYTES_TO_T_UINT_8( 0x04, 0x00, 0xA4, 0x48, 0xC8, 0xE8, 0xBA, 0xBF ),
+    BYTES_TO_T_UINT_8( 0xE8, 0xA1, 0xB5, 0x13, 0x5A, 0xCD, 0x99, 0x9C ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x95, 0xAD, 0xFC, 0xE2, 0x7E, 0xE7, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x96, 0x6B, 0xD1, 0x34, 0x99, 0x53, 0x63, 0x0B ),
+};
+static const mbedtls_mpi_uint secp384r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0x19, 0x8A, 0x77, 0x5D, 0x2B, 0xAB, 0x01, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x85, 0xD0, 0xD5, 0x49, 0x83, 0x4D, 0x60 ),
+    BYTES_TO_T_UINT_8( 0x81, 0xC6, 0x91, 0x30, 0x3B, 0x00, 0xAF, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x3A, 0xAE, 0x61, 0x07, 0xE1, 0xB6, 0xE2, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x95, 0x43, 0x41, 0xFE, 0x9B, 0xB6, 0xF0, 0xA5 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x97, 0xAE, 0xAD, 0x89, 0x88, 0x9E, 0x41 ),
+};
+static const mbedtls_ecp_point secp384r1_T[32] = {
+    ECP_POINT_INIT_XY( secp384r1_T_0_X, secp384r1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_1_X, secp384r1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_2_X, secp384r1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_3_X, secp384r1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_4_X, secp384r1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_5_X, secp384r1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_6_X, secp384r1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_7_X, secp384r1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_8_X, secp384r1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_9_X, secp384r1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_10_X, secp384r1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_11_X, secp384r1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_12_X, secp384r1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_13_X, secp384r1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_14_X, secp384r1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_15_X, secp384r1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_16_X, secp384r1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_17_X, secp384r1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_18_X, secp384r1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_19_X, secp384r1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_20_X, secp384r1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_21_X, secp384r1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_22_X, secp384r1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_23_X, secp384r1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_24_X, secp384r1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_25_X, secp384r1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_26_X, secp384r1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_27_X, secp384r1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_28_X, secp384r1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_29_X, secp384r1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_30_X, secp384r1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp384r1_T_31_X, secp384r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP384R1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_SECP521R1_ENABLED)
+static const mbedtls_mpi_uint secp521r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x66, 0xBD, 0xE5, 0xC2, 0x31, 0x7E, 0x7E, 0xF9 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x42, 0x6A, 0x85, 0xC1, 0xB3, 0x48, 0x33 ),
+    BYTES_TO_T_UINT_8( 0xDE, 0xA8, 0xFF, 0xA2, 0x27, 0xC1, 0x1D, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x28, 0x59, 0xE7, 0xEF, 0x77, 0x5E, 0x4B, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x3D, 0x4D, 0x6B, 0x60, 0xAF, 0x28, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0x21, 0xB5, 0x3F, 0x05, 0x39, 0x81, 0x64, 0x9C ),
+    BYTES_TO_T_UINT_8( 0x42, 0xB4, 0x95, 0x23, 0x66, 0xCB, 0x3E, 0x9E ),
+    BYTES_TO_T_UINT_8( 0xCD, 0xE9, 0x04, 0x04, 0xB7, 0x06, 0x8E, 0x85 ),
+    BYTES_TO_T_UINT_2( 0xC6, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0x66, 0xD1, 0x9F, 0x76, 0x94, 0xBE, 0x88 ),
+    BYTES_TO_T_UINT_8( 0x40, 0xC2, 0x72, 0xA2, 0x86, 0x70, 0x3C, 0x35 ),
+    BYTES_TO_T_UINT_8( 0x61, 0x07, 0xAD, 0x3F, 0x01, 0xB9, 0x50, 0xC5 ),
+    BYTES_TO_T_UINT_8( 0x40, 0x26, 0xF4, 0x5E, 0x99, 0x72, 0xEE, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x2C, 0x66, 0x3E, 0x27, 0x17, 0xBD, 0xAF, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x68, 0x44, 0x9B, 0x57, 0x49, 0x44, 0xF5, 0x98 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x1B, 0x7D, 0x2C, 0xB4, 0x5F, 0x8A, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x04, 0xC0, 0x3B, 0x9A, 0x78, 0x6A, 0x29, 0x39 ),
+    BYTES_TO_T_UINT_2( 0x18, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0x2F, 0xB1, 0x2D, 0xEB, 0x27, 0x2F, 0xE8, 0xDA ),
+    BYTES_TO_T_UINT_8( 0x98, 0x4B, 0x44, 0x25, 0xDB, 0x5C, 0x5F, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x13, 0x85, 0x28, 0x78, 0x2E, 0x75, 0x34, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x69, 0x57, 0x0F, 0x73, 0x78, 0x7A, 0xE3, 0x53 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xD8, 0xEC, 0xDC, 0xDA, 0x04, 0xAD, 0xAB ),
+    BYTES_TO_T_UINT_8( 0x34, 0x8A, 0x09, 0xF3, 0x58, 0x79, 0xD8, 0x29 ),
+    BYTES_TO_T_UINT_8( 0x63, 0x03, 0xCB, 0x50, 0x1A, 0x7F, 0x56, 0x00 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xA6, 0x78, 0x38, 0x85, 0x67, 0x0B, 0x40 ),
+    BYTES_TO_T_UINT_2( 0x83, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8A, 0xD5, 0xD2, 0x22, 0xC4, 0x00, 0x3B, 0xBA ),
+    BYTES_TO_T_UINT_8( 0xD5, 0x93, 0x0E, 0x7B, 0x85, 0x51, 0xC3, 0x06 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xA6, 0x5F, 0x54, 0x49, 0x02, 0x81, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x22, 0xE9, 0x6B, 0x3A, 0x92, 0xE7, 0x72, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x5F, 0x28, 0x9E, 0x91, 0x27, 0x88, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0xEF, 0x28, 0x31, 0xB3, 0x84, 0xCA, 0x12, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xF9, 0xAC, 0x22, 0x10, 0x0A, 0x64, 0x41 ),
+    BYTES_TO_T_UINT_8( 0xE9, 0xC6, 0x33, 0x1F, 0x69, 0x19, 0x18, 0xBF ),
+    BYTES_TO_T_UINT_2( 0xBE, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0xA0, 0x48, 0xB8, 0xC7, 0x37, 0x5A, 0x00, 0x36 ),
+    BYTES_TO_T_UINT_8( 0x07, 0xCC, 0x32, 0xE0, 0xEE, 0x03, 0xC2, 0xBA ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x29, 0xC2, 0xE4, 0x6E, 0x24, 0x20, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x06, 0x6B, 0x7F, 0x7B, 0xF9, 0xB0, 0xB8, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x7B, 0x3C, 0xE1, 0x19, 0xA1, 0x23, 0x02 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0xE3, 0xC2, 0x53, 0xC0, 0x07, 0x13, 0xA9 ),
+    BYTES_TO_T_UINT_8( 0x07, 0xFE, 0x36, 0x35, 0x9F, 0x5E, 0x59, 0xCE ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x55, 0x89, 0x84, 0xBC, 0xEF, 0xA2, 0xC2 ),
+    BYTES_TO_T_UINT_2( 0x19, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFD, 0x1A, 0x08, 0x67, 0xB4, 0xE7, 0x22, 0xED ),
+    BYTES_TO_T_UINT_8( 0x76, 0x26, 0xDF, 0x81, 0x3C, 0x5F, 0x1C, 0xDA ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x4D, 0xD0, 0x0A, 0x48, 0x06, 0xF4, 0x48 ),
+    BYTES_TO_T_UINT_8( 0x73, 0x18, 0x39, 0xF7, 0xD1, 0x20, 0x77, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x78, 0x8F, 0x44, 0x13, 0xCB, 0x78, 0x11, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x33, 0xE2, 0x49, 0xEA, 0x43, 0x79, 0x08, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x01, 0xD1, 0xD8, 0x73, 0x2C, 0x71, 0x2F, 0x69 ),
+    BYTES_TO_T_UINT_8( 0x21, 0xE5, 0xE7, 0xF4, 0x46, 0xAB, 0x20, 0xCA ),
+    BYTES_TO_T_UINT_2( 0x5A, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x8C, 0x0B, 0xB9, 0x71, 0x1A, 0x27, 0xB7, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0xA2, 0x2C, 0xD1, 0xDA, 0xBC, 0xC1, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x10, 0xA3, 0x10, 0x1F, 0x90, 0xF2, 0xA5, 0x52 ),
+    BYTES_TO_T_UINT_8( 0x28, 0xFB, 0x20, 0xF4, 0xC0, 0x70, 0xC0, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0xA7, 0x99, 0xF0, 0xA5, 0xD3, 0x09, 0xDD ),
+    BYTES_TO_T_UINT_8( 0x26, 0xE8, 0x14, 0x39, 0xBE, 0xCB, 0x60, 0xAF ),
+    BYTES_TO_T_UINT_8( 0x9F, 0xD6, 0x14, 0xA9, 0xC9, 0x20, 0xC3, 0xEA ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xA8, 0x5B, 0xFD, 0x2D, 0x96, 0xBC, 0x78 ),
+    BYTES_TO_T_UINT_2( 0xC0, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9D, 0x04, 0x45, 0xBE, 0xCE, 0x75, 0x95, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xCC, 0xDA, 0x58, 0x49, 0x35, 0x09, 0x8D, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x76, 0xF0, 0xC0, 0x36, 0xF2, 0xA6, 0x2D, 0x14 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0xFC, 0x3D, 0xA8, 0xFB, 0x3C, 0xD2, 0x51 ),
+    BYTES_TO_T_UINT_8( 0x01, 0x4D, 0x71, 0x09, 0x18, 0x42, 0xF0, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xC1, 0xCE, 0x9E, 0x6A, 0x49, 0x60, 0x12 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0xB1, 0x00, 0xF7, 0xA1, 0x7A, 0x31, 0xB4 ),
+    BYTES_TO_T_UINT_8( 0x41, 0xC3, 0x86, 0xCD, 0x20, 0x4A, 0x17, 0x86 ),
+    BYTES_TO_T_UINT_2( 0x6C, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0x98, 0xAB, 0x8B, 0x47, 0x8D, 0xAA, 0xA6, 0x5B ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x97, 0xF0, 0xBC, 0x2D, 0xDC, 0x9D, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x01, 0x86, 0xB0, 0x74, 0xB2, 0xF4, 0xF6, 0x67 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xBD, 0xAC, 0xE3, 0x8F, 0x43, 0x5C, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0x37, 0xC3, 0xE2, 0x6E, 0x25, 0x49, 0xCD, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x64, 0x5E, 0x08, 0xB3, 0xB9, 0xAC, 0x5F, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x08, 0xB7, 0xD1, 0xF4, 0xDC, 0x19, 0xE9, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x49, 0xE4, 0xFA, 0xE1, 0x36, 0x3E, 0xED, 0x6E ),
+    BYTES_TO_T_UINT_2( 0x0A, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0x00, 0x67, 0x92, 0x84, 0x6E, 0x48, 0x03, 0x51 ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x95, 0xEF, 0x8F, 0xB2, 0x82, 0x6B, 0x1C ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xFA, 0xB9, 0x55, 0x23, 0xFE, 0x09, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0xEF, 0x79, 0x85, 0x4B, 0x0E, 0xD4, 0x35, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x27, 0x45, 0x81, 0xE0, 0x88, 0x52, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x17, 0x63, 0xA2, 0x4B, 0xBC, 0x5D, 0xB1, 0x92 ),
+    BYTES_TO_T_UINT_8( 0x28, 0x8C, 0x83, 0xD9, 0x3E, 0xD3, 0x42, 0xDA ),
+    BYTES_TO_T_UINT_8( 0x99, 0x03, 0x3A, 0x31, 0xBA, 0xE9, 0x3A, 0xD1 ),
+    BYTES_TO_T_UINT_2( 0x47, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x35, 0x10, 0xCD, 0x2D, 0x00, 0xFE, 0x32, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0xE4, 0x6E, 0x1F, 0xDA, 0xF8, 0x6F, 0x4D, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x09, 0x79, 0x7D, 0x09, 0xE5, 0xD3, 0x03, 0x21 ),
+    BYTES_TO_T_UINT_8( 0x58, 0xC3, 0xBE, 0xDF, 0x07, 0x65, 0x49, 0xCC ),
+    BYTES_TO_T_UINT_8( 0x08, 0x57, 0x33, 0xEF, 0xAE, 0x4F, 0x04, 0x27 ),
+    BYTES_TO_T_UINT_8( 0x9A, 0xE9, 0x9B, 0xFE, 0xBF, 0xE6, 0x85, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xBD, 0xBA, 0xAA, 0x06, 0xC4, 0xC6, 0xB8, 0x57 ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x83, 0x01, 0xA9, 0xF6, 0x51, 0xE7, 0xB8 ),
+    BYTES_TO_T_UINT_2( 0x1B, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB9, 0xA6, 0x15, 0x8E, 0xAB, 0x1F, 0x10, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x08, 0x27, 0x1A, 0xA1, 0x21, 0xAD, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x02, 0x09, 0x90, 0x6E, 0x50, 0x90, 0x9A, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x86, 0x9A, 0xFE, 0xD7, 0xA1, 0xF5, 0xA2, 0x15 ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x7D, 0xE3, 0xDC, 0x21, 0xFB, 0xA4, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xB9, 0xBF, 0x07, 0xFF, 0x45, 0xDF, 0x51, 0x77 ),
+    BYTES_TO_T_UINT_8( 0x0B, 0x5C, 0x34, 0x02, 0x62, 0x9B, 0x08, 0x12 ),
+    BYTES_TO_T_UINT_8( 0x86, 0xCE, 0x9A, 0x6A, 0xEC, 0x75, 0xF6, 0x46 ),
+    BYTES_TO_T_UINT_2( 0x6D, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0xE6, 0x59, 0xF4, 0x78, 0x3C, 0x60, 0xB1, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x3E, 0x37, 0x84, 0x6A, 0xDC, 0xF2, 0x9A, 0x7D ),
+    BYTES_TO_T_UINT_8( 0x40, 0x9A, 0x9A, 0x15, 0x36, 0xE0, 0x2B, 0x2D ),
+    BYTES_TO_T_UINT_8( 0xEC, 0x38, 0x9C, 0x50, 0x3D, 0x1E, 0x37, 0x82 ),
+    BYTES_TO_T_UINT_8( 0xB7, 0x79, 0xF0, 0x92, 0xF2, 0x8B, 0x18, 0x82 ),
+    BYTES_TO_T_UINT_8( 0x17, 0xE0, 0x82, 0x1E, 0x80, 0x82, 0x4B, 0xD7 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0xBB, 0x59, 0x6B, 0x8A, 0x77, 0x41, 0x40 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0xF9, 0xD4, 0xB8, 0x4A, 0x82, 0xCF, 0x40 ),
+    BYTES_TO_T_UINT_2( 0x5D, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1E, 0x8C, 0xC8, 0x9B, 0x72, 0x9E, 0xF7, 0xF9 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0xCE, 0xE9, 0x77, 0x0A, 0x19, 0x59, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x9D, 0xA1, 0x41, 0x6A, 0x72, 0x4B, 0xB4, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x0B, 0x35, 0x43, 0xE2, 0x8C, 0xBE, 0x0D, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0xEB, 0xAD, 0xF3, 0xA9, 0xA6, 0x68, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x2F, 0xE2, 0x48, 0x0C, 0xDB, 0x1F, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xD1, 0x1E, 0x60, 0x9B, 0x2A, 0xD2, 0xC1, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xC0, 0x64, 0xB5, 0xD2, 0xF6, 0xF6, 0x6E, 0x22 ),
+    BYTES_TO_T_UINT_2( 0x70, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0xC6, 0x3D, 0x30, 0x78, 0x10, 0x18, 0x41, 0x51 ),
+    BYTES_TO_T_UINT_8( 0x96, 0x1D, 0x1C, 0xE0, 0x6D, 0x83, 0xD1, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x7B, 0x03, 0x0B, 0xF5, 0x2F, 0x6C, 0x04, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x3E, 0xD5, 0xFC, 0x31, 0x5B, 0x3A, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x50, 0x82, 0x2F, 0xFB, 0xFE, 0xF8, 0x76, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x85, 0x26, 0xDA, 0x9C, 0x36, 0xF5, 0x93, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x4C, 0xE7, 0x6E, 0xD2, 0x7D, 0x81, 0x09, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0xD3, 0x03, 0xF9, 0x58, 0x48, 0x24, 0xA2, 0xEE ),
+    BYTES_TO_T_UINT_2( 0xE9, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1B, 0x79, 0x0C, 0x8E, 0x6B, 0x95, 0xF3, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x10, 0x5C, 0x87, 0x03, 0x39, 0xCF, 0x68 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0xF0, 0xF7, 0xC1, 0x07, 0xA4, 0xF4, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x32, 0xE8, 0x02, 0x89, 0x65, 0xC4, 0x72, 0x36 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x88, 0xEA, 0x96, 0x67, 0x0B, 0x5D, 0xDF ),
+    BYTES_TO_T_UINT_8( 0xA8, 0x75, 0x60, 0xA8, 0xBD, 0x74, 0xDF, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x6E, 0xE5, 0x71, 0x50, 0x67, 0xD0, 0xD2, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0xFC, 0xE5, 0xC7, 0x77, 0xB0, 0x7F, 0x8C ),
+    BYTES_TO_T_UINT_2( 0xF1, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x97, 0x86, 0x69, 0xCD, 0x0D, 0x9A, 0xBD, 0x66 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x17, 0xBC, 0xBB, 0x59, 0x85, 0x7D, 0x0E ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xA8, 0x76, 0xAC, 0x80, 0xA9, 0x72, 0xE0 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x78, 0xC1, 0xE2, 0x4D, 0xAF, 0xF9, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x97, 0x8E, 0x74, 0xC4, 0x4B, 0xB2, 0x85 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0xD8, 0xF6, 0xF3, 0xAF, 0x2F, 0x52, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x95, 0x57, 0xF4, 0xCE, 0xEE, 0x43, 0xED, 0x60 ),
+    BYTES_TO_T_UINT_8( 0x7D, 0x46, 0x38, 0xDE, 0x20, 0xFD, 0x59, 0x18 ),
+    BYTES_TO_T_UINT_2( 0xD7, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1C, 0x18, 0xE8, 0x58, 0xB9, 0x76, 0x2C, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0xED, 0x54, 0xE4, 0xFE, 0xC7, 0xBC, 0x31, 0x37 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xF8, 0x89, 0xEE, 0x70, 0xB5, 0xB0, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x83, 0x22, 0x26, 0x9A, 0x53, 0xB9, 0x38, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x74, 0xA7, 0x19, 0x8C, 0x74, 0x7E, 0x88, 0x46 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0xDA, 0x0A, 0xE8, 0xDA, 0xA5, 0xBE, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x90, 0x5C, 0xF7, 0xB1, 0x0C, 0x72, 0xFB, 0x09 ),
+    BYTES_TO_T_UINT_8( 0x78, 0xE2, 0x23, 0xE7, 0x46, 0xB7, 0xE0, 0x91 ),
+    BYTES_TO_T_UINT_2( 0xC5, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0x3A, 0x36, 0xBC, 0xBD, 0x48, 0x11, 0x8E, 0x72 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0xBB, 0xA1, 0xF7, 0x0B, 0x9E, 0xBF, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x68, 0x28, 0xE1, 0xA2, 0x8F, 0xFC, 0xFC, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0x81, 0xFE, 0x19, 0x0A, 0xE5, 0xE7, 0x69, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0xCD, 0x12, 0xF5, 0xBE, 0xD3, 0x04, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xA8, 0x0D, 0x81, 0x59, 0xC4, 0x79, 0x98 ),
+    BYTES_TO_T_UINT_8( 0xA3, 0xF3, 0x4B, 0x92, 0x65, 0xC3, 0x31, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x75, 0xB5, 0x4F, 0x4D, 0x91, 0xD4, 0xE2, 0xB2 ),
+    BYTES_TO_T_UINT_2( 0x51, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0x72, 0x09, 0x41, 0x79, 0x1D, 0x4D, 0x0D, 0x33 ),
+    BYTES_TO_T_UINT_8( 0xBB, 0x31, 0x18, 0xBA, 0xA0, 0xF2, 0x6E, 0x7E ),
+    BYTES_TO_T_UINT_8( 0x93, 0x5B, 0x4D, 0x4F, 0xAF, 0xC9, 0x8C, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x99, 0x9C, 0x06, 0x68, 0xDE, 0xD8, 0x29 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x04, 0xE1, 0xB5, 0x9D, 0x00, 0xBC, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x61, 0x95, 0x92, 0x8D, 0x72, 0xD3, 0x37, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x4B, 0x27, 0xA2, 0xE8, 0xA4, 0x26, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x4F, 0x45, 0x9C, 0xA9, 0xCB, 0x9F, 0xBA, 0x85 ),
+    BYTES_TO_T_UINT_2( 0xCB, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0x08, 0x7E, 0x1B, 0x64, 0xF4, 0xE8, 0xA5, 0x55 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x20, 0xA9, 0xCA, 0xF3, 0x89, 0xE5, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x83, 0xED, 0xFC, 0xAB, 0xD9, 0x0A, 0xB9, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x08, 0x6F, 0x46, 0x7C, 0xCD, 0x78, 0xFF, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x69, 0xAB, 0x71, 0x5A, 0x94, 0xAB, 0x20, 0x20 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x2E, 0xEE, 0x87, 0x57, 0x1F, 0xAD, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x4C, 0x3D, 0xFB, 0x7E, 0xA1, 0x8B, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x69, 0xCF, 0x07, 0x86, 0xBA, 0x53, 0x37, 0xCF ),
+    BYTES_TO_T_UINT_2( 0x38, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x00, 0x26, 0xB2, 0xB9, 0xE2, 0x91, 0xE3, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x79, 0xC9, 0x54, 0x84, 0x08, 0x3D, 0x0B, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xA8, 0x77, 0x2F, 0x64, 0x45, 0x99, 0x4C ),
+    BYTES_TO_T_UINT_8( 0x87, 0x96, 0x16, 0x1F, 0xDB, 0x96, 0x28, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x83, 0x2B, 0x8D, 0xFF, 0xA2, 0x4F, 0x55, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0x71, 0xE6, 0x48, 0xBD, 0x99, 0x3D, 0x12, 0x57 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0x84, 0x59, 0xDA, 0xB9, 0xB6, 0x66, 0x12 ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x78, 0x41, 0x92, 0xDF, 0xF4, 0x3F, 0x63 ),
+    BYTES_TO_T_UINT_2( 0x1F, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0x7E, 0x86, 0x6F, 0x4F, 0xBF, 0x67, 0xDF, 0x2F ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x2B, 0x1E, 0x5F, 0x00, 0xEA, 0xF6, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x90, 0xB9, 0x6A, 0x89, 0xD8, 0xC0, 0xD7, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0xCB, 0x9A, 0x32, 0x23, 0xA0, 0x02, 0x91, 0x58 ),
+    BYTES_TO_T_UINT_8( 0x42, 0x7F, 0x6A, 0x15, 0x64, 0x6A, 0x8B, 0xBB ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x57, 0x82, 0x58, 0xA9, 0x56, 0xB5, 0xFB ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x50, 0x92, 0x60, 0xCC, 0x81, 0x24, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0x36, 0x3D, 0xAD, 0xDA, 0xD9, 0x51, 0x3E, 0x57 ),
+    BYTES_TO_T_UINT_2( 0x5D, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEC, 0xFE, 0x8F, 0xB0, 0x0B, 0xDE, 0x2E, 0x7E ),
+    BYTES_TO_T_UINT_8( 0x79, 0xD2, 0xBE, 0xEF, 0xAC, 0x76, 0x71, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x55, 0xE8, 0x72, 0x0B, 0xAC, 0xFE, 0xCA, 0x5A ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x5B, 0xC7, 0xFC, 0xE3, 0x3C, 0x7C, 0x4C ),
+    BYTES_TO_T_UINT_8( 0xA1, 0x04, 0xA7, 0xB9, 0x9B, 0x93, 0xC0, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x41, 0x48, 0x4B, 0x8E, 0x32, 0xC5, 0xF0, 0x6B ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x42, 0x07, 0xC1, 0xF2, 0xF1, 0x72, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x1E, 0x37, 0x54, 0x9C, 0x88, 0xD2, 0x62, 0xAA ),
+    BYTES_TO_T_UINT_2( 0xC1, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0xC2, 0x19, 0x8A, 0x89, 0x58, 0xA2, 0x0F, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x01, 0xCC, 0x4C, 0x97, 0x30, 0x66, 0x34, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x83, 0x6A, 0x1E, 0x1F, 0xDB, 0xC9, 0x5E, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x1B, 0x4D, 0x49, 0xFF, 0x9B, 0x9C, 0xAC, 0x9B ),
+    BYTES_TO_T_UINT_8( 0xD7, 0xE4, 0x4B, 0xF2, 0xD4, 0x1A, 0xD2, 0x78 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0xDA, 0xE8, 0x61, 0x9F, 0xC8, 0x49, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x51, 0xCB, 0xF2, 0x2D, 0x85, 0xF6, 0x8D, 0x52 ),
+    BYTES_TO_T_UINT_8( 0xB7, 0xC5, 0xCD, 0x2C, 0x79, 0xC6, 0x0E, 0x4F ),
+    BYTES_TO_T_UINT_2( 0xDB, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0x73, 0x1D, 0x55, 0x0F, 0xF8, 0x22, 0x9F, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x76, 0x56, 0xBA, 0xE7, 0x57, 0x32, 0xEC, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x65, 0x9A, 0xC6, 0x4C, 0x09, 0xC4, 0x52, 0x3F ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x1E, 0x6F, 0xF4, 0x7D, 0x27, 0xDD, 0xAF ),
+    BYTES_TO_T_UINT_8( 0x94, 0x11, 0x16, 0xEC, 0x79, 0x83, 0xAD, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x46, 0x4E, 0x92, 0x1F, 0x19, 0x7D, 0x65, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x09, 0xFF, 0x78, 0x15, 0x45, 0x63, 0x32, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0xBF, 0x91, 0xD0, 0x78, 0x58, 0xDA, 0x50, 0x47 ),
+    BYTES_TO_T_UINT_2( 0x73, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x23, 0xDE, 0x40, 0xF6, 0x41, 0xB4, 0x3B, 0x95 ),
+    BYTES_TO_T_UINT_8( 0xC6, 0x8D, 0xE0, 0xE1, 0xA9, 0xF0, 0x35, 0x5D ),
+    BYTES_TO_T_UINT_8( 0xE6, 0xD4, 0xBA, 0x7B, 0xCC, 0x1B, 0x3A, 0x32 ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x5A, 0x2E, 0x74, 0x47, 0x14, 0xC3, 0x4D ),
+    BYTES_TO_T_UINT_8( 0x7D, 0xF0, 0x8B, 0x06, 0x15, 0x8E, 0x0E, 0xCA ),
+    BYTES_TO_T_UINT_8( 0xB5, 0xD2, 0xEB, 0x97, 0x50, 0x7D, 0x31, 0xFC ),
+    BYTES_TO_T_UINT_8( 0x42, 0x93, 0x4C, 0xDB, 0x97, 0x79, 0x44, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x9C, 0xA2, 0xA0, 0x0B, 0xC8, 0x3A, 0x8A, 0xF9 ),
+    BYTES_TO_T_UINT_2( 0x61, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0x50, 0x92, 0x9E, 0x24, 0x1F, 0xCB, 0x4C ),
+    BYTES_TO_T_UINT_8( 0xD3, 0x16, 0xC9, 0xC5, 0x3D, 0x5A, 0xAF, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x18, 0xE3, 0x97, 0xE4, 0xA8, 0x50, 0xF6, 0x7E ),
+    BYTES_TO_T_UINT_8( 0x45, 0x57, 0x97, 0x42, 0x78, 0x92, 0x49, 0x0D ),
+    BYTES_TO_T_UINT_8( 0xA5, 0xEB, 0x62, 0x24, 0xFB, 0x8F, 0x32, 0xCF ),
+    BYTES_TO_T_UINT_8( 0xF3, 0x0C, 0x36, 0x6E, 0x8F, 0xE8, 0xE8, 0x8E ),
+    BYTES_TO_T_UINT_8( 0xC2, 0xD3, 0x7C, 0xC7, 0x8D, 0x3F, 0x5C, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x6A, 0x64, 0x6A, 0x73, 0x10, 0x79, 0xB8, 0x5A ),
+    BYTES_TO_T_UINT_2( 0xCB, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x51, 0xF9, 0xEF, 0xA5, 0x20, 0x4A, 0x5C, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0xF3, 0xF4, 0x49, 0x5B, 0x73, 0xAA, 0x1B ),
+    BYTES_TO_T_UINT_8( 0xC6, 0xF2, 0xEA, 0x0F, 0x00, 0xAD, 0x53, 0xAB ),
+    BYTES_TO_T_UINT_8( 0x03, 0xB8, 0x66, 0xED, 0xC4, 0x2B, 0x4C, 0x35 ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x2F, 0xC1, 0x9A, 0x37, 0xD2, 0x7F, 0x58 ),
+    BYTES_TO_T_UINT_8( 0x29, 0xA7, 0x81, 0x38, 0x64, 0xC9, 0x37, 0x38 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0x3B, 0x6C, 0x9F, 0x5B, 0xD9, 0x8B, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x14, 0xD9, 0x08, 0xD8, 0xD2, 0x7E, 0x23 ),
+    BYTES_TO_T_UINT_2( 0x1C, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0x15, 0x71, 0xE6, 0x3D, 0xD1, 0xB0, 0xE7, 0xCD ),
+    BYTES_TO_T_UINT_8( 0x5B, 0x81, 0x23, 0xEC, 0x2D, 0x42, 0x45, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0x51, 0x5B, 0x44, 0x6B, 0x89, 0x03, 0x67, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x84, 0x27, 0xAE, 0x80, 0x5A, 0x33, 0xBE, 0x11 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0xB6, 0x64, 0x1A, 0xDF, 0xD3, 0x85, 0x91 ),
+    BYTES_TO_T_UINT_8( 0x67, 0x8C, 0x22, 0xBA, 0xD0, 0xBD, 0xCC, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x3C, 0x01, 0x3A, 0xFF, 0x9D, 0xC7, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x0C, 0xC7, 0x64, 0xB4, 0x59, 0x4E, 0x9F, 0x22 ),
+    BYTES_TO_T_UINT_2( 0x85, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0xA1, 0x34, 0x0A, 0x41, 0x94, 0xA8, 0xF2, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xD4, 0xE4, 0xF0, 0x97, 0x45, 0x6D, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x8F, 0x1F, 0x4D, 0x6D, 0xFE, 0xA0, 0xC4, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x28, 0x5C, 0x40, 0xBB, 0x65, 0xD4, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x98, 0xA8, 0x87, 0x35, 0x20, 0x3A, 0x89, 0x44 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0xFD, 0x4F, 0xAB, 0x2D, 0xD1, 0xD0, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0x86, 0xE8, 0x00, 0xFC, 0x69, 0x52, 0xF8, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0xE1, 0x9A, 0x99, 0xE1, 0xDC, 0x9C, 0x3F, 0xD9 ),
+    BYTES_TO_T_UINT_2( 0x99, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0x12, 0x08, 0x98, 0xD9, 0xCA, 0x73, 0xD5, 0xA9 ),
+    BYTES_TO_T_UINT_8( 0xB9, 0x2C, 0xE0, 0xA7, 0x3E, 0x91, 0xD7, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x68, 0x04, 0xB0, 0x54, 0x09, 0xF4, 0x72, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0xC8, 0xEE, 0x28, 0xCC, 0xE8, 0x50, 0x78, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x0D, 0x91, 0x03, 0x76, 0xDB, 0x68, 0x24, 0x77 ),
+    BYTES_TO_T_UINT_8( 0x7A, 0xE0, 0x56, 0xB2, 0x5D, 0x12, 0xD3, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x0D, 0x42, 0x59, 0x8B, 0xDF, 0x67, 0xB5, 0xBE ),
+    BYTES_TO_T_UINT_8( 0xD1, 0xCC, 0xE5, 0x31, 0x53, 0x7A, 0x46, 0xB3 ),
+    BYTES_TO_T_UINT_2( 0xDA, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0xCC, 0x8D, 0x59, 0xB5, 0x1B, 0x0F, 0xF4, 0xAF ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x2F, 0xD1, 0x2C, 0xE0, 0xD8, 0x04, 0xEF ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xF4, 0xD7, 0xBA, 0xB0, 0xA3, 0x7E, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0x08, 0x51, 0x56, 0xA6, 0x76, 0x67, 0x33 ),
+    BYTES_TO_T_UINT_8( 0x8C, 0x17, 0x63, 0xFE, 0x56, 0xD0, 0xD9, 0x71 ),
+    BYTES_TO_T_UINT_8( 0xAA, 0xF6, 0xC3, 0x14, 0x47, 0xC5, 0xA7, 0x31 ),
+    BYTES_TO_T_UINT_8( 0x72, 0x4C, 0x80, 0xF6, 0xA2, 0x57, 0xA7, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x11, 0xB3, 0x7B, 0xF8, 0x2F, 0xE1, 0x3E, 0x7B ),
+    BYTES_TO_T_UINT_2( 0xFA, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0x26, 0xF4, 0xF9, 0x6B, 0x7B, 0x90, 0xDF, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x1F, 0x82, 0xEF, 0x62, 0xA1, 0x4C, 0x53, 0xCA ),
+    BYTES_TO_T_UINT_8( 0xE6, 0x99, 0x76, 0x01, 0xBA, 0x8D, 0x0F, 0x54 ),
+    BYTES_TO_T_UINT_8( 0xAF, 0xF4, 0x58, 0x73, 0x56, 0xFE, 0xDD, 0x7C ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xCE, 0xF9, 0xE8, 0xA1, 0x34, 0xC3, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x09, 0x5F, 0xDC, 0x6A, 0x3D, 0xD8, 0x7F, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0xF4, 0x51, 0xB8, 0xB8, 0xC1, 0xD7, 0x2F ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x7D, 0x58, 0xD1, 0xD4, 0x1B, 0x4D, 0x23 ),
+    BYTES_TO_T_UINT_2( 0xD3, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0xB9, 0x95, 0xDF, 0x00, 0xD8, 0x21, 0xDE, 0x94 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x47, 0x3C, 0xC3, 0xB2, 0x01, 0x53, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x1E, 0x17, 0x43, 0x23, 0xBD, 0xCA, 0x71, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0x70, 0xBA, 0x0F, 0x4F, 0xDC, 0x41, 0x54, 0xBE ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x39, 0x26, 0x70, 0x53, 0x32, 0x18, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x32, 0x46, 0x07, 0x97, 0x3A, 0x57, 0xE0, 0x01 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x92, 0x4F, 0xCE, 0xDF, 0x25, 0x80, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x5B, 0x6F, 0x9A, 0x03, 0x05, 0x4B, 0xD1, 0x47 ),
+    BYTES_TO_T_UINT_2( 0x5D, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0x25, 0x01, 0x72, 0x30, 0x90, 0x17, 0x51, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x74, 0xFB, 0x41, 0x65, 0x5C, 0xB4, 0x2D, 0xEE ),
+    BYTES_TO_T_UINT_8( 0x66, 0xCD, 0xCD, 0xAA, 0x41, 0xCC, 0xBB, 0x07 ),
+    BYTES_TO_T_UINT_8( 0xD4, 0xCE, 0x08, 0x0A, 0x63, 0xE9, 0xA2, 0xFF ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xA8, 0x21, 0x7F, 0x7A, 0x5B, 0x9B, 0x81 ),
+    BYTES_TO_T_UINT_8( 0x10, 0x6B, 0x89, 0x44, 0x0A, 0x7F, 0x85, 0x5F ),
+    BYTES_TO_T_UINT_8( 0x7D, 0xDE, 0x7C, 0x19, 0x5C, 0x65, 0x26, 0x61 ),
+    BYTES_TO_T_UINT_8( 0xD7, 0xAC, 0x62, 0x29, 0x4A, 0xF1, 0xD0, 0x81 ),
+    BYTES_TO_T_UINT_2( 0x38, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x32, 0x00, 0x40, 0x87, 0xEB, 0xA9, 0x58, 0x56 ),
+    BYTES_TO_T_UINT_8( 0xAF, 0x51, 0x0B, 0xFF, 0x56, 0x35, 0x51, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x7B, 0xAC, 0x08, 0x94, 0x71, 0xDA, 0xEC, 0x99 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x4D, 0xC5, 0x7B, 0x31, 0x8B, 0x8D, 0x5E ),
+    BYTES_TO_T_UINT_8( 0x15, 0x05, 0xF1, 0x3E, 0x9E, 0x8F, 0x17, 0x8F ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x9C, 0x4B, 0x62, 0x94, 0xAD, 0x49, 0xFC ),
+    BYTES_TO_T_UINT_8( 0x0F, 0xC9, 0xC6, 0x8F, 0xFD, 0x33, 0x44, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x96, 0x17, 0x7F, 0x42, 0xBE, 0xF7, 0x0D ),
+    BYTES_TO_T_UINT_2( 0xD4, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFB, 0x29, 0x39, 0x13, 0x08, 0x8D, 0x91, 0x47 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0x79, 0xF9, 0x2F, 0xA9, 0x0A, 0xCF, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x87, 0x7A, 0xA3, 0x19, 0xAB, 0x55, 0xAD ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x0B, 0x01, 0xC5, 0x56, 0x19, 0x9D, 0x9E ),
+    BYTES_TO_T_UINT_8( 0x19, 0xDE, 0x82, 0x3B, 0xEA, 0xD3, 0x0B, 0x8C ),
+    BYTES_TO_T_UINT_8( 0x65, 0x6B, 0xC7, 0xF3, 0x0F, 0x82, 0x87, 0x6C ),
+    BYTES_TO_T_UINT_8( 0xD8, 0x2E, 0x23, 0xF2, 0x39, 0x9D, 0x49, 0x70 ),
+    BYTES_TO_T_UINT_8( 0x31, 0xDE, 0xAF, 0x7A, 0xEE, 0xB0, 0xDA, 0x70 ),
+    BYTES_TO_T_UINT_2( 0x63, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0x76, 0x4E, 0x2A, 0x50, 0xFD, 0x8E, 0xC0, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x52, 0x0F, 0x7C, 0x76, 0x63, 0xD8, 0x89, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xEC, 0x2D, 0xB9, 0x4E, 0xF4, 0xEE, 0x85, 0xCF ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x95, 0x5C, 0x96, 0x5D, 0xAA, 0x59, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xCA, 0xDB, 0xD2, 0x68, 0x8E, 0x5A, 0x94, 0x60 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x02, 0xBF, 0x77, 0x9F, 0xB9, 0x4C, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x2D, 0xDC, 0xC0, 0xCF, 0x81, 0x1E, 0xC4, 0x6C ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xCC, 0x37, 0x86, 0xDC, 0xE2, 0x64, 0x72 ),
+    BYTES_TO_T_UINT_2( 0xD5, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0x30, 0xB1, 0x59, 0x20, 0x9D, 0x98, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x77, 0x0C, 0x9D, 0xF8, 0x20, 0xDC, 0x90, 0xBA ),
+    BYTES_TO_T_UINT_8( 0xB1, 0xA0, 0xF4, 0xE7, 0x3E, 0x9C, 0x9E, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x25, 0xA2, 0xB0, 0x54, 0xCD, 0x2E, 0x33 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0xD9, 0x42, 0xB0, 0x80, 0xB0, 0xA3, 0x38 ),
+    BYTES_TO_T_UINT_8( 0x9F, 0xFE, 0x9D, 0x8D, 0x40, 0xFF, 0x27, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x9D, 0xA6, 0x88, 0x3A, 0x8B, 0x6F, 0x14 ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x39, 0xEE, 0x1F, 0x3F, 0xB1, 0x4F, 0x63 ),
+    BYTES_TO_T_UINT_2( 0x31, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x6D, 0xD7, 0x9E, 0xFF, 0xD2, 0x35, 0x67, 0x03 ),
+    BYTES_TO_T_UINT_8( 0xCA, 0x4F, 0x15, 0x5D, 0xE3, 0xE8, 0x53, 0x86 ),
+    BYTES_TO_T_UINT_8( 0x92, 0xF7, 0x24, 0x98, 0xA2, 0xCB, 0x11, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x06, 0x2E, 0x25, 0xE1, 0x94, 0xC5, 0xA3, 0x96 ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x82, 0x6E, 0xBA, 0xE7, 0x43, 0x25, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0x18, 0x65, 0xB4, 0x49, 0x73, 0x18, 0x35, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x59, 0x5B, 0xBC, 0x62, 0x86, 0x4C, 0xC1, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0xF2, 0x95, 0xA2, 0xBB, 0xA2, 0x35, 0x65 ),
+    BYTES_TO_T_UINT_2( 0xBF, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0x72, 0x59, 0x62, 0xB0, 0x4B, 0x1E, 0xB4, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0x0D, 0x55, 0xCE, 0xB0, 0x69, 0xBA, 0x63, 0x10 ),
+    BYTES_TO_T_UINT_8( 0x6E, 0x69, 0x86, 0xDB, 0x34, 0x7D, 0x68, 0x64 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0x06, 0xCA, 0x55, 0x44, 0x36, 0x2B, 0xBA ),
+    BYTES_TO_T_UINT_8( 0x6C, 0xD4, 0xC4, 0x3D, 0xCD, 0x9E, 0x69, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0x44, 0xE4, 0xBF, 0x31, 0xE6, 0x40, 0x9F ),
+    BYTES_TO_T_UINT_8( 0x7E, 0x4F, 0xFA, 0x75, 0xE3, 0xFB, 0x97, 0x0E ),
+    BYTES_TO_T_UINT_8( 0x08, 0xC0, 0xBD, 0x1C, 0x48, 0xB0, 0x26, 0xD0 ),
+    BYTES_TO_T_UINT_2( 0xD2, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0x1C, 0x7B, 0x32, 0xFA, 0xF2, 0x6D, 0x84, 0x8E ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x21, 0x03, 0x1D, 0x0D, 0x22, 0x55, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x18, 0xF9, 0x42, 0x03, 0x9C, 0xC2, 0xCB, 0xBA ),
+    BYTES_TO_T_UINT_8( 0xF8, 0xA1, 0x96, 0xD9, 0x9D, 0x11, 0x6F, 0xBE ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x40, 0x57, 0xEB, 0x40, 0x2D, 0xC0, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0x96, 0xBB, 0x4F, 0x2F, 0x23, 0xA8, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x29, 0x85, 0x21, 0xA5, 0x50, 0x62, 0x06 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x7D, 0x92, 0xCF, 0x87, 0x0C, 0x22, 0xF9 ),
+    BYTES_TO_T_UINT_2( 0xC9, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0x5A, 0x0E, 0xA5, 0x32, 0x5B, 0xDF, 0x9C, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0x27, 0x96, 0x37, 0x2C, 0x88, 0x35, 0x30, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x40, 0xB4, 0x69, 0xFF, 0xEB, 0xC6, 0x94, 0x08 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x55, 0x60, 0xAD, 0xAA, 0x58, 0x14, 0x88 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0xFF, 0xF2, 0xB2, 0xD5, 0xA7, 0xD9, 0x27 ),
+    BYTES_TO_T_UINT_8( 0x2D, 0xAE, 0x54, 0xD2, 0x60, 0x31, 0xF3, 0x15 ),
+    BYTES_TO_T_UINT_8( 0xBB, 0x92, 0x83, 0xE3, 0xF1, 0x42, 0x83, 0x6E ),
+    BYTES_TO_T_UINT_8( 0x49, 0xD2, 0xC8, 0xB7, 0x76, 0x45, 0x7F, 0x7D ),
+    BYTES_TO_T_UINT_2( 0x04, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0x4A, 0x11, 0xA4, 0xFB, 0x7A, 0x01, 0xBC, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0x27, 0x73, 0x8D, 0x02, 0x91, 0x27, 0x8E ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x62, 0xF6, 0xDD, 0x6B, 0xFA, 0x5B, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xEF, 0xCA, 0xA2, 0x44, 0x2C, 0xF0, 0x28, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0xF1, 0x7A, 0xA2, 0x42, 0x4C, 0x50, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0x2D, 0x83, 0x3E, 0x50, 0xAB, 0x9C, 0xF7, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0xED, 0x78, 0xCB, 0x76, 0x69, 0xDA, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xDB, 0x01, 0x1E, 0x43, 0x27, 0x47, 0x6E, 0xDA ),
+    BYTES_TO_T_UINT_2( 0x94, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD3, 0x4F, 0x54, 0xB9, 0x3E, 0xBD, 0xD5, 0x44 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x35, 0x40, 0x69, 0x7F, 0x74, 0x9D, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x06, 0x6F, 0x67, 0x68, 0x2B, 0x4D, 0x10 ),
+    BYTES_TO_T_UINT_8( 0xC6, 0x65, 0x41, 0xFC, 0x7C, 0x1E, 0xE8, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x79, 0x37, 0xAF, 0xFD, 0xD2, 0xDA, 0x4C ),
+    BYTES_TO_T_UINT_8( 0x33, 0xA8, 0x69, 0x56, 0x62, 0xA4, 0xE4, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x42, 0x71, 0x73, 0x21, 0x8A, 0x17, 0x81, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0x14, 0x55, 0x8F, 0x7B, 0xB8, 0xAF, 0xF7, 0x86 ),
+    BYTES_TO_T_UINT_2( 0xAA, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x4B, 0xD1, 0xBD, 0xBE, 0x8C, 0xBC, 0x60, 0x6E ),
+    BYTES_TO_T_UINT_8( 0x62, 0xA6, 0x57, 0x8C, 0xAE, 0x5C, 0x19, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x7A, 0x43, 0xE4, 0xD9, 0xD8, 0x7B, 0xE7, 0x41 ),
+    BYTES_TO_T_UINT_8( 0xED, 0xB9, 0xE4, 0x85, 0x7C, 0x2E, 0xFC, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x02, 0x2E, 0x01, 0x2A, 0x6D, 0x56, 0xBE, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x6A, 0x0C, 0x25, 0x9B, 0xAE, 0x86, 0x37, 0x43 ),
+    BYTES_TO_T_UINT_8( 0x4A, 0x22, 0xB3, 0xCB, 0x99, 0x66, 0xB7, 0x9E ),
+    BYTES_TO_T_UINT_8( 0x56, 0xF7, 0x90, 0xF0, 0x1B, 0x09, 0x27, 0xF7 ),
+    BYTES_TO_T_UINT_2( 0xC8, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1C, 0x16, 0x08, 0xEF, 0x39, 0x64, 0x49, 0x31 ),
+    BYTES_TO_T_UINT_8( 0x08, 0xA0, 0xE3, 0x97, 0xA9, 0x07, 0x54, 0x26 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0xFF, 0xE2, 0x00, 0x07, 0x21, 0x88, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x16, 0xFD, 0x59, 0x53, 0x05, 0x6C, 0x42, 0x27 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0xF7, 0x39, 0x5C, 0x82, 0x36, 0xE8, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x2E, 0x83, 0xA8, 0xE2, 0xA8, 0x43, 0x07, 0x38 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0xAF, 0x2B, 0x79, 0xED, 0xD8, 0x39, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x15, 0x20, 0x91, 0x7A, 0xC4, 0x07, 0xEF, 0x6C ),
+    BYTES_TO_T_UINT_2( 0x28, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0x6A, 0x10, 0x2F, 0xAA, 0x0C, 0x94, 0x0E, 0x5A ),
+    BYTES_TO_T_UINT_8( 0xB7, 0x81, 0x87, 0x41, 0x23, 0xEB, 0x55, 0x7C ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x53, 0xCC, 0x79, 0xB6, 0xEB, 0x6C, 0xCC ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x77, 0x73, 0x9D, 0xFC, 0x64, 0x6F, 0x7F ),
+    BYTES_TO_T_UINT_8( 0x3C, 0x40, 0xE3, 0x6D, 0x1C, 0x16, 0x71, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x5A, 0xF4, 0x1B, 0xFF, 0x1C, 0x2F, 0xA5, 0xD7 ),
+    BYTES_TO_T_UINT_8( 0x06, 0x0E, 0x0B, 0x11, 0xF4, 0x8D, 0x93, 0xAF ),
+    BYTES_TO_T_UINT_8( 0x58, 0xC5, 0x64, 0x6F, 0x24, 0x19, 0xF2, 0x9B ),
+    BYTES_TO_T_UINT_2( 0x1C, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x52, 0xB3, 0xAF, 0xA5, 0x0E, 0x4F, 0x5E, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x0F, 0x77, 0xCA, 0xF2, 0x6D, 0xC5, 0xF6, 0x9F ),
+    BYTES_TO_T_UINT_8( 0x90, 0x18, 0x8E, 0x33, 0x68, 0x6C, 0xE8, 0xE0 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x8B, 0x80, 0x90, 0x19, 0x7F, 0x90, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x5B, 0x80, 0x6B, 0x68, 0xE2, 0x7D, 0xD4, 0xD0 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0xC1, 0x67, 0xB3, 0x72, 0xCB, 0xBF, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x4F, 0xD5, 0xD3, 0x1D, 0x14, 0x58, 0x0A, 0x80 ),
+    BYTES_TO_T_UINT_8( 0x79, 0x7A, 0x65, 0x98, 0xB3, 0x07, 0x4B, 0x2F ),
+    BYTES_TO_T_UINT_2( 0xF3, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x2A, 0x87, 0x0F, 0x5F, 0xCF, 0xA2, 0x01, 0x08 ),
+    BYTES_TO_T_UINT_8( 0x0C, 0xC9, 0xC8, 0x6E, 0x35, 0x87, 0xA5, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x94, 0x3E, 0x91, 0xA0, 0xAB, 0x24, 0x1E, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0xB9, 0xBC, 0x02, 0x35, 0x70, 0xC1, 0x5F, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x26, 0x59, 0xA0, 0x50, 0x04, 0x80, 0x52, 0x85 ),
+    BYTES_TO_T_UINT_8( 0xF8, 0x56, 0x6E, 0x42, 0x8F, 0x8C, 0x91, 0x65 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xA2, 0xCB, 0xA5, 0xDE, 0x14, 0x24, 0x38 ),
+    BYTES_TO_T_UINT_8( 0x00, 0xCB, 0x74, 0x28, 0xE6, 0xA7, 0xE7, 0xC3 ),
+    BYTES_TO_T_UINT_2( 0x5F, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0x35, 0x73, 0xA8, 0x8F, 0x9E, 0x0E, 0x63, 0x96 ),
+    BYTES_TO_T_UINT_8( 0xC8, 0x1B, 0x77, 0xC7, 0xC1, 0x38, 0xF9, 0xDC ),
+    BYTES_TO_T_UINT_8( 0xD8, 0x3C, 0xCF, 0xA8, 0x7A, 0xD7, 0xF3, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x5F, 0x9A, 0xC9, 0xAD, 0xE9, 0x1A, 0x93 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0xCF, 0x2B, 0x5E, 0xD5, 0x81, 0x95, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0x19, 0x88, 0x75, 0x29, 0x1F, 0xC7, 0xC7, 0xD0 ),
+    BYTES_TO_T_UINT_8( 0xD8, 0xA9, 0x5A, 0x4D, 0x63, 0x95, 0xF9, 0x4E ),
+    BYTES_TO_T_UINT_8( 0xEB, 0xCD, 0x04, 0x8F, 0xCD, 0x91, 0xDE, 0xC6 ),
+    BYTES_TO_T_UINT_2( 0x71, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0x88, 0xD4, 0xFD, 0x25, 0x11, 0x99, 0x6E, 0xEA ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x83, 0x01, 0x3D, 0xFB, 0x56, 0xA5, 0x4E ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x3A, 0xDC, 0x74, 0xC2, 0xD7, 0xCF, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0xBD, 0xF1, 0xDD, 0xA3, 0x07, 0x03, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x7B, 0xBE, 0xE9, 0x2E, 0x58, 0x84, 0x66, 0xFC ),
+    BYTES_TO_T_UINT_8( 0x71, 0x20, 0x78, 0x37, 0x79, 0x0B, 0xA6, 0x64 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0xF2, 0xAC, 0x65, 0xC8, 0xC9, 0x2F, 0x61 ),
+    BYTES_TO_T_UINT_8( 0x26, 0x93, 0xE5, 0x0D, 0x0C, 0xC6, 0xB8, 0xCB ),
+    BYTES_TO_T_UINT_2( 0x9C, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0x69, 0xAD, 0x5C, 0x19, 0x12, 0x61, 0x0E, 0x25 ),
+    BYTES_TO_T_UINT_8( 0x39, 0x4F, 0x0B, 0x1F, 0x49, 0x7E, 0xCD, 0x81 ),
+    BYTES_TO_T_UINT_8( 0x46, 0x2E, 0x30, 0x61, 0xDB, 0x08, 0x68, 0x9B ),
+    BYTES_TO_T_UINT_8( 0x41, 0x78, 0xAF, 0xB3, 0x08, 0xC1, 0x69, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x5F, 0x5D, 0xC1, 0x57, 0x6F, 0xD8, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x38, 0xD3, 0x6A, 0xF7, 0xFD, 0x86, 0xE5, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0xA8, 0x63, 0xBD, 0x70, 0x7B, 0x47, 0xE8, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x18, 0x62, 0xC8, 0x7E, 0x9D, 0x11, 0x2B, 0xA5 ),
+    BYTES_TO_T_UINT_2( 0xB6, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0xE2, 0x84, 0xFD, 0xD5, 0x9A, 0x56, 0x7F, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x7C, 0xBB, 0xA4, 0x6F, 0x12, 0x6E, 0x4D, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x08, 0xA1, 0x82, 0x9C, 0x62, 0x74, 0x7B ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x58, 0x22, 0x05, 0x1D, 0x15, 0x35, 0x79 ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x88, 0xCF, 0x5C, 0x05, 0x78, 0xFB, 0x94 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0x6B, 0x2F, 0x79, 0x09, 0x73, 0x67, 0xEC ),
+    BYTES_TO_T_UINT_8( 0xD8, 0xA0, 0x80, 0xD8, 0xE8, 0xEC, 0xFB, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xE7, 0x0B, 0xB7, 0x81, 0x48, 0x7B, 0xD9 ),
+    BYTES_TO_T_UINT_2( 0xE3, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE8, 0x53, 0xA9, 0xED, 0x61, 0x92, 0xD7, 0x85 ),
+    BYTES_TO_T_UINT_8( 0x26, 0x49, 0xD9, 0x5D, 0x9B, 0x4E, 0x89, 0x35 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x12, 0xEB, 0x9A, 0xC9, 0xCB, 0xC1, 0x95 ),
+    BYTES_TO_T_UINT_8( 0x35, 0xDC, 0x95, 0x16, 0xFE, 0x29, 0x70, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x64, 0x33, 0xB1, 0xD6, 0x78, 0xB9, 0xE2, 0x36 ),
+    BYTES_TO_T_UINT_8( 0x34, 0xCE, 0x88, 0xC3, 0xFD, 0x7A, 0x6B, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x40, 0x1E, 0x50, 0x1E, 0xAF, 0xB1, 0x25, 0x2D ),
+    BYTES_TO_T_UINT_8( 0xC1, 0xE7, 0xD7, 0xD5, 0xBD, 0x7A, 0x12, 0xF9 ),
+    BYTES_TO_T_UINT_2( 0x31, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x22, 0xAA, 0xA2, 0x80, 0x5D, 0x8F, 0xCD, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x39, 0x79, 0x64, 0xA1, 0x67, 0x3C, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xC7, 0x49, 0xFF, 0x7F, 0xAC, 0xAB, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x54, 0x3E, 0x83, 0xF0, 0x3D, 0xBC, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x87, 0x92, 0x4A, 0x38, 0x42, 0x8A, 0xAB, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0x0B, 0x4F, 0xEE, 0x9E, 0x92, 0xA5, 0xBE ),
+    BYTES_TO_T_UINT_8( 0xBA, 0xDD, 0x19, 0x96, 0xF2, 0xF0, 0x6B, 0x2E ),
+    BYTES_TO_T_UINT_8( 0xBE, 0xFC, 0xDD, 0xB2, 0x8A, 0xE5, 0x4C, 0x22 ),
+    BYTES_TO_T_UINT_2( 0xD4, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB7, 0x06, 0x49, 0xAC, 0x99, 0x7E, 0xF8, 0x12 ),
+    BYTES_TO_T_UINT_8( 0x76, 0xC8, 0x01, 0x51, 0xEA, 0xF6, 0x52, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x89, 0x66, 0x2B, 0x1F, 0x9B, 0x2A, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x0F, 0x95, 0x07, 0x2B, 0x6C, 0x6E, 0x9E ),
+    BYTES_TO_T_UINT_8( 0x24, 0xC3, 0xB4, 0xBB, 0x91, 0x1F, 0xA3, 0x72 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x6E, 0x54, 0x28, 0x7B, 0x9C, 0x79, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x03, 0x45, 0xFF, 0xA6, 0xDA, 0xA2, 0x83, 0x71 ),
+    BYTES_TO_T_UINT_8( 0xEB, 0xDE, 0x8F, 0x17, 0x37, 0x82, 0xCB, 0xE2 ),
+    BYTES_TO_T_UINT_2( 0x30, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0xD8, 0x94, 0x3F, 0x26, 0xC9, 0x1D, 0xD9, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x09, 0x97, 0x28, 0x20, 0xCD, 0xC1, 0xF3, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x95, 0xC9, 0xB5, 0x60, 0x9B, 0x1E, 0xDC, 0x74 ),
+    BYTES_TO_T_UINT_8( 0x5B, 0xB9, 0x5B, 0x7D, 0xA0, 0xB2, 0x8C, 0xF0 ),
+    BYTES_TO_T_UINT_8( 0x33, 0xD1, 0x42, 0xE6, 0x39, 0x33, 0x6D, 0xBB ),
+    BYTES_TO_T_UINT_8( 0x5D, 0xC0, 0xFC, 0xD2, 0x14, 0x5D, 0x3E, 0x3C ),
+    BYTES_TO_T_UINT_8( 0x78, 0x4A, 0x3E, 0x40, 0x16, 0x93, 0x15, 0xCF ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x24, 0xC1, 0x27, 0x27, 0xE5, 0x4B, 0xD8 ),
+    BYTES_TO_T_UINT_2( 0xD4, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1D, 0x50, 0xD8, 0xBC, 0xC1, 0x46, 0x22, 0xBB ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x0E, 0x60, 0xA1, 0xB3, 0x50, 0xD4, 0x86 ),
+    BYTES_TO_T_UINT_8( 0x80, 0xB1, 0x26, 0xB6, 0x6D, 0x47, 0x5A, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x45, 0xAC, 0x11, 0x35, 0x3E, 0xB9, 0xF4, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x97, 0xFA, 0xBB, 0x6B, 0x39, 0x13, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0x15, 0x7B, 0x34, 0x12, 0x75, 0x8E, 0x9B, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0x2C, 0x9E, 0xCD, 0x29, 0xB6, 0xEF, 0x8D, 0x10 ),
+    BYTES_TO_T_UINT_8( 0x47, 0xAC, 0xE9, 0x25, 0x27, 0xBB, 0x78, 0x47 ),
+    BYTES_TO_T_UINT_2( 0x2F, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0x30, 0x7A, 0xA8, 0xD3, 0xE3, 0x66, 0xE5, 0x66 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0x4C, 0xC4, 0x2C, 0x76, 0x81, 0x50, 0x32 ),
+    BYTES_TO_T_UINT_8( 0xEE, 0x71, 0x08, 0xB8, 0x52, 0x7C, 0xAF, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x45, 0x59, 0x24, 0xDD, 0xFB, 0x2F, 0xD0, 0xDA ),
+    BYTES_TO_T_UINT_8( 0xB7, 0xCD, 0x56, 0xE9, 0xAC, 0x91, 0xE6, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xE5, 0x64, 0x20, 0xC6, 0x9F, 0xE4, 0xEF, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x2C, 0x8F, 0x8C, 0x97, 0xF6, 0x22, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xF4, 0x88, 0xAA, 0xA8, 0xD7, 0xA5, 0x68 ),
+    BYTES_TO_T_UINT_2( 0xDE, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x21, 0x6C, 0xAE, 0x83, 0xB1, 0x55, 0x55, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x67, 0x84, 0x47, 0x7C, 0x83, 0x5C, 0x89 ),
+    BYTES_TO_T_UINT_8( 0x5B, 0x10, 0x4D, 0xDD, 0x30, 0x60, 0xB0, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0x59, 0xA7, 0x36, 0x76, 0x24, 0x32, 0x9F, 0x9D ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x42, 0x81, 0xFB, 0xA4, 0x2E, 0x13, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x87, 0x94, 0x91, 0xFF, 0x99, 0xA0, 0x09, 0x61 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0x83, 0xA1, 0x76, 0xAF, 0x37, 0x5C, 0x77 ),
+    BYTES_TO_T_UINT_8( 0x1E, 0xA8, 0x04, 0x86, 0xC4, 0xA9, 0x79, 0x42 ),
+    BYTES_TO_T_UINT_2( 0x93, 0x00 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0xB6, 0x8C, 0xC2, 0x34, 0xFB, 0x83, 0x28, 0x27 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x03, 0x7D, 0x5E, 0x9E, 0x0E, 0xB0, 0x22 ),
+    BYTES_TO_T_UINT_8( 0xA2, 0x02, 0x46, 0x7F, 0xB9, 0xAC, 0xBB, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x06, 0xED, 0x48, 0xC2, 0x96, 0x4D, 0x56, 0x27 ),
+    BYTES_TO_T_UINT_8( 0x44, 0xB5, 0xC5, 0xD1, 0xE6, 0x1C, 0x7E, 0x9B ),
+    BYTES_TO_T_UINT_8( 0x92, 0x2E, 0x18, 0x71, 0x2D, 0x7B, 0xD7, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x46, 0x9D, 0xDE, 0xAA, 0x78, 0x8E, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0x4D, 0xD7, 0x69, 0x2E, 0xE1, 0xD9, 0x48, 0xDE ),
+    BYTES_TO_T_UINT_2( 0xFB, 0x01 ),
+};
+static const mbedtls_mpi_uint secp521r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0xAF, 0xFF, 0x9E, 0x09, 0x22, 0x22, 0xE6, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x14, 0x28, 0x13, 0x1B, 0x62, 0x12, 0x22 ),
+    BYTES_TO_T_UINT_8( 0xCC, 0x7F, 0x67, 0x03, 0xB0, 0xC0, 0xF3, 0x05 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0xC3, 0x0F, 0xFB, 0x25, 0x48, 0x3E, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x0B, 0x6E, 0x53, 0x98, 0x36, 0xB3, 0xD3, 0x94 ),
+    BYTES_TO_T_UINT_8( 0xEB, 0x81, 0x54, 0x22, 0xA4, 0xCC, 0xC1, 0x22 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xBA, 0xFC, 0xA9, 0xDF, 0x68, 0x86, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x71, 0x92, 0x0E, 0xC3, 0xF2, 0x58, 0xE8, 0x51 ),
+    BYTES_TO_T_UINT_2( 0xE9, 0x01 ),
+};
+static const mbedtls_ecp_point secp521r1_T[32] = {
+    ECP_POINT_INIT_XY( secp521r1_T_0_X, secp521r1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_1_X, secp521r1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_2_X, secp521r1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_3_X, secp521r1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_4_X, secp521r1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_5_X, secp521r1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_6_X, secp521r1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_7_X, secp521r1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_8_X, secp521r1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_9_X, secp521r1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_10_X, secp521r1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_11_X, secp521r1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_12_X, secp521r1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_13_X, secp521r1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_14_X, secp521r1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_15_X, secp521r1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_16_X, secp521r1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_17_X, secp521r1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_18_X, secp521r1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_19_X, secp521r1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_20_X, secp521r1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_21_X, secp521r1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_22_X, secp521r1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_23_X, secp521r1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_24_X, secp521r1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_25_X, secp521r1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_26_X, secp521r1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_27_X, secp521r1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_28_X, secp521r1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_29_X, secp521r1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_30_X, secp521r1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp521r1_T_31_X, secp521r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP521R1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_SECP192K1_ENABLED)
+static const mbedtls_mpi_uint secp192k1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x7D, 0x6C, 0xE0, 0xEA, 0xB1, 0xD1, 0xA5, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x34, 0xF4, 0xB7, 0x80, 0x02, 0x7D, 0xB0, 0x26 ),
+    BYTES_TO_T_UINT_8( 0xAE, 0xE9, 0x57, 0xC0, 0x0E, 0xF1, 0x4F, 0xDB ),
+};
+static const mbedtls_mpi_uint secp192k1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9D, 0x2F, 0x5E, 0xD9, 0x88, 0xAA, 0x82, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x34, 0x86, 0xBE, 0x15, 0xD0, 0x63, 0x41, 0x84 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0x28, 0x56, 0x9C, 0x6D, 0x2F, 0x2F, 0x9B ),
+};
+static const mbedtls_mpi_uint secp192k1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0x9D, 0x86, 0xBC, 0xAA, 0x11, 0x92, 0xAD, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x36, 0xD8, 0x9C, 0x6E, 0xCB, 0xD6, 0x62, 0xDF ),
+    BYTES_TO_T_UINT_8( 0xF5, 0x1A, 0x8C, 0x0F, 0xAB, 0x90, 0xCC, 0x06 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE3, 0x4C, 0x8D, 0xEE, 0xA2, 0x50, 0xC2, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0xB3, 0x14, 0xBC, 0x86, 0x2B, 0x2D, 0x1B, 0xF7 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x23, 0xE1, 0x26, 0x6A, 0xB3, 0xCD, 0x14 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x5E, 0x70, 0x0C, 0x89, 0x1C, 0x90, 0xEA, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xE5, 0xB8, 0x07, 0xAB, 0x86, 0x28, 0xC8, 0x29 ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x99, 0x78, 0x3C, 0x06, 0xDE, 0x71, 0x6E ),
+};
+static const mbedtls_mpi_uint secp192k1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x73, 0xD4, 0x91, 0xAB, 0xE8, 0x80, 0xE4, 0x3F ),
+    BYTES_TO_T_UINT_8( 0xFF, 0xF8, 0xEF, 0xE7, 0x69, 0x8E, 0xB3, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x9C, 0xD3, 0xA4, 0xE3, 0xAC, 0x41, 0xC9, 0xF9 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x58, 0xF4, 0xC0, 0xA1, 0xFD, 0x5B, 0x3E, 0x37 ),
+    BYTES_TO_T_UINT_8( 0x39, 0x76, 0x0A, 0xE2, 0xFE, 0x39, 0xA8, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x4C, 0xCE, 0x02, 0x66, 0x07, 0xFD, 0x26, 0x24 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFD, 0xB7, 0x50, 0x7D, 0x64, 0x55, 0x22, 0x7C ),
+    BYTES_TO_T_UINT_8( 0x9D, 0x4A, 0x87, 0x49, 0xC5, 0x92, 0x1B, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x7E, 0xA2, 0x6F, 0x8B, 0x86, 0xF9, 0x59, 0x2F ),
+};
+static const mbedtls_mpi_uint secp192k1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0xBF, 0x0A, 0x6B, 0x2C, 0xBA, 0x70, 0x09, 0x64 ),
+    BYTES_TO_T_UINT_8( 0x84, 0xA5, 0xC0, 0xB2, 0x0C, 0x51, 0xC6, 0x14 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0xBB, 0x3A, 0x9C, 0xC9, 0x72, 0xBB, 0x03 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0x47, 0x75, 0xC7, 0xA2, 0xE8, 0x39, 0x8D, 0x27 ),
+    BYTES_TO_T_UINT_8( 0xA6, 0xCE, 0xDF, 0x3E, 0x51, 0x04, 0x7C, 0x9A ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x4A, 0xA1, 0x6D, 0xCF, 0x33, 0x25, 0x5F ),
+};
+static const mbedtls_mpi_uint secp192k1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x11, 0xF6, 0x88, 0x5A, 0x6C, 0x23, 0xF4, 0x7A ),
+    BYTES_TO_T_UINT_8( 0xB0, 0xBA, 0x91, 0x1C, 0x03, 0x34, 0x6C, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x5A, 0xBF, 0xFB, 0xC5, 0x8E, 0x82, 0xB7 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0x14, 0x26, 0x6F, 0x76, 0x90, 0x56, 0x8F, 0x1C ),
+    BYTES_TO_T_UINT_8( 0xBE, 0xDA, 0x7C, 0xE1, 0xCE, 0x3F, 0x19, 0x1E ),
+    BYTES_TO_T_UINT_8( 0x33, 0xDB, 0x1D, 0x6F, 0x74, 0xEF, 0xC0, 0x48 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0xC6, 0x4C, 0x1B, 0x3A, 0xFB, 0x0C, 0xD1, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x63, 0x3B, 0x44, 0x14, 0x80, 0xCA, 0xBB, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0xCC, 0xF7, 0xBA, 0x6D, 0xF3, 0xE3, 0xC4 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF1, 0x9A, 0x1C, 0x09, 0xE9, 0xEE, 0xD8, 0x17 ),
+    BYTES_TO_T_UINT_8( 0xE1, 0xB3, 0xBE, 0x3F, 0x65, 0x4A, 0x25, 0x85 ),
+    BYTES_TO_T_UINT_8( 0x9F, 0x09, 0x5D, 0xBF, 0x68, 0xA6, 0x80, 0x16 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0xD2, 0xED, 0xBA, 0xAE, 0xFC, 0x0C, 0xD4, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x14, 0x00, 0xC2, 0x43, 0x8C, 0x94, 0x08, 0xDE ),
+    BYTES_TO_T_UINT_8( 0x84, 0xCF, 0x33, 0xFC, 0xCD, 0xDD, 0x90, 0xCE ),
+};
+static const mbedtls_mpi_uint secp192k1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x7A, 0x89, 0x2E, 0x83, 0x76, 0x84, 0x35, 0x90 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x39, 0xE4, 0xD0, 0x70, 0x7B, 0xCA, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x09, 0xCC, 0x05, 0x93, 0x94, 0x94, 0x5E, 0x01 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x72, 0xDF, 0x76, 0x6E, 0x71, 0xFF, 0x1F, 0x0F ),
+    BYTES_TO_T_UINT_8( 0x83, 0xE2, 0xF1, 0x8E, 0xC0, 0xCD, 0x00, 0xCF ),
+    BYTES_TO_T_UINT_8( 0x3D, 0x88, 0xFA, 0x11, 0x20, 0x7F, 0x80, 0xBF ),
+};
+static const mbedtls_mpi_uint secp192k1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFE, 0x6C, 0x86, 0xE9, 0x74, 0x2A, 0x15, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0x3C, 0xDD, 0x98, 0xA1, 0x90, 0xD9, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x71, 0x08, 0x90, 0x6D, 0x88, 0x3C, 0x7B, 0xB8 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0x96, 0x9E, 0x02, 0xE5, 0x71, 0x71, 0x2A, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0x67, 0x5A, 0xBC, 0xEB, 0xA1, 0x3E, 0xB3, 0x6A ),
+    BYTES_TO_T_UINT_8( 0x20, 0x6D, 0xDA, 0xCE, 0x2E, 0xD3, 0x07, 0xB2 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA0, 0x68, 0x64, 0xC3, 0x11, 0x7C, 0xE1, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x11, 0x62, 0x10, 0xBF, 0x83, 0x0B, 0xAB, 0x08 ),
+    BYTES_TO_T_UINT_8( 0xB9, 0xFB, 0x02, 0xA1, 0x37, 0x32, 0x21, 0x4D ),
+};
+static const mbedtls_mpi_uint secp192k1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0x4C, 0xF3, 0x38, 0x79, 0xDC, 0xD5, 0xB7, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0xFA, 0x2B, 0xBC, 0xAA, 0x12, 0xD8, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x12, 0x87, 0x3D, 0x07, 0xB3, 0x99, 0x99, 0x43 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8D, 0x49, 0x77, 0xA8, 0x3C, 0xCD, 0x2A, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x7B, 0x7F, 0xA9, 0x7B, 0x49, 0x9B, 0x85 ),
+    BYTES_TO_T_UINT_8( 0xF8, 0xB2, 0x38, 0xE0, 0x5F, 0x61, 0x5A, 0x32 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0xC6, 0xB5, 0xF4, 0xEA, 0x93, 0x91, 0x7E, 0x6C ),
+    BYTES_TO_T_UINT_8( 0x2E, 0x3E, 0x79, 0x89, 0xE1, 0x2B, 0x97, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0xAB, 0x8A, 0x2D, 0xC4, 0xE2, 0xF2, 0x92 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0xAD, 0xA7, 0x2C, 0x07, 0x4A, 0x84, 0x2E ),
+    BYTES_TO_T_UINT_8( 0xCF, 0xF9, 0x47, 0xE3, 0x75, 0x18, 0xD1, 0x04 ),
+    BYTES_TO_T_UINT_8( 0x49, 0x59, 0x0E, 0xDC, 0xE2, 0xB2, 0x94, 0x73 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0x7B, 0x45, 0x4D, 0xAB, 0x11, 0xDC, 0xEC, 0xCE ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x24, 0x6E, 0xA0, 0xB1, 0x35, 0xD5, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0x3B, 0x8E, 0x50, 0xC7, 0x17, 0x6C, 0x2E ),
+};
+static const mbedtls_mpi_uint secp192k1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE1, 0xAD, 0x6D, 0xC5, 0x9A, 0xF0, 0x2D, 0x41 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x8E, 0xB2, 0x56, 0x27, 0x9D, 0xAD, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x9F, 0xF6, 0xFD, 0x3D, 0x08, 0x6C, 0x01, 0x78 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x1E, 0x8B, 0x5C, 0x97, 0x80, 0x1E, 0xDE, 0x76 ),
+    BYTES_TO_T_UINT_8( 0x07, 0xB1, 0x8E, 0xC9, 0xFD, 0xBC, 0xB1, 0x03 ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x73, 0x59, 0xF7, 0x88, 0xCA, 0xE4, 0xFE ),
+};
+static const mbedtls_mpi_uint secp192k1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0xB5, 0xD7, 0xCE, 0x7D, 0x95, 0xF3, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x31, 0xDA, 0xF6, 0x51, 0xDE, 0x08, 0xC7, 0x02 ),
+    BYTES_TO_T_UINT_8( 0x29, 0x1A, 0x7A, 0xEB, 0xA3, 0xB5, 0x6E, 0xF2 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x09, 0x5C, 0xF9, 0x03, 0x68, 0xC7, 0xD8, 0xD7 ),
+    BYTES_TO_T_UINT_8( 0x05, 0x75, 0xB3, 0xCE, 0xD6, 0x6F, 0xFD, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x6D, 0xB9, 0x5F, 0x6A, 0x9D, 0xAA, 0xBE ),
+};
+static const mbedtls_mpi_uint secp192k1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE6, 0xF9, 0x52, 0x58, 0x09, 0x1F, 0x5E, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x77, 0xC4, 0x4D, 0x22, 0xEA, 0x35, 0x0A, 0xF9 ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x72, 0x65, 0x6A, 0x2D, 0xBD, 0xF8, 0xAC ),
+};
+static const mbedtls_mpi_uint secp192k1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0x0F, 0x39, 0x5D, 0x24, 0xF6, 0xF9, 0x1F, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x51, 0x92, 0x98, 0x8F, 0x58, 0xC5, 0xE5, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0x94, 0xE8, 0x26, 0xDA, 0xEE, 0x04, 0xA0, 0x3B ),
+};
+static const mbedtls_mpi_uint secp192k1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA8, 0xE8, 0x6B, 0x90, 0x79, 0xB5, 0x31, 0x47 ),
+    BYTES_TO_T_UINT_8( 0x93, 0xB4, 0x79, 0x9E, 0x73, 0xE0, 0x70, 0x09 ),
+    BYTES_TO_T_UINT_8( 0x4D, 0x4F, 0x67, 0xA2, 0xD8, 0x88, 0xF3, 0x7B ),
+};
+static const mbedtls_mpi_uint secp192k1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x49, 0xE6, 0x6D, 0x80, 0x77, 0x67, 0xDF, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x66, 0x5F, 0xBD, 0x3F, 0xBD, 0x50, 0x9D, 0x7D ),
+    BYTES_TO_T_UINT_8( 0x92, 0x02, 0x8B, 0xBE, 0x03, 0x7A, 0xE6, 0x8A ),
+};
+static const mbedtls_mpi_uint secp192k1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0x54, 0x1F, 0x6D, 0x28, 0xDE, 0x98, 0x57, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xE1, 0x40, 0x19, 0xA1, 0xF7, 0x8D, 0x9E, 0x59 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0x2A, 0x9E, 0x09, 0x69, 0x21, 0x11, 0x8F ),
+};
+static const mbedtls_mpi_uint secp192k1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x02, 0x97, 0x2B, 0x86, 0x52, 0xDE, 0x0F, 0xF3 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x97, 0x31, 0x7D, 0x8D, 0xDB, 0x27, 0x62 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0xF6, 0x6C, 0xFA, 0x29, 0x6D, 0xB5, 0xD2 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0x94, 0x3D, 0x7B, 0x8C, 0xF4, 0x72, 0x01, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0x2C, 0x56, 0xE3, 0xDB, 0xD4, 0xEE, 0x70 ),
+    BYTES_TO_T_UINT_8( 0xF3, 0xAA, 0x41, 0x3D, 0x0D, 0x66, 0x7B, 0x83 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x8E, 0x44, 0x4A, 0xCD, 0xD0, 0x17, 0x85, 0x6F ),
+    BYTES_TO_T_UINT_8( 0xDC, 0x85, 0xF2, 0x75, 0x92, 0xE2, 0x6B, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0x0A, 0x8E, 0xA3, 0xA7, 0x09, 0xFC, 0xDE, 0xE5 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0x14, 0xA2, 0x44, 0x44, 0x84, 0x1A, 0xA8, 0x72 ),
+    BYTES_TO_T_UINT_8( 0xB6, 0xEA, 0xD1, 0xD7, 0xEB, 0xFB, 0x8D, 0x92 ),
+    BYTES_TO_T_UINT_8( 0xA5, 0x87, 0xCF, 0xF9, 0xDF, 0x38, 0xD1, 0xF3 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0x34, 0x0A, 0x6C, 0xF5, 0xBC, 0xB0, 0x45, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x92, 0x05, 0xC5, 0x94, 0x84, 0x47, 0xFB ),
+    BYTES_TO_T_UINT_8( 0x7C, 0x0C, 0x5E, 0xF0, 0x82, 0xB9, 0x82, 0xD2 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA3, 0xA6, 0x81, 0x39, 0x92, 0x29, 0x63, 0x9B ),
+    BYTES_TO_T_UINT_8( 0x6B, 0xEA, 0x7A, 0x23, 0x03, 0x45, 0xC9, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x70, 0x7B, 0x4A, 0x0F, 0x4B, 0xE8, 0x23 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x51, 0xD6, 0x45, 0x9C, 0xFC, 0x11, 0xC4, 0x18 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x30, 0x84, 0x11, 0x2E, 0x74, 0xCF, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x88, 0xAC, 0x36, 0xD2, 0x68, 0x77, 0x78, 0x13 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9F, 0x8F, 0xB9, 0x02, 0x21, 0xFC, 0x6A, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0x96, 0x5A, 0xD5, 0x57, 0x71, 0xD1, 0x89, 0xBA ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x0A, 0xD8, 0x4F, 0xD8, 0x97, 0xD5, 0xEB ),
+};
+static const mbedtls_mpi_uint secp192k1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0xA2, 0xE7, 0x01, 0xDA, 0xD9, 0x21, 0x38, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x72, 0xCB, 0x0F, 0x98, 0xE4, 0x30, 0xFA, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x22, 0x62, 0x8D, 0xD2, 0x1E, 0x65, 0x51, 0x83 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0x35, 0x94, 0xF8, 0x86, 0x85, 0x57, 0x1A, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x78, 0x79, 0x8C, 0x71, 0xEE, 0x6E, 0x8F, 0x6F ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x62, 0x9D, 0xC2, 0xF0, 0x63, 0x5E, 0xA6 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0x21, 0x55, 0xFD, 0x2B, 0x61, 0x6B, 0xBB, 0x95 ),
+    BYTES_TO_T_UINT_8( 0x51, 0x0A, 0x77, 0xC6, 0xC4, 0x1D, 0x23, 0x8C ),
+    BYTES_TO_T_UINT_8( 0x24, 0x96, 0xBC, 0xD3, 0x31, 0x14, 0xF9, 0xC0 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x57, 0x17, 0x52, 0xF3, 0xDD, 0x12, 0xCB, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x62, 0x8E, 0xC1, 0xFC, 0xFB, 0x7C, 0xD7, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x82, 0x7F, 0x54, 0xED, 0x32, 0x01, 0x66, 0x1E ),
+};
+static const mbedtls_mpi_uint secp192k1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x55, 0xB5, 0x68, 0x7D, 0x7B, 0x9B, 0xD6, 0xD7 ),
+    BYTES_TO_T_UINT_8( 0xB8, 0xE6, 0x9E, 0xF1, 0xFC, 0x0E, 0xE0, 0x0A ),
+    BYTES_TO_T_UINT_8( 0xDC, 0x3E, 0xDD, 0x42, 0xBF, 0x88, 0x35, 0x83 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC5, 0x5E, 0x14, 0x05, 0xE7, 0xCA, 0x11, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x38, 0x3A, 0x76, 0x92, 0x11, 0xBD, 0xF7, 0x80 ),
+    BYTES_TO_T_UINT_8( 0x35, 0x1E, 0xA6, 0xB2, 0xE4, 0x85, 0x22, 0x67 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0xF9, 0x38, 0xA8, 0x82, 0x41, 0xBC, 0xA3, 0xEF ),
+    BYTES_TO_T_UINT_8( 0x5E, 0xEC, 0x7D, 0xAD, 0xD7, 0xB5, 0xE0, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x58, 0xCC, 0x8B, 0x36, 0x8B, 0x1F, 0x96, 0x5C ),
+};
+static const mbedtls_mpi_uint secp192k1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x78, 0xFA, 0x52, 0x79, 0xB0, 0x71, 0x67, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0xAA, 0x75, 0xB2, 0x20, 0x3C, 0x8F, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x52, 0x6A, 0xDA, 0xE1, 0x84, 0x4B, 0x2C, 0x69 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x84, 0x0B, 0xC4, 0x75, 0x43, 0x39, 0x4C, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x3F, 0x24, 0xAC, 0x62, 0xE4, 0x49, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x1F, 0xA8, 0xFD, 0x1F, 0x04, 0x6A, 0xC8, 0xBE ),
+};
+static const mbedtls_mpi_uint secp192k1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFA, 0xAA, 0x87, 0x77, 0x67, 0xF7, 0xBB, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0x33, 0xD7, 0xF5, 0x1C, 0x82, 0x62, 0xD0, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x93, 0xB9, 0x8F, 0xB9, 0x3E, 0x58, 0x6A, 0xD2 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0x2D, 0x55, 0x3E, 0x74, 0x3F, 0x84, 0x1B, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x4D, 0x6D, 0x13, 0xC0, 0x7F, 0xDE, 0x00 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x67, 0x76, 0x30, 0x0A, 0x3A, 0x03, 0xF0 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA8, 0xA8, 0x2D, 0x26, 0xF7, 0x4B, 0x1C, 0xFB ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x01, 0xD3, 0xB2, 0xCC, 0x94, 0xDD, 0x77 ),
+    BYTES_TO_T_UINT_8( 0x1F, 0xE9, 0x55, 0xDF, 0x10, 0x06, 0x58, 0x14 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0x75, 0xFB, 0x82, 0xFD, 0x45, 0xE8, 0x71, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x1C, 0xB9, 0xD1, 0x41, 0xB4, 0xBB, 0x6A ),
+    BYTES_TO_T_UINT_8( 0x15, 0xB0, 0xD2, 0x21, 0x9F, 0x3C, 0x99, 0xA4 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA5, 0xCE, 0x52, 0x83, 0xFB, 0x50, 0x91, 0x71 ),
+    BYTES_TO_T_UINT_8( 0x88, 0xB5, 0x71, 0xD8, 0x93, 0x29, 0x62, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x0F, 0x21, 0x50, 0x77, 0xF6, 0xF0, 0x81, 0xD0 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x66, 0xB0, 0xCC, 0x92, 0x0C, 0x44, 0x65, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xC8, 0x27, 0xA2, 0xC2, 0x8A, 0xA3, 0x69, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x36, 0x36, 0x93, 0xC2, 0x29, 0x40, 0xD0, 0x5D ),
+};
+static const mbedtls_mpi_uint secp192k1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDE, 0x99, 0x82, 0xBF, 0x5F, 0xF9, 0x9E, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x63, 0xD6, 0x6F, 0x5C, 0x34, 0x5D, 0x40, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xCE, 0xF8, 0x23, 0xE7, 0x71, 0xEC, 0xF8, 0x2A ),
+};
+static const mbedtls_mpi_uint secp192k1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0xAE, 0x41, 0x1E, 0xFF, 0x93, 0x04, 0x29, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0x5A, 0x05, 0x49, 0x1C, 0x84, 0xBE, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0x1B, 0x65, 0xBD, 0x65, 0xE3, 0x8E, 0x46, 0x04 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE2, 0x27, 0x9C, 0xC6, 0xB0, 0x11, 0xA6, 0x89 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0x13, 0xE2, 0xE3, 0xC4, 0x50, 0xDB, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0x75, 0xCF, 0x76, 0x38, 0xBF, 0x5A, 0x97 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0x81, 0x60, 0xC4, 0x23, 0xA8, 0xAF, 0xC8, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x39, 0xAB, 0xC4, 0xE2, 0xFE, 0x9C, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0x46, 0x0C, 0x60, 0xE0, 0x27, 0xF3, 0xB7, 0x80 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x05, 0xC6, 0xE0, 0x33, 0x6C, 0x74, 0x90, 0x0E ),
+    BYTES_TO_T_UINT_8( 0x4D, 0x00, 0x10, 0x2F, 0x34, 0x15, 0xCE, 0x19 ),
+    BYTES_TO_T_UINT_8( 0x26, 0x76, 0xD5, 0x3A, 0xEA, 0xA8, 0xE9, 0x34 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0x32, 0xF5, 0x27, 0x9C, 0xB3, 0x78, 0x4C, 0x0A ),
+    BYTES_TO_T_UINT_8( 0xA1, 0x41, 0x58, 0xAF, 0x76, 0x00, 0x00, 0x11 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0xC6, 0x38, 0xFD, 0x6C, 0x03, 0x36, 0xB5 ),
+};
+static const mbedtls_mpi_uint secp192k1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0x88, 0x13, 0xC9, 0xF6, 0x3D, 0xBE, 0xAA, 0x3E ),
+    BYTES_TO_T_UINT_8( 0x59, 0x8D, 0x58, 0x29, 0x1E, 0x75, 0xF2, 0x85 ),
+    BYTES_TO_T_UINT_8( 0x35, 0x8D, 0x82, 0x3F, 0xF2, 0x33, 0xFD, 0x44 ),
+};
+static const mbedtls_ecp_point secp192k1_T[32] = {
+    ECP_POINT_INIT_XY( secp192k1_T_0_X, secp192k1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_1_X, secp192k1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_2_X, secp192k1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_3_X, secp192k1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_4_X, secp192k1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_5_X, secp192k1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_6_X, secp192k1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_7_X, secp192k1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_8_X, secp192k1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_9_X, secp192k1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_10_X, secp192k1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_11_X, secp192k1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_12_X, secp192k1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_13_X, secp192k1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_14_X, secp192k1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_15_X, secp192k1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_16_X, secp192k1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_17_X, secp192k1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_18_X, secp192k1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_19_X, secp192k1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_20_X, secp192k1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_21_X, secp192k1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_22_X, secp192k1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_23_X, secp192k1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_24_X, secp192k1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_25_X, secp192k1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_26_X, secp192k1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_27_X, secp192k1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_28_X, secp192k1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_29_X, secp192k1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_30_X, secp192k1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp192k1_T_31_X, secp192k1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP192K1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_SECP224K1_ENABLED)
+static const mbedtls_mpi_uint secp224k1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x5C, 0xA4, 0xB7, 0xB6, 0x0E, 0x65, 0x7E, 0x0F ),
+    BYTES_TO_T_UINT_8( 0xA9, 0x75, 0x70, 0xE4, 0xE9, 0x67, 0xA4, 0x69 ),
+    BYTES_TO_T_UINT_8( 0xA1, 0x28, 0xFC, 0x30, 0xDF, 0x99, 0xF0, 0x4D ),
+    BYTES_TO_T_UINT_4( 0x33, 0x5B, 0x45, 0xA1 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA5, 0x61, 0x6D, 0x55, 0xDB, 0x4B, 0xCA, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x59, 0xBD, 0xB0, 0xC0, 0xF7, 0x19, 0xE3, 0xF7 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0xFB, 0xCA, 0x82, 0x42, 0x34, 0xBA, 0x7F ),
+    BYTES_TO_T_UINT_4( 0xED, 0x9F, 0x08, 0x7E ),
+};
+static const mbedtls_mpi_uint secp224k1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0x45, 0xD1, 0x8A, 0x56, 0x97, 0xC1, 0x9B, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x18, 0x17, 0x45, 0x7C, 0x1C, 0x49, 0x27, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x95, 0x68, 0x47, 0x55, 0x43, 0xDA, 0x9F, 0x6F ),
+    BYTES_TO_T_UINT_4( 0x5B, 0x08, 0xF9, 0x0F ),
+};
+static const mbedtls_mpi_uint secp224k1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x6E, 0x4E, 0x26, 0x02, 0x4F, 0x6F, 0xD9, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x05, 0xFF, 0xC5, 0x3D, 0xE6, 0xA4, 0x21 ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x7B, 0x4D, 0x61, 0xA4, 0x28, 0xD6, 0xEB ),
+    BYTES_TO_T_UINT_4( 0x22, 0xE7, 0x7E, 0x3D ),
+};
+static const mbedtls_mpi_uint secp224k1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x79, 0x1A, 0x50, 0x30, 0x1F, 0x7B, 0x1E, 0x30 ),
+    BYTES_TO_T_UINT_8( 0xE5, 0x29, 0x20, 0xCC, 0x2A, 0x61, 0xBC, 0x5A ),
+    BYTES_TO_T_UINT_8( 0x46, 0x57, 0x8F, 0x0B, 0xCA, 0xCD, 0xBF, 0x93 ),
+    BYTES_TO_T_UINT_4( 0x78, 0x6F, 0x07, 0x08 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB2, 0x2B, 0x1C, 0x08, 0x90, 0xB1, 0xA2, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x4A, 0xAB, 0x68, 0x7D, 0x90, 0xED, 0xD6, 0xE9 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x9D, 0x18, 0xC2, 0xDA, 0xDB, 0xA8, 0x59 ),
+    BYTES_TO_T_UINT_4( 0x25, 0x28, 0x70, 0xB8 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x5F, 0xBD, 0x5C, 0xC4, 0x35, 0xFA, 0xDE, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0xC7, 0x4F, 0x19, 0xD2, 0xDD, 0xC8, 0xFB ),
+    BYTES_TO_T_UINT_8( 0x4F, 0x7A, 0x03, 0xA8, 0x33, 0x8E, 0x6C, 0x10 ),
+    BYTES_TO_T_UINT_4( 0x09, 0x78, 0x6F, 0x13 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0x56, 0xC4, 0x44, 0x8D, 0xDE, 0x4A, 0x94, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x95, 0x40, 0x8B, 0xE7, 0xF8, 0x2A, 0x95, 0x6E ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x7A, 0x83, 0x01, 0x98, 0x51, 0xB1, 0x80 ),
+    BYTES_TO_T_UINT_4( 0x41, 0x82, 0x18, 0xCC ),
+};
+static const mbedtls_mpi_uint secp224k1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0x96, 0x6B, 0x1D, 0x9C, 0x7B, 0xC8, 0x23, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0xFA, 0xE4, 0x42, 0x8F, 0x26, 0x50, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0xB7, 0xFD, 0xFD, 0xBE, 0x27, 0x5A, 0xC4 ),
+    BYTES_TO_T_UINT_4( 0x0C, 0xF9, 0xE1, 0x5A ),
+};
+static const mbedtls_mpi_uint secp224k1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD4, 0x1B, 0xCD, 0x5A, 0x0D, 0x7C, 0xED, 0xFA ),
+    BYTES_TO_T_UINT_8( 0xED, 0x4F, 0xB2, 0xAB, 0xA1, 0xBB, 0x09, 0xDE ),
+    BYTES_TO_T_UINT_8( 0x5B, 0x09, 0x83, 0x41, 0x74, 0xB4, 0x47, 0xB1 ),
+    BYTES_TO_T_UINT_4( 0x46, 0x0B, 0x5D, 0xDA ),
+};
+static const mbedtls_mpi_uint secp224k1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0xBC, 0x3C, 0x7A, 0x9C, 0x3A, 0xFD, 0x5E, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x8C, 0xC3, 0x08, 0x6F, 0xD2, 0x06, 0x9D ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x9E, 0xFD, 0x8A, 0xE8, 0x8C, 0xB8, 0xCD ),
+    BYTES_TO_T_UINT_4( 0xCA, 0x47, 0x43, 0xBF ),
+};
+static const mbedtls_mpi_uint secp224k1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC7, 0x80, 0x68, 0xED, 0x96, 0x50, 0x8E, 0x3B ),
+    BYTES_TO_T_UINT_8( 0x00, 0x23, 0xAD, 0xCD, 0x57, 0xBB, 0x47, 0x3B ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x35, 0x6F, 0x19, 0x42, 0xE7, 0x45, 0xD4 ),
+    BYTES_TO_T_UINT_4( 0x4C, 0x95, 0xCF, 0x53 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0x9A, 0xE4, 0x90, 0xBC, 0xB5, 0x33, 0x03, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x90, 0xA5, 0x85, 0x0C, 0x59, 0x67, 0x55, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x23, 0x78, 0x89, 0xD7, 0x60, 0xAF, 0x17 ),
+    BYTES_TO_T_UINT_4( 0xE6, 0x4B, 0x95, 0xDE ),
+};
+static const mbedtls_mpi_uint secp224k1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0x05, 0x75, 0x35, 0xB8, 0x5D, 0x9A, 0x88, 0x92 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0x6C, 0xF3, 0x73, 0xC6, 0x55, 0xA3, 0xCB ),
+    BYTES_TO_T_UINT_8( 0xEC, 0xBC, 0x2B, 0x35, 0x54, 0x6E, 0x03, 0x94 ),
+    BYTES_TO_T_UINT_4( 0x52, 0xCD, 0x2A, 0x0A ),
+};
+static const mbedtls_mpi_uint secp224k1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0x68, 0x5C, 0x07, 0x8B, 0xCC, 0x4A, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0x12, 0x11, 0x12, 0x17, 0x4C, 0x68, 0xBE, 0x80 ),
+    BYTES_TO_T_UINT_8( 0x57, 0x49, 0x63, 0x5E, 0x42, 0x39, 0x17, 0xF1 ),
+    BYTES_TO_T_UINT_4( 0xDF, 0xC3, 0xEC, 0x6B ),
+};
+static const mbedtls_mpi_uint secp224k1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x56, 0xA3, 0x42, 0xFB, 0x9A, 0x60, 0x6F, 0x33 ),
+    BYTES_TO_T_UINT_8( 0x58, 0xA9, 0x3E, 0x22, 0x2A, 0xAB, 0xFE, 0xE0 ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x45, 0x7B, 0xF8, 0x99, 0xCD, 0x00, 0x30 ),
+    BYTES_TO_T_UINT_4( 0x28, 0xDB, 0x3D, 0x64 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x65, 0x4E, 0xB9, 0x98, 0xAD, 0x80, 0xF0, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x87, 0xE4, 0x21, 0x77, 0x4D, 0xE8, 0x7B, 0x95 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0x26, 0x9E, 0xE5, 0xCF, 0x70, 0x48, 0x51 ),
+    BYTES_TO_T_UINT_4( 0x3B, 0x21, 0xE4, 0x07 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD0, 0x93, 0x7E, 0x51, 0xD3, 0x1B, 0x4E, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x6E, 0xEB, 0xEA, 0xE3, 0xCC, 0x26, 0x9E, 0x7A ),
+    BYTES_TO_T_UINT_8( 0xAA, 0x78, 0x1B, 0xD4, 0x55, 0xAC, 0x6E, 0xA3 ),
+    BYTES_TO_T_UINT_4( 0xA7, 0x0A, 0xCC, 0xD2 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0x77, 0x6C, 0xC4, 0x97, 0xB7, 0x8B, 0x8B, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x94, 0x22, 0x93, 0x3F, 0x1E, 0xB6, 0x22, 0x92 ),
+    BYTES_TO_T_UINT_8( 0xD4, 0x1F, 0xFE, 0x25, 0x64, 0x2C, 0x36, 0x6C ),
+    BYTES_TO_T_UINT_4( 0xAC, 0x4B, 0x0A, 0xC4 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0x30, 0x0F, 0xEA, 0x01, 0x50, 0xC3, 0xAD, 0x7B ),
+    BYTES_TO_T_UINT_8( 0x4D, 0x03, 0x29, 0xED, 0xB7, 0x9F, 0xC8, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x01, 0x94, 0x3F, 0x8B, 0xAF, 0x9F, 0xE3, 0x5E ),
+    BYTES_TO_T_UINT_4( 0x52, 0x3C, 0x46, 0xE9 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0xB1, 0x92, 0x54, 0x3C, 0x6F, 0x30, 0x7B, 0x0C ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x8A, 0xF3, 0x14, 0xDB, 0x42, 0x23, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x93, 0x4E, 0x3E, 0x2E, 0xAE, 0x62, 0xED ),
+    BYTES_TO_T_UINT_4( 0xA4, 0xD6, 0xD6, 0xCB ),
+};
+static const mbedtls_mpi_uint secp224k1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x55, 0x0D, 0x50, 0x5E, 0x48, 0x36, 0x70, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xD7, 0x4D, 0xD9, 0x9B, 0x01, 0x23, 0x78, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x01, 0xEF, 0xF1, 0x5C, 0x2D, 0xBD, 0x94, 0x6D ),
+    BYTES_TO_T_UINT_4( 0x43, 0x7A, 0xFA, 0xE7 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0x96, 0xE9, 0xB0, 0x18, 0x31, 0x07, 0xC7, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0x84, 0x16, 0x2C, 0x3F, 0x5F, 0xBB, 0x11, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x70, 0x6A, 0xD4, 0xB2, 0x77, 0x32, 0x4F, 0xF2 ),
+    BYTES_TO_T_UINT_4( 0x71, 0x39, 0x74, 0x0E ),
+};
+static const mbedtls_mpi_uint secp224k1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0x65, 0x12, 0x56, 0x7B, 0xE5, 0x86, 0x77, 0x78 ),
+    BYTES_TO_T_UINT_8( 0xE2, 0x38, 0x7A, 0x10, 0xD5, 0x91, 0x34, 0x45 ),
+    BYTES_TO_T_UINT_8( 0x62, 0xFA, 0x66, 0xCB, 0x2F, 0xE6, 0x9E, 0xFF ),
+    BYTES_TO_T_UINT_4( 0xF0, 0xC7, 0x39, 0xE3 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0xBD, 0x5F, 0x1E, 0x87, 0x96, 0x95, 0x64, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x15, 0xBD, 0xFA, 0x85, 0x77, 0x4D, 0x64, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x7B, 0x3E, 0x31, 0x53, 0xB3, 0xC0, 0xBC, 0xB8 ),
+    BYTES_TO_T_UINT_4( 0xA1, 0x6E, 0x51, 0xDE ),
+};
+static const mbedtls_mpi_uint secp224k1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA7, 0x94, 0x33, 0x5C, 0xEE, 0x51, 0xC0, 0x86 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0x19, 0x42, 0xB0, 0x9E, 0x11, 0x13, 0x35 ),
+    BYTES_TO_T_UINT_8( 0x47, 0x43, 0xA7, 0x08, 0xBA, 0x91, 0xCB, 0x00 ),
+    BYTES_TO_T_UINT_4( 0xDF, 0x3F, 0xC6, 0x78 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x3E, 0x6E, 0xC1, 0x93, 0x5D, 0xA1, 0xA8, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0x7E, 0xDD, 0xC3, 0x13, 0xEB, 0xAD, 0x7E, 0x29 ),
+    BYTES_TO_T_UINT_8( 0x06, 0x43, 0xCC, 0xF9, 0x0C, 0x27, 0xA8, 0x56 ),
+    BYTES_TO_T_UINT_4( 0xCF, 0xA2, 0x5C, 0x28 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0xCD, 0x91, 0x60, 0x3E, 0x58, 0xEF, 0x9F, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x78, 0xC6, 0x34, 0x0C, 0x1A, 0x3B, 0xF6, 0x8B ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x66, 0x61, 0xDC, 0x84, 0x10, 0x32, 0xAF ),
+    BYTES_TO_T_UINT_4( 0xFB, 0x21, 0x50, 0xE5 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x43, 0xD3, 0xEC, 0x76, 0xB2, 0x54, 0x10, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x1B, 0xDF, 0x46, 0xD1, 0x67, 0x99, 0xEC, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x05, 0x00, 0x06, 0xDC, 0xB0, 0xA6, 0x44, 0xDC ),
+    BYTES_TO_T_UINT_4( 0x1A, 0xA2, 0x36, 0xD2 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB3, 0x24, 0xDF, 0xD6, 0x54, 0x4E, 0x83, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0x2B, 0x60, 0xDC, 0x70, 0x94, 0x09, 0xBF ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x9F, 0xFB, 0x7C, 0x0A, 0x5B, 0xF4, 0xC0 ),
+    BYTES_TO_T_UINT_4( 0xED, 0x0B, 0x8F, 0x76 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0x61, 0xFD, 0xA2, 0xC0, 0x4E, 0x54, 0x04, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0x92, 0xB8, 0x7E, 0x92, 0x19, 0x7B, 0xE9, 0xFC ),
+    BYTES_TO_T_UINT_8( 0x39, 0x2B, 0x47, 0x10, 0xDB, 0x48, 0xBD, 0x92 ),
+    BYTES_TO_T_UINT_4( 0xF9, 0x5F, 0x40, 0xD1 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEC, 0x35, 0x90, 0x87, 0x3C, 0x25, 0x45, 0x7B ),
+    BYTES_TO_T_UINT_8( 0x92, 0x7B, 0xA7, 0x7F, 0xF6, 0xC8, 0xA8, 0x66 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x3D, 0xE6, 0x36, 0x68, 0xC0, 0xA7, 0x0A ),
+    BYTES_TO_T_UINT_4( 0x2B, 0x88, 0x39, 0xD1 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x5E, 0x18, 0xAA, 0x29, 0xC9, 0x3D, 0x2E, 0x7C ),
+    BYTES_TO_T_UINT_8( 0x9C, 0xB9, 0x54, 0xA0, 0x09, 0x93, 0x5E, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0x83, 0x64, 0xE4, 0x14, 0x03, 0x7D, 0x8C, 0x2F ),
+    BYTES_TO_T_UINT_4( 0x3E, 0xB5, 0x19, 0xE0 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0x08, 0x0B, 0x6E, 0x69, 0xE4, 0xF8, 0xE1, 0x02 ),
+    BYTES_TO_T_UINT_8( 0x76, 0x86, 0xE0, 0x7B, 0xD8, 0xF8, 0xA3, 0x9E ),
+    BYTES_TO_T_UINT_8( 0xDE, 0x5B, 0xE0, 0x40, 0x98, 0xEE, 0x8E, 0xBE ),
+    BYTES_TO_T_UINT_4( 0xF0, 0x87, 0xB0, 0x88 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x0C, 0xD8, 0x37, 0xC1, 0x3F, 0xA5, 0xAF, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x63, 0xFD, 0x11, 0xF1, 0x49, 0xC1, 0x7F ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x86, 0x57, 0xFE, 0x3D, 0xE8, 0x6A, 0xFD ),
+    BYTES_TO_T_UINT_4( 0x5A, 0xF2, 0x18, 0x09 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFA, 0xC4, 0x85, 0xFE, 0xCD, 0x2E, 0x84, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0xA2, 0xBE, 0x59, 0x45, 0x76, 0x7D, 0xEA, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x11, 0xED, 0x26, 0x8D, 0x6D, 0x12, 0xE6, 0x6F ),
+    BYTES_TO_T_UINT_4( 0x03, 0xA8, 0xDD, 0x40 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x8A, 0x5E, 0xDA, 0x61, 0x74, 0x80, 0x41, 0x1B ),
+    BYTES_TO_T_UINT_8( 0xDE, 0xFA, 0x66, 0xB3, 0x91, 0xD8, 0xAF, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0x36, 0x5A, 0xC6, 0x24, 0x99, 0xE0, 0x70, 0xCE ),
+    BYTES_TO_T_UINT_4( 0xC3, 0x5C, 0x76, 0xDF ),
+};
+static const mbedtls_mpi_uint secp224k1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0x82, 0xF9, 0xCA, 0xB3, 0xE2, 0x55, 0x91, 0x52 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0xA0, 0xF8, 0x72, 0x1E, 0xFC, 0x8F, 0x0C ),
+    BYTES_TO_T_UINT_8( 0xA1, 0x0A, 0x8C, 0x6A, 0xCB, 0xB6, 0xCD, 0x98 ),
+    BYTES_TO_T_UINT_4( 0x34, 0xC7, 0xFD, 0x00 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0x5A, 0x07, 0x80, 0x88, 0xB9, 0x42, 0x1D, 0x53 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x59, 0xAA, 0x0B, 0x6F, 0x9C, 0xB6, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x68, 0x0C, 0x77, 0x54, 0xD0, 0x0B, 0xF1, 0x8A ),
+    BYTES_TO_T_UINT_4( 0xC9, 0xCA, 0x80, 0x73 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC8, 0xC7, 0x88, 0xD6, 0xFC, 0xB7, 0xE5, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0xB8, 0xF2, 0x8F, 0xEA, 0x36, 0xA0, 0x92 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0xDC, 0x19, 0x71, 0xA3, 0xE1, 0x9B, 0x5E ),
+    BYTES_TO_T_UINT_4( 0x9D, 0xB6, 0x5D, 0xDA ),
+};
+static const mbedtls_mpi_uint secp224k1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0xD7, 0x43, 0x64, 0xFA, 0xC3, 0x9B, 0xE8, 0x2A ),
+    BYTES_TO_T_UINT_8( 0xCF, 0x5D, 0x0B, 0xA1, 0x28, 0x70, 0x2E, 0xFB ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x0F, 0x00, 0x9E, 0xDD, 0x4E, 0x4D, 0xC8 ),
+    BYTES_TO_T_UINT_4( 0x09, 0xB8, 0x93, 0xF7 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD9, 0x6F, 0xA1, 0xD0, 0xDB, 0xDD, 0x6E, 0x8F ),
+    BYTES_TO_T_UINT_8( 0xED, 0x98, 0x75, 0xC6, 0xE3, 0x4A, 0xDB, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0x85, 0x6C, 0xD5, 0x9C, 0x17, 0xC9, 0x77 ),
+    BYTES_TO_T_UINT_4( 0x8D, 0xA2, 0xB5, 0xE8 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0x11, 0x67, 0x20, 0x21, 0x08, 0x7F, 0x38, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x1B, 0x0A, 0xBE, 0x99, 0xC4, 0x7A, 0x5A ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x88, 0x52, 0xEB, 0xD6, 0xAE, 0xE8, 0xBF ),
+    BYTES_TO_T_UINT_4( 0x25, 0xF8, 0x46, 0xDC ),
+};
+static const mbedtls_mpi_uint secp224k1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0x3E, 0xE3, 0x9B, 0x57, 0xA8, 0xA7, 0x15, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xE9, 0xC7, 0x86, 0xD6, 0x80, 0x00, 0x32, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xDF, 0xA5, 0xD3, 0x26, 0xBC, 0x9B, 0xF0, 0xE5 ),
+    BYTES_TO_T_UINT_4( 0x8B, 0x57, 0xA2, 0x3D ),
+};
+static const mbedtls_mpi_uint secp224k1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0x56, 0x4F, 0x49, 0x0D, 0xFE, 0xD0, 0x41, 0x21 ),
+    BYTES_TO_T_UINT_8( 0x6A, 0xCE, 0x7D, 0xCC, 0xCA, 0x3C, 0x10, 0x80 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0xE6, 0xC5, 0x81, 0xC9, 0xC1, 0xAC, 0x89 ),
+    BYTES_TO_T_UINT_4( 0x1F, 0x3E, 0x4A, 0xFF ),
+};
+static const mbedtls_mpi_uint secp224k1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x09, 0xD1, 0x26, 0xCD, 0xD2, 0x99, 0x28, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x09, 0x4E, 0x07, 0xD7, 0xF3, 0xA6, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x4C, 0xBF, 0xD6, 0xCF, 0xD7, 0xF9, 0x55, 0xD3 ),
+    BYTES_TO_T_UINT_4( 0x47, 0xC3, 0x78, 0x6C ),
+};
+static const mbedtls_mpi_uint secp224k1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x2F, 0x91, 0x31, 0x90, 0xCA, 0x69, 0x37, 0x48 ),
+    BYTES_TO_T_UINT_8( 0x56, 0xCB, 0x79, 0x6F, 0x74, 0x3A, 0x98, 0xBA ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x0F, 0xB4, 0xFB, 0x39, 0x23, 0x91, 0xFE ),
+    BYTES_TO_T_UINT_4( 0xA3, 0x3B, 0x9D, 0x77 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0xE4, 0x28, 0x6D, 0x3A, 0xF1, 0x53, 0xDA ),
+    BYTES_TO_T_UINT_8( 0x33, 0x18, 0x15, 0xDD, 0x30, 0x5D, 0xF0, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x47, 0xD5, 0xDB, 0x4D, 0x1E, 0xDF, 0x8A, 0xB6 ),
+    BYTES_TO_T_UINT_4( 0x1C, 0x29, 0x1A, 0x85 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0x2D, 0xEE, 0x3B, 0x18, 0x0F, 0x02, 0xDE, 0xC2 ),
+    BYTES_TO_T_UINT_8( 0x2D, 0xAD, 0x13, 0x19, 0x65, 0xCE, 0x1F, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x77, 0x5E, 0x09, 0xBD, 0x42, 0xA1, 0x1B, 0x7C ),
+    BYTES_TO_T_UINT_4( 0x7D, 0x6D, 0x3B, 0x36 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0xAF, 0x0E, 0x1C, 0xE5, 0x21, 0x3F, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x57, 0xAA, 0x11, 0xC8, 0x3D, 0x41, 0xDE, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x0F, 0xC9, 0x3B, 0x0B, 0x99, 0xF9, 0x26, 0x1F ),
+    BYTES_TO_T_UINT_4( 0x44, 0xDA, 0x31, 0x19 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x5B, 0x97, 0x50, 0x26, 0x34, 0xE9, 0x7C, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x2D, 0x12, 0x6C, 0x69, 0x7F, 0x3A, 0x2E, 0x74 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x8C, 0x48, 0xAA, 0xE6, 0x6E, 0x4E, 0x95 ),
+    BYTES_TO_T_UINT_4( 0xE3, 0x71, 0x83, 0x2B ),
+};
+static const mbedtls_mpi_uint secp224k1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0x57, 0x10, 0x23, 0x0A, 0x0D, 0x4D, 0x68, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0xAA, 0x83, 0xFA, 0x62, 0x5D, 0x8E, 0x41, 0xBD ),
+    BYTES_TO_T_UINT_8( 0xF7, 0xAE, 0xC9, 0xBF, 0x80, 0xD3, 0x59, 0x67 ),
+    BYTES_TO_T_UINT_4( 0xEE, 0x49, 0x8E, 0x23 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0xA1, 0xC6, 0xB2, 0x86, 0xA0, 0xDE, 0xE0, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0x64, 0xEB, 0x84, 0x2B, 0x53, 0xD3, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x58, 0x8F, 0x8E, 0xC4, 0x35, 0x52, 0xB1, 0x66 ),
+    BYTES_TO_T_UINT_4( 0xCD, 0xE9, 0x71, 0xE9 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDF, 0x2A, 0x70, 0x71, 0x97, 0x37, 0xC2, 0x9D ),
+    BYTES_TO_T_UINT_8( 0x5F, 0xAE, 0x2D, 0xF7, 0x6A, 0xDE, 0xA8, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x9A, 0xC3, 0xFA, 0x4F, 0x35, 0x3B, 0xB7, 0x68 ),
+    BYTES_TO_T_UINT_4( 0x57, 0x13, 0x59, 0xF2 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0xE5, 0x30, 0x48, 0xA4, 0xE3, 0xE6, 0x68, 0x9A ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x51, 0x11, 0xB6, 0x54, 0x2A, 0x1B, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0x6D, 0xFD, 0xCF, 0xDB, 0xD2, 0xB1, 0x27 ),
+    BYTES_TO_T_UINT_4( 0xA4, 0x0E, 0xFE, 0x9A ),
+};
+static const mbedtls_mpi_uint secp224k1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0x7A, 0x1B, 0x61, 0xEC, 0xE8, 0xDC, 0xE4, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0x7F, 0xFE, 0xEB, 0xBA, 0x04, 0x23, 0xE0, 0xCD ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x3D, 0x75, 0x7C, 0xED, 0x82, 0xF7, 0x20 ),
+    BYTES_TO_T_UINT_4( 0xE7, 0xED, 0xFB, 0xCA ),
+};
+static const mbedtls_mpi_uint secp224k1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0xDD, 0x12, 0xB1, 0xA3, 0xED, 0xD7, 0x99, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x18, 0x9C, 0x3D, 0x7E, 0x95, 0x29, 0x47, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xC4, 0xD0, 0xC5, 0x09, 0x9A, 0x4F, 0xA1, 0x58 ),
+    BYTES_TO_T_UINT_4( 0xB1, 0x2C, 0x9F, 0xF6 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0x3D, 0x88, 0x1A, 0x10, 0x33, 0x3F, 0x14, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0x8A, 0xC8, 0xD9, 0x30, 0x27, 0x8D, 0x31, 0x3E ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x09, 0x1F, 0x19, 0xDD, 0x96, 0x2B, 0xFE ),
+    BYTES_TO_T_UINT_4( 0x92, 0x18, 0x27, 0x96 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0x44, 0x78, 0xB7, 0x4F, 0x80, 0x88, 0x3A, 0xEA ),
+    BYTES_TO_T_UINT_8( 0x69, 0xC7, 0x04, 0x81, 0x58, 0xB6, 0x2D, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0xB3, 0xAD, 0x07, 0x7C, 0x90, 0x47, 0x6F ),
+    BYTES_TO_T_UINT_4( 0xB9, 0x8E, 0x79, 0x89 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDD, 0xF3, 0x52, 0x0A, 0xC4, 0xB6, 0x6A, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0x31, 0x26, 0xBE, 0x1D, 0x1C, 0x82, 0xB7, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x97, 0x63, 0x72, 0x44, 0x21, 0x26, 0xEB, 0xBA ),
+    BYTES_TO_T_UINT_4( 0x5A, 0x88, 0xD7, 0xF4 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0x3A, 0xD3, 0x2B, 0xB5, 0x76, 0x26, 0x8D, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x51, 0x68, 0xB8, 0xA1, 0x7A, 0xCE, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x18, 0x55, 0xA2, 0x77, 0x41, 0xE0, 0x12, 0x42 ),
+    BYTES_TO_T_UINT_4( 0x4B, 0x45, 0x62, 0x7C ),
+};
+static const mbedtls_mpi_uint secp224k1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x78, 0x0E, 0x0F, 0xE3, 0x09, 0x7D, 0x12, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0x00, 0x01, 0x57, 0xA8, 0x53, 0x5B, 0xF8, 0xED ),
+    BYTES_TO_T_UINT_8( 0x11, 0x02, 0xFB, 0x40, 0x0D, 0x4E, 0xEB, 0x31 ),
+    BYTES_TO_T_UINT_4( 0xA3, 0xE3, 0xD3, 0x71 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0xEC, 0x88, 0x38, 0xEA, 0x9A, 0x1E, 0xFB, 0x9D ),
+    BYTES_TO_T_UINT_8( 0x07, 0xD5, 0x80, 0x92, 0xEE, 0xD2, 0xCD, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x23, 0xED, 0x8B, 0x8A, 0x60, 0xFD, 0xB3, 0x79 ),
+    BYTES_TO_T_UINT_4( 0x06, 0xAE, 0xA5, 0x16 ),
+};
+static const mbedtls_mpi_uint secp224k1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC5, 0xBF, 0xDC, 0x4D, 0xF1, 0xB8, 0x60, 0x07 ),
+    BYTES_TO_T_UINT_8( 0xEE, 0xB7, 0xD5, 0x04, 0xD1, 0x0F, 0xE3, 0xDE ),
+    BYTES_TO_T_UINT_8( 0x01, 0xA5, 0x89, 0x00, 0x54, 0xBA, 0x0D, 0x72 ),
+    BYTES_TO_T_UINT_4( 0xEF, 0xD1, 0x7D, 0xEE ),
+};
+static const mbedtls_ecp_point secp224k1_T[32] = {
+    ECP_POINT_INIT_XY( secp224k1_T_0_X, secp224k1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_1_X, secp224k1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_2_X, secp224k1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_3_X, secp224k1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_4_X, secp224k1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_5_X, secp224k1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_6_X, secp224k1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_7_X, secp224k1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_8_X, secp224k1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_9_X, secp224k1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_10_X, secp224k1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_11_X, secp224k1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_12_X, secp224k1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_13_X, secp224k1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_14_X, secp224k1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_15_X, secp224k1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_16_X, secp224k1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_17_X, secp224k1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_18_X, secp224k1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_19_X, secp224k1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_20_X, secp224k1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_21_X, secp224k1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_22_X, secp224k1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_23_X, secp224k1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_24_X, secp224k1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_25_X, secp224k1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_26_X, secp224k1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_27_X, secp224k1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_28_X, secp224k1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_29_X, secp224k1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_30_X, secp224k1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp224k1_T_31_X, secp224k1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP224K1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_SECP256K1_ENABLED)
+static const mbedtls_mpi_uint secp256k1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x98, 0x17, 0xF8, 0x16, 0x5B, 0x81, 0xF2, 0x59 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x28, 0xCE, 0x2D, 0xDB, 0xFC, 0x9B, 0x02 ),
+    BYTES_TO_T_UINT_8( 0x07, 0x0B, 0x87, 0xCE, 0x95, 0x62, 0xA0, 0x55 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0xBB, 0xDC, 0xF9, 0x7E, 0x66, 0xBE, 0x79 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB8, 0xD4, 0x10, 0xFB, 0x8F, 0xD0, 0x47, 0x9C ),
+    BYTES_TO_T_UINT_8( 0x19, 0x54, 0x85, 0xA6, 0x48, 0xB4, 0x17, 0xFD ),
+    BYTES_TO_T_UINT_8( 0xA8, 0x08, 0x11, 0x0E, 0xFC, 0xFB, 0xA4, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x65, 0xC4, 0xA3, 0x26, 0x77, 0xDA, 0x3A, 0x48 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0x04, 0xD3, 0x0F, 0xB1, 0x57, 0xD0, 0x27, 0xBE ),
+    BYTES_TO_T_UINT_8( 0x26, 0x3A, 0x7F, 0x34, 0x38, 0x06, 0x96, 0x86 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0xA8, 0xE4, 0x18, 0xD6, 0xB2, 0xD0, 0x8C ),
+    BYTES_TO_T_UINT_8( 0xD4, 0x88, 0x4D, 0x8B, 0x54, 0xD5, 0x76, 0x65 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x7E, 0x5A, 0xB3, 0x74, 0xF6, 0xFB, 0x14, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0xA5, 0xDC, 0x19, 0xFF, 0xC8, 0x91, 0xDE ),
+    BYTES_TO_T_UINT_8( 0xCD, 0xA2, 0x71, 0x74, 0xBD, 0x82, 0xA2, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x39, 0x8C, 0x1E, 0x3A, 0x3E, 0xE6, 0x81, 0xB4 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x96, 0x61, 0x86, 0xF7, 0xC8, 0xFC, 0x73, 0x3E ),
+    BYTES_TO_T_UINT_8( 0xAA, 0xF4, 0xB3, 0x81, 0x36, 0x1C, 0xE2, 0x25 ),
+    BYTES_TO_T_UINT_8( 0x07, 0xAE, 0x39, 0x93, 0x80, 0x5E, 0x56, 0x52 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0x3C, 0x1E, 0x89, 0xAB, 0x7E, 0xC4, 0x29 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0xCD, 0x3D, 0xAC, 0x26, 0xA9, 0x8A, 0x9D, 0x3D ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x0F, 0xF1, 0x2F, 0x5B, 0x81, 0x49, 0x3E ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x3E, 0xCA, 0x6A, 0xEC, 0x8D, 0x5A, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x3D, 0xB8, 0x88, 0xB7, 0x94, 0x0D, 0x4E ),
+};
+static const mbedtls_mpi_uint secp256k1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0xB1, 0xE6, 0x7F, 0x2B, 0xC4, 0xF9, 0x6F, 0x8F ),
+    BYTES_TO_T_UINT_8( 0x30, 0xD4, 0xDE, 0x65, 0xB0, 0xB5, 0x47, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0x4B, 0x5F, 0xAA, 0x29, 0x26, 0xC3, 0x53, 0x5D ),
+    BYTES_TO_T_UINT_8( 0xC5, 0x26, 0xD3, 0x63, 0x72, 0xE1, 0xA2, 0xCE ),
+};
+static const mbedtls_mpi_uint secp256k1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD1, 0x7B, 0xCF, 0xB3, 0xE5, 0x11, 0x51, 0x7E ),
+    BYTES_TO_T_UINT_8( 0xA7, 0x47, 0xC5, 0x99, 0xA2, 0x7F, 0x15, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xE4, 0xB9, 0x51, 0xC2, 0xAB, 0x42, 0x4E, 0x88 ),
+    BYTES_TO_T_UINT_8( 0x6F, 0xD9, 0x97, 0x9B, 0xB5, 0x5D, 0x68, 0x31 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0x45, 0x9A, 0x27, 0xCE, 0x89, 0x79, 0x2F, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xBF, 0x23, 0x0F, 0x27, 0xA8, 0x0F, 0x8B, 0xEA ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x23, 0x26, 0xBD, 0xE5, 0x7C, 0x5C, 0x50 ),
+    BYTES_TO_T_UINT_8( 0xC6, 0x23, 0x01, 0xCD, 0x87, 0x45, 0x0E, 0x2C ),
+};
+static const mbedtls_mpi_uint secp256k1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA8, 0x8D, 0x85, 0x79, 0xED, 0x91, 0x54, 0xAA ),
+    BYTES_TO_T_UINT_8( 0xBE, 0x8E, 0x34, 0xC5, 0xF3, 0xDB, 0x81, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0xEB, 0x01, 0x68, 0x94, 0x5C, 0xAA, 0x5B, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x62, 0x27, 0xD4, 0x07, 0x27, 0x61, 0x2F, 0xA0 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x0A, 0x1F, 0xF4, 0x16, 0xBA, 0x69, 0x55, 0x35 ),
+    BYTES_TO_T_UINT_8( 0x70, 0x0C, 0x85, 0xA5, 0x05, 0xBB, 0x1E, 0x4D ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x5D, 0xE5, 0x57, 0x98, 0x76, 0x95, 0x5A ),
+    BYTES_TO_T_UINT_8( 0x33, 0xD8, 0xE7, 0x1C, 0xF8, 0xE5, 0x43, 0x25 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8C, 0x23, 0x96, 0x05, 0xA0, 0x13, 0xE9, 0x50 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0xC3, 0xBF, 0x2F, 0x31, 0x40, 0x0E, 0xEF ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x34, 0x36, 0x57, 0x66, 0xB5, 0x3E, 0xC2 ),
+    BYTES_TO_T_UINT_8( 0x1F, 0x88, 0x3C, 0x17, 0x33, 0x05, 0xF0, 0x9A ),
+};
+static const mbedtls_mpi_uint secp256k1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0xDA, 0xE9, 0xE4, 0x78, 0x21, 0x2E, 0xAC, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x67, 0xC8, 0x3D, 0xD3, 0x70, 0xD8, 0xB8, 0x37 ),
+    BYTES_TO_T_UINT_8( 0xA9, 0x6E, 0xBA, 0x39, 0xE4, 0x13, 0x08, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0x0B, 0x0C, 0x7D, 0x04, 0xCE, 0x56, 0x3D ),
+};
+static const mbedtls_mpi_uint secp256k1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0x31, 0x5F, 0x00, 0x6E, 0xC7, 0x05, 0x72, 0x1A ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x0E, 0xBF, 0x0B, 0x92, 0x18, 0x5B, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x28, 0xD9, 0x79, 0xBB, 0xD9, 0xB4, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x16, 0xB1, 0x2C, 0x97, 0x98, 0x50, 0x42 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0x20, 0xBA, 0xCF, 0xFA, 0x66, 0x61, 0x77, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x91, 0xF4, 0xB1, 0x32, 0x62, 0x41, 0xA9, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x6D, 0xD6, 0x09, 0x79, 0xA1, 0xA1, 0xD8, 0x25 ),
+    BYTES_TO_T_UINT_8( 0x80, 0xF3, 0x92, 0x21, 0xD8, 0x5D, 0xD8, 0x8F ),
+};
+static const mbedtls_mpi_uint secp256k1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8D, 0xD6, 0x75, 0x12, 0x3B, 0x97, 0xF5, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x9A, 0x5B, 0x7B, 0x19, 0xC7, 0x56, 0xCA ),
+    BYTES_TO_T_UINT_8( 0xE9, 0xB9, 0x3F, 0xCB, 0x4F, 0xB3, 0x4C, 0x14 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xFF, 0xB2, 0xAF, 0x91, 0x05, 0xE0, 0x90 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x67, 0x13, 0xED, 0x48, 0xDD, 0x72, 0xB0, 0x92 ),
+    BYTES_TO_T_UINT_8( 0x97, 0x12, 0x03, 0x3D, 0xDD, 0xCE, 0x02, 0x9C ),
+    BYTES_TO_T_UINT_8( 0x7E, 0x94, 0x8E, 0xB3, 0xA0, 0xA5, 0xB0, 0xFD ),
+    BYTES_TO_T_UINT_8( 0x07, 0x66, 0x2F, 0xA8, 0x80, 0x75, 0x20, 0x0D ),
+};
+static const mbedtls_mpi_uint secp256k1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8E, 0xD2, 0x93, 0xF6, 0x26, 0x73, 0x60, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x04, 0xD7, 0x73, 0xD4, 0xE9, 0xF8, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x21, 0xA8, 0x06, 0x78, 0x5E, 0x10, 0x9D, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0x5A, 0x2E, 0x9F, 0x8E, 0x57, 0x6F, 0x7F ),
+};
+static const mbedtls_mpi_uint secp256k1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0x95, 0x24, 0xE8, 0x48, 0x51, 0x19, 0x0F, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x7A, 0xDE, 0x0A, 0x98, 0x87, 0x67, 0x7F, 0x0F ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x26, 0x72, 0x8F, 0x50, 0xD0, 0x1E, 0xED ),
+    BYTES_TO_T_UINT_8( 0xA7, 0x13, 0x8C, 0xFA, 0x0E, 0x4E, 0x96, 0xC1 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2C, 0x5F, 0xAB, 0xDD, 0x7C, 0x05, 0x8B, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x01, 0x5B, 0xE3, 0x5E, 0x62, 0xE3, 0xD4, 0x74 ),
+    BYTES_TO_T_UINT_8( 0x4C, 0x22, 0x8E, 0x3B, 0xBF, 0x9B, 0x01, 0x9B ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x1F, 0xC2, 0x01, 0x16, 0x05, 0xC3, 0x9B ),
+};
+static const mbedtls_mpi_uint secp256k1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0x68, 0xEA, 0x2A, 0x1B, 0x26, 0x85, 0x66, 0xF9 ),
+    BYTES_TO_T_UINT_8( 0x81, 0xA3, 0xAD, 0x3F, 0x2B, 0xBC, 0xAC, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x3E, 0x51, 0xCD, 0x23, 0xEF, 0x4B, 0x13, 0xCE ),
+    BYTES_TO_T_UINT_8( 0x7B, 0xCA, 0x35, 0xFA, 0x5C, 0xFC, 0xAB, 0xC7 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1C, 0x8C, 0x65, 0x92, 0xD1, 0xAB, 0xB5, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x0E, 0x9D, 0xD1, 0x30, 0xB7, 0x85, 0xBC ),
+    BYTES_TO_T_UINT_8( 0xC5, 0xCC, 0xA3, 0x29, 0xA0, 0xFB, 0xC5, 0xCF ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x55, 0xF7, 0x38, 0xF1, 0xB7, 0x58, 0x87 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0x0D, 0x0A, 0x7B, 0x95, 0x48, 0x36, 0x66, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x45, 0x37, 0x64, 0xF7, 0x55, 0xB6, 0xD9, 0xF0 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x48, 0x61, 0x46, 0x46, 0x0C, 0x0B, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x25, 0x3F, 0x4E, 0x2C, 0x24, 0x4E, 0xE9, 0x40 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0x05, 0x3E, 0x0E, 0xA6, 0xF5, 0xF6, 0x58, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x6C, 0xD6, 0xA1, 0xE5, 0x6F, 0x1D, 0x73, 0x6D ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x84, 0x3E, 0xBD, 0x1D, 0x8E, 0xE0, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x23, 0x5C, 0x74, 0xAB, 0x13, 0xE3, 0x9E, 0x16 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0x71, 0x36, 0xD6, 0x35, 0xC7, 0x81, 0xFA, 0x87 ),
+    BYTES_TO_T_UINT_8( 0xA9, 0x49, 0xEB, 0xF2, 0x62, 0x53, 0x88, 0x64 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0xB3, 0x7E, 0x3D, 0x7F, 0x48, 0xEB, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x84, 0x7B, 0x45, 0xE5, 0xEA, 0xA5, 0xF1 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA7, 0xDC, 0x57, 0xAF, 0x95, 0x4B, 0x66, 0x1F ),
+    BYTES_TO_T_UINT_8( 0xC2, 0xAF, 0x62, 0x1B, 0x9C, 0xCE, 0x94, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x81, 0x2C, 0xA2, 0xFE, 0x40, 0x89, 0x9A ),
+    BYTES_TO_T_UINT_8( 0xB4, 0xB5, 0x8C, 0xCB, 0x38, 0xC9, 0xEB, 0x0A ),
+};
+static const mbedtls_mpi_uint secp256k1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x30, 0xA2, 0x53, 0x01, 0x8F, 0x5B, 0x20, 0x76 ),
+    BYTES_TO_T_UINT_8( 0x21, 0x1A, 0xDD, 0x20, 0x6F, 0xF8, 0xB7, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x7E, 0xC3, 0xC0, 0x83, 0x6D, 0x5D, 0xAE, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0x7D, 0x82, 0xC2, 0x32, 0xA5, 0x48, 0x10, 0x5C ),
+};
+static const mbedtls_mpi_uint secp256k1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x33, 0xA5, 0x73, 0xBC, 0xD1, 0xD4, 0xF3, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xAD, 0xB3, 0xA8, 0x98, 0x41, 0xB6, 0xFF, 0x91 ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x2A, 0x3E, 0x0F, 0xC7, 0x69, 0x24, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x91, 0xC8, 0x80, 0x26, 0x33, 0xFC, 0x59, 0x68 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0x26, 0x10, 0x0F, 0x71, 0x19, 0xC4, 0xC3, 0xDD ),
+    BYTES_TO_T_UINT_8( 0x4A, 0x7C, 0x26, 0xCA, 0x62, 0x23, 0x6F, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x90, 0xC1, 0x53, 0xA7, 0x08, 0xB8, 0x04, 0x06 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0xE2, 0xCE, 0xFE, 0x13, 0xBB, 0x34, 0x0A ),
+};
+static const mbedtls_mpi_uint secp256k1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0x96, 0x45, 0x7B, 0x83, 0x51, 0x05, 0x66, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x58, 0x75, 0xE1, 0x0E, 0xFE, 0x1C, 0x41, 0xD9 ),
+    BYTES_TO_T_UINT_8( 0x55, 0x0F, 0x5F, 0xC1, 0x02, 0xAF, 0x1E, 0x0C ),
+    BYTES_TO_T_UINT_8( 0x3C, 0x90, 0x8A, 0xE0, 0x2C, 0x73, 0x69, 0x1D ),
+};
+static const mbedtls_mpi_uint secp256k1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0x70, 0x6A, 0x50, 0x48, 0xCF, 0x5F, 0x21, 0x4B ),
+    BYTES_TO_T_UINT_8( 0xAC, 0x1F, 0x27, 0xE7, 0x9A, 0xBF, 0x58, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xBB, 0xCA, 0xC0, 0xA2, 0xFB, 0x70, 0xAD ),
+    BYTES_TO_T_UINT_8( 0xFE, 0xF3, 0x06, 0x1D, 0x9F, 0xC3, 0x7A, 0x0E ),
+};
+static const mbedtls_mpi_uint secp256k1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA9, 0xE7, 0x0A, 0x10, 0x0E, 0xFA, 0x55, 0x14 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x7A, 0x3C, 0x76, 0x41, 0x47, 0x46, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x92, 0x78, 0xCD, 0xED, 0xEA, 0xC5, 0x0A, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xA2, 0xC7, 0x94, 0x99, 0x78, 0x71, 0x25 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0xEF, 0x52, 0x09, 0x70, 0xCC, 0xDD, 0xF3, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x41, 0x91, 0xCA, 0x53, 0xBD, 0xF9, 0x97, 0x32 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0xEA, 0x3A, 0x55, 0xD1, 0x8F, 0xD2, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x8E, 0xD4, 0xCC, 0xB0, 0xB6, 0x17, 0xC8, 0x1C ),
+};
+static const mbedtls_mpi_uint secp256k1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8E, 0x53, 0x7F, 0x12, 0x83, 0xDD, 0xB1, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x22, 0x6A, 0x3D, 0x78, 0xDD, 0x09, 0xE3, 0xCB ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x3D, 0x03, 0x75, 0x3C, 0x28, 0x44, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0x9C, 0xC2, 0x85, 0xDA, 0xC7, 0x58, 0x3E, 0x1E ),
+};
+static const mbedtls_mpi_uint secp256k1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0xAD, 0xAC, 0x9B, 0x95, 0x00, 0x85, 0xD4, 0x53 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0x2A, 0x2A, 0x60, 0x7A, 0x12, 0x9B, 0x33 ),
+    BYTES_TO_T_UINT_8( 0x81, 0xCB, 0x41, 0xE6, 0xF4, 0xBE, 0x48, 0x14 ),
+    BYTES_TO_T_UINT_8( 0x3E, 0xAE, 0x0D, 0x7E, 0x42, 0x3F, 0xA5, 0xEF ),
+};
+static const mbedtls_mpi_uint secp256k1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2A, 0xFD, 0x6A, 0xCA, 0x5E, 0xA1, 0xA2, 0xCF ),
+    BYTES_TO_T_UINT_8( 0x25, 0x9E, 0x1F, 0x89, 0x47, 0xC8, 0xD7, 0x25 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x9D, 0x94, 0xDD, 0x70, 0x7E, 0xA2, 0x07 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x65, 0xBB, 0xA2, 0xE1, 0xBA, 0x5B, 0x6F ),
+};
+static const mbedtls_mpi_uint secp256k1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x71, 0x0F, 0x2F, 0x12, 0x99, 0x51, 0x08, 0x4F ),
+    BYTES_TO_T_UINT_8( 0x19, 0x36, 0x4B, 0x56, 0x1D, 0xF2, 0xBF, 0x98 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x44, 0x13, 0xEA, 0x18, 0x49, 0x55, 0x3C ),
+    BYTES_TO_T_UINT_8( 0x53, 0xF9, 0x29, 0xC7, 0xA6, 0x18, 0xF1, 0x80 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA2, 0x9C, 0x1A, 0x1F, 0x60, 0x7C, 0x20, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0x56, 0xB6, 0x04, 0xA1, 0x24, 0x66, 0x2B ),
+    BYTES_TO_T_UINT_8( 0xED, 0x7F, 0xDE, 0x9D, 0x2F, 0x03, 0xAF, 0x92 ),
+    BYTES_TO_T_UINT_8( 0x48, 0xAF, 0x56, 0x77, 0x8C, 0x40, 0xC9, 0x43 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0xED, 0x81, 0xF7, 0x5F, 0x04, 0xC2, 0x08, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0x90, 0x87, 0x76, 0xA7, 0x05, 0x02, 0x67 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0x53, 0x79, 0x11, 0x7C, 0x84, 0xF2, 0x44 ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x51, 0x89, 0x97, 0x7A, 0x89, 0xC5, 0x38 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0x68, 0x39, 0x6F, 0xFD, 0xC9, 0x87, 0xE3, 0x9F ),
+    BYTES_TO_T_UINT_8( 0x1B, 0xFD, 0xAE, 0x1C, 0x26, 0x48, 0xEB, 0xFF ),
+    BYTES_TO_T_UINT_8( 0x11, 0x73, 0xCA, 0x23, 0x64, 0x31, 0x4D, 0x1B ),
+    BYTES_TO_T_UINT_8( 0x09, 0x3C, 0xFB, 0x6D, 0xD5, 0x58, 0x78, 0x94 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x91, 0xAF, 0xAD, 0xFB, 0x43, 0xD1, 0xA6, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x71, 0xE4, 0x39, 0x03, 0xF2, 0x5A, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0x13, 0x9C, 0x4B, 0xD0, 0x74, 0x1B, 0xC6, 0x9B ),
+    BYTES_TO_T_UINT_8( 0xF4, 0xAE, 0x6E, 0xD2, 0x5F, 0x48, 0x92, 0x2F ),
+};
+static const mbedtls_mpi_uint secp256k1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0x26, 0x89, 0x2D, 0x19, 0x95, 0x37, 0x6A, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x99, 0x76, 0x4A, 0xAD, 0x5C, 0x6B, 0x12 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0xF4, 0xC6, 0x7F, 0x33, 0x62, 0x17, 0x1A ),
+    BYTES_TO_T_UINT_8( 0xA8, 0x4C, 0x82, 0xF3, 0x88, 0x0B, 0x07, 0x20 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0xBA, 0xA0, 0xB8, 0x99, 0x6C, 0x2B, 0x8E, 0x5C ),
+    BYTES_TO_T_UINT_8( 0xC2, 0xAF, 0x6E, 0x77, 0xBB, 0xAA, 0xCB, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0x41, 0xC5, 0x6B, 0xBC, 0xC2, 0x24, 0x20, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x18, 0xDC, 0xD0, 0x90, 0x5A, 0xFD, 0xB0, 0x75 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEC, 0xE2, 0x9C, 0x60, 0x8E, 0xF1, 0x9E, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xD2, 0x31, 0x40, 0xEB, 0xE1, 0xB2, 0xFB ),
+    BYTES_TO_T_UINT_8( 0x34, 0xF4, 0xF1, 0xFC, 0x4C, 0x73, 0x9D, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x26, 0xBF, 0x58, 0x4B, 0xA4, 0xF9, 0x3C ),
+};
+static const mbedtls_mpi_uint secp256k1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0xA6, 0x02, 0xB0, 0xAE, 0x9D, 0x9C, 0xD5, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x4A, 0xD0, 0x32, 0x8E, 0xDB, 0x98, 0x2C, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x05, 0xAA, 0xF6, 0xED, 0x91, 0x9E, 0x90, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0xDC, 0x16, 0x77, 0x45, 0xC6, 0xDD, 0x2D, 0x80 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x02, 0x4D, 0xA3, 0x20, 0xEB, 0x3A, 0xBB, 0xC1 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x6C, 0xFD, 0xC7, 0x8A, 0xE0, 0x20, 0x99 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xE4, 0x1B, 0xD9, 0xEA, 0x4F, 0x42, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0x62, 0x8E, 0x84, 0xDB, 0x27, 0x7E, 0x6B, 0xD4 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x95, 0x69, 0xD3, 0xC9, 0x14, 0xCC, 0xCD, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0xB6, 0x97, 0x3B, 0x7A, 0xA7, 0x82, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0xB3, 0xEF, 0xCD, 0xBC, 0x79, 0xD0, 0xA6, 0x85 ),
+    BYTES_TO_T_UINT_8( 0xE2, 0x67, 0x38, 0x69, 0x48, 0x16, 0xA6, 0x7A ),
+};
+static const mbedtls_mpi_uint secp256k1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x90, 0x9E, 0x4E, 0xAD, 0xC1, 0x3D, 0xA3, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x89, 0x0B, 0x21, 0x0C, 0x43, 0xB2, 0x15, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x1D, 0x99, 0x99, 0xEE, 0x7A, 0x1D, 0x6B ),
+    BYTES_TO_T_UINT_8( 0xD6, 0xB7, 0xC3, 0x56, 0x06, 0xA7, 0x5E, 0x21 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0x3D, 0x03, 0x76, 0x5D, 0x5D, 0x0D, 0x5B, 0x31 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0xA2, 0xA2, 0x39, 0x2C, 0x52, 0x25, 0x17 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0xC1, 0x70, 0x12, 0x89, 0x96, 0x13, 0x8E ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x5B, 0xE6, 0x77, 0x0E, 0x99, 0xCF, 0x97 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x89, 0x40, 0xD3, 0x64, 0x3C, 0x0E, 0x15, 0xAB ),
+    BYTES_TO_T_UINT_8( 0x92, 0xCD, 0x79, 0x0A, 0x4A, 0xE2, 0x27, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x02, 0xB4, 0x6E, 0x3C, 0x94, 0xA8, 0x66 ),
+    BYTES_TO_T_UINT_8( 0xB1, 0xF3, 0x9B, 0xF3, 0x6A, 0x12, 0x6F, 0x0C ),
+};
+static const mbedtls_mpi_uint secp256k1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x0D, 0x35, 0x99, 0x14, 0x7C, 0x6A, 0x75, 0x19 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x27, 0x61, 0x47, 0xC1, 0x3A, 0xE3, 0x0C ),
+    BYTES_TO_T_UINT_8( 0x59, 0x10, 0xEC, 0x2B, 0x23, 0x90, 0xBD, 0xDD ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xE5, 0xCC, 0xF5, 0xE6, 0x2F, 0xCA, 0x6F ),
+};
+static const mbedtls_mpi_uint secp256k1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9F, 0xF1, 0xE0, 0x01, 0x3A, 0xF8, 0xF0, 0xE0 ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x24, 0x3B, 0x3A, 0x5A, 0xC8, 0x3C, 0x90 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xB6, 0x9B, 0xF7, 0x64, 0x1B, 0xF6, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0xAD, 0x2D, 0x7B, 0x64, 0x22, 0xBF, 0x81 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0xA7, 0x5B, 0x7E, 0x60, 0x60, 0x08, 0xB9, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x54, 0xC5, 0xF5, 0xBF, 0x84, 0xA5, 0x1A ),
+    BYTES_TO_T_UINT_8( 0x2C, 0xD9, 0x62, 0xE9, 0x5C, 0x6E, 0xF7, 0x57 ),
+    BYTES_TO_T_UINT_8( 0x44, 0x91, 0x4E, 0x2B, 0xFB, 0x5E, 0xD4, 0x60 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD3, 0xE3, 0x17, 0x04, 0x0E, 0xAF, 0x84, 0xAC ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x5B, 0xAE, 0x0F, 0xAD, 0x3D, 0x8E, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x6E, 0x34, 0xA1, 0xE9, 0x61, 0x09, 0xEE, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x08, 0xA9, 0x8B, 0xBE, 0x90, 0xAD, 0xCA ),
+};
+static const mbedtls_mpi_uint secp256k1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0xC1, 0xEE, 0xAE, 0x40, 0xCE, 0xB0, 0xA6, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x26, 0xED, 0x52, 0x82, 0x97, 0x55, 0x1B, 0x86 ),
+    BYTES_TO_T_UINT_8( 0x49, 0xF8, 0xEF, 0x78, 0xE2, 0x6D, 0x5F, 0x6C ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xAE, 0xBD, 0x18, 0x6D, 0x44, 0xFB, 0xB0 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4B, 0xCB, 0x52, 0xCC, 0x4E, 0x2E, 0x4C, 0xDD ),
+    BYTES_TO_T_UINT_8( 0x62, 0x9A, 0x4F, 0xA9, 0x8C, 0x65, 0x4F, 0x61 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x23, 0x48, 0x73, 0x3E, 0x45, 0x02, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x54, 0x07, 0x57, 0xCB, 0x4F, 0x3F, 0x57, 0x44 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x6C, 0x7B, 0x6E, 0x71, 0x2C, 0xA9, 0x2E, 0x79 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x22, 0xC8, 0xB2, 0xAA, 0xD0, 0xA2, 0x91 ),
+    BYTES_TO_T_UINT_8( 0x4B, 0xA7, 0xE2, 0x45, 0x71, 0x12, 0xAF, 0x39 ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xF5, 0xC8, 0x05, 0xFF, 0x13, 0xC6, 0xAD ),
+};
+static const mbedtls_mpi_uint secp256k1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF4, 0xCB, 0x00, 0xFB, 0x3E, 0x79, 0xD9, 0xE9 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0xD7, 0xB4, 0x71, 0xCC, 0xA7, 0xB7, 0x31 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x03, 0x87, 0xE3, 0x04, 0x4C, 0x25, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0xE9, 0x80, 0x22, 0xF2, 0x92, 0x9A, 0x7F, 0xC9 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0x59, 0x52, 0x60, 0x93, 0x32, 0x0C, 0x6E, 0x88 ),
+    BYTES_TO_T_UINT_8( 0x0B, 0xB9, 0x59, 0x8D, 0x8A, 0x12, 0xDF, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x94, 0x30, 0x22, 0x40, 0x02, 0xA2, 0xEB, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x7F, 0xEF, 0x7B, 0x06, 0x14, 0x7F, 0xAC, 0x37 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4A, 0xE7, 0x29, 0xDA, 0x5D, 0xBB, 0xBB, 0x83 ),
+    BYTES_TO_T_UINT_8( 0x01, 0x9B, 0x6E, 0xA7, 0x8F, 0x5F, 0x45, 0x5F ),
+    BYTES_TO_T_UINT_8( 0xC4, 0xB4, 0xEC, 0xB5, 0x33, 0x35, 0xBA, 0x58 ),
+    BYTES_TO_T_UINT_8( 0xBD, 0xC6, 0xC1, 0x57, 0x1F, 0x32, 0x8E, 0x28 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0xE5, 0x59, 0xDA, 0x95, 0x90, 0xB7, 0x71, 0x86 ),
+    BYTES_TO_T_UINT_8( 0x75, 0x85, 0x74, 0x0A, 0xF6, 0x4F, 0xA0, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x6E, 0xA2, 0xD6, 0xD5, 0x47, 0x99, 0xB5, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x3E, 0x5A, 0x89, 0x3B, 0x38, 0xEE, 0x7D, 0x9E ),
+};
+static const mbedtls_mpi_uint secp256k1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x5B, 0x48, 0xEE, 0x53, 0x1A, 0xBA, 0x0F, 0x3E ),
+    BYTES_TO_T_UINT_8( 0x4F, 0xA8, 0x6C, 0x02, 0x21, 0x19, 0x4A, 0x35 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0xCC, 0xC7, 0x0A, 0xC3, 0xB3, 0x1A, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x22, 0x07, 0x78, 0xFA, 0x1B, 0x83, 0x49 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0xEE, 0x0F, 0x53, 0x1F, 0x49, 0xAD, 0xCC, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x98, 0x1B, 0x3B, 0xFB, 0x7F, 0x1D, 0xE9, 0x5A ),
+    BYTES_TO_T_UINT_8( 0x45, 0xBF, 0x91, 0xBA, 0xFD, 0x93, 0x28, 0x14 ),
+    BYTES_TO_T_UINT_8( 0x39, 0xBA, 0x0F, 0x57, 0xD2, 0x8A, 0x89, 0x25 ),
+};
+static const mbedtls_mpi_uint secp256k1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE3, 0x80, 0x71, 0x1B, 0x82, 0x59, 0xAA, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x52, 0x4C, 0xC5, 0xC7, 0x4C, 0xE3, 0x89, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xDB, 0x03, 0x82, 0xF2, 0xD1, 0xAA, 0xD4, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x76, 0x26, 0xB0, 0xD4, 0xB6, 0x88, 0x21 ),
+};
+static const mbedtls_ecp_point secp256k1_T[32] = {
+    ECP_POINT_INIT_XY( secp256k1_T_0_X, secp256k1_T_0_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_1_X, secp256k1_T_1_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_2_X, secp256k1_T_2_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_3_X, secp256k1_T_3_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_4_X, secp256k1_T_4_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_5_X, secp256k1_T_5_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_6_X, secp256k1_T_6_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_7_X, secp256k1_T_7_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_8_X, secp256k1_T_8_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_9_X, secp256k1_T_9_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_10_X, secp256k1_T_10_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_11_X, secp256k1_T_11_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_12_X, secp256k1_T_12_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_13_X, secp256k1_T_13_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_14_X, secp256k1_T_14_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_15_X, secp256k1_T_15_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_16_X, secp256k1_T_16_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_17_X, secp256k1_T_17_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_18_X, secp256k1_T_18_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_19_X, secp256k1_T_19_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_20_X, secp256k1_T_20_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_21_X, secp256k1_T_21_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_22_X, secp256k1_T_22_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_23_X, secp256k1_T_23_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_24_X, secp256k1_T_24_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_25_X, secp256k1_T_25_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_26_X, secp256k1_T_26_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_27_X, secp256k1_T_27_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_28_X, secp256k1_T_28_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_29_X, secp256k1_T_29_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_30_X, secp256k1_T_30_Y ),
+    ECP_POINT_INIT_XY( secp256k1_T_31_X, secp256k1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_SECP256K1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_BP256R1_ENABLED)
+static const mbedtls_mpi_uint brainpoolP256r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x62, 0x32, 0xCE, 0x9A, 0xBD, 0x53, 0x44, 0x3A ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x23, 0xBD, 0xE3, 0xE1, 0x27, 0xDE, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xAF, 0xB7, 0x81, 0xFC, 0x2F, 0x48, 0x4B, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xCB, 0x57, 0x7E, 0xCB, 0xB9, 0xAE, 0xD2, 0x8B ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x97, 0x69, 0x04, 0x2F, 0xC7, 0x54, 0x1D, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x54, 0x8E, 0xED, 0x2D, 0x13, 0x45, 0x77, 0xC2 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x1D, 0x61, 0x14, 0x1A, 0x46, 0xF8, 0x97 ),
+    BYTES_TO_T_UINT_8( 0xFD, 0xC4, 0xDA, 0xC3, 0x35, 0xF8, 0x7E, 0x54 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0x4D, 0x98, 0xBB, 0x54, 0xB4, 0x99, 0xB8, 0xBA ),
+    BYTES_TO_T_UINT_8( 0x92, 0x48, 0xDE, 0x71, 0x00, 0x91, 0x8D, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x81, 0x52, 0xEF, 0xEC, 0xD3, 0x5E, 0xBE, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0x06, 0x47, 0x55, 0xEC, 0x98, 0x72, 0x8A, 0x60 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x43, 0xBE, 0xFC, 0x16, 0xCC, 0xBE, 0x5E, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0xC5, 0xB6, 0x0D, 0xE1, 0xA7, 0xAF, 0xF8, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x9B, 0xF1, 0xB1, 0x4F, 0x24, 0x5F, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x41, 0x90, 0x35, 0xED, 0x0E, 0x9D, 0x19, 0xA8 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x06, 0x49, 0xA0, 0x61, 0x7A, 0xB0, 0x6B, 0x25 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0xCE, 0x73, 0xB4, 0xD2, 0xC8, 0x10, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x78, 0x99, 0x61, 0x5A, 0xB0, 0x82, 0x7D, 0xAA ),
+    BYTES_TO_T_UINT_8( 0x4C, 0xFC, 0xE4, 0x31, 0xD9, 0x18, 0x8C, 0x8D ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2F, 0xFC, 0x4B, 0x7C, 0xD8, 0x69, 0x4A, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0xC9, 0x38, 0x75, 0xB9, 0xE4, 0x5D, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xD3, 0x72, 0xAE, 0x56, 0xD4, 0x3A, 0xFF ),
+    BYTES_TO_T_UINT_8( 0xF8, 0xDB, 0xEA, 0x73, 0xDA, 0xB6, 0x07, 0x03 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0xC0, 0xA9, 0xB7, 0x68, 0x54, 0x79, 0x86, 0x01 ),
+    BYTES_TO_T_UINT_8( 0xD3, 0xDE, 0x9F, 0x3B, 0x12, 0x1F, 0x6E, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0x62, 0xC2, 0x2C, 0x23, 0x12, 0x88, 0x34, 0x81 ),
+    BYTES_TO_T_UINT_8( 0xDB, 0xE5, 0xAB, 0x08, 0xA2, 0x34, 0xA4, 0x54 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0x62, 0x71, 0x80, 0xDD, 0x4E, 0xE0, 0xA4, 0x10 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0x4A, 0xB6, 0xAA, 0x08, 0xF4, 0x23, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x60, 0x53, 0xD0, 0xC2, 0x49, 0x93, 0x11, 0x3A ),
+    BYTES_TO_T_UINT_8( 0x63, 0xFC, 0x82, 0xAD, 0xA8, 0x97, 0xC2, 0x9F ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0x1F, 0x04, 0x01, 0x36, 0x0D, 0xA5, 0x81, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x45, 0x97, 0x78, 0x49, 0x9E, 0x90, 0x81 ),
+    BYTES_TO_T_UINT_8( 0x69, 0x81, 0xF4, 0xC3, 0x40, 0x47, 0x5E, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x61, 0x6A, 0xF2, 0xF6, 0x6C, 0xBD, 0x9A ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD7, 0xEE, 0xF4, 0x4B, 0x9C, 0x6E, 0xA7, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x50, 0xEF, 0x12, 0xE3, 0x43, 0x0D, 0xC3, 0x09 ),
+    BYTES_TO_T_UINT_8( 0xD3, 0x08, 0xCB, 0xB7, 0xC2, 0xAE, 0xB4, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0x33, 0xD7, 0x93, 0x42, 0x22, 0x23, 0x2A ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0xCF, 0xA9, 0x67, 0x47, 0xB0, 0xD2, 0x8E, 0xFA ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x71, 0x60, 0xB4, 0x91, 0x27, 0xC2, 0xBA ),
+    BYTES_TO_T_UINT_8( 0xA8, 0x84, 0xE5, 0x3A, 0x90, 0x9A, 0xEC, 0x66 ),
+    BYTES_TO_T_UINT_8( 0xFD, 0x39, 0x96, 0x42, 0x67, 0x49, 0x03, 0x7B ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF6, 0xEC, 0x8B, 0xA7, 0xB1, 0xE9, 0xC2, 0xFE ),
+    BYTES_TO_T_UINT_8( 0xF8, 0x8A, 0x3E, 0xAF, 0x61, 0xDA, 0x65, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x7F, 0x27, 0xE2, 0x93, 0x53, 0x33, 0x8A ),
+    BYTES_TO_T_UINT_8( 0x74, 0xBB, 0xEC, 0xB4, 0x2D, 0xD6, 0x5B, 0x86 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0xAE, 0x28, 0x86, 0x7D, 0xAD, 0x75, 0xC8, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x43, 0xE2, 0xBB, 0xA8, 0xAF, 0xC9, 0x2C, 0x54 ),
+    BYTES_TO_T_UINT_8( 0x69, 0x35, 0xD2, 0x30, 0xE0, 0xC5, 0xFC, 0x85 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x39, 0xC0, 0x7B, 0x6A, 0x19, 0xAB, 0x77 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB0, 0x98, 0xAC, 0x33, 0x2F, 0xCB, 0x91, 0xEC ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x2A, 0x24, 0x98, 0xBE, 0x15, 0xF9, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xA6, 0x40, 0xEF, 0x50, 0x44, 0xA9, 0x6D, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0x95, 0x7E, 0xFC, 0x4F, 0xCC, 0xD2, 0x01, 0x8E ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0xE2, 0xC9, 0x59, 0x18, 0xB4, 0x0E, 0x1B, 0x63 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0xED, 0xB0, 0xE1, 0x53, 0xE0, 0xB0, 0xFB ),
+    BYTES_TO_T_UINT_8( 0x84, 0xD7, 0xCC, 0x3A, 0x99, 0x41, 0x23, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x7B, 0x4B, 0x75, 0x58, 0x5F, 0x11, 0x57, 0x60 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0xBD, 0x80, 0xD9, 0x34, 0x9D, 0x19, 0x95, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x17, 0x92, 0x65, 0x7C, 0xA7, 0x10, 0x8A ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x11, 0x3E, 0xF1, 0x84, 0x9A, 0x40, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x2A, 0x39, 0x56, 0x10, 0xCF, 0x31, 0x54 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0x86, 0xC3, 0xA5, 0xCB, 0x49, 0x72, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x13, 0x4A, 0x1B, 0x6F, 0xC6, 0x91, 0x37, 0x47 ),
+    BYTES_TO_T_UINT_8( 0x81, 0xEE, 0x5F, 0xD8, 0xFB, 0x74, 0xB4, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x19, 0xED, 0xC7, 0xE4, 0x22, 0xFC, 0xC7, 0x89 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1C, 0x64, 0xCD, 0xEF, 0x69, 0xE6, 0xF9, 0x3E ),
+    BYTES_TO_T_UINT_8( 0xB8, 0xDD, 0x9C, 0xBA, 0x78, 0x48, 0x3C, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0x63, 0xBB, 0xDC, 0x07, 0x99, 0xE8, 0x13, 0x2E ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x40, 0x85, 0xE9, 0xF1, 0x31, 0x0B, 0x8F ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0x47, 0x9C, 0x19, 0x2A, 0x7C, 0x6A, 0xE6, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x82, 0xED, 0x1D, 0x66, 0x18, 0x91, 0xFB, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0xB2, 0x4A, 0xC2, 0xDA, 0x52, 0x48, 0xF3 ),
+    BYTES_TO_T_UINT_8( 0x54, 0x0E, 0xDB, 0x4B, 0xE7, 0x13, 0xA5, 0x3D ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0x99, 0xE4, 0xA4, 0x2E, 0x91, 0x1B, 0xE2, 0x4E ),
+    BYTES_TO_T_UINT_8( 0xF8, 0x34, 0x37, 0xF8, 0x9A, 0x7C, 0xC3, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0xA3, 0xF6, 0x6E, 0x3B, 0xCD, 0x46, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x9C, 0x02, 0xC1, 0x8F, 0x21, 0xDF, 0x46 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0x7B, 0xB5, 0x4F, 0x9C, 0xAC, 0x95, 0xCC, 0x93 ),
+    BYTES_TO_T_UINT_8( 0xBD, 0xF0, 0x13, 0xF1, 0x81, 0xA8, 0xA8, 0x77 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x98, 0x70, 0xE2, 0x54, 0x8C, 0xF7, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x37, 0x71, 0xB2, 0xE7, 0x9E, 0x9B, 0xFB, 0x04 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x16, 0x6C, 0x46, 0x65, 0x24, 0xA9, 0x6B, 0x43 ),
+    BYTES_TO_T_UINT_8( 0x7A, 0x65, 0xC7, 0xA1, 0x00, 0x8A, 0xB7, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x00, 0x4A, 0xF9, 0x49, 0xE9, 0xCF, 0xD1, 0xCE ),
+    BYTES_TO_T_UINT_8( 0x5B, 0xCE, 0x92, 0xA6, 0x6C, 0x82, 0xCC, 0x5D ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0xCE, 0x17, 0xDA, 0x9C, 0x26, 0xA3, 0x5C, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x38, 0xE0, 0xCE, 0x47, 0x78, 0x0C, 0x0D, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x42, 0xCC, 0x7F, 0x87, 0xCE, 0xFC, 0xE8, 0xC7 ),
+    BYTES_TO_T_UINT_8( 0xAF, 0xB9, 0x3F, 0x61, 0xFE, 0x99, 0xA3, 0x18 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0x3F, 0xC1, 0xE9, 0xFF, 0x03, 0x2E, 0xA4, 0x45 ),
+    BYTES_TO_T_UINT_8( 0x75, 0x59, 0xAE, 0xDF, 0x69, 0x90, 0xF2, 0x81 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0x57, 0x05, 0x82, 0x59, 0x88, 0xC7, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x8B, 0xB9, 0x40, 0x3B, 0xE0, 0xDF, 0xDE, 0x6E ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0xD1, 0xC3, 0xE5, 0x21, 0x9C, 0xB0, 0x4D, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x55, 0x86, 0xB4, 0xA8, 0x3F, 0xAB, 0x9F, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xDC, 0x16, 0xCD, 0xAB, 0xA7, 0xB7, 0x12, 0x49 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x2B, 0xC2, 0x3E, 0x68, 0xE3, 0xF5, 0x1E ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD4, 0x0A, 0x8A, 0x66, 0xD8, 0xDF, 0x8D, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x62, 0x47, 0xBC, 0x07, 0x2F, 0x5F, 0xA2, 0x95 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0xDE, 0x54, 0x90, 0x28, 0x2A, 0x65, 0x39 ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x4F, 0x4F, 0x93, 0xED, 0xA9, 0x7A, 0x65 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0xDC, 0xC3, 0x70, 0x50, 0xA6, 0x05, 0x45, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xDE, 0xB6, 0x35, 0x5E, 0x21, 0x78, 0x4D, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0x10, 0x65, 0xEB, 0xF6, 0xCE, 0xA4, 0xCD ),
+    BYTES_TO_T_UINT_8( 0x76, 0xF6, 0x4F, 0x36, 0x09, 0x50, 0xE8, 0x1D ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x01, 0xAC, 0xEF, 0x2B, 0x88, 0x35, 0xB1, 0x8A ),
+    BYTES_TO_T_UINT_8( 0x67, 0xED, 0x12, 0x3C, 0x24, 0xBF, 0xE0, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x8E, 0x3F, 0x3F, 0x80, 0xA3, 0x8C, 0x90, 0xF0 ),
+    BYTES_TO_T_UINT_8( 0x48, 0x0E, 0xA8, 0x48, 0x90, 0x07, 0xF8, 0x59 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0xF2, 0xA3, 0x4D, 0x8F, 0x7E, 0x9A, 0xF1, 0x77 ),
+    BYTES_TO_T_UINT_8( 0x54, 0xA0, 0x0F, 0xEC, 0x69, 0xD0, 0x50, 0x7E ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x1B, 0xA2, 0x9A, 0x85, 0x4D, 0x16, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xDC, 0x47, 0x28, 0x77, 0x54, 0x7E, 0x60 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9A, 0xAE, 0xCB, 0xF2, 0xCB, 0xE6, 0x68, 0xFC ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x83, 0x48, 0x26, 0x26, 0x5D, 0xED, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0xE4, 0xA8, 0x95, 0xB7, 0x91, 0xD5, 0x72, 0xD7 ),
+    BYTES_TO_T_UINT_8( 0x8C, 0xEB, 0xC9, 0x36, 0x98, 0x56, 0x1C, 0x2B ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0x6F, 0x1C, 0x93, 0x92, 0x78, 0x30, 0x28, 0x3E ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xC4, 0x09, 0x37, 0xD1, 0xAD, 0x25, 0xDB ),
+    BYTES_TO_T_UINT_8( 0xEA, 0x45, 0xCA, 0xD4, 0x6B, 0xF8, 0xC8, 0xF7 ),
+    BYTES_TO_T_UINT_8( 0x6B, 0x16, 0x59, 0x39, 0x7F, 0xA2, 0xB7, 0x1D ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0x39, 0xA5, 0x12, 0x58, 0xC7, 0x56, 0x1D, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x4E, 0xB5, 0x12, 0x12, 0x23, 0x17, 0x99, 0x2E ),
+    BYTES_TO_T_UINT_8( 0xD8, 0x9E, 0x02, 0x7C, 0x85, 0x46, 0x4C, 0xCC ),
+    BYTES_TO_T_UINT_8( 0xE0, 0x48, 0xB6, 0x89, 0x05, 0xDB, 0x70, 0x43 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x00, 0x80, 0x16, 0x32, 0x5E, 0xB6, 0x14, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x39, 0x2B, 0xF1, 0xE9, 0x97, 0xAF, 0x6E, 0xFF ),
+    BYTES_TO_T_UINT_8( 0xD4, 0x96, 0xE4, 0x2A, 0x27, 0xA6, 0xD6, 0x4D ),
+    BYTES_TO_T_UINT_8( 0x01, 0x48, 0xAD, 0xBB, 0x82, 0xCB, 0x67, 0x96 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0x54, 0x18, 0x6A, 0xD8, 0x89, 0xC1, 0x16, 0x34 ),
+    BYTES_TO_T_UINT_8( 0xCC, 0xD0, 0x08, 0x3B, 0x01, 0x43, 0xA2, 0x21 ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x0E, 0xB0, 0xF4, 0x55, 0x39, 0xA7, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x1B, 0xFD, 0xE1, 0xFA, 0x70, 0x6F, 0xAA, 0x23 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x02, 0xBA, 0x22, 0xBC, 0x46, 0x03, 0x32, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x25, 0x99, 0xF8, 0xB1, 0x5F, 0x2E, 0xEF, 0x75 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0xC2, 0xF4, 0x19, 0x17, 0x7E, 0x66, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x04, 0xDA, 0x04, 0x4D, 0x32, 0x3B, 0x9B ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9B, 0x2D, 0x05, 0x26, 0x14, 0xCB, 0x86, 0x3B ),
+    BYTES_TO_T_UINT_8( 0x2D, 0xCE, 0x65, 0x02, 0x36, 0xC4, 0xFB, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x00, 0xC6, 0xC2, 0xF4, 0xB4, 0x4B, 0xE1, 0x89 ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x26, 0xB4, 0x0D, 0xEB, 0x83, 0x55, 0x5C ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x63, 0x5A, 0x79, 0x2C, 0xCD, 0x38, 0x84, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x9A, 0xF6, 0xB9, 0x6A, 0x35, 0xE3, 0x1D, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x8B, 0x99, 0x3D, 0xCC, 0xA6, 0x04, 0xE1, 0x59 ),
+    BYTES_TO_T_UINT_8( 0xB7, 0x45, 0x5A, 0x42, 0xA9, 0xA6, 0xF1, 0x34 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0x45, 0x3D, 0x69, 0xAE, 0x7F, 0x46, 0x95, 0xEC ),
+    BYTES_TO_T_UINT_8( 0xE9, 0xE4, 0x02, 0x36, 0x08, 0xBD, 0x76, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0x7A, 0xF5, 0xC2, 0xA7, 0x48, 0x4D, 0x99, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x11, 0x4E, 0x22, 0xC8, 0x95, 0x3E, 0x37, 0x47 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0xC0, 0xCE, 0x18, 0xD2, 0xE6, 0x32, 0x3C, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0x97, 0x52, 0x7D, 0x3F, 0x55, 0xDE, 0xD5, 0x9A ),
+    BYTES_TO_T_UINT_8( 0xB2, 0xFA, 0x69, 0x5A, 0x7C, 0xBB, 0x4F, 0x01 ),
+    BYTES_TO_T_UINT_8( 0xDC, 0xA8, 0x06, 0x13, 0x0E, 0x5D, 0xCD, 0x16 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0x6C, 0xF6, 0xC2, 0x67, 0x32, 0xD3, 0x16, 0xBC ),
+    BYTES_TO_T_UINT_8( 0x91, 0xEC, 0xC6, 0xA5, 0x93, 0x2A, 0xF4, 0x6A ),
+    BYTES_TO_T_UINT_8( 0xC0, 0x7D, 0xE8, 0xFA, 0x29, 0xEE, 0x58, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x77, 0xC4, 0xF7, 0x65, 0x98, 0xC8, 0xA6 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x01, 0x3D, 0x98, 0x95, 0x0A, 0x25, 0xD3, 0x21 ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x19, 0xCD, 0xCA, 0x1B, 0x4B, 0x88, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0x47, 0x00, 0xE6, 0x25, 0x70, 0x24, 0xEF, 0x7E ),
+    BYTES_TO_T_UINT_8( 0x48, 0xAB, 0x54, 0xFE, 0x28, 0xCA, 0xE3, 0x50 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4B, 0x28, 0xD1, 0x85, 0xD2, 0x9D, 0xA4, 0x82 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x4D, 0xFC, 0xE7, 0xD8, 0xAA, 0x2F, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x36, 0xC6, 0xC3, 0x1A, 0xB9, 0x07, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x29, 0x73, 0x57, 0xFF, 0x32, 0x43, 0x05, 0x3E ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0xF2, 0x06, 0x9C, 0x27, 0x54, 0x83, 0xDD, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x61, 0xAD, 0xD2, 0x64, 0x89, 0x28, 0x7B, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x26, 0xA5, 0x10, 0x59, 0xDF, 0xB5, 0xE8, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x90, 0xE0, 0x3D, 0xB2, 0x4F, 0xAE, 0x5A, 0x79 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0x5A, 0x76, 0x33, 0xD8, 0x93, 0x0F, 0xC7, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x58, 0xDB, 0x13, 0x9C, 0x35, 0xB5, 0x35, 0xEB ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x2D, 0x25, 0x84, 0x82, 0x33, 0xA4, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0x44, 0x22, 0xF2, 0xBF, 0x37, 0xE2, 0x6E, 0x07 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0x7B, 0xC3, 0x4B, 0x1C, 0x50, 0x76, 0xFE, 0x8C ),
+    BYTES_TO_T_UINT_8( 0x7C, 0xCE, 0xB8, 0x14, 0xF9, 0x07, 0x99, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0xDE, 0x91, 0xD7, 0xE4, 0x98, 0xDC, 0xD4, 0xEF ),
+    BYTES_TO_T_UINT_8( 0x30, 0x5D, 0xAA, 0x5C, 0xB3, 0xA7, 0x89, 0x83 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0x29, 0x2F, 0xB8, 0x06, 0x10, 0x1B, 0xC7, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x1D, 0xB9, 0x18, 0xF9, 0x86, 0xA7, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x2E, 0x32, 0xBC, 0x36, 0xB1, 0x3F, 0xD4, 0x76 ),
+    BYTES_TO_T_UINT_8( 0xAA, 0xF4, 0x04, 0x5C, 0xC9, 0x40, 0x00, 0x39 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0x6F, 0xCC, 0x16, 0xCF, 0xF7, 0xCA, 0x52, 0x9C ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x73, 0x13, 0xA5, 0xC3, 0x80, 0x4B, 0x4E ),
+    BYTES_TO_T_UINT_8( 0xCC, 0x4A, 0x9D, 0x99, 0x50, 0x62, 0xF5, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x0F, 0x13, 0x50, 0xA1, 0x82, 0x11, 0xD0, 0x2C ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE7, 0x24, 0x30, 0x7B, 0x4D, 0x93, 0x50, 0x14 ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x33, 0x00, 0xFB, 0xE8, 0x29, 0x88, 0x38 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0xE5, 0xB9, 0xCF, 0xD9, 0x99, 0x4E, 0x66 ),
+    BYTES_TO_T_UINT_8( 0x57, 0x8A, 0x0A, 0xD0, 0x70, 0xF0, 0x04, 0xA4 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0xC6, 0x0A, 0x85, 0x4C, 0x12, 0x33, 0x7D, 0xEE ),
+    BYTES_TO_T_UINT_8( 0x0D, 0xDC, 0x23, 0xB7, 0x52, 0xB0, 0xEB, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x72, 0x32, 0x9D, 0xEF, 0xC3, 0x95, 0x5F ),
+    BYTES_TO_T_UINT_8( 0x75, 0xCF, 0xAA, 0xD6, 0x9E, 0x9D, 0x8C, 0x6E ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC6, 0xE0, 0x20, 0xA8, 0xD6, 0x6A, 0x0C, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x26, 0x67, 0xC3, 0x7A, 0x73, 0x2A, 0xC6, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x03, 0x8A, 0x3E, 0xB4, 0x69, 0xD2, 0xEC, 0x11 ),
+    BYTES_TO_T_UINT_8( 0x46, 0x75, 0xFB, 0x59, 0x12, 0x0F, 0xC9, 0x04 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x3B, 0x46, 0x83, 0x95, 0xA8, 0x31, 0x51, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xA0, 0x93, 0x90, 0x7A, 0x82, 0x7B, 0x59 ),
+    BYTES_TO_T_UINT_8( 0xB9, 0x71, 0x0D, 0x6D, 0xDA, 0xBF, 0x5E, 0xAF ),
+    BYTES_TO_T_UINT_8( 0x8D, 0x1E, 0xEF, 0xF4, 0xBE, 0x80, 0x8F, 0x27 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0xCE, 0x7D, 0xF3, 0x05, 0x11, 0x2A, 0x92, 0x70 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xEE, 0x48, 0xA3, 0x8F, 0x1B, 0x2A, 0x11 ),
+    BYTES_TO_T_UINT_8( 0xE2, 0x16, 0x9E, 0xE9, 0x07, 0x70, 0x9F, 0x5F ),
+    BYTES_TO_T_UINT_8( 0x94, 0x55, 0x65, 0x89, 0x4B, 0x26, 0xCB, 0x2D ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0xEB, 0x78, 0x0B, 0xFD, 0x8D, 0xE3, 0x42, 0x91 ),
+    BYTES_TO_T_UINT_8( 0x07, 0xAA, 0xCF, 0x39, 0x89, 0x43, 0x06, 0xAA ),
+    BYTES_TO_T_UINT_8( 0xCA, 0x95, 0xB1, 0x95, 0x30, 0x9D, 0x0F, 0x90 ),
+    BYTES_TO_T_UINT_8( 0x65, 0x37, 0x7C, 0x76, 0x13, 0x5F, 0xA5, 0x4D ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE9, 0xF9, 0x27, 0xD8, 0x21, 0x67, 0x25, 0x5B ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x51, 0x38, 0x01, 0xDE, 0x77, 0xE6, 0xDC ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x51, 0xF0, 0x04, 0x8F, 0xF8, 0x08, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x68, 0x2C, 0x7D, 0x84, 0x7A, 0xF5, 0xE2, 0x30 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0xA5, 0x6E, 0x17, 0xAA, 0xDD, 0xB8, 0x5D, 0x02 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0xC3, 0xB1, 0xF5, 0xC4, 0x9C, 0x12, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x84, 0xC8, 0xD7, 0xDC, 0x60, 0x15, 0xED, 0xBF ),
+    BYTES_TO_T_UINT_8( 0xEA, 0xE8, 0xAB, 0x4F, 0x1C, 0x98, 0x09, 0x86 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0x55, 0xEF, 0x00, 0x92, 0x6C, 0x82, 0xF9, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x05, 0xFC, 0x83, 0xE2, 0x59, 0x9B, 0x46, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x03, 0x5B, 0x59, 0x41, 0xF3, 0x4B, 0x91, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x6E, 0x83, 0x12, 0x56, 0xF9, 0xDE, 0xDB, 0x0C ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x90, 0x58, 0x55, 0x14, 0x38, 0xFA, 0x6D, 0xD9 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x45, 0xAB, 0xDC, 0x55, 0x43, 0x7E, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x66, 0x20, 0x07, 0x6E, 0x5E, 0x4E, 0xCD, 0x05 ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x89, 0xB4, 0xE8, 0x08, 0x23, 0x7B, 0x8A ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF1, 0xF8, 0x2D, 0x15, 0xB1, 0x41, 0x6E, 0x67 ),
+    BYTES_TO_T_UINT_8( 0x22, 0xC1, 0x9A, 0x2F, 0xE2, 0x15, 0xB6, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x27, 0xD5, 0x4D, 0xBD, 0xDE, 0x5D, 0xF8, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0xCB, 0xE5, 0xC4, 0x8A, 0xC5, 0x15, 0x1B ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0xA7, 0x81, 0xAE, 0x81, 0x24, 0x20, 0xD6, 0x18 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0x80, 0xC0, 0xB6, 0x16, 0x8B, 0xD9, 0x2E ),
+    BYTES_TO_T_UINT_8( 0xB2, 0x34, 0x62, 0x7F, 0xD2, 0x73, 0x74, 0xAB ),
+    BYTES_TO_T_UINT_8( 0x62, 0x28, 0xB3, 0xDC, 0x72, 0xE8, 0xBD, 0x09 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0x6B, 0x6F, 0xA3, 0x84, 0xF5, 0x2F, 0x0F, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0x7F, 0x29, 0x8E, 0x0F, 0x11, 0x56, 0x5B, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x83, 0x78, 0xEF, 0xC9, 0xDB, 0x0E, 0x9F, 0xCD ),
+    BYTES_TO_T_UINT_8( 0x25, 0x82, 0x1C, 0xA2, 0xFD, 0x40, 0x60, 0x37 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0xA5, 0xB3, 0x32, 0x4C, 0xAA, 0x05, 0x13, 0x57 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0xDD, 0xB5, 0xB0, 0xDD, 0xA0, 0xDA, 0x36 ),
+    BYTES_TO_T_UINT_8( 0x51, 0xAF, 0xD4, 0x5E, 0xE7, 0xBA, 0xF3, 0x3D ),
+    BYTES_TO_T_UINT_8( 0x13, 0x5A, 0x85, 0x8C, 0x79, 0x18, 0x94, 0x4B ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x44, 0x49, 0x15, 0x39, 0x69, 0x76, 0x93, 0x7D ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x3B, 0xA7, 0xAB, 0x8F, 0x6F, 0x9D, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0xBF, 0x9D, 0xEF, 0xDB, 0xD8, 0x1B, 0x95, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0x44, 0x1D, 0x0E, 0x54, 0x7C, 0xEE, 0xE8, 0x72 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0x9A, 0x90, 0xC9, 0x05, 0xDC, 0x47, 0x0B, 0x3D ),
+    BYTES_TO_T_UINT_8( 0x9C, 0x95, 0x64, 0x20, 0x74, 0xDD, 0xE9, 0x28 ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x36, 0x2F, 0xB8, 0x60, 0x5D, 0xC2, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x4A, 0x29, 0x9E, 0xDE, 0xB7, 0xC0, 0x6F, 0x36 ),
+};
+static const mbedtls_mpi_uint brainpoolP256r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0x14, 0xF5, 0xA6, 0xC2, 0x2A, 0x15, 0xC4, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x15, 0x36, 0xA0, 0x1C, 0x80, 0x7C, 0x34, 0x55 ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x8E, 0x82, 0x9F, 0x5F, 0x5D, 0x9A, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x28, 0xA9, 0x16, 0xDB, 0x4A, 0xFC, 0x16, 0x82 ),
+};
+static const mbedtls_ecp_point brainpoolP256r1_T[32] = {
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_0_X, brainpoolP256r1_T_0_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_1_X, brainpoolP256r1_T_1_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_2_X, brainpoolP256r1_T_2_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_3_X, brainpoolP256r1_T_3_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_4_X, brainpoolP256r1_T_4_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_5_X, brainpoolP256r1_T_5_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_6_X, brainpoolP256r1_T_6_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_7_X, brainpoolP256r1_T_7_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_8_X, brainpoolP256r1_T_8_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_9_X, brainpoolP256r1_T_9_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_10_X, brainpoolP256r1_T_10_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_11_X, brainpoolP256r1_T_11_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_12_X, brainpoolP256r1_T_12_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_13_X, brainpoolP256r1_T_13_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_14_X, brainpoolP256r1_T_14_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_15_X, brainpoolP256r1_T_15_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_16_X, brainpoolP256r1_T_16_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_17_X, brainpoolP256r1_T_17_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_18_X, brainpoolP256r1_T_18_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_19_X, brainpoolP256r1_T_19_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_20_X, brainpoolP256r1_T_20_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_21_X, brainpoolP256r1_T_21_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_22_X, brainpoolP256r1_T_22_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_23_X, brainpoolP256r1_T_23_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_24_X, brainpoolP256r1_T_24_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_25_X, brainpoolP256r1_T_25_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_26_X, brainpoolP256r1_T_26_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_27_X, brainpoolP256r1_T_27_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_28_X, brainpoolP256r1_T_28_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_29_X, brainpoolP256r1_T_29_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_30_X, brainpoolP256r1_T_30_Y ),
+    ECP_POINT_INIT_XY( brainpoolP256r1_T_31_X, brainpoolP256r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_BP256R1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_BP384R1_ENABLED)
+static const mbedtls_mpi_uint brainpoolP384r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x1E, 0xAF, 0xD4, 0x47, 0xE2, 0xB2, 0x87, 0xEF ),
+    BYTES_TO_T_UINT_8( 0xAA, 0x46, 0xD6, 0x36, 0x34, 0xE0, 0x26, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x10, 0xBD, 0x0C, 0xFE, 0xCA, 0x7F, 0xDB ),
+    BYTES_TO_T_UINT_8( 0xE3, 0x4F, 0xF1, 0x7E, 0xE7, 0xA3, 0x47, 0x88 ),
+    BYTES_TO_T_UINT_8( 0x6B, 0x3F, 0xC1, 0xB7, 0x81, 0x3A, 0xA6, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x45, 0xCF, 0x68, 0xF0, 0x64, 0x1C, 0x1D ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x15, 0x53, 0x3C, 0x26, 0x41, 0x03, 0x82, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x11, 0x81, 0x91, 0x77, 0x21, 0x46, 0x46, 0x0E ),
+    BYTES_TO_T_UINT_8( 0x28, 0x29, 0x91, 0xF9, 0x4F, 0x05, 0x9C, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x64, 0x58, 0xEC, 0xFE, 0x29, 0x0B, 0xB7, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x52, 0xD5, 0xCF, 0x95, 0x8E, 0xEB, 0xB1, 0x5C ),
+    BYTES_TO_T_UINT_8( 0xA4, 0xC2, 0xF9, 0x20, 0x75, 0x1D, 0xBE, 0x8A ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0x93, 0xD8, 0x8A, 0x54, 0x41, 0xD6, 0x6B, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xE2, 0x3B, 0xF1, 0x22, 0xFD, 0x2D, 0x4B, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x01, 0x55, 0xE3, 0x33, 0xF0, 0x73, 0x52, 0x5A ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x3F, 0x30, 0x26, 0xCA, 0x7F, 0x52, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0xD3, 0x6E, 0x17, 0x9B, 0xD5, 0x2A, 0x4A, 0x31 ),
+    BYTES_TO_T_UINT_8( 0x86, 0xDA, 0x6B, 0xE5, 0x03, 0x07, 0x1D, 0x2E ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x51, 0x7A, 0xAF, 0x98, 0xE3, 0xA4, 0xF6, 0x19 ),
+    BYTES_TO_T_UINT_8( 0xEC, 0x7D, 0xFE, 0x51, 0x40, 0x3B, 0x47, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x88, 0xEC, 0xC4, 0xE2, 0x8F, 0xCB, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0x30, 0xE2, 0x88, 0x2D, 0x4E, 0x50, 0xEB, 0x9A ),
+    BYTES_TO_T_UINT_8( 0x13, 0x54, 0x94, 0x5E, 0xF4, 0x7F, 0x3A, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0x07, 0x1C, 0xE1, 0xBD, 0x0F, 0xF8, 0x63 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x94, 0x92, 0x28, 0x2E, 0x32, 0x04, 0xB1, 0x4D ),
+    BYTES_TO_T_UINT_8( 0x25, 0x82, 0x44, 0x43, 0x76, 0x0D, 0x55, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x5B, 0xE3, 0xFF, 0x89, 0x46, 0xDE, 0x4E, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x5B, 0x22, 0xBB, 0x67, 0x1A, 0x81, 0xEE, 0x27 ),
+    BYTES_TO_T_UINT_8( 0xC8, 0x54, 0xE2, 0x7A, 0xAE, 0xDA, 0x2C, 0xD0 ),
+    BYTES_TO_T_UINT_8( 0x74, 0x9A, 0x90, 0xAA, 0x6E, 0x8B, 0xCC, 0x5F ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x16, 0x40, 0xAC, 0xED, 0x7D, 0x37, 0x87, 0xAC ),
+    BYTES_TO_T_UINT_8( 0x98, 0xF8, 0xB1, 0x80, 0x4C, 0x8C, 0x04, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x98, 0x2C, 0xAD, 0x30, 0x69, 0x35, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0x32, 0x2E, 0x00, 0x2F, 0x44, 0x8C, 0xF0, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0x16, 0x58, 0x07, 0xD7, 0xCD, 0x60, 0xA1, 0x5B ),
+    BYTES_TO_T_UINT_8( 0xAF, 0xFB, 0x7B, 0x03, 0x05, 0x5E, 0x79, 0x73 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0xC8, 0x17, 0xCE, 0x38, 0x4B, 0x5E, 0x5B, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x60, 0x0E, 0x0A, 0x61, 0x9D, 0x7C, 0x62, 0x08 ),
+    BYTES_TO_T_UINT_8( 0x25, 0xF0, 0x98, 0x71, 0x7F, 0x17, 0x26, 0xD7 ),
+    BYTES_TO_T_UINT_8( 0x83, 0xD3, 0xFA, 0x3C, 0xF0, 0x70, 0x07, 0x82 ),
+    BYTES_TO_T_UINT_8( 0x29, 0x47, 0x5C, 0x09, 0x43, 0xB7, 0x65, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0xA9, 0xA7, 0x3E, 0xFA, 0xF3, 0xEC, 0x22 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0xDA, 0x78, 0x22, 0x2B, 0x58, 0x71, 0xFA, 0xAA ),
+    BYTES_TO_T_UINT_8( 0x00, 0x30, 0xCE, 0x6A, 0xB3, 0xB0, 0x4F, 0x83 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0x95, 0x20, 0xA9, 0x23, 0xC2, 0x65, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x55, 0xCF, 0x03, 0x5B, 0x8A, 0x80, 0x44, 0xBB ),
+    BYTES_TO_T_UINT_8( 0x5C, 0xF8, 0x91, 0xF7, 0xD5, 0xED, 0xEA, 0x81 ),
+    BYTES_TO_T_UINT_8( 0x40, 0x5B, 0x16, 0x10, 0x25, 0xAC, 0x2A, 0x17 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0xF2, 0xEC, 0xDC, 0xC4, 0x7B, 0x8C, 0x6B, 0xE9 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xBB, 0x1C, 0xD3, 0x5A, 0xEE, 0xD9, 0x97 ),
+    BYTES_TO_T_UINT_8( 0x64, 0x5D, 0x30, 0x5E, 0xF7, 0xB2, 0x41, 0x9D ),
+    BYTES_TO_T_UINT_8( 0xED, 0xCE, 0x0F, 0x1A, 0xC6, 0x41, 0x64, 0x62 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x18, 0xE1, 0xE3, 0x82, 0x15, 0x66, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x9B, 0xE2, 0x24, 0x04, 0x72, 0x39, 0xA0, 0x7C ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2B, 0x51, 0xA2, 0x58, 0x88, 0x62, 0xE1, 0x02 ),
+    BYTES_TO_T_UINT_8( 0x58, 0xD2, 0x65, 0x14, 0xE9, 0x4C, 0x82, 0x30 ),
+    BYTES_TO_T_UINT_8( 0xDC, 0xE1, 0xAC, 0x87, 0xAE, 0x31, 0x1A, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x85, 0x4F, 0x96, 0x1E, 0x85, 0x7A, 0xC3, 0x2B ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x86, 0xBB, 0xF0, 0xC0, 0x9D, 0x08, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x53, 0x03, 0x09, 0x80, 0x91, 0xEF, 0x68 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x2D, 0xD7, 0xAF, 0x6F, 0x69, 0x7B, 0x88, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0xAF, 0x13, 0xE4, 0x30, 0xA2, 0x47, 0xB5, 0xC1 ),
+    BYTES_TO_T_UINT_8( 0x0F, 0xD2, 0xC0, 0xDD, 0x8A, 0x1C, 0x3C, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0xF9, 0x8C, 0xB3, 0x4C, 0xBA, 0x8B, 0x6D, 0xCF ),
+    BYTES_TO_T_UINT_8( 0x6B, 0xC7, 0xA1, 0xA8, 0x6E, 0x3C, 0x4F, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0x94, 0x4A, 0x97, 0xC8, 0x03, 0x6F, 0x01, 0x82 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0x74, 0x18, 0x12, 0xA9, 0x39, 0xD5, 0x22, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x47, 0xA7, 0xC0, 0xBD, 0x9D, 0x8D, 0x78, 0x38 ),
+    BYTES_TO_T_UINT_8( 0xA9, 0xB3, 0xD0, 0x7F, 0xDF, 0xD0, 0x30, 0xDE ),
+    BYTES_TO_T_UINT_8( 0x37, 0x25, 0x73, 0x96, 0xEC, 0xA8, 0x1D, 0x7C ),
+    BYTES_TO_T_UINT_8( 0x91, 0xD1, 0x65, 0x66, 0xDC, 0xD9, 0xCF, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x95, 0xED, 0x7B, 0x37, 0xAD, 0xE2, 0xBE, 0x2D ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0x50, 0x79, 0x42, 0x6A, 0x07, 0x66, 0xB1, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x45, 0x53, 0x62, 0x65, 0x92, 0x09, 0x4C, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x06, 0xAF, 0xC3, 0x03, 0xF6, 0xF4, 0x2D, 0x9B ),
+    BYTES_TO_T_UINT_8( 0xE8, 0xCA, 0x41, 0xD9, 0xA2, 0x69, 0x9B, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x4B, 0xB2, 0xA6, 0x8D, 0xE1, 0xAA, 0x61, 0x76 ),
+    BYTES_TO_T_UINT_8( 0x11, 0xBA, 0x4D, 0x12, 0xB6, 0xBE, 0xF3, 0x7E ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0xCA, 0xD9, 0x92, 0x22, 0x07, 0xCE, 0xC9, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x62, 0xA1, 0x7C, 0x91, 0xDB, 0x32, 0xF7, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x49, 0x4B, 0x6D, 0xFB, 0xD9, 0x70, 0x3B ),
+    BYTES_TO_T_UINT_8( 0x1C, 0xFB, 0x4E, 0x4C, 0x5E, 0x66, 0x81, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xA5, 0xB3, 0xE1, 0x00, 0xB7, 0xD9, 0xCC, 0x58 ),
+    BYTES_TO_T_UINT_8( 0xF3, 0x36, 0x8B, 0xC4, 0x39, 0x20, 0xFD, 0x30 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0x94, 0x1F, 0x60, 0x03, 0xBB, 0xD7, 0x60, 0x57 ),
+    BYTES_TO_T_UINT_8( 0x72, 0x3C, 0x62, 0xDD, 0x71, 0x95, 0xE9, 0x61 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x5B, 0x7A, 0x5F, 0x68, 0x81, 0xC5, 0x90 ),
+    BYTES_TO_T_UINT_8( 0x1E, 0xAF, 0xB5, 0xB9, 0x98, 0x42, 0x28, 0xA5 ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x29, 0x8E, 0x11, 0x49, 0xB4, 0xD7, 0x20 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x3E, 0xD2, 0x30, 0xA1, 0xBA, 0xCA, 0x03 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0x29, 0x37, 0x64, 0x44, 0x2F, 0x03, 0xE5, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x4A, 0x42, 0xBC, 0xFF, 0xA2, 0x1A, 0x5F, 0x06 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0x04, 0xAB, 0x04, 0xE0, 0x24, 0xAD, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x3D, 0x45, 0x17, 0x67, 0x1F, 0x3E, 0x53, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0xED, 0x0F, 0xB3, 0x1B, 0x57, 0x54, 0xC2, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x59, 0xD3, 0xF8, 0xC4, 0x1B, 0x9B, 0xFA, 0x30 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x37, 0x90, 0xFD, 0xFB, 0xCA, 0x49, 0x38, 0x4E ),
+    BYTES_TO_T_UINT_8( 0xC3, 0xCF, 0xC6, 0xDD, 0xF0, 0xFF, 0x8C, 0x11 ),
+    BYTES_TO_T_UINT_8( 0xD7, 0x69, 0x9D, 0xBD, 0x5F, 0x33, 0xE9, 0xB4 ),
+    BYTES_TO_T_UINT_8( 0x47, 0x19, 0x82, 0x3D, 0xAC, 0x1C, 0x40, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x40, 0xC7, 0x02, 0x46, 0x14, 0x77, 0x00, 0xBE ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x05, 0xF2, 0x77, 0x3A, 0x66, 0x5C, 0x39 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1E, 0xE6, 0x17, 0xDE, 0xB2, 0xA1, 0xE5, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x71, 0xEC, 0x9D, 0xD8, 0xF5, 0xD4, 0x66 ),
+    BYTES_TO_T_UINT_8( 0xAA, 0xC6, 0x42, 0x5E, 0xE7, 0x18, 0xBA, 0xD0 ),
+    BYTES_TO_T_UINT_8( 0xC5, 0x21, 0x68, 0x5A, 0x26, 0xFB, 0xD7, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x26, 0x00, 0x5C, 0xBA, 0x8A, 0x34, 0xEC, 0x75 ),
+    BYTES_TO_T_UINT_8( 0xC3, 0x9C, 0x3C, 0xAF, 0x53, 0xE8, 0x65, 0x35 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0xBE, 0xEF, 0x28, 0xDC, 0x67, 0x05, 0xC8, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x0B, 0x78, 0xC3, 0x85, 0x49, 0xA0, 0xBC, 0x0F ),
+    BYTES_TO_T_UINT_8( 0x10, 0x3E, 0x2D, 0xA0, 0xCF, 0xD4, 0x7A, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x36, 0x93, 0xFE, 0x60, 0xB3, 0x6E, 0x99, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x62, 0xAD, 0x04, 0xE7, 0x49, 0xAF, 0x5E, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0x54, 0x7A, 0xED, 0xA6, 0x9E, 0x18, 0x09, 0x31 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0xE8, 0x05, 0x94, 0x44, 0xDC, 0xB8, 0x85, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x14, 0xB7, 0x37, 0xC2, 0x50, 0x75, 0x15, 0xDA ),
+    BYTES_TO_T_UINT_8( 0xD6, 0xC6, 0x0F, 0xB2, 0xA9, 0x91, 0x3E, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0xB9, 0x81, 0xAD, 0x25, 0xA1, 0x26, 0x73, 0x15 ),
+    BYTES_TO_T_UINT_8( 0xFD, 0xF1, 0xD1, 0x61, 0x7C, 0x76, 0x8F, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x06, 0xDB, 0x4A, 0xFF, 0x14, 0xA7, 0x48, 0x0B ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0x2A, 0x73, 0xC6, 0xC2, 0xCC, 0xF1, 0x57, 0x04 ),
+    BYTES_TO_T_UINT_8( 0xB6, 0xED, 0x73, 0x27, 0x70, 0x82, 0xB6, 0x5E ),
+    BYTES_TO_T_UINT_8( 0x0B, 0xBA, 0xAC, 0x3A, 0xCF, 0xF4, 0xEA, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0x99, 0xD6, 0xB1, 0x8F, 0x0E, 0x08, 0x2C, 0x5E ),
+    BYTES_TO_T_UINT_8( 0x17, 0xE3, 0x8F, 0x2F, 0x0E, 0xA1, 0xF3, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x1A, 0xF5, 0x7C, 0x9B, 0x29, 0x0A, 0xF6, 0x28 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0xBD, 0xEE, 0x17, 0x47, 0x34, 0x15, 0xA3, 0xAF ),
+    BYTES_TO_T_UINT_8( 0xFB, 0xBE, 0x88, 0x48, 0xE7, 0xA2, 0xBB, 0xDE ),
+    BYTES_TO_T_UINT_8( 0xC5, 0xAD, 0xDC, 0x65, 0x61, 0x37, 0x0F, 0xC1 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x67, 0xAD, 0xA2, 0x3A, 0x1C, 0x91, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x55, 0x07, 0x0C, 0x3A, 0x41, 0x6E, 0x13, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x73, 0xBD, 0x7E, 0xED, 0xAA, 0x14, 0xDD, 0x61 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0xC3, 0xDC, 0x20, 0x01, 0x72, 0x11, 0x48, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x1E, 0xC4, 0x7B, 0xF8, 0x62, 0x3D, 0xF0, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xE8, 0xC2, 0x3D, 0x2E, 0x52, 0xA3, 0x4A, 0x89 ),
+    BYTES_TO_T_UINT_8( 0xCE, 0xE2, 0x53, 0x46, 0x5E, 0x21, 0xF8, 0xCE ),
+    BYTES_TO_T_UINT_8( 0xC2, 0xC7, 0x8F, 0xA9, 0x26, 0x42, 0x32, 0x3A ),
+    BYTES_TO_T_UINT_8( 0xFB, 0xA6, 0xA0, 0x8D, 0x4B, 0x9A, 0x19, 0x03 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEA, 0xAB, 0x6D, 0x1E, 0xFB, 0xEE, 0x60, 0x0C ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x56, 0x3C, 0xC5, 0x5D, 0x10, 0x79, 0x1C ),
+    BYTES_TO_T_UINT_8( 0x25, 0xBC, 0x41, 0x9F, 0x71, 0xEF, 0x02, 0xF9 ),
+    BYTES_TO_T_UINT_8( 0xA2, 0x36, 0xC4, 0xD0, 0x88, 0x9B, 0x32, 0xFC ),
+    BYTES_TO_T_UINT_8( 0x9C, 0xD4, 0x5D, 0x17, 0x39, 0xE6, 0x22, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x7B, 0x26, 0x01, 0xCE, 0xBE, 0x4A, 0x9C, 0x27 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0xEF, 0x6D, 0x11, 0xCA, 0x6C, 0x5A, 0x93, 0x0C ),
+    BYTES_TO_T_UINT_8( 0xEB, 0x96, 0x26, 0xAF, 0x2F, 0xE4, 0x30, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x35, 0xC1, 0x4C, 0xC6, 0x30, 0x1F, 0x5C, 0x04 ),
+    BYTES_TO_T_UINT_8( 0x59, 0xB3, 0xE8, 0xFC, 0x35, 0xEB, 0x63, 0x6C ),
+    BYTES_TO_T_UINT_8( 0x9C, 0x1D, 0xCA, 0xFC, 0x50, 0x36, 0x4B, 0x96 ),
+    BYTES_TO_T_UINT_8( 0xE4, 0x0E, 0x23, 0x5B, 0xAF, 0xEB, 0x2D, 0x31 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC6, 0x88, 0xB6, 0xD7, 0x74, 0x4A, 0x23, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0xEF, 0x66, 0xE2, 0xBB, 0x29, 0xA6, 0x4F, 0x55 ),
+    BYTES_TO_T_UINT_8( 0xE9, 0x6F, 0x7E, 0x68, 0x6E, 0xA0, 0x14, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x3B, 0x73, 0xD4, 0xE8, 0xAB, 0x5B, 0xF6, 0x0D ),
+    BYTES_TO_T_UINT_8( 0x46, 0xE0, 0x3C, 0x24, 0x00, 0x95, 0xE9, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x37, 0x0D, 0x4F, 0x81, 0xD0, 0xF2, 0x3F, 0x00 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x99, 0x1D, 0xCD, 0x78, 0x39, 0xC4, 0x6B, 0xD9 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x45, 0xC7, 0xB8, 0x2F, 0xAA, 0x5D, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0x33, 0x8C, 0x6E, 0xA3, 0x24, 0xB2, 0xDB, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x69, 0x2D, 0xD9, 0xF1, 0xC7, 0x9B, 0x8A, 0xAF ),
+    BYTES_TO_T_UINT_8( 0x67, 0xE1, 0x2C, 0xB9, 0x40, 0x37, 0x91, 0x75 ),
+    BYTES_TO_T_UINT_8( 0x81, 0x2C, 0xB5, 0x23, 0x03, 0x2B, 0xAF, 0x2F ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2F, 0x9D, 0x5A, 0x20, 0x10, 0xA9, 0x84, 0xDA ),
+    BYTES_TO_T_UINT_8( 0x61, 0x30, 0x89, 0x20, 0x13, 0xE9, 0xB2, 0xCA ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x6E, 0x52, 0xEB, 0x03, 0x18, 0x1F, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x9E, 0x1C, 0x35, 0x87, 0x92, 0x69, 0xC7 ),
+    BYTES_TO_T_UINT_8( 0xA1, 0xC9, 0x88, 0xAF, 0xC6, 0x6C, 0x83, 0x72 ),
+    BYTES_TO_T_UINT_8( 0xCB, 0xD5, 0x7A, 0x54, 0x34, 0x99, 0xB6, 0x6F ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0xDF, 0xAD, 0x45, 0x9B, 0x4B, 0x41, 0x4D, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x1B, 0x5D, 0xAB, 0x7F, 0x35, 0x34, 0xE9, 0x29 ),
+    BYTES_TO_T_UINT_8( 0x73, 0xBE, 0x78, 0x34, 0x44, 0xF3, 0x4A, 0x87 ),
+    BYTES_TO_T_UINT_8( 0xFB, 0xDE, 0xE3, 0xC4, 0xEE, 0x0B, 0xF9, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x86, 0x16, 0x48, 0x32, 0xB8, 0x74, 0x41 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0xEE, 0x7C, 0xBA, 0xBD, 0x81, 0xE3, 0x55 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF8, 0x6A, 0xFA, 0x84, 0xDA, 0xB8, 0xD5, 0x14 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0x9F, 0x8A, 0xD5, 0x1B, 0x2E, 0x1A, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x0C, 0x61, 0xE2, 0xFF, 0x5B, 0xE6, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0x62, 0xC1, 0x87, 0x53, 0x1B, 0x92, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x54, 0x90, 0x00, 0xD1, 0x6A, 0x0C, 0x0E, 0x28 ),
+    BYTES_TO_T_UINT_8( 0x8B, 0x2E, 0xB5, 0x3B, 0x44, 0xB5, 0xA0, 0x78 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0xB8, 0x5D, 0x02, 0x58, 0xB5, 0xBE, 0x45, 0x14 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0xEF, 0x8E, 0x90, 0x4D, 0x2A, 0x32, 0xAC ),
+    BYTES_TO_T_UINT_8( 0x48, 0x99, 0x75, 0x5C, 0x0A, 0x33, 0x8F, 0x36 ),
+    BYTES_TO_T_UINT_8( 0xC8, 0x6C, 0x95, 0xD4, 0x1F, 0xF3, 0xEB, 0xDA ),
+    BYTES_TO_T_UINT_8( 0xC2, 0xE4, 0x4C, 0x91, 0x20, 0xF3, 0x25, 0xEB ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x95, 0xEB, 0x29, 0x6F, 0x20, 0x34, 0x81 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0x2D, 0x15, 0xE5, 0x13, 0x7E, 0x64, 0x8B, 0xAD ),
+    BYTES_TO_T_UINT_8( 0xA7, 0xBC, 0x0D, 0x18, 0x7E, 0x37, 0x9E, 0xFA ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x82, 0x20, 0xF7, 0x2D, 0x7A, 0x77, 0x52 ),
+    BYTES_TO_T_UINT_8( 0xCB, 0x29, 0xA2, 0xDB, 0x7A, 0xE6, 0x6F, 0xA5 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xC6, 0x50, 0x5C, 0xBC, 0xE6, 0x4F, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x1E, 0x9F, 0xD5, 0xE8, 0xC5, 0x3D, 0xB7, 0x30 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x45, 0x03, 0x55, 0x10, 0xDB, 0xA6, 0x8B, 0x22 ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x17, 0xAE, 0x78, 0xC9, 0x1D, 0x43, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x35, 0x49, 0xD4, 0x47, 0x84, 0x8D, 0x20 ),
+    BYTES_TO_T_UINT_8( 0xF3, 0x95, 0x2F, 0xEA, 0xBC, 0xB4, 0x18, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0xD4, 0x48, 0xAE, 0x89, 0xF5, 0x65, 0x3D, 0x89 ),
+    BYTES_TO_T_UINT_8( 0x86, 0xF2, 0x2B, 0x20, 0xD1, 0x75, 0x50, 0x63 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0xAD, 0xE6, 0x5C, 0x2C, 0xE0, 0x7D, 0xDF, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x3E, 0x07, 0x3E, 0xCE, 0x9F, 0x18, 0xB6, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x9A, 0xF8, 0xF0, 0xD5, 0xFA, 0x42, 0x1D, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x41, 0x6C, 0x1D, 0x03, 0xC9, 0x0E, 0x2B, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x43, 0x18, 0x52, 0xA5, 0xB4, 0x63, 0xE1, 0x06 ),
+    BYTES_TO_T_UINT_8( 0xB7, 0x0A, 0xD9, 0xC4, 0xFD, 0x16, 0x60, 0x54 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x43, 0x7D, 0xDE, 0xDF, 0x4B, 0x4A, 0xB0, 0xCB ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x4E, 0x8C, 0x94, 0xC1, 0xE2, 0x85, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x4F, 0xF0, 0xEA, 0xB5, 0x9B, 0x70, 0xEF, 0x10 ),
+    BYTES_TO_T_UINT_8( 0x56, 0xC2, 0x39, 0x5D, 0xF3, 0x2C, 0xD9, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x0D, 0x1C, 0x2E, 0xCC, 0x2F, 0x54, 0x87, 0x80 ),
+    BYTES_TO_T_UINT_8( 0xB0, 0x72, 0xC7, 0xB5, 0x50, 0xA3, 0x84, 0x77 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB7, 0xD1, 0xAF, 0xA9, 0xB4, 0x8B, 0x5D, 0xFA ),
+    BYTES_TO_T_UINT_8( 0xC8, 0xF6, 0x52, 0x8A, 0xC3, 0x56, 0xA5, 0x5E ),
+    BYTES_TO_T_UINT_8( 0x3B, 0x52, 0xFF, 0xEA, 0x05, 0x42, 0x77, 0x83 ),
+    BYTES_TO_T_UINT_8( 0x29, 0x08, 0x90, 0x72, 0x86, 0xC4, 0xC3, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x4D, 0x15, 0xF8, 0xF1, 0x16, 0x67, 0xC6, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0x75, 0x87, 0xAC, 0x8F, 0x71, 0xEC, 0x83, 0x81 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x91, 0xE1, 0xE6, 0x2D, 0x0E, 0x11, 0xA1, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x74, 0xE2, 0xA8, 0x32, 0xE6, 0xE3, 0x83, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0x50, 0x56, 0xE5, 0xCD, 0xB7, 0x2B, 0x67, 0x6F ),
+    BYTES_TO_T_UINT_8( 0xE5, 0xED, 0xC9, 0x65, 0x6D, 0x87, 0xE1, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x50, 0x8E, 0xFD, 0x9A, 0x53, 0x0E, 0xFA, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x49, 0x4C, 0x4A, 0xE2, 0x23, 0x84, 0xFA, 0x01 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB4, 0xFE, 0x49, 0x81, 0xD1, 0x3E, 0xF4, 0x7C ),
+    BYTES_TO_T_UINT_8( 0x45, 0x72, 0xE0, 0xEF, 0x0D, 0xB8, 0x3E, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x3C, 0x00, 0x0F, 0x5F, 0xCE, 0x60, 0x72, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xB7, 0xCC, 0xD8, 0x03, 0x07, 0x6E, 0x5A, 0xCD ),
+    BYTES_TO_T_UINT_8( 0x27, 0x3A, 0x35, 0x50, 0x4E, 0x1F, 0xCA, 0x5F ),
+    BYTES_TO_T_UINT_8( 0x58, 0xEA, 0x88, 0x55, 0xBD, 0x6E, 0x05, 0x7F ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0xB1, 0x6D, 0xF1, 0x97, 0xA6, 0x69, 0x39, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x0B, 0x41, 0x99, 0xFF, 0x3B, 0xA1, 0x26, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x95, 0x2F, 0x95, 0x80, 0x12, 0x4A, 0x1B, 0xCB ),
+    BYTES_TO_T_UINT_8( 0xEA, 0xBF, 0x51, 0xAA, 0xAE, 0x2D, 0xDA, 0xCF ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x1C, 0xB3, 0x52, 0x36, 0x49, 0xD4, 0x86 ),
+    BYTES_TO_T_UINT_8( 0x99, 0xC1, 0x1F, 0x3A, 0xD3, 0x3E, 0x5C, 0x1A ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0x73, 0x51, 0xF7, 0x2B, 0xC8, 0xA9, 0xA7, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x12, 0x4E, 0x7F, 0x98, 0x41, 0x66, 0xB0, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x1D, 0xC0, 0x42, 0xCD, 0xF8, 0xC3, 0x2B ),
+    BYTES_TO_T_UINT_8( 0xCC, 0x41, 0x91, 0x7D, 0xCC, 0x8B, 0xCC, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0xAE, 0x76, 0xED, 0x56, 0x18, 0xC5, 0xAB ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x6A, 0x06, 0xA3, 0x7F, 0x65, 0x10, 0x1F ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0x0C, 0xEC, 0x3C, 0x05, 0x05, 0xCA, 0xF6, 0xED ),
+    BYTES_TO_T_UINT_8( 0x48, 0xCD, 0x02, 0x51, 0x12, 0x16, 0x3C, 0x63 ),
+    BYTES_TO_T_UINT_8( 0xA8, 0xEB, 0xB3, 0x43, 0x7B, 0xDD, 0xB2, 0x7C ),
+    BYTES_TO_T_UINT_8( 0x00, 0x59, 0x90, 0x41, 0xDB, 0xE4, 0xF5, 0x91 ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x0E, 0x18, 0x2A, 0x5A, 0x83, 0x7C, 0x2F ),
+    BYTES_TO_T_UINT_8( 0xE1, 0x37, 0xA1, 0x0D, 0xF1, 0x2F, 0x63, 0x79 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0x21, 0xC0, 0xFA, 0x6F, 0x1F, 0x67, 0xCF, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x98, 0x34, 0x45, 0xBB, 0xF4, 0xF9, 0x9B, 0x89 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0x69, 0xFE, 0x67, 0x1D, 0x64, 0x8F, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xDB, 0x39, 0xBF, 0xD8, 0xB3, 0xC7, 0xAD, 0x8A ),
+    BYTES_TO_T_UINT_8( 0x8C, 0x93, 0xFF, 0xF3, 0x28, 0xFA, 0x39, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0xF9, 0xC3, 0x85, 0x26, 0x7A, 0x88, 0x89 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0x4D, 0xD5, 0x79, 0xD8, 0x11, 0xDE, 0xEB, 0x4E ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x46, 0xA4, 0x6A, 0xDA, 0x74, 0x34, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0x1E, 0xBD, 0xD3, 0xF5, 0x14, 0xEE, 0xFE, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x19, 0x4C, 0xA3, 0x71, 0x43, 0x65, 0xF8, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x72, 0x6C, 0x35, 0xFA, 0x90, 0x25, 0xD8, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0xBB, 0x34, 0x84, 0x96, 0xA1, 0x43, 0x03, 0x4D ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF1, 0x3B, 0x3B, 0x2F, 0xCA, 0x59, 0xF2, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xCD, 0x48, 0x24, 0x74, 0xD8, 0x72, 0x90, 0xA3 ),
+    BYTES_TO_T_UINT_8( 0x83, 0x42, 0x74, 0x8C, 0x6F, 0x52, 0x19, 0x3D ),
+    BYTES_TO_T_UINT_8( 0x40, 0x9E, 0x41, 0x63, 0x68, 0x78, 0x4C, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x53, 0x94, 0xB6, 0x6B, 0x38, 0x52, 0xA8, 0x9F ),
+    BYTES_TO_T_UINT_8( 0x81, 0x30, 0x25, 0x93, 0xA1, 0x6F, 0x6E, 0x68 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0xFC, 0x2F, 0x4B, 0x64, 0x79, 0x50, 0xFF, 0x01 ),
+    BYTES_TO_T_UINT_8( 0xD4, 0x36, 0xED, 0x57, 0x39, 0x3B, 0xE7, 0xF3 ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x85, 0xEA, 0x35, 0xD6, 0xC0, 0xA0, 0x52 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x89, 0x3A, 0xCC, 0x22, 0x1C, 0x46, 0x02 ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x7A, 0xB0, 0xA1, 0x1B, 0x69, 0x62, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x57, 0xB8, 0x8A, 0x6C, 0x18, 0x85, 0x0D, 0x88 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0xFD, 0xB6, 0x50, 0xE9, 0x4E, 0x7F, 0xE8, 0x07 ),
+    BYTES_TO_T_UINT_8( 0x92, 0x5B, 0x5C, 0xD1, 0x4B, 0x11, 0x9A, 0xD8 ),
+    BYTES_TO_T_UINT_8( 0x96, 0x25, 0x56, 0x74, 0x51, 0x9C, 0xEC, 0x9C ),
+    BYTES_TO_T_UINT_8( 0x55, 0x7F, 0xB6, 0x8A, 0xCB, 0x3A, 0x10, 0x6A ),
+    BYTES_TO_T_UINT_8( 0x60, 0x33, 0x07, 0x01, 0xE9, 0x49, 0x59, 0xE6 ),
+    BYTES_TO_T_UINT_8( 0xC6, 0xA5, 0x2E, 0xF2, 0xBA, 0x32, 0x63, 0x44 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0xF8, 0x06, 0x0B, 0xA5, 0x44, 0x27, 0x7F, 0x22 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x74, 0xAC, 0x0F, 0xCC, 0x4F, 0x13, 0x61 ),
+    BYTES_TO_T_UINT_8( 0xFD, 0xB1, 0xBF, 0x97, 0x49, 0xA5, 0x1C, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x64, 0x68, 0x7B, 0x0F, 0xCC, 0x77, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0xBB, 0x39, 0xF9, 0x4E, 0x84, 0x9C, 0xF6, 0x96 ),
+    BYTES_TO_T_UINT_8( 0xBC, 0xCF, 0x6D, 0xE2, 0xA1, 0x2D, 0xF9, 0x2B ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x95, 0xC4, 0x90, 0x57, 0x31, 0x01, 0x05, 0x5E ),
+    BYTES_TO_T_UINT_8( 0xCC, 0x1E, 0xBB, 0xBF, 0x98, 0xA4, 0x7C, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0x89, 0xE3, 0xA0, 0xB2, 0xCD, 0x39, 0x9A, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x92, 0x34, 0x60, 0x7A, 0x89, 0x98, 0xB5, 0x52 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0x20, 0x3D, 0x3A, 0x04, 0x8F, 0x5A, 0xAC ),
+    BYTES_TO_T_UINT_8( 0xA3, 0x26, 0xB6, 0x49, 0x09, 0x9C, 0x0F, 0x59 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0x72, 0x66, 0xD2, 0x38, 0x2A, 0x62, 0x81, 0xCA ),
+    BYTES_TO_T_UINT_8( 0xC5, 0xC8, 0x20, 0x5E, 0x28, 0xA3, 0x81, 0xA7 ),
+    BYTES_TO_T_UINT_8( 0x20, 0x31, 0xA4, 0xF1, 0xEA, 0x7D, 0x87, 0x45 ),
+    BYTES_TO_T_UINT_8( 0x8F, 0x2C, 0x99, 0x09, 0x6F, 0x63, 0xEB, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x73, 0x76, 0xDA, 0x1A, 0x06, 0xBE, 0xDE, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0x29, 0x09, 0x2E, 0x75, 0x39, 0x30, 0x2D, 0x42 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x41, 0x9B, 0xC1, 0x5A, 0x17, 0xC3, 0x8C, 0x31 ),
+    BYTES_TO_T_UINT_8( 0x58, 0x8D, 0x94, 0x4D, 0x3D, 0xAB, 0x60, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0xFD, 0x1E, 0x0F, 0x43, 0xAE, 0x9D, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x8E, 0xF2, 0xF3, 0x20, 0x1B, 0xAA, 0xB7, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x9D, 0x5B, 0xA4, 0xF4, 0x90, 0x3B, 0xE3, 0x71 ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x78, 0x72, 0xBD, 0x65, 0x09, 0x0B, 0x01 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0xCA, 0x37, 0x2A, 0x6C, 0x16, 0x4F, 0x64, 0x59 ),
+    BYTES_TO_T_UINT_8( 0x5A, 0xCE, 0xA3, 0x90, 0xB4, 0x9A, 0xBC, 0xF7 ),
+    BYTES_TO_T_UINT_8( 0x27, 0x38, 0x55, 0x63, 0x1D, 0x3A, 0x6E, 0x18 ),
+    BYTES_TO_T_UINT_8( 0x37, 0xB4, 0xAA, 0x99, 0x22, 0x45, 0x89, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xB7, 0x7C, 0x8C, 0xA6, 0x3D, 0xA7, 0x3E, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0x70, 0x06, 0x42, 0xDC, 0xA6, 0xE3, 0xC6, 0x12 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0x55, 0x8C, 0x3D, 0x5D, 0x47, 0x31, 0x7C, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x46, 0x85, 0xEE, 0x46, 0x7E, 0x13, 0x04, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x3C, 0x8B, 0x43, 0x2E, 0x74, 0xF5, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x88, 0x8E, 0x07, 0x29, 0x08, 0x03, 0x26 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0x9B, 0x89, 0xEB, 0x08, 0xE8, 0x43, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x17, 0x07, 0x67, 0xFD, 0xD9, 0x73, 0x6F, 0x18 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0x29, 0xEB, 0x21, 0x8D, 0x98, 0x43, 0x74, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x88, 0xCC, 0x14, 0xD8, 0x08, 0xBB, 0xA6, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x98, 0xF2, 0x6A, 0x18, 0xC3, 0xDD, 0x9E ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x38, 0x91, 0xA0, 0x03, 0xF2, 0x04, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x7A, 0xAF, 0xE8, 0xFD, 0xFB, 0x13, 0x70, 0x74 ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x93, 0x87, 0x98, 0x4A, 0xE0, 0x00, 0x12 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0x97, 0x2E, 0x69, 0x9C, 0xA2, 0x2D, 0x03, 0x3F ),
+    BYTES_TO_T_UINT_8( 0x79, 0xFE, 0xF3, 0xB9, 0xC1, 0x85, 0x2A, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xCE, 0xFD, 0x86, 0xB1, 0xCD, 0xBF, 0x41, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xD8, 0x9A, 0x21, 0xF3, 0xFE, 0xCB, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0x95, 0x78, 0x04, 0x60, 0xB7, 0xA9, 0xA2, 0x84 ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x1E, 0x66, 0x2A, 0x54, 0x51, 0xBD, 0x8B ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0x8E, 0x16, 0x36, 0xEF, 0x61, 0x2D, 0xEE, 0x3B ),
+    BYTES_TO_T_UINT_8( 0x45, 0x5F, 0x88, 0xA0, 0x13, 0x12, 0xF7, 0x23 ),
+    BYTES_TO_T_UINT_8( 0xA9, 0xC6, 0xAD, 0x4A, 0x4A, 0x07, 0x01, 0x5B ),
+    BYTES_TO_T_UINT_8( 0xB8, 0x74, 0xB1, 0x4F, 0xEB, 0xBD, 0xD5, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x57, 0xF9, 0x71, 0xA2, 0x06, 0x4F, 0xD7, 0xBC ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x8B, 0x4D, 0x48, 0xE0, 0x98, 0xFB, 0x6A ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC4, 0xBA, 0x10, 0xA3, 0x0D, 0x52, 0xAC, 0x3A ),
+    BYTES_TO_T_UINT_8( 0x11, 0xD0, 0xE0, 0x36, 0xE6, 0x07, 0x3A, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x7E, 0x80, 0xF0, 0xAA, 0x49, 0x22, 0x4B, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xFF, 0xC7, 0xAB, 0x1C, 0x89, 0xCD, 0x24, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x82, 0x2A, 0xFC, 0xB3, 0x6D, 0x45, 0x96, 0x49 ),
+    BYTES_TO_T_UINT_8( 0x63, 0xE4, 0xDB, 0x52, 0x3F, 0xC4, 0xB4, 0x19 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x5B, 0xCC, 0xC8, 0x7F, 0xBB, 0x6B, 0x87, 0x47 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0x21, 0x3C, 0x69, 0x7D, 0x38, 0x57, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x52, 0x4C, 0x18, 0x3C, 0x53, 0xA5, 0x48, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x21, 0xC3, 0x64, 0x45, 0xDB, 0xC4, 0x6D, 0x15 ),
+    BYTES_TO_T_UINT_8( 0x49, 0xCC, 0xD1, 0xBB, 0x17, 0xB8, 0x34, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x69, 0x71, 0xFA, 0xA0, 0x28, 0x4A, 0x3D ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0xED, 0xE8, 0x9E, 0x39, 0xEA, 0x8D, 0x38, 0xDB ),
+    BYTES_TO_T_UINT_8( 0xCC, 0x9C, 0xBB, 0xCD, 0x80, 0x1A, 0xEE, 0xB7 ),
+    BYTES_TO_T_UINT_8( 0xBC, 0xA0, 0x45, 0xBF, 0xD9, 0x22, 0x11, 0x32 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0x7C, 0x5C, 0xD9, 0xC0, 0x9F, 0x69, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0xBC, 0x8A, 0xA6, 0x79, 0x4E, 0x35, 0xB9, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0xCC, 0x8B, 0x9A, 0x3E, 0xA1, 0xB8, 0x28, 0x10 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0x55, 0x2F, 0xEF, 0xBB, 0xA9, 0x72, 0x7F, 0xEA ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x34, 0xB7, 0x12, 0xB9, 0xE7, 0xC3, 0x2A ),
+    BYTES_TO_T_UINT_8( 0xF8, 0x1D, 0xD9, 0x42, 0x77, 0x0C, 0x71, 0x6E ),
+    BYTES_TO_T_UINT_8( 0xEC, 0x01, 0x59, 0xA7, 0x56, 0x03, 0x91, 0x8D ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x91, 0x99, 0x33, 0x30, 0x3E, 0xEF, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x87, 0xC9, 0x5A, 0x9A, 0x54, 0x66, 0xF1, 0x70 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0x64, 0x2C, 0xB7, 0x6E, 0x71, 0x7D, 0x35, 0x30 ),
+    BYTES_TO_T_UINT_8( 0x1A, 0x0D, 0xEF, 0xD1, 0x2D, 0x99, 0x63, 0x2F ),
+    BYTES_TO_T_UINT_8( 0xE4, 0x31, 0xAF, 0x2D, 0xC9, 0xC6, 0xC2, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x19, 0xC0, 0xDF, 0x80, 0x54, 0xC4, 0xAC, 0xF3 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0x6B, 0xA0, 0x84, 0x96, 0xF7, 0x31, 0xC8 ),
+    BYTES_TO_T_UINT_8( 0x93, 0xE2, 0x7C, 0x7A, 0x41, 0x45, 0x75, 0x6A ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0xAE, 0xEE, 0x58, 0x31, 0xE8, 0x68, 0xD6, 0x76 ),
+    BYTES_TO_T_UINT_8( 0xD2, 0x2E, 0x48, 0xB7, 0x09, 0x9F, 0xD4, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x34, 0xA9, 0x5C, 0xE7, 0x64, 0x43, 0x5D, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x9E, 0x58, 0x9F, 0x50, 0xAB, 0x68, 0xFF, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x87, 0x88, 0x2D, 0xBA, 0x12, 0xBF, 0x8D, 0x7D ),
+    BYTES_TO_T_UINT_8( 0xD4, 0xDF, 0x6F, 0xB3, 0x75, 0xA4, 0x55, 0x73 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0x6D, 0x17, 0x92, 0x39, 0xB7, 0x13, 0x37, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x43, 0x71, 0xA7, 0xCA, 0x17, 0x1B, 0x32 ),
+    BYTES_TO_T_UINT_8( 0xE7, 0xB9, 0xB0, 0x78, 0xEF, 0xA0, 0xDA, 0x83 ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x84, 0xF2, 0x0F, 0x85, 0xA2, 0xB6, 0x1F ),
+    BYTES_TO_T_UINT_8( 0x72, 0x65, 0x2E, 0x6E, 0x45, 0xB9, 0x4C, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x6A, 0x8C, 0x2B, 0x77, 0x96, 0x36, 0x22 ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0x68, 0x7A, 0x13, 0x4A, 0x97, 0x63, 0x02, 0x10 ),
+    BYTES_TO_T_UINT_8( 0xBC, 0x1E, 0x06, 0x03, 0x8F, 0xB9, 0xEE, 0x64 ),
+    BYTES_TO_T_UINT_8( 0x68, 0xEE, 0x8B, 0x89, 0xA9, 0x70, 0xDB, 0xCE ),
+    BYTES_TO_T_UINT_8( 0x15, 0x7B, 0x81, 0xC9, 0x70, 0x8D, 0x62, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x75, 0xDA, 0x46, 0xF8, 0xF9, 0x3A, 0xBE, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x9F, 0x9C, 0x7A, 0x97, 0x62, 0xEB, 0xFA, 0x0F ),
+};
+static const mbedtls_mpi_uint brainpoolP384r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB2, 0x03, 0x3D, 0x3C, 0x46, 0x27, 0x9E, 0x65 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x08, 0x1C, 0xD5, 0x25, 0xAF, 0xE9, 0x40 ),
+    BYTES_TO_T_UINT_8( 0xFE, 0x69, 0xDC, 0x59, 0xF4, 0x8A, 0x7C, 0x1F ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x9A, 0x7A, 0x99, 0x21, 0x0C, 0x4E, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xCE, 0x85, 0x5F, 0xAC, 0xAA, 0x82, 0x10 ),
+    BYTES_TO_T_UINT_8( 0x83, 0x57, 0x69, 0x90, 0x76, 0xF3, 0x53, 0x3F ),
+};
+static const mbedtls_ecp_point brainpoolP384r1_T[32] = {
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_0_X, brainpoolP384r1_T_0_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_1_X, brainpoolP384r1_T_1_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_2_X, brainpoolP384r1_T_2_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_3_X, brainpoolP384r1_T_3_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_4_X, brainpoolP384r1_T_4_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_5_X, brainpoolP384r1_T_5_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_6_X, brainpoolP384r1_T_6_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_7_X, brainpoolP384r1_T_7_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_8_X, brainpoolP384r1_T_8_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_9_X, brainpoolP384r1_T_9_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_10_X, brainpoolP384r1_T_10_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_11_X, brainpoolP384r1_T_11_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_12_X, brainpoolP384r1_T_12_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_13_X, brainpoolP384r1_T_13_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_14_X, brainpoolP384r1_T_14_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_15_X, brainpoolP384r1_T_15_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_16_X, brainpoolP384r1_T_16_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_17_X, brainpoolP384r1_T_17_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_18_X, brainpoolP384r1_T_18_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_19_X, brainpoolP384r1_T_19_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_20_X, brainpoolP384r1_T_20_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_21_X, brainpoolP384r1_T_21_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_22_X, brainpoolP384r1_T_22_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_23_X, brainpoolP384r1_T_23_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_24_X, brainpoolP384r1_T_24_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_25_X, brainpoolP384r1_T_25_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_26_X, brainpoolP384r1_T_26_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_27_X, brainpoolP384r1_T_27_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_28_X, brainpoolP384r1_T_28_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_29_X, brainpoolP384r1_T_29_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_30_X, brainpoolP384r1_T_30_Y ),
+    ECP_POINT_INIT_XY( brainpoolP384r1_T_31_X, brainpoolP384r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_BP384R1_ENABLED */
+
+#if defined(MBEDTLS_ECP_DP_BP512R1_ENABLED)
+static const mbedtls_mpi_uint brainpoolP512r1_T_0_X[] = {
+    BYTES_TO_T_UINT_8( 0x22, 0xF8, 0xB9, 0xBC, 0x09, 0x22, 0x35, 0x8B ),
+    BYTES_TO_T_UINT_8( 0x68, 0x5E, 0x6A, 0x40, 0x47, 0x50, 0x6D, 0x7C ),
+    BYTES_TO_T_UINT_8( 0x5F, 0x7D, 0xB9, 0x93, 0x7B, 0x68, 0xD1, 0x50 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xD4, 0xD0, 0xE2, 0x78, 0x1F, 0x3B, 0xFF ),
+    BYTES_TO_T_UINT_8( 0x8E, 0x09, 0xD0, 0xF4, 0xEE, 0x62, 0x3B, 0xB4 ),
+    BYTES_TO_T_UINT_8( 0xC1, 0x16, 0xD9, 0xB5, 0x70, 0x9F, 0xED, 0x85 ),
+    BYTES_TO_T_UINT_8( 0x93, 0x6A, 0x4C, 0x9C, 0x2E, 0x32, 0x21, 0x5A ),
+    BYTES_TO_T_UINT_8( 0x64, 0xD9, 0x2E, 0xD8, 0xBD, 0xE4, 0xAE, 0x81 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_0_Y[] = {
+    BYTES_TO_T_UINT_8( 0x92, 0x08, 0xD8, 0x3A, 0x0F, 0x1E, 0xCD, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x06, 0x54, 0xF0, 0xA8, 0x2F, 0x2B, 0xCA, 0xD1 ),
+    BYTES_TO_T_UINT_8( 0xAE, 0x63, 0x27, 0x8A, 0xD8, 0x4B, 0xCA, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x48, 0x5F, 0x4A, 0x49, 0xDE, 0xDC, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0x11, 0x81, 0x1F, 0x88, 0x5B, 0xC5, 0x00, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0x1A, 0x7B, 0xA5, 0x24, 0x00, 0xF7, 0x09, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0xFD, 0x22, 0x78, 0xCF, 0xA9, 0xBF, 0xEA, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0xEC, 0x32, 0x63, 0x56, 0x5D, 0x38, 0xDE, 0x7D ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_1_X[] = {
+    BYTES_TO_T_UINT_8( 0xEA, 0xE9, 0x6B, 0x8C, 0x6F, 0x9D, 0x88, 0x43 ),
+    BYTES_TO_T_UINT_8( 0xBB, 0x4F, 0x86, 0x96, 0xA7, 0x56, 0xD1, 0x37 ),
+    BYTES_TO_T_UINT_8( 0x9D, 0xAB, 0xFA, 0xEE, 0xA7, 0xF5, 0x0E, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0x40, 0xEF, 0x9E, 0x6D, 0xD6, 0x32, 0x33 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0xED, 0x56, 0x14, 0x57, 0x1A, 0x8D, 0x69 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0xED, 0x4D, 0x3A, 0xFA, 0x71, 0x75, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x66, 0xC5, 0x76, 0x1C, 0x14, 0xBE, 0xB5, 0xCD ),
+    BYTES_TO_T_UINT_8( 0xE1, 0x5A, 0xCB, 0xE7, 0x36, 0x1D, 0x52, 0x1C ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_1_Y[] = {
+    BYTES_TO_T_UINT_8( 0x6B, 0x8D, 0x7A, 0xEB, 0xA3, 0x8B, 0xD5, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0x1F, 0xA3, 0x41, 0xF8, 0xAC, 0x9E, 0xAB, 0x74 ),
+    BYTES_TO_T_UINT_8( 0x12, 0xE3, 0x65, 0x0D, 0x1C, 0xFE, 0x09, 0x2B ),
+    BYTES_TO_T_UINT_8( 0x3F, 0xCA, 0x13, 0x3F, 0xC5, 0xF9, 0x7E, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x2C, 0x5D, 0x63, 0x28, 0xA6, 0x89, 0xD3, 0x91 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x95, 0x3F, 0x7A, 0x82, 0xD4, 0x77, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0x34, 0xBB, 0x92, 0x32, 0x00, 0xF4, 0x66, 0x42 ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x58, 0x31, 0xD1, 0x17, 0x9F, 0x2A, 0x22 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_2_X[] = {
+    BYTES_TO_T_UINT_8( 0x52, 0x36, 0xA9, 0xCD, 0x80, 0xA5, 0x2D, 0x78 ),
+    BYTES_TO_T_UINT_8( 0x91, 0x44, 0xAB, 0xCE, 0x71, 0xFF, 0x0C, 0x9B ),
+    BYTES_TO_T_UINT_8( 0x18, 0x24, 0x58, 0x35, 0x5A, 0x21, 0x32, 0x93 ),
+    BYTES_TO_T_UINT_8( 0x1B, 0xA6, 0x28, 0xF8, 0x7A, 0x97, 0xAE, 0x8B ),
+    BYTES_TO_T_UINT_8( 0x84, 0xE7, 0x08, 0xFA, 0x47, 0xC9, 0x55, 0x09 ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xAC, 0x2E, 0x84, 0xA4, 0xF5, 0x52, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x58, 0x05, 0x9D, 0xA7, 0xC8, 0x71, 0xBF ),
+    BYTES_TO_T_UINT_8( 0xB3, 0x92, 0xB4, 0x92, 0xC1, 0x92, 0xEC, 0x6B ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_2_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4A, 0x48, 0x2D, 0x79, 0x5E, 0x58, 0xE5, 0x69 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x85, 0x26, 0xEC, 0xE9, 0x6E, 0xD4, 0x06 ),
+    BYTES_TO_T_UINT_8( 0x98, 0x68, 0x26, 0x87, 0x38, 0xA2, 0xD2, 0x0B ),
+    BYTES_TO_T_UINT_8( 0xF7, 0x17, 0x60, 0xCE, 0x75, 0xF8, 0xA5, 0x6F ),
+    BYTES_TO_T_UINT_8( 0x20, 0x51, 0xDB, 0xA9, 0xAE, 0x87, 0xF1, 0x15 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x49, 0x92, 0x3B, 0x19, 0x96, 0xF5, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0xC4, 0xD5, 0x52, 0x52, 0x8C, 0xCE, 0xFD, 0xFA ),
+    BYTES_TO_T_UINT_8( 0x24, 0x18, 0x0A, 0xE6, 0xF6, 0xAE, 0x08, 0x41 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_3_X[] = {
+    BYTES_TO_T_UINT_8( 0x7E, 0x2B, 0xD8, 0x54, 0xCE, 0xB0, 0x57, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x8A, 0xB0, 0xF8, 0x9E, 0x03, 0x03, 0x3C, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x93, 0x0E, 0x29, 0x29, 0x00, 0xF3, 0x70, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x54, 0x33, 0x99, 0x0E, 0x00, 0x5D, 0xFE, 0x4B ),
+    BYTES_TO_T_UINT_8( 0x46, 0x2D, 0xF2, 0x59, 0x32, 0xCF, 0x03, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x3B, 0xC9, 0x72, 0xAE, 0x0C, 0xEF, 0xD1, 0x5B ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x5A, 0x27, 0xBF, 0x2F, 0x45, 0xF9, 0x51 ),
+    BYTES_TO_T_UINT_8( 0xD4, 0xBE, 0xE5, 0x2C, 0xFF, 0x5B, 0x1E, 0x88 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_3_Y[] = {
+    BYTES_TO_T_UINT_8( 0xAA, 0xAC, 0xBB, 0xD8, 0x83, 0xC2, 0x46, 0xF6 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0xDC, 0xCE, 0x15, 0xB4, 0xEF, 0xCF, 0x46 ),
+    BYTES_TO_T_UINT_8( 0x46, 0xDB, 0x5E, 0x94, 0x31, 0x0B, 0xB2, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x3C, 0xB9, 0xE3, 0xE3, 0x11, 0x71, 0x41, 0x1E ),
+    BYTES_TO_T_UINT_8( 0x36, 0xE3, 0x01, 0xB7, 0x7D, 0xBC, 0x65, 0xBE ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x07, 0x65, 0x87, 0xA7, 0xE8, 0x48, 0xE3 ),
+    BYTES_TO_T_UINT_8( 0x66, 0x48, 0x8F, 0xD4, 0x30, 0x8E, 0xB4, 0x6C ),
+    BYTES_TO_T_UINT_8( 0x86, 0xE0, 0x73, 0xBE, 0x1E, 0xBF, 0x56, 0x36 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_4_X[] = {
+    BYTES_TO_T_UINT_8( 0xFE, 0x0E, 0x5E, 0x87, 0xC5, 0xAB, 0x0E, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xB9, 0xF9, 0x5F, 0x80, 0x24, 0x4C, 0x2A, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0xDE, 0x15, 0x21, 0x54, 0x92, 0x84, 0x8D, 0x6A ),
+    BYTES_TO_T_UINT_8( 0xA8, 0x8A, 0x47, 0x74, 0xDC, 0x42, 0xB1, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0x81, 0xF7, 0x30, 0xFD, 0xC1, 0x9B, 0x0C, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x6C, 0xCC, 0xDF, 0xC5, 0xE3, 0xA9, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x67, 0x59, 0x10, 0x5C, 0x51, 0x54, 0x40 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x37, 0xFB, 0x6E, 0xB0, 0x78, 0x63, 0x8E ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_4_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA5, 0xEF, 0xC4, 0x39, 0x20, 0xF1, 0x46, 0x66 ),
+    BYTES_TO_T_UINT_8( 0xE2, 0x62, 0xAE, 0xFF, 0x10, 0xE4, 0xE2, 0xE9 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x5C, 0xF5, 0x2E, 0x22, 0x89, 0xE5, 0x82 ),
+    BYTES_TO_T_UINT_8( 0x89, 0x0C, 0x29, 0xA8, 0x62, 0xAE, 0xDB, 0x65 ),
+    BYTES_TO_T_UINT_8( 0xD7, 0x9E, 0x0F, 0xCA, 0x87, 0x2A, 0x6F, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xCE, 0xDC, 0x9B, 0x9F, 0x65, 0xD4, 0xAD, 0x27 ),
+    BYTES_TO_T_UINT_8( 0xED, 0xC3, 0x08, 0x0F, 0xCF, 0x67, 0xE9, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0x92, 0x5C, 0xD7, 0xFF, 0x41, 0x9C, 0xCB, 0x26 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_5_X[] = {
+    BYTES_TO_T_UINT_8( 0x37, 0x25, 0x05, 0x12, 0xAD, 0x73, 0x63, 0x90 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x99, 0x07, 0x86, 0x57, 0xE7, 0x94, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0x00, 0x4B, 0xA5, 0xBF, 0x18, 0xA9, 0xEF, 0x6A ),
+    BYTES_TO_T_UINT_8( 0xFA, 0x4C, 0xC4, 0x09, 0xF2, 0x2F, 0x0C, 0xAA ),
+    BYTES_TO_T_UINT_8( 0x8C, 0x3A, 0x04, 0xEA, 0x89, 0x6C, 0x91, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0x7D, 0x6C, 0x3A, 0xE7, 0xA3, 0xEC, 0x24, 0x7B ),
+    BYTES_TO_T_UINT_8( 0x16, 0xA1, 0x26, 0x21, 0x04, 0xE3, 0xB9, 0x40 ),
+    BYTES_TO_T_UINT_8( 0x53, 0x71, 0x4B, 0x7B, 0xC2, 0x89, 0xCD, 0xA2 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_5_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB7, 0xB9, 0xA8, 0x9D, 0xFD, 0x00, 0x3A, 0x1F ),
+    BYTES_TO_T_UINT_8( 0x63, 0x41, 0x6C, 0xBB, 0x5A, 0xCA, 0x1F, 0x74 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0xD7, 0xE2, 0x6C, 0x6B, 0xA7, 0x48, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x1E, 0x19, 0xAD, 0xA7, 0xC1, 0x7E, 0x4F, 0x6E ),
+    BYTES_TO_T_UINT_8( 0xD1, 0xF7, 0x19, 0x3C, 0x06, 0x74, 0x2C, 0x3A ),
+    BYTES_TO_T_UINT_8( 0xC5, 0x23, 0x4F, 0x0C, 0x09, 0xB0, 0x80, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x4E, 0x74, 0x34, 0x08, 0x44, 0x7E, 0xA3, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xFB, 0xCC, 0x8D, 0x12, 0x6E, 0xE1, 0x3D, 0x0B ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_6_X[] = {
+    BYTES_TO_T_UINT_8( 0x38, 0x18, 0xB1, 0x71, 0x02, 0x93, 0xC2, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x89, 0x40, 0xE2, 0x1F, 0xE7, 0x5E, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x50, 0x8E, 0xAE, 0x89, 0x01, 0xD4, 0x0C, 0xEB ),
+    BYTES_TO_T_UINT_8( 0xAE, 0xDA, 0x58, 0x70, 0x24, 0xF2, 0xE4, 0x5F ),
+    BYTES_TO_T_UINT_8( 0x6F, 0xC7, 0x1D, 0xD6, 0x4A, 0x6F, 0x66, 0x4F ),
+    BYTES_TO_T_UINT_8( 0x92, 0x1D, 0x7E, 0x4A, 0x2C, 0xCA, 0xEC, 0x3B ),
+    BYTES_TO_T_UINT_8( 0xA1, 0x06, 0x7F, 0xA8, 0x99, 0xE4, 0xD3, 0x4E ),
+    BYTES_TO_T_UINT_8( 0x2A, 0x1D, 0x5A, 0xDF, 0x5E, 0x58, 0x36, 0x49 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_6_Y[] = {
+    BYTES_TO_T_UINT_8( 0x9C, 0xB9, 0x32, 0x69, 0x1F, 0x72, 0x2A, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0x73, 0xE2, 0x03, 0x39, 0x35, 0xAA, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0xEB, 0x5E, 0x5D, 0x48, 0xEF, 0xAE, 0x30, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x77, 0x7F, 0x60, 0x19, 0xAF, 0xEC, 0x9D, 0xFC ),
+    BYTES_TO_T_UINT_8( 0xCA, 0xD9, 0x19, 0xE4, 0x1B, 0x56, 0x15, 0x5F ),
+    BYTES_TO_T_UINT_8( 0xBC, 0xD7, 0x33, 0x59, 0x1F, 0x43, 0x59, 0x2C ),
+    BYTES_TO_T_UINT_8( 0xC6, 0xCE, 0xEE, 0xCA, 0xA4, 0x7F, 0x63, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0xBD, 0x40, 0xC0, 0xF6, 0x19, 0x89, 0x43, 0x20 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_7_X[] = {
+    BYTES_TO_T_UINT_8( 0xEB, 0x92, 0xEA, 0x07, 0x65, 0x79, 0x86, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0xFF, 0xB7, 0x13, 0x75, 0xD3, 0xC5, 0x0A, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x26, 0x9E, 0xFA, 0xE1, 0x1F, 0x0C, 0xF9, 0x74 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x8C, 0xED, 0x5C, 0x21, 0xE9, 0x09, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xF4, 0x4D, 0xD8, 0x18, 0xC4, 0xF6, 0x36, 0x39 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0xC9, 0xAC, 0x5C, 0xFA, 0x69, 0xA4, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0x6B, 0x8C, 0x94, 0x1C, 0x7B, 0x71, 0x36, 0x58 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0xBD, 0x46, 0xCE, 0xB7, 0x1D, 0x9C, 0x5E ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_7_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEA, 0xD6, 0x96, 0x4B, 0xA6, 0x47, 0xEB, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0x5F, 0xF1, 0x5F, 0x15, 0xDE, 0x99, 0x6F, 0x66 ),
+    BYTES_TO_T_UINT_8( 0x21, 0xBD, 0xE5, 0x04, 0xB8, 0xE6, 0xC0, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x49, 0xD3, 0xF0, 0x04, 0x00, 0xE4, 0x05, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x96, 0xF3, 0x06, 0xA3, 0x1A, 0xFF, 0xEA, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x08, 0x32, 0xAA, 0x99, 0x33, 0x09, 0xB6, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x6E, 0xEF, 0xFC, 0x61, 0x10, 0x42, 0x31, 0x94 ),
+    BYTES_TO_T_UINT_8( 0x34, 0xF1, 0xF4, 0x33, 0xCF, 0x28, 0x90, 0x9C ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_8_X[] = {
+    BYTES_TO_T_UINT_8( 0x10, 0xDE, 0xF9, 0x88, 0x87, 0x7B, 0xEB, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0x66, 0xB8, 0xDA, 0xFA, 0xDA, 0x3D, 0xA6, 0x17 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xF0, 0x62, 0x82, 0x53, 0x32, 0x55, 0x03 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0xA5, 0x32, 0x4A, 0x19, 0x11, 0x9C, 0x10 ),
+    BYTES_TO_T_UINT_8( 0x16, 0xB3, 0x27, 0xE9, 0x75, 0x90, 0x05, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x63, 0x1C, 0x90, 0x48, 0x77, 0x01, 0x85, 0x1B ),
+    BYTES_TO_T_UINT_8( 0xC7, 0xD6, 0x9B, 0x84, 0xA8, 0xD7, 0xC5, 0x28 ),
+    BYTES_TO_T_UINT_8( 0xE1, 0x7A, 0xCB, 0xB3, 0x11, 0x46, 0xD7, 0x99 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_8_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8B, 0x23, 0xBF, 0x75, 0x75, 0xA1, 0x95, 0x90 ),
+    BYTES_TO_T_UINT_8( 0x4B, 0x66, 0x5D, 0x34, 0x13, 0xA9, 0x03, 0xBE ),
+    BYTES_TO_T_UINT_8( 0x29, 0x80, 0x9D, 0x5F, 0xD2, 0x44, 0xE1, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x96, 0x5D, 0xBD, 0xA8, 0xBF, 0xB4, 0x25, 0x1F ),
+    BYTES_TO_T_UINT_8( 0x6A, 0x99, 0x1F, 0x53, 0xF1, 0x57, 0xDB, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x21, 0x7C, 0xE5, 0xC5, 0x51, 0x0B, 0x4C, 0x9B ),
+    BYTES_TO_T_UINT_8( 0x6B, 0xB0, 0x1A, 0x9C, 0x16, 0xB0, 0x32, 0x1F ),
+    BYTES_TO_T_UINT_8( 0xF4, 0xE3, 0xCF, 0xDD, 0x48, 0xB4, 0x7B, 0x33 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_9_X[] = {
+    BYTES_TO_T_UINT_8( 0xC0, 0xDD, 0x9E, 0x3C, 0x98, 0x0E, 0x77, 0x65 ),
+    BYTES_TO_T_UINT_8( 0x6C, 0xAB, 0x01, 0xD3, 0x87, 0x74, 0x25, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x87, 0xA3, 0xE3, 0x76, 0x43, 0x87, 0x12, 0xBD ),
+    BYTES_TO_T_UINT_8( 0x54, 0xB1, 0x3B, 0x60, 0x66, 0xEB, 0x98, 0x54 ),
+    BYTES_TO_T_UINT_8( 0xD2, 0x78, 0xC8, 0xD7, 0x4E, 0x75, 0xCA, 0x69 ),
+    BYTES_TO_T_UINT_8( 0x07, 0xDF, 0x71, 0x19, 0xE7, 0x07, 0x36, 0xB5 ),
+    BYTES_TO_T_UINT_8( 0x6D, 0xC9, 0xA8, 0x5F, 0x91, 0xBF, 0x47, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0x80, 0x96, 0x58, 0x96, 0x18, 0xB6, 0xFA, 0x01 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_9_Y[] = {
+    BYTES_TO_T_UINT_8( 0xD0, 0x2D, 0xA9, 0x9B, 0x86, 0xDB, 0x0C, 0x4C ),
+    BYTES_TO_T_UINT_8( 0xE4, 0x0B, 0x2D, 0x56, 0x4A, 0xD3, 0x93, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x15, 0xE2, 0x65, 0x12, 0x86, 0x0E, 0xB2 ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x41, 0x4D, 0xC1, 0xCB, 0xE4, 0xC3, 0xD7 ),
+    BYTES_TO_T_UINT_8( 0x6A, 0x53, 0x10, 0xCA, 0xA3, 0xAC, 0x83, 0x26 ),
+    BYTES_TO_T_UINT_8( 0x3E, 0x01, 0x22, 0x96, 0x10, 0xAD, 0x69, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x42, 0x46, 0x4E, 0xD8, 0xEA, 0xD6, 0x9D, 0xF3 ),
+    BYTES_TO_T_UINT_8( 0x43, 0x2F, 0x7F, 0x62, 0x62, 0x80, 0xD0, 0x14 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_10_X[] = {
+    BYTES_TO_T_UINT_8( 0xB2, 0xDA, 0x00, 0x63, 0x09, 0xBD, 0x6A, 0x83 ),
+    BYTES_TO_T_UINT_8( 0x0F, 0xD4, 0x6E, 0x48, 0x05, 0xB7, 0xF7, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x14, 0x4D, 0xD7, 0x00, 0x4A, 0x15, 0x27, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x15, 0xAA, 0x37, 0x27, 0x34, 0x18, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x20, 0x2C, 0x84, 0x1B, 0x88, 0xBA, 0x05 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0x09, 0xD6, 0x04, 0xA2, 0x60, 0x84, 0x72 ),
+    BYTES_TO_T_UINT_8( 0xC8, 0x04, 0x94, 0x08, 0xD4, 0xED, 0x47, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x8B, 0xF3, 0xE4, 0x3E, 0xB9, 0x5B, 0x35, 0x42 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_10_Y[] = {
+    BYTES_TO_T_UINT_8( 0x5F, 0xD8, 0xB6, 0x80, 0xD6, 0xF1, 0x30, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x14, 0xA6, 0x85, 0xEE, 0xA7, 0xD8, 0x61 ),
+    BYTES_TO_T_UINT_8( 0xE4, 0x49, 0x2A, 0x1E, 0x7C, 0xE9, 0x2D, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x3A, 0x87, 0x56, 0x91, 0x03, 0x77, 0x4D, 0x55 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0x52, 0xD4, 0xAA, 0xF7, 0xFA, 0xB0, 0xC5 ),
+    BYTES_TO_T_UINT_8( 0x04, 0x5D, 0x11, 0x39, 0xB1, 0xE7, 0x76, 0xAD ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x13, 0xBC, 0x37, 0x5D, 0x74, 0xCD, 0xC2 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x48, 0x14, 0x23, 0x30, 0xF8, 0x46, 0x37 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_11_X[] = {
+    BYTES_TO_T_UINT_8( 0xAC, 0x27, 0xB0, 0xD9, 0xB2, 0x74, 0xB4, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0xEA, 0xA6, 0xB9, 0x6F, 0x9F, 0x64, 0x36, 0x92 ),
+    BYTES_TO_T_UINT_8( 0x2E, 0x2B, 0x78, 0x40, 0x05, 0x2B, 0x7B, 0xA9 ),
+    BYTES_TO_T_UINT_8( 0xB3, 0x68, 0x3A, 0xB6, 0x4A, 0xE2, 0xDB, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x1E, 0x33, 0xD7, 0x34, 0x8B, 0x25, 0x45, 0xEF ),
+    BYTES_TO_T_UINT_8( 0x89, 0xCE, 0xA8, 0xC9, 0x01, 0xFB, 0x0E, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xE2, 0xF9, 0x51, 0x4C, 0x12, 0x9F, 0x60, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0x67, 0x85, 0xBD, 0x30, 0x37, 0x84, 0x39, 0x44 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_11_Y[] = {
+    BYTES_TO_T_UINT_8( 0x26, 0x33, 0xAF, 0x2E, 0xB8, 0x2E, 0xCC, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xA4, 0xB1, 0x73, 0x59, 0x4E, 0x0C, 0x09, 0x4A ),
+    BYTES_TO_T_UINT_8( 0x8A, 0x24, 0x89, 0x81, 0x12, 0xFF, 0xBB, 0x6E ),
+    BYTES_TO_T_UINT_8( 0x71, 0x37, 0x1A, 0x66, 0xEE, 0xED, 0xB6, 0x9B ),
+    BYTES_TO_T_UINT_8( 0x16, 0xBD, 0x04, 0x20, 0x5D, 0xFB, 0xBF, 0x95 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0xF8, 0x34, 0xA3, 0xFF, 0x45, 0xDE, 0x92 ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x18, 0x73, 0xF1, 0x32, 0x25, 0x58, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x63, 0xC1, 0x14, 0xE3, 0x9E, 0x40, 0x0F, 0x12 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_12_X[] = {
+    BYTES_TO_T_UINT_8( 0x61, 0x07, 0x9D, 0x9C, 0x00, 0xF7, 0x56, 0x19 ),
+    BYTES_TO_T_UINT_8( 0xFB, 0xBA, 0x87, 0xF9, 0x15, 0x0C, 0x66, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x7E, 0x1F, 0xC1, 0x28, 0xB0, 0x47, 0x0D, 0xF5 ),
+    BYTES_TO_T_UINT_8( 0x96, 0xCA, 0x27, 0xEE, 0x4B, 0x23, 0x2B, 0x89 ),
+    BYTES_TO_T_UINT_8( 0x7E, 0xB5, 0x68, 0xC8, 0x17, 0x5D, 0xC3, 0xAA ),
+    BYTES_TO_T_UINT_8( 0x17, 0x02, 0x08, 0xEE, 0x20, 0x9D, 0xEA, 0x64 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0x14, 0x50, 0xD4, 0x7D, 0x5F, 0xCF, 0xA0 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0xFA, 0xF8, 0xA7, 0xC6, 0xDC, 0x14, 0x8C ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_12_Y[] = {
+    BYTES_TO_T_UINT_8( 0x76, 0xBD, 0x0A, 0x1A, 0x18, 0x98, 0xDC, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0x63, 0x63, 0x02, 0xB7, 0xD5, 0x5B, 0x5A, 0xC6 ),
+    BYTES_TO_T_UINT_8( 0x51, 0xB1, 0xD7, 0x4B, 0x15, 0x39, 0x61, 0x5D ),
+    BYTES_TO_T_UINT_8( 0x5C, 0x32, 0xE1, 0x9E, 0x70, 0x1B, 0xCE, 0x51 ),
+    BYTES_TO_T_UINT_8( 0x64, 0xD8, 0x18, 0x83, 0x52, 0x9B, 0x6D, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x55, 0x56, 0x19, 0x34, 0xA4, 0xEA, 0xFC ),
+    BYTES_TO_T_UINT_8( 0x30, 0xA9, 0x55, 0x80, 0xE3, 0x15, 0x36, 0x8B ),
+    BYTES_TO_T_UINT_8( 0xBB, 0x06, 0xC8, 0x1D, 0x17, 0x0D, 0xAD, 0x16 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_13_X[] = {
+    BYTES_TO_T_UINT_8( 0x20, 0xD6, 0xF0, 0xCC, 0xF3, 0x63, 0x53, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0x27, 0x5A, 0xDC, 0x46, 0xBD, 0x0D, 0xAD, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x21, 0x2F, 0x11, 0x60, 0x15, 0x51, 0x4A, 0xEA ),
+    BYTES_TO_T_UINT_8( 0x33, 0xE3, 0x93, 0x38, 0xD5, 0x83, 0xAA, 0x0D ),
+    BYTES_TO_T_UINT_8( 0x90, 0xA6, 0xCC, 0xB1, 0xFD, 0xBB, 0x1A, 0x0F ),
+    BYTES_TO_T_UINT_8( 0x3B, 0x54, 0xC8, 0x54, 0x6F, 0x79, 0x1A, 0x59 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0x4A, 0xDA, 0x28, 0x92, 0x97, 0x9D, 0x7F ),
+    BYTES_TO_T_UINT_8( 0xD6, 0x4B, 0xDB, 0xC7, 0x52, 0xC5, 0x66, 0x34 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_13_Y[] = {
+    BYTES_TO_T_UINT_8( 0x05, 0x7E, 0x92, 0x53, 0x30, 0x93, 0xFD, 0xFF ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x16, 0x6A, 0xB1, 0x91, 0x0A, 0xB4, 0x52 ),
+    BYTES_TO_T_UINT_8( 0x6D, 0x9D, 0x40, 0x3F, 0xE3, 0xF1, 0x01, 0x46 ),
+    BYTES_TO_T_UINT_8( 0x13, 0x0E, 0xD8, 0xED, 0x11, 0x8E, 0x4C, 0xED ),
+    BYTES_TO_T_UINT_8( 0x86, 0x4A, 0x1B, 0x88, 0xDF, 0x8D, 0x29, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x97, 0x23, 0x21, 0x11, 0xAB, 0x77, 0x81, 0x62 ),
+    BYTES_TO_T_UINT_8( 0x0B, 0xAF, 0x11, 0xFA, 0xBA, 0x40, 0x63, 0xE7 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0x6F, 0x8D, 0x80, 0xDF, 0x67, 0xF5, 0x44 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_14_X[] = {
+    BYTES_TO_T_UINT_8( 0xB2, 0x8B, 0xB7, 0x08, 0xF4, 0xD7, 0x2D, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x2B, 0x30, 0x02, 0x45, 0x71, 0x08, 0x49 ),
+    BYTES_TO_T_UINT_8( 0x97, 0x3A, 0xCA, 0x50, 0xF6, 0xC2, 0x19, 0x8C ),
+    BYTES_TO_T_UINT_8( 0x17, 0xB9, 0x9B, 0x3E, 0x73, 0x95, 0x1D, 0x49 ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x60, 0x59, 0x48, 0xCB, 0xD8, 0xD6, 0xAA ),
+    BYTES_TO_T_UINT_8( 0xF0, 0xB9, 0x6C, 0x89, 0xAB, 0x99, 0xA8, 0xF8 ),
+    BYTES_TO_T_UINT_8( 0xEF, 0xA1, 0x8B, 0x4E, 0x06, 0x19, 0xEC, 0x99 ),
+    BYTES_TO_T_UINT_8( 0x70, 0x95, 0x04, 0xCF, 0xD5, 0x94, 0xB3, 0x02 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_14_Y[] = {
+    BYTES_TO_T_UINT_8( 0x29, 0x35, 0x93, 0x7C, 0xB3, 0xB8, 0x9E, 0x1B ),
+    BYTES_TO_T_UINT_8( 0xC4, 0x45, 0x5C, 0x7E, 0xBF, 0x75, 0x81, 0x0F ),
+    BYTES_TO_T_UINT_8( 0xDC, 0xE8, 0x24, 0xDF, 0xEC, 0x2F, 0x7D, 0xB9 ),
+    BYTES_TO_T_UINT_8( 0xF2, 0x8B, 0xD5, 0x6A, 0x9B, 0xA0, 0xE0, 0x4F ),
+    BYTES_TO_T_UINT_8( 0x32, 0xE3, 0x27, 0x82, 0xDE, 0xDD, 0xCA, 0x4B ),
+    BYTES_TO_T_UINT_8( 0xA7, 0x57, 0x56, 0x46, 0x05, 0x06, 0x01, 0x2E ),
+    BYTES_TO_T_UINT_8( 0x74, 0x35, 0xA7, 0x47, 0xE2, 0x6B, 0x2C, 0x4F ),
+    BYTES_TO_T_UINT_8( 0x38, 0x9D, 0x4C, 0xEC, 0x1F, 0x11, 0x75, 0x2B ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_15_X[] = {
+    BYTES_TO_T_UINT_8( 0xAC, 0xAA, 0x41, 0xC1, 0xE9, 0x0E, 0xE9, 0xAA ),
+    BYTES_TO_T_UINT_8( 0x0A, 0xCF, 0x9C, 0x4B, 0xE8, 0xED, 0x0A, 0x49 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0x73, 0xCA, 0x0C, 0x46, 0x0A, 0x9C, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0x99, 0xE1, 0x9E, 0xBC, 0xFE, 0x44, 0x63, 0x6D ),
+    BYTES_TO_T_UINT_8( 0x31, 0x43, 0x71, 0xEE, 0xF8, 0xC1, 0x8C, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x6A, 0x4B, 0xF0, 0x69, 0x25, 0xBD, 0x71, 0x1A ),
+    BYTES_TO_T_UINT_8( 0xFD, 0x9A, 0xFE, 0x82, 0xE7, 0xC1, 0xC1, 0xEE ),
+    BYTES_TO_T_UINT_8( 0xFC, 0x5A, 0x6E, 0x5E, 0x97, 0x6A, 0x35, 0x8D ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_15_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA2, 0x18, 0x6C, 0x7E, 0xB8, 0x9E, 0x57, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x35, 0xB9, 0xC1, 0xD0, 0xFE, 0x78, 0xFB, 0x32 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0x08, 0xAE, 0x46, 0x34, 0xEA, 0x7A, 0x7F ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x1C, 0x56, 0xA9, 0x18, 0x37, 0xD4, 0x9E ),
+    BYTES_TO_T_UINT_8( 0x28, 0x63, 0xE9, 0x0A, 0xB6, 0x38, 0x3C, 0xC1 ),
+    BYTES_TO_T_UINT_8( 0x3E, 0x4F, 0xA4, 0x6E, 0x85, 0x31, 0x23, 0x52 ),
+    BYTES_TO_T_UINT_8( 0x0D, 0xAD, 0xC4, 0xC3, 0xB1, 0x4B, 0x1C, 0x82 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x56, 0x4A, 0x38, 0xB3, 0x6B, 0x6F, 0x2C ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_16_X[] = {
+    BYTES_TO_T_UINT_8( 0x67, 0xC7, 0x19, 0xDE, 0x21, 0xED, 0x89, 0xD0 ),
+    BYTES_TO_T_UINT_8( 0x2F, 0xBE, 0xA6, 0xAE, 0xEB, 0x9D, 0xA7, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x04, 0x0E, 0x13, 0x1E, 0x86, 0x57, 0xC3, 0x3B ),
+    BYTES_TO_T_UINT_8( 0x1F, 0x4B, 0x30, 0x46, 0x52, 0xC1, 0xEC, 0x52 ),
+    BYTES_TO_T_UINT_8( 0x6E, 0xD5, 0x44, 0x31, 0x96, 0x3B, 0x26, 0x27 ),
+    BYTES_TO_T_UINT_8( 0x77, 0x68, 0xA8, 0x67, 0x78, 0x39, 0xE8, 0x68 ),
+    BYTES_TO_T_UINT_8( 0x8E, 0x78, 0xB7, 0xDD, 0xF2, 0x58, 0xB6, 0x3D ),
+    BYTES_TO_T_UINT_8( 0x81, 0x3C, 0xB3, 0x26, 0xC4, 0x2C, 0x8C, 0xA5 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_16_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB9, 0x24, 0xE5, 0x73, 0xEE, 0x9A, 0x02, 0xA9 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0x6A, 0x65, 0x60, 0xF3, 0x62, 0xE3, 0xE9 ),
+    BYTES_TO_T_UINT_8( 0xFB, 0x07, 0x84, 0xE6, 0x3B, 0x46, 0x65, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xE1, 0x8F, 0x0C, 0xB0, 0xE1, 0x04, 0x82, 0x9D ),
+    BYTES_TO_T_UINT_8( 0xEB, 0x13, 0xBF, 0x3D, 0xA0, 0x48, 0xA2, 0x74 ),
+    BYTES_TO_T_UINT_8( 0x08, 0x26, 0x76, 0x74, 0xAB, 0x0B, 0x29, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0x30, 0x6E, 0x5F, 0x03, 0x34, 0x7C, 0x38, 0xCE ),
+    BYTES_TO_T_UINT_8( 0x4D, 0x72, 0xF9, 0x3B, 0x3C, 0xA4, 0xBC, 0x7C ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_17_X[] = {
+    BYTES_TO_T_UINT_8( 0x5C, 0xCE, 0x18, 0x80, 0xB8, 0x24, 0x45, 0x81 ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x09, 0x03, 0xB8, 0x06, 0x64, 0xF7, 0xEC ),
+    BYTES_TO_T_UINT_8( 0xF1, 0x26, 0xB1, 0x10, 0x6D, 0x71, 0x12, 0x2E ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x12, 0xC6, 0x6E, 0x1E, 0x6A, 0xC3, 0x80 ),
+    BYTES_TO_T_UINT_8( 0xE5, 0xD3, 0x0A, 0xDE, 0xD8, 0x6B, 0x04, 0x5C ),
+    BYTES_TO_T_UINT_8( 0x96, 0x87, 0x5B, 0xAE, 0xDB, 0x3C, 0xC0, 0xC5 ),
+    BYTES_TO_T_UINT_8( 0x8E, 0xF5, 0xF9, 0xC1, 0x9A, 0x89, 0xBB, 0x7E ),
+    BYTES_TO_T_UINT_8( 0xED, 0x69, 0x72, 0x8B, 0xAE, 0x32, 0x13, 0x11 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_17_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF9, 0x16, 0x07, 0x50, 0xFA, 0x4C, 0xCF, 0xE8 ),
+    BYTES_TO_T_UINT_8( 0xF8, 0x50, 0x21, 0xE9, 0xDE, 0xEC, 0x7E, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x7C, 0x2F, 0xE8, 0x83, 0x30, 0x0B, 0x65, 0x0E ),
+    BYTES_TO_T_UINT_8( 0xA5, 0x0B, 0x99, 0xAC, 0xC9, 0xBA, 0x6C, 0x2A ),
+    BYTES_TO_T_UINT_8( 0xA7, 0x59, 0x5A, 0x0D, 0x7B, 0x9E, 0x08, 0xAD ),
+    BYTES_TO_T_UINT_8( 0x34, 0x91, 0xB2, 0xDC, 0x90, 0xCE, 0x67, 0xED ),
+    BYTES_TO_T_UINT_8( 0xE3, 0x93, 0x60, 0x0C, 0xD7, 0x1F, 0x2F, 0x17 ),
+    BYTES_TO_T_UINT_8( 0x19, 0x7F, 0x9D, 0x40, 0xF8, 0x78, 0x7A, 0x54 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_18_X[] = {
+    BYTES_TO_T_UINT_8( 0x13, 0x22, 0x95, 0xE8, 0xEF, 0x31, 0x57, 0x35 ),
+    BYTES_TO_T_UINT_8( 0x2D, 0x88, 0x53, 0xFE, 0xAF, 0x7C, 0x47, 0x14 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0xCE, 0xCC, 0x79, 0xE8, 0x9F, 0x8C, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0xDB, 0x16, 0xDD, 0x77, 0x6E, 0x8A, 0x73, 0x97 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0x07, 0x97, 0x21, 0x3B, 0xF8, 0x5F, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0xC6, 0xB5, 0xD2, 0x81, 0x84, 0xF0, 0xE7, 0x9F ),
+    BYTES_TO_T_UINT_8( 0xCB, 0x8F, 0x75, 0x09, 0x6A, 0x0E, 0x53, 0xAD ),
+    BYTES_TO_T_UINT_8( 0xE6, 0x4F, 0x70, 0x97, 0xC7, 0xAC, 0x7D, 0x3F ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_18_Y[] = {
+    BYTES_TO_T_UINT_8( 0xF9, 0x3C, 0x6A, 0xB4, 0x10, 0xA9, 0xC8, 0x1D ),
+    BYTES_TO_T_UINT_8( 0xEE, 0xC5, 0xD6, 0x69, 0x16, 0xB8, 0xAC, 0x25 ),
+    BYTES_TO_T_UINT_8( 0xAC, 0x44, 0xDC, 0xEB, 0x48, 0x54, 0x5D, 0x5F ),
+    BYTES_TO_T_UINT_8( 0x6F, 0x48, 0x9B, 0xD7, 0x72, 0x69, 0xA4, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x0D, 0x36, 0x9A, 0x66, 0x0B, 0xEC, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0xC6, 0xD4, 0xB6, 0x60, 0xE5, 0xC3, 0x3A ),
+    BYTES_TO_T_UINT_8( 0xBA, 0x29, 0x42, 0xE0, 0x9D, 0xFD, 0x7C, 0x3E ),
+    BYTES_TO_T_UINT_8( 0x43, 0x10, 0xBA, 0x55, 0xBC, 0x3B, 0x38, 0x5D ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_19_X[] = {
+    BYTES_TO_T_UINT_8( 0x25, 0x66, 0xFA, 0x05, 0x73, 0x03, 0x1B, 0x69 ),
+    BYTES_TO_T_UINT_8( 0x11, 0xA4, 0x66, 0x12, 0x96, 0x7B, 0x02, 0x4C ),
+    BYTES_TO_T_UINT_8( 0x44, 0xB5, 0xDE, 0x6D, 0x98, 0xD1, 0xD5, 0xA8 ),
+    BYTES_TO_T_UINT_8( 0xE2, 0xF5, 0x44, 0xB8, 0x8E, 0xF6, 0x8C, 0x05 ),
+    BYTES_TO_T_UINT_8( 0x68, 0x15, 0x2B, 0x72, 0xBC, 0x49, 0xE5, 0xDF ),
+    BYTES_TO_T_UINT_8( 0x6C, 0x44, 0xD7, 0xDF, 0x8F, 0xEB, 0x8D, 0x80 ),
+    BYTES_TO_T_UINT_8( 0x05, 0x64, 0x88, 0xAA, 0xB7, 0xE4, 0x70, 0x1D ),
+    BYTES_TO_T_UINT_8( 0x9C, 0x14, 0xBB, 0xE9, 0x9B, 0xB9, 0x65, 0x5D ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_19_Y[] = {
+    BYTES_TO_T_UINT_8( 0x66, 0x8E, 0x88, 0xF5, 0xF1, 0xC1, 0x89, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0x16, 0x30, 0x53, 0xE6, 0xFB, 0x2D, 0x82, 0xB4 ),
+    BYTES_TO_T_UINT_8( 0xA7, 0xE4, 0xFF, 0xBA, 0x31, 0x79, 0xAB, 0xC2 ),
+    BYTES_TO_T_UINT_8( 0x45, 0x09, 0xF7, 0xB7, 0x09, 0x78, 0x4C, 0x90 ),
+    BYTES_TO_T_UINT_8( 0x10, 0xAE, 0xC2, 0x44, 0xDC, 0x17, 0x78, 0x47 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0xD4, 0x17, 0x43, 0x19, 0x74, 0x9E, 0x23 ),
+    BYTES_TO_T_UINT_8( 0x15, 0x64, 0x3B, 0x73, 0xA2, 0x99, 0x27, 0x76 ),
+    BYTES_TO_T_UINT_8( 0x05, 0x74, 0x36, 0x5F, 0xD3, 0x14, 0xB1, 0x31 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_20_X[] = {
+    BYTES_TO_T_UINT_8( 0xAC, 0x07, 0xAB, 0xFD, 0x9B, 0x03, 0xC5, 0xD5 ),
+    BYTES_TO_T_UINT_8( 0xC7, 0xBE, 0xB0, 0x1D, 0xF2, 0x0C, 0x73, 0x73 ),
+    BYTES_TO_T_UINT_8( 0x99, 0xE7, 0x7B, 0x87, 0xD3, 0x34, 0xFD, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x9A, 0x25, 0x3D, 0xC7, 0x36, 0x83, 0x53, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x22, 0x7C, 0xCF, 0x63, 0x55, 0x12, 0x11, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0xC0, 0x34, 0x4D, 0x27, 0x92, 0xAC, 0x18, 0x16 ),
+    BYTES_TO_T_UINT_8( 0x98, 0x42, 0x61, 0x9D, 0x2E, 0xFF, 0x13, 0x16 ),
+    BYTES_TO_T_UINT_8( 0xF4, 0xDE, 0x92, 0x65, 0x57, 0x0D, 0xBC, 0x0A ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_20_Y[] = {
+    BYTES_TO_T_UINT_8( 0xEF, 0x7B, 0x6E, 0xC6, 0x2A, 0x21, 0x74, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x37, 0xA7, 0x53, 0x4D, 0x29, 0x36, 0xEF, 0xE5 ),
+    BYTES_TO_T_UINT_8( 0xE1, 0xD6, 0x41, 0xC7, 0x99, 0xAD, 0x50, 0x53 ),
+    BYTES_TO_T_UINT_8( 0x99, 0xAC, 0x41, 0x9F, 0xFB, 0x4C, 0x86, 0xF1 ),
+    BYTES_TO_T_UINT_8( 0x8B, 0xBB, 0xE6, 0x25, 0x28, 0xAA, 0xEB, 0x1E ),
+    BYTES_TO_T_UINT_8( 0x92, 0x04, 0xA2, 0xC3, 0xAA, 0x08, 0x8A, 0xCC ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x2B, 0x5B, 0xE2, 0x8D, 0x76, 0xEA, 0x34 ),
+    BYTES_TO_T_UINT_8( 0xB3, 0x33, 0xD2, 0x21, 0x4D, 0x62, 0xE3, 0x8E ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_21_X[] = {
+    BYTES_TO_T_UINT_8( 0xF6, 0x06, 0x8B, 0x2B, 0xC2, 0xC4, 0xB1, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0xFA, 0xF5, 0xA1, 0xC0, 0x03, 0x6A, 0x29, 0x12 ),
+    BYTES_TO_T_UINT_8( 0xF5, 0xA9, 0xEF, 0x55, 0xB6, 0x1A, 0x9F, 0x6B ),
+    BYTES_TO_T_UINT_8( 0x9B, 0x54, 0x32, 0xBE, 0x06, 0x43, 0xB5, 0xFD ),
+    BYTES_TO_T_UINT_8( 0xF7, 0xD6, 0xD9, 0x20, 0x89, 0xBE, 0xD4, 0x1B ),
+    BYTES_TO_T_UINT_8( 0xE8, 0x26, 0x95, 0x10, 0xCE, 0xB4, 0x88, 0x79 ),
+    BYTES_TO_T_UINT_8( 0xE6, 0xA6, 0x27, 0xAC, 0x32, 0xBA, 0xBD, 0xC7 ),
+    BYTES_TO_T_UINT_8( 0xA3, 0xA6, 0xAE, 0x9C, 0x7B, 0xBE, 0xA1, 0x63 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_21_Y[] = {
+    BYTES_TO_T_UINT_8( 0x8B, 0xCD, 0x4D, 0x3D, 0xDF, 0x96, 0xBB, 0x7D ),
+    BYTES_TO_T_UINT_8( 0x77, 0xA7, 0x11, 0x06, 0xCC, 0x0E, 0x31, 0x81 ),
+    BYTES_TO_T_UINT_8( 0x20, 0xE4, 0xF4, 0xAD, 0x7B, 0x5F, 0xF1, 0xEF ),
+    BYTES_TO_T_UINT_8( 0xE4, 0x54, 0xBE, 0xF4, 0x8A, 0x03, 0x47, 0xDF ),
+    BYTES_TO_T_UINT_8( 0xB4, 0x53, 0x00, 0x7F, 0xB0, 0x8A, 0x68, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x16, 0xB1, 0x73, 0x6F, 0x5B, 0x0E, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0x2A, 0x32, 0xE3, 0x43, 0x64, 0x75, 0xFB, 0xFB ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x18, 0x55, 0x8A, 0x4E, 0x6E, 0x35, 0x54 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_22_X[] = {
+    BYTES_TO_T_UINT_8( 0x80, 0x97, 0x15, 0x1E, 0xCB, 0xF2, 0x9C, 0xA5 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0xD1, 0xBB, 0xF3, 0x70, 0xAD, 0x13, 0xAD ),
+    BYTES_TO_T_UINT_8( 0xD8, 0x96, 0xA4, 0xC5, 0x5E, 0xDA, 0xD5, 0x57 ),
+    BYTES_TO_T_UINT_8( 0x07, 0x81, 0xE9, 0x65, 0x66, 0x76, 0x47, 0x45 ),
+    BYTES_TO_T_UINT_8( 0xC9, 0x35, 0x87, 0x06, 0x73, 0xCF, 0x34, 0xD2 ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x81, 0x15, 0x42, 0xA2, 0x79, 0x5B, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x08, 0xA2, 0x7D, 0x09, 0x14, 0x64, 0xC6, 0xAE ),
+    BYTES_TO_T_UINT_8( 0x5E, 0x6D, 0xC4, 0xED, 0xF1, 0xD6, 0xE9, 0x24 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_22_Y[] = {
+    BYTES_TO_T_UINT_8( 0xB4, 0xD5, 0xBB, 0x25, 0xA3, 0xDD, 0xA3, 0x88 ),
+    BYTES_TO_T_UINT_8( 0x46, 0xF2, 0x68, 0x67, 0x39, 0x8F, 0x73, 0x93 ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x76, 0x28, 0x89, 0xAD, 0x32, 0xE0, 0xDF ),
+    BYTES_TO_T_UINT_8( 0xF8, 0x90, 0xCC, 0x57, 0x58, 0xAA, 0xC9, 0x75 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0xD7, 0x43, 0xD2, 0xCE, 0x5E, 0xA0, 0x08 ),
+    BYTES_TO_T_UINT_8( 0x33, 0xB0, 0xB8, 0xA4, 0x9E, 0x96, 0x26, 0x86 ),
+    BYTES_TO_T_UINT_8( 0x94, 0x61, 0x1D, 0xF3, 0x65, 0x5E, 0x60, 0xCA ),
+    BYTES_TO_T_UINT_8( 0xC7, 0x1E, 0x65, 0xED, 0xCF, 0x07, 0x60, 0x20 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_23_X[] = {
+    BYTES_TO_T_UINT_8( 0xA4, 0x30, 0x17, 0x8A, 0x91, 0x88, 0x0A, 0xA4 ),
+    BYTES_TO_T_UINT_8( 0x05, 0x7D, 0x18, 0xA4, 0xAC, 0x59, 0xFC, 0x5F ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x31, 0x8B, 0x25, 0x65, 0x39, 0x9A, 0xDC ),
+    BYTES_TO_T_UINT_8( 0x15, 0x16, 0x4B, 0x68, 0xBA, 0x59, 0x13, 0x2F ),
+    BYTES_TO_T_UINT_8( 0x8D, 0xFD, 0xD3, 0xC5, 0x56, 0xC9, 0x8C, 0x5E ),
+    BYTES_TO_T_UINT_8( 0xBC, 0xC6, 0x9F, 0xF4, 0xE6, 0xF7, 0xB4, 0x01 ),
+    BYTES_TO_T_UINT_8( 0x2D, 0x7C, 0x03, 0x00, 0x26, 0x9F, 0xD8, 0x7B ),
+    BYTES_TO_T_UINT_8( 0x24, 0x1D, 0x6E, 0x00, 0xB9, 0x00, 0x6E, 0x93 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_23_Y[] = {
+    BYTES_TO_T_UINT_8( 0x75, 0x63, 0xDA, 0x03, 0x2B, 0xD5, 0x0B, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x46, 0xFC, 0xE2, 0xC8, 0x47, 0xF0, 0xAE, 0xF2 ),
+    BYTES_TO_T_UINT_8( 0x51, 0x4C, 0xF7, 0x50, 0x0C, 0x48, 0x06, 0x2A ),
+    BYTES_TO_T_UINT_8( 0xDF, 0x2B, 0x32, 0x98, 0x0E, 0x7E, 0x61, 0x41 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0x02, 0x27, 0xFE, 0x75, 0x86, 0xDF, 0x24 ),
+    BYTES_TO_T_UINT_8( 0x2B, 0x30, 0xB1, 0x22, 0x32, 0x1B, 0xFE, 0x24 ),
+    BYTES_TO_T_UINT_8( 0xC2, 0x27, 0xF7, 0x78, 0x6F, 0xD7, 0xFD, 0xE4 ),
+    BYTES_TO_T_UINT_8( 0xA0, 0x78, 0xCC, 0xEA, 0xC0, 0x50, 0x24, 0x44 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_24_X[] = {
+    BYTES_TO_T_UINT_8( 0x37, 0x2B, 0x4F, 0x7F, 0x58, 0xE6, 0xC2, 0x70 ),
+    BYTES_TO_T_UINT_8( 0x37, 0x43, 0xD5, 0xA7, 0x35, 0x3C, 0x80, 0xB8 ),
+    BYTES_TO_T_UINT_8( 0x1A, 0x6D, 0x4B, 0x12, 0x00, 0x7B, 0xE6, 0xA6 ),
+    BYTES_TO_T_UINT_8( 0x37, 0x15, 0xBD, 0xD0, 0x9B, 0xCA, 0xAA, 0x81 ),
+    BYTES_TO_T_UINT_8( 0xCF, 0xCE, 0x9C, 0xE3, 0x8B, 0x60, 0x7A, 0x53 ),
+    BYTES_TO_T_UINT_8( 0x0C, 0xDA, 0x4B, 0x03, 0xA7, 0x8D, 0x43, 0x22 ),
+    BYTES_TO_T_UINT_8( 0x57, 0xAF, 0x00, 0x2B, 0x32, 0xF0, 0x22, 0x68 ),
+    BYTES_TO_T_UINT_8( 0xDC, 0xD9, 0x99, 0x99, 0xBE, 0x43, 0x99, 0x3E ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_24_Y[] = {
+    BYTES_TO_T_UINT_8( 0x1F, 0x71, 0x41, 0xF4, 0xB5, 0xFD, 0xDD, 0x36 ),
+    BYTES_TO_T_UINT_8( 0x9D, 0xE2, 0x20, 0x4C, 0xD1, 0x2E, 0x1F, 0x06 ),
+    BYTES_TO_T_UINT_8( 0x96, 0x43, 0x48, 0x76, 0x8A, 0x49, 0xAC, 0x87 ),
+    BYTES_TO_T_UINT_8( 0x0C, 0x1A, 0x55, 0xA8, 0xA3, 0xD4, 0x57, 0x75 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0xA6, 0x84, 0x39, 0xC9, 0x13, 0xBB, 0x60 ),
+    BYTES_TO_T_UINT_8( 0xD9, 0xFA, 0xA9, 0x70, 0xDE, 0x83, 0xDD, 0xC9 ),
+    BYTES_TO_T_UINT_8( 0xEC, 0xC9, 0xD9, 0x3E, 0x44, 0x91, 0x68, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xB6, 0x9F, 0x85, 0x6D, 0xF7, 0x54, 0x36, 0x82 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_25_X[] = {
+    BYTES_TO_T_UINT_8( 0x68, 0x6B, 0xA6, 0xA3, 0xE5, 0xD4, 0x46, 0xDB ),
+    BYTES_TO_T_UINT_8( 0x23, 0x3E, 0xDC, 0x84, 0x7C, 0x7B, 0x24, 0x34 ),
+    BYTES_TO_T_UINT_8( 0x14, 0xED, 0x7F, 0x86, 0x07, 0x6C, 0x57, 0xCA ),
+    BYTES_TO_T_UINT_8( 0x95, 0x06, 0xFE, 0x52, 0x12, 0x79, 0x69, 0x56 ),
+    BYTES_TO_T_UINT_8( 0x84, 0xD1, 0x44, 0x5F, 0x21, 0x3A, 0xC3, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x5E, 0xD9, 0x4A, 0xC0, 0x75, 0xAB, 0x17, 0xAC ),
+    BYTES_TO_T_UINT_8( 0xFF, 0x81, 0x94, 0xB6, 0x80, 0x6B, 0x6F, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0x07, 0xBE, 0x8E, 0xA5, 0xAA, 0xBC, 0x1E, 0x3E ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_25_Y[] = {
+    BYTES_TO_T_UINT_8( 0x89, 0xC7, 0x85, 0xA6, 0x59, 0x9B, 0xB1, 0x52 ),
+    BYTES_TO_T_UINT_8( 0x1C, 0xCE, 0x40, 0xD1, 0xFB, 0xDF, 0x94, 0xF7 ),
+    BYTES_TO_T_UINT_8( 0x18, 0xB8, 0x5E, 0xBF, 0x45, 0xA8, 0x2D, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x98, 0x9C, 0x06, 0x1B, 0xA9, 0x57, 0xB9, 0x79 ),
+    BYTES_TO_T_UINT_8( 0x53, 0xE9, 0xCE, 0xA2, 0xD3, 0x74, 0xA1, 0x3C ),
+    BYTES_TO_T_UINT_8( 0xAA, 0x5F, 0x34, 0x78, 0xDB, 0xAE, 0x3A, 0x14 ),
+    BYTES_TO_T_UINT_8( 0x7D, 0x32, 0x84, 0x3E, 0x68, 0x6A, 0x43, 0x0F ),
+    BYTES_TO_T_UINT_8( 0x8C, 0xBC, 0x39, 0x36, 0xA4, 0xC5, 0xBB, 0x11 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_26_X[] = {
+    BYTES_TO_T_UINT_8( 0x8C, 0x07, 0xA2, 0xB5, 0xC9, 0x0F, 0x4D, 0x0F ),
+    BYTES_TO_T_UINT_8( 0xE3, 0x1D, 0x67, 0xE6, 0xF1, 0x46, 0xEB, 0x71 ),
+    BYTES_TO_T_UINT_8( 0xD7, 0x41, 0x23, 0x95, 0xE7, 0xE0, 0x10, 0xDD ),
+    BYTES_TO_T_UINT_8( 0xBE, 0x69, 0xFE, 0x68, 0x8C, 0xC6, 0x5F, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0xE3, 0xB9, 0x2B, 0x3D, 0xD2, 0x4F, 0xD8, 0x1A ),
+    BYTES_TO_T_UINT_8( 0xA3, 0x09, 0xF5, 0x5F, 0xCF, 0xF6, 0x91, 0x57 ),
+    BYTES_TO_T_UINT_8( 0x65, 0x15, 0x42, 0x6B, 0x6D, 0xB5, 0xF3, 0xB6 ),
+    BYTES_TO_T_UINT_8( 0xBF, 0x56, 0x9D, 0xC5, 0xFF, 0xCA, 0x13, 0x9B ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_26_Y[] = {
+    BYTES_TO_T_UINT_8( 0x4D, 0x38, 0xE6, 0x23, 0x63, 0x48, 0x3C, 0xCA ),
+    BYTES_TO_T_UINT_8( 0xD2, 0x68, 0x3C, 0xD1, 0x3B, 0xE9, 0x3B, 0x82 ),
+    BYTES_TO_T_UINT_8( 0xB5, 0x08, 0x54, 0x49, 0xD1, 0x46, 0x45, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x07, 0x70, 0x52, 0x6E, 0x79, 0xC4, 0x5E, 0x95 ),
+    BYTES_TO_T_UINT_8( 0x36, 0xDF, 0xE8, 0x5A, 0x32, 0x81, 0xDA, 0xD3 ),
+    BYTES_TO_T_UINT_8( 0x3C, 0x2D, 0x94, 0x5B, 0xB5, 0x35, 0x9F, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x2A, 0x12, 0x8D, 0xC3, 0x36, 0x36, 0xB2, 0x2A ),
+    BYTES_TO_T_UINT_8( 0x39, 0x2F, 0x22, 0x38, 0x5B, 0x18, 0x4C, 0x35 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_27_X[] = {
+    BYTES_TO_T_UINT_8( 0x10, 0xC1, 0x22, 0x0E, 0xF0, 0x73, 0x11, 0x05 ),
+    BYTES_TO_T_UINT_8( 0xB2, 0xAE, 0xA4, 0x56, 0x18, 0x61, 0x66, 0x12 ),
+    BYTES_TO_T_UINT_8( 0x79, 0xFB, 0x72, 0x08, 0x84, 0x38, 0x51, 0xB0 ),
+    BYTES_TO_T_UINT_8( 0xDA, 0x86, 0xA8, 0xB9, 0x31, 0x99, 0x29, 0xC3 ),
+    BYTES_TO_T_UINT_8( 0x8A, 0xFB, 0xC3, 0x42, 0xB3, 0xC7, 0x6F, 0x3A ),
+    BYTES_TO_T_UINT_8( 0xD8, 0xF8, 0xE1, 0x09, 0xBE, 0x75, 0xB0, 0x22 ),
+    BYTES_TO_T_UINT_8( 0x5A, 0x7D, 0xFF, 0xF4, 0x99, 0xFC, 0x13, 0xAB ),
+    BYTES_TO_T_UINT_8( 0xE6, 0x1B, 0x84, 0x81, 0x42, 0x22, 0xC6, 0x3D ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_27_Y[] = {
+    BYTES_TO_T_UINT_8( 0x21, 0xE0, 0x37, 0xA4, 0xA0, 0x2F, 0x38, 0x7F ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x3D, 0xB7, 0x40, 0x2F, 0x39, 0x3C, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x7A, 0x3B, 0x8A, 0x51, 0xAE, 0x40, 0x49, 0x7A ),
+    BYTES_TO_T_UINT_8( 0x36, 0x20, 0x9F, 0xDD, 0xA9, 0xD0, 0x77, 0xC7 ),
+    BYTES_TO_T_UINT_8( 0x78, 0x1D, 0x64, 0xDA, 0xA0, 0x53, 0xC7, 0x7D ),
+    BYTES_TO_T_UINT_8( 0x37, 0x7B, 0x66, 0x55, 0x94, 0xD1, 0x51, 0x44 ),
+    BYTES_TO_T_UINT_8( 0x0E, 0xA9, 0xB5, 0x5B, 0x38, 0x35, 0x40, 0xC0 ),
+    BYTES_TO_T_UINT_8( 0xC8, 0xC9, 0x0F, 0xF0, 0x73, 0x79, 0x43, 0x61 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_28_X[] = {
+    BYTES_TO_T_UINT_8( 0x10, 0x47, 0x45, 0x69, 0x80, 0x72, 0x72, 0x42 ),
+    BYTES_TO_T_UINT_8( 0x70, 0x11, 0x99, 0x59, 0xDB, 0x48, 0x80, 0x39 ),
+    BYTES_TO_T_UINT_8( 0x75, 0x6E, 0x3D, 0xFC, 0x37, 0x15, 0xF4, 0xBF ),
+    BYTES_TO_T_UINT_8( 0x17, 0xBB, 0x5B, 0xA6, 0x35, 0x8D, 0x28, 0x20 ),
+    BYTES_TO_T_UINT_8( 0xAB, 0x1A, 0x3B, 0x2C, 0x8F, 0xD3, 0xAA, 0x2D ),
+    BYTES_TO_T_UINT_8( 0x55, 0x1C, 0x1A, 0xF8, 0x02, 0xD9, 0x7B, 0x41 ),
+    BYTES_TO_T_UINT_8( 0xAF, 0x69, 0xAC, 0xF8, 0x54, 0x31, 0x14, 0xA1 ),
+    BYTES_TO_T_UINT_8( 0x41, 0x8A, 0xE6, 0xDE, 0x58, 0xB9, 0xC4, 0x7A ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_28_Y[] = {
+    BYTES_TO_T_UINT_8( 0x57, 0x83, 0x52, 0xFE, 0xF9, 0x7B, 0xE9, 0x1F ),
+    BYTES_TO_T_UINT_8( 0x07, 0xA2, 0x55, 0x46, 0x15, 0x49, 0xC1, 0x3A ),
+    BYTES_TO_T_UINT_8( 0x1D, 0xBC, 0x5C, 0x91, 0xBD, 0xB9, 0x9C, 0xF4 ),
+    BYTES_TO_T_UINT_8( 0xBB, 0xFD, 0xB1, 0x4E, 0x5F, 0x74, 0xEE, 0x53 ),
+    BYTES_TO_T_UINT_8( 0xB1, 0x8B, 0xD8, 0x8B, 0x17, 0x73, 0x1B, 0x96 ),
+    BYTES_TO_T_UINT_8( 0x22, 0x92, 0xD7, 0x67, 0x06, 0xAD, 0x25, 0xCD ),
+    BYTES_TO_T_UINT_8( 0x01, 0x0F, 0x80, 0x24, 0xE2, 0x27, 0x5F, 0x8B ),
+    BYTES_TO_T_UINT_8( 0x61, 0x1C, 0xCE, 0xD0, 0x67, 0xCA, 0xD4, 0x0B ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_29_X[] = {
+    BYTES_TO_T_UINT_8( 0x87, 0xF1, 0xDD, 0x33, 0x66, 0xF9, 0x05, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0x1D, 0xE5, 0x6B, 0x79, 0xBD, 0x48, 0x42, 0xAA ),
+    BYTES_TO_T_UINT_8( 0xD1, 0x14, 0x52, 0xE3, 0x53, 0xB4, 0x50, 0xD4 ),
+    BYTES_TO_T_UINT_8( 0x32, 0x84, 0x6C, 0xCF, 0xDA, 0xB2, 0x20, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x70, 0xD6, 0x1A, 0xE5, 0xE2, 0x29, 0x70, 0xCE ),
+    BYTES_TO_T_UINT_8( 0xD5, 0x61, 0xFE, 0xBB, 0x21, 0x82, 0xD1, 0xFE ),
+    BYTES_TO_T_UINT_8( 0x2C, 0xF0, 0x9C, 0x8B, 0x1A, 0x42, 0x30, 0x06 ),
+    BYTES_TO_T_UINT_8( 0x43, 0xD6, 0x49, 0x81, 0x92, 0xF1, 0xD0, 0x90 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_29_Y[] = {
+    BYTES_TO_T_UINT_8( 0xC9, 0x91, 0x93, 0x6A, 0xA6, 0x22, 0xE9, 0xD6 ),
+    BYTES_TO_T_UINT_8( 0x09, 0xDC, 0xC3, 0x69, 0x11, 0x95, 0x7D, 0xEC ),
+    BYTES_TO_T_UINT_8( 0x1C, 0xA3, 0x9D, 0x87, 0x5E, 0x64, 0x41, 0xA2 ),
+    BYTES_TO_T_UINT_8( 0xBE, 0x87, 0x5A, 0x15, 0xBD, 0x6E, 0x3C, 0x8D ),
+    BYTES_TO_T_UINT_8( 0xD0, 0x8D, 0x50, 0xCC, 0xCF, 0xB7, 0x8F, 0x0B ),
+    BYTES_TO_T_UINT_8( 0x38, 0x65, 0xCD, 0x31, 0x30, 0xF1, 0x68, 0x13 ),
+    BYTES_TO_T_UINT_8( 0x10, 0x5C, 0x66, 0x67, 0x92, 0x30, 0x57, 0x95 ),
+    BYTES_TO_T_UINT_8( 0x23, 0x9B, 0x01, 0x3D, 0x20, 0x8B, 0xD1, 0x0D ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_30_X[] = {
+    BYTES_TO_T_UINT_8( 0xAB, 0xC0, 0xE6, 0x4F, 0xDE, 0x62, 0xAB, 0xB3 ),
+    BYTES_TO_T_UINT_8( 0xA4, 0x48, 0xB3, 0x1C, 0x0F, 0x16, 0x93, 0x45 ),
+    BYTES_TO_T_UINT_8( 0x77, 0x63, 0xBD, 0x1F, 0x16, 0x50, 0x56, 0x98 ),
+    BYTES_TO_T_UINT_8( 0x5D, 0x06, 0xBC, 0xE9, 0x27, 0x1C, 0x9A, 0x7B ),
+    BYTES_TO_T_UINT_8( 0xF8, 0xFE, 0x21, 0xC5, 0x39, 0x55, 0xE1, 0xFD ),
+    BYTES_TO_T_UINT_8( 0xF6, 0xA8, 0xD0, 0x96, 0x0E, 0xB5, 0xB2, 0x84 ),
+    BYTES_TO_T_UINT_8( 0x3D, 0xE7, 0x4B, 0xF3, 0x11, 0x0C, 0xC9, 0x5B ),
+    BYTES_TO_T_UINT_8( 0x43, 0x3A, 0xC4, 0x87, 0x71, 0xEE, 0xFA, 0x18 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_30_Y[] = {
+    BYTES_TO_T_UINT_8( 0xA7, 0x77, 0xEE, 0x81, 0x5E, 0x96, 0xEA, 0x4B ),
+    BYTES_TO_T_UINT_8( 0xEE, 0xDF, 0xA9, 0xF4, 0x4F, 0x7C, 0xB2, 0x43 ),
+    BYTES_TO_T_UINT_8( 0x9F, 0xD4, 0xDF, 0x35, 0x63, 0x47, 0x25, 0x8A ),
+    BYTES_TO_T_UINT_8( 0xA5, 0x3D, 0xFF, 0xA4, 0x02, 0xC3, 0x95, 0x11 ),
+    BYTES_TO_T_UINT_8( 0xD5, 0x10, 0x78, 0xD1, 0x2B, 0xB7, 0xBE, 0x0E ),
+    BYTES_TO_T_UINT_8( 0x0A, 0xE9, 0x57, 0xF9, 0xE0, 0xD8, 0xFC, 0xBC ),
+    BYTES_TO_T_UINT_8( 0xF3, 0xC4, 0x01, 0xD6, 0xB4, 0xE7, 0x78, 0xE2 ),
+    BYTES_TO_T_UINT_8( 0x02, 0x6C, 0xB9, 0x13, 0xA4, 0xE8, 0x6D, 0x6F ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_31_X[] = {
+    BYTES_TO_T_UINT_8( 0xE8, 0xB0, 0xC9, 0xCD, 0xBF, 0xA2, 0x1E, 0x63 ),
+    BYTES_TO_T_UINT_8( 0xDD, 0x4F, 0x86, 0x22, 0x9B, 0xEA, 0xE8, 0xBB ),
+    BYTES_TO_T_UINT_8( 0x50, 0x46, 0xDF, 0x43, 0xB9, 0x82, 0x2D, 0x0A ),
+    BYTES_TO_T_UINT_8( 0x07, 0x32, 0xF1, 0x4E, 0x95, 0x41, 0xAE, 0x8E ),
+    BYTES_TO_T_UINT_8( 0x52, 0x93, 0x26, 0xFC, 0xD3, 0x90, 0xDC, 0xEB ),
+    BYTES_TO_T_UINT_8( 0x04, 0x05, 0x45, 0xCA, 0xF9, 0x5A, 0x89, 0x93 ),
+    BYTES_TO_T_UINT_8( 0xC5, 0x82, 0x63, 0x4E, 0x55, 0x1D, 0x3A, 0x08 ),
+    BYTES_TO_T_UINT_8( 0x7C, 0x69, 0x52, 0x49, 0xE9, 0xED, 0x57, 0x34 ),
+};
+static const mbedtls_mpi_uint brainpoolP512r1_T_31_Y[] = {
+    BYTES_TO_T_UINT_8( 0x70, 0x64, 0xE9, 0xAC, 0x4C, 0x4A, 0xEA, 0x25 ),
+    BYTES_TO_T_UINT_8( 0xE9, 0xE9, 0x0B, 0x99, 0xE7, 0xF9, 0xA9, 0x2C ),
+    BYTES_TO_T_UINT_8( 0x24, 0x0C, 0xC1, 0xF4, 0x8D, 0x07, 0xB6, 0xB1 ),
+    BYTES_TO_T_UINT_8( 0xAD, 0x68, 0xFA, 0x35, 0xE4, 0x9E, 0xAE, 0xD9 ),
+    BYTES_TO_T_UINT_8( 0xF0, 0x2D, 0x1A, 0x13, 0x8E, 0x02, 0xE2, 0x63 ),
+    BYTES_TO_T_UINT_8( 0x27, 0x38, 0x28, 0x86, 0x46, 0x7B, 0x3A, 0xE1 ),
+    BYTES_TO_T_UINT_8( 0x3F, 0x4C, 0x64, 0x59, 0x0A, 0xF9, 0x02, 0xC4 ),
+    BYTES_TO_T_UINT_8( 0x41, 0x4F, 0x23, 0xA2, 0xC3, 0xD5, 0xEF, 0x42 ),
+};
+static const mbedtls_ecp_point brainpoolP512r1_T[32] = {
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_0_X, brainpoolP512r1_T_0_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_1_X, brainpoolP512r1_T_1_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_2_X, brainpoolP512r1_T_2_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_3_X, brainpoolP512r1_T_3_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_4_X, brainpoolP512r1_T_4_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_5_X, brainpoolP512r1_T_5_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_6_X, brainpoolP512r1_T_6_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_7_X, brainpoolP512r1_T_7_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_8_X, brainpoolP512r1_T_8_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_9_X, brainpoolP512r1_T_9_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_10_X, brainpoolP512r1_T_10_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_11_X, brainpoolP512r1_T_11_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_12_X, brainpoolP512r1_T_12_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_13_X, brainpoolP512r1_T_13_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_14_X, brainpoolP512r1_T_14_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_15_X, brainpoolP512r1_T_15_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_16_X, brainpoolP512r1_T_16_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_17_X, brainpoolP512r1_T_17_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_18_X, brainpoolP512r1_T_18_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_19_X, brainpoolP512r1_T_19_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_20_X, brainpoolP512r1_T_20_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_21_X, brainpoolP512r1_T_21_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_22_X, brainpoolP512r1_T_22_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_23_X, brainpoolP512r1_T_23_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_24_X, brainpoolP512r1_T_24_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_25_X, brainpoolP512r1_T_25_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_26_X, brainpoolP512r1_T_26_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_27_X, brainpoolP512r1_T_27_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_28_X, brainpoolP512r1_T_28_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_29_X, brainpoolP512r1_T_29_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_30_X, brainpoolP512r1_T_30_Y ),
+    ECP_POINT_INIT_XY( brainpoolP512r1_T_31_X, brainpoolP512r1_T_31_Y ),
+};
+#endif /* MBEDTLS_ECP_DP_BP512R1_ENABLED */
+
+#endif /* MBEDTLS_ECP_FIXED_POINT_OPTIM == 1 */
+/* END generated comb tables */
+
+/*
+ * Create an MPI from embedded constants
+ * (assumes len is an exact multiple of sizeof mbedtls_mpi_uint)
+ */
+static inline void ecp_mpi_load( mbedtls_mpi *X, const mbedtls_mpi_uint *p, size_t len )
+{
+    X->s = 1;
+    X->n = len / sizeof( mbedtls_mpi_uint );
+    X->p = (mbedtls_mpi_uint *) p;
+}
+
+/*
+ * Set an MPI to static value 1
+ */
+static inline void ecp_mpi_set1( mbedtls_mpi *X )
+{
+    static mbedtls_mpi_uint one[] = { 1 };
+    X->s = 1;
+    X->n = 1;
+    X->p = one;
+}
+
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+/*
+ * X = X R mod P, for X in the range 0..P-1
+ */
+static int ecp_mpi_to_mont( const mbedtls_ecp_group *grp, mbedtls_mpi *X )
+{
+    int ret;
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( X, X, &grp->RR ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_montg_reduce( X, &grp->P, grp->mm ) );
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * Keep the field elements of a group without fast reduction in Montgomery
+ * form (see ecp_modp() in ecp.c): set the constants, and replace the static
+ * table of G with a converted copy, owned by the group
+ */
+static int ecp_use_mont_form( mbedtls_ecp_group *grp )
+{
+    int ret;
+    size_t i;
+    mbedtls_mpi_uint mm;
+    mbedtls_ecp_point *T = NULL;
+
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+    /* Alternative implementations work on standard representations */
+    if( mbedtls_internal_ecp_grp_capable( grp ) )
+        return( 0 );
+#endif
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_montg_init( &mm, &grp->P ) );
+
+    /* one = R mod P, RR = R^2 mod P */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &grp->one, 1 ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_shift_l( &grp->one,
+                                    grp->P.n * sizeof( mbedtls_mpi_uint ) * 8 ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &grp->one, &grp->one, &grp->P ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &grp->RR, &grp->one, &grp->one ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &grp->RR, &grp->RR, &grp->P ) );
+
+    /* Set after RR, which ecp_mpi_to_mont() needs as well */
+    grp->mm = mm;
+
+    if( grp->A.p == NULL )
+        MBEDTLS_MPI_CHK( mbedtls_mpi_sub_int( &grp->Am, &grp->P, 3 ) );
+    else
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &grp->Am, &grp->A ) );
+    MBEDTLS_MPI_CHK( ecp_mpi_to_mont( grp, &grp->Am ) );
+
+    if( grp->T == NULL )
+        return( 0 );
+
+    /* The points are affine, with Z unset meaning 1 */
+    T = mbedtls_calloc( grp->T_size, sizeof( mbedtls_ecp_point ) );
+    if( T == NULL )
+    {
+        ret = MBEDTLS_ERR_ECP_ALLOC_FAILED;
+        goto cleanup;
+    }
+
+    for( i = 0; i < grp->T_size; i++ )
+    {
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &T[i].X, &grp->T[i].X ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &T[i].Y, &grp->T[i].Y ) );
+        MBEDTLS_MPI_CHK( ecp_mpi_to_mont( grp, &T[i].X ) );
+        MBEDTLS_MPI_CHK( ecp_mpi_to_mont( grp, &T[i].Y ) );
+    }
+
+    grp->T = T;
+    T = NULL;
+
+cleanup:
+
+    if( T != NULL )
+    {
+        for( i = 0; i < grp->T_size; i++ )
+            mbedtls_ecp_point_free( &T[i] );
+        mbedtls_free( T );
+    }
+
+    /* grp->T is still the static table at this point, not to be freed */
+    if( ret != 0 )
+    {
+        grp->mm = 0;
+        mbedtls_ecp_group_free( grp );
+    }
+
+    return( ret );
+}
+#endif /* MBEDTLS_ECP_MONT_FORM_OPTIM */
+
+/*
+ * Make group available from embedded constants
+ */
+static int ecp_group_load( mbedtls_ecp_group *grp,
+                           const mbedtls_mpi_uint *p,  size_t plen,
+                           const mbedtls_mpi_uint *a,  size_t alen,
+                           const mbedtls_mpi_uint *b,  size_t blen,
+                           const mbedtls_mpi_uint *gx, size_t gxlen,
+                           const mbedtls_mpi_uint *gy, size_t gylen,
+                           const mbedtls_mpi_uint *n,  size_t nlen,
+                           const mbedtls_ecp_point *T, size_t T_size )
+{
+    ecp_mpi_load( &grp->P, p, plen );
+    if( a != NULL )
+        ecp_mpi_load( &grp->A, a, alen );
+    ecp_mpi_load( &grp->B, b, blen );
+    ecp_mpi_load( &grp->N, n, nlen );
+
+    ecp_mpi_load( &grp->G.X, gx, gxlen );
+    ecp_mpi_load( &grp->G.Y, gy, gylen );
+    ecp_mpi_set1( &grp->G.Z );
+
+    grp->pbits = mbedtls_mpi_bitlen( &grp->P );
+    grp->nbits = mbedtls_mpi_bitlen( &grp->N );
+
+    /* Static groups come with a static table or none at all */
+    grp->T = (mbedtls_ecp_point *) T;
+    grp->T_size = T_size;
+
+    grp->h = 1;
+
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    if( grp->modp == NULL )
+        return( ecp_use_mont_form( grp ) );
+#endif
+
+    return( 0 );
+}
+
+#if defined(MBEDTLS_ECP_NIST_OPTIM)
+/* Forward declarations */
+#if defined(MBEDTLS_ECP_DP_SECP192R1_ENABLED)
+static int ecp_mod_p192( mbedtls_mpi * );
+#endif
+#if defined(MBEDTLS_ECP_DP_SECP224R1_ENABLED)
+static int ecp_mod_p224( mbedtls_mpi * );
+#endif
+#if defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+static int ecp_mod_p256( mbedtls_mpi * );
+#endif
+#if defined(MBEDTLS_ECP_DP_SECP384R1_ENABLED)
+static int ecp_mod_p384( mbedtls_mpi * );
+#endif
+#if defined(MBEDTLS_ECP_DP_SECP521R1_ENABLED)
+static int ecp_mod_p521( mbedtls_mpi * );
+#endif
+
+#define NIST_MODP( P )      grp->modp = ecp_mod_ ## P;
+#else
+#define NIST_MODP( P )
+#endif /* MBEDTLS_ECP_NIST_OPTIM */
+
+/* Additional forward declarations */
+#if defined(MBEDTLS_ECP_DP_CURVE25519_ENABLED)
+static int ecp_mod_p255( mbedtls_mpi * );
+#endif
+#if defined(MBEDTLS_ECP_DP_SECP192K1_ENABLED)
+static int ecp_mod_p192k1( mbedtls_mpi * );
+#endif
+#if defined(MBEDTLS_ECP_DP_SECP224K1_ENABLED)
+static int ecp_mod_p224k1( mbedtls_mpi * );
+#endif
+#if defined(MBEDTLS_ECP_DP_SECP256K1_ENABLED)
+static int ecp_mod_p256k1( mbedtls_mpi * );
+#endif
+
+#if MBEDTLS_ECP_FIXED_POINT_OPTIM == 1
+#define LOAD_GROUP_T( G )   G ## _T,  sizeof( G ## _T ) / sizeof( G ## _T[0] )
+#else
+#define LOAD_GROUP_T( G )   NULL,     0
 #endif
 
 #define LOAD_GROUP_A( G )   ecp_group_load( grp,            \
@@ -643,7 +6121,8 @@ static int ecp_mod_p256k1( mbedtls_mpi * );
                             G ## _b,  sizeof( G ## _b  ),   \
                             G ## _gx, sizeof( G ## _gx ),   \
                             G ## _gy, sizeof( G ## _gy ),   \
-                            G ## _n,  sizeof( G ## _n  ) )
+                            G ## _n,  sizeof( G ## _n  ),   \
+                            LOAD_GROUP_T( G ) )
 
 #define LOAD_GROUP( G )     ecp_group_load( grp,            \
                             G ## _p,  sizeof( G ## _p  ),   \
@@ -651,7 +6130,8 @@ static int ecp_mod_p256k1( mbedtls_mpi * );
                             G ## _b,  sizeof( G ## _b  ),   \
                             G ## _gx, sizeof( G ## _gx ),   \
                             G ## _gy, sizeof( G ## _gy ),   \
-                            G ## _n,  sizeof( G ## _n  ) )
+                            G ## _n,  sizeof( G ## _n  ),   \
+                            LOAD_GROUP_T( G ) )
 
 #if defined(MBEDTLS_ECP_DP_CURVE25519_ENABLED)
 /*
@@ -929,6 +6409,7 @@ static inline void sub32( uint32_t *dst, uint32_t src, signed char *carry )
     mbedtls_mpi C;                                                  \
     mbedtls_mpi_uint Cp[ b / 8 / sizeof( mbedtls_mpi_uint) + 1 ];               \
                                                             \
+    mbedtls_mpi_init( &C );                                 \
     C.s = 1;                                                \
     C.n = b / 8 / sizeof( mbedtls_mpi_uint) + 1;                      \
     C.p = Cp;                                               \
@@ -1127,6 +6608,7 @@ static int ecp_mod_p521( mbedtls_mpi *N )
         return( 0 );
 
     /* M = A1 */
+    mbedtls_mpi_init( &M );
     M.s = 1;
     M.n = N->n - ( P521_WIDTH - 1 );
     if( M.n > P521_WIDTH + 1 )
@@ -1173,6 +6655,7 @@ static int ecp_mod_p255( mbedtls_mpi *N )
         return( 0 );
 
     /* M = A1 */
+    mbedtls_mpi_init( &M );
     M.s = 1;
     M.n = N->n - ( P255_WIDTH - 1 );
     if( M.n > P255_WIDTH + 1 )
@@ -1221,11 +6704,13 @@ static inline int ecp_mod_koblitz( mbedtls_mpi *N, mbedtls_mpi_uint *Rp, size_t
         return( 0 );
 
     /* Init R */
+    mbedtls_mpi_init( &R );
     R.s = 1;
     R.p = Rp;
     R.n = P_KOBLITZ_R;
 
     /* Common setup for M */
+    mbedtls_mpi_init( &M );
     M.s = 1;
     M.p = Mp;
 
@@ -0,0 +1,701 @@
+/*
+ *  Fixed-size secp256r1 arithmetic for the ECP internal interface
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+
+/*
+ * This module implements the MBEDTLS_ECP_INTERNAL_ALT interface for
+ * secp256r1. Field elements live on the stack in arrays of 256 bits worth of
+ * limbs instead of heap-allocated mbedtls_mpi, and every field operation runs
+ * in time independent of its operands.
+ *
+ * Field elements are kept fully reduced, as the coordinates of points are in
+ * ecp.c, so they convert to and from mbedtls_mpi by copying limbs.
+ * Products are reduced with the NIST fast reduction (FIPS 186-4 D.2.3), and
+ * inversion is a fixed exponentiation by p - 2.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_ECP_P256_C)
+
+#include "mbedtls/ecp.h"
+
+#include <string.h>
+
+/* ecp_internal.h only declares the functions for short Weierstrass curves
+ * when the including module supports them, as ecp.c tells it */
+#define ECP_SHORTWEIERSTRASS
+#include "mbedtls/ecp_internal.h"
+
+#if ( defined(__ARMCC_VERSION) || defined(_MSC_VER) ) && \
+    !defined(inline) && !defined(__cplusplus)
+#define inline __inline
+#endif
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize( void *v, size_t n ) {
+    volatile unsigned char *p = v; while( n-- ) *p++ = 0;
+}
+
+#define ciL             ( sizeof( mbedtls_mpi_uint ) )  /* chars in limb  */
+#define biL             ( ciL << 3 )                    /* bits  in limb  */
+
+#define P256_LIMBS      ( 32 / ciL )
+#define P256_WORDS      8               /* 32-bit words in a field element */
+
+/* Number of points normalized with each inversion, as many as ecp.c may
+ * precompute for a comb */
+#define P256_NORM_MAX   ( 1 << ( MBEDTLS_ECP_WINDOW_SIZE - 1 ) )
+
+typedef mbedtls_mpi_uint p256_fe[P256_LIMBS];
+
+#if defined(MBEDTLS_HAVE_INT32)
+#define P256_LIMB( lo, hi )     (mbedtls_mpi_uint)( lo ), (mbedtls_mpi_uint)( hi )
+#else
+#define P256_LIMB( lo, hi )     ( (mbedtls_mpi_uint)( hi ) << 32 | ( lo ) )
+#endif
+
+/* p = 2^256 - 2^224 + 2^192 + 2^96 - 1 */
+static const p256_fe p256_p = {
+    P256_LIMB( 0xFFFFFFFF, 0xFFFFFFFF ), P256_LIMB( 0xFFFFFFFF, 0x00000000 ),
+    P256_LIMB( 0x00000000, 0x00000000 ), P256_LIMB( 0x00000001, 0xFFFFFFFF ),
+};
+
+/*
+ * Load a field element from a coordinate, which must be reduced mod p
+ */
+static int p256_from_mpi( p256_fe r, const mbedtls_mpi *X )
+{
+    size_t i;
+
+    if( X->s < 0 )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    for( i = 0; i < P256_LIMBS; i++ )
+        r[i] = i < X->n ? X->p[i] : 0;
+
+    for( ; i < X->n; i++ )
+        if( X->p[i] != 0 )
+            return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    return( 0 );
+}
+
+/*
+ * Store a field element into a coordinate, without reallocating it if it
+ * already has enough limbs
+ */
+static int p256_to_mpi( mbedtls_mpi *X, const p256_fe a )
+{
+    int ret;
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_grow( X, P256_LIMBS ) );
+
+    memset( X->p, 0, X->n * ciL );
+    memcpy( X->p, a, sizeof( p256_fe ) );
+    X->s = 1;
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * r = a if cond == 1, unchanged if cond == 0, without branches
+ */
+static void p256_cond_assign( p256_fe r, const p256_fe a, mbedtls_mpi_uint cond )
+{
+    mbedtls_mpi_uint mask = (mbedtls_mpi_uint) 0 - cond;
+    size_t i;
+
+    for( i = 0; i < P256_LIMBS; i++ )
+        r[i] = ( r[i] & ~mask ) | ( a[i] & mask );
+}
+
+/*
+ * 1 if a == 0, 0 otherwise, without branches
+ */
+static mbedtls_mpi_uint p256_is_zero( const p256_fe a )
+{
+    mbedtls_mpi_uint acc = 0;
+    size_t i;
+
+    for( i = 0; i < P256_LIMBS; i++ )
+        acc |= a[i];
+
+    /* The top bit of acc | -acc is set iff acc != 0 */
+    return( 1 ^ ( ( acc | ( (mbedtls_mpi_uint) 0 - acc ) ) >> ( biL - 1 ) ) );
+}
+
+/*
+ * r = a + b, returning the carry
+ */
+static mbedtls_mpi_uint p256_add_raw( p256_fe r, const p256_fe a, const p256_fe b )
+{
+    mbedtls_mpi_uint c = 0, t;
+    size_t i;
+
+    for( i = 0; i < P256_LIMBS; i++ )
+    {
+        t = a[i] + c; c = ( t < c );
+        r[i] = t + b[i]; c += ( r[i] < t );
+    }
+
+    return( c );
+}
+
+/*
+ * r = a - b, returning the borrow
+ */
+static mbedtls_mpi_uint p256_sub_raw( p256_fe r, const p256_fe a, const p256_fe b )
+{
+    mbedtls_mpi_uint c = 0, t, z;
+    size_t i;
+
+    for( i = 0; i < P256_LIMBS; i++ )
+    {
+        z = ( a[i] < c ); t = a[i] - c;
+        c = ( t < b[i] ) + z; r[i] = t - b[i];
+    }
+
+    return( c );
+}
+
+/*
+ * r = a + b mod p
+ */
+static void p256_add( p256_fe r, const p256_fe a, const p256_fe b )
+{
+    p256_fe t;
+    mbedtls_mpi_uint carry, borrow;
+
+    carry = p256_add_raw( r, a, b );
+    borrow = p256_sub_raw( t, r, p256_p );
+
+    /* a + b < 2p: subtract p unless a + b < p */
+    p256_cond_assign( r, t, carry | ( borrow ^ 1 ) );
+}
+
+/*
+ * r = a - b mod p
+ */
+static void p256_sub( p256_fe r, const p256_fe a, const p256_fe b )
+{
+    p256_fe t;
+    mbedtls_mpi_uint borrow;
+
+    borrow = p256_sub_raw( r, a, b );
+    p256_add_raw( t, r, p256_p );
+    p256_cond_assign( r, t, borrow );
+}
+
+/*
+ * Double-width product of two limbs: returns the low half, stores the high
+ * half in *hi
+ */
+static inline mbedtls_mpi_uint p256_mul_limb( mbedtls_mpi_uint a,
+                                              mbedtls_mpi_uint b,
+                                              mbedtls_mpi_uint *hi )
+{
+#if defined(MBEDTLS_HAVE_UDBL)
+    mbedtls_t_udbl r = (mbedtls_t_udbl) a * b;
+
+    *hi = (mbedtls_mpi_uint)( r >> biL );
+    return( (mbedtls_mpi_uint) r );
+#else
+    const mbedtls_mpi_uint m = ( (mbedtls_mpi_uint) 1 << ( biL / 2 ) ) - 1;
+    mbedtls_mpi_uint a0 = a & m, a1 = a >> ( biL / 2 );
+    mbedtls_mpi_uint b0 = b & m, b1 = b >> ( biL / 2 );
+    mbedtls_mpi_uint p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0;
+    mbedtls_mpi_uint mid = ( p00 >> ( biL / 2 ) ) + ( p01 & m ) + ( p10 & m );
+
+    *hi = a1 * b1 + ( p01 >> ( biL / 2 ) ) + ( p10 >> ( biL / 2 ) ) +
+          ( mid >> ( biL / 2 ) );
+    return( ( p00 & m ) | ( mid << ( biL / 2 ) ) );
+#endif
+}
+
+/*
+ * Signed carry out of a 32-bit word accumulator
+ */
+static inline int64_t p256_carry( int64_t c )
+{
+    return( ( c - (int64_t)(uint32_t) c ) / ( (int64_t) 1 << 32 ) );
+}
+
+/*
+ * w += top * 2^256 mod p, that is top * (2^224 - 2^192 - 2^96 + 1),
+ * returning the new carry out of w
+ */
+static int64_t p256_fold( uint32_t w[P256_WORDS], int64_t top )
+{
+    int64_t c = 0;
+    size_t i;
+
+    for( i = 0; i < P256_WORDS; i++ )
+    {
+        c += w[i];
+        if( i == 0 || i == 7 )
+            c += top;
+        else if( i == 3 || i == 6 )
+            c -= top;
+
+        w[i] = (uint32_t) c;
+        c = p256_carry( c );
+    }
+
+    return( c );
+}
+
+/*
+ * r = t mod p, for t < 2^512 (FIPS 186-4 D.2.3)
+ */
+static void p256_reduce( p256_fe r, const mbedtls_mpi_uint t[2 * P256_LIMBS] )
+{
+    uint32_t a[2 * P256_WORDS], w[P256_WORDS];
+    int64_t c;
+    p256_fe d;
+    size_t i;
+
+    for( i = 0; i < 2 * P256_WORDS; i++ )
+        a[i] = (uint32_t)( t[i / ( ciL / 4 )] >> ( 32 * ( i % ( ciL / 4 ) ) ) );
+
+#define A( i )  ( (int64_t) a[i] )
+#define W( i )  w[i] = (uint32_t) c; c = p256_carry( c )
+
+    c =         A( 0 ) + A(  8 ) + A(  9 ) - A( 11 ) - A( 12 ) - A( 13 ) - A( 14 );
+    W( 0 );
+    c +=        A( 1 ) + A(  9 ) + A( 10 ) - A( 12 ) - A( 13 ) - A( 14 ) - A( 15 );
+    W( 1 );
+    c +=        A( 2 ) + A( 10 ) + A( 11 ) - A( 13 ) - A( 14 ) - A( 15 );
+    W( 2 );
+    c +=        A( 3 ) + 2 * A( 11 ) + 2 * A( 12 ) + A( 13 )
+                - A( 15 ) - A(  8 ) - A(  9 );
+    W( 3 );
+    c +=        A( 4 ) + 2 * A( 12 ) + 2 * A( 13 ) + A( 14 ) - A(  9 ) - A( 10 );
+    W( 4 );
+    c +=        A( 5 ) + 2 * A( 13 ) + 2 * A( 14 ) + A( 15 ) - A( 10 ) - A( 11 );
+    W( 5 );
+    c +=        A( 6 ) + 3 * A( 14 ) + 2 * A( 15 ) + A( 13 ) - A(  8 ) - A(  9 );
+    W( 6 );
+    c +=        A( 7 ) + 3 * A( 15 ) + A(  8 )
+                - A( 10 ) - A( 11 ) - A( 12 ) - A( 13 );
+    W( 7 );
+
+#undef A
+#undef W
+
+    /*
+     * Now t = w + c * 2^256 with -4 <= c <= 6. Folding c back in leaves a
+     * carry of at most one in absolute value, and folding that one cannot
+     * carry again, so that two folds always bring the value in [0, 2^256).
+     */
+    c = p256_fold( w, c );
+    (void) p256_fold( w, c );
+
+    memset( r, 0, sizeof( p256_fe ) );
+    for( i = 0; i < P256_WORDS; i++ )
+        r[i / ( ciL / 4 )] |= (mbedtls_mpi_uint) w[i] << ( 32 * ( i % ( ciL / 4 ) ) );
+
+    /* 2^256 < 2p: at most one subtraction left */
+    c = (int64_t) p256_sub_raw( d, r, p256_p );
+    p256_cond_assign( r, d, (mbedtls_mpi_uint)( c ^ 1 ) );
+
+    mbedtls_zeroize( a, sizeof( a ) );
+}
+
+/*
+ * r = a * b mod p
+ */
+static void p256_mul( p256_fe r, const p256_fe a, const p256_fe b )
+{
+    mbedtls_mpi_uint t[2 * P256_LIMBS];
+    mbedtls_mpi_uint lo, hi, c;
+    size_t i, j;
+
+    memset( t, 0, sizeof( t ) );
+
+    for( i = 0; i < P256_LIMBS; i++ )
+    {
+        c = 0;
+        for( j = 0; j < P256_LIMBS; j++ )
+        {
+            lo = p256_mul_limb( a[i], b[j], &hi );
+            lo += c;        hi += ( lo < c );
+            lo += t[i + j]; hi += ( lo < t[i + j] );
+            t[i + j] = lo;
+            c = hi;
+        }
+        t[i + P256_LIMBS] = c;
+    }
+
+    p256_reduce( r, t );
+}
+
+/*
+ * r = a^(2^n) mod p
+ */
+static void p256_sqr_n( p256_fe r, const p256_fe a, unsigned n )
+{
+    if( r != a )
+        memcpy( r, a, sizeof( p256_fe ) );
+
+    while( n-- > 0 )
+        p256_mul( r, r, r );
+}
+
+/*
+ * r = 1 / a mod p = a^(p - 2) mod p, with a fixed addition chain.
+ * p - 2 = 2^256 - 2^224 + 2^192 + 2^96 - 3: 32 ones, 31 zeros, one one,
+ * 96 zeros, 94 ones, one zero, one one.
+ */
+static void p256_inv( p256_fe r, const p256_fe a )
+{
+    p256_fe x2, x3, x6, x12, x15, x30, x32, t;
+
+    p256_mul( x2, a, a );       p256_mul( x2, x2, a );      /* 2^2 - 1 */
+    p256_mul( x3, x2, x2 );     p256_mul( x3, x3, a );      /* 2^3 - 1 */
+    p256_sqr_n( x6, x3, 3 );    p256_mul( x6, x6, x3 );     /* 2^6 - 1 */
+    p256_sqr_n( x12, x6, 6 );   p256_mul( x12, x12, x6 );   /* 2^12 - 1 */
+    p256_sqr_n( x15, x12, 3 );  p256_mul( x15, x15, x3 );   /* 2^15 - 1 */
+    p256_sqr_n( x30, x15, 15 ); p256_mul( x30, x30, x15 );  /* 2^30 - 1 */
+    p256_sqr_n( x32, x30, 2 );  p256_mul( x32, x32, x2 );   /* 2^32 - 1 */
+
+    p256_sqr_n( t, x32, 32 );   p256_mul( t, t, a );
+    p256_sqr_n( t, t, 128 );    p256_mul( t, t, x32 );
+    p256_sqr_n( t, t, 32 );     p256_mul( t, t, x32 );
+    p256_sqr_n( t, t, 30 );     p256_mul( t, t, x30 );
+    p256_sqr_n( t, t, 2 );      p256_mul( r, t, a );
+
+    mbedtls_zeroize( x2, sizeof( x2 ) ); mbedtls_zeroize( x3, sizeof( x3 ) );
+    mbedtls_zeroize( x6, sizeof( x6 ) ); mbedtls_zeroize( x12, sizeof( x12 ) );
+    mbedtls_zeroize( x15, sizeof( x15 ) ); mbedtls_zeroize( x30, sizeof( x30 ) );
+    mbedtls_zeroize( x32, sizeof( x32 ) ); mbedtls_zeroize( t, sizeof( t ) );
+}
+
+/*
+ * Point doubling in place, Jacobian coordinates, A = -3: same formulas and
+ * variable names as ecp_double_jac()
+ */
+static void p256_double( p256_fe X, p256_fe Y, p256_fe Z )
+{
+    p256_fe M, S, T, U;
+
+    /* M = 3(X + Z^2)(X - Z^2) */
+    p256_mul( S, Z, Z );
+    p256_add( T, X, S );
+    p256_sub( U, X, S );
+    p256_mul( S, T, U );
+    p256_add( M, S, S );
+    p256_add( M, M, S );
+
+    /* S = 4.X.Y^2 */
+    p256_mul( T, Y, Y );
+    p256_add( T, T, T );
+    p256_mul( S, X, T );
+    p256_add( S, S, S );
+
+    /* U = 8.Y^4 */
+    p256_mul( U, T, T );
+    p256_add( U, U, U );
+
+    /* Z = 2.Y.Z, while Y is still available */
+    p256_mul( Z, Y, Z );
+    p256_add( Z, Z, Z );
+
+    /* X = M^2 - 2.S */
+    p256_mul( X, M, M );
+    p256_sub( X, X, S );
+    p256_sub( X, X, S );
+
+    /* Y = M(S - X) - U */
+    p256_sub( S, S, X );
+    p256_mul( Y, S, M );
+    p256_sub( Y, Y, U );
+
+    mbedtls_zeroize( M, sizeof( M ) ); mbedtls_zeroize( S, sizeof( S ) );
+    mbedtls_zeroize( T, sizeof( T ) ); mbedtls_zeroize( U, sizeof( U ) );
+}
+
+unsigned char mbedtls_internal_ecp_grp_capable( const mbedtls_ecp_group *grp )
+{
+    return( grp->id == MBEDTLS_ECP_DP_SECP256R1 );
+}
+
+int mbedtls_internal_ecp_init( const mbedtls_ecp_group *grp )
+{
+    (void) grp;
+    return( 0 );
+}
+
+void mbedtls_internal_ecp_free( const mbedtls_ecp_group *grp )
+{
+    (void) grp;
+}
+
+#if defined(MBEDTLS_ECP_DOUBLE_JAC_ALT)
+int mbedtls_internal_ecp_double_jac( const mbedtls_ecp_group *grp,
+        mbedtls_ecp_point *R, const mbedtls_ecp_point *P )
+{
+    int ret;
+    p256_fe X, Y, Z;
+
+    (void) grp;
+
+    MBEDTLS_MPI_CHK( p256_from_mpi( X, &P->X ) );
+    MBEDTLS_MPI_CHK( p256_from_mpi( Y, &P->Y ) );
+    MBEDTLS_MPI_CHK( p256_from_mpi( Z, &P->Z ) );
+
+    p256_double( X, Y, Z );
+
+    MBEDTLS_MPI_CHK( p256_to_mpi( &R->X, X ) );
+    MBEDTLS_MPI_CHK( p256_to_mpi( &R->Y, Y ) );
+    MBEDTLS_MPI_CHK( p256_to_mpi( &R->Z, Z ) );
+
+cleanup:
+    mbedtls_zeroize( X, sizeof( X ) ); mbedtls_zeroize( Y, sizeof( Y ) );
+    mbedtls_zeroize( Z, sizeof( Z ) );
+
+    return( ret );
+}
+#endif /* MBEDTLS_ECP_DOUBLE_JAC_ALT */
+
+#if defined(MBEDTLS_ECP_ADD_MIXED_ALT)
+/*
+ * Same formulas, special cases and variable names as ecp_add_mixed()
+ */
+int mbedtls_internal_ecp_add_mixed( const mbedtls_ecp_group *grp,
+        mbedtls_ecp_point *R, const mbedtls_ecp_point *P,
+        const mbedtls_ecp_point *Q )
+{
+    int ret;
+    p256_fe PX, PY, PZ, QX, QY, T1, T2, T3, T4;
+
+    (void) grp;
+
+    /*
+     * Trivial cases: P == 0 or Q == 0 (case 1)
+     */
+    if( mbedtls_mpi_cmp_int( &P->Z, 0 ) == 0 )
+        return( mbedtls_ecp_copy( R, Q ) );
+
+    if( Q->Z.p != NULL && mbedtls_mpi_cmp_int( &Q->Z, 0 ) == 0 )
+        return( mbedtls_ecp_copy( R, P ) );
+
+    /*
+     * Make sure Q coordinates are normalized
+     */
+    if( Q->Z.p != NULL && mbedtls_mpi_cmp_int( &Q->Z, 1 ) != 0 )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    MBEDTLS_MPI_CHK( p256_from_mpi( PX, &P->X ) );
+    MBEDTLS_MPI_CHK( p256_from_mpi( PY, &P->Y ) );
+    MBEDTLS_MPI_CHK( p256_from_mpi( PZ, &P->Z ) );
+    MBEDTLS_MPI_CHK( p256_from_mpi( QX, &Q->X ) );
+    MBEDTLS_MPI_CHK( p256_from_mpi( QY, &Q->Y ) );
+
+    p256_mul( T1, PZ, PZ );
+    p256_mul( T2, T1, PZ );
+    p256_mul( T1, T1, QX );
+    p256_mul( T2, T2, QY );
+    p256_sub( T1, T1, PX );
+    p256_sub( T2, T2, PY );
+
+    /* Special cases (2) and (3) */
+    if( p256_is_zero( T1 ) )
+    {
+        if( p256_is_zero( T2 ) )
+        {
+            p256_double( PX, PY, PZ );
+
+            MBEDTLS_MPI_CHK( p256_to_mpi( &R->X, PX ) );
+            MBEDTLS_MPI_CHK( p256_to_mpi( &R->Y, PY ) );
+            MBEDTLS_MPI_CHK( p256_to_mpi( &R->Z, PZ ) );
+        }
+        else
+        {
+            ret = mbedtls_ecp_set_zero( R );
+        }
+
+        goto cleanup;
+    }
+
+    p256_mul( PZ, PZ, T1 );             /* Z */
+    p256_mul( T3, T1, T1 );
+    p256_mul( T4, T3, T1 );
+    p256_mul( T3, T3, PX );
+    p256_add( T1, T3, T3 );
+    p256_mul( QX, T2, T2 );             /* X */
+    p256_sub( QX, QX, T1 );
+    p256_sub( QX, QX, T4 );
+    p256_sub( T3, T3, QX );
+    p256_mul( T3, T3, T2 );
+    p256_mul( T4, T4, PY );
+    p256_sub( QY, T3, T4 );             /* Y */
+
+    MBEDTLS_MPI_CHK( p256_to_mpi( &R->X, QX ) );
+    MBEDTLS_MPI_CHK( p256_to_mpi( &R->Y, QY ) );
+    MBEDTLS_MPI_CHK( p256_to_mpi( &R->Z, PZ ) );
+
+cleanup:
+    mbedtls_zeroize( PX, sizeof( PX ) ); mbedtls_zeroize( PY, sizeof( PY ) );
+    mbedtls_zeroize( PZ, sizeof( PZ ) ); mbedtls_zeroize( QX, sizeof( QX ) );
+    mbedtls_zeroize( QY, sizeof( QY ) ); mbedtls_zeroize( T1, sizeof( T1 ) );
+    mbedtls_zeroize( T2, sizeof( T2 ) ); mbedtls_zeroize( T3, sizeof( T3 ) );
+    mbedtls_zeroize( T4, sizeof( T4 ) );
+
+    return( ret );
+}
+#endif /* MBEDTLS_ECP_ADD_MIXED_ALT */
+
+#if defined(MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT) || \
+    defined(MBEDTLS_ECP_NORMALIZE_JAC_ALT)
+/*
+ * X = X / Z^2, Y = Y / Z^3 given Zi = 1 / Z
+ */
+static int p256_normalize_one( mbedtls_ecp_point *pt, const p256_fe Zi )
+{
+    int ret;
+    p256_fe X, Y, ZZi;
+
+    MBEDTLS_MPI_CHK( p256_from_mpi( X, &pt->X ) );
+    MBEDTLS_MPI_CHK( p256_from_mpi( Y, &pt->Y ) );
+
+    p256_mul( ZZi, Zi, Zi );
+    p256_mul( X, X, ZZi );
+    p256_mul( Y, Y, ZZi );
+    p256_mul( Y, Y, Zi );
+
+    MBEDTLS_MPI_CHK( p256_to_mpi( &pt->X, X ) );
+    MBEDTLS_MPI_CHK( p256_to_mpi( &pt->Y, Y ) );
+
+cleanup:
+    mbedtls_zeroize( X, sizeof( X ) ); mbedtls_zeroize( Y, sizeof( Y ) );
+    mbedtls_zeroize( ZZi, sizeof( ZZi ) );
+
+    return( ret );
+}
+#endif /* MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT || MBEDTLS_ECP_NORMALIZE_JAC_ALT */
+
+#if defined(MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT)
+/*
+ * Montgomery's trick as in ecp_normalize_jac_many(), with the partial
+ * products on the stack: points are processed in groups of P256_NORM_MAX,
+ * with one inversion per group.
+ */
+int mbedtls_internal_ecp_normalize_jac_many( const mbedtls_ecp_group *grp,
+        mbedtls_ecp_point *T[], size_t t_len )
+{
+    int ret = 0;
+    size_t i, n;
+    p256_fe c[P256_NORM_MAX], u, Zi, Z;
+
+    for( ; t_len > 0; T += n, t_len -= n )
+    {
+        n = t_len < P256_NORM_MAX ? t_len : P256_NORM_MAX;
+
+        /*
+         * c[i] = Z_0 * ... * Z_i
+         */
+        MBEDTLS_MPI_CHK( p256_from_mpi( c[0], &T[0]->Z ) );
+        for( i = 1; i < n; i++ )
+        {
+            MBEDTLS_MPI_CHK( p256_from_mpi( Z, &T[i]->Z ) );
+            p256_mul( c[i], c[i-1], Z );
+        }
+
+        /* One of the points is zero: fail like mbedtls_mpi_inv_mod() */
+        if( p256_is_zero( c[n-1] ) )
+        {
+            ret = MBEDTLS_ERR_MPI_NOT_ACCEPTABLE;
+            goto cleanup;
+        }
+
+        /*
+         * u = 1 / (Z_0 * ... * Z_n) mod P
+         */
+        p256_inv( u, c[n-1] );
+
+        for( i = n - 1; ; i-- )
+        {
+            /*
+             * Zi = 1 / Z_i mod p
+             * u = 1 / (Z_0 * ... * Z_i) mod P
+             */
+            if( i == 0 )
+            {
+                memcpy( Zi, u, sizeof( p256_fe ) );
+            }
+            else
+            {
+                MBEDTLS_MPI_CHK( p256_from_mpi( Z, &T[i]->Z ) );
+                p256_mul( Zi, u, c[i-1] );
+                p256_mul( u, u, Z );
+            }
+
+            MBEDTLS_MPI_CHK( p256_normalize_one( T[i], Zi ) );
+
+            /*
+             * Post-processing as in ecp_normalize_jac_many(): keep the
+             * coordinates at the size of P and don't store Z (always 1)
+             */
+            MBEDTLS_MPI_CHK( mbedtls_mpi_shrink( &T[i]->X, grp->P.n ) );
+            MBEDTLS_MPI_CHK( mbedtls_mpi_shrink( &T[i]->Y, grp->P.n ) );
+            mbedtls_mpi_free( &T[i]->Z );
+
+            if( i == 0 )
+                break;
+        }
+    }
+
+cleanup:
+    mbedtls_zeroize( c, sizeof( c ) ); mbedtls_zeroize( u, sizeof( u ) );
+    mbedtls_zeroize( Zi, sizeof( Zi ) ); mbedtls_zeroize( Z, sizeof( Z ) );
+
+    return( ret );
+}
+#endif /* MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT */
+
+#if defined(MBEDTLS_ECP_NORMALIZE_JAC_ALT)
+int mbedtls_internal_ecp_normalize_jac( const mbedtls_ecp_group *grp,
+        mbedtls_ecp_point *pt )
+{
+    int ret;
+    p256_fe Z, Zi;
+
+    (void) grp;
+
+    MBEDTLS_MPI_CHK( p256_from_mpi( Z, &pt->Z ) );
+    p256_inv( Zi, Z );
+
+    MBEDTLS_MPI_CHK( p256_normalize_one( pt, Zi ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &pt->Z, 1 ) );
+
+cleanup:
+    mbedtls_zeroize( Z, sizeof( Z ) ); mbedtls_zeroize( Zi, sizeof( Zi ) );
+
+    return( ret );
+}
+#endif /* MBEDTLS_ECP_NORMALIZE_JAC_ALT */
+
+#endif /* MBEDTLS_ECP_P256_C */
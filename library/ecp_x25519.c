@@ -0,0 +1,465 @@
+/*
+ *  Native X25519 scalar multiplication for Curve25519
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+
+/*
+ * References:
+ *
+ * RFC 7748 "Elliptic Curves for Security", section 5
+ * D. J. Bernstein, "Curve25519: new Diffie-Hellman speed records", 2006
+ *
+ * Field elements modulo p = 2^255 - 19 are held in five 51-bit limbs on the
+ * stack. Limbs are allowed to grow a few bits past 51 between operations and
+ * are only brought to the canonical representation when encoding, so the
+ * ladder never branches or indexes memory on secret data.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_ECP_C)
+
+#include "ecp_x25519.h"
+
+#if defined(MBEDTLS_ECP_X25519_NATIVE)
+
+#include <string.h>
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize( void *v, size_t n ) {
+    volatile unsigned char *p = v; while( n-- ) *p++ = 0;
+}
+
+#define X25519_MASK51   ( ( (uint64_t) 1 << 51 ) - 1 )
+
+typedef uint64_t x25519_fe[5];
+
+/*
+ * Read a little-endian 256-bit integer, reduced modulo p only as far as
+ * folding bit 255 back in (2^255 = 19 mod p)
+ */
+static uint64_t x25519_load64( const unsigned char *s )
+{
+    return( (uint64_t) s[0]       | (uint64_t) s[1] <<  8 |
+            (uint64_t) s[2] << 16 | (uint64_t) s[3] << 24 |
+            (uint64_t) s[4] << 32 | (uint64_t) s[5] << 40 |
+            (uint64_t) s[6] << 48 | (uint64_t) s[7] << 56 );
+}
+
+static void x25519_fe_frombytes( x25519_fe h, const unsigned char s[32] )
+{
+    h[0] =   x25519_load64( s      )         & X25519_MASK51;
+    h[1] = ( x25519_load64( s +  6 ) >>  3 ) & X25519_MASK51;
+    h[2] = ( x25519_load64( s + 12 ) >>  6 ) & X25519_MASK51;
+    h[3] = ( x25519_load64( s + 19 ) >>  1 ) & X25519_MASK51;
+    h[4] = ( x25519_load64( s + 24 ) >> 12 ) & X25519_MASK51;
+    h[0] += 19 * (uint64_t)( s[31] >> 7 );
+}
+
+/*
+ * Propagate carries so that every limb fits in 51 bits, folding the carry
+ * out of the top limb back into the bottom one
+ */
+static void x25519_fe_carry( x25519_fe h )
+{
+    h[1] += h[0] >> 51; h[0] &= X25519_MASK51;
+    h[2] += h[1] >> 51; h[1] &= X25519_MASK51;
+    h[3] += h[2] >> 51; h[2] &= X25519_MASK51;
+    h[4] += h[3] >> 51; h[3] &= X25519_MASK51;
+    h[0] += 19 * ( h[4] >> 51 ); h[4] &= X25519_MASK51;
+}
+
+/*
+ * Write the canonical representative of h, little-endian
+ */
+static void x25519_fe_tobytes( unsigned char s[32], const x25519_fe f )
+{
+    x25519_fe h;
+    uint64_t w;
+    size_t i;
+
+    memcpy( h, f, sizeof( x25519_fe ) );
+
+    /* Two passes bring h below 2^255 with every limb carried */
+    x25519_fe_carry( h );
+    x25519_fe_carry( h );
+
+    /* Offset h by 19, which wraps around exactly when h >= p, so that the
+     * result is h + 19 or h - p + 19 */
+    h[0] += 19;
+    x25519_fe_carry( h );
+
+    /* Subtract 19 again by adding 2^255 - 19 and dropping bit 255 */
+    h[0] += X25519_MASK51 + 1 - 19;
+    h[1] += X25519_MASK51;
+    h[2] += X25519_MASK51;
+    h[3] += X25519_MASK51;
+    h[4] += X25519_MASK51;
+
+    h[1] += h[0] >> 51; h[0] &= X25519_MASK51;
+    h[2] += h[1] >> 51; h[1] &= X25519_MASK51;
+    h[3] += h[2] >> 51; h[2] &= X25519_MASK51;
+    h[4] += h[3] >> 51; h[3] &= X25519_MASK51;
+    h[4] &= X25519_MASK51;
+
+    w = h[0] | h[1] << 51;
+    for( i = 0; i < 8; i++ )
+        s[i] = (unsigned char)( w >> ( 8 * i ) );
+    w = h[1] >> 13 | h[2] << 38;
+    for( i = 0; i < 8; i++ )
+        s[i + 8] = (unsigned char)( w >> ( 8 * i ) );
+    w = h[2] >> 26 | h[3] << 25;
+    for( i = 0; i < 8; i++ )
+        s[i + 16] = (unsigned char)( w >> ( 8 * i ) );
+    w = h[3] >> 39 | h[4] << 12;
+    for( i = 0; i < 8; i++ )
+        s[i + 24] = (unsigned char)( w >> ( 8 * i ) );
+
+    mbedtls_zeroize( h, sizeof( h ) );
+}
+
+static void x25519_fe_copy( x25519_fe h, const x25519_fe f )
+{
+    memcpy( h, f, sizeof( x25519_fe ) );
+}
+
+/*
+ * h = f + g, without carrying
+ */
+static void x25519_fe_add( x25519_fe h, const x25519_fe f, const x25519_fe g )
+{
+    h[0] = f[0] + g[0];
+    h[1] = f[1] + g[1];
+    h[2] = f[2] + g[2];
+    h[3] = f[3] + g[3];
+    h[4] = f[4] + g[4];
+}
+
+/*
+ * h = f - g, computed as f + 2p - g so that no limb goes negative, which
+ * requires the limbs of g to be carried (at most 51 bits and a little)
+ */
+static void x25519_fe_sub( x25519_fe h, const x25519_fe f, const x25519_fe g )
+{
+    h[0] = ( f[0] + 0xFFFFFFFFFFFDAULL ) - g[0];
+    h[1] = ( f[1] + 0xFFFFFFFFFFFFEULL ) - g[1];
+    h[2] = ( f[2] + 0xFFFFFFFFFFFFEULL ) - g[2];
+    h[3] = ( f[3] + 0xFFFFFFFFFFFFEULL ) - g[3];
+    h[4] = ( f[4] + 0xFFFFFFFFFFFFEULL ) - g[4];
+}
+
+/*
+ * Carry the 128-bit column sums of a product into h
+ */
+static void x25519_fe_carry_wide( x25519_fe h, mbedtls_t_udbl t0,
+                                  mbedtls_t_udbl t1, mbedtls_t_udbl t2,
+                                  mbedtls_t_udbl t3, mbedtls_t_udbl t4 )
+{
+    uint64_t c;
+
+    t1 += (uint64_t)( t0 >> 51 ); h[0] = (uint64_t) t0 & X25519_MASK51;
+    t2 += (uint64_t)( t1 >> 51 ); h[1] = (uint64_t) t1 & X25519_MASK51;
+    t3 += (uint64_t)( t2 >> 51 ); h[2] = (uint64_t) t2 & X25519_MASK51;
+    t4 += (uint64_t)( t3 >> 51 ); h[3] = (uint64_t) t3 & X25519_MASK51;
+    c = (uint64_t)( t4 >> 51 );   h[4] = (uint64_t) t4 & X25519_MASK51;
+
+    h[0] += c * 19;
+    h[1] += h[0] >> 51; h[0] &= X25519_MASK51;
+}
+
+#define MUL( a, b )     ( (mbedtls_t_udbl)( a ) * ( b ) )
+
+/*
+ * h = f * g, with limbs of f and g up to 54 bits
+ */
+static void x25519_fe_mul( x25519_fe h, const x25519_fe f, const x25519_fe g )
+{
+    uint64_t g1_19 = 19 * g[1], g2_19 = 19 * g[2];
+    uint64_t g3_19 = 19 * g[3], g4_19 = 19 * g[4];
+
+    x25519_fe_carry_wide( h,
+        MUL( f[0], g[0] ) + MUL( f[1], g4_19 ) + MUL( f[2], g3_19 ) +
+            MUL( f[3], g2_19 ) + MUL( f[4], g1_19 ),
+        MUL( f[0], g[1] ) + MUL( f[1], g[0] ) + MUL( f[2], g4_19 ) +
+            MUL( f[3], g3_19 ) + MUL( f[4], g2_19 ),
+        MUL( f[0], g[2] ) + MUL( f[1], g[1] ) + MUL( f[2], g[0] ) +
+            MUL( f[3], g4_19 ) + MUL( f[4], g3_19 ),
+        MUL( f[0], g[3] ) + MUL( f[1], g[2] ) + MUL( f[2], g[1] ) +
+            MUL( f[3], g[0] ) + MUL( f[4], g4_19 ),
+        MUL( f[0], g[4] ) + MUL( f[1], g[3] ) + MUL( f[2], g[2] ) +
+            MUL( f[3], g[1] ) + MUL( f[4], g[0] ) );
+}
+
+/*
+ * h = f^2, with limbs of f up to 54 bits
+ */
+static void x25519_fe_sqr( x25519_fe h, const x25519_fe f )
+{
+    uint64_t f0_2 = 2 * f[0], f1_2 = 2 * f[1];
+    uint64_t f1_38 = 38 * f[1], f2_38 = 38 * f[2], f3_38 = 38 * f[3];
+    uint64_t f3_19 = 19 * f[3], f4_19 = 19 * f[4];
+
+    x25519_fe_carry_wide( h,
+        MUL( f[0], f[0] ) + MUL( f1_38, f[4] ) + MUL( f2_38, f[3] ),
+        MUL( f0_2, f[1] ) + MUL( f2_38, f[4] ) + MUL( f3_19, f[3] ),
+        MUL( f0_2, f[2] ) + MUL( f[1], f[1] ) + MUL( f3_38, f[4] ),
+        MUL( f0_2, f[3] ) + MUL( f1_2, f[2] ) + MUL( f4_19, f[4] ),
+        MUL( f0_2, f[4] ) + MUL( f1_2, f[3] ) + MUL( f[2], f[2] ) );
+}
+
+/*
+ * h = f * 121665, the constant (A - 2) / 4 of RFC 7748
+ */
+static void x25519_fe_mul_a24( x25519_fe h, const x25519_fe f )
+{
+    x25519_fe_carry_wide( h, MUL( f[0], 121665 ), MUL( f[1], 121665 ),
+                             MUL( f[2], 121665 ), MUL( f[3], 121665 ),
+                             MUL( f[4], 121665 ) );
+}
+
+#undef MUL
+
+static void x25519_fe_sqr_n( x25519_fe h, const x25519_fe f, int n )
+{
+    x25519_fe_sqr( h, f );
+    while( --n > 0 )
+        x25519_fe_sqr( h, h );
+}
+
+/*
+ * h = f^(p - 2) = 1 / f, or 0 if f = 0
+ */
+static void x25519_fe_inv( x25519_fe h, const x25519_fe f )
+{
+    x25519_fe z2, z9, z11, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+
+    x25519_fe_sqr( z2, f );                     /* 2 */
+    x25519_fe_sqr_n( t, z2, 2 );                /* 8 */
+    x25519_fe_mul( z9, t, f );                  /* 9 */
+    x25519_fe_mul( z11, z9, z2 );               /* 11 */
+    x25519_fe_sqr( t, z11 );                    /* 22 */
+    x25519_fe_mul( z2_5_0, t, z9 );             /* 2^5 - 2^0 */
+    x25519_fe_sqr_n( t, z2_5_0, 5 );
+    x25519_fe_mul( z2_10_0, t, z2_5_0 );        /* 2^10 - 2^0 */
+    x25519_fe_sqr_n( t, z2_10_0, 10 );
+    x25519_fe_mul( z2_20_0, t, z2_10_0 );       /* 2^20 - 2^0 */
+    x25519_fe_sqr_n( t, z2_20_0, 20 );
+    x25519_fe_mul( t, t, z2_20_0 );             /* 2^40 - 2^0 */
+    x25519_fe_sqr_n( t, t, 10 );
+    x25519_fe_mul( z2_50_0, t, z2_10_0 );       /* 2^50 - 2^0 */
+    x25519_fe_sqr_n( t, z2_50_0, 50 );
+    x25519_fe_mul( z2_100_0, t, z2_50_0 );      /* 2^100 - 2^0 */
+    x25519_fe_sqr_n( t, z2_100_0, 100 );
+    x25519_fe_mul( t, t, z2_100_0 );            /* 2^200 - 2^0 */
+    x25519_fe_sqr_n( t, t, 50 );
+    x25519_fe_mul( t, t, z2_50_0 );             /* 2^250 - 2^0 */
+    x25519_fe_sqr_n( t, t, 5 );
+    x25519_fe_mul( h, t, z11 );                 /* 2^255 - 21 */
+
+    mbedtls_zeroize( z2, sizeof( z2 ) );
+    mbedtls_zeroize( z9, sizeof( z9 ) );
+    mbedtls_zeroize( z11, sizeof( z11 ) );
+    mbedtls_zeroize( z2_5_0, sizeof( z2_5_0 ) );
+    mbedtls_zeroize( z2_10_0, sizeof( z2_10_0 ) );
+    mbedtls_zeroize( z2_20_0, sizeof( z2_20_0 ) );
+    mbedtls_zeroize( z2_50_0, sizeof( z2_50_0 ) );
+    mbedtls_zeroize( z2_100_0, sizeof( z2_100_0 ) );
+    mbedtls_zeroize( t, sizeof( t ) );
+}
+
+/*
+ * Swap f and g if swap is 1, leave them alone if it is 0, without branches
+ */
+static void x25519_fe_cswap( x25519_fe f, x25519_fe g, uint64_t swap )
+{
+    uint64_t mask = (uint64_t) 0 - swap, t;
+    size_t i;
+
+    for( i = 0; i < 5; i++ )
+    {
+        t = mask & ( f[i] ^ g[i] );
+        f[i] ^= t;
+        g[i] ^= t;
+    }
+}
+
+/*
+ * Generate l such that 1 < l < p
+ */
+static int x25519_random_fe( x25519_fe l,
+                             int (*f_rng)(void *, unsigned char *, size_t),
+                             void *p_rng )
+{
+    int ret = 0;
+    int count = 0;
+    size_t i;
+    unsigned char buf[32], chk[32], acc;
+
+    do
+    {
+        if( count++ > 10 )
+        {
+            ret = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+            break;
+        }
+
+        MBEDTLS_MPI_CHK( f_rng( p_rng, buf, sizeof( buf ) ) );
+        buf[31] &= 0x7F;
+
+        /* Values >= p do not survive a round trip through the field */
+        x25519_fe_frombytes( l, buf );
+        x25519_fe_tobytes( chk, l );
+
+        acc = 0;
+        for( i = 1; i < 32; i++ )
+            acc |= buf[i];
+    }
+    while( memcmp( buf, chk, sizeof( buf ) ) != 0 ||
+           ( acc == 0 && buf[0] <= 1 ) );
+
+cleanup:
+    mbedtls_zeroize( buf, sizeof( buf ) );
+    mbedtls_zeroize( chk, sizeof( chk ) );
+
+    return( ret );
+}
+
+/*
+ * Multiplication R = m * P, see RFC 7748 section 5 for the ladder
+ */
+int mbedtls_ecp_x25519_mul( mbedtls_ecp_point *R, const mbedtls_mpi *m,
+                            const mbedtls_ecp_point *P,
+                            int (*f_rng)(void *, unsigned char *, size_t),
+                            void *p_rng )
+{
+    int ret;
+    int i;
+    unsigned char k[32], buf[32], acc;
+    uint64_t swap, bit;
+    x25519_fe x1, x2, z2, x3, z3;
+    x25519_fe a, aa, b, bb, e, c, d, da, cb;
+
+    /* Scalar and input coordinate, little-endian. Both fit in 32 bytes as
+     * mbedtls_ecp_check_privkey() and mbedtls_ecp_check_pubkey() passed. */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_write_binary( m, buf, sizeof( buf ) ) );
+    for( i = 0; i < 32; i++ )
+        k[i] = buf[31 - i];
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_write_binary( &P->X, buf, sizeof( buf ) ) );
+    for( i = 0; i < 16; i++ )
+    {
+        acc = buf[i]; buf[i] = buf[31 - i]; buf[31 - i] = acc;
+    }
+    x25519_fe_frombytes( x1, buf );
+
+    /* R = zero and RP = P in x/z coordinates */
+    memset( x2, 0, sizeof( x2 ) ); x2[0] = 1;
+    memset( z2, 0, sizeof( z2 ) );
+    x25519_fe_copy( x3, x1 );
+    memset( z3, 0, sizeof( z3 ) ); z3[0] = 1;
+
+    /* Randomize coordinates of the starting point */
+    if( f_rng != NULL )
+    {
+        MBEDTLS_MPI_CHK( x25519_random_fe( z3, f_rng, p_rng ) );
+        x25519_fe_mul( x3, x1, z3 );
+    }
+
+    /* Loop invariant: R = result so far, RP = R + P, with R and RP swapped
+     * whenever swap is set */
+    swap = 0;
+    for( i = 254; i >= 0; i-- )
+    {
+        bit = ( k[i >> 3] >> ( i & 7 ) ) & 1;
+        swap ^= bit;
+        x25519_fe_cswap( x2, x3, swap );
+        x25519_fe_cswap( z2, z3, swap );
+        swap = bit;
+
+        x25519_fe_add( a, x2, z2 );
+        x25519_fe_sqr( aa, a );
+        x25519_fe_sub( b, x2, z2 );
+        x25519_fe_sqr( bb, b );
+        x25519_fe_sub( e, aa, bb );
+        x25519_fe_add( c, x3, z3 );
+        x25519_fe_sub( d, x3, z3 );
+        x25519_fe_mul( da, d, a );
+        x25519_fe_mul( cb, c, b );
+
+        x25519_fe_add( x3, da, cb );
+        x25519_fe_sqr( x3, x3 );
+        x25519_fe_sub( z3, da, cb );
+        x25519_fe_sqr( z3, z3 );
+        x25519_fe_mul( z3, z3, x1 );
+        x25519_fe_mul( x2, aa, bb );
+        x25519_fe_mul_a24( z2, e );
+        x25519_fe_add( z2, z2, aa );
+        x25519_fe_mul( z2, z2, e );
+    }
+    x25519_fe_cswap( x2, x3, swap );
+    x25519_fe_cswap( z2, z3, swap );
+
+    /* Like the generic ladder, refuse to normalize the point at infinity */
+    x25519_fe_tobytes( buf, z2 );
+    acc = 0;
+    for( i = 0; i < 32; i++ )
+        acc |= buf[i];
+    if( acc == 0 )
+    {
+        ret = MBEDTLS_ERR_MPI_NOT_ACCEPTABLE;
+        goto cleanup;
+    }
+
+    x25519_fe_inv( z2, z2 );
+    x25519_fe_mul( x2, x2, z2 );
+    x25519_fe_tobytes( k, x2 );
+    for( i = 0; i < 32; i++ )
+        buf[i] = k[31 - i];
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_read_binary( &R->X, buf, sizeof( buf ) ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &R->Z, 1 ) );
+    mbedtls_mpi_free( &R->Y );
+
+cleanup:
+    mbedtls_zeroize( k, sizeof( k ) );
+    mbedtls_zeroize( buf, sizeof( buf ) );
+    mbedtls_zeroize( x2, sizeof( x2 ) );
+    mbedtls_zeroize( z2, sizeof( z2 ) );
+    mbedtls_zeroize( x3, sizeof( x3 ) );
+    mbedtls_zeroize( z3, sizeof( z3 ) );
+    mbedtls_zeroize( a, sizeof( a ) );
+    mbedtls_zeroize( aa, sizeof( aa ) );
+    mbedtls_zeroize( b, sizeof( b ) );
+    mbedtls_zeroize( bb, sizeof( bb ) );
+    mbedtls_zeroize( e, sizeof( e ) );
+    mbedtls_zeroize( c, sizeof( c ) );
+    mbedtls_zeroize( d, sizeof( d ) );
+    mbedtls_zeroize( da, sizeof( da ) );
+    mbedtls_zeroize( cb, sizeof( cb ) );
+
+    return( ret );
+}
+
+#endif /* MBEDTLS_ECP_X25519_NATIVE */
+
+#endif /* MBEDTLS_ECP_C */
@@ -0,0 +1,91 @@
+/**
+ * \file ecp_x25519.h
+ *
+ * \brief Internal native X25519 scalar multiplication, used by ecp.c
+ *
+ * \note  This header is private to the library and is not installed.
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_ECP_X25519_H
+#define MBEDTLS_ECP_X25519_H
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "mbedtls/ecp.h"
+
+/*
+ * The native implementation works on 51-bit limbs and needs a 64x64->128 bit
+ * multiplication; other platforms keep using the generic ladder of ecp.c.
+ */
+#if !defined(MBEDTLS_ECP_ALT)                   &&  \
+    defined(MBEDTLS_ECP_DP_CURVE25519_ENABLED)  &&  \
+    defined(MBEDTLS_HAVE_INT64)                 &&  \
+    defined(MBEDTLS_HAVE_UDBL)                  &&  \
+    !defined(MBEDTLS_ECP_DOUBLE_ADD_MXZ_ALT)    &&  \
+    !defined(MBEDTLS_ECP_RANDOMIZE_MXZ_ALT)     &&  \
+    !defined(MBEDTLS_ECP_NORMALIZE_MXZ_ALT)
+#define MBEDTLS_ECP_X25519_NATIVE
+#endif
+
+#if defined(MBEDTLS_ECP_X25519_NATIVE)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief           Multiplication R = m * P on Curve25519 with a fixed-size,
+ *                  constant-time Montgomery ladder
+ *
+ * \note            This is the X25519 function of RFC 7748, except that the
+ *                  scalar is used as given (mbedtls_ecp_check_privkey()
+ *                  already ensures it is clamped) and the input coordinate
+ *                  is reduced modulo p in full, like the generic ladder does.
+ *                  It is called by mbedtls_ecp_mul() for Curve25519, and
+ *                  expects m and P to have been checked already.
+ *
+ * \param R         Destination point, in x/z coordinates with Z = 1
+ * \param m         Scalar, smaller than 2^255
+ * \param P         Point to multiply, in x/z coordinates with Z = 1
+ * \param f_rng     RNG used to randomize the projective coordinates of the
+ *                  ladder, or NULL
+ * \param p_rng     RNG parameter
+ *
+ * \return          0 if successful,
+ *                  MBEDTLS_ERR_MPI_NOT_ACCEPTABLE if the result is the point
+ *                  at infinity (P has small order),
+ *                  MBEDTLS_ERR_ECP_RANDOM_FAILED if f_rng failed to provide
+ *                  a usable value, or MBEDTLS_ERR_MPI_XXX on memory failure.
+ */
+int mbedtls_ecp_x25519_mul( mbedtls_ecp_point *R, const mbedtls_mpi *m,
+                            const mbedtls_ecp_point *P,
+                            int (*f_rng)(void *, unsigned char *, size_t),
+                            void *p_rng );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_ECP_X25519_NATIVE */
+
+#endif /* ecp_x25519.h */
@@ -124,9 +124,13 @@ static int gcm_gen_table( mbedtls_gcm_context *ctx )
     ctx->HH[8] = vh;
 
 #if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
-    /* With CLMUL support, we need only h, not the rest of the table */
+    /* With CLMUL support, we need only h, not the rest of the table,
+     * and its first powers for the bulk path */
     if( mbedtls_aesni_has_support( MBEDTLS_AESNI_CLMUL ) )
+    {
+        mbedtls_aesni_gcm_precompute( ctx->HP, h );
         return( 0 );
+    }
 #endif
 
     /* 0 corresponds to 0 in GF(2^128) */
@@ -187,6 +191,12 @@ int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
     if( ( ret = gcm_gen_table( ctx ) ) != 0 )
         return( ret );
 
+#if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
+    ctx->aesni = ( cipher == MBEDTLS_CIPHER_ID_AES &&
+                   mbedtls_aesni_has_support( MBEDTLS_AESNI_AES ) &&
+                   mbedtls_aesni_has_support( MBEDTLS_AESNI_CLMUL ) );
+#endif
+
     return( 0 );
 }
 
@@ -370,6 +380,25 @@ int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
     ctx->len += length;
 
     p = input;
+
+#if defined(MBEDTLS_AESNI_C) && defined(MBEDTLS_HAVE_X86_64)
+    /* Whole groups of 4 blocks go through the pipelined AES-NI path */
+    if( ctx->aesni && length >= 64 )
+    {
+        use_len = length & ~( (size_t) 63 );
+
+        mbedtls_aesni_gcm_crypt( ctx->cipher_ctx.cipher_ctx,
+                                 ctx->mode == MBEDTLS_GCM_ENCRYPT ?
+                                 MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT,
+                                 use_len, ctx->y, ctx->buf, ctx->HP,
+                                 p, out_p );
+
+        length -= use_len;
+        p += use_len;
+        out_p += use_len;
+    }
+#endif /* MBEDTLS_AESNI_C && MBEDTLS_HAVE_X86_64 */
+
     while( length > 0 )
     {
         use_len = ( length < 16 ) ? length : 16;
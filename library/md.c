@@ -286,6 +286,27 @@ int mbedtls_md( const mbedtls_md_info_t *md_info, const unsigned char *input, si
     return( 0 );
 }
 
+int mbedtls_md_multi( const mbedtls_md_info_t *md_info, size_t n,
+                      const unsigned char * const input[], const size_t ilen[],
+                      unsigned char * const output[] )
+{
+    size_t i;
+
+    if( md_info == NULL )
+        return( MBEDTLS_ERR_MD_BAD_INPUT_DATA );
+
+    if( md_info->multi_func != NULL )
+    {
+        md_info->multi_func( n, input, ilen, output );
+        return( 0 );
+    }
+
+    for( i = 0; i < n; i++ )
+        md_info->digest_func( input[i], ilen[i], output[i] );
+
+    return( 0 );
+}
+
 #if defined(MBEDTLS_FS_IO)
 int mbedtls_md_file( const mbedtls_md_info_t *md_info, const char *path, unsigned char *output )
 {
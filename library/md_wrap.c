@@ -61,6 +61,10 @@
 #include "mbedtls/sha512.h"
 #endif
 
+#if defined(MBEDTLS_SHA_MB_C)
+#include "mbedtls/sha_mb.h"
+#endif
+
 #if defined(MBEDTLS_PLATFORM_C)
 #include "mbedtls/platform.h"
 #else
@@ -129,6 +133,7 @@ const mbedtls_md_info_t mbedtls_md2_info = {
     md2_ctx_free,
     md2_clone_wrap,
     md2_process_wrap,
+    NULL,
 };
 
 #endif /* MBEDTLS_MD2_C */
@@ -191,6 +196,7 @@ const mbedtls_md_info_t mbedtls_md4_info = {
     md4_ctx_free,
     md4_clone_wrap,
     md4_process_wrap,
+    NULL,
 };
 
 #endif /* MBEDTLS_MD4_C */
@@ -253,6 +259,7 @@ const mbedtls_md_info_t mbedtls_md5_info = {
     md5_ctx_free,
     md5_clone_wrap,
     md5_process_wrap,
+    NULL,
 };
 
 #endif /* MBEDTLS_MD5_C */
@@ -315,6 +322,7 @@ const mbedtls_md_info_t mbedtls_ripemd160_info = {
     ripemd160_ctx_free,
     ripemd160_clone_wrap,
     ripemd160_process_wrap,
+    NULL,
 };
 
 #endif /* MBEDTLS_RIPEMD160_C */
@@ -377,6 +385,11 @@ const mbedtls_md_info_t mbedtls_sha1_info = {
     sha1_ctx_free,
     sha1_clone_wrap,
     sha1_process_wrap,
+#if defined(MBEDTLS_SHA_MB_C)
+    mbedtls_sha1_mb,
+#else
+    NULL,
+#endif
 };
 
 #endif /* MBEDTLS_SHA1_C */
@@ -408,6 +421,14 @@ static void sha224_wrap( const unsigned char *input, size_t ilen,
     mbedtls_sha256( input, ilen, output, 1 );
 }
 
+#if defined(MBEDTLS_SHA_MB_C)
+static void sha224_mb_wrap( size_t n, const unsigned char * const input[],
+                            const size_t ilen[], unsigned char * const output[] )
+{
+    mbedtls_sha256_mb( n, input, ilen, output, 1 );
+}
+#endif
+
 static void *sha224_ctx_alloc( void )
 {
     void *ctx = mbedtls_calloc( 1, sizeof( mbedtls_sha256_context ) );
@@ -448,6 +469,11 @@ const mbedtls_md_info_t mbedtls_sha224_info = {
     sha224_ctx_free,
     sha224_clone_wrap,
     sha224_process_wrap,
+#if defined(MBEDTLS_SHA_MB_C)
+    sha224_mb_wrap,
+#else
+    NULL,
+#endif
 };
 
 static void sha256_starts_wrap( void *ctx )
@@ -461,6 +487,14 @@ static void sha256_wrap( const unsigned char *input, size_t ilen,
     mbedtls_sha256( input, ilen, output, 0 );
 }
 
+#if defined(MBEDTLS_SHA_MB_C)
+static void sha256_mb_wrap( size_t n, const unsigned char * const input[],
+                            const size_t ilen[], unsigned char * const output[] )
+{
+    mbedtls_sha256_mb( n, input, ilen, output, 0 );
+}
+#endif
+
 const mbedtls_md_info_t mbedtls_sha256_info = {
     MBEDTLS_MD_SHA256,
     "SHA256",
@@ -474,6 +508,11 @@ const mbedtls_md_info_t mbedtls_sha256_info = {
     sha224_ctx_free,
     sha224_clone_wrap,
     sha224_process_wrap,
+#if defined(MBEDTLS_SHA_MB_C)
+    sha256_mb_wrap,
+#else
+    NULL,
+#endif
 };
 
 #endif /* MBEDTLS_SHA256_C */
@@ -542,6 +581,7 @@ const mbedtls_md_info_t mbedtls_sha384_info = {
     sha384_ctx_free,
     sha384_clone_wrap,
     sha384_process_wrap,
+    NULL,
 };
 
 static void sha512_starts_wrap( void *ctx )
@@ -568,6 +608,7 @@ const mbedtls_md_info_t mbedtls_sha512_info = {
     sha384_ctx_free,
     sha384_clone_wrap,
     sha384_process_wrap,
+    NULL,
 };
 
 #endif /* MBEDTLS_SHA512_C */
@@ -71,6 +71,15 @@ static void mbedtls_zeroize( void *v, size_t n ) {
     volatile unsigned char *p = (unsigned char*)v; while( n-- ) *p++ = 0;
 }
 
+/*
+ * Temporaries take their limbs from the scratch arena of the context, if any
+ */
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+#define RSA_MPI_INIT( ctx, X )  mbedtls_mpi_init_scratch( X, (ctx)->scratch )
+#else
+#define RSA_MPI_INIT( ctx, X )  mbedtls_mpi_init( X )
+#endif
+
 /*
  * Initialize an RSA context
  */
@@ -96,6 +105,17 @@ void mbedtls_rsa_set_padding( mbedtls_rsa_context *ctx, int padding, int hash_id
     ctx->hash_id = hash_id;
 }
 
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/*
+ * Attach a scratch arena to an RSA context
+ */
+void mbedtls_rsa_set_scratch( mbedtls_rsa_context *ctx,
+                              mbedtls_mpi_scratch *scratch )
+{
+    ctx->scratch = scratch;
+}
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
 #if defined(MBEDTLS_GENPRIME)
 
 /*
@@ -282,6 +302,87 @@ int mbedtls_rsa_check_pub_priv( const mbedtls_rsa_context *pub, const mbedtls_rs
     return( 0 );
 }
 
+/*
+ * Montgomery constants of a modulus M: RR = R^2 mod M, as computed by
+ * mbedtls_mpi_exp_mod(), and mm = -M^-1 mod 2^biL, which is never 0 and
+ * only set once RR is
+ */
+static int rsa_montg_precompute( mbedtls_mpi *RR, mbedtls_mpi_uint *mm,
+                                 const mbedtls_mpi *M )
+{
+    int ret;
+    mbedtls_mpi_uint m;
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_montg_init( &m, M ) );
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_lset( RR, 1 ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_shift_l( RR,
+                                M->n * 2 * sizeof( mbedtls_mpi_uint ) * 8 ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( RR, RR, M ) );
+
+    *mm = m;
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * Precompute the constants of the key that are still missing
+ */
+static int rsa_precompute_constants( mbedtls_rsa_context *ctx )
+{
+    int ret = 0;
+
+    if( ctx->mN == 0 )
+        MBEDTLS_MPI_CHK( rsa_montg_precompute( &ctx->RN, &ctx->mN, &ctx->N ) );
+
+    if( ctx->mP == 0 && ctx->P.p != NULL )
+        MBEDTLS_MPI_CHK( rsa_montg_precompute( &ctx->RP, &ctx->mP, &ctx->P ) );
+
+    if( ctx->mQ == 0 && ctx->Q.p != NULL )
+        MBEDTLS_MPI_CHK( rsa_montg_precompute( &ctx->RQ, &ctx->mQ, &ctx->Q ) );
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * Check that the private key operations only have to read the context
+ */
+static int rsa_private_ready( const mbedtls_rsa_context *ctx )
+{
+#if defined(MBEDTLS_RSA_NO_CRT)
+    return( ctx->mN != 0 );
+#else
+    return( ctx->mN != 0 && ctx->mP != 0 && ctx->mQ != 0 );
+#endif
+}
+
+/*
+ * Precompute the Montgomery constants of an RSA key
+ */
+int mbedtls_rsa_precompute( mbedtls_rsa_context *ctx )
+{
+    int ret;
+
+#if defined(MBEDTLS_THREADING_C)
+    if( ( ret = mbedtls_mutex_lock( &ctx->mutex ) ) != 0 )
+        return( ret );
+#endif
+
+    ret = rsa_precompute_constants( ctx );
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
+        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
+#endif
+
+    if( ret != 0 )
+        return( MBEDTLS_ERR_RSA_BAD_INPUT_DATA + ret );
+
+    return( 0 );
+}
+
 /*
  * Do an RSA public key operation
  */
@@ -293,7 +394,7 @@ int mbedtls_rsa_public( mbedtls_rsa_context *ctx,
     size_t olen;
     mbedtls_mpi T;
 
-    mbedtls_mpi_init( &T );
+    RSA_MPI_INIT( ctx, &T );
 
 #if defined(MBEDTLS_THREADING_C)
     if( ( ret = mbedtls_mutex_lock( &ctx->mutex ) ) != 0 )
@@ -313,37 +414,71 @@ int mbedtls_rsa_public( mbedtls_rsa_context *ctx,
     MBEDTLS_MPI_CHK( mbedtls_mpi_write_binary( &T, output, olen ) );
 
 cleanup:
+    /* Before unlocking, as the temporaries may use the arena of ctx */
+    mbedtls_mpi_free( &T );
+
 #if defined(MBEDTLS_THREADING_C)
     if( mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
         return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
 #endif
 
-    mbedtls_mpi_free( &T );
-
     if( ret != 0 )
         return( MBEDTLS_ERR_RSA_PUBLIC_FAILED + ret );
 
     return( 0 );
 }
 
+/*
+ * Initialize blinding values
+ */
+void mbedtls_rsa_blinding_init( mbedtls_rsa_blinding *blind )
+{
+    memset( blind, 0, sizeof( mbedtls_rsa_blinding ) );
+
+    mbedtls_mpi_init( &blind->Vi );
+    mbedtls_mpi_init( &blind->Vf );
+}
+
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+/*
+ * Attach a scratch arena to blinding values
+ */
+void mbedtls_rsa_blinding_set_scratch( mbedtls_rsa_blinding *blind,
+                                       mbedtls_mpi_scratch *scratch )
+{
+    blind->scratch = scratch;
+}
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
+
+/*
+ * Free blinding values
+ */
+void mbedtls_rsa_blinding_free( mbedtls_rsa_blinding *blind )
+{
+    mbedtls_mpi_free( &blind->Vi ); mbedtls_mpi_free( &blind->Vf );
+}
+
 /*
  * Generate or update blinding values, see section 10 of:
  *  KOCHER, Paul C. Timing attacks on implementations of Diffie-Hellman, RSA,
  *  DSS, and other systems. In : Advances in Cryptology-CRYPTO'96. Springer
  *  Berlin Heidelberg, 1996. p. 104-113.
+ *
+ * T is a temporary of the caller, for the arena it uses.
  */
-static int rsa_prepare_blinding( mbedtls_rsa_context *ctx,
+static int rsa_prepare_blinding( const mbedtls_rsa_context *ctx,
+                 mbedtls_mpi *Vi, mbedtls_mpi *Vf, mbedtls_mpi *T,
                  int (*f_rng)(void *, unsigned char *, size_t), void *p_rng )
 {
     int ret, count = 0;
 
-    if( ctx->Vf.p != NULL )
+    if( Vf->p != NULL )
     {
         /* We already have blinding values, just update them by squaring */
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &ctx->Vi, &ctx->Vi, &ctx->Vi ) );
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &ctx->Vi, &ctx->Vi, &ctx->N ) );
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &ctx->Vf, &ctx->Vf, &ctx->Vf ) );
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &ctx->Vf, &ctx->Vf, &ctx->N ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( T, Vi, Vi ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( Vi, T, &ctx->N ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( T, Vf, Vf ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( Vf, T, &ctx->N ) );
 
         goto cleanup;
     }
@@ -353,14 +488,15 @@ static int rsa_prepare_blinding( mbedtls_rsa_context *ctx,
         if( count++ > 10 )
             return( MBEDTLS_ERR_RSA_RNG_FAILED );
 
-        MBEDTLS_MPI_CHK( mbedtls_mpi_fill_random( &ctx->Vf, ctx->len - 1, f_rng, p_rng ) );
-        MBEDTLS_MPI_CHK( mbedtls_mpi_gcd( &ctx->Vi, &ctx->Vf, &ctx->N ) );
-    } while( mbedtls_mpi_cmp_int( &ctx->Vi, 1 ) != 0 );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_fill_random( Vf, ctx->len - 1, f_rng, p_rng ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_gcd( Vi, Vf, &ctx->N ) );
+    } while( mbedtls_mpi_cmp_int( Vi, 1 ) != 0 );
 
     /* Blinding value: Vi =  Vf^(-e) mod N */
-    MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( &ctx->Vi, &ctx->Vf, &ctx->N ) );
-    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod( &ctx->Vi, &ctx->Vi, &ctx->E, &ctx->N, &ctx->RN ) );
-
+    MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( Vi, Vf, &ctx->N ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod_fixed( Vi, Vi, &ctx->E,
+                                                mbedtls_mpi_bitlen( &ctx->E ),
+                                                &ctx->N, ctx->mN, &ctx->RN ) );
 
 cleanup:
     return( ret );
@@ -388,13 +524,16 @@ cleanup:
 #define RSA_EXPONENT_BLINDING 28
 
 /*
- * Do an RSA private key operation
+ * Private key operation with blinding values that are already prepared if
+ * f_rng is not NULL. The constants of the key are precomputed, so that ctx
+ * is only read.
  */
-int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
-                 int (*f_rng)(void *, unsigned char *, size_t),
-                 void *p_rng,
-                 const unsigned char *input,
-                 unsigned char *output )
+static int rsa_private_core( const mbedtls_rsa_context *ctx,
+                             const mbedtls_rsa_blinding *blind,
+                             int (*f_rng)(void *, unsigned char *, size_t),
+                             void *p_rng,
+                             const unsigned char *input,
+                             unsigned char *output )
 {
     int ret;
     size_t olen;
@@ -402,35 +541,22 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
     mbedtls_mpi P1, Q1, R;
 #if defined(MBEDTLS_RSA_NO_CRT)
     mbedtls_mpi D_blind;
-    mbedtls_mpi *D = &ctx->D;
+    const mbedtls_mpi *D = &ctx->D;
+    size_t dbits = mbedtls_mpi_bitlen( &ctx->N );
 #else
     mbedtls_mpi DP_blind, DQ_blind;
-    mbedtls_mpi *DP = &ctx->DP;
-    mbedtls_mpi *DQ = &ctx->DQ;
+    const mbedtls_mpi *DP = &ctx->DP;
+    const mbedtls_mpi *DQ = &ctx->DQ;
+    size_t dpbits = mbedtls_mpi_bitlen( &ctx->P );
+    size_t dqbits = mbedtls_mpi_bitlen( &ctx->Q );
 #endif
 
-    /* Make sure we have private key info, prevent possible misuse */
-    if( ctx->P.p == NULL || ctx->Q.p == NULL || ctx->D.p == NULL )
-        return( MBEDTLS_ERR_RSA_BAD_INPUT_DATA );
-
-    mbedtls_mpi_init( &T ); mbedtls_mpi_init( &T1 ); mbedtls_mpi_init( &T2 );
-    mbedtls_mpi_init( &P1 ); mbedtls_mpi_init( &Q1 ); mbedtls_mpi_init( &R );
-
-
-    if( f_rng != NULL )
-    {
+    RSA_MPI_INIT( blind, &T ); RSA_MPI_INIT( blind, &T1 ); RSA_MPI_INIT( blind, &T2 );
+    RSA_MPI_INIT( blind, &P1 ); RSA_MPI_INIT( blind, &Q1 ); RSA_MPI_INIT( blind, &R );
 #if defined(MBEDTLS_RSA_NO_CRT)
-        mbedtls_mpi_init( &D_blind );
+    RSA_MPI_INIT( blind, &D_blind );
 #else
-        mbedtls_mpi_init( &DP_blind );
-        mbedtls_mpi_init( &DQ_blind );
-#endif
-    }
-
-
-#if defined(MBEDTLS_THREADING_C)
-    if( ( ret = mbedtls_mutex_lock( &ctx->mutex ) ) != 0 )
-        return( ret );
+    RSA_MPI_INIT( blind, &DP_blind ); RSA_MPI_INIT( blind, &DQ_blind );
 #endif
 
     MBEDTLS_MPI_CHK( mbedtls_mpi_read_binary( &T, input, ctx->len ) );
@@ -446,8 +572,7 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
          * Blinding
          * T = T * Vi mod N
          */
-        MBEDTLS_MPI_CHK( rsa_prepare_blinding( ctx, f_rng, p_rng ) );
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &T, &T, &ctx->Vi ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &T, &T, &blind->Vi ) );
         MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &T, &T, &ctx->N ) );
 
         /*
@@ -467,6 +592,7 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
         MBEDTLS_MPI_CHK( mbedtls_mpi_add_mpi( &D_blind, &D_blind, &ctx->D ) );
 
         D = &D_blind;
+        dbits += 8 * RSA_EXPONENT_BLINDING;
 #else
         /*
          * DP_blind = ( P - 1 ) * R + DP
@@ -478,6 +604,7 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
                     &ctx->DP ) );
 
         DP = &DP_blind;
+        dpbits += 8 * RSA_EXPONENT_BLINDING;
 
         /*
          * DQ_blind = ( Q - 1 ) * R + DQ
@@ -489,11 +616,17 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
                     &ctx->DQ ) );
 
         DQ = &DQ_blind;
+        dqbits += 8 * RSA_EXPONENT_BLINDING;
 #endif /* MBEDTLS_RSA_NO_CRT */
     }
 
+    /*
+     * The exponentiations process as many bits as the blinded exponents can
+     * have, so that their timing does not depend on the exponents
+     */
 #if defined(MBEDTLS_RSA_NO_CRT)
-    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod( &T, &T, D, &ctx->N, &ctx->RN ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod_fixed( &T, &T, D, dbits,
+                                                &ctx->N, ctx->mN, &ctx->RN ) );
 #else
     /*
      * Faster decryption using the CRT
@@ -501,8 +634,10 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
      * T1 = input ^ dP mod P
      * T2 = input ^ dQ mod Q
      */
-    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod( &T1, &T, DP, &ctx->P, &ctx->RP ) );
-    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod( &T2, &T, DQ, &ctx->Q, &ctx->RQ ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod_fixed( &T1, &T, DP, dpbits,
+                                                &ctx->P, ctx->mP, &ctx->RP ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_exp_mod_fixed( &T2, &T, DQ, dqbits,
+                                                &ctx->Q, ctx->mQ, &ctx->RQ ) );
 
     /*
      * T = (T1 - T2) * (Q^-1 mod P) mod P
@@ -524,7 +659,7 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
          * Unblind
          * T = T * Vf mod N
          */
-        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &T, &T, &ctx->Vf ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &T, &T, &blind->Vf ) );
         MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &T, &T, &ctx->N ) );
     }
 
@@ -532,23 +667,126 @@ int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
     MBEDTLS_MPI_CHK( mbedtls_mpi_write_binary( &T, output, olen ) );
 
 cleanup:
+    mbedtls_mpi_free( &T ); mbedtls_mpi_free( &T1 ); mbedtls_mpi_free( &T2 );
+    mbedtls_mpi_free( &P1 ); mbedtls_mpi_free( &Q1 ); mbedtls_mpi_free( &R );
+#if defined(MBEDTLS_RSA_NO_CRT)
+    mbedtls_mpi_free( &D_blind );
+#else
+    mbedtls_mpi_free( &DP_blind ); mbedtls_mpi_free( &DQ_blind );
+#endif
+
+    return( ret );
+}
+
+/*
+ * Do an RSA private key operation
+ */
+int mbedtls_rsa_private( mbedtls_rsa_context *ctx,
+                 int (*f_rng)(void *, unsigned char *, size_t),
+                 void *p_rng,
+                 const unsigned char *input,
+                 unsigned char *output )
+{
+    int ret;
+    mbedtls_mpi T;
+    mbedtls_rsa_blinding blind;
 #if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
-        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
+    int locked = 1;
 #endif
 
-    mbedtls_mpi_free( &T ); mbedtls_mpi_free( &T1 ); mbedtls_mpi_free( &T2 );
-    mbedtls_mpi_free( &P1 ); mbedtls_mpi_free( &Q1 ); mbedtls_mpi_free( &R );
+    /* Make sure we have private key info, prevent possible misuse */
+    if( ctx->P.p == NULL || ctx->Q.p == NULL || ctx->D.p == NULL )
+        return( MBEDTLS_ERR_RSA_BAD_INPUT_DATA );
+
+    /* The copies of the shared blinding values are temporaries as well */
+    RSA_MPI_INIT( ctx, &T );
+    RSA_MPI_INIT( ctx, &blind.Vi ); RSA_MPI_INIT( ctx, &blind.Vf );
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    blind.scratch = ctx->scratch;
+#endif
+
+#if defined(MBEDTLS_THREADING_C)
+    if( ( ret = mbedtls_mutex_lock( &ctx->mutex ) ) != 0 )
+        return( ret );
+#endif
+
+    MBEDTLS_MPI_CHK( rsa_precompute_constants( ctx ) );
 
     if( f_rng != NULL )
     {
-#if defined(MBEDTLS_RSA_NO_CRT)
-        mbedtls_mpi_free( &D_blind );
-#else
-        mbedtls_mpi_free( &DP_blind );
-        mbedtls_mpi_free( &DQ_blind );
+        MBEDTLS_MPI_CHK( rsa_prepare_blinding( ctx, &ctx->Vi, &ctx->Vf, &T,
+                                               f_rng, p_rng ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &blind.Vi, &ctx->Vi ) );
+        MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &blind.Vf, &ctx->Vf ) );
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    /*
+     * The operation itself only reads ctx and runs without the mutex,
+     * unless its temporaries use the arena of ctx
+     */
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    if( ctx->scratch == NULL )
 #endif
+    {
+        locked = 0;
+
+        if( mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
+        {
+            ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+            goto cleanup;
+        }
     }
+#endif /* MBEDTLS_THREADING_C */
+
+    MBEDTLS_MPI_CHK( rsa_private_core( ctx, &blind, f_rng, p_rng,
+                                       input, output ) );
+
+cleanup:
+    /* Before unlocking, as the temporaries may use the arena of ctx */
+    mbedtls_mpi_free( &T );
+    mbedtls_rsa_blinding_free( &blind );
+
+#if defined(MBEDTLS_THREADING_C)
+    if( locked && mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
+        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
+
+    if( ret == MBEDTLS_ERR_THREADING_MUTEX_ERROR )
+        return( ret );
+#endif
+
+    if( ret != 0 )
+        return( MBEDTLS_ERR_RSA_PRIVATE_FAILED + ret );
+
+    return( 0 );
+}
+
+/*
+ * Do an RSA private key operation with the blinding values of the thread
+ */
+int mbedtls_rsa_private_blinded( const mbedtls_rsa_context *ctx,
+                                 mbedtls_rsa_blinding *blind,
+                                 int (*f_rng)(void *, unsigned char *, size_t),
+                                 void *p_rng,
+                                 const unsigned char *input,
+                                 unsigned char *output )
+{
+    int ret;
+    mbedtls_mpi T;
+
+    if( ctx->P.p == NULL || ctx->Q.p == NULL || ctx->D.p == NULL ||
+        f_rng == NULL || ! rsa_private_ready( ctx ) )
+        return( MBEDTLS_ERR_RSA_BAD_INPUT_DATA );
+
+    RSA_MPI_INIT( blind, &T );
+
+    MBEDTLS_MPI_CHK( rsa_prepare_blinding( ctx, &blind->Vi, &blind->Vf, &T,
+                                           f_rng, p_rng ) );
+    MBEDTLS_MPI_CHK( rsa_private_core( ctx, blind, f_rng, p_rng,
+                                       input, output ) );
+
+cleanup:
+    mbedtls_mpi_free( &T );
 
     if( ret != 0 )
         return( MBEDTLS_ERR_RSA_PRIVATE_FAILED + ret );
@@ -1625,6 +1863,9 @@ int mbedtls_rsa_copy( mbedtls_rsa_context *dst, const mbedtls_rsa_context *src )
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &dst->RN, &src->RN ) );
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &dst->RP, &src->RP ) );
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &dst->RQ, &src->RQ ) );
+    dst->mN = src->mN;
+    dst->mP = src->mP;
+    dst->mQ = src->mQ;
 
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &dst->Vi, &src->Vi ) );
     MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &dst->Vf, &src->Vf ) );
@@ -1649,6 +1890,7 @@ void mbedtls_rsa_free( mbedtls_rsa_context *ctx )
     mbedtls_mpi_free( &ctx->QP ); mbedtls_mpi_free( &ctx->DQ ); mbedtls_mpi_free( &ctx->DP );
     mbedtls_mpi_free( &ctx->Q  ); mbedtls_mpi_free( &ctx->P  ); mbedtls_mpi_free( &ctx->D );
     mbedtls_mpi_free( &ctx->E  ); mbedtls_mpi_free( &ctx->N  );
+    ctx->mN = ctx->mP = ctx->mQ = 0;
 
 #if defined(MBEDTLS_THREADING_C)
     mbedtls_mutex_free( &ctx->mutex );
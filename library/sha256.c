@@ -36,6 +36,10 @@
 
 #include <string.h>
 
+#if defined(MBEDTLS_SHANI_C)
+#include "mbedtls/shani.h"
+#endif
+
 #if defined(MBEDTLS_SELF_TEST)
 #if defined(MBEDTLS_PLATFORM_C)
 #include "mbedtls/platform.h"
@@ -185,6 +189,14 @@ void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char da
     uint32_t A[8];
     unsigned int i;
 
+#if defined(MBEDTLS_SHANI_C) && defined(MBEDTLS_HAVE_X86_64)
+    if( mbedtls_shani_has_support( MBEDTLS_SHANI_SHA ) )
+    {
+        mbedtls_shani_sha256_process( ctx->state, data );
+        return;
+    }
+#endif
+
     for( i = 0; i < 8; i++ )
         A[i] = ctx->state[i];
 
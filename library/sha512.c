@@ -42,6 +42,10 @@
 
 #include <string.h>
 
+#if defined(MBEDTLS_SHANI_C)
+#include "mbedtls/shani.h"
+#endif
+
 #if defined(MBEDTLS_SELF_TEST)
 #if defined(MBEDTLS_PLATFORM_C)
 #include "mbedtls/platform.h"
@@ -202,6 +206,14 @@ void mbedtls_sha512_process( mbedtls_sha512_context *ctx, const unsigned char da
     uint64_t temp1, temp2, W[80];
     uint64_t A, B, C, D, E, F, G, H;
 
+#if defined(MBEDTLS_SHANI_C) && defined(MBEDTLS_HAVE_X86_64)
+    if( mbedtls_shani_has_support( MBEDTLS_SHANI_AVX2 ) )
+    {
+        mbedtls_shani_sha512_process( ctx->state, data );
+        return;
+    }
+#endif
+
 #define  SHR(x,n) (x >> n)
 #define ROTR(x,n) (SHR(x,n) | (x << (64 - n)))
 
@@ -0,0 +1,536 @@
+/*
+ *  Multi-buffer SHA-1 and SHA-224/256
+ *
+ *  Copyright (C) 2006-2016, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+/*
+ *  The compression functions of SHA-1 and SHA-256 are serial within a
+ *  message but independent between messages, so N messages can be hashed
+ *  at once with each 32-bit word of the state widened to a vector of N
+ *  lanes, one lane per message. This is the multi-buffer technique of
+ *
+ *  J. Guilford, K. Yap, V. Gopal, "Fast SHA-256 Implementations on Intel
+ *  Architecture Processors", Intel, 2012.
+ *
+ *  The vectors are GCC vector extensions, which the compiler maps to SSE2
+ *  or AVX2 on x86-64 and to NEON on ARM; elsewhere the messages are hashed
+ *  one after the other with the regular functions.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_SHA_MB_C)
+
+#include "mbedtls/sha_mb.h"
+
+#if defined(MBEDTLS_SHA1_C)
+#include "mbedtls/sha1.h"
+#endif
+#if defined(MBEDTLS_SHA256_C)
+#include "mbedtls/sha256.h"
+#endif
+
+#if defined(MBEDTLS_SHANI_C)
+#include "mbedtls/shani.h"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && \
+    ( defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__) )
+#define SHA_MB_HAVE_SIMD
+/* The CPU and OS support for AVX2 is detected by shani.c */
+#if defined(MBEDTLS_SHANI_C) && defined(MBEDTLS_HAVE_X86_64)
+#define SHA_MB_HAVE_AVX2
+#endif
+#endif
+
+/*
+ * Largest number of lanes available that is not above max_lanes
+ */
+static size_t sha_mb_pick_lanes( size_t max_lanes )
+{
+#if defined(SHA_MB_HAVE_AVX2)
+    if( max_lanes >= 8 &&
+        mbedtls_shani_has_support( MBEDTLS_SHANI_AVX2 ) )
+        return( 8 );
+#endif
+#if defined(SHA_MB_HAVE_SIMD)
+    if( max_lanes >= 4 )
+        return( 4 );
+#endif
+    ((void) max_lanes);
+    return( 1 );
+}
+
+size_t mbedtls_sha_mb_lanes( void )
+{
+    return( sha_mb_pick_lanes( 8 ) );
+}
+
+#if defined(SHA_MB_HAVE_SIMD)
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize( void *v, size_t n ) {
+    volatile unsigned char *p = (unsigned char*)v; while( n-- ) *p++ = 0;
+}
+
+/*
+ * 32-bit integer manipulation macros (big endian)
+ */
+#ifndef GET_UINT32_BE
+#define GET_UINT32_BE(n,b,i)                            \
+{                                                       \
+    (n) = ( (uint32_t) (b)[(i)    ] << 24 )             \
+        | ( (uint32_t) (b)[(i) + 1] << 16 )             \
+        | ( (uint32_t) (b)[(i) + 2] <<  8 )             \
+        | ( (uint32_t) (b)[(i) + 3]       );            \
+}
+#endif
+
+#ifndef PUT_UINT32_BE
+#define PUT_UINT32_BE(n,b,i)                            \
+{                                                       \
+    (b)[(i)    ] = (unsigned char) ( (n) >> 24 );       \
+    (b)[(i) + 1] = (unsigned char) ( (n) >> 16 );       \
+    (b)[(i) + 2] = (unsigned char) ( (n) >>  8 );       \
+    (b)[(i) + 3] = (unsigned char) ( (n)       );       \
+}
+#endif
+
+#define SHA_MB_MAX_LANES    8
+
+typedef uint32_t sha_mb_x4 __attribute__((vector_size(16)));
+#if defined(SHA_MB_HAVE_AVX2)
+typedef uint32_t sha_mb_x8 __attribute__((vector_size(32)));
+#define SHA_MB_AVX2         __attribute__((target("avx2")))
+#endif
+#define SHA_MB_DEFAULT
+
+/*
+ * Compress nblk consecutive blocks in each lane: blk[l] points to the
+ * blocks of lane l and st holds the state as st[word * lanes + lane]
+ */
+typedef void (*sha_mb_blocks_t)( uint32_t *st, const unsigned char **blk,
+                                 size_t nblk );
+
+/*
+ * Load message word i of the current block of every lane
+ */
+#define SHA_MB_LOAD( W, vec, lanes, blk, i )                        \
+    do                                                              \
+    {                                                               \
+        uint32_t w_[lanes];                                         \
+        size_t l_;                                                  \
+        for( l_ = 0; l_ < (lanes); l_++ )                           \
+            GET_UINT32_BE( w_[l_], (blk)[l_], 4 * (i) );            \
+        memcpy( &(W), w_, sizeof( vec ) );                          \
+    } while( 0 )
+
+#define ROTL(x,n)   ( ( (x) << (n) ) | ( (x) >> ( 32 - (n) ) ) )
+#define ROTR(x,n)   ( ( (x) >> (n) ) | ( (x) << ( 32 - (n) ) ) )
+
+#if defined(MBEDTLS_SHA1_C)
+/*
+ * SHA-1 compression, with the round functions of sha1.c
+ */
+#define SHA1_F1(x,y,z)  ( (z) ^ ( (x) & ( (y) ^ (z) ) ) )
+#define SHA1_F2(x,y,z)  ( (x) ^ (y) ^ (z) )
+#define SHA1_F3(x,y,z)  ( ( (x) & (y) ) | ( (z) & ( (x) | (y) ) ) )
+
+#define SHA1_MB_ROUND( F, K, t )                                    \
+    do                                                              \
+    {                                                               \
+        if( (t) >= 16 )                                             \
+        {                                                           \
+            tmp = W[( (t) - 3 ) & 15] ^ W[( (t) - 8 ) & 15] ^       \
+                  W[( (t) - 14 ) & 15] ^ W[(t) & 15];               \
+            W[(t) & 15] = ROTL( tmp, 1 );                           \
+        }                                                           \
+        tmp = ROTL( a, 5 ) + F( b, c, d ) + e + (K) + W[(t) & 15];  \
+        e = d; d = c; c = ROTL( b, 30 ); b = a; a = tmp;            \
+    } while( 0 )
+
+#define SHA1_MB_BLOCKS( name, vec, lanes, attr )                            \
+static attr void name( uint32_t *st, const unsigned char **blk,             \
+                       size_t nblk )                                        \
+{                                                                           \
+    vec s[5], W[16], a, b, c, d, e, tmp;                                    \
+    const unsigned char *p[lanes];                                          \
+    size_t i, l;                                                            \
+                                                                            \
+    memcpy( s, st, sizeof( s ) );                                           \
+    memcpy( p, blk, sizeof( p ) );                                          \
+                                                                            \
+    while( nblk-- > 0 )                                                     \
+    {                                                                       \
+        a = s[0]; b = s[1]; c = s[2]; d = s[3]; e = s[4];                   \
+                                                                            \
+        for( i = 0; i < 16; i++ )                                           \
+        {                                                                   \
+            SHA_MB_LOAD( W[i], vec, lanes, p, i );                          \
+            SHA1_MB_ROUND( SHA1_F1, 0x5A827999, i );                        \
+        }                                                                   \
+        for( ; i < 20; i++ )                                                \
+            SHA1_MB_ROUND( SHA1_F1, 0x5A827999, i );                        \
+        for( ; i < 40; i++ )                                                \
+            SHA1_MB_ROUND( SHA1_F2, 0x6ED9EBA1, i );                        \
+        for( ; i < 60; i++ )                                                \
+            SHA1_MB_ROUND( SHA1_F3, 0x8F1BBCDC, i );                        \
+        for( ; i < 80; i++ )                                                \
+            SHA1_MB_ROUND( SHA1_F2, 0xCA62C1D6, i );                        \
+                                                                            \
+        s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e;              \
+                                                                            \
+        for( l = 0; l < (lanes); l++ )                                      \
+            p[l] += 64;                                                     \
+    }                                                                       \
+                                                                            \
+    memcpy( st, s, sizeof( s ) );                                           \
+}
+
+SHA1_MB_BLOCKS( sha1_mb_blocks4, sha_mb_x4, 4, SHA_MB_DEFAULT )
+#if defined(SHA_MB_HAVE_AVX2)
+SHA1_MB_BLOCKS( sha1_mb_blocks8, sha_mb_x8, 8, SHA_MB_AVX2 )
+#endif
+
+static const uint32_t sha1_iv[5] =
+{
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+#endif /* MBEDTLS_SHA1_C */
+
+#if defined(MBEDTLS_SHA256_C)
+/*
+ * SHA-256 compression, with the constants and functions of sha256.c
+ */
+static const uint32_t K[] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+#define S0(x) (ROTR(x, 7) ^ ROTR(x,18) ^  ((x) >>  3))
+#define S1(x) (ROTR(x,17) ^ ROTR(x,19) ^  ((x) >> 10))
+
+#define S2(x) (ROTR(x, 2) ^ ROTR(x,13) ^ ROTR(x,22))
+#define S3(x) (ROTR(x, 6) ^ ROTR(x,11) ^ ROTR(x,25))
+
+#define F0(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define F1(x,y,z) ((z) ^ ((x) & ((y) ^ (z))))
+
+#define SHA256_MB_ROUND( t )                                        \
+    do                                                              \
+    {                                                               \
+        if( (t) >= 16 )                                             \
+            W[(t) & 15] += S1( W[( (t) - 2 ) & 15] ) +              \
+                           W[( (t) - 7 ) & 15] +                    \
+                           S0( W[( (t) - 15 ) & 15] );              \
+        tmp1 = h + S3( e ) + F1( e, f, g ) + K[t] + W[(t) & 15];    \
+        tmp2 = S2( a ) + F0( a, b, c );                             \
+        h = g; g = f; f = e; e = d + tmp1;                          \
+        d = c; c = b; b = a; a = tmp1 + tmp2;                       \
+    } while( 0 )
+
+#define SHA256_MB_BLOCKS( name, vec, lanes, attr )                          \
+static attr void name( uint32_t *st, const unsigned char **blk,             \
+                       size_t nblk )                                        \
+{                                                                           \
+    vec s[8], W[16], a, b, c, d, e, f, g, h, tmp1, tmp2;                    \
+    const unsigned char *p[lanes];                                          \
+    size_t i, l;                                                            \
+                                                                            \
+    memcpy( s, st, sizeof( s ) );                                           \
+    memcpy( p, blk, sizeof( p ) );                                          \
+                                                                            \
+    while( nblk-- > 0 )                                                     \
+    {                                                                       \
+        a = s[0]; b = s[1]; c = s[2]; d = s[3];                             \
+        e = s[4]; f = s[5]; g = s[6]; h = s[7];                             \
+                                                                            \
+        for( i = 0; i < 16; i++ )                                           \
+        {                                                                   \
+            SHA_MB_LOAD( W[i], vec, lanes, p, i );                          \
+            SHA256_MB_ROUND( i );                                           \
+        }                                                                   \
+        for( ; i < 64; i++ )                                                \
+            SHA256_MB_ROUND( i );                                           \
+                                                                            \
+        s[0] += a; s[1] += b; s[2] += c; s[3] += d;                         \
+        s[4] += e; s[5] += f; s[6] += g; s[7] += h;                         \
+                                                                            \
+        for( l = 0; l < (lanes); l++ )                                      \
+            p[l] += 64;                                                     \
+    }                                                                       \
+                                                                            \
+    memcpy( st, s, sizeof( s ) );                                           \
+}
+
+SHA256_MB_BLOCKS( sha256_mb_blocks4, sha_mb_x4, 4, SHA_MB_DEFAULT )
+#if defined(SHA_MB_HAVE_AVX2)
+SHA256_MB_BLOCKS( sha256_mb_blocks8, sha_mb_x8, 8, SHA_MB_AVX2 )
+#endif
+
+static const uint32_t sha224_iv[8] =
+{
+    0xC1059ED8, 0x367CD507, 0x3070DD17, 0xF70E5939,
+    0xFFC00B31, 0x68581511, 0x64F98FA7, 0xBEFA4FA4
+};
+
+static const uint32_t sha256_iv[8] =
+{
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+#endif /* MBEDTLS_SHA256_C */
+
+/*
+ * A lane works through the full blocks of its message in place, then
+ * through one or two padded blocks copied to tail[]
+ */
+typedef struct
+{
+    size_t msg;                 /*!< message in the lane, n if idle     */
+    const unsigned char *p;     /*!< next block of the lane             */
+    size_t left;                /*!< blocks left at p                   */
+    int in_tail;                /*!< p points to tail                   */
+    unsigned char tail[128];    /*!< last bytes of the message, padded  */
+}
+sha_mb_lane;
+
+static void sha_mb_lane_tail( sha_mb_lane *lane, size_t ilen )
+{
+    size_t rem = ilen % 64;
+
+    lane->left = ( rem < 56 ) ? 1 : 2;
+
+    if( rem > 0 )
+        memcpy( lane->tail, lane->p, rem );
+    lane->tail[rem] = 0x80;
+    memset( lane->tail + rem + 1, 0, 64 * lane->left - rem - 1 );
+
+    PUT_UINT32_BE( (uint32_t) ( ilen >> 29 ), lane->tail, 64 * lane->left - 8 );
+    PUT_UINT32_BE( (uint32_t) ( ilen <<  3 ), lane->tail, 64 * lane->left - 4 );
+
+    lane->p = lane->tail;
+    lane->in_tail = 1;
+}
+
+/*
+ * Hash the n messages with blocks() over the given number of lanes: every
+ * step runs all lanes for as many blocks as the busiest lane has left
+ * without a message change, then finished lanes output their digest and
+ * take the next message. Idle lanes hash a copy of an active lane's blocks.
+ */
+static void sha_mb_run( sha_mb_blocks_t blocks, size_t lanes,
+                        const uint32_t *iv, size_t words, size_t olen,
+                        size_t n, const unsigned char * const input[],
+                        const size_t ilen[], unsigned char * const output[] )
+{
+    sha_mb_lane lane[SHA_MB_MAX_LANES];
+    uint32_t st[8 * SHA_MB_MAX_LANES];
+    const unsigned char *blk[SHA_MB_MAX_LANES];
+    size_t next = 0, active = 0, nblk, busy = 0, i, l;
+
+    memset( st, 0, words * lanes * sizeof( uint32_t ) );
+    for( l = 0; l < lanes; l++ )
+        lane[l].msg = n;
+
+    while( 1 )
+    {
+        /* Start the next messages in the idle lanes */
+        for( l = 0; l < lanes && next < n; l++ )
+        {
+            if( lane[l].msg != n )
+                continue;
+
+            lane[l].msg = next;
+            lane[l].p = input[next];
+            lane[l].left = ilen[next] / 64;
+            lane[l].in_tail = 0;
+            if( lane[l].left == 0 )
+                sha_mb_lane_tail( &lane[l], ilen[next] );
+
+            for( i = 0; i < words; i++ )
+                st[i * lanes + l] = iv[i];
+
+            next++;
+            active++;
+        }
+
+        if( active == 0 )
+            break;
+
+        nblk = (size_t) -1;
+        for( l = 0; l < lanes; l++ )
+        {
+            if( lane[l].msg != n )
+            {
+                busy = l;
+                if( lane[l].left < nblk )
+                    nblk = lane[l].left;
+            }
+        }
+
+        for( l = 0; l < lanes; l++ )
+            blk[l] = lane[lane[l].msg != n ? l : busy].p;
+
+        blocks( st, blk, nblk );
+
+        for( l = 0; l < lanes; l++ )
+        {
+            if( lane[l].msg == n )
+                continue;
+
+            lane[l].p += 64 * nblk;
+            lane[l].left -= nblk;
+            if( lane[l].left > 0 )
+                continue;
+
+            if( ! lane[l].in_tail )
+            {
+                sha_mb_lane_tail( &lane[l], ilen[lane[l].msg] );
+                continue;
+            }
+
+            for( i = 0; i < olen / 4; i++ )
+                PUT_UINT32_BE( st[i * lanes + l], output[lane[l].msg], 4 * i );
+
+            lane[l].msg = n;
+            active--;
+        }
+    }
+
+    for( l = 0; l < lanes; l++ )
+        mbedtls_zeroize( lane[l].tail, sizeof( lane[l].tail ) );
+    mbedtls_zeroize( st, words * lanes * sizeof( uint32_t ) );
+}
+
+#endif /* SHA_MB_HAVE_SIMD */
+
+#if defined(MBEDTLS_SHA1_C)
+void mbedtls_sha1_mb_ext( size_t n, const unsigned char * const input[],
+                          const size_t ilen[], unsigned char * const output[],
+                          size_t lanes )
+{
+    size_t i;
+
+    lanes = sha_mb_pick_lanes( lanes );
+
+#if defined(SHA_MB_HAVE_AVX2)
+    if( lanes == 8 )
+    {
+        sha_mb_run( sha1_mb_blocks8, 8, sha1_iv, 5, 20,
+                    n, input, ilen, output );
+        return;
+    }
+#endif
+#if defined(SHA_MB_HAVE_SIMD)
+    if( lanes == 4 )
+    {
+        sha_mb_run( sha1_mb_blocks4, 4, sha1_iv, 5, 20,
+                    n, input, ilen, output );
+        return;
+    }
+#endif
+
+    for( i = 0; i < n; i++ )
+        mbedtls_sha1( input[i], ilen[i], output[i] );
+}
+
+void mbedtls_sha1_mb( size_t n, const unsigned char * const input[],
+                      const size_t ilen[], unsigned char * const output[] )
+{
+    /* A single message is faster without the lanes */
+    mbedtls_sha1_mb_ext( n, input, ilen, output,
+                         n > 4 ? 8 : n > 1 ? 4 : 1 );
+}
+#endif /* MBEDTLS_SHA1_C */
+
+#if defined(MBEDTLS_SHA256_C)
+void mbedtls_sha256_mb_ext( size_t n, const unsigned char * const input[],
+                            const size_t ilen[], unsigned char * const output[],
+                            int is224, size_t lanes )
+{
+    size_t i;
+#if defined(SHA_MB_HAVE_SIMD)
+    const uint32_t *iv = is224 ? sha224_iv : sha256_iv;
+    size_t olen = is224 ? 28 : 32;
+#endif
+
+    lanes = sha_mb_pick_lanes( lanes );
+
+#if defined(SHA_MB_HAVE_AVX2)
+    if( lanes == 8 )
+    {
+        sha_mb_run( sha256_mb_blocks8, 8, iv, 8, olen,
+                    n, input, ilen, output );
+        return;
+    }
+#endif
+#if defined(SHA_MB_HAVE_SIMD)
+    if( lanes == 4 )
+    {
+        sha_mb_run( sha256_mb_blocks4, 4, iv, 8, olen,
+                    n, input, ilen, output );
+        return;
+    }
+#endif
+
+    for( i = 0; i < n; i++ )
+        mbedtls_sha256( input[i], ilen[i], output[i], is224 );
+}
+
+void mbedtls_sha256_mb( size_t n, const unsigned char * const input[],
+                        const size_t ilen[], unsigned char * const output[],
+                        int is224 )
+{
+    /* A single message is faster without the lanes */
+    size_t lanes = n > 4 ? 8 : n > 1 ? 4 : 1;
+
+#if defined(MBEDTLS_SHANI_C) && defined(MBEDTLS_HAVE_X86_64)
+    /* With the SHA extensions, mbedtls_sha256() hashes the messages one
+     * after the other faster than the lanes do */
+    if( mbedtls_shani_has_support( MBEDTLS_SHANI_SHA ) )
+        lanes = 1;
+#endif
+
+    mbedtls_sha256_mb_ext( n, input, ilen, output, is224, lanes );
+}
+#endif /* MBEDTLS_SHA256_C */
+
+#endif /* MBEDTLS_SHA_MB_C */
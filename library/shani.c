@@ -0,0 +1,541 @@
+/*
+ *  SHA extensions and AVX2 support functions for SHA-256 and SHA-512
+ *
+ *  Copyright (C) 2006-2016, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+
+/*
+ * [SHA-WP] https://software.intel.com/en-us/articles/intel-sha-extensions
+ * [AVX2-WP] http://www.intel.com/content/www/us/en/intelligent-systems/intel-technology/fast-sha512-implementations-ia-processors-paper.html
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_SHANI_C)
+
+#include "mbedtls/shani.h"
+
+#include <string.h>
+
+#ifndef asm
+#define asm __asm
+#endif
+
+#if defined(MBEDTLS_HAVE_X86_64)
+
+/*
+ * SHA extensions and AVX2 support detection routine: CPUID leaf 7 for the
+ * features, and for AVX2, OSXSAVE and XGETBV to check that the OS saves the
+ * YMM registers
+ */
+int mbedtls_shani_has_support( unsigned int what )
+{
+    static int done = 0;
+    static unsigned int b = 0;
+    unsigned int a, c, d;
+
+    if( ! done )
+    {
+        asm( "xorl  %%eax, %%eax\n\t"
+             "cpuid             \n\t"
+             : "=a" (a)
+             :
+             : "ebx", "ecx", "edx" );
+
+        if( a >= 7 )
+        {
+            asm( "movl  $7, %%eax   \n\t"
+                 "xorl  %%ecx, %%ecx\n\t"
+                 "cpuid             \n\t"
+                 : "=b" (b)
+                 :
+                 : "eax", "ecx", "edx" );
+
+            asm( "movl  $1, %%eax   \n\t"
+                 "cpuid             \n\t"
+                 : "=c" (c)
+                 :
+                 : "eax", "ebx", "edx" );
+
+            a = 0;
+            if( ( c & 0x18000000u ) == 0x18000000u )
+            {
+                asm( "xorl  %%ecx, %%ecx\n\t"
+                     ".byte 0x0F,0x01,0xD0\n\t" /* xgetbv */
+                     : "=a" (a), "=d" (d)
+                     :
+                     : "ecx" );
+            }
+
+            /* AVX2 also needs the YMM state saved, and BMI2 for RORX */
+            if( ( a & 6 ) != 6 || ( b & 0x00000100u ) == 0 )
+                b &= ~MBEDTLS_SHANI_AVX2;
+        }
+        done = 1;
+    }
+
+    return( ( b & what ) != 0 );
+}
+
+#if defined(MBEDTLS_SHA256_C)
+/*
+ * Binutils needs to be at least 2.24 to support the SHA instructions, so
+ * emit bytecode directly as aesni.c does for AES-NI.
+ *
+ * Opcodes from the Intel architecture reference manual, vol. 2.
+ * We always use registers, so we don't need prefixes for memory operands.
+ * Operand macros are in gas order (src, dst).
+ */
+#define SHA256RNDS2 ".byte 0x0F,0x38,0xCB,"
+#define SHA256MSG1  ".byte 0x0F,0x38,0xCC,"
+#define SHA256MSG2  ".byte 0x0F,0x38,0xCD,"
+#define PALIGNR     ".byte 0x66,0x0F,0x3A,0x0F,"
+#define PBLENDW     ".byte 0x66,0x0F,0x3A,0x0E,"
+#define PSHUFB_R8   ".byte 0x66,0x41,0x0F,0x38,0x00,"   /* source xmm8 */
+
+#define xmm1_xmm2   "0xD1"
+#define xmm2_xmm1   "0xCA"
+#define xmm7_xmm2   "0xD7"
+#define xmm3_xmm4   "0xE3"
+#define xmm3_xmm6   "0xF3"
+#define xmm3_xmm7   "0xFB"
+#define xmm4_xmm3   "0xDC"
+#define xmm4_xmm5   "0xEC"
+#define xmm4_xmm7   "0xFC"
+#define xmm5_xmm4   "0xE5"
+#define xmm5_xmm6   "0xF5"
+#define xmm5_xmm7   "0xFD"
+#define xmm6_xmm3   "0xDE"
+#define xmm6_xmm5   "0xEE"
+#define xmm6_xmm7   "0xFE"
+#define xmm8_xmm0   "0xC0"
+
+static const uint32_t K256[64] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+static const unsigned char sha256_be32_mask[16] =
+{
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/*
+ * SHA-256 compression with the SHA extensions, [SHA-WP]. SHA256RNDS2 does
+ * two rounds on the state halves ABEF (xmm1) and CDGH (xmm2) with the
+ * message words plus constants in xmm0; SHA256MSG1 and SHA256MSG2 compute
+ * the message schedule four words at a time in xmm3 to xmm6.
+ */
+void mbedtls_shani_sha256_process( uint32_t state[8],
+                                   const unsigned char data[64] )
+{
+    asm( "movdqu    (%0), %%xmm1        \n\t"       // DCBA
+         "movdqu    16(%0), %%xmm2      \n\t"       // HGFE
+         "movdqu    (%3), %%xmm8        \n\t"       // byte swap mask
+         "pshufd    $0xB1, %%xmm1, %%xmm1\n\t"      // CDAB
+         "pshufd    $0x1B, %%xmm2, %%xmm2\n\t"      // EFGH
+         "movdqa    %%xmm1, %%xmm7      \n\t"
+         PALIGNR     xmm2_xmm1 ",0x08\n\t"          // ABEF
+         PBLENDW     xmm7_xmm2 ",0xF0\n\t"          // CDGH
+         "movdqa    %%xmm1, %%xmm10     \n\t"
+         "movdqa    %%xmm2, %%xmm11     \n\t"
+
+         "movdqu    (%1), %%xmm0        \n\t"       // W[0..3]
+         PSHUFB_R8   xmm8_xmm0      "\n\t"
+         "movdqa    %%xmm0, %%xmm3      \n\t"
+         "movdqu    (%2), %%xmm9        \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[0..3]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 0, 1
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 2, 3
+
+         "movdqu    16(%1), %%xmm0      \n\t"       // W[4..7]
+         PSHUFB_R8   xmm8_xmm0      "\n\t"
+         "movdqa    %%xmm0, %%xmm4      \n\t"
+         "movdqu    16(%2), %%xmm9      \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[4..7]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 4, 5
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 6, 7
+         SHA256MSG1  xmm4_xmm3      "\n\t"
+
+         "movdqu    32(%1), %%xmm0      \n\t"       // W[8..11]
+         PSHUFB_R8   xmm8_xmm0      "\n\t"
+         "movdqa    %%xmm0, %%xmm5      \n\t"
+         "movdqu    32(%2), %%xmm9      \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[8..11]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 8, 9
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 10, 11
+         SHA256MSG1  xmm5_xmm4      "\n\t"
+
+         "movdqu    48(%1), %%xmm0      \n\t"       // W[12..15]
+         PSHUFB_R8   xmm8_xmm0      "\n\t"
+         "movdqa    %%xmm0, %%xmm6      \n\t"
+         "movdqu    48(%2), %%xmm9      \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[12..15]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 12, 13
+         "movdqa    %%xmm6, %%xmm7      \n\t"
+         PALIGNR     xmm5_xmm7 ",0x04\n\t"          // W[9..12]
+         "paddd     %%xmm7, %%xmm3      \n\t"
+         SHA256MSG2  xmm6_xmm3      "\n\t"          // W[16..19]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 14, 15
+         SHA256MSG1  xmm6_xmm5      "\n\t"
+
+         "movdqa    %%xmm3, %%xmm0      \n\t"       // W[16..19]
+         "movdqu    64(%2), %%xmm9      \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[16..19]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 16, 17
+         "movdqa    %%xmm3, %%xmm7      \n\t"
+         PALIGNR     xmm6_xmm7 ",0x04\n\t"          // W[13..16]
+         "paddd     %%xmm7, %%xmm4      \n\t"
+         SHA256MSG2  xmm3_xmm4      "\n\t"          // W[20..23]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 18, 19
+         SHA256MSG1  xmm3_xmm6      "\n\t"
+
+         "movdqa    %%xmm4, %%xmm0      \n\t"       // W[20..23]
+         "movdqu    80(%2), %%xmm9      \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[20..23]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 20, 21
+         "movdqa    %%xmm4, %%xmm7      \n\t"
+         PALIGNR     xmm3_xmm7 ",0x04\n\t"          // W[17..20]
+         "paddd     %%xmm7, %%xmm5      \n\t"
+         SHA256MSG2  xmm4_xmm5      "\n\t"          // W[24..27]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 22, 23
+         SHA256MSG1  xmm4_xmm3      "\n\t"
+
+         "movdqa    %%xmm5, %%xmm0      \n\t"       // W[24..27]
+         "movdqu    96(%2), %%xmm9      \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[24..27]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 24, 25
+         "movdqa    %%xmm5, %%xmm7      \n\t"
+         PALIGNR     xmm4_xmm7 ",0x04\n\t"          // W[21..24]
+         "paddd     %%xmm7, %%xmm6      \n\t"
+         SHA256MSG2  xmm5_xmm6      "\n\t"          // W[28..31]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 26, 27
+         SHA256MSG1  xmm5_xmm4      "\n\t"
+
+         "movdqa    %%xmm6, %%xmm0      \n\t"       // W[28..31]
+         "movdqu    112(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[28..31]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 28, 29
+         "movdqa    %%xmm6, %%xmm7      \n\t"
+         PALIGNR     xmm5_xmm7 ",0x04\n\t"          // W[25..28]
+         "paddd     %%xmm7, %%xmm3      \n\t"
+         SHA256MSG2  xmm6_xmm3      "\n\t"          // W[32..35]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 30, 31
+         SHA256MSG1  xmm6_xmm5      "\n\t"
+
+         "movdqa    %%xmm3, %%xmm0      \n\t"       // W[32..35]
+         "movdqu    128(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[32..35]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 32, 33
+         "movdqa    %%xmm3, %%xmm7      \n\t"
+         PALIGNR     xmm6_xmm7 ",0x04\n\t"          // W[29..32]
+         "paddd     %%xmm7, %%xmm4      \n\t"
+         SHA256MSG2  xmm3_xmm4      "\n\t"          // W[36..39]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 34, 35
+         SHA256MSG1  xmm3_xmm6      "\n\t"
+
+         "movdqa    %%xmm4, %%xmm0      \n\t"       // W[36..39]
+         "movdqu    144(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[36..39]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 36, 37
+         "movdqa    %%xmm4, %%xmm7      \n\t"
+         PALIGNR     xmm3_xmm7 ",0x04\n\t"          // W[33..36]
+         "paddd     %%xmm7, %%xmm5      \n\t"
+         SHA256MSG2  xmm4_xmm5      "\n\t"          // W[40..43]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 38, 39
+         SHA256MSG1  xmm4_xmm3      "\n\t"
+
+         "movdqa    %%xmm5, %%xmm0      \n\t"       // W[40..43]
+         "movdqu    160(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[40..43]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 40, 41
+         "movdqa    %%xmm5, %%xmm7      \n\t"
+         PALIGNR     xmm4_xmm7 ",0x04\n\t"          // W[37..40]
+         "paddd     %%xmm7, %%xmm6      \n\t"
+         SHA256MSG2  xmm5_xmm6      "\n\t"          // W[44..47]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 42, 43
+         SHA256MSG1  xmm5_xmm4      "\n\t"
+
+         "movdqa    %%xmm6, %%xmm0      \n\t"       // W[44..47]
+         "movdqu    176(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[44..47]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 44, 45
+         "movdqa    %%xmm6, %%xmm7      \n\t"
+         PALIGNR     xmm5_xmm7 ",0x04\n\t"          // W[41..44]
+         "paddd     %%xmm7, %%xmm3      \n\t"
+         SHA256MSG2  xmm6_xmm3      "\n\t"          // W[48..51]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 46, 47
+         SHA256MSG1  xmm6_xmm5      "\n\t"
+
+         "movdqa    %%xmm3, %%xmm0      \n\t"       // W[48..51]
+         "movdqu    192(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[48..51]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 48, 49
+         "movdqa    %%xmm3, %%xmm7      \n\t"
+         PALIGNR     xmm6_xmm7 ",0x04\n\t"          // W[45..48]
+         "paddd     %%xmm7, %%xmm4      \n\t"
+         SHA256MSG2  xmm3_xmm4      "\n\t"          // W[52..55]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 50, 51
+         SHA256MSG1  xmm3_xmm6      "\n\t"
+
+         "movdqa    %%xmm4, %%xmm0      \n\t"       // W[52..55]
+         "movdqu    208(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[52..55]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 52, 53
+         "movdqa    %%xmm4, %%xmm7      \n\t"
+         PALIGNR     xmm3_xmm7 ",0x04\n\t"          // W[49..52]
+         "paddd     %%xmm7, %%xmm5      \n\t"
+         SHA256MSG2  xmm4_xmm5      "\n\t"          // W[56..59]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 54, 55
+
+         "movdqa    %%xmm5, %%xmm0      \n\t"       // W[56..59]
+         "movdqu    224(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[56..59]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 56, 57
+         "movdqa    %%xmm5, %%xmm7      \n\t"
+         PALIGNR     xmm4_xmm7 ",0x04\n\t"          // W[53..56]
+         "paddd     %%xmm7, %%xmm6      \n\t"
+         SHA256MSG2  xmm5_xmm6      "\n\t"          // W[60..63]
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 58, 59
+
+         "movdqa    %%xmm6, %%xmm0      \n\t"       // W[60..63]
+         "movdqu    240(%2), %%xmm9     \n\t"
+         "paddd     %%xmm9, %%xmm0      \n\t"       // + K[60..63]
+         SHA256RNDS2 xmm1_xmm2      "\n\t"          // rounds 60, 61
+         "pshufd    $0x0E, %%xmm0, %%xmm0\n\t"
+         SHA256RNDS2 xmm2_xmm1      "\n\t"          // rounds 62, 63
+
+         "paddd     %%xmm10, %%xmm1     \n\t"
+         "paddd     %%xmm11, %%xmm2     \n\t"
+         "pshufd    $0x1B, %%xmm1, %%xmm1\n\t"      // FEBA
+         "pshufd    $0xB1, %%xmm2, %%xmm2\n\t"      // DCHG
+         "movdqa    %%xmm1, %%xmm7      \n\t"
+         PBLENDW     xmm2_xmm1 ",0xF0\n\t"          // DCBA
+         PALIGNR     xmm7_xmm2 ",0x08\n\t"          // HGFE
+         "movdqu    %%xmm1, (%0)        \n\t"
+         "movdqu    %%xmm2, 16(%0)      \n\t"
+         :
+         : "r" (state), "r" (data), "r" (K256), "r" (sha256_be32_mask)
+         : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+           "xmm6", "xmm7", "xmm8", "xmm9", "xmm10", "xmm11" );
+}
+#endif /* MBEDTLS_SHA256_C */
+
+#if defined(MBEDTLS_SHA512_C)
+#define UL64(x) x##ULL
+
+static const uint64_t K512[80] =
+{
+    UL64(0x428A2F98D728AE22),  UL64(0x7137449123EF65CD),
+    UL64(0xB5C0FBCFEC4D3B2F),  UL64(0xE9B5DBA58189DBBC),
+    UL64(0x3956C25BF348B538),  UL64(0x59F111F1B605D019),
+    UL64(0x923F82A4AF194F9B),  UL64(0xAB1C5ED5DA6D8118),
+    UL64(0xD807AA98A3030242),  UL64(0x12835B0145706FBE),
+    UL64(0x243185BE4EE4B28C),  UL64(0x550C7DC3D5FFB4E2),
+    UL64(0x72BE5D74F27B896F),  UL64(0x80DEB1FE3B1696B1),
+    UL64(0x9BDC06A725C71235),  UL64(0xC19BF174CF692694),
+    UL64(0xE49B69C19EF14AD2),  UL64(0xEFBE4786384F25E3),
+    UL64(0x0FC19DC68B8CD5B5),  UL64(0x240CA1CC77AC9C65),
+    UL64(0x2DE92C6F592B0275),  UL64(0x4A7484AA6EA6E483),
+    UL64(0x5CB0A9DCBD41FBD4),  UL64(0x76F988DA831153B5),
+    UL64(0x983E5152EE66DFAB),  UL64(0xA831C66D2DB43210),
+    UL64(0xB00327C898FB213F),  UL64(0xBF597FC7BEEF0EE4),
+    UL64(0xC6E00BF33DA88FC2),  UL64(0xD5A79147930AA725),
+    UL64(0x06CA6351E003826F),  UL64(0x142929670A0E6E70),
+    UL64(0x27B70A8546D22FFC),  UL64(0x2E1B21385C26C926),
+    UL64(0x4D2C6DFC5AC42AED),  UL64(0x53380D139D95B3DF),
+    UL64(0x650A73548BAF63DE),  UL64(0x766A0ABB3C77B2A8),
+    UL64(0x81C2C92E47EDAEE6),  UL64(0x92722C851482353B),
+    UL64(0xA2BFE8A14CF10364),  UL64(0xA81A664BBC423001),
+    UL64(0xC24B8B70D0F89791),  UL64(0xC76C51A30654BE30),
+    UL64(0xD192E819D6EF5218),  UL64(0xD69906245565A910),
+    UL64(0xF40E35855771202A),  UL64(0x106AA07032BBD1B8),
+    UL64(0x19A4C116B8D2D0C8),  UL64(0x1E376C085141AB53),
+    UL64(0x2748774CDF8EEB99),  UL64(0x34B0BCB5E19B48A8),
+    UL64(0x391C0CB3C5C95A63),  UL64(0x4ED8AA4AE3418ACB),
+    UL64(0x5B9CCA4F7763E373),  UL64(0x682E6FF3D6B2B8A3),
+    UL64(0x748F82EE5DEFB2FC),  UL64(0x78A5636F43172F60),
+    UL64(0x84C87814A1F0AB72),  UL64(0x8CC702081A6439EC),
+    UL64(0x90BEFFFA23631E28),  UL64(0xA4506CEBDE82BDE9),
+    UL64(0xBEF9A3F7B2C67915),  UL64(0xC67178F2E372532B),
+    UL64(0xCA273ECEEA26619C),  UL64(0xD186B8C721C0C207),
+    UL64(0xEADA7DD6CDE0EB1E),  UL64(0xF57D4F7FEE6ED178),
+    UL64(0x06F067AA72176FBA),  UL64(0x0A637DC5A2C898A6),
+    UL64(0x113F9804BEF90DAE),  UL64(0x1B710B35131C471B),
+    UL64(0x28DB77F523047D84),  UL64(0x32CAAB7B40C72493),
+    UL64(0x3C9EBE0A15C9BEBC),  UL64(0x431D67C49C100D4C),
+    UL64(0x4CC5D4BECB3E42B6),  UL64(0x597F299CFC657E2A),
+    UL64(0x5FCB6FAB3AD6FAEC),  UL64(0x6C44198C4A475817)
+};
+
+typedef uint64_t shani_u64x4 __attribute__((vector_size(32)));
+
+#define  SHR(x,n) ((x) >> (n))
+#define ROTR(x,n) (SHR(x,n) | ((x) << (64 - (n))))
+
+#define S0(x) (ROTR(x, 1) ^ ROTR(x, 8) ^  SHR(x, 7))
+#define S1(x) (ROTR(x,19) ^ ROTR(x,61) ^  SHR(x, 6))
+
+#define S2(x) (ROTR(x,28) ^ ROTR(x,34) ^ ROTR(x,39))
+#define S3(x) (ROTR(x,14) ^ ROTR(x,18) ^ ROTR(x,41))
+
+#define F0(x,y,z) ((x & y) | (z & (x | y)))
+#define F1(x,y,z) (z ^ (x & (y ^ z)))
+
+/*
+ * One round, with wk = W[t] + K[t]
+ */
+#define P(a,b,c,d,e,f,g,h,wk)                   \
+{                                               \
+    temp1 = h + S3(e) + F1(e,f,g) + wk;         \
+    temp2 = S2(a) + F0(a,b,c);                  \
+    d += temp1; h = temp1 + temp2;              \
+}
+
+/*
+ * W[t..t+3] from X0..X3 = W[t-16..t-1], [AVX2-WP]: the terms in W[t-16],
+ * W[t-15] and W[t-7] four at a time, then S1(W[t-2]) in two halves since
+ * W[t+2] and W[t+3] depend on W[t] and W[t+1]. WK[] receives W + K.
+ */
+#define SCHEDULE( t )                                                   \
+{                                                                       \
+    shani_u64x4 w15, w7, w2;                                            \
+                                                                        \
+    w15 = (shani_u64x4) { X0[1], X0[2], X0[3], X1[0] };                 \
+    w7  = (shani_u64x4) { X2[1], X2[2], X2[3], X3[0] };                 \
+    w2  = (shani_u64x4) { X3[2], X3[3], 0, 0 };                         \
+    X = X0 + S0( w15 ) + w7 + S1( w2 );                                 \
+    w2  = (shani_u64x4) { 0, 0, X[0], X[1] };                           \
+    X += S1( w2 );                                                      \
+                                                                        \
+    X0 = X1; X1 = X2; X2 = X3; X3 = X;                                  \
+    memcpy( &Kv, K512 + (t), sizeof( Kv ) );                            \
+    X += Kv;                                                            \
+    memcpy( WK + ( (t) & 15 ), &X, sizeof( X ) );                       \
+}
+
+/*
+ * SHA-512 compression with the message schedule in AVX2 registers, four
+ * words at a time and four rounds ahead of the scalar rounds, [AVX2-WP].
+ * Built for BMI2 too, for the RORX rotations in the rounds.
+ */
+__attribute__((target("avx2,bmi2")))
+void mbedtls_shani_sha512_process( uint64_t state[8],
+                                   const unsigned char data[128] )
+{
+    int i;
+    uint64_t temp1, temp2, W[16], WK[16];
+    uint64_t A, B, C, D, E, F, G, H;
+    shani_u64x4 X0, X1, X2, X3, X, Kv;
+
+    /* x86 is little endian */
+    memcpy( W, data, sizeof( W ) );
+    for( i = 0; i < 16; i++ )
+        W[i] = __builtin_bswap64( W[i] );
+
+    memcpy( &X0, W +  0, sizeof( X0 ) );
+    memcpy( &X1, W +  4, sizeof( X1 ) );
+    memcpy( &X2, W +  8, sizeof( X2 ) );
+    memcpy( &X3, W + 12, sizeof( X3 ) );
+
+    for( i = 0; i < 16; i++ )
+        WK[i] = W[i] + K512[i];
+
+    A = state[0];
+    B = state[1];
+    C = state[2];
+    D = state[3];
+    E = state[4];
+    F = state[5];
+    G = state[6];
+    H = state[7];
+
+    for( i = 0; i < 64; i += 8 )
+    {
+        P( A, B, C, D, E, F, G, H, WK[( i + 0 ) & 15] );
+        P( H, A, B, C, D, E, F, G, WK[( i + 1 ) & 15] );
+        P( G, H, A, B, C, D, E, F, WK[( i + 2 ) & 15] );
+        P( F, G, H, A, B, C, D, E, WK[( i + 3 ) & 15] );
+        SCHEDULE( i + 16 );
+        P( E, F, G, H, A, B, C, D, WK[( i + 4 ) & 15] );
+        P( D, E, F, G, H, A, B, C, WK[( i + 5 ) & 15] );
+        P( C, D, E, F, G, H, A, B, WK[( i + 6 ) & 15] );
+        P( B, C, D, E, F, G, H, A, WK[( i + 7 ) & 15] );
+        SCHEDULE( i + 20 );
+    }
+
+    for( ; i < 80; i += 8 )
+    {
+        P( A, B, C, D, E, F, G, H, WK[( i + 0 ) & 15] );
+        P( H, A, B, C, D, E, F, G, WK[( i + 1 ) & 15] );
+        P( G, H, A, B, C, D, E, F, WK[( i + 2 ) & 15] );
+        P( F, G, H, A, B, C, D, E, WK[( i + 3 ) & 15] );
+        P( E, F, G, H, A, B, C, D, WK[( i + 4 ) & 15] );
+        P( D, E, F, G, H, A, B, C, WK[( i + 5 ) & 15] );
+        P( C, D, E, F, G, H, A, B, WK[( i + 6 ) & 15] );
+        P( B, C, D, E, F, G, H, A, WK[( i + 7 ) & 15] );
+    }
+
+    state[0] += A;
+    state[1] += B;
+    state[2] += C;
+    state[3] += D;
+    state[4] += E;
+    state[5] += F;
+    state[6] += G;
+    state[7] += H;
+}
+#endif /* MBEDTLS_SHA512_C */
+
+#endif /* MBEDTLS_HAVE_X86_64 */
+
+#endif /* MBEDTLS_SHANI_C */
@@ -0,0 +1,201 @@
+/*
+ *  Pool of SSL record buffers
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+/*
+ * Idle buffers are chained through a pointer stored at their start, so the
+ * pool needs no memory of its own besides the context.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdlib.h>
+#define mbedtls_calloc    calloc
+#define mbedtls_free      free
+#endif
+
+#include "mbedtls/ssl_buffer_pool.h"
+
+#include <string.h>
+
+void mbedtls_ssl_buffer_pool_init( mbedtls_ssl_buffer_pool *pool )
+{
+    memset( pool, 0, sizeof( mbedtls_ssl_buffer_pool ) );
+
+    pool->max_idle = MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_IDLE;
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_init( &pool->mutex );
+#endif
+}
+
+void mbedtls_ssl_buffer_pool_set_max_idle( mbedtls_ssl_buffer_pool *pool,
+                                           size_t max_idle )
+{
+    pool->max_idle = max_idle;
+}
+
+/*
+ * Find the list for buffers of the given size, claiming an unused one if
+ * needed. Returns NULL if all lists are taken by other sizes.
+ */
+static mbedtls_ssl_buffer_pool_list *ssl_buffer_pool_list(
+        mbedtls_ssl_buffer_pool *pool, size_t len )
+{
+    mbedtls_ssl_buffer_pool_list *unused = NULL;
+    size_t i;
+
+    for( i = 0; i < MBEDTLS_SSL_BUFFER_POOL_SIZES; i++ )
+    {
+        if( pool->lists[i].len == len )
+            return( &pool->lists[i] );
+
+        if( pool->lists[i].len == 0 && unused == NULL )
+            unused = &pool->lists[i];
+    }
+
+    if( unused != NULL )
+        unused->len = len;
+
+    return( unused );
+}
+
+unsigned char *mbedtls_ssl_buffer_pool_get( void *data, size_t len )
+{
+    mbedtls_ssl_buffer_pool *pool = (mbedtls_ssl_buffer_pool *) data;
+    mbedtls_ssl_buffer_pool_list *list;
+    unsigned char *buf = NULL;
+
+    if( len < sizeof( unsigned char * ) )
+        len = sizeof( unsigned char * );
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_lock( &pool->mutex ) != 0 )
+        return( NULL );
+#endif
+
+    list = ssl_buffer_pool_list( pool, len );
+
+    if( list != NULL && list->head != NULL )
+    {
+        buf = list->head;
+        list->head = *(unsigned char **) buf;
+        *(unsigned char **) buf = NULL;
+        list->count--;
+    }
+
+    pool->busy++;
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_unlock( &pool->mutex ) != 0 )
+    {
+        /* The pool can't be safely touched again, release the buffer that
+         * was taken from it rather than losing it */
+        mbedtls_free( buf );
+        return( NULL );
+    }
+#endif
+
+    if( buf == NULL && ( buf = mbedtls_calloc( 1, len ) ) == NULL )
+    {
+#if defined(MBEDTLS_THREADING_C)
+        if( mbedtls_mutex_lock( &pool->mutex ) != 0 )
+            return( NULL );
+#endif
+        pool->busy--;
+#if defined(MBEDTLS_THREADING_C)
+        mbedtls_mutex_unlock( &pool->mutex );
+#endif
+    }
+
+    return( buf );
+}
+
+void mbedtls_ssl_buffer_pool_put( void *data, unsigned char *buf, size_t len )
+{
+    mbedtls_ssl_buffer_pool *pool = (mbedtls_ssl_buffer_pool *) data;
+    mbedtls_ssl_buffer_pool_list *list;
+
+    if( buf == NULL )
+        return;
+
+    if( len < sizeof( unsigned char * ) )
+        len = sizeof( unsigned char * );
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_lock( &pool->mutex ) != 0 )
+    {
+        mbedtls_free( buf );
+        return;
+    }
+#endif
+
+    pool->busy--;
+
+    list = ssl_buffer_pool_list( pool, len );
+
+    if( list != NULL && list->count < pool->max_idle )
+    {
+        *(unsigned char **) buf = list->head;
+        list->head = buf;
+        list->count++;
+        buf = NULL;
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_unlock( &pool->mutex );
+#endif
+
+    mbedtls_free( buf );
+}
+
+void mbedtls_ssl_buffer_pool_free( mbedtls_ssl_buffer_pool *pool )
+{
+    unsigned char *buf;
+    size_t i;
+
+    if( pool == NULL )
+        return;
+
+    for( i = 0; i < MBEDTLS_SSL_BUFFER_POOL_SIZES; i++ )
+    {
+        while( ( buf = pool->lists[i].head ) != NULL )
+        {
+            pool->lists[i].head = *(unsigned char **) buf;
+            mbedtls_free( buf );
+        }
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_free( &pool->mutex );
+#endif
+
+    memset( pool, 0, sizeof( mbedtls_ssl_buffer_pool ) );
+}
+
+#endif /* MBEDTLS_SSL_BUFFER_POOL_C */
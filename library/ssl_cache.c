@@ -241,6 +241,11 @@ int mbedtls_ssl_cache_set( void *data, const mbedtls_ssl_session *session )
 
     memcpy( &cur->session, session, sizeof( mbedtls_ssl_session ) );
 
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+    /* Lean mode identity fields are not stored */
+    cur->session.peer_id = NULL;
+#endif
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     /*
      * If we're reusing an entry, free its certificate first
@@ -0,0 +1,498 @@
+/*
+ *  Sharded, hash-indexed SSL session cache implementation
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+/*
+ * These session callbacks split the cache into independently locked shards,
+ * each holding a chained hash table indexed by session id and a doubly
+ * linked LRU list used for eviction.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_SSL_CACHE_SHARDED_C)
+
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdlib.h>
+#define mbedtls_calloc    calloc
+#define mbedtls_free      free
+#endif
+
+#include "mbedtls/ssl_cache_sharded.h"
+
+#include <string.h>
+
+void mbedtls_ssl_cache_sharded_init( mbedtls_ssl_cache_sharded_context *cache )
+{
+    memset( cache, 0, sizeof( mbedtls_ssl_cache_sharded_context ) );
+
+    cache->timeout = MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_TIMEOUT;
+}
+
+/*
+ * FNV-1a over the session id. Session ids are chosen by the server's RNG,
+ * so a client cannot make stored entries collide; a non-keyed hash is
+ * enough to spread them over shards and buckets.
+ */
+static uint32_t ssl_cache_sharded_hash( const unsigned char *id, size_t len )
+{
+    uint32_t h = 0x811C9DC5;
+    size_t i;
+
+    for( i = 0; i < len; i++ )
+    {
+        h ^= id[i];
+        h *= 0x01000193;
+    }
+
+    return( h );
+}
+
+static mbedtls_ssl_cache_shard *ssl_cache_sharded_select(
+        mbedtls_ssl_cache_sharded_context *cache, uint32_t hash )
+{
+    return( &cache->shards[hash & ( ( 1u << cache->shard_bits ) - 1 )] );
+}
+
+static mbedtls_ssl_cache_sharded_entry **ssl_cache_sharded_bucket(
+        const mbedtls_ssl_cache_sharded_context *cache,
+        mbedtls_ssl_cache_shard *shard, uint32_t hash )
+{
+    return( &shard->buckets[( hash >> cache->shard_bits ) & shard->bucket_mask] );
+}
+
+static mbedtls_ssl_cache_sharded_entry *ssl_cache_sharded_find(
+        const mbedtls_ssl_cache_sharded_context *cache,
+        mbedtls_ssl_cache_shard *shard, uint32_t hash,
+        const unsigned char *id, size_t id_len )
+{
+    mbedtls_ssl_cache_sharded_entry *cur;
+
+    cur = *ssl_cache_sharded_bucket( cache, shard, hash );
+
+    while( cur != NULL )
+    {
+        if( cur->hash == hash &&
+            cur->session.id_len == id_len &&
+            memcmp( cur->session.id, id, id_len ) == 0 )
+        {
+            return( cur );
+        }
+
+        cur = cur->hnext;
+    }
+
+    return( NULL );
+}
+
+static void ssl_cache_sharded_lru_unlink( mbedtls_ssl_cache_shard *shard,
+                                          mbedtls_ssl_cache_sharded_entry *entry )
+{
+    if( entry->lru_prev != NULL )
+        entry->lru_prev->lru_next = entry->lru_next;
+    else
+        shard->lru_head = entry->lru_next;
+
+    if( entry->lru_next != NULL )
+        entry->lru_next->lru_prev = entry->lru_prev;
+    else
+        shard->lru_tail = entry->lru_prev;
+
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void ssl_cache_sharded_lru_push( mbedtls_ssl_cache_shard *shard,
+                                        mbedtls_ssl_cache_sharded_entry *entry )
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+
+    if( shard->lru_head != NULL )
+        shard->lru_head->lru_prev = entry;
+    else
+        shard->lru_tail = entry;
+
+    shard->lru_head = entry;
+}
+
+/*
+ * Remove an entry from both its hash bucket and the LRU list,
+ * without freeing it
+ */
+static void ssl_cache_sharded_unlink( const mbedtls_ssl_cache_sharded_context *cache,
+                                      mbedtls_ssl_cache_shard *shard,
+                                      mbedtls_ssl_cache_sharded_entry *entry )
+{
+    mbedtls_ssl_cache_sharded_entry **pp;
+
+    pp = ssl_cache_sharded_bucket( cache, shard, entry->hash );
+
+    while( *pp != NULL && *pp != entry )
+        pp = &(*pp)->hnext;
+
+    if( *pp != NULL )
+        *pp = entry->hnext;
+
+    entry->hnext = NULL;
+
+    ssl_cache_sharded_lru_unlink( shard, entry );
+}
+
+/*
+ * Release the data held by an entry, leaving it ready for reuse
+ */
+static void ssl_cache_sharded_entry_clear( mbedtls_ssl_cache_sharded_entry *entry )
+{
+    mbedtls_ssl_session_free( &entry->session );
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    mbedtls_free( entry->peer_cert.p );
+    memset( &entry->peer_cert, 0, sizeof( mbedtls_x509_buf ) );
+#endif
+}
+
+static void ssl_cache_sharded_remove( const mbedtls_ssl_cache_sharded_context *cache,
+                                      mbedtls_ssl_cache_shard *shard,
+                                      mbedtls_ssl_cache_sharded_entry *entry )
+{
+    ssl_cache_sharded_unlink( cache, shard, entry );
+    ssl_cache_sharded_entry_clear( entry );
+    mbedtls_free( entry );
+
+    shard->count--;
+}
+
+int mbedtls_ssl_cache_sharded_setup( mbedtls_ssl_cache_sharded_context *cache,
+                                     unsigned int shards,
+                                     size_t max_entries )
+{
+    unsigned int bits = 0, i;
+    size_t per_shard, buckets = 1;
+
+    if( cache->shards != NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    if( shards == 0 )
+        shards = MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_SHARDS;
+
+    if( shards > MBEDTLS_SSL_CACHE_SHARDED_MAX_SHARDS || max_entries == 0 )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    while( ( 1u << bits ) < shards )
+        bits++;
+    shards = 1u << bits;
+
+    per_shard = max_entries / shards + ( max_entries % shards != 0 );
+
+    if( per_shard > ( (size_t) -1 ) / 2 / sizeof( mbedtls_ssl_cache_sharded_entry * ) )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    while( buckets < per_shard )
+        buckets <<= 1;
+
+    cache->shards = mbedtls_calloc( shards, sizeof( mbedtls_ssl_cache_shard ) );
+    if( cache->shards == NULL )
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+
+    cache->shard_bits = bits;
+
+    for( i = 0; i < shards; i++ )
+    {
+        mbedtls_ssl_cache_shard *shard = &cache->shards[i];
+
+#if defined(MBEDTLS_THREADING_C)
+        mbedtls_mutex_init( &shard->mutex );
+#endif
+
+        shard->max_entries = per_shard;
+        shard->bucket_mask = buckets - 1;
+        shard->buckets = mbedtls_calloc( buckets,
+                                 sizeof( mbedtls_ssl_cache_sharded_entry * ) );
+    }
+
+    for( i = 0; i < shards; i++ )
+    {
+        if( cache->shards[i].buckets == NULL )
+        {
+            mbedtls_ssl_cache_sharded_free( cache );
+            return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+        }
+    }
+
+    return( 0 );
+}
+
+int mbedtls_ssl_cache_sharded_get( void *data, mbedtls_ssl_session *session )
+{
+    int ret = 1;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time( NULL );
+#endif
+    mbedtls_ssl_cache_sharded_context *cache = (mbedtls_ssl_cache_sharded_context *) data;
+    mbedtls_ssl_cache_shard *shard;
+    mbedtls_ssl_cache_sharded_entry *entry;
+    uint32_t hash;
+
+    if( cache == NULL || cache->shards == NULL ||
+        session->id_len > sizeof( session->id ) )
+    {
+        return( 1 );
+    }
+
+    hash = ssl_cache_sharded_hash( session->id, session->id_len );
+    shard = ssl_cache_sharded_select( cache, hash );
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_lock( &shard->mutex ) != 0 )
+        return( 1 );
+#endif
+
+    entry = ssl_cache_sharded_find( cache, shard, hash,
+                                    session->id, session->id_len );
+    if( entry == NULL )
+        goto exit;
+
+#if defined(MBEDTLS_HAVE_TIME)
+    if( cache->timeout != 0 &&
+        (int) ( t - entry->timestamp ) > cache->timeout )
+    {
+        ssl_cache_sharded_remove( cache, shard, entry );
+        goto exit;
+    }
+#endif
+
+    if( session->ciphersuite != entry->session.ciphersuite ||
+        session->compression != entry->session.compression )
+    {
+        goto exit;
+    }
+
+    memcpy( session->master, entry->session.master, 48 );
+
+    session->verify_result = entry->session.verify_result;
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    /*
+     * Restore peer certificate (without rest of the original chain)
+     */
+    if( entry->peer_cert.p != NULL )
+    {
+        if( ( session->peer_cert = mbedtls_calloc( 1,
+                             sizeof(mbedtls_x509_crt) ) ) == NULL )
+        {
+            goto exit;
+        }
+
+        mbedtls_x509_crt_init( session->peer_cert );
+        if( mbedtls_x509_crt_parse( session->peer_cert, entry->peer_cert.p,
+                            entry->peer_cert.len ) != 0 )
+        {
+            mbedtls_free( session->peer_cert );
+            session->peer_cert = NULL;
+            goto exit;
+        }
+    }
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
+
+    ssl_cache_sharded_lru_unlink( shard, entry );
+    ssl_cache_sharded_lru_push( shard, entry );
+
+    ret = 0;
+
+exit:
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_unlock( &shard->mutex ) != 0 )
+        ret = 1;
+#endif
+
+    return( ret );
+}
+
+int mbedtls_ssl_cache_sharded_set( void *data, const mbedtls_ssl_session *session )
+{
+    int ret = 1;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time( NULL );
+#endif
+    mbedtls_ssl_cache_sharded_context *cache = (mbedtls_ssl_cache_sharded_context *) data;
+    mbedtls_ssl_cache_shard *shard;
+    mbedtls_ssl_cache_sharded_entry *cur;
+    uint32_t hash;
+
+    if( cache == NULL || cache->shards == NULL ||
+        session->id_len > sizeof( session->id ) )
+    {
+        return( 1 );
+    }
+
+    hash = ssl_cache_sharded_hash( session->id, session->id_len );
+    shard = ssl_cache_sharded_select( cache, hash );
+
+#if defined(MBEDTLS_THREADING_C)
+    if( ( ret = mbedtls_mutex_lock( &shard->mutex ) ) != 0 )
+        return( ret );
+#endif
+
+    cur = ssl_cache_sharded_find( cache, shard, hash,
+                                  session->id, session->id_len );
+
+    if( cur != NULL )
+    {
+        /*
+         * Client reconnected: keep timestamp for session id, unless the
+         * entry already expired
+         */
+#if defined(MBEDTLS_HAVE_TIME)
+        if( cache->timeout != 0 &&
+            (int) ( t - cur->timestamp ) > cache->timeout )
+        {
+            cur->timestamp = t;
+        }
+#endif
+        ssl_cache_sharded_lru_unlink( shard, cur );
+        ssl_cache_sharded_entry_clear( cur );
+    }
+    else
+    {
+        if( shard->count >= shard->max_entries )
+        {
+            /*
+             * Shard is full: recycle the least recently used entry
+             */
+            cur = shard->lru_tail;
+            ssl_cache_sharded_unlink( cache, shard, cur );
+            ssl_cache_sharded_entry_clear( cur );
+        }
+        else
+        {
+            cur = mbedtls_calloc( 1, sizeof( mbedtls_ssl_cache_sharded_entry ) );
+            if( cur == NULL )
+            {
+                ret = 1;
+                goto exit;
+            }
+
+            shard->count++;
+        }
+
+        cur->hash = hash;
+        cur->hnext = *ssl_cache_sharded_bucket( cache, shard, hash );
+        *ssl_cache_sharded_bucket( cache, shard, hash ) = cur;
+
+#if defined(MBEDTLS_HAVE_TIME)
+        cur->timestamp = t;
+#endif
+    }
+
+    ssl_cache_sharded_lru_push( shard, cur );
+
+    memcpy( &cur->session, session, sizeof( mbedtls_ssl_session ) );
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+    /* Lean mode identity fields are not stored */
+    cur->session.peer_id = NULL;
+#endif
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    /*
+     * Store peer certificate
+     */
+    cur->session.peer_cert = NULL;
+
+    if( session->peer_cert != NULL )
+    {
+        cur->peer_cert.p = mbedtls_calloc( 1, session->peer_cert->raw.len );
+        if( cur->peer_cert.p == NULL )
+        {
+            /* Don't leave behind an entry that would resume without
+             * the peer's certificate */
+            ssl_cache_sharded_remove( cache, shard, cur );
+            ret = 1;
+            goto exit;
+        }
+
+        memcpy( cur->peer_cert.p, session->peer_cert->raw.p,
+                session->peer_cert->raw.len );
+        cur->peer_cert.len = session->peer_cert->raw.len;
+    }
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
+
+    ret = 0;
+
+exit:
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_unlock( &shard->mutex ) != 0 )
+        ret = 1;
+#endif
+
+    return( ret );
+}
+
+#if defined(MBEDTLS_HAVE_TIME)
+void mbedtls_ssl_cache_sharded_set_timeout( mbedtls_ssl_cache_sharded_context *cache,
+                                            int timeout )
+{
+    if( timeout < 0 ) timeout = 0;
+
+    cache->timeout = timeout;
+}
+#endif /* MBEDTLS_HAVE_TIME */
+
+void mbedtls_ssl_cache_sharded_free( mbedtls_ssl_cache_sharded_context *cache )
+{
+    mbedtls_ssl_cache_sharded_entry *cur, *prv;
+    unsigned int i;
+
+    if( cache == NULL || cache->shards == NULL )
+        return;
+
+    for( i = 0; i < ( 1u << cache->shard_bits ); i++ )
+    {
+        mbedtls_ssl_cache_shard *shard = &cache->shards[i];
+
+        cur = shard->lru_head;
+
+        while( cur != NULL )
+        {
+            prv = cur;
+            cur = cur->lru_next;
+
+            ssl_cache_sharded_entry_clear( prv );
+            mbedtls_free( prv );
+        }
+
+        mbedtls_free( shard->buckets );
+
+#if defined(MBEDTLS_THREADING_C)
+        mbedtls_mutex_free( &shard->mutex );
+#endif
+    }
+
+    mbedtls_free( cache->shards );
+    cache->shards = NULL;
+}
+
+#endif /* MBEDTLS_SSL_CACHE_SHARDED_C */
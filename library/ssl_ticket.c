@@ -58,62 +58,227 @@ void mbedtls_ssl_ticket_init( mbedtls_ssl_ticket_context *ctx )
 
 #define MAX_KEY_BYTES 32    /* 256 bits */
 
+static int ssl_ticket_lock( mbedtls_ssl_ticket_context *ctx )
+{
+#if defined(MBEDTLS_THREADING_C)
+    return( mbedtls_mutex_lock( &ctx->mutex ) );
+#else
+    ((void) ctx);
+    return( 0 );
+#endif
+}
+
+static int ssl_ticket_unlock( mbedtls_ssl_ticket_context *ctx )
+{
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
+        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
+#else
+    ((void) ctx);
+#endif
+    return( 0 );
+}
+
 /*
- * Generate/update a key
+ * Free a key and its pool of cipher contexts
+ */
+static void ssl_ticket_key_free( mbedtls_ssl_ticket_key *key )
+{
+    mbedtls_ssl_ticket_cipher *cur, *next;
+
+    if( key == NULL )
+        return;
+
+    for( cur = key->idle; cur != NULL; cur = next )
+    {
+        next = cur->next;
+        mbedtls_cipher_free( &cur->ctx );
+        mbedtls_free( cur );
+    }
+
+    mbedtls_zeroize( key, sizeof( mbedtls_ssl_ticket_key ) );
+    mbedtls_free( key );
+}
+
+/*
+ * Drop a reference to a key, and free it if it was the last one.
+ * Must be called with the context locked.
+ */
+static void ssl_ticket_key_release( mbedtls_ssl_ticket_key *key )
+{
+    if( key == NULL )
+        return;
+
+    if( --key->refcount == 0 )
+        ssl_ticket_key_free( key );
+}
+
+/*
+ * Generate a new key. It is not visible to other threads until it is
+ * published in ctx->keys, and never modified afterwards.
  */
 static int ssl_ticket_gen_key( mbedtls_ssl_ticket_context *ctx,
-                               unsigned char index )
+                               mbedtls_ssl_ticket_key **out )
 {
     int ret;
-    unsigned char buf[MAX_KEY_BYTES];
-    mbedtls_ssl_ticket_key *key = ctx->keys + index;
+    mbedtls_ssl_ticket_key *key;
+
+    key = mbedtls_calloc( 1, sizeof( mbedtls_ssl_ticket_key ) );
+    if( key == NULL )
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
 
 #if defined(MBEDTLS_HAVE_TIME)
     key->generation_time = (uint32_t) mbedtls_time( NULL );
 #endif
 
-    if( ( ret = ctx->f_rng( ctx->p_rng, key->name, sizeof( key->name ) ) ) != 0 )
+    if( ( ret = ctx->f_rng( ctx->p_rng, key->name, sizeof( key->name ) ) ) != 0 ||
+        ( ret = ctx->f_rng( ctx->p_rng, key->key, sizeof( key->key ) ) ) != 0 )
+    {
+        ssl_ticket_key_free( key );
+        return( ret );
+    }
+
+    /* Reference held by the context */
+    key->refcount = 1;
+
+    *out = key;
+
+    return( 0 );
+}
+
+/*
+ * Take a reference to a key, and an idle cipher context for it if any.
+ * Must be called with the context locked.
+ */
+static void ssl_ticket_key_acquire( mbedtls_ssl_ticket_key *key,
+                                    mbedtls_ssl_ticket_cipher **cipher )
+{
+    key->refcount++;
+
+    *cipher = key->idle;
+    if( *cipher != NULL )
+        key->idle = (*cipher)->next;
+}
+
+/*
+ * Set up a new cipher context for a key, when all the existing ones are in
+ * use by other threads. Called without holding the lock: the raw key is
+ * immutable and the caller holds a reference to it.
+ */
+static int ssl_ticket_cipher_new( const mbedtls_ssl_ticket_context *ctx,
+                                  const mbedtls_ssl_ticket_key *key,
+                                  mbedtls_ssl_ticket_cipher **out )
+{
+    int ret;
+    mbedtls_ssl_ticket_cipher *cipher;
+
+    cipher = mbedtls_calloc( 1, sizeof( mbedtls_ssl_ticket_cipher ) );
+    if( cipher == NULL )
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+
+    mbedtls_cipher_init( &cipher->ctx );
+
+    /* With GCM and CCM, same context can encrypt & decrypt */
+    if( ( ret = mbedtls_cipher_setup( &cipher->ctx, ctx->cipher_info ) ) != 0 ||
+        ( ret = mbedtls_cipher_setkey( &cipher->ctx, key->key,
+                                       ctx->cipher_info->key_bitlen,
+                                       MBEDTLS_ENCRYPT ) ) != 0 )
+    {
+        mbedtls_cipher_free( &cipher->ctx );
+        mbedtls_free( cipher );
         return( ret );
+    }
+
+    *out = cipher;
+
+    return( 0 );
+}
 
-    if( ( ret = ctx->f_rng( ctx->p_rng, buf, sizeof( buf ) ) ) != 0 )
+/*
+ * Return a cipher context to its key's pool and drop the reference taken by
+ * ssl_ticket_key_acquire()
+ */
+static int ssl_ticket_key_put( mbedtls_ssl_ticket_context *ctx,
+                               mbedtls_ssl_ticket_key *key,
+                               mbedtls_ssl_ticket_cipher *cipher )
+{
+    int ret;
+
+    if( ( ret = ssl_ticket_lock( ctx ) ) != 0 )
         return( ret );
 
-    /* With GCM and CCM, same context can encrypt & decrypt */
-    ret = mbedtls_cipher_setkey( &key->ctx, buf,
-                                 mbedtls_cipher_get_key_bitlen( &key->ctx ),
-                                 MBEDTLS_ENCRYPT );
+    if( cipher != NULL )
+    {
+        cipher->next = key->idle;
+        key->idle = cipher;
+    }
 
-    mbedtls_zeroize( buf, sizeof( buf ) );
+    ssl_ticket_key_release( key );
 
-    return( ret );
+    return( ssl_ticket_unlock( ctx ) );
 }
 
 /*
  * Rotate/generate keys if necessary
+ *
+ * The new key is generated without holding the lock, by the first thread
+ * noticing that the active key is too old; others keep using the current
+ * key meanwhile. Publishing the new key is a pointer swap. The retired key
+ * is freed once the last ticket operation using it completes.
  */
 static int ssl_ticket_update_keys( mbedtls_ssl_ticket_context *ctx )
 {
 #if !defined(MBEDTLS_HAVE_TIME)
     ((void) ctx);
+    return( 0 );
 #else
-    if( ctx->ticket_lifetime != 0 )
+    int ret, lock_ret, rotate = 0;
+    mbedtls_ssl_ticket_key *key = NULL;
+
+    if( ctx->ticket_lifetime == 0 )
+        return( 0 );
+
+    if( ( ret = ssl_ticket_lock( ctx ) ) != 0 )
+        return( ret );
+
+    if( ! ctx->rotating )
     {
         uint32_t current_time = (uint32_t) mbedtls_time( NULL );
-        uint32_t key_time = ctx->keys[ctx->active].generation_time;
+        uint32_t key_time = ctx->keys[ctx->active]->generation_time;
 
-        if( current_time > key_time &&
-            current_time - key_time < ctx->ticket_lifetime )
+        if( current_time <= key_time ||
+            current_time - key_time >= ctx->ticket_lifetime )
         {
-            return( 0 );
+            ctx->rotating = 1;
+            rotate = 1;
         }
+    }
 
-        ctx->active = 1 - ctx->active;
+    if( ( ret = ssl_ticket_unlock( ctx ) ) != 0 || rotate == 0 )
+        return( ret );
 
-        return( ssl_ticket_gen_key( ctx, ctx->active ) );
+    ret = ssl_ticket_gen_key( ctx, &key );
+
+    if( ( lock_ret = ssl_ticket_lock( ctx ) ) != 0 )
+    {
+        ssl_ticket_key_free( key );
+        return( lock_ret );
     }
-    else
+
+    if( ret == 0 )
+    {
+        ctx->active = 1 - ctx->active;
+        ssl_ticket_key_release( ctx->keys[ctx->active] );
+        ctx->keys[ctx->active] = key;
+    }
+
+    ctx->rotating = 0;
+
+    if( ( lock_ret = ssl_ticket_unlock( ctx ) ) != 0 )
+        return( lock_ret );
+
+    return( ret );
 #endif /* MBEDTLS_HAVE_TIME */
-        return( 0 );
 }
 
 /*
@@ -145,18 +310,23 @@ int mbedtls_ssl_ticket_setup( mbedtls_ssl_ticket_context *ctx,
     if( cipher_info->key_bitlen > 8 * MAX_KEY_BYTES )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
-    if( ( ret = mbedtls_cipher_setup( &ctx->keys[0].ctx, cipher_info ) ) != 0 ||
-        ( ret = mbedtls_cipher_setup( &ctx->keys[1].ctx, cipher_info ) ) != 0 )
-    {
+    if( ctx->keys[0] != NULL || ctx->keys[1] != NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    if( ( ret = ssl_ticket_gen_key( ctx, &ctx->keys[0] ) ) != 0 )
         return( ret );
-    }
 
-    if( ( ret = ssl_ticket_gen_key( ctx, 0 ) ) != 0 ||
-        ( ret = ssl_ticket_gen_key( ctx, 1 ) ) != 0 )
+    if( ( ret = ssl_ticket_gen_key( ctx, &ctx->keys[1] ) ) != 0 )
     {
+        /* Leave the context as it was, so that setup can be retried */
+        ssl_ticket_key_release( ctx->keys[0] );
+        ctx->keys[0] = NULL;
         return( ret );
     }
 
+    /* Marks the context as ready for use */
+    ctx->cipher_info = cipher_info;
+
     return( 0 );
 }
 
@@ -225,6 +395,11 @@ static int ssl_load_session( mbedtls_ssl_session *session,
     memcpy( session, p, sizeof( mbedtls_ssl_session ) );
     p += sizeof( mbedtls_ssl_session );
 
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+    /* Lean mode identity fields are not stored */
+    session->peer_id = NULL;
+#endif
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     if( p + 3 > end )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
@@ -289,9 +464,10 @@ int mbedtls_ssl_ticket_write( void *p_ticket,
                               size_t *tlen,
                               uint32_t *ticket_lifetime )
 {
-    int ret;
+    int ret, put_ret;
     mbedtls_ssl_ticket_context *ctx = p_ticket;
     mbedtls_ssl_ticket_key *key;
+    mbedtls_ssl_ticket_cipher *cipher;
     unsigned char *key_name = start;
     unsigned char *iv = start + 4;
     unsigned char *state_len_bytes = iv + 12;
@@ -301,7 +477,7 @@ int mbedtls_ssl_ticket_write( void *p_ticket,
 
     *tlen = 0;
 
-    if( ctx == NULL || ctx->f_rng == NULL )
+    if( ctx == NULL || ctx->f_rng == NULL || ctx->cipher_info == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
     /* We need at least 4 bytes for key_name, 12 for IV, 2 for len 16 for tag,
@@ -309,18 +485,27 @@ int mbedtls_ssl_ticket_write( void *p_ticket,
     if( end - start < 4 + 12 + 2 + 16 )
         return( MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL );
 
-#if defined(MBEDTLS_THREADING_C)
-    if( ( ret = mbedtls_mutex_lock( &ctx->mutex ) ) != 0 )
+    if( ( ret = ssl_ticket_update_keys( ctx ) ) != 0 )
         return( ret );
-#endif
 
-    if( ( ret = ssl_ticket_update_keys( ctx ) ) != 0 )
-        goto cleanup;
+    if( ( ret = ssl_ticket_lock( ctx ) ) != 0 )
+        return( ret );
 
-    key = &ctx->keys[ctx->active];
+    key = ctx->keys[ctx->active];
+    ssl_ticket_key_acquire( key, &cipher );
 
     *ticket_lifetime = ctx->ticket_lifetime;
 
+    /* The key reference and the cipher are given back at cleanup */
+    if( ( ret = ssl_ticket_unlock( ctx ) ) != 0 )
+        goto cleanup;
+
+    if( cipher == NULL &&
+        ( ret = ssl_ticket_cipher_new( ctx, key, &cipher ) ) != 0 )
+    {
+        goto cleanup;
+    }
+
     memcpy( key_name, key->name, 4 );
 
     if( ( ret = ctx->f_rng( ctx->p_rng, iv, 12 ) ) != 0 )
@@ -338,7 +523,7 @@ int mbedtls_ssl_ticket_write( void *p_ticket,
 
     /* Encrypt and authenticate */
     tag = state + clear_len;
-    if( ( ret = mbedtls_cipher_auth_encrypt( &key->ctx,
+    if( ( ret = mbedtls_cipher_auth_encrypt( &cipher->ctx,
                     iv, 12, key_name, 4 + 12 + 2,
                     state, clear_len, state, &ciph_len, tag, 16 ) ) != 0 )
     {
@@ -353,26 +538,32 @@ int mbedtls_ssl_ticket_write( void *p_ticket,
     *tlen = 4 + 12 + 2 + 16 + ciph_len;
 
 cleanup:
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
-        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
-#endif
+    if( ( put_ret = ssl_ticket_key_put( ctx, key, cipher ) ) != 0 )
+        return( put_ret );
 
     return( ret );
 }
 
 /*
- * Select key based on name
+ * Select key based on name, and take a reference to it.
+ * Must be called with the context locked.
  */
 static mbedtls_ssl_ticket_key *ssl_ticket_select_key(
         mbedtls_ssl_ticket_context *ctx,
-        const unsigned char name[4] )
+        const unsigned char name[4],
+        mbedtls_ssl_ticket_cipher **cipher )
 {
     unsigned char i;
 
     for( i = 0; i < sizeof( ctx->keys ) / sizeof( *ctx->keys ); i++ )
-        if( memcmp( name, ctx->keys[i].name, 4 ) == 0 )
-            return( &ctx->keys[i] );
+    {
+        if( ctx->keys[i] != NULL &&
+            memcmp( name, ctx->keys[i]->name, 4 ) == 0 )
+        {
+            ssl_ticket_key_acquire( ctx->keys[i], cipher );
+            return( ctx->keys[i] );
+        }
+    }
 
     return( NULL );
 }
@@ -385,9 +576,10 @@ int mbedtls_ssl_ticket_parse( void *p_ticket,
                               unsigned char *buf,
                               size_t len )
 {
-    int ret;
+    int ret, put_ret;
     mbedtls_ssl_ticket_context *ctx = p_ticket;
     mbedtls_ssl_ticket_key *key;
+    mbedtls_ssl_ticket_cipher *cipher = NULL;
     unsigned char *key_name = buf;
     unsigned char *iv = buf + 4;
     unsigned char *enc_len_p = iv + 12;
@@ -395,41 +587,47 @@ int mbedtls_ssl_ticket_parse( void *p_ticket,
     unsigned char *tag;
     size_t enc_len, clear_len;
 
-    if( ctx == NULL || ctx->f_rng == NULL )
+    if( ctx == NULL || ctx->f_rng == NULL || ctx->cipher_info == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
     /* See mbedtls_ssl_ticket_write() */
     if( len < 4 + 12 + 2 + 16 )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
-#if defined(MBEDTLS_THREADING_C)
-    if( ( ret = mbedtls_mutex_lock( &ctx->mutex ) ) != 0 )
-        return( ret );
-#endif
-
     if( ( ret = ssl_ticket_update_keys( ctx ) ) != 0 )
-        goto cleanup;
+        return( ret );
 
     enc_len = ( enc_len_p[0] << 8 ) | enc_len_p[1];
     tag = ticket + enc_len;
 
     if( len != 4 + 12 + 2 + enc_len + 16 )
-    {
-        ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
-        goto cleanup;
-    }
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
     /* Select key */
-    if( ( key = ssl_ticket_select_key( ctx, key_name ) ) == NULL )
+    if( ( ret = ssl_ticket_lock( ctx ) ) != 0 )
+        return( ret );
+
+    key = ssl_ticket_select_key( ctx, key_name, &cipher );
+
+    /* The key reference and the cipher are given back at cleanup */
+    if( ( ret = ssl_ticket_unlock( ctx ) ) != 0 )
+        goto cleanup;
+
+    if( key == NULL )
     {
         /* We can't know for sure but this is a likely option unless we're
          * under attack - this is only informative anyway */
-        ret = MBEDTLS_ERR_SSL_SESSION_TICKET_EXPIRED;
+        return( MBEDTLS_ERR_SSL_SESSION_TICKET_EXPIRED );
+    }
+
+    if( cipher == NULL &&
+        ( ret = ssl_ticket_cipher_new( ctx, key, &cipher ) ) != 0 )
+    {
         goto cleanup;
     }
 
     /* Decrypt and authenticate */
-    if( ( ret = mbedtls_cipher_auth_decrypt( &key->ctx, iv, 12,
+    if( ( ret = mbedtls_cipher_auth_decrypt( &cipher->ctx, iv, 12,
                     key_name, 4 + 12 + 2, ticket, enc_len,
                     ticket, &clear_len, tag, 16 ) ) != 0 )
     {
@@ -463,10 +661,8 @@ int mbedtls_ssl_ticket_parse( void *p_ticket,
 #endif
 
 cleanup:
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &ctx->mutex ) != 0 )
-        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
-#endif
+    if( ( put_ret = ssl_ticket_key_put( ctx, key, cipher ) ) != 0 )
+        return( put_ret );
 
     return( ret );
 }
@@ -476,8 +672,10 @@ cleanup:
  */
 void mbedtls_ssl_ticket_free( mbedtls_ssl_ticket_context *ctx )
 {
-    mbedtls_cipher_free( &ctx->keys[0].ctx );
-    mbedtls_cipher_free( &ctx->keys[1].ctx );
+    /* No ticket operation may be in progress at this point, so these are
+     * the last references */
+    ssl_ticket_key_release( ctx->keys[0] );
+    ssl_ticket_key_release( ctx->keys[1] );
 
 #if defined(MBEDTLS_THREADING_C)
     mbedtls_mutex_free( &ctx->mutex );
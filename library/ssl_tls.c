@@ -155,11 +155,399 @@ static unsigned int mfl_code_to_length[MBEDTLS_SSL_MAX_FRAG_LEN_INVALID] =
 };
 #endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+/*
+ * Dynamic record buffers: with buffer callbacks configured, TLS contexts
+ * only hold in_buf and out_buf while they are in use. While a buffer is
+ * released, the record counter that TLS keeps at its start lives in
+ * in_ctr_save / out_ctr_save, where in_ctr / out_ctr point.
+ */
+#define SSL_IN_BUFFER_LEN( ssl )    ( (ssl)->in_buf_len )
+#define SSL_OUT_BUFFER_LEN( ssl )   ( (ssl)->out_buf_len )
+
+static int ssl_buf_dynamic( const mbedtls_ssl_context *ssl )
+{
+    return( ssl->conf->f_buf_get != NULL &&
+            ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM );
+}
+
+/*
+ * Size of in_buf (out == 0) or out_buf (out == 1) for the current state:
+ * full-size during handshakes, as handshake messages are not fragmented,
+ * otherwise large enough for the negotiated maximum fragment length.
+ */
+static size_t ssl_buf_len_needed( const mbedtls_ssl_context *ssl, int out )
+{
+    size_t len = MBEDTLS_SSL_MAX_CONTENT_LEN;
+
+    if( ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
+        return( MBEDTLS_SSL_BUFFER_LEN );
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    if( out )
+        len = mbedtls_ssl_get_max_frag_len( ssl );
+    else
+    {
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+        /* A renegotiation ClientHello isn't fragmented either */
+        if( ssl->conf->disable_renegotiation ==
+                MBEDTLS_SSL_RENEGOTIATION_ENABLED )
+        {
+            return( MBEDTLS_SSL_BUFFER_LEN );
+        }
+#endif
+        if( ssl->session != NULL &&
+            mfl_code_to_length[ssl->session->mfl_code] < len )
+        {
+            len = mfl_code_to_length[ssl->session->mfl_code];
+        }
+    }
+#else
+    ((void) out);
+#endif
+
+    return( len + MBEDTLS_SSL_BUFFER_LEN - MBEDTLS_SSL_MAX_CONTENT_LEN );
+}
+
+static void ssl_buf_put( mbedtls_ssl_context *ssl,
+                         unsigned char *buf, size_t len )
+{
+    mbedtls_zeroize( buf, len );
+    ssl->conf->f_buf_put( ssl->conf->p_buf_pool, buf, len );
+}
+
+/*
+ * Make sure in_buf is held and large enough for the current state
+ */
+static int ssl_buf_in_get( mbedtls_ssl_context *ssl )
+{
+    unsigned char *buf;
+    size_t len;
+
+    if( ! ssl_buf_dynamic( ssl ) )
+        return( 0 );
+
+    len = ssl_buf_len_needed( ssl, 0 );
+    if( ssl->in_buf != NULL && ssl->in_buf_len >= len )
+        return( 0 );
+
+    if( ( buf = ssl->conf->f_buf_get( ssl->conf->p_buf_pool, len ) ) == NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "failed to get input buffer (%d bytes)",
+                                    len ) );
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "got input buffer (%d bytes)", len ) );
+
+    if( ssl->in_buf != NULL )
+    {
+        /* Growing for a handshake: keep what was already received */
+        memcpy( buf, ssl->in_buf, ssl->in_buf_len );
+        ssl->in_msg = buf + ( ssl->in_msg - ssl->in_buf );
+        if( ssl->in_offt != NULL )
+            ssl->in_offt = buf + ( ssl->in_offt - ssl->in_buf );
+
+        ssl_buf_put( ssl, ssl->in_buf, ssl->in_buf_len );
+    }
+    else
+    {
+        memcpy( buf, ssl->in_ctr_save, 8 );
+
+        if( ssl->transform_in != NULL &&
+            ssl->minor_ver >= MBEDTLS_SSL_MINOR_VERSION_2 )
+        {
+            ssl->in_msg = buf + 13 + ssl->transform_in->ivlen -
+                                     ssl->transform_in->fixed_ivlen;
+        }
+        else
+            ssl->in_msg = buf + 13;
+    }
+
+    ssl->in_buf = buf;
+    ssl->in_buf_len = len;
+    ssl->in_ctr = buf;
+    ssl->in_hdr = buf +  8;
+    ssl->in_len = buf + 11;
+    ssl->in_iv  = buf + 13;
+
+    return( 0 );
+}
+
+/*
+ * Make sure out_buf is held and large enough for the current state
+ */
+static int ssl_buf_out_get( mbedtls_ssl_context *ssl )
+{
+    unsigned char *buf;
+    size_t len;
+
+    if( ! ssl_buf_dynamic( ssl ) )
+        return( 0 );
+
+    len = ssl_buf_len_needed( ssl, 1 );
+    if( ssl->out_buf != NULL && ssl->out_buf_len >= len )
+        return( 0 );
+
+    if( ( buf = ssl->conf->f_buf_get( ssl->conf->p_buf_pool, len ) ) == NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "failed to get output buffer (%d bytes)",
+                                    len ) );
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "got output buffer (%d bytes)", len ) );
+
+    if( ssl->out_buf != NULL )
+    {
+        /* Growing for a handshake: keep what is waiting to be sent */
+        memcpy( buf, ssl->out_buf, ssl->out_buf_len );
+        ssl->out_msg = buf + ( ssl->out_msg - ssl->out_buf );
+
+        ssl_buf_put( ssl, ssl->out_buf, ssl->out_buf_len );
+    }
+    else
+    {
+        memcpy( buf, ssl->out_ctr_save, 8 );
+
+        if( ssl->transform_out != NULL &&
+            ssl->minor_ver >= MBEDTLS_SSL_MINOR_VERSION_2 )
+        {
+            ssl->out_msg = buf + 13 + ssl->transform_out->ivlen -
+                                      ssl->transform_out->fixed_ivlen;
+        }
+        else
+            ssl->out_msg = buf + 13;
+    }
+
+    ssl->out_buf = buf;
+    ssl->out_buf_len = len;
+    ssl->out_ctr = buf;
+    ssl->out_hdr = buf +  8;
+    ssl->out_len = buf + 11;
+    ssl->out_iv  = buf + 13;
+
+    return( 0 );
+}
+
+static void ssl_buf_in_put( mbedtls_ssl_context *ssl )
+{
+    if( ssl->in_buf == NULL )
+        return;
+
+    memcpy( ssl->in_ctr_save, ssl->in_ctr, 8 );
+    ssl_buf_put( ssl, ssl->in_buf, ssl->in_buf_len );
+
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "released input buffer" ) );
+
+    ssl->in_buf = NULL;
+    ssl->in_buf_len = 0;
+    ssl->in_ctr = ssl->in_ctr_save;
+    ssl->in_hdr = NULL;
+    ssl->in_len = NULL;
+    ssl->in_iv  = NULL;
+    ssl->in_msg = NULL;
+}
+
+static void ssl_buf_out_put( mbedtls_ssl_context *ssl )
+{
+    if( ssl->out_buf == NULL )
+        return;
+
+    memcpy( ssl->out_ctr_save, ssl->out_ctr, 8 );
+    ssl_buf_put( ssl, ssl->out_buf, ssl->out_buf_len );
+
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "released output buffer" ) );
+
+    ssl->out_buf = NULL;
+    ssl->out_buf_len = 0;
+    ssl->out_ctr = ssl->out_ctr_save;
+    ssl->out_hdr = NULL;
+    ssl->out_len = NULL;
+    ssl->out_iv  = NULL;
+    ssl->out_msg = NULL;
+}
+#else
+#define SSL_IN_BUFFER_LEN( ssl )    MBEDTLS_SSL_BUFFER_LEN
+#define SSL_OUT_BUFFER_LEN( ssl )   MBEDTLS_SSL_BUFFER_LEN
+#endif /* MBEDTLS_SSL_DYNAMIC_BUFFERS */
+
+/*
+ * Give back in_buf if nothing in it is needed any more: no application
+ * data left to read, no partial or read-ahead record, no handshake message
+ * left in the current record.
+ */
+static void ssl_buf_in_release_idle( mbedtls_ssl_context *ssl )
+{
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl_buf_dynamic( ssl ) &&
+        ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER &&
+        ssl->in_offt == NULL &&
+        ssl->in_left == 0 &&
+        ssl->next_record_offset == 0 &&
+        ssl->record_read == 0 &&
+        ( ssl->in_hslen == 0 || ssl->in_hslen >= ssl->in_msglen ) )
+    {
+        ssl_buf_in_put( ssl );
+    }
+#else
+    ((void) ssl);
+#endif
+}
+
+/*
+ * Give back out_buf if no record is waiting to be sent
+ */
+static void ssl_buf_out_release_idle( mbedtls_ssl_context *ssl )
+{
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl_buf_dynamic( ssl ) &&
+        ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER &&
+        ssl->out_left == 0 )
+    {
+        ssl_buf_out_put( ssl );
+    }
+#else
+    ((void) ssl);
+#endif
+}
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+/*
+ * Peer identity fields live in a single allocation: the structure is
+ * followed by the serial, issuer, subject and subject alt names, in order.
+ */
+static size_t ssl_peer_id_data_len( const mbedtls_ssl_peer_id *id )
+{
+    return( id->serial.len + id->issuer_raw.len + id->subject_raw.len +
+            id->subject_alt_names.len );
+}
+
+static unsigned char *ssl_peer_id_set_buf( mbedtls_x509_buf *buf,
+                                           unsigned char *p )
+{
+    buf->p = ( buf->len != 0 ) ? p : NULL;
+    return( p + buf->len );
+}
+
+static void ssl_peer_id_rebase( mbedtls_ssl_peer_id *id )
+{
+    unsigned char *p = (unsigned char *)( id + 1 );
+
+    p = ssl_peer_id_set_buf( &id->serial, p );
+    p = ssl_peer_id_set_buf( &id->issuer_raw, p );
+    p = ssl_peer_id_set_buf( &id->subject_raw, p );
+    (void) ssl_peer_id_set_buf( &id->subject_alt_names, p );
+}
+
+static mbedtls_ssl_peer_id *ssl_peer_id_dup( const mbedtls_ssl_peer_id *src )
+{
+    size_t len = sizeof( mbedtls_ssl_peer_id ) + ssl_peer_id_data_len( src );
+    mbedtls_ssl_peer_id *dst;
+
+    if( ( dst = mbedtls_calloc( 1, len ) ) == NULL )
+        return( NULL );
+
+    memcpy( dst, src, len );
+    ssl_peer_id_rebase( dst );
+
+    return( dst );
+}
+
+/*
+ * Size of a dNSName GeneralName TLV with a value of len bytes
+ */
+static size_t ssl_peer_id_dns_name_len( size_t len )
+{
+    return( 1 + ( len < 0x80 ? 1 : len < 0x100 ? 2 : 3 ) + len );
+}
+
+/*
+ * Extract the requested fields of crt
+ */
+static mbedtls_ssl_peer_id *ssl_peer_id_extract( const mbedtls_x509_crt *crt,
+                                                 unsigned char fields )
+{
+    mbedtls_ssl_peer_id id, *dst;
+    const mbedtls_x509_sequence *cur;
+    unsigned char *p;
+
+    memset( &id, 0, sizeof( id ) );
+    id.fields = fields;
+
+    if( fields & MBEDTLS_SSL_PEER_ID_SERIAL )
+        id.serial = crt->serial;
+    if( fields & MBEDTLS_SSL_PEER_ID_ISSUER )
+        id.issuer_raw = crt->issuer_raw;
+    if( fields & MBEDTLS_SSL_PEER_ID_SUBJECT )
+        id.subject_raw = crt->subject_raw;
+    if( fields & MBEDTLS_SSL_PEER_ID_VALIDITY )
+    {
+        id.valid_from = crt->valid_from;
+        id.valid_to = crt->valid_to;
+    }
+    if( fields & MBEDTLS_SSL_PEER_ID_SUBJECT_ALT_NAMES )
+    {
+        id.subject_alt_names.tag = MBEDTLS_ASN1_CONSTRUCTED |
+                                   MBEDTLS_ASN1_SEQUENCE;
+        for( cur = &crt->subject_alt_names; cur != NULL; cur = cur->next )
+        {
+            if( cur->buf.p != NULL )
+                id.subject_alt_names.len +=
+                    ssl_peer_id_dns_name_len( cur->buf.len );
+        }
+    }
+
+    dst = mbedtls_calloc( 1, sizeof( id ) + ssl_peer_id_data_len( &id ) );
+    if( dst == NULL )
+        return( NULL );
+
+    memcpy( dst, &id, sizeof( id ) );
+    ssl_peer_id_rebase( dst );
+
+    if( dst->serial.len != 0 )
+        memcpy( dst->serial.p, id.serial.p, id.serial.len );
+    if( dst->issuer_raw.len != 0 )
+        memcpy( dst->issuer_raw.p, id.issuer_raw.p, id.issuer_raw.len );
+    if( dst->subject_raw.len != 0 )
+        memcpy( dst->subject_raw.p, id.subject_raw.p, id.subject_raw.len );
+
+    /* The parser only keeps the dNSName entries, re-encode them */
+    p = dst->subject_alt_names.p;
+    if( fields & MBEDTLS_SSL_PEER_ID_SUBJECT_ALT_NAMES )
+    {
+        for( cur = &crt->subject_alt_names; cur != NULL; cur = cur->next )
+        {
+            if( cur->buf.p == NULL )
+                continue;
+
+            *p++ = MBEDTLS_ASN1_CONTEXT_SPECIFIC | 2;
+            if( cur->buf.len >= 0x100 )
+            {
+                *p++ = 0x82;
+                *p++ = (unsigned char)( cur->buf.len >> 8 );
+            }
+            else if( cur->buf.len >= 0x80 )
+                *p++ = 0x81;
+            *p++ = (unsigned char)( cur->buf.len );
+
+            memcpy( p, cur->buf.p, cur->buf.len );
+            p += cur->buf.len;
+        }
+    }
+
+    return( dst );
+}
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS && MBEDTLS_X509_CRT_PARSE_C */
+
 #if defined(MBEDTLS_SSL_CLI_C)
 static int ssl_session_copy( mbedtls_ssl_session *dst, const mbedtls_ssl_session *src )
 {
     mbedtls_ssl_session_free( dst );
     memcpy( dst, src, sizeof( mbedtls_ssl_session ) );
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+    dst->peer_id = NULL;
+#endif
 
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     if( src->peer_cert != NULL )
@@ -193,6 +581,14 @@ static int ssl_session_copy( mbedtls_ssl_session *dst, const mbedtls_ssl_session
     }
 #endif /* MBEDTLS_SSL_SESSION_TICKETS && MBEDTLS_SSL_CLI_C */
 
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+    if( src->peer_id != NULL &&
+        ( dst->peer_id = ssl_peer_id_dup( src->peer_id ) ) == NULL )
+    {
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+    }
+#endif
+
     return( 0 );
 }
 #endif /* MBEDTLS_SSL_CLI_C */
@@ -2195,7 +2591,8 @@ static int ssl_compress_buf( mbedtls_ssl_context *ssl )
     ssl->transform_out->ctx_deflate.next_in = msg_pre;
     ssl->transform_out->ctx_deflate.avail_in = len_pre;
     ssl->transform_out->ctx_deflate.next_out = msg_post;
-    ssl->transform_out->ctx_deflate.avail_out = MBEDTLS_SSL_BUFFER_LEN;
+    ssl->transform_out->ctx_deflate.avail_out = SSL_OUT_BUFFER_LEN( ssl ) -
+                                    (size_t)( ssl->out_msg - ssl->out_buf );
 
     ret = deflate( &ssl->transform_out->ctx_deflate, Z_SYNC_FLUSH );
     if( ret != Z_OK )
@@ -2204,7 +2601,8 @@ static int ssl_compress_buf( mbedtls_ssl_context *ssl )
         return( MBEDTLS_ERR_SSL_COMPRESSION_FAILED );
     }
 
-    ssl->out_msglen = MBEDTLS_SSL_BUFFER_LEN -
+    ssl->out_msglen = SSL_OUT_BUFFER_LEN( ssl ) -
+                      (size_t)( ssl->out_msg - ssl->out_buf ) -
                       ssl->transform_out->ctx_deflate.avail_out;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "after compression: msglen = %d, ",
@@ -2224,9 +2622,14 @@ static int ssl_decompress_buf( mbedtls_ssl_context *ssl )
     unsigned char *msg_post = ssl->in_msg;
     size_t len_pre = ssl->in_msglen;
     unsigned char *msg_pre = ssl->compress_buf;
+    size_t len_max = SSL_IN_BUFFER_LEN( ssl ) -
+                     (size_t)( ssl->in_msg - ssl->in_buf );
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> decompress buf" ) );
 
+    if( len_max > MBEDTLS_SSL_MAX_CONTENT_LEN )
+        len_max = MBEDTLS_SSL_MAX_CONTENT_LEN;
+
     if( len_pre == 0 )
         return( 0 );
 
@@ -2241,7 +2644,7 @@ static int ssl_decompress_buf( mbedtls_ssl_context *ssl )
     ssl->transform_in->ctx_inflate.next_in = msg_pre;
     ssl->transform_in->ctx_inflate.avail_in = len_pre;
     ssl->transform_in->ctx_inflate.next_out = msg_post;
-    ssl->transform_in->ctx_inflate.avail_out = MBEDTLS_SSL_MAX_CONTENT_LEN;
+    ssl->transform_in->ctx_inflate.avail_out = len_max;
 
     ret = inflate( &ssl->transform_in->ctx_inflate, Z_SYNC_FLUSH );
     if( ret != Z_OK )
@@ -2250,8 +2653,7 @@ static int ssl_decompress_buf( mbedtls_ssl_context *ssl )
         return( MBEDTLS_ERR_SSL_COMPRESSION_FAILED );
     }
 
-    ssl->in_msglen = MBEDTLS_SSL_MAX_CONTENT_LEN -
-                     ssl->transform_in->ctx_inflate.avail_out;
+    ssl->in_msglen = len_max - ssl->transform_in->ctx_inflate.avail_out;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "after decompression: msglen = %d, ",
                    ssl->in_msglen ) );
@@ -2296,6 +2698,67 @@ static int ssl_resend_hello_request( mbedtls_ssl_context *ssl )
 #endif
 #endif /* MBEDTLS_SSL_SRV_C && MBEDTLS_SSL_RENEGOTIATION */
 
+#if defined(MBEDTLS_SSL_PROTO_DTLS) || defined(MBEDTLS_SSL_RECORD_BATCHING)
+/*
+ * Discard the record just processed if data following it was read together
+ * with it (same datagram with DTLS, read ahead with TLS), moving that data
+ * to the start of the buffer.
+ */
+static int ssl_next_record( mbedtls_ssl_context *ssl )
+{
+    if( ssl->next_record_offset == 0 )
+        return( 0 );
+
+    if( ssl->in_left < ssl->next_record_offset )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "should never happen" ) );
+        return( MBEDTLS_ERR_SSL_INTERNAL_ERROR );
+    }
+
+    ssl->in_left -= ssl->next_record_offset;
+
+    if( ssl->in_left != 0 )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 2, ( "next record already read, offset: %d",
+                            ssl->next_record_offset ) );
+        memmove( ssl->in_hdr,
+                 ssl->in_hdr + ssl->next_record_offset,
+                 ssl->in_left );
+    }
+
+    ssl->next_record_offset = 0;
+
+    return( 0 );
+}
+#endif /* MBEDTLS_SSL_PROTO_DTLS || MBEDTLS_SSL_RECORD_BATCHING */
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+/*
+ * Read ahead only in the steady state of a TLS connection, where records
+ * are processed one at a time in place, and without compression, which
+ * may expand a record over the data that follows it.
+ */
+static int ssl_read_ahead( const mbedtls_ssl_context *ssl )
+{
+    if( ssl->conf->read_ahead != MBEDTLS_SSL_READ_AHEAD_ENABLED ||
+        ssl->conf->transport != MBEDTLS_SSL_TRANSPORT_STREAM ||
+        ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
+    {
+        return( 0 );
+    }
+
+#if defined(MBEDTLS_ZLIB_SUPPORT)
+    if( ssl->session_in != NULL &&
+        ssl->session_in->compression == MBEDTLS_SSL_COMPRESS_DEFLATE )
+    {
+        return( 0 );
+    }
+#endif
+
+    return( 1 );
+}
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
 /*
  * Fill the input message buffer by appending data to it.
  * The amount of data already fetched is in ssl->in_left.
@@ -2306,10 +2769,11 @@ static int ssl_resend_hello_request( mbedtls_ssl_context *ssl )
  *
  * With stream transport (TLS) on success ssl->in_left == nb_want, but
  * with datagram transport (DTLS) on success ssl->in_left >= nb_want,
- * since we always read a whole datagram at once.
+ * since we always read a whole datagram at once. The same applies to TLS
+ * when reading ahead (see ssl_read_ahead()).
  *
- * For DTLS, it is up to the caller to set ssl->next_record_offset when
- * they're done reading a record.
+ * For DTLS and TLS with read ahead, it is up to the caller to set
+ * ssl->next_record_offset when they're done reading a record.
  */
 int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
 {
@@ -2325,7 +2789,12 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
     }
 
-    if( nb_want > MBEDTLS_SSL_BUFFER_LEN - (size_t)( ssl->in_hdr - ssl->in_buf ) )
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buf_in_get( ssl ) ) != 0 )
+        return( ret );
+#endif
+
+    if( nb_want > SSL_IN_BUFFER_LEN( ssl ) - (size_t)( ssl->in_hdr - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "requesting more data than fits" ) );
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
@@ -2354,27 +2823,8 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         /*
          * Move to the next record in the already read datagram if applicable
          */
-        if( ssl->next_record_offset != 0 )
-        {
-            if( ssl->in_left < ssl->next_record_offset )
-            {
-                MBEDTLS_SSL_DEBUG_MSG( 1, ( "should never happen" ) );
-                return( MBEDTLS_ERR_SSL_INTERNAL_ERROR );
-            }
-
-            ssl->in_left -= ssl->next_record_offset;
-
-            if( ssl->in_left != 0 )
-            {
-                MBEDTLS_SSL_DEBUG_MSG( 2, ( "next record in same datagram, offset: %d",
-                                    ssl->next_record_offset ) );
-                memmove( ssl->in_hdr,
-                         ssl->in_hdr + ssl->next_record_offset,
-                         ssl->in_left );
-            }
-
-            ssl->next_record_offset = 0;
-        }
+        if( ( ret = ssl_next_record( ssl ) ) != 0 )
+            return( ret );
 
         MBEDTLS_SSL_DEBUG_MSG( 2, ( "in_left: %d, nb_want: %d",
                        ssl->in_left, nb_want ) );
@@ -2408,7 +2858,7 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
             ret = MBEDTLS_ERR_SSL_TIMEOUT;
         else
         {
-            len = MBEDTLS_SSL_BUFFER_LEN - ( ssl->in_hdr - ssl->in_buf );
+            len = SSL_IN_BUFFER_LEN( ssl ) - ( ssl->in_hdr - ssl->in_buf );
 
             if( ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
                 timeout = ssl->handshake->retransmit_timeout;
@@ -2473,6 +2923,14 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
     else
 #endif
     {
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+        /*
+         * Move to the next record read ahead if applicable
+         */
+        if( ( ret = ssl_next_record( ssl ) ) != 0 )
+            return( ret );
+#endif
+
         MBEDTLS_SSL_DEBUG_MSG( 2, ( "in_left: %d, nb_want: %d",
                        ssl->in_left, nb_want ) );
 
@@ -2480,6 +2938,13 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         {
             len = nb_want - ssl->in_left;
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+            /* Read as much as fits, possibly including the next records */
+            if( ssl_read_ahead( ssl ) )
+                len = SSL_IN_BUFFER_LEN( ssl ) -
+                      (size_t)( ssl->in_hdr - ssl->in_buf ) - ssl->in_left;
+#endif
+
             if( ssl_check_timer( ssl ) != 0 )
                 ret = MBEDTLS_ERR_SSL_TIMEOUT;
             else
@@ -2517,22 +2982,137 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
 }
 
 /*
- * Flush any data not yet written
+ * Increment the outgoing record counter once a record is complete
  */
-int mbedtls_ssl_flush_output( mbedtls_ssl_context *ssl )
+static int ssl_out_ctr_increment( mbedtls_ssl_context *ssl )
 {
-    int ret;
-    unsigned char *buf, i;
+    unsigned char i;
 
-    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> flush output" ) );
+    for( i = 8; i > ssl_ep_len( ssl ); i-- )
+        if( ++ssl->out_ctr[i - 1] != 0 )
+            break;
 
-    if( ssl->f_send == NULL )
+    /* The loop goes to its end iff the counter is wrapping */
+    if( i == ssl_ep_len( ssl ) )
     {
-        MBEDTLS_SSL_DEBUG_MSG( 1, ( "Bad usage of mbedtls_ssl_set_bio() "
-                            "or mbedtls_ssl_set_bio()" ) );
-        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "outgoing message counter would wrap" ) );
+        return( MBEDTLS_ERR_SSL_COUNTER_WRAPPING );
     }
 
+    return( 0 );
+}
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+/*
+ * Send the records held back in the batch buffer
+ */
+static int ssl_flush_batch( mbedtls_ssl_context *ssl )
+{
+    int ret;
+    unsigned char *buf;
+
+    if( ssl->out_batch_left == 0 )
+        return( 0 );
+
+    if( ssl->f_send == NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "Bad usage of mbedtls_ssl_set_bio() "
+                            "or mbedtls_ssl_set_bio()" ) );
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+    }
+
+    while( ssl->out_batch_left > 0 )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 2, ( "batch length: %d, out_batch_left: %d",
+                       ssl->out_batch_len, ssl->out_batch_left ) );
+
+        buf = ssl->out_batch + ssl->out_batch_len - ssl->out_batch_left;
+        ret = ssl->f_send( ssl->p_bio, buf, ssl->out_batch_left );
+
+        MBEDTLS_SSL_DEBUG_RET( 2, "ssl->f_send", ret );
+
+        if( ret <= 0 )
+            return( ret );
+
+        ssl->out_batch_left -= ret;
+    }
+
+    ssl->out_batch_len = 0;
+
+    return( 0 );
+}
+
+/*
+ * Should the record just protected go to the batch buffer?
+ * Only application data in the steady state of a TLS connection is held
+ * back, anything else is sent right away (after the batch).
+ */
+static int ssl_write_batching( const mbedtls_ssl_context *ssl )
+{
+    return( ssl->out_batch != NULL &&
+            ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM &&
+            ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER &&
+            ssl->out_msgtype == MBEDTLS_SSL_MSG_APPLICATION_DATA &&
+            ssl->out_batch_size - ssl->out_batch_len >= ssl->out_left );
+}
+
+/*
+ * Move the record just protected from out_buf to the batch buffer
+ */
+static int ssl_batch_record( mbedtls_ssl_context *ssl )
+{
+    int ret;
+
+    memcpy( ssl->out_batch + ssl->out_batch_len, ssl->out_hdr, ssl->out_left );
+    ssl->out_batch_len  += ssl->out_left;
+    ssl->out_batch_left += ssl->out_left;
+    ssl->out_left = 0;
+
+    if( ( ret = ssl_out_ctr_increment( ssl ) ) != 0 )
+        return( ret );
+
+    ssl_buf_out_release_idle( ssl );
+
+    /* Send the batch once it can't take another full-size record. The record
+     * is accepted anyway: if the transport would block, what is left will
+     * be sent on the next flush. */
+    if( ssl->out_batch_size - ssl->out_batch_len < MBEDTLS_SSL_BUFFER_LEN )
+    {
+        ret = ssl_flush_batch( ssl );
+        if( ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_WRITE &&
+            ret != MBEDTLS_ERR_SSL_WANT_READ )
+        {
+            return( ret );
+        }
+    }
+
+    return( 0 );
+}
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
+/*
+ * Flush any data not yet written
+ */
+int mbedtls_ssl_flush_output( mbedtls_ssl_context *ssl )
+{
+    int ret;
+    unsigned char *buf;
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> flush output" ) );
+
+    if( ssl->f_send == NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "Bad usage of mbedtls_ssl_set_bio() "
+                            "or mbedtls_ssl_set_bio()" ) );
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+    }
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    /* Records held back by batching go first */
+    if( ( ret = ssl_flush_batch( ssl ) ) != 0 )
+        return( ret );
+#endif
+
     /* Avoid incrementing counter if data is flushed */
     if( ssl->out_left == 0 )
     {
@@ -2557,16 +3137,10 @@ int mbedtls_ssl_flush_output( mbedtls_ssl_context *ssl )
         ssl->out_left -= ret;
     }
 
-    for( i = 8; i > ssl_ep_len( ssl ); i-- )
-        if( ++ssl->out_ctr[i - 1] != 0 )
-            break;
+    if( ( ret = ssl_out_ctr_increment( ssl ) ) != 0 )
+        return( ret );
 
-    /* The loop goes to its end iff the counter is wrapping */
-    if( i == ssl_ep_len( ssl ) )
-    {
-        MBEDTLS_SSL_DEBUG_MSG( 1, ( "outgoing message counter would wrap" ) );
-        return( MBEDTLS_ERR_SSL_COUNTER_WRAPPING );
-    }
+    ssl_buf_out_release_idle( ssl );
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= flush output" ) );
 
@@ -2952,6 +3526,21 @@ int mbedtls_ssl_write_record( mbedtls_ssl_context *ssl )
                        ssl->out_hdr, mbedtls_ssl_hdr_len( ssl ) + ssl->out_msglen );
     }
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    if( ssl_write_batching( ssl ) )
+    {
+        if( ( ret = ssl_batch_record( ssl ) ) != 0 )
+        {
+            MBEDTLS_SSL_DEBUG_RET( 1, "ssl_batch_record", ret );
+            return( ret );
+        }
+
+        MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write record" ) );
+
+        return( 0 );
+    }
+#endif
+
     if( ( ret = mbedtls_ssl_flush_output( ssl ) ) != 0 )
     {
         MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ssl_flush_output", ret );
@@ -3159,7 +3748,7 @@ static int ssl_reassemble_dtls_handshake( mbedtls_ssl_context *ssl )
         ssl->next_record_offset = new_remain - ssl->in_hdr;
         ssl->in_left = ssl->next_record_offset + remain_len;
 
-        if( ssl->in_left > MBEDTLS_SSL_BUFFER_LEN -
+        if( ssl->in_left > SSL_IN_BUFFER_LEN( ssl ) -
                            (size_t)( ssl->in_hdr - ssl->in_buf ) )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "reassembled message too large for buffer" ) );
@@ -3623,7 +4212,7 @@ static int ssl_parse_record_header( mbedtls_ssl_context *ssl )
     }
 
     /* Check length against the size of our buffer */
-    if( ssl->in_msglen > MBEDTLS_SSL_BUFFER_LEN
+    if( ssl->in_msglen > SSL_IN_BUFFER_LEN( ssl )
                          - (size_t)( ssl->in_msg - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
@@ -3817,6 +4406,9 @@ static int ssl_prepare_record_content( mbedtls_ssl_context *ssl )
 }
 
 static void ssl_handshake_wrapup_free_hs_transform( mbedtls_ssl_context *ssl );
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+static void ssl_handshake_free_key_exchange( mbedtls_ssl_handshake_params *handshake );
+#endif
 
 /*
  * Read a record.
@@ -3941,6 +4533,11 @@ read_record_header:
     if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
         ssl->next_record_offset = ssl->in_msglen + mbedtls_ssl_hdr_len( ssl );
     else
+#endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    if( ssl->in_left > ssl->in_msglen + mbedtls_ssl_hdr_len( ssl ) )
+        ssl->next_record_offset = ssl->in_msglen + mbedtls_ssl_hdr_len( ssl );
+    else
 #endif
         ssl->in_left = 0;
 
@@ -4136,6 +4733,11 @@ int mbedtls_ssl_send_alert_message( mbedtls_ssl_context *ssl,
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> send alert message" ) );
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "send alert level=%u message=%u", level, message ));
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buf_out_get( ssl ) ) != 0 )
+        return( ret );
+#endif
+
     ssl->out_msgtype = MBEDTLS_SSL_MSG_ALERT;
     ssl->out_msglen = 2;
     ssl->out_msg[0] = level;
@@ -4327,6 +4929,244 @@ write_msg:
     return( ret );
 }
 
+/*
+ * Verify the peer's certificate chain, or start or resume its asynchronous
+ * verification
+ */
+static int ssl_verify_peer_cert( mbedtls_ssl_context *ssl,
+                                 mbedtls_x509_crt *ca_chain,
+                                 mbedtls_x509_crl *ca_crl )
+{
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    int ret;
+
+    if( ssl->handshake->async_verify_in_progress == 0 &&
+        ssl->conf->f_async_verify_start != NULL )
+    {
+        ret = ssl->conf->f_async_verify_start( ssl->conf->p_async_verify, ssl,
+                                               ssl->session_negotiate->peer_cert,
+                                               ca_chain, ca_crl,
+                                               ssl->conf->cert_profile,
+                                               ssl->hostname );
+        switch( ret )
+        {
+            case MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH:
+                /* Verify locally as if there were no callback */
+                break;
+            case 0:
+                ssl->handshake->async_verify_in_progress = 1;
+                break;
+            case MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS:
+                ssl->handshake->async_verify_in_progress = 1;
+                return( ret );
+            default:
+                MBEDTLS_SSL_DEBUG_RET( 1, "f_async_verify_start", ret );
+                return( ret );
+        }
+    }
+
+    if( ssl->handshake->async_verify_in_progress != 0 )
+    {
+        ret = ssl->conf->f_async_verify_resume( ssl->conf->p_async_verify, ssl,
+                                &ssl->session_negotiate->verify_result );
+
+        if( ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
+        {
+            ssl->handshake->async_verify_in_progress = 0;
+            mbedtls_ssl_set_async_operation_data( ssl, NULL );
+        }
+
+        MBEDTLS_SSL_DEBUG_RET( 2, "f_async_verify_resume", ret );
+        return( ret );
+    }
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    if( ssl->conf->verify_cache != NULL )
+    {
+        return( mbedtls_x509_crt_verify_with_cache(
+                                ssl->session_negotiate->peer_cert,
+                                ca_chain, ca_crl,
+                                ssl->conf->cert_profile,
+                                ssl->conf->verify_cache,
+                                ssl->hostname,
+                               &ssl->session_negotiate->verify_result,
+                                ssl->conf->f_vrfy, ssl->conf->p_vrfy ) );
+    }
+#endif
+
+    return( mbedtls_x509_crt_verify_with_profile(
+                                ssl->session_negotiate->peer_cert,
+                                ca_chain, ca_crl,
+                                ssl->conf->cert_profile,
+                                ssl->hostname,
+                               &ssl->session_negotiate->verify_result,
+                                ssl->conf->f_vrfy, ssl->conf->p_vrfy ) );
+}
+
+/*
+ * Verify the peer's certificate chain against the trusted CAs, and do the
+ * secondary checks that depend on the handshake; send an alert on failure
+ */
+static int ssl_parse_certificate_verify( mbedtls_ssl_context *ssl,
+                                         int authmode )
+{
+    int ret;
+    const mbedtls_ssl_ciphersuite_t *ciphersuite_info = ssl->transform_negotiate->ciphersuite_info;
+    mbedtls_x509_crt *ca_chain;
+    mbedtls_x509_crl *ca_crl;
+    uint8_t alert;
+
+#if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
+    if( ssl->handshake->sni_ca_chain != NULL )
+    {
+        ca_chain = ssl->handshake->sni_ca_chain;
+        ca_crl   = ssl->handshake->sni_ca_crl;
+    }
+    else
+#endif
+    {
+        ca_chain = ssl->conf->ca_chain;
+        ca_crl   = ssl->conf->ca_crl;
+    }
+
+    /*
+     * Main check: verify certificate
+     */
+    ret = ssl_verify_peer_cert( ssl, ca_chain, ca_crl );
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    if( ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
+        return( ret );
+#endif
+
+    if( ret != 0 )
+    {
+        MBEDTLS_SSL_DEBUG_RET( 1, "x509_verify_cert", ret );
+    }
+
+    /*
+     * Secondary checks: always done, but change 'ret' only if it was 0
+     */
+
+#if defined(MBEDTLS_ECP_C)
+    {
+        const mbedtls_pk_context *pk = &ssl->session_negotiate->peer_cert->pk;
+
+        /* If certificate uses an EC key, make sure the curve is OK */
+        if( mbedtls_pk_can_do( pk, MBEDTLS_PK_ECKEY ) &&
+            mbedtls_ssl_check_curve( ssl, mbedtls_pk_ec( *pk )->grp.id ) != 0 )
+        {
+            ssl->session_negotiate->verify_result |= MBEDTLS_X509_BADCERT_BAD_KEY;
+
+            MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad certificate (EC key curve)" ) );
+            if( ret == 0 )
+                ret = MBEDTLS_ERR_SSL_BAD_HS_CERTIFICATE;
+        }
+    }
+#endif /* MBEDTLS_ECP_C */
+
+    if( mbedtls_ssl_check_cert_usage( ssl->session_negotiate->peer_cert,
+                             ciphersuite_info,
+                             ! ssl->conf->endpoint,
+                             &ssl->session_negotiate->verify_result ) != 0 )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad certificate (usage extensions)" ) );
+        if( ret == 0 )
+            ret = MBEDTLS_ERR_SSL_BAD_HS_CERTIFICATE;
+    }
+
+    /* mbedtls_x509_crt_verify_with_profile is supposed to report a
+     * verification failure through MBEDTLS_ERR_X509_CERT_VERIFY_FAILED,
+     * with details encoded in the verification flags. All other kinds
+     * of error codes, including those from the user provided f_vrfy
+     * functions, are treated as fatal and lead to a failure of
+     * ssl_parse_certificate even if verification was optional. */
+    if( authmode == MBEDTLS_SSL_VERIFY_OPTIONAL &&
+        ( ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED ||
+          ret == MBEDTLS_ERR_SSL_BAD_HS_CERTIFICATE ) )
+    {
+        ret = 0;
+    }
+
+    if( ca_chain == NULL && authmode == MBEDTLS_SSL_VERIFY_REQUIRED )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "got no CA chain" ) );
+        ret = MBEDTLS_ERR_SSL_CA_CHAIN_REQUIRED;
+    }
+
+    if( ret != 0 )
+    {
+        /* The certificate may have been rejected for several reasons.
+           Pick one and send the corresponding alert. Which alert to send
+           may be a subject of debate in some cases. */
+        if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_OTHER )
+            alert = MBEDTLS_SSL_ALERT_MSG_ACCESS_DENIED;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_CN_MISMATCH )
+            alert = MBEDTLS_SSL_ALERT_MSG_BAD_CERT;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_KEY_USAGE )
+            alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_EXT_KEY_USAGE )
+            alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_NS_CERT_TYPE )
+            alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_BAD_PK )
+            alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_BAD_KEY )
+            alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_EXPIRED )
+            alert = MBEDTLS_SSL_ALERT_MSG_CERT_EXPIRED;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_REVOKED )
+            alert = MBEDTLS_SSL_ALERT_MSG_CERT_REVOKED;
+        else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_NOT_TRUSTED )
+            alert = MBEDTLS_SSL_ALERT_MSG_UNKNOWN_CA;
+        else
+            alert = MBEDTLS_SSL_ALERT_MSG_CERT_UNKNOWN;
+        mbedtls_ssl_send_alert_message( ssl, MBEDTLS_SSL_ALERT_LEVEL_FATAL,
+                                        alert );
+    }
+
+#if defined(MBEDTLS_DEBUG_C)
+    if( ssl->session_negotiate->verify_result != 0 )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 3, ( "! Certificate verification flags %x",
+                                    ssl->session_negotiate->verify_result ) );
+    }
+    else
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 3, ( "Certificate verification flags clear" ) );
+    }
+#endif /* MBEDTLS_DEBUG_C */
+
+    return( ret );
+}
+
+#if defined(MBEDTLS_SSL_RENEGOTIATION) && defined(MBEDTLS_SSL_CLI_C)
+/*
+ * Compare the certificate of an established session with a new one,
+ * through its digest if the certificate was released in lean mode
+ */
+static int ssl_peer_cert_changed( const mbedtls_ssl_session *session,
+                                  const mbedtls_x509_crt *crt )
+{
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    if( session->peer_cert == NULL )
+    {
+        unsigned char digest[MBEDTLS_SSL_PEER_CERT_DIGEST_LEN];
+
+        mbedtls_sha256( crt->raw.p, crt->raw.len, digest, 0 );
+
+        return( memcmp( digest, session->peer_cert_digest,
+                        sizeof( digest ) ) != 0 );
+    }
+#endif
+
+    return( session->peer_cert->raw.len != crt->raw.len ||
+            memcmp( session->peer_cert->raw.p, crt->raw.p,
+                    crt->raw.len ) != 0 );
+}
+#endif /* MBEDTLS_SSL_RENEGOTIATION && MBEDTLS_SSL_CLI_C */
+
 int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
 {
     int ret = MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
@@ -4373,6 +5213,15 @@ int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
     }
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    /* The chain was parsed already if its verification is pending */
+    if( ssl->handshake->async_verify_in_progress != 0 )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 2, ( "resuming certificate verification" ) );
+        goto crt_verify;
+    }
+#endif
+
     if( ( ret = mbedtls_ssl_read_record( ssl ) ) != 0 )
     {
         /* mbedtls_ssl_read_record may have sent an alert already. We
@@ -4381,8 +5230,6 @@ int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
         return( ret );
     }
 
-    ssl->state++;
-
 #if defined(MBEDTLS_SSL_SRV_C)
 #if defined(MBEDTLS_SSL_PROTO_SSL3)
     /*
@@ -4402,6 +5249,7 @@ int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
                one. The client should know what's going on, so we
                don't send an alert. */
             ssl->session_negotiate->verify_result = MBEDTLS_X509_BADCERT_MISSING;
+            ssl->state++;
             if( authmode == MBEDTLS_SSL_VERIFY_OPTIONAL )
                 return( 0 );
             else
@@ -4426,6 +5274,7 @@ int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
                one. The client should know what's going on, so we
                don't send an alert. */
             ssl->session_negotiate->verify_result = MBEDTLS_X509_BADCERT_MISSING;
+            ssl->state++;
             if( authmode == MBEDTLS_SSL_VERIFY_OPTIONAL )
                 return( 0 );
             else
@@ -4551,7 +5400,11 @@ int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
     if( ssl->conf->endpoint == MBEDTLS_SSL_IS_CLIENT &&
         ssl->renego_status == MBEDTLS_SSL_RENEGOTIATION_IN_PROGRESS )
     {
-        if( ssl->session->peer_cert == NULL )
+        if( ssl->session->peer_cert == NULL
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+            && ssl->session->peer_cert_digest_len == 0
+#endif
+          )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "new server cert during renegotiation" ) );
             mbedtls_ssl_send_alert_message( ssl, MBEDTLS_SSL_ALERT_LEVEL_FATAL,
@@ -4559,11 +5412,8 @@ int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
             return( MBEDTLS_ERR_SSL_BAD_HS_CERTIFICATE );
         }
 
-        if( ssl->session->peer_cert->raw.len !=
-            ssl->session_negotiate->peer_cert->raw.len ||
-            memcmp( ssl->session->peer_cert->raw.p,
-                    ssl->session_negotiate->peer_cert->raw.p,
-                    ssl->session->peer_cert->raw.len ) != 0 )
+        if( ssl_peer_cert_changed( ssl->session,
+                                   ssl->session_negotiate->peer_cert ) )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "server cert changed during renegotiation" ) );
             mbedtls_ssl_send_alert_message( ssl, MBEDTLS_SSL_ALERT_LEVEL_FATAL,
@@ -4573,135 +5423,23 @@ int mbedtls_ssl_parse_certificate( mbedtls_ssl_context *ssl )
     }
 #endif /* MBEDTLS_SSL_RENEGOTIATION && MBEDTLS_SSL_CLI_C */
 
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+crt_verify:
+#endif
     if( authmode != MBEDTLS_SSL_VERIFY_NONE )
     {
-        mbedtls_x509_crt *ca_chain;
-        mbedtls_x509_crl *ca_crl;
+        ret = ssl_parse_certificate_verify( ssl, authmode );
 
-#if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
-        if( ssl->handshake->sni_ca_chain != NULL )
-        {
-            ca_chain = ssl->handshake->sni_ca_chain;
-            ca_crl   = ssl->handshake->sni_ca_crl;
-        }
-        else
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+        /* Stay in this state until the verification has completed */
+        if( ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
+            return( ret );
 #endif
-        {
-            ca_chain = ssl->conf->ca_chain;
-            ca_crl   = ssl->conf->ca_crl;
-        }
+    }
 
-        /*
-         * Main check: verify certificate
-         */
-        ret = mbedtls_x509_crt_verify_with_profile(
-                                ssl->session_negotiate->peer_cert,
-                                ca_chain, ca_crl,
-                                ssl->conf->cert_profile,
-                                ssl->hostname,
-                               &ssl->session_negotiate->verify_result,
-                                ssl->conf->f_vrfy, ssl->conf->p_vrfy );
+    ssl->state++;
 
-        if( ret != 0 )
-        {
-            MBEDTLS_SSL_DEBUG_RET( 1, "x509_verify_cert", ret );
-        }
-
-        /*
-         * Secondary checks: always done, but change 'ret' only if it was 0
-         */
-
-#if defined(MBEDTLS_ECP_C)
-        {
-            const mbedtls_pk_context *pk = &ssl->session_negotiate->peer_cert->pk;
-
-            /* If certificate uses an EC key, make sure the curve is OK */
-            if( mbedtls_pk_can_do( pk, MBEDTLS_PK_ECKEY ) &&
-                mbedtls_ssl_check_curve( ssl, mbedtls_pk_ec( *pk )->grp.id ) != 0 )
-            {
-                ssl->session_negotiate->verify_result |= MBEDTLS_X509_BADCERT_BAD_KEY;
-
-                MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad certificate (EC key curve)" ) );
-                if( ret == 0 )
-                    ret = MBEDTLS_ERR_SSL_BAD_HS_CERTIFICATE;
-            }
-        }
-#endif /* MBEDTLS_ECP_C */
-
-        if( mbedtls_ssl_check_cert_usage( ssl->session_negotiate->peer_cert,
-                                 ciphersuite_info,
-                                 ! ssl->conf->endpoint,
-                                 &ssl->session_negotiate->verify_result ) != 0 )
-        {
-            MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad certificate (usage extensions)" ) );
-            if( ret == 0 )
-                ret = MBEDTLS_ERR_SSL_BAD_HS_CERTIFICATE;
-        }
-
-        /* mbedtls_x509_crt_verify_with_profile is supposed to report a
-         * verification failure through MBEDTLS_ERR_X509_CERT_VERIFY_FAILED,
-         * with details encoded in the verification flags. All other kinds
-         * of error codes, including those from the user provided f_vrfy
-         * functions, are treated as fatal and lead to a failure of
-         * ssl_parse_certificate even if verification was optional. */
-        if( authmode == MBEDTLS_SSL_VERIFY_OPTIONAL &&
-            ( ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED ||
-              ret == MBEDTLS_ERR_SSL_BAD_HS_CERTIFICATE ) )
-        {
-            ret = 0;
-        }
-
-        if( ca_chain == NULL && authmode == MBEDTLS_SSL_VERIFY_REQUIRED )
-        {
-            MBEDTLS_SSL_DEBUG_MSG( 1, ( "got no CA chain" ) );
-            ret = MBEDTLS_ERR_SSL_CA_CHAIN_REQUIRED;
-        }
-
-        if( ret != 0 )
-        {
-            /* The certificate may have been rejected for several reasons.
-               Pick one and send the corresponding alert. Which alert to send
-               may be a subject of debate in some cases. */
-            if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_OTHER )
-                alert = MBEDTLS_SSL_ALERT_MSG_ACCESS_DENIED;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_CN_MISMATCH )
-                alert = MBEDTLS_SSL_ALERT_MSG_BAD_CERT;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_KEY_USAGE )
-                alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_EXT_KEY_USAGE )
-                alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_NS_CERT_TYPE )
-                alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_BAD_PK )
-                alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_BAD_KEY )
-                alert = MBEDTLS_SSL_ALERT_MSG_UNSUPPORTED_CERT;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_EXPIRED )
-                alert = MBEDTLS_SSL_ALERT_MSG_CERT_EXPIRED;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_REVOKED )
-                alert = MBEDTLS_SSL_ALERT_MSG_CERT_REVOKED;
-            else if( ssl->session_negotiate->verify_result & MBEDTLS_X509_BADCERT_NOT_TRUSTED )
-                alert = MBEDTLS_SSL_ALERT_MSG_UNKNOWN_CA;
-            else
-                alert = MBEDTLS_SSL_ALERT_MSG_CERT_UNKNOWN;
-            mbedtls_ssl_send_alert_message( ssl, MBEDTLS_SSL_ALERT_LEVEL_FATAL,
-                                            alert );
-        }
-
-#if defined(MBEDTLS_DEBUG_C)
-        if( ssl->session_negotiate->verify_result != 0 )
-        {
-            MBEDTLS_SSL_DEBUG_MSG( 3, ( "! Certificate verification flags %x",
-                                        ssl->session_negotiate->verify_result ) );
-        }
-        else
-        {
-            MBEDTLS_SSL_DEBUG_MSG( 3, ( "Certificate verification flags clear" ) );
-        }
-#endif /* MBEDTLS_DEBUG_C */
-    }
-
-    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= parse certificate" ) );
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= parse certificate" ) );
 
     return( ret );
 }
@@ -5159,6 +5897,56 @@ static void ssl_calc_finished_tls_sha384(
 #endif /* MBEDTLS_SHA512_C */
 #endif /* MBEDTLS_SSL_PROTO_TLS1_2 */
 
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+/*
+ * Replace the peer's certificate chain with a digest of its end-entity
+ * certificate and the fields the application asked for. On allocation
+ * failure, the chain is simply kept.
+ */
+static void ssl_session_release_peer_cert( const mbedtls_ssl_context *ssl,
+                                           mbedtls_ssl_session *session,
+                                           unsigned char fields )
+{
+    mbedtls_x509_crt *crt = session->peer_cert;
+    ((void) ssl);
+
+    if( crt == NULL )
+        return;
+
+    if( fields != 0 &&
+        ( session->peer_id = ssl_peer_id_extract( crt, fields ) ) == NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "alloc(peer_id) failed, keeping peer cert" ) );
+        return;
+    }
+
+    mbedtls_sha256( crt->raw.p, crt->raw.len, session->peer_cert_digest, 0 );
+    session->peer_cert_digest_len = MBEDTLS_SSL_PEER_CERT_DIGEST_LEN;
+
+    mbedtls_x509_crt_free( crt );
+    mbedtls_free( crt );
+    session->peer_cert = NULL;
+}
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
+
+static void ssl_handshake_wrapup_release( mbedtls_ssl_context *ssl )
+{
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "=> handshake wrapup: lean release" ) );
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    ssl_session_release_peer_cert( ssl, ssl->session,
+                                   ssl->conf->peer_id_fields );
+#endif
+
+    /* Only left when the last flight is kept for retransmission */
+    if( ssl->handshake != NULL )
+        ssl_handshake_free_key_exchange( ssl->handshake );
+
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "<= handshake wrapup: lean release" ) );
+}
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS */
+
 static void ssl_handshake_wrapup_free_hs_transform( mbedtls_ssl_context *ssl )
 {
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "=> handshake wrapup: final free" ) );
@@ -5166,7 +5954,7 @@ static void ssl_handshake_wrapup_free_hs_transform( mbedtls_ssl_context *ssl )
     /*
      * Free our handshake params
      */
-    mbedtls_ssl_handshake_free( ssl->handshake );
+    mbedtls_ssl_handshake_free( ssl );
     mbedtls_free( ssl->handshake );
     ssl->handshake = NULL;
 
@@ -5241,6 +6029,11 @@ void mbedtls_ssl_handshake_wrapup( mbedtls_ssl_context *ssl )
 #endif
         ssl_handshake_wrapup_free_hs_transform( ssl );
 
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    if( ssl->conf->lean == MBEDTLS_SSL_LEAN_ENABLED )
+        ssl_handshake_wrapup_release( ssl );
+#endif
+
     ssl->state++;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "<= handshake wrapup" ) );
@@ -5515,13 +6308,15 @@ void mbedtls_ssl_session_init( mbedtls_ssl_session *session )
 
 static int ssl_handshake_init( mbedtls_ssl_context *ssl )
 {
-    /* Clear old handshake information if present */
+    /* Clear old handshake information if present. The handshake goes
+     * first: an asynchronous verification of the peer certificate in
+     * session_negotiate is cancelled there. */
+    if( ssl->handshake )
+        mbedtls_ssl_handshake_free( ssl );
     if( ssl->transform_negotiate )
         mbedtls_ssl_transform_free( ssl->transform_negotiate );
     if( ssl->session_negotiate )
         mbedtls_ssl_session_free( ssl->session_negotiate );
-    if( ssl->handshake )
-        mbedtls_ssl_handshake_free( ssl->handshake );
 
     /*
      * Either the pointers are now NULL or cleared properly and can be freed.
@@ -5620,19 +6415,12 @@ void mbedtls_ssl_init( mbedtls_ssl_context *ssl )
 }
 
 /*
- * Setup an SSL context
+ * Allocate the record buffers for the lifetime of the context
  */
-int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
-                       const mbedtls_ssl_config *conf )
+static int ssl_alloc_buffers( mbedtls_ssl_context *ssl )
 {
-    int ret;
     const size_t len = MBEDTLS_SSL_BUFFER_LEN;
 
-    ssl->conf = conf;
-
-    /*
-     * Prepare base structures
-     */
     if( ( ssl-> in_buf = mbedtls_calloc( 1, len ) ) == NULL ||
         ( ssl->out_buf = mbedtls_calloc( 1, len ) ) == NULL )
     {
@@ -5642,8 +6430,13 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
         return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    ssl->in_buf_len  = len;
+    ssl->out_buf_len = len;
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
-    if( conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
+    if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
     {
         ssl->out_hdr = ssl->out_buf;
         ssl->out_ctr = ssl->out_buf +  3;
@@ -5673,6 +6466,49 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
         ssl->in_msg = ssl->in_buf + 13;
     }
 
+    return( 0 );
+}
+
+/*
+ * Setup an SSL context
+ */
+int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
+                       const mbedtls_ssl_config *conf )
+{
+    int ret;
+
+    ssl->conf = conf;
+
+    /*
+     * Prepare base structures
+     */
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl_buf_dynamic( ssl ) )
+    {
+        /* Buffers are taken from the pool when needed */
+        ssl->in_ctr  = ssl->in_ctr_save;
+        ssl->out_ctr = ssl->out_ctr_save;
+    }
+    else
+#endif
+    if( ( ret = ssl_alloc_buffers( ssl ) ) != 0 )
+        return( ret );
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    if( conf->write_batch_len != 0 &&
+        conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM )
+    {
+        if( ( ssl->out_batch = mbedtls_calloc( 1, conf->write_batch_len ) ) == NULL )
+        {
+            MBEDTLS_SSL_DEBUG_MSG( 1, ( "alloc(%d bytes) failed",
+                                        conf->write_batch_len ) );
+            return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+        }
+
+        ssl->out_batch_size = conf->write_batch_len;
+    }
+#endif
+
     if( ( ret = ssl_handshake_init( ssl ) ) != 0 )
         return( ret );
 
@@ -5707,13 +6543,12 @@ static int ssl_session_reset_int( mbedtls_ssl_context *ssl, int partial )
 
     ssl->in_offt = NULL;
 
-    ssl->in_msg = ssl->in_buf + 13;
     ssl->in_msgtype = 0;
     ssl->in_msglen = 0;
     if( partial == 0 )
         ssl->in_left = 0;
-#if defined(MBEDTLS_SSL_PROTO_DTLS)
     ssl->next_record_offset = 0;
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
     ssl->in_epoch = 0;
 #endif
 #if defined(MBEDTLS_SSL_DTLS_ANTI_REPLAY)
@@ -5724,7 +6559,6 @@ static int ssl_session_reset_int( mbedtls_ssl_context *ssl, int partial )
     ssl->nb_zero = 0;
     ssl->record_read = 0;
 
-    ssl->out_msg = ssl->out_buf + 13;
     ssl->out_msgtype = 0;
     ssl->out_msglen = 0;
     ssl->out_left = 0;
@@ -5732,13 +6566,33 @@ static int ssl_session_reset_int( mbedtls_ssl_context *ssl, int partial )
     if( ssl->split_done != MBEDTLS_SSL_CBC_RECORD_SPLITTING_DISABLED )
         ssl->split_done = 0;
 #endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    ssl->out_batch_len = 0;
+    ssl->out_batch_left = 0;
+#endif
 
     ssl->transform_in = NULL;
     ssl->transform_out = NULL;
 
-    memset( ssl->out_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
-    if( partial == 0 )
-        memset( ssl->in_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl_buf_dynamic( ssl ) )
+    {
+        /* The next handshake takes new, full-size buffers */
+        ssl_buf_in_put( ssl );
+        ssl_buf_out_put( ssl );
+        memset( ssl->in_ctr_save, 0, 8 );
+        memset( ssl->out_ctr_save, 0, 8 );
+    }
+    else
+#endif
+    {
+        ssl->in_msg = ssl->in_buf + 13;
+        ssl->out_msg = ssl->out_buf + 13;
+
+        memset( ssl->out_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+        if( partial == 0 )
+            memset( ssl->in_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+    }
 
 #if defined(MBEDTLS_SSL_HW_RECORD_ACCEL)
     if( mbedtls_ssl_hw_record_reset != NULL )
@@ -6012,6 +6866,14 @@ void mbedtls_ssl_conf_ca_chain( mbedtls_ssl_config *conf,
     conf->ca_chain   = ca_chain;
     conf->ca_crl     = ca_crl;
 }
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+void mbedtls_ssl_conf_verify_cache( mbedtls_ssl_config *conf,
+                                    mbedtls_x509_verify_cache *cache )
+{
+    conf->verify_cache = cache;
+}
+#endif
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
@@ -6354,6 +7216,45 @@ void mbedtls_ssl_conf_cbc_record_splitting( mbedtls_ssl_config *conf, char split
 }
 #endif
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+void mbedtls_ssl_conf_buffer_pool( mbedtls_ssl_config *conf,
+        void *p_pool,
+        unsigned char *(*f_get)( void *, size_t ),
+        void (*f_put)( void *, unsigned char *, size_t ) )
+{
+    conf->p_buf_pool = p_pool;
+    conf->f_buf_get  = f_get;
+    conf->f_buf_put  = f_put;
+}
+#endif /* MBEDTLS_SSL_DYNAMIC_BUFFERS */
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+void mbedtls_ssl_conf_write_batching( mbedtls_ssl_config *conf, size_t len )
+{
+    conf->write_batch_len = len;
+}
+
+void mbedtls_ssl_conf_read_ahead( mbedtls_ssl_config *conf, char read_ahead )
+{
+    conf->read_ahead = read_ahead;
+}
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+void mbedtls_ssl_conf_lean( mbedtls_ssl_config *conf, char lean )
+{
+    conf->lean = lean;
+}
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+void mbedtls_ssl_conf_peer_id_fields( mbedtls_ssl_config *conf,
+                                      unsigned char fields )
+{
+    conf->peer_id_fields = fields;
+}
+#endif
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS */
+
 void mbedtls_ssl_conf_legacy_renegotiation( mbedtls_ssl_config *conf, int allow_legacy )
 {
     conf->allow_legacy_renegotiation = allow_legacy;
@@ -6408,6 +7309,54 @@ void mbedtls_ssl_conf_export_keys_cb( mbedtls_ssl_config *conf,
 }
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+void mbedtls_ssl_conf_async_private_cb( mbedtls_ssl_config *conf,
+        mbedtls_ssl_async_sign_t *f_async_sign_start,
+        mbedtls_ssl_async_decrypt_t *f_async_decrypt_start,
+        mbedtls_ssl_async_resume_t *f_async_resume,
+        mbedtls_ssl_async_cancel_t *f_async_cancel,
+        void *p_async )
+{
+    conf->f_async_sign_start = f_async_sign_start;
+    conf->f_async_decrypt_start = f_async_decrypt_start;
+    conf->f_async_resume = f_async_resume;
+    conf->f_async_cancel = f_async_cancel;
+    conf->p_async = p_async;
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+void mbedtls_ssl_conf_async_verify_cb( mbedtls_ssl_config *conf,
+        mbedtls_ssl_async_verify_start_t *f_async_verify_start,
+        mbedtls_ssl_async_verify_resume_t *f_async_verify_resume,
+        mbedtls_ssl_async_verify_cancel_t *f_async_verify_cancel,
+        void *p_async_verify )
+{
+    conf->f_async_verify_start = f_async_verify_start;
+    conf->f_async_verify_resume = f_async_verify_resume;
+    conf->f_async_verify_cancel = f_async_verify_cancel;
+    conf->p_async_verify = p_async_verify;
+}
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) || defined(MBEDTLS_SSL_ASYNC_VERIFY)
+
+void *mbedtls_ssl_get_async_operation_data( const mbedtls_ssl_context *ssl )
+{
+    if( ssl->handshake == NULL )
+        return( NULL );
+
+    return( ssl->handshake->user_async_ctx );
+}
+
+void mbedtls_ssl_set_async_operation_data( mbedtls_ssl_context *ssl,
+                                           void *ctx )
+{
+    if( ssl->handshake != NULL )
+        ssl->handshake->user_async_ctx = ctx;
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE || MBEDTLS_SSL_ASYNC_VERIFY */
+
 /*
  * SSL get accessors
  */
@@ -6416,6 +7365,26 @@ size_t mbedtls_ssl_get_bytes_avail( const mbedtls_ssl_context *ssl )
     return( ssl->in_offt == NULL ? 0 : ssl->in_msglen );
 }
 
+int mbedtls_ssl_check_pending( const mbedtls_ssl_context *ssl )
+{
+    /* Application data not read yet */
+    if( ssl->in_offt != NULL )
+        return( 1 );
+
+    /* More handshake messages in the current record */
+    if( ssl->in_hslen != 0 && ssl->in_hslen < ssl->in_msglen )
+        return( 1 );
+
+    /* More records in the current datagram, or read ahead */
+    if( ssl->next_record_offset != 0 &&
+        ssl->in_left > ssl->next_record_offset )
+    {
+        return( 1 );
+    }
+
+    return( 0 );
+}
+
 uint32_t mbedtls_ssl_get_verify_result( const mbedtls_ssl_context *ssl )
 {
     if( ssl->session != NULL )
@@ -6538,6 +7507,29 @@ const mbedtls_x509_crt *mbedtls_ssl_get_peer_cert( const mbedtls_ssl_context *ss
 
     return( ssl->session->peer_cert );
 }
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+const unsigned char *mbedtls_ssl_get_peer_cert_digest(
+                                        const mbedtls_ssl_context *ssl )
+{
+    if( ssl == NULL || ssl->session == NULL ||
+        ssl->session->peer_cert_digest_len == 0 )
+    {
+        return( NULL );
+    }
+
+    return( ssl->session->peer_cert_digest );
+}
+
+const mbedtls_ssl_peer_id *mbedtls_ssl_get_peer_id(
+                                        const mbedtls_ssl_context *ssl )
+{
+    if( ssl == NULL || ssl->session == NULL )
+        return( NULL );
+
+    return( ssl->session->peer_id );
+}
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS */
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
 #if defined(MBEDTLS_SSL_CLI_C)
@@ -6565,6 +7557,16 @@ int mbedtls_ssl_handshake_step( mbedtls_ssl_context *ssl )
     if( ssl == NULL || ssl->conf == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buf_in_get( ssl ) ) != 0 ||
+        ( ret = ssl_buf_out_get( ssl ) ) != 0 )
+    {
+        return( ret );
+    }
+
+    ret = MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif
+
 #if defined(MBEDTLS_SSL_CLI_C)
     if( ssl->conf->endpoint == MBEDTLS_SSL_IS_CLIENT )
         ret = mbedtls_ssl_handshake_client_step( ssl );
@@ -6597,6 +7599,10 @@ int mbedtls_ssl_handshake( mbedtls_ssl_context *ssl )
             break;
     }
 
+    /* Handshake buffers are full-size, don't keep them around */
+    ssl_buf_in_release_idle( ssl );
+    ssl_buf_out_release_idle( ssl );
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= handshake" ) );
 
     return( ret );
@@ -6613,6 +7619,11 @@ static int ssl_write_hello_request( mbedtls_ssl_context *ssl )
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write hello request" ) );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buf_out_get( ssl ) ) != 0 )
+        return( ret );
+#endif
+
     ssl->out_msglen  = 4;
     ssl->out_msgtype = MBEDTLS_SSL_MSG_HANDSHAKE;
     ssl->out_msg[0]  = MBEDTLS_SSL_HS_HELLO_REQUEST;
@@ -6763,17 +7774,21 @@ static int ssl_check_ctr_renegotiate( mbedtls_ssl_context *ssl )
 #endif /* MBEDTLS_SSL_RENEGOTIATION */
 
 /*
- * Receive application data decrypted from the SSL layer
+ * Make sure decrypted application data is available at ssl->in_offt,
+ * reading and processing records as necessary.
+ *
+ * Returns 0 with ssl->in_offt != NULL when application data is available,
+ * 0 with ssl->in_offt == NULL on EOF, or an error code.
  */
-int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
+static int ssl_read_prepare( mbedtls_ssl_context *ssl )
 {
     int ret, record_read = 0;
-    size_t n;
 
-    if( ssl == NULL || ssl->conf == NULL )
-        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
-
-    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> read" ) );
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    /* The peer may be waiting for what we wrote before answering */
+    if( ( ret = ssl_flush_batch( ssl ) ) != 0 )
+        return( ret );
+#endif
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
@@ -7000,6 +8015,28 @@ int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
 #endif
     }
 
+    return( 0 );
+}
+
+/*
+ * Receive application data decrypted from the SSL layer
+ */
+int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
+{
+    int ret;
+    size_t n;
+
+    if( ssl == NULL || ssl->conf == NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> read" ) );
+
+    if( ( ret = ssl_read_prepare( ssl ) ) != 0 || ssl->in_offt == NULL )
+    {
+        ssl_buf_in_release_idle( ssl );
+        return( ret );
+    }
+
     n = ( len < ssl->in_msglen )
         ? len : ssl->in_msglen;
 
@@ -7013,17 +8050,104 @@ int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
         /* more data available */
         ssl->in_offt += n;
 
+    ssl_buf_in_release_idle( ssl );
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= read" ) );
 
     return( (int) n );
 }
 
+/*
+ * Lend the caller the decrypted application data of the current record
+ */
+int mbedtls_ssl_read_borrow( mbedtls_ssl_context *ssl,
+                             const unsigned char **buf, size_t *len )
+{
+    int ret;
+
+    if( ssl == NULL || ssl->conf == NULL || buf == NULL || len == NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> read borrow" ) );
+
+    *buf = NULL;
+    *len = 0;
+
+    if( ( ret = ssl_read_prepare( ssl ) ) != 0 || ssl->in_offt == NULL )
+    {
+        ssl_buf_in_release_idle( ssl );
+        return( ret );
+    }
+
+    /* Never lend more than what is left of the current record: the bytes
+     * following it in in_buf are not (yet) authenticated plaintext */
+    *buf = ssl->in_offt;
+    *len = ssl->in_msglen;
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= read borrow" ) );
+
+    return( (int) ssl->in_msglen );
+}
+
+/*
+ * Release application data obtained from mbedtls_ssl_read_borrow()
+ */
+int mbedtls_ssl_read_consume( mbedtls_ssl_context *ssl, size_t len )
+{
+    if( ssl == NULL || ssl->in_offt == NULL || len > ssl->in_msglen )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    ssl->in_msglen -= len;
+
+    if( ssl->in_msglen == 0 )
+        /* all bytes consumed  */
+        ssl->in_offt = NULL;
+    else
+        /* more data available */
+        ssl->in_offt += len;
+
+    ssl_buf_in_release_idle( ssl );
+
+    return( 0 );
+}
+
+/*
+ * Copy len bytes starting at offset in the concatenation of iov to dst
+ */
+static void ssl_iov_copy( unsigned char *dst, const mbedtls_ssl_iovec *iov,
+                          size_t offset, size_t len )
+{
+    size_t n;
+
+    if( len == 0 )
+        return;
+
+    while( offset >= iov->len )
+        offset -= iov++->len;
+
+    while( len > 0 )
+    {
+        n = iov->len - offset;
+        if( n > len )
+            n = len;
+
+        memcpy( dst, iov->buf + offset, n );
+
+        dst += n;
+        len -= n;
+        offset = 0;
+        iov++;
+    }
+}
+
 /*
  * Send application data to be encrypted by the SSL layer,
- * taking care of max fragment length and buffer size
+ * taking care of max fragment length and buffer size.
+ * The data is the len bytes starting at offset in the concatenation of iov.
  */
 static int ssl_write_real( mbedtls_ssl_context *ssl,
-                           const unsigned char *buf, size_t len )
+                           const mbedtls_ssl_iovec *iov,
+                           size_t offset, size_t len )
 {
     int ret;
 #if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
@@ -7055,9 +8179,14 @@ static int ssl_write_real( mbedtls_ssl_context *ssl,
     }
     else
     {
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+        if( ( ret = ssl_buf_out_get( ssl ) ) != 0 )
+            return( ret );
+#endif
+
         ssl->out_msglen  = len;
         ssl->out_msgtype = MBEDTLS_SSL_MSG_APPLICATION_DATA;
-        memcpy( ssl->out_msg, buf, len );
+        ssl_iov_copy( ssl->out_msg, iov, offset, len );
 
         if( ( ret = mbedtls_ssl_write_record( ssl ) ) != 0 )
         {
@@ -7078,7 +8207,7 @@ static int ssl_write_real( mbedtls_ssl_context *ssl,
  */
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
 static int ssl_write_split( mbedtls_ssl_context *ssl,
-                            const unsigned char *buf, size_t len )
+                            const mbedtls_ssl_iovec *iov, size_t len )
 {
     int ret;
 
@@ -7089,17 +8218,17 @@ static int ssl_write_split( mbedtls_ssl_context *ssl,
         mbedtls_cipher_get_cipher_mode( &ssl->transform_out->cipher_ctx_enc )
                                 != MBEDTLS_MODE_CBC )
     {
-        return( ssl_write_real( ssl, buf, len ) );
+        return( ssl_write_real( ssl, iov, 0, len ) );
     }
 
     if( ssl->split_done == 0 )
     {
-        if( ( ret = ssl_write_real( ssl, buf, 1 ) ) <= 0 )
+        if( ( ret = ssl_write_real( ssl, iov, 0, 1 ) ) <= 0 )
             return( ret );
         ssl->split_done = 1;
     }
 
-    if( ( ret = ssl_write_real( ssl, buf + 1, len - 1 ) ) <= 0 )
+    if( ( ret = ssl_write_real( ssl, iov, 1, len - 1 ) ) <= 0 )
         return( ret );
     ssl->split_done = 0;
 
@@ -7108,17 +8237,12 @@ static int ssl_write_split( mbedtls_ssl_context *ssl,
 #endif /* MBEDTLS_SSL_CBC_RECORD_SPLITTING */
 
 /*
- * Write application data (public-facing wrapper)
+ * Renegotiate or complete the handshake if needed before writing
  */
-int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len )
+static int ssl_write_check_state( mbedtls_ssl_context *ssl )
 {
     int ret;
 
-    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write" ) );
-
-    if( ssl == NULL || ssl->conf == NULL )
-        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
-
 #if defined(MBEDTLS_SSL_RENEGOTIATION)
     if( ( ret = ssl_check_ctr_renegotiate( ssl ) ) != 0 )
     {
@@ -7136,10 +8260,32 @@ int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_
         }
     }
 
+    return( 0 );
+}
+
+/*
+ * Write application data (public-facing wrapper)
+ */
+int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len )
+{
+    int ret;
+    mbedtls_ssl_iovec iov;
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write" ) );
+
+    if( ssl == NULL || ssl->conf == NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    if( ( ret = ssl_write_check_state( ssl ) ) != 0 )
+        return( ret );
+
+    iov.buf = buf;
+    iov.len = len;
+
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
-    ret = ssl_write_split( ssl, buf, len );
+    ret = ssl_write_split( ssl, &iov, len );
 #else
-    ret = ssl_write_real( ssl, buf, len );
+    ret = ssl_write_real( ssl, &iov, 0, len );
 #endif
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write" ) );
@@ -7147,6 +8293,173 @@ int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_
     return( ret );
 }
 
+/*
+ * Write application data gathered from several buffers
+ */
+int mbedtls_ssl_writev( mbedtls_ssl_context *ssl,
+                        const mbedtls_ssl_iovec *iov, size_t iovcnt )
+{
+    int ret;
+    size_t i, len = 0;
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> writev" ) );
+
+    if( ssl == NULL || ssl->conf == NULL || ( iov == NULL && iovcnt != 0 ) )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    for( i = 0; i < iovcnt; i++ )
+    {
+        if( iov[i].buf == NULL && iov[i].len != 0 )
+            return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+        if( len + iov[i].len < len )
+            return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+        len += iov[i].len;
+    }
+
+    if( ( ret = ssl_write_check_state( ssl ) ) != 0 )
+        return( ret );
+
+#if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
+    ret = ssl_write_split( ssl, iov, len );
+#else
+    ret = ssl_write_real( ssl, iov, 0, len );
+#endif
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= writev" ) );
+
+    return( ret );
+}
+
+/*
+ * Send records held back by write batching
+ */
+int mbedtls_ssl_flush( mbedtls_ssl_context *ssl )
+{
+    if( ssl == NULL || ssl->conf == NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    return( ssl_flush_batch( ssl ) );
+#else
+    return( 0 );
+#endif
+}
+
+/*
+ * Lend the caller the plaintext area of the next outgoing record
+ */
+int mbedtls_ssl_write_prepare( mbedtls_ssl_context *ssl,
+                               unsigned char **buf, size_t *len )
+{
+    int ret;
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write prepare" ) );
+
+    if( ssl == NULL || ssl->conf == NULL || buf == NULL || len == NULL )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    *buf = NULL;
+    *len = 0;
+
+    if( ( ret = ssl_write_check_state( ssl ) ) != 0 )
+        return( ret );
+
+#if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
+    /* The 1/n-1 split would need the data of the first record to be moved
+     * out of the way before encrypting, which defeats the purpose */
+    if( ssl->conf->cbc_record_splitting ==
+            MBEDTLS_SSL_CBC_RECORD_SPLITTING_ENABLED &&
+        ssl->minor_ver <= MBEDTLS_SSL_MINOR_VERSION_1 &&
+        mbedtls_cipher_get_cipher_mode( &ssl->transform_out->cipher_ctx_enc )
+                                == MBEDTLS_MODE_CBC )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "in-place write not available with "
+                                    "CBC record splitting" ) );
+        return( MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE );
+    }
+#endif /* MBEDTLS_SSL_CBC_RECORD_SPLITTING */
+
+    /* Make sure out_msg isn't holding a record still waiting to be sent */
+    if( ssl->out_left != 0 )
+    {
+        if( ( ret = mbedtls_ssl_flush_output( ssl ) ) != 0 )
+        {
+            MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ssl_flush_output", ret );
+            return( ret );
+        }
+    }
+
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ( ret = ssl_buf_out_get( ssl ) ) != 0 )
+        return( ret );
+#endif
+
+    *buf = ssl->out_msg;
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    *len = mbedtls_ssl_get_max_frag_len( ssl );
+#else
+    *len = MBEDTLS_SSL_MAX_CONTENT_LEN;
+#endif
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write prepare" ) );
+
+    return( 0 );
+}
+
+/*
+ * Encrypt and send the data written in place after mbedtls_ssl_write_prepare()
+ */
+int mbedtls_ssl_write_commit( mbedtls_ssl_context *ssl, size_t len )
+{
+    int ret;
+    size_t max_len;
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write commit" ) );
+
+    if( ssl == NULL || ssl->conf == NULL || ssl->out_buf == NULL ||
+        ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
+    {
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+    }
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    max_len = mbedtls_ssl_get_max_frag_len( ssl );
+#else
+    max_len = MBEDTLS_SSL_MAX_CONTENT_LEN;
+#endif
+
+    if( len > max_len )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    if( ssl->out_left != 0 )
+    {
+        /* The record was protected by a previous call that returned
+         * WANT_WRITE, only the flush remains to be done */
+        if( ( ret = mbedtls_ssl_flush_output( ssl ) ) != 0 )
+        {
+            MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ssl_flush_output", ret );
+            return( ret );
+        }
+    }
+    else
+    {
+        ssl->out_msglen  = len;
+        ssl->out_msgtype = MBEDTLS_SSL_MSG_APPLICATION_DATA;
+
+        if( ( ret = mbedtls_ssl_write_record( ssl ) ) != 0 )
+        {
+            MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ssl_write_record", ret );
+            return( ret );
+        }
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write commit" ) );
+
+    return( 0 );
+}
+
 /*
  * Notify the peer that the connection is being closed
  */
@@ -7211,11 +8524,12 @@ static void ssl_key_cert_free( mbedtls_ssl_key_cert *key_cert )
 }
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
-void mbedtls_ssl_handshake_free( mbedtls_ssl_handshake_params *handshake )
+/*
+ * Free the key exchange and checksum state of a handshake. Pointers are
+ * reset, so that this can be followed by mbedtls_ssl_handshake_free().
+ */
+static void ssl_handshake_free_key_exchange( mbedtls_ssl_handshake_params *handshake )
 {
-    if( handshake == NULL )
-        return;
-
 #if defined(MBEDTLS_SSL_PROTO_SSL3) || defined(MBEDTLS_SSL_PROTO_TLS1) || \
     defined(MBEDTLS_SSL_PROTO_TLS1_1)
     mbedtls_md5_free(    &handshake->fin_md5  );
@@ -7245,18 +8559,11 @@ void mbedtls_ssl_handshake_free( mbedtls_ssl_handshake_params *handshake )
 #endif
 #endif
 
-#if defined(MBEDTLS_MILAGRO_CS_C)
-    mbedtls_milagro_cs_free(handshake->milagro_cs);
-#endif
-#if defined(MBEDTLS_MILAGRO_P2P_C)
-    mbedtls_milagro_p2p_free(handshake->milagro_p2p);
-#endif
-
-    
 #if defined(MBEDTLS_ECDH_C) || defined(MBEDTLS_ECDSA_C) || \
     defined(MBEDTLS_KEY_EXCHANGE_ECJPAKE_ENABLED)
     /* explicit void pointer cast for buggy MS compiler */
     mbedtls_free( (void *) handshake->curves );
+    handshake->curves = NULL;
 #endif
 
 #if defined(MBEDTLS_KEY_EXCHANGE__SOME__PSK_ENABLED)
@@ -7264,9 +8571,48 @@ void mbedtls_ssl_handshake_free( mbedtls_ssl_handshake_params *handshake )
     {
         mbedtls_zeroize( handshake->psk, handshake->psk_len );
         mbedtls_free( handshake->psk );
+        handshake->psk = NULL;
+        handshake->psk_len = 0;
     }
 #endif
 
+    mbedtls_zeroize( handshake->premaster, sizeof( handshake->premaster ) );
+}
+
+void mbedtls_ssl_handshake_free( mbedtls_ssl_context *ssl )
+{
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+
+    if( handshake == NULL )
+        return;
+
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    if( handshake->async_in_progress != 0 &&
+        ssl->conf != NULL && ssl->conf->f_async_cancel != NULL )
+    {
+        ssl->conf->f_async_cancel( ssl->conf->p_async, ssl );
+        handshake->async_in_progress = 0;
+    }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    if( handshake->async_verify_in_progress != 0 &&
+        ssl->conf != NULL && ssl->conf->f_async_verify_cancel != NULL )
+    {
+        ssl->conf->f_async_verify_cancel( ssl->conf->p_async_verify, ssl );
+        handshake->async_verify_in_progress = 0;
+    }
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+
+    ssl_handshake_free_key_exchange( handshake );
+
+#if defined(MBEDTLS_MILAGRO_CS_C)
+    mbedtls_milagro_cs_free(handshake->milagro_cs);
+#endif
+#if defined(MBEDTLS_MILAGRO_P2P_C)
+    mbedtls_milagro_p2p_free(handshake->milagro_p2p);
+#endif
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C) && \
     defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
     /*
@@ -7306,6 +8652,9 @@ void mbedtls_ssl_session_free( mbedtls_ssl_session *session )
         mbedtls_x509_crt_free( session->peer_cert );
         mbedtls_free( session->peer_cert );
     }
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    mbedtls_free( session->peer_id );
+#endif
 #endif
 
 #if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
@@ -7325,6 +8674,14 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> free" ) );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl->conf != NULL && ssl_buf_dynamic( ssl ) )
+    {
+        ssl_buf_in_put( ssl );
+        ssl_buf_out_put( ssl );
+    }
+#endif
+
     if( ssl->out_buf != NULL )
     {
         mbedtls_zeroize( ssl->out_buf, MBEDTLS_SSL_BUFFER_LEN );
@@ -7337,6 +8694,14 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
         mbedtls_free( ssl->in_buf );
     }
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    if( ssl->out_batch != NULL )
+    {
+        mbedtls_zeroize( ssl->out_batch, ssl->out_batch_size );
+        mbedtls_free( ssl->out_batch );
+    }
+#endif
+
 #if defined(MBEDTLS_ZLIB_SUPPORT)
     if( ssl->compress_buf != NULL )
     {
@@ -7353,7 +8718,7 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
 
     if( ssl->handshake )
     {
-        mbedtls_ssl_handshake_free( ssl->handshake );
+        mbedtls_ssl_handshake_free( ssl );
         mbedtls_ssl_transform_free( ssl->transform_negotiate );
         mbedtls_ssl_session_free( ssl->session_negotiate );
 
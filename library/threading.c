@@ -116,6 +116,9 @@ void mbedtls_threading_set_alt( void (*mutex_init)( mbedtls_threading_mutex_t *
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
     mbedtls_mutex_init( &mbedtls_threading_ecp_mutex );
 #endif
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    mbedtls_mutex_init( &mbedtls_threading_x509_crt_mutex );
+#endif
 }
 
 /*
@@ -128,6 +131,9 @@ void mbedtls_threading_free_alt( void )
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
     mbedtls_mutex_free( &mbedtls_threading_ecp_mutex );
 #endif
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    mbedtls_mutex_free( &mbedtls_threading_x509_crt_mutex );
+#endif
 }
 #endif /* MBEDTLS_THREADING_ALT */
 
@@ -142,5 +148,8 @@ mbedtls_threading_mutex_t mbedtls_threading_gmtime_mutex MUTEX_INIT;
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
 mbedtls_threading_mutex_t mbedtls_threading_ecp_mutex MUTEX_INIT;
 #endif
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+mbedtls_threading_mutex_t mbedtls_threading_x509_crt_mutex MUTEX_INIT;
+#endif
 
 #endif /* MBEDTLS_THREADING_C */
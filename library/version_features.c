@@ -270,6 +270,9 @@ static const char *features[] = {
 #if defined(MBEDTLS_ECP_NIST_OPTIM)
     "MBEDTLS_ECP_NIST_OPTIM",
 #endif /* MBEDTLS_ECP_NIST_OPTIM */
+#if defined(MBEDTLS_ECP_MONT_FORM_OPTIM)
+    "MBEDTLS_ECP_MONT_FORM_OPTIM",
+#endif /* MBEDTLS_ECP_MONT_FORM_OPTIM */
 #if defined(MBEDTLS_ECDSA_DETERMINISTIC)
     "MBEDTLS_ECDSA_DETERMINISTIC",
 #endif /* MBEDTLS_ECDSA_DETERMINISTIC */
@@ -315,6 +318,9 @@ static const char *features[] = {
 #if defined(MBEDTLS_GENPRIME)
     "MBEDTLS_GENPRIME",
 #endif /* MBEDTLS_GENPRIME */
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+    "MBEDTLS_MPI_SCRATCH_ARENA",
+#endif /* MBEDTLS_MPI_SCRATCH_ARENA */
 #if defined(MBEDTLS_FS_IO)
     "MBEDTLS_FS_IO",
 #endif /* MBEDTLS_FS_IO */
@@ -357,6 +363,12 @@ static const char *features[] = {
 #if defined(MBEDTLS_SSL_ALL_ALERT_MESSAGES)
     "MBEDTLS_SSL_ALL_ALERT_MESSAGES",
 #endif /* MBEDTLS_SSL_ALL_ALERT_MESSAGES */
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    "MBEDTLS_SSL_ASYNC_PRIVATE",
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    "MBEDTLS_SSL_ASYNC_VERIFY",
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
 #if defined(MBEDTLS_SSL_DEBUG_ALL)
     "MBEDTLS_SSL_DEBUG_ALL",
 #endif /* MBEDTLS_SSL_DEBUG_ALL */
@@ -375,6 +387,15 @@ static const char *features[] = {
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING)
     "MBEDTLS_SSL_CBC_RECORD_SPLITTING",
 #endif /* MBEDTLS_SSL_CBC_RECORD_SPLITTING */
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    "MBEDTLS_SSL_DYNAMIC_BUFFERS",
+#endif /* MBEDTLS_SSL_DYNAMIC_BUFFERS */
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    "MBEDTLS_SSL_LEAN_CONNECTIONS",
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS */
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    "MBEDTLS_SSL_RECORD_BATCHING",
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
 #if defined(MBEDTLS_SSL_RENEGOTIATION)
     "MBEDTLS_SSL_RENEGOTIATION",
 #endif /* MBEDTLS_SSL_RENEGOTIATION */
@@ -444,6 +465,15 @@ static const char *features[] = {
 #if defined(MBEDTLS_X509_ALLOW_UNSUPPORTED_CRITICAL_EXTENSION)
     "MBEDTLS_X509_ALLOW_UNSUPPORTED_CRITICAL_EXTENSION",
 #endif /* MBEDTLS_X509_ALLOW_UNSUPPORTED_CRITICAL_EXTENSION */
+#if defined(MBEDTLS_X509_CA_STORE)
+    "MBEDTLS_X509_CA_STORE",
+#endif /* MBEDTLS_X509_CA_STORE */
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    "MBEDTLS_X509_VERIFY_CACHE",
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    "MBEDTLS_X509_CRT_LAZY_PARSE",
+#endif /* MBEDTLS_X509_CRT_LAZY_PARSE */
 #if defined(MBEDTLS_X509_CHECK_KEY_USAGE)
     "MBEDTLS_X509_CHECK_KEY_USAGE",
 #endif /* MBEDTLS_X509_CHECK_KEY_USAGE */
@@ -519,6 +549,9 @@ static const char *features[] = {
 #if defined(MBEDTLS_ECP_C)
     "MBEDTLS_ECP_C",
 #endif /* MBEDTLS_ECP_C */
+#if defined(MBEDTLS_ECP_P256_C)
+    "MBEDTLS_ECP_P256_C",
+#endif /* MBEDTLS_ECP_P256_C */
 #if defined(MBEDTLS_ENTROPY_C)
     "MBEDTLS_ENTROPY_C",
 #endif /* MBEDTLS_ENTROPY_C */
@@ -600,9 +633,21 @@ static const char *features[] = {
 #if defined(MBEDTLS_SHA512_C)
     "MBEDTLS_SHA512_C",
 #endif /* MBEDTLS_SHA512_C */
+#if defined(MBEDTLS_SHANI_C)
+    "MBEDTLS_SHANI_C",
+#endif /* MBEDTLS_SHANI_C */
+#if defined(MBEDTLS_SHA_MB_C)
+    "MBEDTLS_SHA_MB_C",
+#endif /* MBEDTLS_SHA_MB_C */
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+    "MBEDTLS_SSL_BUFFER_POOL_C",
+#endif /* MBEDTLS_SSL_BUFFER_POOL_C */
 #if defined(MBEDTLS_SSL_CACHE_C)
     "MBEDTLS_SSL_CACHE_C",
 #endif /* MBEDTLS_SSL_CACHE_C */
+#if defined(MBEDTLS_SSL_CACHE_SHARDED_C)
+    "MBEDTLS_SSL_CACHE_SHARDED_C",
+#endif /* MBEDTLS_SSL_CACHE_SHARDED_C */
 #if defined(MBEDTLS_SSL_COOKIE_C)
     "MBEDTLS_SSL_COOKIE_C",
 #endif /* MBEDTLS_SSL_COOKIE_C */
@@ -60,6 +60,10 @@
 #include "mbedtls/threading.h"
 #endif
 
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+#include "mbedtls/sha256.h"
+#endif
+
 #if defined(_WIN32) && !defined(EFIX64) && !defined(EFI32)
 #include <windows.h>
 #else
@@ -80,6 +84,15 @@ static void mbedtls_zeroize( void *v, size_t n ) {
     volatile unsigned char *p = v; while( n-- ) *p++ = 0;
 }
 
+/*
+ * Parts of a certificate that lazy parsing leaves to decode later
+ * (bits of lazy_pending)
+ */
+#define X509_CRT_PART_NAMES         0x01
+#define X509_CRT_PART_EXT           0x02
+#define X509_CRT_PART_ALL           ( X509_CRT_PART_NAMES | X509_CRT_PART_EXT )
+#define X509_CRT_DECODE_FAILED      0x80
+
 /*
  * Default profile
  */
@@ -516,25 +529,16 @@ static int x509_get_subject_alt_name( unsigned char **p,
 }
 
 /*
- * X.509 v3 extensions
- *
+ * List of X.509 v3 extensions, after the Extensions SEQUENCE header
  */
-static int x509_get_crt_ext( unsigned char **p,
-                             const unsigned char *end,
-                             mbedtls_x509_crt *crt )
+static int x509_get_crt_ext_list( unsigned char **p,
+                                  const unsigned char *end,
+                                  mbedtls_x509_crt *crt )
 {
     int ret;
     size_t len;
     unsigned char *end_ext_data, *end_ext_octet;
 
-    if( ( ret = mbedtls_x509_get_ext( p, end, &crt->v3_ext, 3 ) ) != 0 )
-    {
-        if( ret == MBEDTLS_ERR_ASN1_UNEXPECTED_TAG )
-            return( 0 );
-
-        return( ret );
-    }
-
     while( *p < end )
     {
         /*
@@ -658,6 +662,37 @@ static int x509_get_crt_ext( unsigned char **p,
     return( 0 );
 }
 
+/*
+ * X.509 v3 extensions
+ *
+ */
+static int x509_get_crt_ext( unsigned char **p,
+                             const unsigned char *end,
+                             mbedtls_x509_crt *crt )
+{
+    int ret;
+
+    if( ( ret = mbedtls_x509_get_ext( p, end, &crt->v3_ext, 3 ) ) != 0 )
+    {
+        if( ret == MBEDTLS_ERR_ASN1_UNEXPECTED_TAG )
+            return( 0 );
+
+        return( ret );
+    }
+
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    if( crt->lazy_parse && crt->v3_ext.p != NULL )
+    {
+        /* Framing checked by mbedtls_x509_get_ext(), list decoded later */
+        crt->lazy_pending |= X509_CRT_PART_EXT;
+        *p = crt->v3_ext.p + crt->v3_ext.len;
+        return( 0 );
+    }
+#endif
+
+    return( x509_get_crt_ext_list( p, end, crt ) );
+}
+
 /*
  * Parse and fill a single X.509 certificate in DER format
  */
@@ -776,6 +811,14 @@ static int x509_crt_parse_der_core( mbedtls_x509_crt *crt, const unsigned char *
         return( MBEDTLS_ERR_X509_INVALID_FORMAT + ret );
     }
 
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    if( crt->lazy_parse )
+    {
+        crt->lazy_pending |= X509_CRT_PART_NAMES;
+        p += len;
+    }
+    else
+#endif
     if( ( ret = mbedtls_x509_get_name( &p, p + len, &crt->issuer ) ) != 0 )
     {
         mbedtls_x509_crt_free( crt );
@@ -809,6 +852,11 @@ static int x509_crt_parse_der_core( mbedtls_x509_crt *crt, const unsigned char *
         return( MBEDTLS_ERR_X509_INVALID_FORMAT + ret );
     }
 
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    if( crt->lazy_parse )
+        p += len;
+    else
+#endif
     if( len && ( ret = mbedtls_x509_get_name( &p, p + len, &crt->subject ) ) != 0 )
     {
         mbedtls_x509_crt_free( crt );
@@ -923,6 +971,9 @@ int mbedtls_x509_crt_parse_der( mbedtls_x509_crt *chain, const unsigned char *bu
 {
     int ret;
     mbedtls_x509_crt *crt = chain, *prev = NULL;
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    int lazy_parse;
+#endif
 
     /*
      * Check for valid input
@@ -930,6 +981,10 @@ int mbedtls_x509_crt_parse_der( mbedtls_x509_crt *chain, const unsigned char *bu
     if( crt == NULL || buf == NULL )
         return( MBEDTLS_ERR_X509_BAD_INPUT_DATA );
 
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    lazy_parse = chain->lazy_parse;
+#endif
+
     while( crt->version != 0 && crt->next != NULL )
     {
         prev = crt;
@@ -949,6 +1004,9 @@ int mbedtls_x509_crt_parse_der( mbedtls_x509_crt *chain, const unsigned char *bu
         prev = crt;
         mbedtls_x509_crt_init( crt->next );
         crt = crt->next;
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+        crt->lazy_parse = chain->lazy_parse;
+#endif
     }
 
     if( ( ret = x509_crt_parse_der_core( crt, buf, buflen ) ) != 0 )
@@ -958,6 +1016,10 @@ int mbedtls_x509_crt_parse_der( mbedtls_x509_crt *chain, const unsigned char *bu
 
         if( crt != chain )
             mbedtls_free( crt );
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+        else
+            chain->lazy_parse = lazy_parse;
+#endif
 
         return( ret );
     }
@@ -1221,6 +1283,126 @@ cleanup:
 }
 #endif /* MBEDTLS_FS_IO */
 
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+/*
+ * Parse the certificates added to the chain lazily from now on
+ */
+void mbedtls_x509_crt_set_lazy_parse( mbedtls_x509_crt *chain, int lazy )
+{
+    chain->lazy_parse = lazy;
+}
+
+/*
+ * Decode some of the parts left out by x509_crt_parse_der_core(). Their
+ * framing was checked during the parsing, so this only fills in the fields.
+ */
+static int x509_crt_decode_pending( mbedtls_x509_crt *crt, int parts )
+{
+    int ret;
+    size_t len;
+    unsigned char *p, *end;
+
+    if( crt->lazy_pending & X509_CRT_DECODE_FAILED )
+        return( MBEDTLS_ERR_X509_INVALID_FORMAT );
+
+    parts &= crt->lazy_pending;
+
+    if( parts & X509_CRT_PART_NAMES )
+    {
+        p = crt->issuer_raw.p;
+        end = p + crt->issuer_raw.len;
+
+        if( ( ret = mbedtls_asn1_get_tag( &p, end, &len,
+                MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE ) ) != 0 )
+            return( MBEDTLS_ERR_X509_INVALID_FORMAT + ret );
+
+        if( ( ret = mbedtls_x509_get_name( &p, p + len, &crt->issuer ) ) != 0 )
+            return( ret );
+
+        p = crt->subject_raw.p;
+        end = p + crt->subject_raw.len;
+
+        if( ( ret = mbedtls_asn1_get_tag( &p, end, &len,
+                MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE ) ) != 0 )
+            return( MBEDTLS_ERR_X509_INVALID_FORMAT + ret );
+
+        if( len && ( ret = mbedtls_x509_get_name( &p, p + len, &crt->subject ) ) != 0 )
+            return( ret );
+
+        crt->lazy_pending &= ~X509_CRT_PART_NAMES;
+    }
+
+    if( parts & X509_CRT_PART_EXT )
+    {
+        p = crt->v3_ext.p;
+        end = crt->v3_ext.p + crt->v3_ext.len;
+
+        if( ( ret = mbedtls_asn1_get_tag( &p, end, &len,
+                MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE ) ) != 0 )
+            return( MBEDTLS_ERR_X509_INVALID_EXTENSIONS + ret );
+
+        if( ( ret = x509_get_crt_ext_list( &p, end, crt ) ) != 0 )
+            return( ret );
+
+        crt->lazy_pending &= ~X509_CRT_PART_EXT;
+    }
+
+    return( 0 );
+}
+
+static int x509_crt_decode_parts( mbedtls_x509_crt *crt, int parts )
+{
+    int ret;
+
+    /* lazy_parse does not change once the certificate is parsed */
+    if( crt->lazy_parse == 0 )
+        return( 0 );
+
+#if defined(MBEDTLS_THREADING_C)
+    if( ( ret = mbedtls_mutex_lock( &mbedtls_threading_x509_crt_mutex ) ) != 0 )
+        return( ret );
+#endif
+
+    /* A failed decoding may leave partial lists: don't try again */
+    if( ( ret = x509_crt_decode_pending( crt, parts ) ) != 0 )
+        crt->lazy_pending |= X509_CRT_DECODE_FAILED;
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_unlock( &mbedtls_threading_x509_crt_mutex ) != 0 )
+        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
+#endif
+
+    return( ret );
+}
+
+/*
+ * Decode the names and extensions of a lazily parsed certificate
+ */
+int mbedtls_x509_crt_decode( mbedtls_x509_crt *crt )
+{
+    if( crt == NULL )
+        return( MBEDTLS_ERR_X509_BAD_INPUT_DATA );
+
+    return( x509_crt_decode_parts( crt, X509_CRT_PART_ALL ) );
+}
+#endif /* MBEDTLS_X509_CRT_LAZY_PARSE */
+
+/*
+ * Make sure some parts of a certificate are available. Functions taking a
+ * const certificate may still decode it: this doesn't change the
+ * certificate it represents.
+ */
+static int x509_crt_decode( const mbedtls_x509_crt *crt, int parts )
+{
+#if defined(MBEDTLS_X509_CRT_LAZY_PARSE)
+    return( x509_crt_decode_parts( (mbedtls_x509_crt *) crt, parts ) );
+#else
+    ((void) crt);
+    ((void) parts);
+    return( 0 );
+#endif
+}
+
 static int x509_info_subject_alt_name( char **buf, size_t *size,
                                        const mbedtls_x509_sequence *subject_alt_name )
 {
@@ -1374,6 +1556,9 @@ int mbedtls_x509_crt_info( char *buf, size_t size, const char *prefix,
         return( (int) ( size - n ) );
     }
 
+    if( ( ret = x509_crt_decode( crt, X509_CRT_PART_ALL ) ) != 0 )
+        return( ret );
+
     ret = mbedtls_snprintf( p, n, "%scert. version     : %d\n",
                                prefix, crt->version );
     MBEDTLS_X509_SAFE_SNPRINTF;
@@ -1548,10 +1733,14 @@ int mbedtls_x509_crt_verify_info( char *buf, size_t size, const char *prefix,
 int mbedtls_x509_crt_check_key_usage( const mbedtls_x509_crt *crt,
                                       unsigned int usage )
 {
+    int ret;
     unsigned int usage_must, usage_may;
     unsigned int may_mask = MBEDTLS_X509_KU_ENCIPHER_ONLY
                           | MBEDTLS_X509_KU_DECIPHER_ONLY;
 
+    if( ( ret = x509_crt_decode( crt, X509_CRT_PART_EXT ) ) != 0 )
+        return( ret );
+
     if( ( crt->ext_types & MBEDTLS_X509_EXT_KEY_USAGE ) == 0 )
         return( 0 );
 
@@ -1574,8 +1763,12 @@ int mbedtls_x509_crt_check_extended_key_usage( const mbedtls_x509_crt *crt,
                                        const char *usage_oid,
                                        size_t usage_len )
 {
+    int ret;
     const mbedtls_x509_sequence *cur;
 
+    if( ( ret = x509_crt_decode( crt, X509_CRT_PART_EXT ) ) != 0 )
+        return( ret );
+
     /* Extension is not mandatory, absent means no restriction */
     if( ( crt->ext_types & MBEDTLS_X509_EXT_EXTENDED_KEY_USAGE ) == 0 )
         return( 0 );
@@ -1861,7 +2054,11 @@ static int x509_crt_check_parent( const mbedtls_x509_crt *child,
     int need_ca_bit;
 
     /* Parent must be the issuer */
-    if( x509_name_cmp( &child->issuer, &parent->subject ) != 0 )
+    if( x509_crt_decode( parent, X509_CRT_PART_NAMES ) != 0 ||
+        x509_name_cmp( &child->issuer, &parent->subject ) != 0 )
+        return( -1 );
+
+    if( x509_crt_decode( parent, X509_CRT_PART_EXT ) != 0 )
         return( -1 );
 
     /* Parent must have the basicConstraints CA bit set as a general rule */
@@ -1893,159 +2090,635 @@ static int x509_crt_check_parent( const mbedtls_x509_crt *child,
     return( 0 );
 }
 
-static int x509_crt_verify_top(
-                mbedtls_x509_crt *child, mbedtls_x509_crt *trust_ca,
-                mbedtls_x509_crl *ca_crl,
-                const mbedtls_x509_crt_profile *profile,
-                int path_cnt, int self_cnt, uint32_t *flags,
-                int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
-                void *p_vrfy )
+#if defined(MBEDTLS_X509_CA_STORE)
+/*
+ * Entry of a CA store. The entries of a bucket are linked in chain order.
+ */
+struct mbedtls_x509_ca_entry
 {
-    int ret;
-    uint32_t ca_flags = 0;
-    int check_path_cnt;
-    unsigned char hash[MBEDTLS_MD_MAX_SIZE];
-    const mbedtls_md_info_t *md_info;
-    mbedtls_x509_crt *future_past_ca = NULL;
+    mbedtls_x509_crt *crt;
+    uint32_t hash;              /* hash of the subject name         */
+    mbedtls_x509_buf key_id;    /* subject key identifier, if any   */
+    size_t next;                /* index + 1 of the next entry of
+                                   the same bucket, or 0            */
+};
 
-    if( mbedtls_x509_time_is_past( &child->valid_to ) )
-        *flags |= MBEDTLS_X509_BADCERT_EXPIRED;
+/*
+ * FNV-1a, folding ASCII letters to lower case if requested
+ */
+static uint32_t x509_hash_update( uint32_t h, const unsigned char *p,
+                                  size_t len, int fold )
+{
+    size_t i;
+    unsigned char c;
 
-    if( mbedtls_x509_time_is_future( &child->valid_from ) )
-        *flags |= MBEDTLS_X509_BADCERT_FUTURE;
+    for( i = 0; i < len; i++ )
+    {
+        c = p[i];
+        if( fold && c >= 'A' && c <= 'Z' )
+            c += 'a' - 'A';
 
-    if( x509_profile_check_md_alg( profile, child->sig_md ) != 0 )
-        *flags |= MBEDTLS_X509_BADCERT_BAD_MD;
+        h = ( h ^ c ) * 16777619u;
+    }
 
-    if( x509_profile_check_pk_alg( profile, child->sig_pk ) != 0 )
-        *flags |= MBEDTLS_X509_BADCERT_BAD_PK;
+    return( h );
+}
 
-    /*
-     * Child is the top of the chain. Check against the trust_ca list.
-     */
-    *flags |= MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+/*
+ * Hash of an X.509 Name. Names that x509_name_cmp() finds equal have the
+ * same hash: UTF8String and PrintableString values are hashed alike, and
+ * case-insensitively.
+ */
+static uint32_t x509_name_hash( const mbedtls_x509_name *name )
+{
+    uint32_t h = 2166136261u;
+    unsigned char hdr[3];
+    int fold;
 
-    md_info = mbedtls_md_info_from_type( child->sig_md );
-    if( md_info == NULL )
+    while( name != NULL )
     {
-        /*
-         * Cannot check 'unknown', no need to try any CA
-         */
-        trust_ca = NULL;
-    }
-    else
-        mbedtls_md( md_info, child->tbs.p, child->tbs.len, hash );
+        hdr[0] = (unsigned char) name->oid.tag;
+        hdr[1] = (unsigned char) name->oid.len;
+        hdr[2] = (unsigned char)( name->oid.len >> 8 );
+        h = x509_hash_update( h, hdr, 3, 0 );
+        h = x509_hash_update( h, name->oid.p, name->oid.len, 0 );
 
-    for( /* trust_ca */ ; trust_ca != NULL; trust_ca = trust_ca->next )
-    {
-        if( x509_crt_check_parent( child, trust_ca, 1, path_cnt == 0 ) != 0 )
-            continue;
+        fold = ( name->val.tag == MBEDTLS_ASN1_UTF8_STRING ||
+                 name->val.tag == MBEDTLS_ASN1_PRINTABLE_STRING );
 
-        check_path_cnt = path_cnt + 1;
+        hdr[0] = fold ? MBEDTLS_ASN1_UTF8_STRING : (unsigned char) name->val.tag;
+        hdr[1] = (unsigned char) name->val.len;
+        hdr[2] = (unsigned char)( name->val.len >> 8 );
+        h = x509_hash_update( h, hdr, 3, 0 );
+        h = x509_hash_update( h, name->val.p, name->val.len, fold );
 
-        /*
-         * Reduce check_path_cnt to check against if top of the chain is
-         * the same as the trusted CA
-         */
-        if( child->subject_raw.len == trust_ca->subject_raw.len &&
-            memcmp( child->subject_raw.p, trust_ca->subject_raw.p,
-                            child->issuer_raw.len ) == 0 )
-        {
-            check_path_cnt--;
-        }
+        hdr[0] = (unsigned char) name->next_merged;
+        h = x509_hash_update( h, hdr, 1, 0 );
 
-        /* Self signed certificates do not count towards the limit */
-        if( trust_ca->max_pathlen > 0 &&
-            trust_ca->max_pathlen < check_path_cnt - self_cnt )
-        {
-            continue;
-        }
+        name = name->next;
+    }
 
-        if( mbedtls_pk_verify_ext( child->sig_pk, child->sig_opts, &trust_ca->pk,
-                           child->sig_md, hash, mbedtls_md_get_size( md_info ),
-                           child->sig.p, child->sig.len ) != 0 )
-        {
-            continue;
-        }
+    return( h );
+}
 
-        if( mbedtls_x509_time_is_past( &trust_ca->valid_to ) ||
-            mbedtls_x509_time_is_future( &trust_ca->valid_from ) )
-        {
-            if ( future_past_ca == NULL )
-                future_past_ca = trust_ca;
+/*
+ * Get the keyIdentifier of the subject key identifier extension (ski != 0)
+ * or of the authority key identifier extension of a certificate. These
+ * extensions are not parsed by x509_get_crt_ext(). key_id is left empty if
+ * the extension is absent or malformed.
+ *
+ * SubjectKeyIdentifier ::= KeyIdentifier
+ *
+ * AuthorityKeyIdentifier ::= SEQUENCE {
+ *      keyIdentifier             [0] KeyIdentifier           OPTIONAL,
+ *      authorityCertIssuer       [1] GeneralNames            OPTIONAL,
+ *      authorityCertSerialNumber [2] CertificateSerialNumber OPTIONAL  }
+ *
+ * KeyIdentifier ::= OCTET STRING
+ */
+static void x509_crt_get_key_id( const mbedtls_x509_crt *crt, int ski,
+                                 mbedtls_x509_buf *key_id )
+{
+    unsigned char *p = crt->v3_ext.p;
+    const unsigned char *end = p + crt->v3_ext.len;
+    const unsigned char *end_ext;
+    mbedtls_x509_buf oid;
+    size_t len;
+    int is_critical;
 
-            continue;
-        }
+    memset( key_id, 0, sizeof( mbedtls_x509_buf ) );
 
-        break;
-    }
+    if( p == NULL ||
+        mbedtls_asn1_get_tag( &p, end, &len,
+                MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE ) != 0 )
+        return;
 
-    if( trust_ca != NULL || ( trust_ca = future_past_ca ) != NULL )
+    while( p < end )
     {
-        /*
-         * Top of chain is signed by a trusted CA
-         */
-        *flags &= ~MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+        if( mbedtls_asn1_get_tag( &p, end, &len,
+                MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE ) != 0 )
+            return;
 
-        if( x509_profile_check_key( profile, child->sig_pk, &trust_ca->pk ) != 0 )
-            *flags |= MBEDTLS_X509_BADCERT_BAD_KEY;
-    }
+        end_ext = p + len;
 
-    /*
-     * If top of chain is not the same as the trusted CA send a verify request
-     * to the callback for any issues with validity and CRL presence for the
-     * trusted CA certificate.
-     */
-    if( trust_ca != NULL &&
-        ( child->subject_raw.len != trust_ca->subject_raw.len ||
-          memcmp( child->subject_raw.p, trust_ca->subject_raw.p,
-                            child->issuer_raw.len ) != 0 ) )
-    {
-#if defined(MBEDTLS_X509_CRL_PARSE_C)
-        /* Check trusted CA's CRL for the chain's top crt */
-        *flags |= x509_crt_verifycrl( child, trust_ca, ca_crl, profile );
-#else
-        ((void) ca_crl);
-#endif
+        if( mbedtls_asn1_get_tag( &p, end_ext, &oid.len, MBEDTLS_ASN1_OID ) != 0 )
+            return;
 
-        if( mbedtls_x509_time_is_past( &trust_ca->valid_to ) )
-            ca_flags |= MBEDTLS_X509_BADCERT_EXPIRED;
+        oid.p = p;
+        p += oid.len;
 
-        if( mbedtls_x509_time_is_future( &trust_ca->valid_from ) )
-            ca_flags |= MBEDTLS_X509_BADCERT_FUTURE;
+        /* critical is optional and irrelevant here */
+        (void) mbedtls_asn1_get_bool( &p, end_ext, &is_critical );
 
-        if( NULL != f_vrfy )
+        if( mbedtls_asn1_get_tag( &p, end_ext, &len, MBEDTLS_ASN1_OCTET_STRING ) != 0 )
+            return;
+
+        if( ski && MBEDTLS_OID_CMP( MBEDTLS_OID_SUBJECT_KEY_IDENTIFIER, &oid ) == 0 )
         {
-            if( ( ret = f_vrfy( p_vrfy, trust_ca, path_cnt + 1,
-                                &ca_flags ) ) != 0 )
-            {
-                return( ret );
-            }
+            if( mbedtls_asn1_get_tag( &p, end_ext, &len,
+                                      MBEDTLS_ASN1_OCTET_STRING ) != 0 )
+                return;
+            break;
         }
-    }
 
-    /* Call callback on top cert */
-    if( NULL != f_vrfy )
-    {
-        if( ( ret = f_vrfy( p_vrfy, child, path_cnt, flags ) ) != 0 )
-            return( ret );
+        if( ! ski && MBEDTLS_OID_CMP( MBEDTLS_OID_AUTHORITY_KEY_IDENTIFIER, &oid ) == 0 )
+        {
+            if( mbedtls_asn1_get_tag( &p, end_ext, &len,
+                    MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE ) != 0 ||
+                mbedtls_asn1_get_tag( &p, end_ext, &len,
+                    MBEDTLS_ASN1_CONTEXT_SPECIFIC | 0 ) != 0 )
+                return;
+            break;
+        }
+
+        p = (unsigned char *) end_ext;
     }
 
-    *flags |= ca_flags;
+    if( p >= end || len == 0 )
+        return;
 
-    return( 0 );
+    key_id->tag = MBEDTLS_ASN1_OCTET_STRING;
+    key_id->len = len;
+    key_id->p = p;
 }
 
-static int x509_crt_verify_child(
-                mbedtls_x509_crt *child, mbedtls_x509_crt *parent,
-                mbedtls_x509_crt *trust_ca, mbedtls_x509_crl *ca_crl,
-                const mbedtls_x509_crt_profile *profile,
-                int path_cnt, int self_cnt, uint32_t *flags,
-                int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
-                void *p_vrfy )
+/*
+ * Initialize a CA store
+ */
+void mbedtls_x509_ca_store_init( mbedtls_x509_ca_store *store )
 {
-    int ret;
-    uint32_t parent_flags = 0;
+    memset( store, 0, sizeof( mbedtls_x509_ca_store ) );
+}
+
+/*
+ * Index a chain of trusted CAs
+ */
+int mbedtls_x509_ca_store_build( mbedtls_x509_ca_store *store,
+                                 mbedtls_x509_crt *chain )
+{
+    size_t count = 0, size = 1, i, b;
+    mbedtls_x509_crt *crt;
+    struct mbedtls_x509_ca_entry *entries;
+    size_t *buckets;
+
+    if( chain == NULL )
+        return( MBEDTLS_ERR_X509_BAD_INPUT_DATA );
+
+    for( crt = chain; crt != NULL; crt = crt->next )
+        count++;
+
+    while( size < 2 * count )
+        size <<= 1;
+
+    entries = mbedtls_calloc( count, sizeof( struct mbedtls_x509_ca_entry ) );
+    buckets = mbedtls_calloc( size, sizeof( size_t ) );
+
+    if( entries == NULL || buckets == NULL )
+    {
+        mbedtls_free( entries );
+        mbedtls_free( buckets );
+        return( MBEDTLS_ERR_X509_ALLOC_FAILED );
+    }
+
+    for( i = 0, crt = chain; i < count; i++, crt = crt->next )
+    {
+        /* A CA that fails to decode is rejected by x509_crt_check_parent() */
+        (void) x509_crt_decode( crt, X509_CRT_PART_NAMES );
+
+        entries[i].crt = crt;
+        entries[i].hash = x509_name_hash( &crt->subject );
+        x509_crt_get_key_id( crt, 1, &entries[i].key_id );
+    }
+
+    /* Insert backwards so that the buckets list their entries in order */
+    for( i = count; i > 0; i-- )
+    {
+        b = entries[i - 1].hash & ( size - 1 );
+        entries[i - 1].next = buckets[b];
+        buckets[b] = i;
+    }
+
+    mbedtls_x509_ca_store_free( store );
+
+    store->chain = chain;
+    store->count = count;
+    store->size = size;
+    store->entries = entries;
+    store->buckets = buckets;
+
+    chain->ca_store = store;
+
+    return( 0 );
+}
+
+/*
+ * Free a CA store
+ */
+void mbedtls_x509_ca_store_free( mbedtls_x509_ca_store *store )
+{
+    if( store == NULL )
+        return;
+
+    if( store->chain != NULL && store->chain->ca_store == store )
+        store->chain->ca_store = NULL;
+
+    mbedtls_free( store->entries );
+    mbedtls_free( store->buckets );
+
+    mbedtls_zeroize( store, sizeof( mbedtls_x509_ca_store ) );
+}
+
+/*
+ * Store of a chain of trusted CAs, if it still indexes the whole chain
+ */
+static const mbedtls_x509_ca_store *x509_ca_store_get(
+                                        const mbedtls_x509_crt *trust_ca )
+{
+    const mbedtls_x509_ca_store *store;
+
+    if( trust_ca == NULL || ( store = trust_ca->ca_store ) == NULL )
+        return( NULL );
+
+    if( store->chain != trust_ca ||
+        store->entries[store->count - 1].crt->next != NULL )
+        return( NULL );
+
+    return( store );
+}
+#endif /* MBEDTLS_X509_CA_STORE */
+
+/*
+ * Iterator over the possible parents of a certificate among the trusted CAs,
+ * starting from a given CA. With a store, only the CAs whose subject name
+ * has the same hash as the issuer of the child are visited.
+ */
+typedef struct
+{
+    mbedtls_x509_crt *crt;      /* next CA, without a store             */
+#if defined(MBEDTLS_X509_CA_STORE)
+    const mbedtls_x509_ca_store *store;
+    uint32_t hash;              /* hash of the issuer of the child      */
+    size_t next;                /* index + 1 of the next entry, or 0    */
+    const mbedtls_x509_buf *key_id; /* key identifier of the last CA    */
+#endif
+}
+x509_crt_parents;
+
+static void x509_crt_parents_init( x509_crt_parents *it,
+                                   const mbedtls_x509_crt *child,
+                                   mbedtls_x509_crt *trust_ca,
+                                   mbedtls_x509_crt *start )
+{
+    it->crt = start;
+
+#if defined(MBEDTLS_X509_CA_STORE)
+    it->store = NULL;
+    it->key_id = NULL;
+
+    if( start == NULL || ( it->store = x509_ca_store_get( trust_ca ) ) == NULL )
+        return;
+
+    it->hash = x509_name_hash( &child->issuer );
+    it->next = it->store->buckets[it->hash & ( it->store->size - 1 )];
+
+    if( start != trust_ca )
+    {
+        /* Skip the entries before start */
+        while( it->next != 0 && it->store->entries[it->next - 1].crt != start )
+            it->next = it->store->entries[it->next - 1].next;
+
+        /* start was found through this bucket, but never mind if not */
+        if( it->next == 0 )
+            it->store = NULL;
+    }
+#else
+    ((void) child);
+    ((void) trust_ca);
+#endif
+}
+
+static mbedtls_x509_crt *x509_crt_parents_next( x509_crt_parents *it )
+{
+    mbedtls_x509_crt *crt;
+
+#if defined(MBEDTLS_X509_CA_STORE)
+    const struct mbedtls_x509_ca_entry *entry;
+
+    if( it->store != NULL )
+    {
+        while( it->next != 0 )
+        {
+            entry = &it->store->entries[it->next - 1];
+            it->next = entry->next;
+
+            if( entry->hash == it->hash )
+            {
+                it->key_id = &entry->key_id;
+                return( entry->crt );
+            }
+        }
+
+        return( NULL );
+    }
+#endif
+
+    if( ( crt = it->crt ) != NULL )
+        it->crt = crt->next;
+
+    return( crt );
+}
+
+/*
+ * First CA of trust_ca that is a suitable parent for child, or NULL
+ */
+static mbedtls_x509_crt *x509_crt_find_trusted_parent(
+                                        const mbedtls_x509_crt *child,
+                                        mbedtls_x509_crt *trust_ca,
+                                        int bottom )
+{
+    x509_crt_parents parents;
+    mbedtls_x509_crt *parent;
+
+    x509_crt_parents_init( &parents, child, trust_ca, trust_ca );
+
+    while( ( parent = x509_crt_parents_next( &parents ) ) != NULL )
+    {
+        if( x509_crt_check_parent( child, parent, 0, bottom ) == 0 )
+            break;
+    }
+
+    return( parent );
+}
+
+struct x509_crt_sig_memo;
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+/*
+ * Signature checks of a verification with a verify cache: those of the
+ * previous verification of the chain, if any, and the new ones
+ */
+struct x509_crt_sig_memo
+{
+    const mbedtls_x509_crt *chain;      /* chain being verified         */
+    size_t sig_count;
+    mbedtls_x509_verify_cache_sig sigs[MBEDTLS_X509_VERIFY_CACHE_MAX_SIGS];
+    int updated;                        /* new checks were recorded     */
+};
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+
+/*
+ * Check the signature of child with the key of parent. With a memo, reuse
+ * the outcome of the same check in a previous verification of the chain,
+ * or record it.
+ *
+ * Return 0 if the signature is valid, non-zero otherwise.
+ */
+static int x509_crt_check_signature( const mbedtls_x509_crt *child,
+                                     mbedtls_x509_crt *parent,
+                                     const mbedtls_md_info_t *md_info,
+                                     const unsigned char *hash,
+                                     struct x509_crt_sig_memo *memo )
+{
+    int ret;
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    const mbedtls_x509_crt *cur;
+    mbedtls_x509_verify_cache_sig *sig;
+    unsigned char issuer[32];
+    size_t i, pos = 0;
+
+    if( memo != NULL )
+    {
+        for( cur = memo->chain; cur != NULL && cur != child; cur = cur->next )
+            pos++;
+
+        if( cur == NULL || pos > 255 )
+            memo = NULL;
+    }
+
+    if( memo != NULL )
+    {
+        mbedtls_sha256( parent->raw.p, parent->raw.len, issuer, 0 );
+
+        for( i = 0; i < memo->sig_count; i++ )
+        {
+            sig = &memo->sigs[i];
+
+            if( sig->child == pos && memcmp( sig->issuer, issuer, 32 ) == 0 )
+                return( sig->valid ? 0 : -1 );
+        }
+    }
+#else
+    ((void) memo);
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+
+    ret = mbedtls_pk_verify_ext( child->sig_pk, child->sig_opts, &parent->pk,
+                                 child->sig_md, hash, mbedtls_md_get_size( md_info ),
+                                 child->sig.p, child->sig.len );
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    if( memo != NULL && memo->sig_count < MBEDTLS_X509_VERIFY_CACHE_MAX_SIGS )
+    {
+        sig = &memo->sigs[memo->sig_count++];
+
+        memcpy( sig->issuer, issuer, 32 );
+        sig->child = (unsigned char) pos;
+        sig->valid = ( ret == 0 );
+
+        memo->updated = 1;
+    }
+#endif
+
+    return( ret );
+}
+
+static int x509_crt_verify_top(
+                mbedtls_x509_crt *child, mbedtls_x509_crt *trust_ca,
+                mbedtls_x509_crt *start, mbedtls_x509_crl *ca_crl,
+                const mbedtls_x509_crt_profile *profile,
+                int path_cnt, int self_cnt, uint32_t *flags,
+                int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                void *p_vrfy, struct x509_crt_sig_memo *memo )
+{
+    int ret;
+    uint32_t ca_flags = 0;
+    int check_path_cnt;
+    unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+    const mbedtls_md_info_t *md_info;
+    mbedtls_x509_crt *parent = NULL;
+    mbedtls_x509_crt *future_past_ca = NULL;
+    x509_crt_parents parents;
+    int pass = 1;
+#if defined(MBEDTLS_X509_CA_STORE)
+    mbedtls_x509_buf auth_key_id;
+#endif
+
+    if( mbedtls_x509_time_is_past( &child->valid_to ) )
+        *flags |= MBEDTLS_X509_BADCERT_EXPIRED;
+
+    if( mbedtls_x509_time_is_future( &child->valid_from ) )
+        *flags |= MBEDTLS_X509_BADCERT_FUTURE;
+
+    if( x509_profile_check_md_alg( profile, child->sig_md ) != 0 )
+        *flags |= MBEDTLS_X509_BADCERT_BAD_MD;
+
+    if( x509_profile_check_pk_alg( profile, child->sig_pk ) != 0 )
+        *flags |= MBEDTLS_X509_BADCERT_BAD_PK;
+
+    /*
+     * Child is the top of the chain. Check against the trust_ca list,
+     * starting from start.
+     */
+    *flags |= MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+
+    md_info = mbedtls_md_info_from_type( child->sig_md );
+    if( md_info == NULL )
+    {
+        /*
+         * Cannot check 'unknown', no need to try any CA
+         */
+        start = NULL;
+    }
+    else
+        mbedtls_md( md_info, child->tbs.p, child->tbs.len, hash );
+
+#if defined(MBEDTLS_X509_CA_STORE)
+    /*
+     * With a store, first try the valid CAs whose subject key identifier
+     * matches the authority key identifier of the child
+     */
+    if( start != NULL && x509_ca_store_get( trust_ca ) != NULL )
+    {
+        x509_crt_get_key_id( child, 0, &auth_key_id );
+        if( auth_key_id.p != NULL )
+            pass = 0;
+    }
+#endif
+
+    for( ; parent == NULL && pass < 2; pass++ )
+    {
+        x509_crt_parents_init( &parents, child, trust_ca, start );
+
+        while( ( parent = x509_crt_parents_next( &parents ) ) != NULL )
+        {
+#if defined(MBEDTLS_X509_CA_STORE)
+            if( pass == 0 &&
+                ( parents.key_id == NULL ||
+                  parents.key_id->len != auth_key_id.len ||
+                  memcmp( parents.key_id->p, auth_key_id.p,
+                          auth_key_id.len ) != 0 ) )
+            {
+                continue;
+            }
+#endif
+
+            if( x509_crt_check_parent( child, parent, 1, path_cnt == 0 ) != 0 )
+                continue;
+
+            check_path_cnt = path_cnt + 1;
+
+            /*
+             * Reduce check_path_cnt to check against if top of the chain is
+             * the same as the trusted CA
+             */
+            if( child->subject_raw.len == parent->subject_raw.len &&
+                memcmp( child->subject_raw.p, parent->subject_raw.p,
+                                child->issuer_raw.len ) == 0 )
+            {
+                check_path_cnt--;
+            }
+
+            /* Self signed certificates do not count towards the limit */
+            if( parent->max_pathlen > 0 &&
+                parent->max_pathlen < check_path_cnt - self_cnt )
+            {
+                continue;
+            }
+
+            if( x509_crt_check_signature( child, parent, md_info, hash,
+                                          memo ) != 0 )
+            {
+                continue;
+            }
+
+            if( mbedtls_x509_time_is_past( &parent->valid_to ) ||
+                mbedtls_x509_time_is_future( &parent->valid_from ) )
+            {
+                if ( pass == 1 && future_past_ca == NULL )
+                    future_past_ca = parent;
+
+                continue;
+            }
+
+            break;
+        }
+    }
+
+    if( parent != NULL || ( parent = future_past_ca ) != NULL )
+    {
+        /*
+         * Top of chain is signed by a trusted CA
+         */
+        *flags &= ~MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+
+        if( x509_profile_check_key( profile, child->sig_pk, &parent->pk ) != 0 )
+            *flags |= MBEDTLS_X509_BADCERT_BAD_KEY;
+    }
+
+    /*
+     * If top of chain is not the same as the trusted CA send a verify request
+     * to the callback for any issues with validity and CRL presence for the
+     * trusted CA certificate.
+     */
+    if( parent != NULL &&
+        ( child->subject_raw.len != parent->subject_raw.len ||
+          memcmp( child->subject_raw.p, parent->subject_raw.p,
+                            child->issuer_raw.len ) != 0 ) )
+    {
+#if defined(MBEDTLS_X509_CRL_PARSE_C)
+        /* Check trusted CA's CRL for the chain's top crt */
+        *flags |= x509_crt_verifycrl( child, parent, ca_crl, profile );
+#else
+        ((void) ca_crl);
+#endif
+
+        if( mbedtls_x509_time_is_past( &parent->valid_to ) )
+            ca_flags |= MBEDTLS_X509_BADCERT_EXPIRED;
+
+        if( mbedtls_x509_time_is_future( &parent->valid_from ) )
+            ca_flags |= MBEDTLS_X509_BADCERT_FUTURE;
+
+        if( NULL != f_vrfy )
+        {
+            if( ( ret = f_vrfy( p_vrfy, parent, path_cnt + 1,
+                                &ca_flags ) ) != 0 )
+            {
+                return( ret );
+            }
+        }
+    }
+
+    /* Call callback on top cert */
+    if( NULL != f_vrfy )
+    {
+        if( ( ret = f_vrfy( p_vrfy, child, path_cnt, flags ) ) != 0 )
+            return( ret );
+    }
+
+    *flags |= ca_flags;
+
+    return( 0 );
+}
+
+static int x509_crt_verify_child(
+                mbedtls_x509_crt *child, mbedtls_x509_crt *parent,
+                mbedtls_x509_crt *trust_ca, mbedtls_x509_crl *ca_crl,
+                const mbedtls_x509_crt_profile *profile,
+                int path_cnt, int self_cnt, uint32_t *flags,
+                int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                void *p_vrfy, struct x509_crt_sig_memo *memo )
+{
+    int ret;
+    uint32_t parent_flags = 0;
     unsigned char hash[MBEDTLS_MD_MAX_SIZE];
     mbedtls_x509_crt *grandparent;
     const mbedtls_md_info_t *md_info;
@@ -2088,9 +2761,8 @@ static int x509_crt_verify_child(
         if( x509_profile_check_key( profile, child->sig_pk, &parent->pk ) != 0 )
             *flags |= MBEDTLS_X509_BADCERT_BAD_KEY;
 
-        if( mbedtls_pk_verify_ext( child->sig_pk, child->sig_opts, &parent->pk,
-                           child->sig_md, hash, mbedtls_md_get_size( md_info ),
-                           child->sig.p, child->sig.len ) != 0 )
+        if( x509_crt_check_signature( child, parent, md_info, hash,
+                                      memo ) != 0 )
         {
             *flags |= MBEDTLS_X509_BADCERT_NOT_TRUSTED;
         }
@@ -2102,19 +2774,13 @@ static int x509_crt_verify_child(
 #endif
 
     /* Look for a grandparent in trusted CAs */
-    for( grandparent = trust_ca;
-         grandparent != NULL;
-         grandparent = grandparent->next )
-    {
-        if( x509_crt_check_parent( parent, grandparent,
-                                   0, path_cnt == 0 ) == 0 )
-            break;
-    }
+    grandparent = x509_crt_find_trusted_parent( parent, trust_ca, path_cnt == 0 );
 
     if( grandparent != NULL )
     {
-        ret = x509_crt_verify_top( parent, grandparent, ca_crl, profile,
-                                path_cnt + 1, self_cnt, &parent_flags, f_vrfy, p_vrfy );
+        ret = x509_crt_verify_top( parent, trust_ca, grandparent, ca_crl, profile,
+                                path_cnt + 1, self_cnt, &parent_flags, f_vrfy, p_vrfy,
+                                memo );
         if( ret != 0 )
             return( ret );
     }
@@ -2144,15 +2810,15 @@ static int x509_crt_verify_child(
         {
             ret = x509_crt_verify_child( parent, grandparent, trust_ca, ca_crl,
                                          profile, path_cnt + 1, self_cnt, &parent_flags,
-                                         f_vrfy, p_vrfy );
+                                         f_vrfy, p_vrfy, memo );
             if( ret != 0 )
                 return( ret );
         }
         else
         {
-            ret = x509_crt_verify_top( parent, trust_ca, ca_crl, profile,
+            ret = x509_crt_verify_top( parent, trust_ca, trust_ca, ca_crl, profile,
                                        path_cnt + 1, self_cnt, &parent_flags,
-                                       f_vrfy, p_vrfy );
+                                       f_vrfy, p_vrfy, memo );
             if( ret != 0 )
                 return( ret );
         }
@@ -2184,15 +2850,16 @@ int mbedtls_x509_crt_verify( mbedtls_x509_crt *crt,
 
 
 /*
- * Verify the certificate validity, with profile
+ * Verify the certificate validity, with profile, reusing and recording
+ * signature checks in memo if not NULL
  */
-int mbedtls_x509_crt_verify_with_profile( mbedtls_x509_crt *crt,
+static int x509_crt_verify_chain( mbedtls_x509_crt *crt,
                      mbedtls_x509_crt *trust_ca,
                      mbedtls_x509_crl *ca_crl,
                      const mbedtls_x509_crt_profile *profile,
                      const char *cn, uint32_t *flags,
                      int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
-                     void *p_vrfy )
+                     void *p_vrfy, struct x509_crt_sig_memo *memo )
 {
     size_t cn_len;
     int ret;
@@ -2207,6 +2874,16 @@ int mbedtls_x509_crt_verify_with_profile( mbedtls_x509_crt *crt,
 
     *flags = 0;
 
+    /*
+     * The chain to verify is decoded in full here, the trusted CAs only
+     * as x509_crt_check_parent() considers them
+     */
+    for( parent = crt; parent != NULL; parent = parent->next )
+    {
+        if( ( ret = x509_crt_decode( parent, X509_CRT_PART_ALL ) ) != 0 )
+            return( ret );
+    }
+
     if( cn != NULL )
     {
         name = &crt->subject;
@@ -2269,16 +2946,13 @@ int mbedtls_x509_crt_verify_with_profile( mbedtls_x509_crt *crt,
         *flags |= MBEDTLS_X509_BADCERT_BAD_KEY;
 
     /* Look for a parent in trusted CAs */
-    for( parent = trust_ca; parent != NULL; parent = parent->next )
-    {
-        if( x509_crt_check_parent( crt, parent, 0, pathlen == 0 ) == 0 )
-            break;
-    }
+    parent = x509_crt_find_trusted_parent( crt, trust_ca, pathlen == 0 );
 
     if( parent != NULL )
     {
-        ret = x509_crt_verify_top( crt, parent, ca_crl, profile,
-                                   pathlen, selfsigned, flags, f_vrfy, p_vrfy );
+        ret = x509_crt_verify_top( crt, trust_ca, parent, ca_crl, profile,
+                                   pathlen, selfsigned, flags, f_vrfy, p_vrfy,
+                                   memo );
         if( ret != 0 )
             return( ret );
     }
@@ -2293,14 +2967,16 @@ int mbedtls_x509_crt_verify_with_profile( mbedtls_x509_crt *crt,
         if( parent != NULL )
         {
             ret = x509_crt_verify_child( crt, parent, trust_ca, ca_crl, profile,
-                                         pathlen, selfsigned, flags, f_vrfy, p_vrfy );
+                                         pathlen, selfsigned, flags, f_vrfy, p_vrfy,
+                                         memo );
             if( ret != 0 )
                 return( ret );
         }
         else
         {
-            ret = x509_crt_verify_top( crt, trust_ca, ca_crl, profile,
-                                       pathlen, selfsigned, flags, f_vrfy, p_vrfy );
+            ret = x509_crt_verify_top( crt, trust_ca, trust_ca, ca_crl, profile,
+                                       pathlen, selfsigned, flags, f_vrfy, p_vrfy,
+                                       memo );
             if( ret != 0 )
                 return( ret );
         }
@@ -2312,6 +2988,322 @@ int mbedtls_x509_crt_verify_with_profile( mbedtls_x509_crt *crt,
     return( 0 );
 }
 
+/*
+ * Verify the certificate validity, with profile
+ */
+int mbedtls_x509_crt_verify_with_profile( mbedtls_x509_crt *crt,
+                     mbedtls_x509_crt *trust_ca,
+                     mbedtls_x509_crl *ca_crl,
+                     const mbedtls_x509_crt_profile *profile,
+                     const char *cn, uint32_t *flags,
+                     int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                     void *p_vrfy )
+{
+    return( x509_crt_verify_chain( crt, trust_ca, ca_crl, profile, cn, flags,
+                                   f_vrfy, p_vrfy, NULL ) );
+}
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+void mbedtls_x509_verify_cache_init( mbedtls_x509_verify_cache *cache )
+{
+    memset( cache, 0, sizeof( mbedtls_x509_verify_cache ) );
+
+    cache->timeout = MBEDTLS_X509_VERIFY_CACHE_DEFAULT_TIMEOUT;
+    cache->max_entries = MBEDTLS_X509_VERIFY_CACHE_DEFAULT_MAX_ENTRIES;
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_init( &cache->mutex );
+#endif
+}
+
+#if defined(MBEDTLS_HAVE_TIME)
+void mbedtls_x509_verify_cache_set_timeout( mbedtls_x509_verify_cache *cache,
+                                            int timeout )
+{
+    if( timeout < 0 ) timeout = 0;
+
+    cache->timeout = timeout;
+}
+#endif /* MBEDTLS_HAVE_TIME */
+
+void mbedtls_x509_verify_cache_set_max_entries( mbedtls_x509_verify_cache *cache,
+                                                int max )
+{
+    if( max < 0 ) max = 0;
+
+    cache->max_entries = max;
+}
+
+void mbedtls_x509_verify_cache_get_stats( mbedtls_x509_verify_cache *cache,
+                                          unsigned long *hits,
+                                          unsigned long *misses )
+{
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_lock( &cache->mutex ) != 0 )
+        return;
+#endif
+
+    *hits = cache->hits;
+    *misses = cache->misses;
+
+#if defined(MBEDTLS_THREADING_C)
+    (void) mbedtls_mutex_unlock( &cache->mutex );
+#endif
+}
+
+void mbedtls_x509_verify_cache_free( mbedtls_x509_verify_cache *cache )
+{
+    mbedtls_x509_verify_cache_entry *cur, *prv;
+
+    cur = cache->chain;
+
+    while( cur != NULL )
+    {
+        prv = cur;
+        cur = cur->next;
+
+        mbedtls_zeroize( prv, sizeof( mbedtls_x509_verify_cache_entry ) );
+        mbedtls_free( prv );
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_free( &cache->mutex );
+#endif
+
+    cache->chain = NULL;
+}
+
+static void x509_verify_cache_put_uint32( unsigned char *p, uint32_t n )
+{
+    p[0] = (unsigned char)( n >> 24 );
+    p[1] = (unsigned char)( n >> 16 );
+    p[2] = (unsigned char)( n >>  8 );
+    p[3] = (unsigned char)( n       );
+}
+
+/*
+ * Cache key: hash of the DER of the chain, and of the profile
+ */
+static void x509_verify_cache_key( const mbedtls_x509_crt *crt,
+                                   const mbedtls_x509_crt_profile *profile,
+                                   unsigned char key[32] )
+{
+    mbedtls_sha256_context sha256;
+    unsigned char buf[16];
+
+    mbedtls_sha256_init( &sha256 );
+    mbedtls_sha256_starts( &sha256, 0 );
+
+    for( ; crt != NULL; crt = crt->next )
+    {
+        x509_verify_cache_put_uint32( buf, (uint32_t) crt->raw.len );
+        mbedtls_sha256_update( &sha256, buf, 4 );
+        mbedtls_sha256_update( &sha256, crt->raw.p, crt->raw.len );
+    }
+
+    x509_verify_cache_put_uint32( buf,      profile->allowed_mds );
+    x509_verify_cache_put_uint32( buf +  4, profile->allowed_pks );
+    x509_verify_cache_put_uint32( buf +  8, profile->allowed_curves );
+    x509_verify_cache_put_uint32( buf + 12, profile->rsa_min_bitlen );
+    mbedtls_sha256_update( &sha256, buf, 16 );
+
+    mbedtls_sha256_finish( &sha256, key );
+    mbedtls_sha256_free( &sha256 );
+}
+
+/*
+ * Load the signature checks of a previous verification of the chain, if any
+ */
+static void x509_verify_cache_get( mbedtls_x509_verify_cache *cache,
+                                   const unsigned char key[32],
+                                   struct x509_crt_sig_memo *memo )
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time( NULL );
+#endif
+    mbedtls_x509_verify_cache_entry *cur;
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_lock( &cache->mutex ) != 0 )
+        return;
+#endif
+
+    for( cur = cache->chain; cur != NULL; cur = cur->next )
+    {
+#if defined(MBEDTLS_HAVE_TIME)
+        if( cache->timeout != 0 &&
+            (int) ( t - cur->timestamp ) > cache->timeout )
+            continue;
+#endif
+
+        if( memcmp( cur->key, key, 32 ) == 0 )
+            break;
+    }
+
+    if( cur != NULL )
+    {
+        memo->sig_count = cur->sig_count;
+        memcpy( memo->sigs, cur->sigs,
+                cur->sig_count * sizeof( mbedtls_x509_verify_cache_sig ) );
+        cache->hits++;
+    }
+    else
+        cache->misses++;
+
+#if defined(MBEDTLS_THREADING_C)
+    (void) mbedtls_mutex_unlock( &cache->mutex );
+#endif
+}
+
+/*
+ * Store the signature checks of a verification of the chain
+ */
+static void x509_verify_cache_set( mbedtls_x509_verify_cache *cache,
+                                   const unsigned char key[32],
+                                   const struct x509_crt_sig_memo *memo )
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time( NULL ), oldest = 0;
+    mbedtls_x509_verify_cache_entry *old = NULL;
+#endif
+    mbedtls_x509_verify_cache_entry *cur, *prv;
+    int count = 0;
+
+#if defined(MBEDTLS_THREADING_C)
+    if( mbedtls_mutex_lock( &cache->mutex ) != 0 )
+        return;
+#endif
+
+    cur = cache->chain;
+    prv = NULL;
+
+    while( cur != NULL )
+    {
+        count++;
+
+#if defined(MBEDTLS_HAVE_TIME)
+        if( cache->timeout != 0 &&
+            (int) ( t - cur->timestamp ) > cache->timeout )
+        {
+            cur->timestamp = t;
+            break; /* expired, reuse this slot, update timestamp */
+        }
+#endif
+
+        if( memcmp( cur->key, key, 32 ) == 0 )
+            break; /* more checks for a known chain, keep timestamp */
+
+#if defined(MBEDTLS_HAVE_TIME)
+        if( oldest == 0 || cur->timestamp < oldest )
+        {
+            oldest = cur->timestamp;
+            old = cur;
+        }
+#endif
+
+        prv = cur;
+        cur = cur->next;
+    }
+
+    if( cur == NULL )
+    {
+#if defined(MBEDTLS_HAVE_TIME)
+        /*
+         * Reuse oldest entry if max_entries reached
+         */
+        if( count >= cache->max_entries )
+        {
+            if( old == NULL )
+                goto exit;
+
+            cur = old;
+        }
+#else /* MBEDTLS_HAVE_TIME */
+        /*
+         * Reuse first entry in chain if max_entries reached,
+         * but move to last place
+         */
+        if( count >= cache->max_entries )
+        {
+            if( cache->chain == NULL )
+                goto exit;
+
+            cur = cache->chain;
+            if( cur != prv )
+            {
+                cache->chain = cur->next;
+                cur->next = NULL;
+                prv->next = cur;
+            }
+        }
+#endif /* MBEDTLS_HAVE_TIME */
+        else
+        {
+            /*
+             * max_entries not reached, create new entry
+             */
+            cur = mbedtls_calloc( 1, sizeof( mbedtls_x509_verify_cache_entry ) );
+            if( cur == NULL )
+                goto exit;
+
+            if( prv == NULL )
+                cache->chain = cur;
+            else
+                prv->next = cur;
+        }
+
+#if defined(MBEDTLS_HAVE_TIME)
+        cur->timestamp = t;
+#endif
+    }
+
+    memcpy( cur->key, key, 32 );
+    cur->sig_count = memo->sig_count;
+    memcpy( cur->sigs, memo->sigs,
+            memo->sig_count * sizeof( mbedtls_x509_verify_cache_sig ) );
+
+exit:
+#if defined(MBEDTLS_THREADING_C)
+    (void) mbedtls_mutex_unlock( &cache->mutex );
+#endif
+    return;
+}
+
+/*
+ * Verify the certificate validity, with profile, with a verify cache
+ */
+int mbedtls_x509_crt_verify_with_cache( mbedtls_x509_crt *crt,
+                     mbedtls_x509_crt *trust_ca,
+                     mbedtls_x509_crl *ca_crl,
+                     const mbedtls_x509_crt_profile *profile,
+                     mbedtls_x509_verify_cache *cache,
+                     const char *cn, uint32_t *flags,
+                     int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                     void *p_vrfy )
+{
+    int ret;
+    unsigned char key[32];
+    struct x509_crt_sig_memo memo;
+
+    if( profile == NULL || cache == NULL )
+        return( MBEDTLS_ERR_X509_BAD_INPUT_DATA );
+
+    memset( &memo, 0, sizeof( memo ) );
+    memo.chain = crt;
+
+    x509_verify_cache_key( crt, profile, key );
+    x509_verify_cache_get( cache, key, &memo );
+
+    ret = x509_crt_verify_chain( crt, trust_ca, ca_crl, profile, cn, flags,
+                                 f_vrfy, p_vrfy, &memo );
+
+    if( memo.updated )
+        x509_verify_cache_set( cache, key, &memo );
+
+    return( ret );
+}
+#endif /* MBEDTLS_X509_VERIFY_CACHE */
+
 /*
  * Initialize a certificate chain
  */
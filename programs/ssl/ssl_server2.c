@@ -81,6 +81,10 @@ int main( void )
 #include "mbedtls/ssl_ticket.h"
 #endif
 
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+#include "mbedtls/ssl_buffer_pool.h"
+#endif
+
 #if defined(MBEDTLS_SSL_COOKIE_C)
 #include "mbedtls/ssl_cookie.h"
 #endif
@@ -102,6 +106,17 @@ int main( void )
 #define DFL_DEBUG_LEVEL         0
 #define DFL_NBIO                0
 #define DFL_READ_TIMEOUT        0
+#define DFL_WRITE_INPLACE       0
+#define DFL_WRITE_BATCH         0
+#define DFL_BUFFER_POOL         0
+#define DFL_LEAN                0
+#define DFL_ASYNC_OPERATIONS    "-"
+#define DFL_ASYNC_PRIVATE_DELAY 0
+#define DFL_ASYNC_PRIVATE_ERROR 0
+#define DFL_ASYNC_VERIFY        0
+#define DFL_ASYNC_VERIFY_DELAY  0
+#define DFL_ASYNC_VERIFY_ERROR  0
+#define DFL_VERIFY_CACHE        0
 #define DFL_CA_FILE             ""
 #define DFL_CA_PATH             ""
 #define DFL_CRT_FILE            ""
@@ -323,6 +338,64 @@ int main( void )
 #define USAGE_CURVES ""
 #endif
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+#define USAGE_WRITE_BATCH \
+    "    write_batch=%%d      default: 0 (send each record on its own)\n" \
+    "                        N: hold back records in a buffer of N bytes\n"
+#else
+#define USAGE_WRITE_BATCH ""
+#endif
+
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+#define USAGE_BUFFER_POOL \
+    "    buffer_pool=%%d      default: 0 (buffers allocated with the context)\n" \
+    "                        options: 1 (buffers taken from a pool when needed)\n"
+#else
+#define USAGE_BUFFER_POOL ""
+#endif
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+#define USAGE_LEAN \
+    "    lean=%%d             default: 0 (keep the peer certificate)\n" \
+    "                        options: 1 (keep only its digest and a few fields)\n"
+#else
+#define USAGE_LEAN ""
+#endif
+
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+#define USAGE_ASYNC \
+    "    async_operations=%%s default: \"-\" (synchronous private key operations)\n" \
+    "                        d=decrypt, s=sign: run them through the async callbacks\n" \
+    "    async_private_delay=%%d default: 0 (complete at the first resume)\n" \
+    "                        N: return IN_PROGRESS N more times, -1: complete at start\n" \
+    "    async_private_error=%%d default: 0 (no error injected)\n" \
+    "                        1: fail at start, 2: fail at resume,\n" \
+    "                        3: give up the handshake while in progress\n"
+#else
+#define USAGE_ASYNC ""
+#endif
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+#define USAGE_ASYNC_VERIFY \
+    "    async_verify=%%d     default: 0 (synchronous certificate verification)\n" \
+    "                        1: run it through the async callbacks\n" \
+    "    async_verify_delay=%%d default: 0 (complete at the first resume)\n" \
+    "                        N: return IN_PROGRESS N more times, -1: complete at start\n" \
+    "    async_verify_error=%%d default: 0 (no error injected)\n" \
+    "                        1: fail at start, 2: fail at resume,\n" \
+    "                        3: give up the handshake while in progress\n"
+#else
+#define USAGE_ASYNC_VERIFY ""
+#endif
+
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+#define USAGE_VERIFY_CACHE \
+    "    verify_cache=%%d     default: 0 (verify each client chain in full)\n" \
+    "                        1: reuse the signature checks of known chains\n"
+#else
+#define USAGE_VERIFY_CACHE ""
+#endif
+
 #define USAGE \
     "\n usage: ssl_server2 param=<>...\n"                   \
     "\n acceptable parameters:\n"                           \
@@ -332,6 +405,8 @@ int main( void )
     "    nbio=%%d             default: 0 (blocking I/O)\n"  \
     "                        options: 1 (non-blocking), 2 (added delays)\n" \
     "    read_timeout=%%d     default: 0 ms (no timeout)\n"    \
+    "    write_inplace=%%d    default: 0 (copy with mbedtls_ssl_write())\n" \
+    "                        options: 1 (mbedtls_ssl_write_prepare/commit())\n" \
     "\n"                                                    \
     USAGE_DTLS                                              \
     USAGE_COOKIES                                           \
@@ -360,6 +435,12 @@ int main( void )
     USAGE_EMS                                               \
     USAGE_ETM                                               \
     USAGE_CURVES                                            \
+    USAGE_WRITE_BATCH                                       \
+    USAGE_BUFFER_POOL                                       \
+    USAGE_LEAN                                              \
+    USAGE_ASYNC                                             \
+    USAGE_ASYNC_VERIFY                                      \
+    USAGE_VERIFY_CACHE                                      \
     "\n"                                                    \
     "    arc4=%%d             default: (library default: 0)\n" \
     "    allow_sha1=%%d       default: 0\n"                             \
@@ -397,6 +478,17 @@ struct options
     int debug_level;            /* level of debugging                       */
     int nbio;                   /* should I/O be blocking?                  */
     uint32_t read_timeout;      /* timeout on mbedtls_ssl_read() in milliseconds    */
+    int write_inplace;          /* use mbedtls_ssl_write_prepare/commit()?  */
+    int write_batch;            /* size of the record batching buffer       */
+    int buffer_pool;            /* take record buffers from a pool?         */
+    int lean;                   /* release handshake-only state?            */
+    const char *async_operations; /* private key operations to run async   */
+    int async_private_delay;    /* IN_PROGRESS returns of async operations  */
+    int async_private_error;    /* error to inject in async operations      */
+    int async_verify;           /* verify the peer certificate async?       */
+    int async_verify_delay;     /* IN_PROGRESS returns of async verification */
+    int async_verify_error;     /* error to inject in async verification    */
+    int verify_cache;           /* use a verify cache?                      */
     const char *ca_file;        /* the file with the CA certificate(s)      */
     const char *ca_path;        /* the path with the CA certificate(s) reside */
     const char *crt_file;       /* the file with the server certificate     */
@@ -494,6 +586,352 @@ static int my_send( void *ctx, const unsigned char *buf, size_t len )
     return( ret );
 }
 
+/*
+ * Write application data, either with mbedtls_ssl_write() or, if
+ * write_inplace is set, by filling the area lent by
+ * mbedtls_ssl_write_prepare() and sending it with mbedtls_ssl_write_commit()
+ */
+static int server_write( mbedtls_ssl_context *ssl, const unsigned char *buf,
+                         size_t len )
+{
+    unsigned char *out;
+    size_t out_len;
+    int ret;
+
+    if( opt.write_inplace == 0 )
+        return( mbedtls_ssl_write( ssl, buf, len ) );
+
+    ret = mbedtls_ssl_write_prepare( ssl, &out, &out_len );
+
+    /* Not available with 1/n-1 record splitting */
+    if( ret == MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE )
+        return( mbedtls_ssl_write( ssl, buf, len ) );
+
+    if( ret != 0 )
+        return( ret );
+
+    if( out_len > len )
+        out_len = len;
+
+    memcpy( out, buf, out_len );
+
+    /* Once the record is protected, only the flush may need to be retried */
+    do ret = mbedtls_ssl_write_commit( ssl, out_len );
+    while( ret == MBEDTLS_ERR_SSL_WANT_READ ||
+           ret == MBEDTLS_ERR_SSL_WANT_WRITE );
+
+    if( ret != 0 )
+        return( ret );
+
+    return( (int) out_len );
+}
+
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) || defined(MBEDTLS_SSL_ASYNC_VERIFY)
+#define ASYNC_INJECT_ERROR_START    1   /* fail in the start callback       */
+#define ASYNC_INJECT_ERROR_RESUME   2   /* fail in the resume callback      */
+#define ASYNC_INJECT_ERROR_CANCEL   3   /* give up the handshake meanwhile  */
+#endif
+
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+
+/*
+ * Asynchronous private key operations, standing in for a worker pool or a
+ * key service: the operation is recorded at start and done after a given
+ * number of resume calls
+ */
+typedef struct
+{
+    mbedtls_x509_crt *cert[2];  /* certificates with their private keys */
+    mbedtls_pk_context *pk[2];
+    int delay;                  /* IN_PROGRESS returns from resume      */
+    int inject_error;           /* ASYNC_INJECT_ERROR_xxx, or 0         */
+    int (*f_rng)(void *, unsigned char *, size_t);
+    void *p_rng;
+} async_key_context;
+
+typedef struct
+{
+    mbedtls_pk_context *pk;     /* private key to use                   */
+    int is_sign;                /* signature, or decryption             */
+    mbedtls_md_type_t md_alg;   /* hash algorithm of a signature        */
+    unsigned char input[MBEDTLS_MPI_MAX_SIZE]; /* hash or ciphertext    */
+    size_t input_len;
+    int remaining_delay;
+} async_operation_context;
+
+static int async_start( async_key_context *key_ctx, mbedtls_ssl_context *ssl,
+                        mbedtls_x509_crt *cert, int is_sign,
+                        mbedtls_md_type_t md_alg,
+                        const unsigned char *input, size_t input_len )
+{
+    async_operation_context *op;
+    int i;
+
+    mbedtls_printf( "Async %s callback: looking for a key\n",
+                    is_sign ? "sign" : "decrypt" );
+
+    for( i = 0; i < 2; i++ )
+        if( key_ctx->cert[i] == cert && key_ctx->pk[i] != NULL )
+            break;
+    if( i == 2 )
+    {
+        mbedtls_printf( "Async %s callback: no key matches this certificate\n",
+                        is_sign ? "sign" : "decrypt" );
+        return( MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH );
+    }
+
+    if( key_ctx->inject_error == ASYNC_INJECT_ERROR_START )
+    {
+        mbedtls_printf( "Async %s callback: injected error\n",
+                        is_sign ? "sign" : "decrypt" );
+        return( MBEDTLS_ERR_PK_FEATURE_UNAVAILABLE );
+    }
+
+    if( input_len > MBEDTLS_MPI_MAX_SIZE )
+        return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
+
+    op = mbedtls_calloc( 1, sizeof( async_operation_context ) );
+    if( op == NULL )
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+
+    op->pk = key_ctx->pk[i];
+    op->is_sign = is_sign;
+    op->md_alg = md_alg;
+    memcpy( op->input, input, input_len );
+    op->input_len = input_len;
+    op->remaining_delay = key_ctx->delay;
+    mbedtls_ssl_set_async_operation_data( ssl, op );
+
+    if( op->remaining_delay < 0 )
+        return( 0 );
+
+    mbedtls_printf( "Async %s callback: using key slot %d, delay=%d\n",
+                    is_sign ? "sign" : "decrypt", i, op->remaining_delay );
+    return( MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS );
+}
+
+static int async_sign_start( void *p_async, mbedtls_ssl_context *ssl,
+                             mbedtls_x509_crt *cert, mbedtls_md_type_t md_alg,
+                             const unsigned char *hash, size_t hash_len )
+{
+    return( async_start( p_async, ssl, cert, 1, md_alg, hash, hash_len ) );
+}
+
+static int async_decrypt_start( void *p_async, mbedtls_ssl_context *ssl,
+                                mbedtls_x509_crt *cert,
+                                const unsigned char *input, size_t input_len )
+{
+    return( async_start( p_async, ssl, cert, 0, MBEDTLS_MD_NONE,
+                         input, input_len ) );
+}
+
+static int async_resume( void *p_async, mbedtls_ssl_context *ssl,
+                         unsigned char *output, size_t *output_len,
+                         size_t output_size )
+{
+    async_key_context *key_ctx = p_async;
+    async_operation_context *op = mbedtls_ssl_get_async_operation_data( ssl );
+    const char *op_name = op->is_sign ? "sign" : "decrypt";
+    int ret;
+
+    if( op->remaining_delay > 0 )
+    {
+        --op->remaining_delay;
+        mbedtls_printf( "Async resume (%s): call again (%d)\n",
+                        op_name, op->remaining_delay );
+        return( MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS );
+    }
+
+    if( key_ctx->inject_error == ASYNC_INJECT_ERROR_RESUME )
+    {
+        mbedtls_printf( "Async resume (%s): injected error\n", op_name );
+        ret = MBEDTLS_ERR_PK_FEATURE_UNAVAILABLE;
+    }
+    else if( op->is_sign )
+    {
+        /* mbedtls_pk_sign() has no output size: make sure the largest
+         * signature of the key fits */
+        if( output_size < MBEDTLS_MPI_MAX_SIZE + 16 )
+            ret = MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+        else
+            ret = mbedtls_pk_sign( op->pk, op->md_alg,
+                                   op->input, op->input_len,
+                                   output, output_len,
+                                   key_ctx->f_rng, key_ctx->p_rng );
+    }
+    else
+    {
+        ret = mbedtls_pk_decrypt( op->pk, op->input, op->input_len,
+                                  output, output_len, output_size,
+                                  key_ctx->f_rng, key_ctx->p_rng );
+    }
+
+    mbedtls_printf( "Async resume (%s): done, status=%d\n", op_name, ret );
+    mbedtls_free( op );
+    return( ret );
+}
+
+static void async_cancel( void *p_async, mbedtls_ssl_context *ssl )
+{
+    async_operation_context *op = mbedtls_ssl_get_async_operation_data( ssl );
+
+    (void) p_async;
+    mbedtls_printf( "Async cancel callback.\n" );
+    mbedtls_free( op );
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+/*
+ * Asynchronous certificate verification, standing in for a worker thread:
+ * the arguments are recorded at start and the chain is verified after a
+ * given number of resume calls
+ */
+typedef struct
+{
+    int delay;                  /* IN_PROGRESS returns from resume      */
+    int inject_error;           /* ASYNC_INJECT_ERROR_xxx, or 0         */
+} async_verify_context;
+
+typedef struct
+{
+    mbedtls_x509_crt *crt;
+    mbedtls_x509_crt *ca_chain;
+    mbedtls_x509_crl *ca_crl;
+    const mbedtls_x509_crt_profile *profile;
+    const char *cn;
+    int remaining_delay;
+} async_verify_operation;
+
+static int async_verify_start( void *p_async_verify, mbedtls_ssl_context *ssl,
+                               mbedtls_x509_crt *crt,
+                               mbedtls_x509_crt *ca_chain,
+                               mbedtls_x509_crl *ca_crl,
+                               const mbedtls_x509_crt_profile *profile,
+                               const char *cn )
+{
+    async_verify_context *ctx = p_async_verify;
+    async_verify_operation *op;
+
+    if( ctx->inject_error == ASYNC_INJECT_ERROR_START )
+    {
+        mbedtls_printf( "Async verify callback: injected error\n" );
+        return( MBEDTLS_ERR_X509_FEATURE_UNAVAILABLE );
+    }
+
+    op = mbedtls_calloc( 1, sizeof( async_verify_operation ) );
+    if( op == NULL )
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+
+    op->crt = crt;
+    op->ca_chain = ca_chain;
+    op->ca_crl = ca_crl;
+    op->profile = profile;
+    op->cn = cn;
+    op->remaining_delay = ctx->delay;
+    mbedtls_ssl_set_async_operation_data( ssl, op );
+
+    if( op->remaining_delay < 0 )
+    {
+        mbedtls_printf( "Async verify callback: completed at start\n" );
+        return( 0 );
+    }
+
+    mbedtls_printf( "Async verify callback: started, delay=%d\n",
+                    op->remaining_delay );
+    return( MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS );
+}
+
+static int async_verify_resume( void *p_async_verify, mbedtls_ssl_context *ssl,
+                                uint32_t *flags )
+{
+    async_verify_context *ctx = p_async_verify;
+    async_verify_operation *op = mbedtls_ssl_get_async_operation_data( ssl );
+    int ret;
+
+    if( op->remaining_delay > 0 )
+    {
+        --op->remaining_delay;
+        mbedtls_printf( "Async verify resume: call again (%d)\n",
+                        op->remaining_delay );
+        return( MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS );
+    }
+
+    if( ctx->inject_error == ASYNC_INJECT_ERROR_RESUME )
+    {
+        mbedtls_printf( "Async verify resume: injected error\n" );
+        ret = MBEDTLS_ERR_X509_FEATURE_UNAVAILABLE;
+    }
+    else
+    {
+        ret = mbedtls_x509_crt_verify_with_profile( op->crt, op->ca_chain,
+                                                    op->ca_crl, op->profile,
+                                                    op->cn, flags,
+                                                    NULL, NULL );
+    }
+
+    mbedtls_printf( "Async verify resume: done, status=%d\n", ret );
+    mbedtls_free( op );
+    return( ret );
+}
+
+static void async_verify_cancel( void *p_async_verify,
+                                 mbedtls_ssl_context *ssl )
+{
+    async_verify_operation *op = mbedtls_ssl_get_async_operation_data( ssl );
+
+    (void) p_async_verify;
+    mbedtls_printf( "Async verify cancel callback.\n" );
+    mbedtls_free( op );
+}
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS) && defined(MBEDTLS_X509_CRT_PARSE_C)
+/*
+ * Print what is left of the peer certificate in lean mode
+ */
+static void print_peer_id( const mbedtls_ssl_context *ssl )
+{
+    const unsigned char *digest = mbedtls_ssl_get_peer_cert_digest( ssl );
+    const mbedtls_ssl_peer_id *id = mbedtls_ssl_get_peer_id( ssl );
+    unsigned char *p, *end;
+    char buf[128];
+    size_t i, len;
+
+    if( digest == NULL )
+        return;
+
+    mbedtls_printf( "  . Peer certificate digest: " );
+    for( i = 0; i < MBEDTLS_SSL_PEER_CERT_DIGEST_LEN; i++ )
+        mbedtls_printf( "%02X", digest[i] );
+    mbedtls_printf( "\n" );
+
+    if( id == NULL )
+        return;
+
+    if( ( id->fields & MBEDTLS_SSL_PEER_ID_SERIAL ) != 0 &&
+        mbedtls_x509_serial_gets( buf, sizeof( buf ), &id->serial ) > 0 )
+    {
+        mbedtls_printf( "  . Peer certificate serial: %s\n", buf );
+    }
+
+    if( ( id->fields & MBEDTLS_SSL_PEER_ID_VALIDITY ) != 0 )
+        mbedtls_printf( "  . Peer certificate expires: %04d-%02d-%02d\n",
+                        id->valid_to.year, id->valid_to.mon,
+                        id->valid_to.day );
+
+    p = id->subject_alt_names.p;
+    end = p + id->subject_alt_names.len;
+    while( p < end &&
+           mbedtls_asn1_get_tag( &p, end, &len,
+                                 MBEDTLS_ASN1_CONTEXT_SPECIFIC | 2 ) == 0 )
+    {
+        mbedtls_printf( "  . Peer subject alt name: %.*s\n", (int) len, p );
+        p += len;
+    }
+}
+#endif /* MBEDTLS_SSL_LEAN_CONNECTIONS && MBEDTLS_X509_CRT_PARSE_C */
+
 /*
  * Return authmode from string, or -1 on error
  */
@@ -873,12 +1311,24 @@ int main( int argc, char *argv[] )
     mbedtls_pk_context pkey2;
     int key_cert_init = 0, key_cert_init2 = 0;
 #endif
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    async_key_context async_key_ctx;
+#endif
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    async_verify_context async_verify_ctx;
+#endif
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    mbedtls_x509_verify_cache verify_cache;
+#endif
 #if defined(MBEDTLS_DHM_C) && defined(MBEDTLS_FS_IO)
     mbedtls_dhm_context dhm;
 #endif
 #if defined(MBEDTLS_SSL_CACHE_C)
     mbedtls_ssl_cache_context cache;
 #endif
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+    mbedtls_ssl_buffer_pool buffer_pool;
+#endif
 #if defined(MBEDTLS_SSL_SESSION_TICKETS)
     mbedtls_ssl_ticket_context ticket_ctx;
 #endif
@@ -919,12 +1369,18 @@ int main( int argc, char *argv[] )
     mbedtls_x509_crt_init( &srvcert2 );
     mbedtls_pk_init( &pkey2 );
 #endif
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    mbedtls_x509_verify_cache_init( &verify_cache );
+#endif
 #if defined(MBEDTLS_DHM_C) && defined(MBEDTLS_FS_IO)
     mbedtls_dhm_init( &dhm );
 #endif
 #if defined(MBEDTLS_SSL_CACHE_C)
     mbedtls_ssl_cache_init( &cache );
 #endif
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+    mbedtls_ssl_buffer_pool_init( &buffer_pool );
+#endif
 #if defined(MBEDTLS_SSL_SESSION_TICKETS)
     mbedtls_ssl_ticket_init( &ticket_ctx );
 #endif
@@ -968,6 +1424,17 @@ int main( int argc, char *argv[] )
     opt.debug_level         = DFL_DEBUG_LEVEL;
     opt.nbio                = DFL_NBIO;
     opt.read_timeout        = DFL_READ_TIMEOUT;
+    opt.write_inplace       = DFL_WRITE_INPLACE;
+    opt.write_batch         = DFL_WRITE_BATCH;
+    opt.buffer_pool         = DFL_BUFFER_POOL;
+    opt.lean                = DFL_LEAN;
+    opt.async_operations    = DFL_ASYNC_OPERATIONS;
+    opt.async_private_delay = DFL_ASYNC_PRIVATE_DELAY;
+    opt.async_private_error = DFL_ASYNC_PRIVATE_ERROR;
+    opt.async_verify        = DFL_ASYNC_VERIFY;
+    opt.async_verify_delay  = DFL_ASYNC_VERIFY_DELAY;
+    opt.async_verify_error  = DFL_ASYNC_VERIFY_ERROR;
+    opt.verify_cache        = DFL_VERIFY_CACHE;
     opt.ca_file             = DFL_CA_FILE;
     opt.ca_path             = DFL_CA_PATH;
     opt.crt_file            = DFL_CRT_FILE;
@@ -1046,6 +1513,74 @@ int main( int argc, char *argv[] )
         }
         else if( strcmp( p, "read_timeout" ) == 0 )
             opt.read_timeout = atoi( q );
+        else if( strcmp( p, "write_inplace" ) == 0 )
+        {
+            opt.write_inplace = atoi( q );
+            if( opt.write_inplace < 0 || opt.write_inplace > 1 )
+                goto usage;
+        }
+        else if( strcmp( p, "write_batch" ) == 0 )
+        {
+            opt.write_batch = atoi( q );
+            if( opt.write_batch < 0 )
+                goto usage;
+        }
+        else if( strcmp( p, "buffer_pool" ) == 0 )
+        {
+            opt.buffer_pool = atoi( q );
+            if( opt.buffer_pool < 0 || opt.buffer_pool > 1 )
+                goto usage;
+        }
+        else if( strcmp( p, "lean" ) == 0 )
+        {
+            opt.lean = atoi( q );
+            if( opt.lean < 0 || opt.lean > 1 )
+                goto usage;
+        }
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        else if( strcmp( p, "async_operations" ) == 0 )
+            opt.async_operations = q;
+        else if( strcmp( p, "async_private_delay" ) == 0 )
+        {
+            opt.async_private_delay = atoi( q );
+            if( opt.async_private_delay < -1 )
+                goto usage;
+        }
+        else if( strcmp( p, "async_private_error" ) == 0 )
+        {
+            opt.async_private_error = atoi( q );
+            if( opt.async_private_error < 0 || opt.async_private_error > 3 )
+                goto usage;
+        }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+        else if( strcmp( p, "async_verify" ) == 0 )
+        {
+            opt.async_verify = atoi( q );
+            if( opt.async_verify < 0 || opt.async_verify > 1 )
+                goto usage;
+        }
+        else if( strcmp( p, "async_verify_delay" ) == 0 )
+        {
+            opt.async_verify_delay = atoi( q );
+            if( opt.async_verify_delay < -1 )
+                goto usage;
+        }
+        else if( strcmp( p, "async_verify_error" ) == 0 )
+        {
+            opt.async_verify_error = atoi( q );
+            if( opt.async_verify_error < 0 || opt.async_verify_error > 3 )
+                goto usage;
+        }
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+        else if( strcmp( p, "verify_cache" ) == 0 )
+        {
+            opt.verify_cache = atoi( q );
+            if( opt.verify_cache < 0 || opt.verify_cache > 1 )
+                goto usage;
+        }
+#endif
         else if( strcmp( p, "ca_file" ) == 0 )
             opt.ca_file = q;
         else if( strcmp( p, "ca_path" ) == 0 )
@@ -1930,6 +2465,10 @@ int main( int argc, char *argv[] )
     {
         mbedtls_ssl_conf_ca_chain( &conf, &cacert, NULL );
     }
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    if( opt.verify_cache != 0 )
+        mbedtls_ssl_conf_verify_cache( &conf, &verify_cache );
+#endif
     if( key_cert_init )
         if( ( ret = mbedtls_ssl_conf_own_cert( &conf, &srvcert, &pkey ) ) != 0 )
         {
@@ -1944,6 +2483,47 @@ int main( int argc, char *argv[] )
         }
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    if( strcmp( opt.async_operations, "-" ) != 0 )
+    {
+        memset( &async_key_ctx, 0, sizeof( async_key_ctx ) );
+        if( key_cert_init )
+        {
+            async_key_ctx.cert[0] = &srvcert;
+            async_key_ctx.pk[0] = &pkey;
+        }
+        if( key_cert_init2 )
+        {
+            async_key_ctx.cert[1] = &srvcert2;
+            async_key_ctx.pk[1] = &pkey2;
+        }
+        async_key_ctx.delay = opt.async_private_delay;
+        async_key_ctx.inject_error = opt.async_private_error;
+        async_key_ctx.f_rng = mbedtls_ctr_drbg_random;
+        async_key_ctx.p_rng = &ctr_drbg;
+
+        mbedtls_ssl_conf_async_private_cb( &conf,
+                strchr( opt.async_operations, 's' ) != NULL ?
+                    async_sign_start : NULL,
+                strchr( opt.async_operations, 'd' ) != NULL ?
+                    async_decrypt_start : NULL,
+                async_resume, async_cancel, &async_key_ctx );
+    }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+#if defined(MBEDTLS_SSL_ASYNC_VERIFY)
+    if( opt.async_verify != 0 )
+    {
+        async_verify_ctx.delay = opt.async_verify_delay;
+        async_verify_ctx.inject_error = opt.async_verify_error;
+
+        mbedtls_ssl_conf_async_verify_cb( &conf, async_verify_start,
+                                          async_verify_resume,
+                                          async_verify_cancel,
+                                          &async_verify_ctx );
+    }
+#endif /* MBEDTLS_SSL_ASYNC_VERIFY */
+
 #if defined(SNI_OPTION)
     if( opt.sni != NULL )
         mbedtls_ssl_conf_sni( &conf, sni_callback, sni_info );
@@ -1995,6 +2575,31 @@ int main( int argc, char *argv[] )
     if( opt.max_version != DFL_MIN_VERSION )
         mbedtls_ssl_conf_max_version( &conf, MBEDTLS_SSL_MAJOR_VERSION_3, opt.max_version );
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    if( opt.write_batch != DFL_WRITE_BATCH )
+        mbedtls_ssl_conf_write_batching( &conf, opt.write_batch );
+#endif
+
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+    if( opt.buffer_pool != DFL_BUFFER_POOL )
+        mbedtls_ssl_conf_buffer_pool( &conf, &buffer_pool,
+                                      mbedtls_ssl_buffer_pool_get,
+                                      mbedtls_ssl_buffer_pool_put );
+#endif
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    if( opt.lean != DFL_LEAN )
+    {
+        mbedtls_ssl_conf_lean( &conf, MBEDTLS_SSL_LEAN_ENABLED );
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+        mbedtls_ssl_conf_peer_id_fields( &conf,
+                                         MBEDTLS_SSL_PEER_ID_SERIAL |
+                                         MBEDTLS_SSL_PEER_ID_VALIDITY |
+                                         MBEDTLS_SSL_PEER_ID_SUBJECT_ALT_NAMES );
+#endif
+    }
+#endif
+
     if( ( ret = mbedtls_ssl_setup( &ssl, &conf ) ) != 0 )
     {
         mbedtls_printf( " failed\n  ! mbedtls_ssl_setup returned -0x%x\n\n", -ret );
@@ -2112,9 +2717,22 @@ handshake:
     mbedtls_printf( "  . Performing the SSL/TLS handshake..." );
     fflush( stdout );
 
-    do ret = mbedtls_ssl_handshake( &ssl );
-    while( ret == MBEDTLS_ERR_SSL_WANT_READ ||
-           ret == MBEDTLS_ERR_SSL_WANT_WRITE );
+    while( ( ret = mbedtls_ssl_handshake( &ssl ) ) != 0 )
+    {
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) || defined(MBEDTLS_SSL_ASYNC_VERIFY)
+        if( ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS &&
+            ( opt.async_private_error == ASYNC_INJECT_ERROR_CANCEL ||
+              opt.async_verify_error == ASYNC_INJECT_ERROR_CANCEL ) )
+        {
+            mbedtls_printf( " cancelling on injected error\n" );
+            break;
+        }
+#endif
+        if( ret != MBEDTLS_ERR_SSL_WANT_READ &&
+            ret != MBEDTLS_ERR_SSL_WANT_WRITE &&
+            ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
+            break;
+    }
 
     if( ret == MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED )
     {
@@ -2184,6 +2802,17 @@ handshake:
     else
         mbedtls_printf( " ok\n" );
 
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    if( opt.verify_cache != 0 )
+    {
+        unsigned long hits, misses;
+
+        mbedtls_x509_verify_cache_get_stats( &verify_cache, &hits, &misses );
+        mbedtls_printf( "  . Verify cache: %lu hits, %lu misses\n",
+                        hits, misses );
+    }
+#endif
+
     if( mbedtls_ssl_get_peer_cert( &ssl ) != NULL )
     {
         char crt_buf[512];
@@ -2193,6 +2822,10 @@ handshake:
                        mbedtls_ssl_get_peer_cert( &ssl ) );
         mbedtls_printf( "%s\n", crt_buf );
     }
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    print_peer_id( &ssl );
+#endif
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
     if( opt.exchanges == 0 )
@@ -2219,7 +2852,8 @@ data_exchange:
             ret = mbedtls_ssl_read( &ssl, buf, len );
 
             if( ret == MBEDTLS_ERR_SSL_WANT_READ ||
-                ret == MBEDTLS_ERR_SSL_WANT_WRITE )
+                ret == MBEDTLS_ERR_SSL_WANT_WRITE ||
+                ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
                 continue;
 
             if( ret <= 0 )
@@ -2310,7 +2944,8 @@ data_exchange:
 
         do ret = mbedtls_ssl_read( &ssl, buf, len );
         while( ret == MBEDTLS_ERR_SSL_WANT_READ ||
-               ret == MBEDTLS_ERR_SSL_WANT_WRITE );
+               ret == MBEDTLS_ERR_SSL_WANT_WRITE ||
+               ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS );
 
         if( ret <= 0 )
         {
@@ -2346,7 +2981,8 @@ data_exchange:
         while( ( ret = mbedtls_ssl_renegotiate( &ssl ) ) != 0 )
         {
             if( ret != MBEDTLS_ERR_SSL_WANT_READ &&
-                ret != MBEDTLS_ERR_SSL_WANT_WRITE )
+                ret != MBEDTLS_ERR_SSL_WANT_WRITE &&
+                ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
             {
                 mbedtls_printf( " failed\n  ! mbedtls_ssl_renegotiate returned %d\n\n", ret );
                 goto reset;
@@ -2370,7 +3006,7 @@ data_exchange:
     {
         for( written = 0, frags = 0; written < len; written += ret, frags++ )
         {
-            while( ( ret = mbedtls_ssl_write( &ssl, buf + written, len - written ) )
+            while( ( ret = server_write( &ssl, buf + written, len - written ) )
                            <= 0 )
             {
                 if( ret == MBEDTLS_ERR_NET_CONN_RESET )
@@ -2387,10 +3023,21 @@ data_exchange:
                 }
             }
         }
+
+        /* Records may have been held back by write batching */
+        while( ( ret = mbedtls_ssl_flush( &ssl ) ) != 0 )
+        {
+            if( ret != MBEDTLS_ERR_SSL_WANT_READ &&
+                ret != MBEDTLS_ERR_SSL_WANT_WRITE )
+            {
+                mbedtls_printf( " failed\n  ! mbedtls_ssl_flush returned %d\n\n", ret );
+                goto reset;
+            }
+        }
     }
     else /* Not stream, so datagram */
     {
-        do ret = mbedtls_ssl_write( &ssl, buf, len );
+        do ret = server_write( &ssl, buf, len );
         while( ret == MBEDTLS_ERR_SSL_WANT_READ ||
                ret == MBEDTLS_ERR_SSL_WANT_WRITE );
 
@@ -2458,6 +3105,9 @@ exit:
     mbedtls_x509_crt_free( &srvcert2 );
     mbedtls_pk_free( &pkey2 );
 #endif
+#if defined(MBEDTLS_X509_VERIFY_CACHE)
+    mbedtls_x509_verify_cache_free( &verify_cache );
+#endif
 #if defined(SNI_OPTION)
     sni_free( sni_info );
 #endif
@@ -2476,6 +3126,9 @@ exit:
 #if defined(MBEDTLS_SSL_CACHE_C)
     mbedtls_ssl_cache_free( &cache );
 #endif
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+    mbedtls_ssl_buffer_pool_free( &buffer_pool );
+#endif
 #if defined(MBEDTLS_SSL_SESSION_TICKETS)
     mbedtls_ssl_ticket_free( &ticket_ctx );
 #endif
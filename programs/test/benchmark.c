@@ -54,6 +54,7 @@ int main( void )
 #include "mbedtls/sha1.h"
 #include "mbedtls/sha256.h"
 #include "mbedtls/sha512.h"
+#include "mbedtls/sha_mb.h"
 #include "mbedtls/arc4.h"
 #include "mbedtls/des.h"
 #include "mbedtls/aes.h"
@@ -92,11 +93,11 @@ int main( void )
 #define TITLE_LEN       25
 
 #define OPTIONS                                                         \
-    "md4, md5, ripemd160, sha1, sha256, sha512,\n"                      \
+    "md4, md5, ripemd160, sha1, sha256, sha512, sha_mb,\n"              \
     "arc4, des3, des, camellia, blowfish,\n"                            \
-    "aes_cbc, aes_gcm, aes_ccm, aes_cmac, des3_cmac,\n"                 \
+    "aes_cbc, aes_ctr, aes_gcm, aes_ccm, aes_cmac, des3_cmac,\n"        \
     "havege, ctr_drbg, hmac_drbg\n"                                     \
-    "rsa, dhm, ecdsa, ecdh.\n"
+    "rsa, dhm, ecdsa, ecdsa_batch, ecdh.\n"
 
 #if defined(MBEDTLS_ERROR_C)
 #define PRINT_ERROR                                                     \
@@ -189,6 +190,58 @@ do {                                                                    \
     }                                                                   \
 } while( 0 )
 
+/*
+ * Like TIME_PUBLIC, for CODE handling COUNT operations at once:
+ * reports operations, not batches, per second
+ */
+#define TIME_MULTI( TITLE, BYTES, CODE )                                \
+do {                                                                    \
+    unsigned long ii, ms;                                               \
+    struct mbedtls_timing_hr_time timer;                                \
+                                                                        \
+    mbedtls_printf( HEADER_FORMAT, TITLE );                             \
+    fflush( stdout );                                                   \
+    mbedtls_set_alarm( 1 );                                             \
+    (void) mbedtls_timing_get_timer( &timer, 1 );                       \
+                                                                        \
+    for( ii = 0; ! mbedtls_timing_alarmed; ii++ )                       \
+    {                                                                   \
+        CODE;                                                           \
+    }                                                                   \
+    ms = mbedtls_timing_get_timer( &timer, 0 ) + 1;                     \
+                                                                        \
+    mbedtls_printf( "%9lu Kb/s\n", ii * 1000 / ms * ( BYTES ) / 1024 ); \
+} while( 0 )
+
+#define TIME_PUBLIC_BATCH( TITLE, TYPE, COUNT, CODE )                   \
+do {                                                                    \
+    unsigned long ii, ms;                                               \
+    int ret;                                                            \
+    struct mbedtls_timing_hr_time timer;                                \
+                                                                        \
+    mbedtls_printf( HEADER_FORMAT, TITLE );                             \
+    fflush( stdout );                                                   \
+    mbedtls_set_alarm( 3 );                                             \
+    (void) mbedtls_timing_get_timer( &timer, 1 );                       \
+                                                                        \
+    ret = 0;                                                            \
+    for( ii = 0; ! mbedtls_timing_alarmed && ! ret ; ii++ )             \
+    {                                                                   \
+        CODE;                                                           \
+    }                                                                   \
+    ms = mbedtls_timing_get_timer( &timer, 0 ) + 1;                     \
+                                                                        \
+    if( ret != 0 )                                                      \
+    {                                                                   \
+        PRINT_ERROR;                                                    \
+    }                                                                   \
+    else                                                                \
+    {                                                                   \
+        mbedtls_printf( "%6lu " TYPE "/s in batches of %u\n",          \
+                        ii * ( COUNT ) * 1000 / ms, (unsigned) ( COUNT ) ); \
+    }                                                                   \
+} while( 0 )
+
 static int myrand( void *rng_state, unsigned char *output, size_t len )
 {
     size_t use_len;
@@ -214,10 +267,14 @@ static int myrand( void *rng_state, unsigned char *output, size_t len )
 
 /*
  * Clear some memory that was used to prepare the context
+ * (static groups share a constant table that is not ours to free)
  */
 #if defined(MBEDTLS_ECP_C)
 void ecp_clear_precomputed( mbedtls_ecp_group *grp )
 {
+    if( grp->h == 1 )
+        return;
+
     if( grp->T != NULL )
     {
         size_t i;
@@ -234,13 +291,20 @@ void ecp_clear_precomputed( mbedtls_ecp_group *grp )
 
 unsigned char buf[BUFSIZE];
 
+#if defined(MBEDTLS_SHA_MB_C)
+#define MB_MAX_MSGS     16
+#define MB_MAX_LEN      16384
+unsigned char mb_buf[MB_MAX_MSGS][MB_MAX_LEN];
+unsigned char mb_out[MB_MAX_MSGS][32];
+#endif
+
 typedef struct {
-    char md4, md5, ripemd160, sha1, sha256, sha512,
+    char md4, md5, ripemd160, sha1, sha256, sha512, sha_mb,
          arc4, des3, des,
-         aes_cbc, aes_gcm, aes_ccm, aes_cmac, des3_cmac,
+         aes_cbc, aes_ctr, aes_gcm, aes_ccm, aes_cmac, des3_cmac,
          camellia, blowfish,
          havege, ctr_drbg, hmac_drbg,
-         rsa, dhm, ecdsa, ecdh;
+         rsa, dhm, ecdsa, ecdsa_batch, ecdh;
 } todo_list;
 
 int main( int argc, char *argv[] )
@@ -275,6 +339,8 @@ int main( int argc, char *argv[] )
                 todo.sha256 = 1;
             else if( strcmp( argv[i], "sha512" ) == 0 )
                 todo.sha512 = 1;
+            else if( strcmp( argv[i], "sha_mb" ) == 0 )
+                todo.sha_mb = 1;
             else if( strcmp( argv[i], "arc4" ) == 0 )
                 todo.arc4 = 1;
             else if( strcmp( argv[i], "des3" ) == 0 )
@@ -283,6 +349,8 @@ int main( int argc, char *argv[] )
                 todo.des = 1;
             else if( strcmp( argv[i], "aes_cbc" ) == 0 )
                 todo.aes_cbc = 1;
+            else if( strcmp( argv[i], "aes_ctr" ) == 0 )
+                todo.aes_ctr = 1;
             else if( strcmp( argv[i], "aes_gcm" ) == 0 )
                 todo.aes_gcm = 1;
             else if( strcmp( argv[i], "aes_ccm" ) == 0 )
@@ -307,6 +375,8 @@ int main( int argc, char *argv[] )
                 todo.dhm = 1;
             else if( strcmp( argv[i], "ecdsa" ) == 0 )
                 todo.ecdsa = 1;
+            else if( strcmp( argv[i], "ecdsa_batch" ) == 0 )
+                todo.ecdsa_batch = 1;
             else if( strcmp( argv[i], "ecdh" ) == 0 )
                 todo.ecdh = 1;
             else
@@ -355,6 +425,50 @@ int main( int argc, char *argv[] )
         TIME_AND_TSC( "SHA-512", mbedtls_sha512( buf, BUFSIZE, tmp, 0 ) );
 #endif
 
+#if defined(MBEDTLS_SHA_MB_C)
+    if( todo.sha_mb )
+    {
+        static const unsigned int mb_msgs[] = { 1, 4, 8, 16 };
+        static const unsigned int mb_lens[] = { 64, 256, 1024, 16384 };
+        const unsigned char *mb_input[MB_MAX_MSGS];
+        size_t mb_ilen[MB_MAX_MSGS];
+        unsigned char *mb_output[MB_MAX_MSGS];
+        unsigned int j, k;
+
+        mbedtls_printf( "  Multi-buffer SHA lanes   :  %u\n",
+                        (unsigned) mbedtls_sha_mb_lanes() );
+
+        memset( mb_buf, 0xAA, sizeof( mb_buf ) );
+        for( j = 0; j < MB_MAX_MSGS; j++ )
+        {
+            mb_input[j] = mb_buf[j];
+            mb_output[j] = mb_out[j];
+        }
+
+        for( k = 0; k < sizeof( mb_lens ) / sizeof( mb_lens[0] ); k++ )
+        {
+            for( j = 0; j < MB_MAX_MSGS; j++ )
+                mb_ilen[j] = mb_lens[k];
+
+            for( i = 0; i < (int)( sizeof( mb_msgs ) / sizeof( mb_msgs[0] ) ); i++ )
+            {
+#if defined(MBEDTLS_SHA1_C)
+                mbedtls_snprintf( title, sizeof( title ), "SHA-1 %2u x %5u B",
+                                  mb_msgs[i], mb_lens[k] );
+                TIME_MULTI( title, mb_msgs[i] * mb_lens[k],
+                    mbedtls_sha1_mb( mb_msgs[i], mb_input, mb_ilen, mb_output ) );
+#endif
+#if defined(MBEDTLS_SHA256_C)
+                mbedtls_snprintf( title, sizeof( title ), "SHA-256 %2u x %5u B",
+                                  mb_msgs[i], mb_lens[k] );
+                TIME_MULTI( title, mb_msgs[i] * mb_lens[k],
+                    mbedtls_sha256_mb( mb_msgs[i], mb_input, mb_ilen, mb_output, 0 ) );
+#endif
+            }
+        }
+    }
+#endif
+
 #if defined(MBEDTLS_ARC4_C)
     if( todo.arc4 )
     {
@@ -425,6 +539,41 @@ int main( int argc, char *argv[] )
             TIME_AND_TSC( title,
                 mbedtls_aes_crypt_cbc( &aes, MBEDTLS_AES_ENCRYPT, BUFSIZE, tmp, buf, buf ) );
         }
+        for( keysize = 128; keysize <= 256; keysize += 64 )
+        {
+            mbedtls_snprintf( title, sizeof( title ), "AES-CBC-%d dec", keysize );
+
+            memset( buf, 0, sizeof( buf ) );
+            memset( tmp, 0, sizeof( tmp ) );
+            mbedtls_aes_setkey_dec( &aes, tmp, keysize );
+
+            TIME_AND_TSC( title,
+                mbedtls_aes_crypt_cbc( &aes, MBEDTLS_AES_DECRYPT, BUFSIZE, tmp, buf, buf ) );
+        }
+        mbedtls_aes_free( &aes );
+    }
+#endif
+#if defined(MBEDTLS_CIPHER_MODE_CTR)
+    if( todo.aes_ctr )
+    {
+        int keysize;
+        size_t nc_off;
+        unsigned char stream_block[16];
+        mbedtls_aes_context aes;
+        mbedtls_aes_init( &aes );
+        for( keysize = 128; keysize <= 256; keysize += 64 )
+        {
+            mbedtls_snprintf( title, sizeof( title ), "AES-CTR-%d", keysize );
+
+            memset( buf, 0, sizeof( buf ) );
+            memset( tmp, 0, sizeof( tmp ) );
+            mbedtls_aes_setkey_enc( &aes, tmp, keysize );
+            nc_off = 0;
+
+            TIME_AND_TSC( title,
+                mbedtls_aes_crypt_ctr( &aes, BUFSIZE, &nc_off, tmp, stream_block,
+                                       buf, buf ) );
+        }
         mbedtls_aes_free( &aes );
     }
 #endif
@@ -761,6 +910,69 @@ int main( int argc, char *argv[] )
     }
 #endif
 
+#if defined(MBEDTLS_ECDSA_C) && defined(MBEDTLS_SHA256_C)
+    if( todo.ecdsa_batch )
+    {
+        static const unsigned int batch_sizes[] = { 1, 16, 256 };
+        mbedtls_ecdsa_context ecdsa;
+        const mbedtls_ecp_curve_info *curve_info;
+        unsigned char hashes[256][32];
+        const unsigned char *phash[256];
+        size_t hlen[256];
+        mbedtls_mpi r[256], s[256];
+        const mbedtls_mpi *pr[256], *ps[256];
+        const mbedtls_ecp_point *pQ[256];
+        int results[256];
+        unsigned int j;
+
+        for( j = 0; j < 256; j++ )
+        {
+            memset( hashes[j], 0x2A, sizeof( hashes[j] ) );
+            hashes[j][0] = (unsigned char) j;
+            phash[j] = hashes[j];
+            hlen[j] = sizeof( hashes[j] );
+            mbedtls_mpi_init( &r[j] ); pr[j] = &r[j];
+            mbedtls_mpi_init( &s[j] ); ps[j] = &s[j];
+        }
+
+        for( curve_info = mbedtls_ecp_curve_list();
+             curve_info->grp_id != MBEDTLS_ECP_DP_NONE;
+             curve_info++ )
+        {
+            mbedtls_ecdsa_init( &ecdsa );
+
+            if( mbedtls_ecdsa_genkey( &ecdsa, curve_info->grp_id, myrand, NULL ) != 0 )
+                mbedtls_exit( 1 );
+
+            /* Signatures by a single key, as for signed logs or tokens */
+            for( j = 0; j < 256; j++ )
+            {
+                pQ[j] = &ecdsa.Q;
+                if( mbedtls_ecdsa_sign( &ecdsa.grp, &r[j], &s[j], &ecdsa.d,
+                                        hashes[j], hlen[j], myrand, NULL ) != 0 )
+                    mbedtls_exit( 1 );
+            }
+
+            for( i = 0; i < (int)( sizeof( batch_sizes ) / sizeof( batch_sizes[0] ) ); i++ )
+            {
+                mbedtls_snprintf( title, sizeof( title ), "ECDSA-%s",
+                                                  curve_info->name );
+                TIME_PUBLIC_BATCH( title, "verify", batch_sizes[i],
+                        ret = mbedtls_ecdsa_verify_batch( &ecdsa.grp, batch_sizes[i],
+                                                  phash, hlen, pQ, pr, ps, results ) );
+            }
+
+            mbedtls_ecdsa_free( &ecdsa );
+        }
+
+        for( j = 0; j < 256; j++ )
+        {
+            mbedtls_mpi_free( &r[j] );
+            mbedtls_mpi_free( &s[j] );
+        }
+    }
+#endif
+
 #if defined(MBEDTLS_ECDH_C)
     if( todo.ecdh )
     {
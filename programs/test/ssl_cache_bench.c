@@ -0,0 +1,345 @@
+/*
+ *  Multi-threaded SSL session cache contention benchmark
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#define mbedtls_printf     printf
+#endif
+
+#if !defined(MBEDTLS_SSL_TLS_C) || !defined(MBEDTLS_TIMING_C) ||          \
+    !defined(MBEDTLS_SSL_CACHE_C) || !defined(MBEDTLS_SSL_CACHE_SHARDED_C) || \
+    !defined(MBEDTLS_THREADING_C) || !defined(MBEDTLS_THREADING_PTHREAD)
+int main( void )
+{
+    mbedtls_printf("MBEDTLS_SSL_TLS_C and/or MBEDTLS_TIMING_C and/or "
+           "MBEDTLS_SSL_CACHE_C and/or MBEDTLS_SSL_CACHE_SHARDED_C and/or "
+           "MBEDTLS_THREADING_C and/or MBEDTLS_THREADING_PTHREAD "
+           "not defined.\n");
+    return( 0 );
+}
+#else
+
+#include <string.h>
+#include <pthread.h>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_cache_sharded.h"
+#include "mbedtls/timing.h"
+
+#define DFL_THREADS             4
+#define DFL_ENTRIES             1000
+#define DFL_OPS                 100000
+#define DFL_SET_RATIO           10
+#define DFL_SHARDS              0
+
+#define USAGE                                                               \
+    "\n usage: ssl_cache_bench param=<>...\n"                               \
+    "\n acceptable parameters:\n"                                           \
+    "    threads=%%d          default: 4\n"                                 \
+    "    entries=%%d          default: 1000 (sessions held in the cache)\n" \
+    "    ops=%%d              default: 100000 (operations per thread)\n"    \
+    "    set_ratio=%%d        default: 10\n"                                \
+    "                        1 in N operations stores a new session\n"      \
+    "    shards=%%d           default: 0 (MBEDTLS_SSL_CACHE_SHARDED_DEFAULT_SHARDS)\n" \
+    "    cache=%%s            default: all\n"                               \
+    "                        options: classic, sharded, all\n"              \
+    "\n"
+
+#define MAX_THREADS             256
+
+/*
+ * global options
+ */
+static struct options
+{
+    int threads;                /* number of worker threads                 */
+    int entries;                /* number of sessions held in the cache     */
+    int ops;                    /* number of operations per thread          */
+    int set_ratio;              /* store a new session every N operations   */
+    int shards;                 /* number of shards for the sharded cache   */
+    const char *cache;          /* which cache(s) to benchmark              */
+} opt;
+
+typedef struct
+{
+    int (*f_get)( void *, mbedtls_ssl_session * );
+    int (*f_set)( void *, const mbedtls_ssl_session * );
+    void *p_cache;
+    unsigned int seed;
+    unsigned long gets;
+    unsigned long hits;
+} thread_info_t;
+
+static void exit_usage( const char *name, const char *value )
+{
+    if( value == NULL )
+        mbedtls_printf( " unknown option or missing value: %s\n", name );
+    else
+        mbedtls_printf( " option %s: illegal value: %s\n", name, value );
+
+    mbedtls_printf( USAGE );
+    exit( 1 );
+}
+
+static void get_options( int argc, char *argv[] )
+{
+    int i;
+    char *p, *q;
+
+    opt.threads     = DFL_THREADS;
+    opt.entries     = DFL_ENTRIES;
+    opt.ops         = DFL_OPS;
+    opt.set_ratio   = DFL_SET_RATIO;
+    opt.shards      = DFL_SHARDS;
+    opt.cache       = "all";
+
+    for( i = 1; i < argc; i++ )
+    {
+        p = argv[i];
+        if( ( q = strchr( p, '=' ) ) == NULL )
+            exit_usage( p, NULL );
+        *q++ = '\0';
+
+        if( strcmp( p, "threads" ) == 0 )
+        {
+            opt.threads = atoi( q );
+            if( opt.threads < 1 || opt.threads > MAX_THREADS )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "entries" ) == 0 )
+        {
+            opt.entries = atoi( q );
+            if( opt.entries < 1 )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "ops" ) == 0 )
+        {
+            opt.ops = atoi( q );
+            if( opt.ops < 1 )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "set_ratio" ) == 0 )
+        {
+            opt.set_ratio = atoi( q );
+            if( opt.set_ratio < 1 )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "shards" ) == 0 )
+        {
+            opt.shards = atoi( q );
+            if( opt.shards < 0 ||
+                opt.shards > MBEDTLS_SSL_CACHE_SHARDED_MAX_SHARDS )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "cache" ) == 0 )
+        {
+            if( strcmp( q, "classic" ) != 0 && strcmp( q, "sharded" ) != 0 &&
+                strcmp( q, "all" ) != 0 )
+                exit_usage( p, q );
+            opt.cache = q;
+        }
+        else
+            exit_usage( p, NULL );
+    }
+}
+
+/*
+ * Small non-cryptographic PRNG, so that session id generation doesn't
+ * weigh on the measurement
+ */
+static unsigned int bench_rand( unsigned int *state )
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return( *state );
+}
+
+/*
+ * Session ids are derived from an index, so that threads can pick sessions
+ * that are known to be in the cache
+ */
+static void bench_session( mbedtls_ssl_session *session, unsigned int index )
+{
+    memset( session, 0, sizeof( mbedtls_ssl_session ) );
+
+    session->ciphersuite = MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256;
+    session->id_len = sizeof( session->id );
+    memset( session->id, 0x5A, sizeof( session->id ) );
+    session->id[0] = (unsigned char)( index >> 24 );
+    session->id[1] = (unsigned char)( index >> 16 );
+    session->id[2] = (unsigned char)( index >>  8 );
+    session->id[3] = (unsigned char)( index       );
+    memset( session->master, (unsigned char) index, sizeof( session->master ) );
+}
+
+static void *bench_thread( void *data )
+{
+    thread_info_t *info = (thread_info_t *) data;
+    mbedtls_ssl_session session;
+    unsigned int next = (unsigned int) opt.entries + info->seed * opt.ops;
+    int i;
+
+    for( i = 0; i < opt.ops; i++ )
+    {
+        if( i % opt.set_ratio == 0 )
+        {
+            /* New full handshake: store a fresh session */
+            bench_session( &session, next++ );
+            info->f_set( info->p_cache, &session );
+        }
+        else
+        {
+            /* Resumption attempt on one of the initially cached sessions */
+            bench_session( &session,
+                           bench_rand( &info->seed ) % opt.entries );
+            info->gets++;
+            if( info->f_get( info->p_cache, &session ) == 0 )
+                info->hits++;
+        }
+
+        mbedtls_ssl_session_free( &session );
+    }
+
+    return( NULL );
+}
+
+static int run_bench( const char *title,
+                      int (*f_get)( void *, mbedtls_ssl_session * ),
+                      int (*f_set)( void *, const mbedtls_ssl_session * ),
+                      void *p_cache )
+{
+    pthread_t tid[MAX_THREADS];
+    thread_info_t info[MAX_THREADS];
+    struct mbedtls_timing_hr_time timer;
+    mbedtls_ssl_session session;
+    unsigned long ms, gets = 0, hits = 0;
+    int i;
+
+    /* Warm up: fill the cache */
+    for( i = 0; i < opt.entries; i++ )
+    {
+        bench_session( &session, i );
+        f_set( p_cache, &session );
+    }
+
+    (void) mbedtls_timing_get_timer( &timer, 1 );
+
+    for( i = 0; i < opt.threads; i++ )
+    {
+        info[i].f_get = f_get;
+        info[i].f_set = f_set;
+        info[i].p_cache = p_cache;
+        info[i].seed = i + 1;
+        info[i].gets = 0;
+        info[i].hits = 0;
+
+        if( pthread_create( &tid[i], NULL, bench_thread, &info[i] ) != 0 )
+        {
+            mbedtls_printf( "  ! pthread_create failed\n" );
+            return( 1 );
+        }
+    }
+
+    for( i = 0; i < opt.threads; i++ )
+    {
+        pthread_join( tid[i], NULL );
+        gets += info[i].gets;
+        hits += info[i].hits;
+    }
+
+    ms = mbedtls_timing_get_timer( &timer, 0 );
+    if( ms == 0 )
+        ms = 1;
+
+    mbedtls_printf( "  %-8s: %9lu ops/s, %3lu%% hits (%d threads, %d entries)\n",
+                    title,
+                    (unsigned long) opt.threads * opt.ops * 1000 / ms,
+                    gets == 0 ? 0 : hits * 100 / gets,
+                    opt.threads, opt.entries );
+
+    return( 0 );
+}
+
+int main( int argc, char *argv[] )
+{
+    int ret = 0;
+
+    get_options( argc, argv );
+
+    mbedtls_printf( "\n" );
+
+    if( strcmp( opt.cache, "sharded" ) != 0 )
+    {
+        mbedtls_ssl_cache_context cache;
+
+        mbedtls_ssl_cache_init( &cache );
+        mbedtls_ssl_cache_set_max_entries( &cache, opt.entries );
+
+        ret = run_bench( "classic", mbedtls_ssl_cache_get,
+                         mbedtls_ssl_cache_set, &cache );
+
+        mbedtls_ssl_cache_free( &cache );
+    }
+
+    if( ret == 0 && strcmp( opt.cache, "classic" ) != 0 )
+    {
+        mbedtls_ssl_cache_sharded_context cache;
+
+        mbedtls_ssl_cache_sharded_init( &cache );
+
+        if( ( ret = mbedtls_ssl_cache_sharded_setup( &cache, opt.shards,
+                                                     opt.entries ) ) != 0 )
+        {
+            mbedtls_printf( "  ! mbedtls_ssl_cache_sharded_setup returned -0x%04x\n",
+                            -ret );
+        }
+        else
+        {
+            ret = run_bench( "sharded", mbedtls_ssl_cache_sharded_get,
+                             mbedtls_ssl_cache_sharded_set, &cache );
+        }
+
+        mbedtls_ssl_cache_sharded_free( &cache );
+    }
+
+    mbedtls_printf( "\n" );
+
+#if defined(_WIN32)
+    mbedtls_printf( "  + Press Enter to exit this program.\n" );
+    fflush( stdout ); getchar();
+#endif
+
+    return( ret != 0 );
+}
+#endif /* MBEDTLS_SSL_TLS_C && MBEDTLS_TIMING_C && MBEDTLS_SSL_CACHE_C &&
+          MBEDTLS_SSL_CACHE_SHARDED_C && MBEDTLS_THREADING_C &&
+          MBEDTLS_THREADING_PTHREAD */
@@ -0,0 +1,602 @@
+/*
+ *  Heap usage of many idle TLS connections, with and without a buffer pool
+ *  and lean connections
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdio.h>
+#define mbedtls_printf     printf
+#endif
+
+#if !defined(MBEDTLS_SSL_CLI_C) || !defined(MBEDTLS_SSL_SRV_C) ||         \
+    !defined(MBEDTLS_SSL_BUFFER_POOL_C) ||                                \
+    !defined(MBEDTLS_KEY_EXCHANGE_PSK_ENABLED) ||                         \
+    !defined(MBEDTLS_AES_C) || !defined(MBEDTLS_GCM_C) ||                 \
+    !defined(MBEDTLS_ENTROPY_C) || !defined(MBEDTLS_CTR_DRBG_C) ||        \
+    !defined(MBEDTLS_PLATFORM_C) || !defined(MBEDTLS_PLATFORM_MEMORY)
+int main( void )
+{
+    mbedtls_printf("MBEDTLS_SSL_CLI_C and/or MBEDTLS_SSL_SRV_C and/or "
+           "MBEDTLS_SSL_BUFFER_POOL_C and/or "
+           "MBEDTLS_KEY_EXCHANGE_PSK_ENABLED and/or "
+           "MBEDTLS_AES_C and/or MBEDTLS_GCM_C and/or "
+           "MBEDTLS_ENTROPY_C and/or MBEDTLS_CTR_DRBG_C and/or "
+           "MBEDTLS_PLATFORM_C and/or MBEDTLS_PLATFORM_MEMORY "
+           "not defined.\n");
+    return( 0 );
+}
+#else
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_buffer_pool.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_CERTS_C) &&      \
+    defined(MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED)
+#include "mbedtls/certs.h"
+#define BENCH_AUTH
+#endif
+
+#define DFL_CONNECTIONS         100
+#define DFL_MAX_FRAG_LEN        0
+#define DFL_MAX_IDLE            MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_IDLE
+#define DFL_AUTH                0
+#define DFL_LEAN                0
+
+#if defined(BENCH_AUTH)
+#define USAGE_AUTH                                                          \
+    "    auth=%%d             default: 0 (PSK)\n"                           \
+    "                        options: 1 (ECDHE-ECDSA with client auth)\n"
+#else
+#define USAGE_AUTH ""
+#endif
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+#define USAGE_LEAN                                                          \
+    "    lean=%%d             default: 0\n"                                 \
+    "                        options: 1 (also measure lean connections)\n"
+#else
+#define USAGE_LEAN ""
+#endif
+
+#define USAGE                                                               \
+    "\n usage: ssl_mem_bench param=<>...\n"                                 \
+    "\n acceptable parameters:\n"                                           \
+    "    connections=%%d      default: 100 (client/server pairs kept open)\n" \
+    "    max_frag_len=%%d     default: 0 (none)\n"                          \
+    "                        options: 512, 1024, 2048, 4096\n"              \
+    "    max_idle=%%d         default: 64 (idle buffers kept by the pool)\n" \
+    USAGE_AUTH                                                              \
+    USAGE_LEAN                                                              \
+    "\n"
+
+/*
+ * global options
+ */
+static struct options
+{
+    int connections;            /* number of connections kept open          */
+    int max_frag_len;           /* maximum fragment length requested        */
+    int max_idle;               /* idle buffers kept by the pool per size   */
+    int auth;                   /* authenticate with certificates?          */
+    int lean;                   /* measure lean connections as well?        */
+} opt;
+
+/*
+ * Heap accounting: each block is prefixed with its size
+ */
+#define HDR_LEN     16
+
+static size_t heap_cur, heap_peak;
+
+static void *bench_calloc( size_t n, size_t size )
+{
+    unsigned char *p;
+    size_t len = n * size;
+
+    if( size != 0 && len / size != n )
+        return( NULL );
+
+    if( ( p = calloc( 1, len + HDR_LEN ) ) == NULL )
+        return( NULL );
+
+    memcpy( p, &len, sizeof( size_t ) );
+
+    heap_cur += len;
+    if( heap_cur > heap_peak )
+        heap_peak = heap_cur;
+
+    return( p + HDR_LEN );
+}
+
+static void bench_free( void *ptr )
+{
+    unsigned char *p = (unsigned char *) ptr;
+    size_t len;
+
+    if( p == NULL )
+        return;
+
+    p -= HDR_LEN;
+    memcpy( &len, p, sizeof( size_t ) );
+    heap_cur -= len;
+
+    free( p );
+}
+
+/*
+ * In-memory transport: one pipe per direction, shared by all connections
+ * since handshakes are run one at a time and pipes are drained after each
+ */
+typedef struct
+{
+    unsigned char buf[2 * MBEDTLS_SSL_MAX_CONTENT_LEN];
+    size_t start;
+    size_t len;
+} pipe_t;
+
+typedef struct
+{
+    pipe_t *out;
+    pipe_t *in;
+} endpoint_t;
+
+static pipe_t to_server, to_client;
+static endpoint_t cli_end = { &to_server, &to_client };
+static endpoint_t srv_end = { &to_client, &to_server };
+
+static int pipe_send( void *ctx, const unsigned char *buf, size_t len )
+{
+    pipe_t *pipe = ( (endpoint_t *) ctx )->out;
+
+    if( pipe->len == 0 )
+        pipe->start = 0;
+
+    if( len > sizeof( pipe->buf ) - pipe->start - pipe->len )
+        len = sizeof( pipe->buf ) - pipe->start - pipe->len;
+
+    if( len == 0 )
+        return( MBEDTLS_ERR_SSL_WANT_WRITE );
+
+    memcpy( pipe->buf + pipe->start + pipe->len, buf, len );
+    pipe->len += len;
+
+    return( (int) len );
+}
+
+static int pipe_recv( void *ctx, unsigned char *buf, size_t len )
+{
+    pipe_t *pipe = ( (endpoint_t *) ctx )->in;
+
+    if( pipe->len == 0 )
+        return( MBEDTLS_ERR_SSL_WANT_READ );
+
+    if( len > pipe->len )
+        len = pipe->len;
+
+    memcpy( buf, pipe->buf + pipe->start, len );
+    pipe->start += len;
+    pipe->len -= len;
+
+    return( (int) len );
+}
+
+static const int ciphersuites[] =
+{
+    MBEDTLS_TLS_PSK_WITH_AES_128_GCM_SHA256,
+    0
+};
+
+static const unsigned char psk[16] = "ssl_mem_bench..";
+static const char psk_identity[] = "ssl_mem_bench";
+
+#if defined(BENCH_AUTH)
+static const int ciphersuites_auth[] =
+{
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    0
+};
+
+static mbedtls_x509_crt cacert, srvcert, clicert;
+static mbedtls_pk_context srvkey, clikey;
+
+static int load_certs( void )
+{
+    int ret;
+
+    if( ( ret = mbedtls_x509_crt_parse( &cacert,
+                        (const unsigned char *) mbedtls_test_cas_pem,
+                        mbedtls_test_cas_pem_len ) ) != 0 ||
+        ( ret = mbedtls_x509_crt_parse( &srvcert,
+                        (const unsigned char *) mbedtls_test_srv_crt_ec,
+                        strlen( mbedtls_test_srv_crt_ec ) + 1 ) ) != 0 ||
+        ( ret = mbedtls_pk_parse_key( &srvkey,
+                        (const unsigned char *) mbedtls_test_srv_key_ec,
+                        strlen( mbedtls_test_srv_key_ec ) + 1, NULL, 0 ) ) != 0 ||
+        ( ret = mbedtls_x509_crt_parse( &clicert,
+                        (const unsigned char *) mbedtls_test_cli_crt_ec,
+                        mbedtls_test_cli_crt_ec_len ) ) != 0 ||
+        ( ret = mbedtls_pk_parse_key( &clikey,
+                        (const unsigned char *) mbedtls_test_cli_key_ec,
+                        mbedtls_test_cli_key_ec_len, NULL, 0 ) ) != 0 )
+    {
+        return( ret );
+    }
+
+    return( 0 );
+}
+#endif /* BENCH_AUTH */
+
+static void exit_usage( const char *name, const char *value )
+{
+    if( value == NULL )
+        mbedtls_printf( " unknown option or missing value: %s\n", name );
+    else
+        mbedtls_printf( " option %s: illegal value: %s\n", name, value );
+
+    mbedtls_printf( USAGE );
+    exit( 1 );
+}
+
+static void get_options( int argc, char *argv[] )
+{
+    int i;
+    char *p, *q;
+
+    opt.connections     = DFL_CONNECTIONS;
+    opt.max_frag_len    = DFL_MAX_FRAG_LEN;
+    opt.max_idle        = DFL_MAX_IDLE;
+    opt.auth            = DFL_AUTH;
+    opt.lean            = DFL_LEAN;
+
+    for( i = 1; i < argc; i++ )
+    {
+        p = argv[i];
+        if( ( q = strchr( p, '=' ) ) == NULL )
+            exit_usage( p, NULL );
+        *q++ = '\0';
+
+        if( strcmp( p, "connections" ) == 0 )
+        {
+            opt.connections = atoi( q );
+            if( opt.connections < 1 )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "max_frag_len" ) == 0 )
+        {
+            opt.max_frag_len = atoi( q );
+            if( opt.max_frag_len != 0 && opt.max_frag_len != 512 &&
+                opt.max_frag_len != 1024 && opt.max_frag_len != 2048 &&
+                opt.max_frag_len != 4096 )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "max_idle" ) == 0 )
+        {
+            opt.max_idle = atoi( q );
+            if( opt.max_idle < 0 )
+                exit_usage( p, q );
+        }
+#if defined(BENCH_AUTH)
+        else if( strcmp( p, "auth" ) == 0 )
+        {
+            opt.auth = atoi( q );
+            if( opt.auth < 0 || opt.auth > 1 )
+                exit_usage( p, q );
+        }
+#endif
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+        else if( strcmp( p, "lean" ) == 0 )
+        {
+            opt.lean = atoi( q );
+            if( opt.lean < 0 || opt.lean > 1 )
+                exit_usage( p, q );
+        }
+#endif
+        else
+            exit_usage( p, NULL );
+    }
+}
+
+static int conf_setup( mbedtls_ssl_config *conf, int endpoint,
+                       mbedtls_ctr_drbg_context *ctr_drbg,
+                       mbedtls_ssl_buffer_pool *pool, int lean )
+{
+    int ret;
+
+    if( ( ret = mbedtls_ssl_config_defaults( conf, endpoint,
+                                    MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT ) ) != 0 )
+        return( ret );
+
+    mbedtls_ssl_conf_rng( conf, mbedtls_ctr_drbg_random, ctr_drbg );
+    mbedtls_ssl_conf_authmode( conf, MBEDTLS_SSL_VERIFY_NONE );
+    mbedtls_ssl_conf_ciphersuites( conf, ciphersuites );
+
+    if( ( ret = mbedtls_ssl_conf_psk( conf, psk, sizeof( psk ),
+                                      (const unsigned char *) psk_identity,
+                                      strlen( psk_identity ) ) ) != 0 )
+        return( ret );
+
+#if defined(BENCH_AUTH)
+    if( opt.auth )
+    {
+        /* The test certificates may have expired: verify, but don't fail */
+        mbedtls_ssl_conf_authmode( conf, MBEDTLS_SSL_VERIFY_OPTIONAL );
+        mbedtls_ssl_conf_ciphersuites( conf, ciphersuites_auth );
+        mbedtls_ssl_conf_ca_chain( conf, &cacert, NULL );
+
+        if( ( ret = mbedtls_ssl_conf_own_cert( conf,
+                        endpoint == MBEDTLS_SSL_IS_CLIENT ? &clicert : &srvcert,
+                        endpoint == MBEDTLS_SSL_IS_CLIENT ? &clikey : &srvkey ) ) != 0 )
+            return( ret );
+    }
+#endif
+
+#if defined(MBEDTLS_SSL_LEAN_CONNECTIONS)
+    if( lean )
+        mbedtls_ssl_conf_lean( conf, MBEDTLS_SSL_LEAN_ENABLED );
+#else
+    ((void) lean);
+#endif
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    if( endpoint == MBEDTLS_SSL_IS_CLIENT )
+    {
+        unsigned char mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+
+        switch( opt.max_frag_len )
+        {
+            case 512:  mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_512;  break;
+            case 1024: mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_1024; break;
+            case 2048: mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_2048; break;
+            case 4096: mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_4096; break;
+        }
+
+        if( ( ret = mbedtls_ssl_conf_max_frag_len( conf, mfl_code ) ) != 0 )
+            return( ret );
+    }
+#endif
+
+    if( pool != NULL )
+        mbedtls_ssl_conf_buffer_pool( conf, pool, mbedtls_ssl_buffer_pool_get,
+                                      mbedtls_ssl_buffer_pool_put );
+
+    return( 0 );
+}
+
+/*
+ * Complete the handshake of a client/server pair and exchange a short
+ * message in each direction, as a client sending a request would
+ */
+static int connect_pair( mbedtls_ssl_context *cli, mbedtls_ssl_context *srv )
+{
+    int ret_cli = 1, ret_srv = 1;
+    unsigned char buf[16];
+
+    mbedtls_ssl_set_bio( cli, &cli_end, pipe_send, pipe_recv, NULL );
+    mbedtls_ssl_set_bio( srv, &srv_end, pipe_send, pipe_recv, NULL );
+
+    while( ret_cli != 0 || ret_srv != 0 )
+    {
+        if( ret_cli != 0 )
+        {
+            ret_cli = mbedtls_ssl_handshake( cli );
+            if( ret_cli != 0 && ret_cli != MBEDTLS_ERR_SSL_WANT_READ &&
+                ret_cli != MBEDTLS_ERR_SSL_WANT_WRITE )
+                return( ret_cli );
+        }
+
+        if( ret_srv != 0 )
+        {
+            ret_srv = mbedtls_ssl_handshake( srv );
+            if( ret_srv != 0 && ret_srv != MBEDTLS_ERR_SSL_WANT_READ &&
+                ret_srv != MBEDTLS_ERR_SSL_WANT_WRITE )
+                return( ret_srv );
+        }
+    }
+
+    if( ( ret_cli = mbedtls_ssl_write( cli, (const unsigned char *) "ping", 4 ) ) < 0 )
+        return( ret_cli );
+    if( ( ret_srv = mbedtls_ssl_read( srv, buf, sizeof( buf ) ) ) < 0 )
+        return( ret_srv );
+    if( ( ret_srv = mbedtls_ssl_write( srv, (const unsigned char *) "pong", 4 ) ) < 0 )
+        return( ret_srv );
+    if( ( ret_cli = mbedtls_ssl_read( cli, buf, sizeof( buf ) ) ) < 0 )
+        return( ret_cli );
+
+    return( 0 );
+}
+
+static int run_bench( const char *title, mbedtls_ctr_drbg_context *ctr_drbg,
+                      int use_pool, int lean )
+{
+    int ret, i;
+    mbedtls_ssl_config conf_cli, conf_srv;
+    mbedtls_ssl_buffer_pool pool;
+    mbedtls_ssl_context *cli = NULL, *srv = NULL;
+    size_t base, idle, peak, pool_idle = 0;
+
+    mbedtls_ssl_config_init( &conf_cli );
+    mbedtls_ssl_config_init( &conf_srv );
+    mbedtls_ssl_buffer_pool_init( &pool );
+    mbedtls_ssl_buffer_pool_set_max_idle( &pool, opt.max_idle );
+
+    if( ( ret = conf_setup( &conf_cli, MBEDTLS_SSL_IS_CLIENT, ctr_drbg,
+                            use_pool ? &pool : NULL, lean ) ) != 0 ||
+        ( ret = conf_setup( &conf_srv, MBEDTLS_SSL_IS_SERVER, ctr_drbg,
+                            use_pool ? &pool : NULL, lean ) ) != 0 )
+    {
+        mbedtls_printf( "  ! config setup returned -0x%04x\n", -ret );
+        goto exit;
+    }
+
+    base = heap_cur;
+    heap_peak = heap_cur;
+
+    cli = mbedtls_calloc( opt.connections, sizeof( mbedtls_ssl_context ) );
+    srv = mbedtls_calloc( opt.connections, sizeof( mbedtls_ssl_context ) );
+    if( cli == NULL || srv == NULL )
+    {
+        mbedtls_printf( "  ! allocation of %d contexts failed\n",
+                        opt.connections );
+        ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        goto exit;
+    }
+
+    for( i = 0; i < opt.connections; i++ )
+    {
+        mbedtls_ssl_init( &cli[i] );
+        mbedtls_ssl_init( &srv[i] );
+    }
+
+    for( i = 0; i < opt.connections; i++ )
+    {
+        if( ( ret = mbedtls_ssl_setup( &cli[i], &conf_cli ) ) != 0 ||
+            ( ret = mbedtls_ssl_setup( &srv[i], &conf_srv ) ) != 0 )
+        {
+            mbedtls_printf( "  ! mbedtls_ssl_setup returned -0x%04x\n", -ret );
+            goto exit;
+        }
+
+        if( ( ret = connect_pair( &cli[i], &srv[i] ) ) != 0 )
+        {
+            mbedtls_printf( "  ! connection %d failed: -0x%04x\n", i, -ret );
+            goto exit;
+        }
+    }
+
+    idle = heap_cur - base;
+    peak = heap_peak - base;
+
+    for( i = 0; i < MBEDTLS_SSL_BUFFER_POOL_SIZES; i++ )
+        pool_idle += pool.lists[i].len * pool.lists[i].count;
+
+    mbedtls_printf( "  %-9s: %6d connections, idle %9lu bytes "
+                    "(%6lu per pair), peak %9lu bytes",
+                    title, opt.connections, (unsigned long) idle,
+                    (unsigned long) idle / opt.connections,
+                    (unsigned long) peak );
+    if( use_pool )
+        mbedtls_printf( ", %lu held by pool", (unsigned long) pool_idle );
+    mbedtls_printf( "\n" );
+
+    ret = 0;
+
+exit:
+    if( cli != NULL && srv != NULL )
+    {
+        for( i = 0; i < opt.connections; i++ )
+        {
+            mbedtls_ssl_free( &cli[i] );
+            mbedtls_ssl_free( &srv[i] );
+        }
+    }
+    mbedtls_free( cli );
+    mbedtls_free( srv );
+    mbedtls_ssl_config_free( &conf_cli );
+    mbedtls_ssl_config_free( &conf_srv );
+    mbedtls_ssl_buffer_pool_free( &pool );
+
+    return( ret );
+}
+
+int main( int argc, char *argv[] )
+{
+    int ret;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    const char *pers = "ssl_mem_bench";
+
+    get_options( argc, argv );
+
+    mbedtls_platform_set_calloc_free( bench_calloc, bench_free );
+
+    mbedtls_entropy_init( &entropy );
+    mbedtls_ctr_drbg_init( &ctr_drbg );
+#if defined(BENCH_AUTH)
+    mbedtls_x509_crt_init( &cacert );
+    mbedtls_x509_crt_init( &srvcert );
+    mbedtls_x509_crt_init( &clicert );
+    mbedtls_pk_init( &srvkey );
+    mbedtls_pk_init( &clikey );
+
+    if( opt.auth && ( ret = load_certs() ) != 0 )
+    {
+        mbedtls_printf( "  ! loading test certificates returned -0x%04x\n",
+                        -ret );
+        goto exit;
+    }
+#endif
+
+    if( ( ret = mbedtls_ctr_drbg_seed( &ctr_drbg, mbedtls_entropy_func,
+                                       &entropy, (const unsigned char *) pers,
+                                       strlen( pers ) ) ) != 0 )
+    {
+        mbedtls_printf( "  ! mbedtls_ctr_drbg_seed returned -0x%04x\n", -ret );
+        goto exit;
+    }
+
+    mbedtls_printf( "\n" );
+
+    if( ( ret = run_bench( "classic", &ctr_drbg, 0, 0 ) ) == 0 )
+        ret = run_bench( "pool", &ctr_drbg, 1, 0 );
+
+    if( ret == 0 && opt.lean )
+    {
+        if( ( ret = run_bench( "lean", &ctr_drbg, 0, 1 ) ) == 0 )
+            ret = run_bench( "pool+lean", &ctr_drbg, 1, 1 );
+    }
+
+    mbedtls_printf( "\n" );
+
+exit:
+#if defined(BENCH_AUTH)
+    mbedtls_x509_crt_free( &cacert );
+    mbedtls_x509_crt_free( &srvcert );
+    mbedtls_x509_crt_free( &clicert );
+    mbedtls_pk_free( &srvkey );
+    mbedtls_pk_free( &clikey );
+#endif
+    mbedtls_ctr_drbg_free( &ctr_drbg );
+    mbedtls_entropy_free( &entropy );
+
+#if defined(_WIN32)
+    mbedtls_printf( "  + Press Enter to exit this program.\n" );
+    fflush( stdout ); getchar();
+#endif
+
+    return( ret != 0 );
+}
+#endif /* MBEDTLS_SSL_CLI_C && MBEDTLS_SSL_SRV_C && MBEDTLS_SSL_BUFFER_POOL_C &&
+          MBEDTLS_KEY_EXCHANGE_PSK_ENABLED && MBEDTLS_AES_C && MBEDTLS_GCM_C &&
+          MBEDTLS_ENTROPY_C && MBEDTLS_CTR_DRBG_C && MBEDTLS_PLATFORM_C &&
+          MBEDTLS_PLATFORM_MEMORY */
@@ -0,0 +1,281 @@
+/*
+ *  Multi-threaded TLS session ticket throughput benchmark
+ *
+ *  Copyright (C) 2006-2017, ARM Limited, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#define mbedtls_time       time
+#define mbedtls_printf     printf
+#endif
+
+#if !defined(MBEDTLS_SSL_TICKET_C) || !defined(MBEDTLS_TIMING_C) ||       \
+    !defined(MBEDTLS_ENTROPY_C) || !defined(MBEDTLS_CTR_DRBG_C) ||        \
+    !defined(MBEDTLS_THREADING_C) || !defined(MBEDTLS_THREADING_PTHREAD)
+int main( void )
+{
+    mbedtls_printf("MBEDTLS_SSL_TICKET_C and/or MBEDTLS_TIMING_C and/or "
+           "MBEDTLS_ENTROPY_C and/or MBEDTLS_CTR_DRBG_C and/or "
+           "MBEDTLS_THREADING_C and/or MBEDTLS_THREADING_PTHREAD "
+           "not defined.\n");
+    return( 0 );
+}
+#else
+
+#include <string.h>
+#include <pthread.h>
+
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/timing.h"
+
+#define DFL_THREADS             4
+#define DFL_OPS                 100000
+#define DFL_LIFETIME            86400
+#define DFL_CIPHER              MBEDTLS_CIPHER_AES_256_GCM
+
+#define USAGE                                                               \
+    "\n usage: ssl_ticket_bench param=<>...\n"                              \
+    "\n acceptable parameters:\n"                                           \
+    "    threads=%%d          default: 4\n"                                 \
+    "    ops=%%d              default: 100000 (tickets per thread)\n"       \
+    "    lifetime=%%d         default: 86400 (ticket lifetime in seconds)\n" \
+    "                        small values exercise key rotation\n"          \
+    "    cipher=%%s           default: AES-256-GCM\n"                       \
+    "\n"
+
+#define MAX_THREADS             256
+
+/*
+ * global options
+ */
+static struct options
+{
+    int threads;                /* number of worker threads                 */
+    int ops;                    /* number of tickets per thread             */
+    int lifetime;               /* ticket lifetime, drives key rotation     */
+    mbedtls_cipher_type_t cipher; /* ticket protection cipher               */
+} opt;
+
+typedef struct
+{
+    mbedtls_ssl_ticket_context *ticket;
+    int ret;
+} thread_info_t;
+
+static void exit_usage( const char *name, const char *value )
+{
+    if( value == NULL )
+        mbedtls_printf( " unknown option or missing value: %s\n", name );
+    else
+        mbedtls_printf( " option %s: illegal value: %s\n", name, value );
+
+    mbedtls_printf( USAGE );
+    exit( 1 );
+}
+
+static void get_options( int argc, char *argv[] )
+{
+    int i;
+    char *p, *q;
+    const mbedtls_cipher_info_t *cipher_info;
+
+    opt.threads     = DFL_THREADS;
+    opt.ops         = DFL_OPS;
+    opt.lifetime    = DFL_LIFETIME;
+    opt.cipher      = DFL_CIPHER;
+
+    for( i = 1; i < argc; i++ )
+    {
+        p = argv[i];
+        if( ( q = strchr( p, '=' ) ) == NULL )
+            exit_usage( p, NULL );
+        *q++ = '\0';
+
+        if( strcmp( p, "threads" ) == 0 )
+        {
+            opt.threads = atoi( q );
+            if( opt.threads < 1 || opt.threads > MAX_THREADS )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "ops" ) == 0 )
+        {
+            opt.ops = atoi( q );
+            if( opt.ops < 1 )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "lifetime" ) == 0 )
+        {
+            opt.lifetime = atoi( q );
+            if( opt.lifetime < 0 )
+                exit_usage( p, q );
+        }
+        else if( strcmp( p, "cipher" ) == 0 )
+        {
+            if( ( cipher_info = mbedtls_cipher_info_from_string( q ) ) == NULL )
+                exit_usage( p, q );
+            opt.cipher = cipher_info->type;
+        }
+        else
+            exit_usage( p, NULL );
+    }
+}
+
+/*
+ * Each iteration issues a ticket then parses it back, as a full handshake
+ * followed by a resumption would.
+ */
+static void *bench_thread( void *data )
+{
+    thread_info_t *info = (thread_info_t *) data;
+    mbedtls_ssl_session session, restored;
+    unsigned char buf[512];
+    size_t tlen;
+    uint32_t lifetime;
+    int i;
+
+    memset( &session, 0, sizeof( mbedtls_ssl_session ) );
+#if defined(MBEDTLS_HAVE_TIME)
+    session.start = mbedtls_time( NULL );
+#endif
+    session.ciphersuite = MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+    memset( session.master, 0x2A, sizeof( session.master ) );
+
+    for( i = 0; i < opt.ops; i++ )
+    {
+        if( ( info->ret = mbedtls_ssl_ticket_write( info->ticket, &session,
+                                        buf, buf + sizeof( buf ),
+                                        &tlen, &lifetime ) ) != 0 )
+        {
+            break;
+        }
+
+        memset( &restored, 0, sizeof( mbedtls_ssl_session ) );
+        info->ret = mbedtls_ssl_ticket_parse( info->ticket, &restored,
+                                              buf, tlen );
+        mbedtls_ssl_session_free( &restored );
+
+        /* With a short lifetime, a ticket may have been issued just before
+         * a rotation made its key unavailable */
+        if( info->ret == MBEDTLS_ERR_SSL_SESSION_TICKET_EXPIRED )
+            info->ret = 0;
+
+        if( info->ret != 0 )
+            break;
+    }
+
+    return( NULL );
+}
+
+int main( int argc, char *argv[] )
+{
+    int ret = 1, i;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_ssl_ticket_context ticket;
+    pthread_t tid[MAX_THREADS];
+    thread_info_t info[MAX_THREADS];
+    struct mbedtls_timing_hr_time timer;
+    unsigned long ms;
+    const char *pers = "ssl_ticket_bench";
+
+    mbedtls_entropy_init( &entropy );
+    mbedtls_ctr_drbg_init( &ctr_drbg );
+    mbedtls_ssl_ticket_init( &ticket );
+
+    get_options( argc, argv );
+
+    if( ( ret = mbedtls_ctr_drbg_seed( &ctr_drbg, mbedtls_entropy_func,
+                                       &entropy, (const unsigned char *) pers,
+                                       strlen( pers ) ) ) != 0 )
+    {
+        mbedtls_printf( "  ! mbedtls_ctr_drbg_seed returned -0x%04x\n", -ret );
+        goto exit;
+    }
+
+    if( ( ret = mbedtls_ssl_ticket_setup( &ticket, mbedtls_ctr_drbg_random,
+                                          &ctr_drbg, opt.cipher,
+                                          opt.lifetime ) ) != 0 )
+    {
+        mbedtls_printf( "  ! mbedtls_ssl_ticket_setup returned -0x%04x\n", -ret );
+        goto exit;
+    }
+
+    (void) mbedtls_timing_get_timer( &timer, 1 );
+
+    for( i = 0; i < opt.threads; i++ )
+    {
+        info[i].ticket = &ticket;
+        info[i].ret = 0;
+
+        if( pthread_create( &tid[i], NULL, bench_thread, &info[i] ) != 0 )
+        {
+            mbedtls_printf( "  ! pthread_create failed\n" );
+            ret = 1;
+            goto exit;
+        }
+    }
+
+    for( i = 0; i < opt.threads; i++ )
+    {
+        pthread_join( tid[i], NULL );
+
+        if( info[i].ret != 0 && ret == 0 )
+        {
+            ret = info[i].ret;
+            mbedtls_printf( "  ! thread %d: ticket operation returned -0x%04x\n",
+                            i, -ret );
+        }
+    }
+
+    ms = mbedtls_timing_get_timer( &timer, 0 );
+    if( ms == 0 )
+        ms = 1;
+
+    mbedtls_printf( "\n  %s: %9lu tickets/s written and parsed (%d threads)\n\n",
+                    mbedtls_cipher_info_from_type( opt.cipher )->name,
+                    (unsigned long) opt.threads * opt.ops * 1000 / ms,
+                    opt.threads );
+
+exit:
+    mbedtls_ssl_ticket_free( &ticket );
+    mbedtls_ctr_drbg_free( &ctr_drbg );
+    mbedtls_entropy_free( &entropy );
+
+#if defined(_WIN32)
+    mbedtls_printf( "  + Press Enter to exit this program.\n" );
+    fflush( stdout ); getchar();
+#endif
+
+    return( ret != 0 );
+}
+#endif /* MBEDTLS_SSL_TICKET_C && MBEDTLS_TIMING_C && MBEDTLS_ENTROPY_C &&
+          MBEDTLS_CTR_DRBG_C && MBEDTLS_THREADING_C &&
+          MBEDTLS_THREADING_PTHREAD */
@@ -0,0 +1,199 @@
+#!/usr/bin/perl
+
+# Generate the precomputed comb tables of the curve generators in
+# library/ecp_curves.c
+#
+# Usage: ./generate_ecp_comb_tables.pl or
+# scripts/generate_ecp_comb_tables.pl without arguments,
+# or generate_ecp_comb_tables.pl curves_file
+#
+# The domain parameters are read from the constants in the curves file, and
+# the section between the BEGIN and END markers is replaced. Each table holds
+# T[i] = ( 1 + i_1 2^d + ... + i_{w-1} 2^{(w-1)d} ) G for i < 2^{w-1},
+# with d = ceil( nbits / w ), in affine coordinates: what ecp_precompute_comb()
+# in ecp.c computes for a window of w bits.
+
+use strict;
+use Math::BigInt;
+
+my $curves_file;
+
+if( @ARGV ) {
+    die "Invalid number of arguments" if scalar @ARGV != 1;
+    ($curves_file) = @ARGV;
+} else {
+    $curves_file = 'library/ecp_curves.c';
+
+    unless( -f $curves_file ) {
+        chdir '..' or die;
+        -f $curves_file
+            or die "Without arguments, must be run from root or scripts\n"
+    }
+}
+
+my $window = 6;
+
+my @curves = ( [ "secp192r1",       "SECP192R1" ],
+               [ "secp224r1",       "SECP224R1" ],
+               [ "secp256r1",       "SECP256R1" ],
+               [ "secp384r1",       "SECP384R1" ],
+               [ "secp521r1",       "SECP521R1" ],
+               [ "secp192k1",       "SECP192K1" ],
+               [ "secp224k1",       "SECP224K1" ],
+               [ "secp256k1",       "SECP256K1" ],
+               [ "brainpoolP256r1", "BP256R1" ],
+               [ "brainpoolP384r1", "BP384R1" ],
+               [ "brainpoolP512r1", "BP512R1" ] );
+
+my $begin_marker = "/* BEGIN generated comb tables */\n";
+my $end_marker = "/* END generated comb tables */\n";
+
+my $line_separator = $/;
+undef $/;
+
+open(CURVES_FILE, "$curves_file") or die "Opening curves file '$curves_file': $!";
+my $curves_c = <CURVES_FILE>;
+close(CURVES_FILE);
+
+$/ = $line_separator;
+
+# Return the little-endian bytes of a constant as a list
+sub constant_bytes {
+    my ($name) = @_;
+
+    $curves_c =~ /static const mbedtls_mpi_uint \Q$name\E\[\] = \{\n(.*?)\n\};/s
+        or return ();
+
+    my @bytes;
+    foreach my $hex ( $1 =~ /0x([0-9A-F]{2})/g ) {
+        push @bytes, hex($hex);
+    }
+
+    return @bytes;
+}
+
+sub constant_value {
+    my (@bytes) = @_;
+    my $hex = join( "", map { sprintf( "%02X", $_ ) } reverse @bytes );
+    return Math::BigInt->from_hex( "0x".$hex );
+}
+
+# Affine point arithmetic, points are [ x, y ] and never zero here
+sub point_double {
+    my ($P, $p, $a) = @_;
+    my ($x, $y) = @$P;
+
+    my $l = ( $x * $x * 3 + $a ) * ( $y * 2 )->bmodinv( $p ) % $p;
+    my $x3 = ( $l * $l - $x * 2 ) % $p;
+    my $y3 = ( $l * ( $x - $x3 ) - $y ) % $p;
+
+    return [ $x3, $y3 ];
+}
+
+sub point_add {
+    my ($P, $Q, $p) = @_;
+    my ($x1, $y1) = @$P;
+    my ($x2, $y2) = @$Q;
+
+    die "Unexpected doubling or zero" if $x1 == $x2;
+
+    my $l = ( $y2 - $y1 ) * ( ( $x2 - $x1 ) % $p )->bmodinv( $p ) % $p;
+    my $x3 = ( $l * $l - $x1 - $x2 ) % $p;
+    my $y3 = ( $l * ( $x1 - $x3 ) - $y1 ) % $p;
+
+    return [ $x3, $y3 ];
+}
+
+# Format a value as a constant of the given length, grouped like the domain
+# parameters are
+sub format_constant {
+    my ($name, $value, $len) = @_;
+    my @bytes;
+    my $code = "static const mbedtls_mpi_uint $name\[\] = {\n";
+
+    my $hex = substr( "0" x ( 2 * $len ) . $value->as_hex() =~ s/^0x//r,
+                      -2 * $len );
+    @bytes = reverse( $hex =~ /(..)/g );
+
+    while( @bytes ) {
+        my $n = @bytes >= 8 ? 8 : @bytes >= 4 ? 4 : 2;
+        my @group = splice( @bytes, 0, $n );
+        $code .= "    BYTES_TO_T_UINT_$n( "
+               . join( ", ", map { "0x".uc( $_ ) } @group ) . " ),\n";
+    }
+
+    return $code."};\n";
+}
+
+my $tables = $begin_marker;
+
+$tables .= <<EOF;
+/*
+ * Precomputed comb tables of the generators for ecp_mul_comb(), window of
+ * $window bits. Generated by scripts/generate_ecp_comb_tables.pl, do not edit.
+ */
+#if MBEDTLS_ECP_FIXED_POINT_OPTIM == 1
+
+#if defined(MBEDTLS_MPI_SCRATCH_ARENA)
+#define ECP_POINT_INIT_XY( X, Y )                                             \\
+    { { 1, sizeof( X ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) X,  \\
+        NULL },                                                               \\
+      { 1, sizeof( Y ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) Y,  \\
+        NULL },                                                               \\
+      { 0, 0, NULL, NULL } }
+#else
+#define ECP_POINT_INIT_XY( X, Y )                                             \\
+    { { 1, sizeof( X ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) X }, \\
+      { 1, sizeof( Y ) / sizeof( mbedtls_mpi_uint ), (mbedtls_mpi_uint *) Y }, \\
+      { 0, 0, NULL } }
+#endif
+EOF
+
+foreach my $curve ( @curves ) {
+    my ($name, $dp) = @$curve;
+
+    my @p_bytes = constant_bytes( $name."_p" );
+    die "No domain parameters for $name" unless @p_bytes;
+
+    my $len = scalar @p_bytes;
+    my $p = constant_value( @p_bytes );
+    my @a_bytes = constant_bytes( $name."_a" );
+    my $a = @a_bytes ? constant_value( @a_bytes ) : $p - 3;
+    my $G = [ constant_value( constant_bytes( $name."_gx" ) ),
+              constant_value( constant_bytes( $name."_gy" ) ) ];
+    my $nbits = length( constant_value( constant_bytes( $name."_n" ) )
+                        ->as_bin() ) - 2;
+    my $d = int( ( $nbits + $window - 1 ) / $window );
+
+    my @T = ( $G );
+    for( my $i = 1; $i < ( 1 << ( $window - 1 ) ); $i <<= 1 ) {
+        my $cur = $T[$i >> 1];
+        $cur = point_double( $cur, $p, $a ) for 1 .. $d;
+        $T[$i] = $cur;
+    }
+    for( my $i = 1; $i < ( 1 << ( $window - 1 ) ); $i <<= 1 ) {
+        for( my $j = $i - 1; $j >= 0; $j-- ) {
+            $T[$i + $j] = point_add( $T[$j], $T[$i], $p );
+        }
+    }
+
+    $tables .= "\n#if defined(MBEDTLS_ECP_DP_${dp}_ENABLED)\n";
+    for( my $i = 0; $i < @T; $i++ ) {
+        $tables .= format_constant( "${name}_T_${i}_X", $T[$i][0], $len );
+        $tables .= format_constant( "${name}_T_${i}_Y", $T[$i][1], $len );
+    }
+    $tables .= "static const mbedtls_ecp_point ${name}_T[".scalar @T."] = {\n";
+    for( my $i = 0; $i < @T; $i++ ) {
+        $tables .= "    ECP_POINT_INIT_XY( ${name}_T_${i}_X, ${name}_T_${i}_Y ),\n";
+    }
+    $tables .= "};\n#endif /* MBEDTLS_ECP_DP_${dp}_ENABLED */\n";
+}
+
+$tables .= "\n#endif /* MBEDTLS_ECP_FIXED_POINT_OPTIM == 1 */\n".$end_marker;
+
+$curves_c =~ s/\Q$begin_marker\E.*\Q$end_marker\E/$tables/s
+    or die "No generated section in $curves_file\n";
+
+open(CURVES_FILE, ">$curves_file") or die "Opening curves file '$curves_file': $!";
+print CURVES_FILE $curves_c;
+close(CURVES_FILE);
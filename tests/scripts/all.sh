@@ -428,6 +428,39 @@ make
 msg "test: MBEDTLS_TEST_NULL_ENTROPY - main suites (inc. selftests) (ASan build)"
 make test
 
+msg "build: default config with MBEDTLS_ECP_P256_C (ASan build)" # ~ 1 min 50s
+cleanup
+cp "$CONFIG_H" "$CONFIG_BAK"
+scripts/config.pl set MBEDTLS_ECP_INTERNAL_ALT
+scripts/config.pl set MBEDTLS_ECP_ADD_MIXED_ALT
+scripts/config.pl set MBEDTLS_ECP_DOUBLE_JAC_ALT
+scripts/config.pl set MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT
+scripts/config.pl set MBEDTLS_ECP_NORMALIZE_JAC_ALT
+scripts/config.pl set MBEDTLS_ECP_P256_C
+CC=gcc cmake -D CMAKE_BUILD_TYPE:String=ASan .
+make
+
+msg "test: MBEDTLS_ECP_P256_C - main suites (inc. selftests) (ASan build)"
+make test
+
+msg "build: MBEDTLS_ECP_P256_C with 32-bit limbs, make, gcc" # ~ 30s
+cleanup
+cp "$CONFIG_H" "$CONFIG_BAK"
+scripts/config.pl set MBEDTLS_ECP_INTERNAL_ALT
+scripts/config.pl set MBEDTLS_ECP_ADD_MIXED_ALT
+scripts/config.pl set MBEDTLS_ECP_DOUBLE_JAC_ALT
+scripts/config.pl set MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT
+scripts/config.pl set MBEDTLS_ECP_NORMALIZE_JAC_ALT
+scripts/config.pl set MBEDTLS_ECP_P256_C
+scripts/config.pl unset MBEDTLS_HAVE_ASM
+scripts/config.pl unset MBEDTLS_AESNI_C
+scripts/config.pl unset MBEDTLS_PADLOCK_C
+scripts/config.pl unset MBEDTLS_SHANI_C
+CC=gcc CFLAGS='-Werror -Wall -Wextra -DMBEDTLS_HAVE_INT32=' make
+
+msg "test: MBEDTLS_ECP_P256_C with 32-bit limbs - main suites"
+make test
+
 if uname -a | grep -F Linux >/dev/null; then
 msg "build/test: make shared" # ~ 40s
 cleanup
@@ -515,6 +548,7 @@ msg "build: MSan (clang)" # ~ 1 min 20s
 cleanup
 cp "$CONFIG_H" "$CONFIG_BAK"
 scripts/config.pl unset MBEDTLS_AESNI_C # memsan doesn't grok asm
+scripts/config.pl unset MBEDTLS_SHANI_C # memsan doesn't grok asm
 CC=clang cmake -D CMAKE_BUILD_TYPE:String=MemSan .
 make
 
@@ -2358,6 +2358,682 @@ run_test    "Non-blocking I/O: session-id resume" \
             -C "mbedtls_ssl_handshake returned" \
             -c "Read from server: .* bytes read"
 
+# Tests for zero-copy reads with mbedtls_ssl_read_borrow()
+
+run_test    "Zero-copy read: basic" \
+            "$P_SRV" \
+            "$P_CLI debug_level=2 read_borrow=1" \
+            0 \
+            -C "mbedtls_ssl_read returned" \
+            -c "<= read borrow" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Zero-copy read: non-blocking I/O" \
+            "$P_SRV nbio=2" \
+            "$P_CLI nbio=2 read_borrow=1" \
+            0 \
+            -C "mbedtls_ssl_read returned" \
+            -c "Read from server: .* bytes read"
+
+run_test    "Zero-copy read: server-initiated renegotiation" \
+            "$P_SRV debug_level=3 exchanges=2 renegotiation=1 renegotiate=1" \
+            "$P_CLI debug_level=3 exchanges=2 renegotiation=1 read_borrow=1" \
+            0 \
+            -C "mbedtls_ssl_read returned" \
+            -c "=> renegotiate" \
+            -s "=> renegotiate" \
+            -c "<= read borrow" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Zero-copy read: DTLS" \
+            "$P_SRV dtls=1" \
+            "$P_CLI dtls=1 read_borrow=1" \
+            0 \
+            -C "mbedtls_ssl_read returned" \
+            -c "Read from server: .* bytes read"
+
+# Tests for in-place writes with mbedtls_ssl_write_prepare/commit()
+
+run_test    "In-place write: basic" \
+            "$P_SRV debug_level=2 write_inplace=1" \
+            "$P_CLI" \
+            0 \
+            -S "mbedtls_ssl_write returned" \
+            -s "<= write commit" \
+            -c "Read from server: .* bytes read"
+
+run_test    "In-place write: non-blocking I/O" \
+            "$P_SRV nbio=2 write_inplace=1" \
+            "$P_CLI nbio=2" \
+            0 \
+            -S "mbedtls_ssl_write returned" \
+            -c "Read from server: .* bytes read"
+
+run_test    "In-place write: max_frag_len" \
+            "$P_SRV debug_level=3 write_inplace=1" \
+            "$P_CLI max_frag_len=512" \
+            0 \
+            -S "mbedtls_ssl_write returned" \
+            -s "<= write commit" \
+            -c "Read from server: .* bytes read"
+
+run_test    "In-place write: TLS 1.0 CBC, record splitting" \
+            "$P_SRV debug_level=1 write_inplace=1" \
+            "$P_CLI force_ciphersuite=TLS-RSA-WITH-AES-128-CBC-SHA \
+             force_version=tls1" \
+            0 \
+            -s "in-place write not available with CBC record splitting" \
+            -S "mbedtls_ssl_write returned" \
+            -c "Read from server: .* bytes read"
+
+run_test    "In-place write: DTLS" \
+            "$P_SRV dtls=1 write_inplace=1" \
+            "$P_CLI dtls=1" \
+            0 \
+            -S "mbedtls_ssl_write returned" \
+            -c "Read from server: .* bytes read"
+
+# Tests for gather writes with mbedtls_ssl_writev()
+
+run_test    "Gather write: small buffers packed in one record" \
+            "$P_SRV" \
+            "$P_CLI request_size=123 write_iov=5" \
+            0 \
+            -C "mbedtls_ssl_write returned" \
+            -c "123 bytes written in 1 fragments" \
+            -s "Read from client: 123 bytes read"
+
+run_test    "Gather write: max_frag_len, records across buffers" \
+            "$P_SRV debug_level=3" \
+            "$P_CLI max_frag_len=2048 request_size=2345 write_iov=100" \
+            0 \
+            -C "mbedtls_ssl_write returned" \
+            -c "2345 bytes written in 2 fragments" \
+            -s "2048 bytes read" \
+            -s "297 bytes read"
+
+run_test    "Gather write: TLS 1.0 CBC, record splitting" \
+            "$P_SRV" \
+            "$P_CLI force_ciphersuite=TLS-RSA-WITH-AES-128-CBC-SHA \
+             force_version=tls1 request_size=123 write_iov=5" \
+            0 \
+            -s "Read from client: 1 bytes read" \
+            -s "122 bytes read"
+
+run_test    "Gather write: non-blocking I/O" \
+            "$P_SRV nbio=2" \
+            "$P_CLI nbio=2 request_size=123 write_iov=7" \
+            0 \
+            -C "mbedtls_ssl_write returned" \
+            -s "Read from client: 123 bytes read"
+
+run_test    "Gather write: DTLS" \
+            "$P_SRV dtls=1" \
+            "$P_CLI dtls=1 request_size=123 write_iov=5" \
+            0 \
+            -C "mbedtls_ssl_write returned" \
+            -s "Read from client: 123 bytes read"
+
+# Tests for record batching
+
+run_test    "Record batching: split records sent and read together" \
+            "$P_SRV debug_level=2 write_batch=65536" \
+            "$P_CLI debug_level=2 read_ahead=1 force_version=tls1 \
+             force_ciphersuite=TLS-RSA-WITH-AES-128-CBC-SHA" \
+            0 \
+            -S "mbedtls_ssl_flush returned" \
+            -s "batch length: [1-9][0-9]*, out_batch_left: [1-9]" \
+            -c "next record already read" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Record batching: write batching only" \
+            "$P_SRV debug_level=2 write_batch=65536" \
+            "$P_CLI debug_level=2 force_version=tls1 \
+             force_ciphersuite=TLS-RSA-WITH-AES-128-CBC-SHA" \
+            0 \
+            -s "batch length: [1-9][0-9]*, out_batch_left: [1-9]" \
+            -C "next record already read" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Record batching: read ahead only" \
+            "$P_SRV debug_level=2" \
+            "$P_CLI debug_level=2 read_ahead=1" \
+            0 \
+            -S "batch length:" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Record batching: small batch buffer" \
+            "$P_SRV debug_level=2 write_batch=100" \
+            "$P_CLI read_ahead=1 force_version=tls1 \
+             force_ciphersuite=TLS-RSA-WITH-AES-128-CBC-SHA" \
+            0 \
+            -S "mbedtls_ssl_flush returned" \
+            -c "Read from server: 1 bytes read"
+
+run_test    "Record batching: non-blocking I/O" \
+            "$P_SRV nbio=2 write_batch=65536" \
+            "$P_CLI nbio=2 read_ahead=1 force_version=tls1 \
+             force_ciphersuite=TLS-RSA-WITH-AES-128-CBC-SHA" \
+            0 \
+            -S "mbedtls_ssl_flush returned" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Record batching: renegotiation" \
+            "$P_SRV debug_level=3 write_batch=65536 exchanges=2 \
+             renegotiation=1 renegotiate=1" \
+            "$P_CLI debug_level=3 read_ahead=1 exchanges=2 renegotiation=1" \
+            0 \
+            -c "=> renegotiate" \
+            -s "=> renegotiate" \
+            -s "write hello request" \
+            -S "mbedtls_ssl_flush returned" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Record batching: DTLS is not batched" \
+            "$P_SRV debug_level=2 dtls=1 write_batch=65536" \
+            "$P_CLI dtls=1 read_ahead=1" \
+            0 \
+            -S "batch length:" \
+            -c "Read from server: [1-9][0-9]* bytes read"
+
+# Tests for dynamic record buffers
+
+run_test    "Dynamic buffers: basic" \
+            "$P_SRV debug_level=3 buffer_pool=1" \
+            "$P_CLI debug_level=3 buffer_pool=1" \
+            0 \
+            -s "got input buffer (16717 bytes)" \
+            -s "released input buffer" \
+            -s "released output buffer" \
+            -c "got output buffer (16717 bytes)" \
+            -c "released output buffer" \
+            -S "mbedtls_ssl_handshake returned" \
+            -C "mbedtls_ssl_handshake returned" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Dynamic buffers: max_frag_len shrinks buffers after handshake" \
+            "$P_SRV debug_level=3 buffer_pool=1 exchanges=2" \
+            "$P_CLI debug_level=3 buffer_pool=1 max_frag_len=1024 \
+             renegotiation=0 exchanges=2" \
+            0 \
+            -s "got input buffer (16717 bytes)" \
+            -s "got input buffer (1357 bytes)" \
+            -s "got output buffer (1357 bytes)" \
+            -c "got input buffer (1357 bytes)" \
+            -c "got output buffer (1357 bytes)" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Dynamic buffers: large request" \
+            "$P_SRV debug_level=3 buffer_pool=1" \
+            "$P_CLI buffer_pool=1 request_size=16384" \
+            0 \
+            -s "got input buffer (16717 bytes)" \
+            -s "16384 bytes read" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Dynamic buffers: non-blocking I/O" \
+            "$P_SRV nbio=2 buffer_pool=1 exchanges=2" \
+            "$P_CLI nbio=2 buffer_pool=1 request_size=16384 exchanges=2" \
+            0 \
+            -S "mbedtls_ssl_read returned" \
+            -C "mbedtls_ssl_read returned" \
+            -s "16384 bytes read"
+
+run_test    "Dynamic buffers: renegotiation" \
+            "$P_SRV debug_level=3 buffer_pool=1 exchanges=2 \
+             renegotiation=1 renegotiate=1" \
+            "$P_CLI debug_level=3 buffer_pool=1 exchanges=2 renegotiation=1" \
+            0 \
+            -c "=> renegotiate" \
+            -s "=> renegotiate" \
+            -s "write hello request" \
+            -s "released output buffer" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Dynamic buffers: session resumption" \
+            "$P_SRV debug_level=3 buffer_pool=1 tickets=0" \
+            "$P_CLI debug_level=3 buffer_pool=1 tickets=0 reconnect=1" \
+            0 \
+            -s "session successfully restored from cache" \
+            -c "released input buffer" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Dynamic buffers: record batching" \
+            "$P_SRV debug_level=2 buffer_pool=1 write_batch=65536" \
+            "$P_CLI debug_level=2 buffer_pool=1 read_ahead=1 force_version=tls1 \
+             force_ciphersuite=TLS-RSA-WITH-AES-128-CBC-SHA" \
+            0 \
+            -S "mbedtls_ssl_flush returned" \
+            -s "batch length: [1-9][0-9]*, out_batch_left: [1-9]" \
+            -c "next record already read" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Dynamic buffers: in-place write and zero-copy read" \
+            "$P_SRV debug_level=2 buffer_pool=1 write_inplace=1" \
+            "$P_CLI debug_level=2 buffer_pool=1 read_borrow=1 write_iov=16" \
+            0 \
+            -S "mbedtls_ssl_write returned" \
+            -C "mbedtls_ssl_read returned" \
+            -s "<= write commit" \
+            -c "<= read borrow" \
+            -c "[1-9][0-9]* bytes read"
+
+run_test    "Dynamic buffers: DTLS keeps static buffers" \
+            "$P_SRV debug_level=3 dtls=1 buffer_pool=1" \
+            "$P_CLI dtls=1 buffer_pool=1" \
+            0 \
+            -S "got input buffer" \
+            -c "[1-9][0-9]* bytes read"
+
+# Tests for lean connections
+
+run_test    "Lean connections: server certificate digest" \
+            "$P_SRV" \
+            "$P_CLI debug_level=3 lean=1" \
+            0 \
+            -c "handshake wrapup: lean release" \
+            -c "Peer certificate digest: E234E102CD8DE90E258906D253157AEB7699A3C6DF0C4E79E05D01801999DCB5" \
+            -c "Peer certificate serial: 09" \
+            -C "Peer certificate information" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Lean connections: client authentication" \
+            "$P_SRV debug_level=3 lean=1 auth_mode=required" \
+            "$P_CLI lean=1" \
+            0 \
+            -s "handshake wrapup: lean release" \
+            -s "Peer certificate digest: " \
+            -s "Peer certificate serial: 04" \
+            -S "Peer certificate information" \
+            -c "Peer certificate digest: "
+
+run_test    "Lean connections: client-initiated renegotiation" \
+            "$P_SRV lean=1 exchanges=2 renegotiation=1 auth_mode=required" \
+            "$P_CLI debug_level=3 lean=1 exchanges=2 renegotiation=1 \
+             renegotiate=1" \
+            0 \
+            -c "=> renegotiate" \
+            -C "server cert changed during renegotiation" \
+            -C "new server cert during renegotiation" \
+            -c "Peer certificate digest: " \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Lean connections: server-initiated renegotiation" \
+            "$P_SRV debug_level=3 lean=1 exchanges=2 renegotiation=1 \
+             renegotiate=1 auth_mode=required" \
+            "$P_CLI debug_level=3 lean=1 exchanges=2 renegotiation=1" \
+            0 \
+            -c "=> renegotiate" \
+            -s "=> renegotiate" \
+            -s "write hello request" \
+            -C "server cert changed during renegotiation" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Lean connections: session resumption from cache" \
+            "$P_SRV debug_level=3 lean=1 tickets=0 auth_mode=required" \
+            "$P_CLI debug_level=3 lean=1 tickets=0 reconnect=1" \
+            0 \
+            -s "session successfully restored from cache" \
+            -c "a session has been resumed" \
+            -c "Peer certificate digest: E234E102CD8DE90E258906D253157AEB7699A3C6DF0C4E79E05D01801999DCB5" \
+            -s "Peer certificate digest: "
+
+run_test    "Lean connections: session resumption with ticket" \
+            "$P_SRV debug_level=3 lean=1 tickets=1 auth_mode=required" \
+            "$P_CLI debug_level=3 lean=1 tickets=1 reconnect=1" \
+            0 \
+            -s "a session has been resumed" \
+            -c "a session has been resumed" \
+            -c "Peer certificate digest: " \
+            -s "Peer certificate digest: "
+
+client_needs_more_time 2
+run_test    "Lean connections: DTLS, 3d proxy" \
+            -p "$P_PXY drop=5 delay=5 duplicate=5" \
+            "$P_SRV debug_level=3 dtls=1 hs_timeout=250-10000 lean=1 \
+             auth_mode=required" \
+            "$P_CLI debug_level=3 dtls=1 hs_timeout=250-10000 lean=1" \
+            0 \
+            -s "handshake wrapup: lean release" \
+            -c "handshake wrapup: lean release" \
+            -s "Extra-header:" \
+            -c "HTTP/1.0 200 OK"
+
+# Tests for asynchronous private key operations
+
+run_test    "Async private: sign, delay=0" \
+            "$P_SRV async_operations=s async_private_delay=0" \
+            "$P_CLI" \
+            0 \
+            -s "Async sign callback: using key slot " \
+            -s "Async resume (sign): done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: sign, delay=2" \
+            "$P_SRV async_operations=s async_private_delay=2" \
+            "$P_CLI" \
+            0 \
+            -s "Async sign callback: using key slot " \
+            -s "Async resume (sign): call again (1)" \
+            -s "Async resume (sign): call again (0)" \
+            -s "Async resume (sign): done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: sign, completed at start" \
+            "$P_SRV async_operations=s async_private_delay=-1" \
+            "$P_CLI" \
+            0 \
+            -s "Async sign callback: looking for a key" \
+            -S "Async sign callback: using key slot " \
+            -s "Async resume (sign): done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: sign, RSA, TLS 1.1" \
+            "$P_SRV async_operations=s async_private_delay=1" \
+            "$P_CLI force_version=tls1_1 \
+             force_ciphersuite=TLS-ECDHE-RSA-WITH-AES-128-CBC-SHA" \
+            0 \
+            -s "Async sign callback: using key slot " \
+            -s "Async resume (sign): done, status=0" \
+            -s "Protocol is TLSv1.1" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: decrypt, delay=1" \
+            "$P_SRV async_operations=d async_private_delay=1" \
+            "$P_CLI force_ciphersuite=TLS-RSA-WITH-AES-128-GCM-SHA256" \
+            0 \
+            -s "Async decrypt callback: using key slot " \
+            -s "Async resume (decrypt): call again (0)" \
+            -s "Async resume (decrypt): done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: decrypt, RSA-PSK" \
+            "$P_SRV async_operations=d async_private_delay=1 \
+             psk=abc123 psk_identity=foo" \
+            "$P_CLI force_ciphersuite=TLS-RSA-PSK-WITH-AES-128-GCM-SHA256 \
+             psk=abc123 psk_identity=foo" \
+            0 \
+            -s "Async decrypt callback: using key slot " \
+            -s "Async resume (decrypt): done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: sign callback not present" \
+            "$P_SRV async_operations=d async_private_delay=1" \
+            "$P_CLI force_ciphersuite=TLS-ECDHE-RSA-WITH-AES-128-GCM-SHA256" \
+            0 \
+            -S "Async sign callback" \
+            -S "Async resume" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: error in sign start" \
+            "$P_SRV async_operations=s async_private_error=1" \
+            "$P_CLI" \
+            1 \
+            -s "Async sign callback: injected error" \
+            -S "Async resume" \
+            -S "Async cancel" \
+            -s "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: error in sign resume" \
+            "$P_SRV async_operations=s async_private_error=2" \
+            "$P_CLI" \
+            1 \
+            -s "Async sign callback: using key slot " \
+            -s "Async resume (sign): injected error" \
+            -S "Async cancel" \
+            -s "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: error in decrypt resume" \
+            "$P_SRV async_operations=d async_private_error=2" \
+            "$P_CLI force_ciphersuite=TLS-RSA-WITH-AES-128-GCM-SHA256" \
+            1 \
+            -s "Async decrypt callback: using key slot " \
+            -s "Async resume (decrypt): injected error" \
+            -s "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: cancel pending signature" \
+            "$P_SRV async_operations=s async_private_delay=1 \
+             async_private_error=3" \
+            "$P_CLI" \
+            1 \
+            -s "Async sign callback: using key slot " \
+            -s "cancelling on injected error" \
+            -s "Async cancel callback" \
+            -S "Async resume"
+
+run_test    "Async private: client-initiated renegotiation" \
+            "$P_SRV async_operations=s async_private_delay=1 exchanges=2 \
+             renegotiation=1" \
+            "$P_CLI exchanges=2 renegotiation=1 renegotiate=1" \
+            0 \
+            -s "Async resume (sign): done, status=0" \
+            -S "mbedtls_ssl_handshake returned" \
+            -S "mbedtls_ssl_read returned" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Async private: with dynamic buffers" \
+            "$P_SRV async_operations=ds async_private_delay=2 buffer_pool=1" \
+            "$P_CLI buffer_pool=1" \
+            0 \
+            -s "Async resume (sign): done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async private: DTLS" \
+            "$P_SRV dtls=1 async_operations=ds async_private_delay=1" \
+            "$P_CLI dtls=1 force_ciphersuite=TLS-RSA-WITH-AES-128-CCM \
+             skip_close_notify=1" \
+            0 \
+            -s "Async resume (decrypt): done, status=0" \
+            -S "mbedtls_ssl_handshake returned" \
+            -c "HTTP/1.0 200 OK"
+
+# Tests for asynchronous certificate verification
+
+run_test    "Async verify: delay=0" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_delay=0" \
+            "$P_CLI" \
+            0 \
+            -s "Async verify callback: started, delay=0" \
+            -s "Async verify resume: done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: delay=2" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_delay=2" \
+            "$P_CLI" \
+            0 \
+            -s "Async verify resume: call again (1)" \
+            -s "Async verify resume: call again (0)" \
+            -s "Async verify resume: done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: completed at start" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_delay=-1" \
+            "$P_CLI" \
+            0 \
+            -s "Async verify callback: completed at start" \
+            -s "Async verify resume: done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: badcert, server required" \
+            "$P_SRV debug_level=3 auth_mode=required async_verify=1 \
+             async_verify_delay=1" \
+            "$P_CLI crt_file=data_files/server5-badsign.crt \
+             key_file=data_files/server5.key" \
+            1 \
+            -s "Async verify resume: done, status=-9984" \
+            -s "! The certificate is not correctly signed by the trusted CA" \
+            -s "send alert level=2 message=48" \
+            -s "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: badcert, server optional" \
+            "$P_SRV debug_level=3 auth_mode=optional async_verify=1 \
+             async_verify_delay=1" \
+            "$P_CLI crt_file=data_files/server5-badsign.crt \
+             key_file=data_files/server5.key" \
+            0 \
+            -s "Async verify resume: done, status=-9984" \
+            -s "! The certificate is not correctly signed by the trusted CA" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: no client certificate" \
+            "$P_SRV auth_mode=optional async_verify=1" \
+            "$P_CLI crt_file=none key_file=none" \
+            0 \
+            -S "Async verify callback" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: error in start" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_error=1" \
+            "$P_CLI" \
+            1 \
+            -s "Async verify callback: injected error" \
+            -S "Async verify resume" \
+            -S "Async verify cancel" \
+            -s "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: error in resume" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_error=2" \
+            "$P_CLI" \
+            1 \
+            -s "Async verify resume: injected error" \
+            -S "Async verify cancel" \
+            -s "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: cancel" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_error=3" \
+            "$P_CLI" \
+            1 \
+            -s "Async verify callback: started" \
+            -s "cancelling on injected error" \
+            -s "Async verify cancel callback" \
+            -S "Async verify resume"
+
+run_test    "Async verify: server-initiated renegotiation" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_delay=1 \
+             exchanges=2 renegotiation=1 renegotiate=1" \
+            "$P_CLI exchanges=2 renegotiation=1" \
+            0 \
+            -s "Async verify resume: done, status=0" \
+            -S "mbedtls_ssl_handshake returned" \
+            -S "mbedtls_ssl_renegotiate returned" \
+            -C "mbedtls_ssl_read returned"
+
+run_test    "Async verify: with async private key operations" \
+            "$P_SRV auth_mode=required async_verify=1 async_verify_delay=1 \
+             async_operations=s async_private_delay=1" \
+            "$P_CLI" \
+            0 \
+            -s "Async resume (sign): done, status=0" \
+            -s "Async verify resume: done, status=0" \
+            -S "mbedtls_ssl_handshake returned"
+
+run_test    "Async verify: DTLS" \
+            "$P_SRV dtls=1 auth_mode=required async_verify=1 \
+             async_verify_delay=1" \
+            "$P_CLI dtls=1" \
+            0 \
+            -s "Async verify resume: done, status=0" \
+            -c "HTTP/1.0 200 OK"
+
+# Tests for the CA store
+
+requires_config_enabled MBEDTLS_X509_CA_STORE
+run_test    "CA store: server cert trusted" \
+            "$P_SRV" \
+            "$P_CLI debug_level=1 auth_mode=required ca_store=1" \
+            0 \
+            -c "Indexing the trusted CAs... ok" \
+            -C "x509_verify_cert() returned" \
+            -C "! mbedtls_ssl_handshake returned"
+
+requires_config_enabled MBEDTLS_X509_CA_STORE
+run_test    "CA store: server cert from another CA" \
+            "$P_SRV crt_file=data_files/server5.crt \
+             key_file=data_files/server5.key" \
+            "$P_CLI debug_level=1 auth_mode=required ca_store=1 \
+             ca_file=data_files/test-ca.crt" \
+            1 \
+            -c "Indexing the trusted CAs... ok" \
+            -c "x509_verify_cert() returned" \
+            -c "! The certificate is not correctly signed by the trusted CA" \
+            -c "X509 - Certificate verification failed"
+
+requires_config_enabled MBEDTLS_X509_CA_STORE
+run_test    "CA store: server badcert" \
+            "$P_SRV crt_file=data_files/server5-badsign.crt \
+             key_file=data_files/server5.key" \
+            "$P_CLI debug_level=1 auth_mode=required ca_store=1" \
+            1 \
+            -c "x509_verify_cert() returned" \
+            -c "! The certificate is not correctly signed by the trusted CA" \
+            -c "X509 - Certificate verification failed"
+
+# Tests for the verify cache
+
+requires_config_enabled MBEDTLS_X509_VERIFY_CACHE
+run_test    "Verify cache: client reconnects" \
+            "$P_SRV auth_mode=required verify_cache=1 tickets=0 cache_max=0" \
+            "$P_CLI reconnect=1 tickets=0" \
+            0 \
+            -s "Verify cache: 0 hits, 1 misses" \
+            -s "Verify cache: 1 hits, 1 misses" \
+            -S "Verifying peer X.509 certificate... failed" \
+            -S "! mbedtls_ssl_handshake returned" \
+            -c "Reconnecting with saved session"
+
+requires_config_enabled MBEDTLS_X509_VERIFY_CACHE
+run_test    "Verify cache: client badcert reconnects" \
+            "$P_SRV auth_mode=optional verify_cache=1 tickets=0 cache_max=0" \
+            "$P_CLI reconnect=1 tickets=0 crt_file=data_files/server5-badsign.crt \
+             key_file=data_files/server5.key" \
+            0 \
+            -s "Verify cache: 0 hits, 1 misses" \
+            -s "Verify cache: 1 hits, 1 misses" \
+            -s "Verifying peer X.509 certificate... failed" \
+            -s "! The certificate is not correctly signed by the trusted CA" \
+            -S "! mbedtls_ssl_handshake returned"
+
+requires_config_enabled MBEDTLS_X509_VERIFY_CACHE
+run_test    "Verify cache: resumed session is not verified" \
+            "$P_SRV debug_level=3 auth_mode=required verify_cache=1 tickets=0" \
+            "$P_CLI reconnect=1 tickets=0" \
+            0 \
+            -s "Verify cache: 0 hits, 1 misses" \
+            -S "Verify cache: 1 hits" \
+            -s "a session has been resumed" \
+            -S "! mbedtls_ssl_handshake returned"
+
+# Tests for lazy parsing of the trusted CAs
+
+requires_config_enabled MBEDTLS_X509_CRT_LAZY_PARSE
+run_test    "Lazy CA parsing: server cert trusted" \
+            "$P_SRV" \
+            "$P_CLI debug_level=1 auth_mode=required ca_lazy=1" \
+            0 \
+            -C "x509_verify_cert() returned" \
+            -C "! mbedtls_ssl_handshake returned"
+
+requires_config_enabled MBEDTLS_X509_CRT_LAZY_PARSE
+run_test    "Lazy CA parsing: server cert from another CA" \
+            "$P_SRV crt_file=data_files/server5.crt \
+             key_file=data_files/server5.key" \
+            "$P_CLI debug_level=1 auth_mode=required ca_lazy=1 \
+             ca_file=data_files/test-ca.crt" \
+            1 \
+            -c "x509_verify_cert() returned" \
+            -c "! The certificate is not correctly signed by the trusted CA" \
+            -c "X509 - Certificate verification failed"
+
+requires_config_enabled MBEDTLS_X509_CRT_LAZY_PARSE
+requires_config_enabled MBEDTLS_X509_CA_STORE
+run_test    "Lazy CA parsing: with CA store" \
+            "$P_SRV" \
+            "$P_CLI debug_level=1 auth_mode=required ca_lazy=1 ca_store=1" \
+            0 \
+            -c "Indexing the trusted CAs... ok" \
+            -C "x509_verify_cert() returned" \
+            -C "! mbedtls_ssl_handshake returned"
+
 # Tests for version negotiation
 
 run_test    "Version check: all -> 1.2" \